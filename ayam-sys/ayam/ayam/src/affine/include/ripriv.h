@@ -559,6 +559,26 @@ RtVoid
    RiGeometricRepresentation( RtToken type );
 
 
+#ifndef __FILE_RIBE
+extern 
+#endif
+RtPointer
+   RiFragmentBegin( void );
+
+#ifndef __FILE_RIBE
+extern 
+#endif
+RtBoolean
+   RiFragmentWrite( RtPointer fragment );
+
+#ifndef __FILE_RIBE
+extern 
+#endif
+RtVoid
+   RiFragmentEnd( void ),
+   RiFragmentFree( RtPointer fragment );
+
+
 #ifdef _RIPRIV_FUNC_TYPES 
 #include <riprivf.h>
 #endif
@@ -65,9 +65,14 @@ typedef struct _HASHATOM
    char              *name;
    int               classNtype;
    int               n;
+   int               flags;
    struct _HASHATOM  *next;
 } HASHATOM;
 
+/* Values of HASHATOM.flags (fragments only). */
+#define HASHATOM_DECLARED  1  /* declared in the fragment */
+#define HASHATOM_USED      2  /* used as declared in the main stream */
+
 typedef struct _UVSTEPS 
 {
    RtInt            nustep;
@@ -88,6 +93,47 @@ typedef struct _PRIVATESTATEDATA
    RtInt         ncolor;
    RtInt         firstline;
    RtBoolean     prman36changes;
+   RtInt         format;
+   RtInt         precision;
+   RtBoolean     gzip;
 } PRIVATESTATEDATA;
 
+/* Values of PRIVATESTATEDATA.format, set with 'Option "rib" "format"'. */
+#define RIBFORMAT_ASCII   0
+#define RIBFORMAT_BINARY  1
+
+/* A declaration a fragment took from the main stream (or did not find). */
+typedef struct _RIBLOOKUP
+{
+   char  *name;
+   int   found;
+   int   classNtype;
+   int   n;
+} RIBLOOKUP;
+
+/* The state of a RIB stream:  the main stream opened by RiBegin() or
+ *    a fragment written to memory (see RiFragmentBegin()).
+ */
+typedef struct _RIBSTREAM
+{
+   PRIVATESTATEDATA  state;
+   FILE              *ribfp;
+   HASHATOM          *ribhashtable[HASHMOD];
+   unsigned char     *buf;
+   size_t            buflen;
+#ifdef AYUSEZLIB
+   z_stream          z;
+   int               gz;
+#endif
+   /* fragments only */
+   PRIVATESTATEDATA  start;
+   unsigned char     *mem;
+   size_t            memlen;
+   size_t            memsize;
+   int               failed;
+   RIBLOOKUP         *lookups;
+   int               nlookups;
+   int               alookups;
+} RIBSTREAM;
+
 #endif
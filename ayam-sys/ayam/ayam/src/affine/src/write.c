@@ -92,6 +92,14 @@
  *      11-28-99  Fixed RiBasis() output for nonstandard basis. [EPPS99]
  *      02-15-00  Fixed gridsize and merge declarations.  Added declaration
  *                type "int" [EVES00].
+ *      10-17-26  Output is collected in a large buffer.  Added binary
+ *                format, 'Option "rib" "precision"' for the number of
+ *                significant digits of floats and gzip compression
+ *                (with -DAYUSEZLIB).
+ *                Moved the writer state into a RIBSTREAM per thread and
+ *                added RiFragmentBegin(), RiFragmentEnd(),
+ *                RiFragmentWrite() and RiFragmentFree() to write parts
+ *                of a RIB in parallel.
  *
  *
  *    References:
@@ -161,6 +169,9 @@
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#ifdef AYUSEZLIB
+#include <zlib.h>
+#endif
 #include <ripriv.h>
 #include "write.h"
 
@@ -192,17 +203,39 @@ static void ClearHashTable( void );
 char *GetClassNType( char *name, char *declaration, int *classNtype, int *n );
 static void AddToHashTable( char *name, int classNtype, int n );
 static int GetFromHashTable( char *name, int* classNtype, int *n );
+static void AddLookup( char *name, int found, int classNtype, int n );
 static void HandleParamList( va_list ap, 
 			    RtInt n, RtToken tokens[], RtPointer parms[],
 			    int nvertex, int nuniform, int nvarying );
 static char *HandleGettingFilterName( RtFilterFunc filterfunc );
+static void HandleRibOption( char *option, char *setting );
 static RtVoid HandleFirstLine( int notacomment );
+static void RibFlush( void );
+static void RibWrite( const void *data, size_t len );
+static void RibPutc( int c );
+static void RibPutInt( long i );
+static void RibPutFloat( double f );
+static void RibPutFloatArray( RtFloat *p, int n );
+static void vRibPrintf( const char *format, va_list ap );
+static void RibPrintf( const char *format, ... );
 
 #define CheckIfFirstLine()  if (gSRIBW.firstline) \
                                HandleFirstLine(RI_FALSE)
 
 
-PRIVATESTATEDATA  gSRIBW = {
+/* All output goes through a large buffer that is written to fp
+ *    (optionally compressed with zlib) by RibFlush() when full.
+ *    In binary format the numbers are written as binary RIB tokens
+ *    ([PIXA89] Appendix C), strings and request names stay ASCII.
+ */
+#define RIBBUFSIZE  262144
+static unsigned char mainbuf[RIBBUFSIZE];
+
+/* The main stream.  Fragments (see RiFragmentBegin()) have their own
+ *    RIBSTREAM, ribstream points to the stream of the calling thread.
+ */
+static RIBSTREAM  mainstream = {
+   /* PRIVATESTATEDATA state */ {
    /* RtBoolean     hashtablecleared */ RI_TRUE,
    /* unsigned int  LastObjectHandle */ 1,
    /* unsigned int  LastLightHandle */  1,
@@ -212,12 +245,307 @@ PRIVATESTATEDATA  gSRIBW = {
    /* RtInt         blocklevel */       0,
    /* RtInt         ncolor */           3,
    /* RtInt         firstline */        2,
-   /* RtBoolean     prman36changes */   RI_TRUE
+   /* RtBoolean     prman36changes */   RI_TRUE,
+   /* RtInt         format */           RIBFORMAT_ASCII,
+   /* RtInt         precision */        0,
+   /* RtBoolean     gzip */             RI_FALSE
+   },
+   /* FILE          *ribfp */           NULL,
+   /* HASHATOM      *ribhashtable[] */  { NULL },
+   /* unsigned char *buf */             mainbuf
 };
+
+#ifdef _MSC_VER
+#define RIBTLS  __declspec(thread)
+#else
+#define RIBTLS  __thread
+#endif
+static RIBTLS RIBSTREAM  *ribstream = &mainstream;
+
+#define gSRIBW     (ribstream->state)
+#define fp         (ribstream->ribfp)
+#define hashtable  (ribstream->ribhashtable)
+#define ribbuf     (ribstream->buf)
+#define ribbuflen  (ribstream->buflen)
+#define ribz       (ribstream->z)
+#define ribgz      (ribstream->gz)
+
 RtInt RiLastError = 0;
-static FILE          *fp = NULL;
 static va_list       noap;
-static HASHATOM      *hashtable[HASHMOD];
+
+
+static void RibFlush( void )
+{
+#ifdef AYUSEZLIB
+   unsigned char  out[16384];
+#endif
+   unsigned char  *mem;
+   size_t         memsize;
+
+   if (ribstream != &mainstream)
+   {
+      /* Fragment, keep the output in memory. */
+      if (ribbuflen && !ribstream->failed)
+      {
+	 if (ribstream->memlen + ribbuflen > ribstream->memsize)
+	 {
+	    memsize = ribstream->memsize ? 2*ribstream->memsize : RIBBUFSIZE;
+	    while (memsize < ribstream->memlen + ribbuflen)
+	      memsize *= 2;
+	    mem = (unsigned char*)realloc( ribstream->mem, memsize );
+	    if (!mem)
+	    {
+	       ribstream->failed = 1;
+	       ribbuflen = 0;
+	       return;
+	    }
+	    ribstream->mem = mem;
+	    ribstream->memsize = memsize;
+	 }
+	 memcpy( ribstream->mem + ribstream->memlen, ribbuf, ribbuflen );
+	 ribstream->memlen += ribbuflen;
+      }
+      ribbuflen = 0;
+      return;
+   }
+
+   if (!fp || !ribbuflen)
+   {
+      ribbuflen = 0;
+      return;
+   }
+#ifdef AYUSEZLIB
+   if (ribgz)
+   {
+      ribz.next_in = ribbuf;
+      ribz.avail_in = (uInt)ribbuflen;
+      do
+      {
+	 ribz.next_out = out;
+	 ribz.avail_out = sizeof(out);
+	 deflate( &ribz, Z_NO_FLUSH );
+	 fwrite( out, 1, sizeof(out) - ribz.avail_out, fp );
+      } while (ribz.avail_out == 0);
+      ribbuflen = 0;
+      return;
+   }
+#endif
+   fwrite( ribbuf, 1, ribbuflen, fp );
+   ribbuflen = 0;
+}
+
+
+static void RibWrite( const void *data, size_t len )
+{
+   if (ribbuflen + len > RIBBUFSIZE)
+   {
+      RibFlush();
+      if (len > RIBBUFSIZE)
+      {
+	 /* Too big for the buffer, hand it over in buffer sized pieces. */
+	 while (len > RIBBUFSIZE)
+	 {
+	    memcpy( ribbuf, data, RIBBUFSIZE );
+	    ribbuflen = RIBBUFSIZE;
+	    RibFlush();
+	    data = (const char*)data + RIBBUFSIZE;
+	    len -= RIBBUFSIZE;
+	 }
+      }
+   }
+   memcpy( ribbuf + ribbuflen, data, len );
+   ribbuflen += len;
+}
+
+
+static void RibPutc( int c )
+{
+   if (ribbuflen == RIBBUFSIZE)
+     RibFlush();
+   ribbuf[ribbuflen++] = (unsigned char)c;
+}
+
+
+static void RibPutInt( long i )
+{
+   unsigned char  b[5];
+   int            l;
+
+
+   if (gSRIBW.format != RIBFORMAT_BINARY)
+   {
+      if (ribbuflen + 32 > RIBBUFSIZE)
+	RibFlush();
+      ribbuflen += sprintf( (char*)ribbuf + ribbuflen, "%ld", i );
+      return;
+   }
+
+   /* Integer token 0200+l, followed by l+1 bytes (big endian). */
+   if (i >= -128 && i <= 127)
+     l = 0;
+   else if (i >= -32768 && i <= 32767)
+     l = 1;
+   else if (i >= -8388608 && i <= 8388607)
+     l = 2;
+   else
+     l = 3;
+   b[0] = (unsigned char)(0200 + l);
+   b[1] = (unsigned char)((unsigned long)i >> 24);
+   b[2] = (unsigned char)((unsigned long)i >> 16);
+   b[3] = (unsigned char)((unsigned long)i >> 8);
+   b[4] = (unsigned char)i;
+   b[3-l] = b[0];
+   RibWrite( b + 3 - l, l + 2 );
+}
+
+
+static void RibPutFloat( double f )
+{
+   union { float f; unsigned int u; } v;
+   unsigned char  b[5];
+   char           *s;
+
+
+   if (gSRIBW.format != RIBFORMAT_BINARY)
+   {
+      if (ribbuflen + 32 > RIBBUFSIZE)
+	RibFlush();
+      s = (char*)ribbuf + ribbuflen;
+      if (gSRIBW.precision > 0)
+	ribbuflen += sprintf( s, "%.*g", gSRIBW.precision, f );
+      else
+	ribbuflen += sprintf( s, "%g", f );
+      return;
+   }
+
+   /* Float token 0244, followed by an IEEE single (big endian). */
+   v.f = (float)f;
+   b[0] = 0244;
+   b[1] = (unsigned char)(v.u >> 24);
+   b[2] = (unsigned char)(v.u >> 16);
+   b[3] = (unsigned char)(v.u >> 8);
+   b[4] = (unsigned char)v.u;
+   RibWrite( b, 5 );
+}
+
+
+/* Write the array p[n] including the brackets.  In binary format this is
+ *    a single float array token (0310+l, followed by n in l+1 bytes).
+ */
+static void RibPutFloatArray( RtFloat *p, int n )
+{
+   union { float f; unsigned int u; } v;
+   unsigned char  b[5];
+   register int   i;
+   int            l;
+
+
+   if (gSRIBW.format != RIBFORMAT_BINARY)
+   {
+      RibPutc( '[' );
+      for ( i=0; i<n; i++ )
+      {
+	 RibPutFloat( p[i] );
+	 RibPutc( ' ' );
+      }
+      RibPutc( ']' );
+      return;
+   }
+
+   if (n < 256)
+     l = 0;
+   else if (n < 65536)
+     l = 1;
+   else if (n < 16777216)
+     l = 2;
+   else
+     l = 3;
+   b[0] = (unsigned char)(0310 + l);
+   b[1] = (unsigned char)((unsigned int)n >> 24);
+   b[2] = (unsigned char)((unsigned int)n >> 16);
+   b[3] = (unsigned char)((unsigned int)n >> 8);
+   b[4] = (unsigned char)n;
+   b[3-l] = b[0];
+   RibWrite( b + 3 - l, l + 2 );
+
+   for ( i=0; i<n; i++ )
+   {
+      v.f = p[i];
+      b[0] = (unsigned char)(v.u >> 24);
+      b[1] = (unsigned char)(v.u >> 16);
+      b[2] = (unsigned char)(v.u >> 8);
+      b[3] = (unsigned char)v.u;
+      if (ribbuflen + 4 > RIBBUFSIZE)
+	RibFlush();
+      memcpy( ribbuf + ribbuflen, b, 4 );
+      ribbuflen += 4;
+   }
+}
+
+
+/* Minimal printf() for the RIB statements, it knows %d, %u, %g, %s, %c
+ *    and %%.  Numbers are written by RibPutInt() and RibPutFloat(), so that
+ *    they follow the selected format and precision.  In binary format the
+ *    blank after a number is dropped as binary tokens need no separator.
+ */
+static void vRibPrintf( const char *format, va_list ap )
+{
+   register const char  *f;
+   const char           *s;
+   int                  isbinary;
+
+
+   isbinary = (gSRIBW.format == RIBFORMAT_BINARY);
+   for ( f=format; *f; f++ )
+   {
+      if (*f != '%')
+      {
+	 /* copy all text up to the next conversion at once */
+	 s = f;
+	 while (f[1] && f[1] != '%')
+	   f++;
+	 RibWrite( s, f - s + 1 );
+	 continue;
+      }
+      switch (*++f)
+      {
+       case 'd':
+	 RibPutInt( va_arg(ap,int) );
+	 break;
+       case 'u':
+	 RibPutInt( (long)va_arg(ap,unsigned int) );
+	 break;
+       case 'g':
+	 RibPutFloat( va_arg(ap,double) );
+	 break;
+       case 's':
+	 s = va_arg(ap,char*);
+	 RibWrite( s, strlen(s) );
+	 continue;
+       case 'c':
+	 RibPutc( va_arg(ap,int) );
+	 continue;
+       case '\0':
+	 return;
+       default:
+	 RibPutc( *f );
+	 continue;
+      }
+      if (isbinary && f[1] == ' ')
+	f++;
+   }
+}
+
+
+static void RibPrintf( const char *format, ... )
+{
+   va_list  ap;
+
+
+   va_start(ap,format);
+   vRibPrintf( format, ap );
+   va_end(ap);
+}
 
 
 static void SetUpHashTable( void )
@@ -456,6 +784,7 @@ static void AddToHashTable( char *name, int classNtype, int n )
       if (!strcmp( name, h->name ))
       {
 	 h->classNtype = classNtype;
+	 h->flags |= HASHATOM_DECLARED;
 	 return;
       }
       h = h->next;
@@ -463,17 +792,25 @@ static void AddToHashTable( char *name, int classNtype, int n )
    
    h = (HASHATOM*)malloc( sizeof(HASHATOM) );
    if (!h)
-     return;
+   {
+      ribstream->failed = 1;
+      return;
+   }
    
    p = (char*)malloc(strlen(name)+1);
    if (!p)
+   {
+      free( h );
+      ribstream->failed = 1;
       return;
+   }
    strcpy( p, name );
 
    h->name = p;
    h->next = hashtable[hashvalue];
    h->classNtype = classNtype;
    h->n = n;
+   h->flags = HASHATOM_DECLARED;
    hashtable[hashvalue] = h;
    
    return;
@@ -498,17 +835,61 @@ static int GetFromHashTable( char *name, int* classNtype, int *n )
       {
 	 *classNtype = h->classNtype;
 	 *n = h->n;
+	 if (ribstream != &mainstream
+	     && !(h->flags & (HASHATOM_DECLARED | HASHATOM_USED)))
+	 {
+	    /* Fragment uses a declaration of the main stream. */
+	    h->flags |= HASHATOM_USED;
+	    AddLookup( h->name, 1, h->classNtype, h->n );
+	 }
 	 return 1; /* item found */
       }
       h = h->next;
    }
    
-
+   if (ribstream != &mainstream)
+   {
+      p = (char*)malloc(strlen(name)+1);
+      if (p)
+      {
+	 strcpy( p, name );
+	 AddLookup( p, 0, 0, 0 );
+      }
+      else
+	ribstream->failed = 1;
+   }
 
    return 0; /* nothing found */
 }
 
 
+static void AddLookup( char *name, int found, int classNtype, int n )
+{
+   RIBLOOKUP  *l;
+   int        a;
+
+   if (ribstream->nlookups == ribstream->alookups)
+   {
+      a = ribstream->alookups ? 2*ribstream->alookups : 16;
+      l = (RIBLOOKUP*)realloc( ribstream->lookups, a*sizeof(RIBLOOKUP) );
+      if (!l)
+      {
+	 if (!found)
+	   free( name );
+	 ribstream->failed = 1;
+	 return;
+      }
+      ribstream->lookups = l;
+      ribstream->alookups = a;
+   }
+   l = &ribstream->lookups[ribstream->nlookups++];
+   l->name = name;
+   l->found = found;
+   l->classNtype = classNtype;
+   l->n = n;
+}
+
+
 static void ClearHashTable( void )
 {
    register HASHATOM  *p;
@@ -727,7 +1108,7 @@ RtToken RiDeclare( char *name, char *declaration )
    {
       CheckIfFirstLine();
 
-      fprintf( fp, "Declare \"%s\" \"%s\"\n", name, declaration );
+      RibPrintf( "Declare \"%s\" \"%s\"\n", name, declaration );
    }
   
    return name;
@@ -835,7 +1216,42 @@ static void HandleParamList( va_list ap,
 	       ntype *= narray;
 	    }
 	    
-	    fprintf( fp, "\"%s\" [", paramlist );
+	    u = classNtype & TYPE;
+	    if ( gSRIBW.format == RIBFORMAT_BINARY && ntype
+		 && INT != u && INTPAIR != u && STRING != u )
+	    {
+	       /* Binary format, write all values as one float array. */
+	       switch ( u )
+	       {
+		case POINT:
+		case NORMAL:
+		case VECTOR:
+		  i = 3;
+		  break;
+		case COLOR:
+		  i = gSRIBW.ncolor;
+		  break;
+		case FLOATPAIR:
+		  i = 2;
+		  break;
+		case HPOINT:
+		  i = 4;
+		  break;
+		case MATRIX:
+		  i = 16;
+		  break;
+		default:
+		  i = 1;
+		  break;
+	       }
+	       p = ( vectorform ? (RtFloat*)parms[t] : va_arg(ap,RtFloat*) );
+	       RibPrintf( "\"%s\" ", paramlist );
+	       RibPutFloatArray( p, i*ntype );
+	       IsaLinefeedNeeded = RI_TRUE;
+	       goto NextIteration;
+	    }
+
+	    RibPrintf( "\"%s\" [", paramlist );
 
 	    /* Although entirely wacky, I'll stick in a quick check to
              *    to handle the case where ntype is zero.  Note though
@@ -846,7 +1262,7 @@ static void HandleParamList( va_list ap,
              */
 	    if (!ntype)
 	    {
-	       fprintf( fp, "]\n" );
+	       RibPrintf( "]\n" );
 	       goto NextIteration; 
 	    }
 	    
@@ -856,18 +1272,18 @@ static void HandleParamList( va_list ap,
 
 	       ip = ( vectorform ? (RtInt*)parms[t] : va_arg(ap,RtInt*) );
 	       for ( i=0; i<(ntype - 1); i++ )
-		  fprintf( fp, "%d ", ip[i] );
-	       fprintf( fp, "%d]\n", ip[i] );
+		  RibPrintf( "%d ", ip[i] );
+	       RibPrintf( "%d]\n", ip[i] );
 	       IsaLinefeedNeeded = RI_FALSE;
 	    }
 	    else if ( INTPAIR == u )
 	    {
 	       ip = ( vectorform ? (RtInt*)parms[t] : va_arg(ap,RtInt*) );
 	       if (ntype>1)
-		  fputc( '\n', fp );
+		  RibPutc( '\n' );
 	       for ( i=0; i<2*(ntype - 1); i+=2 )
-		  fprintf( fp, "%d %d\n", ip[i], ip[i+1] );
-	       fprintf( fp, "%d %d]\n", ip[i], ip[i+1] );
+		  RibPrintf( "%d %d\n", ip[i], ip[i+1] );
+	       RibPrintf( "%d %d]\n", ip[i], ip[i+1] );
 	       IsaLinefeedNeeded = RI_FALSE;
 	    }
 	    else if ( STRING == u )
@@ -881,8 +1297,8 @@ static void HandleParamList( va_list ap,
 	       tp = (RtToken*)( vectorform ? (RtToken*)parms[t] 
 				: va_arg(ap,RtToken*));
 	       for ( i=0; i<(ntype-1); i++ )
-		  fprintf( fp, "\"%s\" ", *tp++ );
-	       fprintf( fp, "\"%s\"]", *tp );
+		  RibPrintf( "\"%s\" ", *tp++ );
+	       RibPrintf( "\"%s\"]", *tp );
 	       IsaLinefeedNeeded = RI_TRUE;
 	    }
 	    else
@@ -893,61 +1309,61 @@ static void HandleParamList( va_list ap,
 	       {
 		case FLOAT:
 		  for ( i=0; i<(ntype-1); i++ )
-		     fprintf( fp, "%g ", p[i] );
-		  fprintf( fp, "%g]", p[i] );
+		     RibPrintf( "%g ", p[i] );
+		  RibPrintf( "%g]", p[i] );
 		  IsaLinefeedNeeded = RI_TRUE;
 		  break;
 		case POINT: 
 		case NORMAL:
 		case VECTOR:
 		  if (ntype>1)
-		     fputc( '\n', fp );
+		     RibPutc( '\n' );
 		  for ( i=0; i<(3*(ntype-1)); i+=3 )
-		     fprintf( fp, "%g %g %g\n", p[i], p[i+1], p[i+2] );
-		  fprintf( fp, "%g %g %g]\n", p[i], p[i+1], p[i+2] );
+		     RibPrintf( "%g %g %g\n", p[i], p[i+1], p[i+2] );
+		  RibPrintf( "%g %g %g]\n", p[i], p[i+1], p[i+2] );
 		  IsaLinefeedNeeded = RI_FALSE;
 		  break;		   
 		case COLOR: 
 		  if (ntype>1)
-		     fputc( '\n', fp );
+		     RibPutc( '\n' );
 		  if (gSRIBW.ncolor==3)
 		  {
 		     for ( i=0; i<3*(ntype-1); i+=3 )
-			fprintf( fp, "%g %g %g\n", p[i], p[i+1], p[i+2] );
-		     fprintf( fp, "%g %g %g]\n", p[i], p[i+1], p[i+2] );
+			RibPrintf( "%g %g %g\n", p[i], p[i+1], p[i+2] );
+		     RibPrintf( "%g %g %g]\n", p[i], p[i+1], p[i+2] );
 		  }
 		  else
 		  {
 		     for ( i=0; i<(ntype*gSRIBW.ncolor - 1); i++ )
-			fprintf( fp, "%g ", p[i] );
-		     fprintf( fp, "%g]\n", p[i] );
+			RibPrintf( "%g ", p[i] );
+		     RibPrintf( "%g]\n", p[i] );
 		  }
 		  IsaLinefeedNeeded = RI_FALSE;
 		  break;
 		case FLOATPAIR:
 		  if (ntype>1)
-		     fputc( '\n', fp );
+		     RibPutc( '\n' );
 		  for ( i=0; i<2*(ntype - 1); i+=2 )
-		     fprintf( fp, "%g %g\n", p[i], p[i+1] );
-		  fprintf( fp, "%g %g]\n", p[i], p[i+1] );
+		     RibPrintf( "%g %g\n", p[i], p[i+1] );
+		  RibPrintf( "%g %g]\n", p[i], p[i+1] );
 		  IsaLinefeedNeeded = RI_FALSE;
 		  break;
 		case HPOINT:
 		  if (ntype>1)
-		     fputc( '\n', fp );
+		     RibPutc( '\n' );
 		  for ( i=0; i<4*(ntype-1); i+=4 )
-		     fprintf( fp, "%g %g %g %g\n", 
+		     RibPrintf( "%g %g %g %g\n", 
 			      p[i],p[i+1],p[i+2],p[i+3] );
-		  fprintf( fp, "%g %g %g %g]\n", 
+		  RibPrintf( "%g %g %g %g]\n", 
 			   p[i],p[i+1],p[i+2],p[i+3] );
 		  IsaLinefeedNeeded = RI_FALSE;
 		  break;
 		case MATRIX:
-		  fputc( '\n', fp );
+		  RibPutc( '\n' );
 		  for ( i=0; i<16*(ntype-1); i+=4 )
-		     fprintf( fp, "%g %g %g %g\n", 
+		     RibPrintf( "%g %g %g %g\n", 
 			      p[i],p[i+1],p[i+2],p[i+3] );
-		  fprintf( fp, "%g %g %g %g]\n", 
+		  RibPrintf( "%g %g %g %g]\n", 
 			   p[i],p[i+1],p[i+2],p[i+3] );
 		  IsaLinefeedNeeded = RI_FALSE;
 		  break;
@@ -989,7 +1405,7 @@ static void HandleParamList( va_list ap,
    }
    if (IsaLinefeedNeeded)
    {
-      fputc( '\n', fp );
+      RibPutc( '\n' );
       return;
    }
 }
@@ -1029,7 +1445,7 @@ static RtVoid HandleFirstLine( int isacomment )
 
    if (gSRIBW.firstline==2 || isacomment)
    {
-      fprintf( fp, "##RenderMan RIB-Structure 1.0\n" );
+      RibPrintf( "##RenderMan RIB-Structure 1.0\n" );
 
       /* If !isacomment, the following if will mark gSRIBW.firstline as having
        *    printed both a ##RenderMan hint and a version statement.
@@ -1045,7 +1461,7 @@ static RtVoid HandleFirstLine( int isacomment )
     */
    if (!isacomment)
    {
-      fprintf( fp, "version 3.03\n" );
+      RibPrintf( "version 3.03\n" );
       gSRIBW.firstline=0;
    }
 }
@@ -1054,10 +1470,24 @@ static RtVoid HandleFirstLine( int isacomment )
 RtVoid RiBegin( RtToken name )
 {
    if (name)
-     fp = fopen( name, "w" );
+     fp = fopen( name, (gSRIBW.format == RIBFORMAT_BINARY || gSRIBW.gzip) ?
+		 "wb" : "w" );
    else
      fp = stdout;
 
+   ribbuflen = 0;
+#ifdef AYUSEZLIB
+   ribgz = 0;
+   if (fp && gSRIBW.gzip)
+   {
+      memset( &ribz, 0, sizeof(z_stream) );
+      /* 15+16: zlib window size plus gzip header and trailer */
+      if (deflateInit2( &ribz, Z_BEST_SPEED, Z_DEFLATED, 15+16, 8,
+			Z_DEFAULT_STRATEGY ) == Z_OK)
+	ribgz = 1;
+   }
+#endif
+
    gSRIBW.LastObjectHandle = 1;
    gSRIBW.LastLightHandle = 1;
    gSRIBW.nustep = 3;
@@ -1081,10 +1511,37 @@ RtVoid RiEnd( void )
    auto UVSTEPS  *p,*pp;
 
 
+#ifdef AYUSEZLIB
+   unsigned char  out[16384];
+#endif
+
+
+   RibFlush();
+#ifdef AYUSEZLIB
+   if (ribgz)
+   {
+      ribz.next_in = ribbuf;
+      ribz.avail_in = 0;
+      do
+      {
+	 ribz.next_out = out;
+	 ribz.avail_out = sizeof(out);
+	 deflate( &ribz, Z_FINISH );
+	 if (fp)
+	   fwrite( out, 1, sizeof(out) - ribz.avail_out, fp );
+      } while (ribz.avail_out == 0);
+      deflateEnd( &ribz );
+      ribgz = 0;
+   }
+#endif
    if (fp && fp!=stdout)
    {
       fclose(fp);
    }
+   else if (fp)
+   {
+      fflush(fp);
+   }
    fp = NULL;
    p = gSRIBW.stepstack;
    while (p)
@@ -1097,6 +1554,190 @@ RtVoid RiEnd( void )
 }
 
 
+/* Fragments:  To write independent parts of a RIB in parallel, each
+ *    part can be written by a different thread into a fragment in memory.
+ *    RiFragmentBegin() starts a fragment for the calling thread from the
+ *    current state of the main stream (which must not change until the
+ *    fragment is written), all further Ri calls of this thread go to the
+ *    fragment until RiFragmentEnd().  RiFragmentWrite() then appends the
+ *    fragments to the main stream in the desired order.  It refuses to do
+ *    so if the output of the fragment would have been different had it
+ *    been written to the main stream directly (because it used a
+ *    declaration that an earlier fragment changed), the caller should
+ *    then write this part again directly.  RiFragmentFree() releases a
+ *    fragment.
+ */
+RtPointer RiFragmentBegin( void )
+{
+   RIBSTREAM  *f;
+   HASHATOM   *h, *c;
+   int        i;
+
+   if (ribstream != &mainstream)
+     return NULL;
+
+   f = (RIBSTREAM*)calloc( 1, sizeof(RIBSTREAM) );
+   if (!f)
+     return NULL;
+   f->buf = (unsigned char*)malloc( RIBBUFSIZE );
+   if (!f->buf)
+   {
+      free( f );
+      return NULL;
+   }
+
+   f->state = mainstream.state;
+   f->state.stepstack = NULL;
+   f->start = f->state;
+
+   /* The fragment is open if the main stream is, its output goes to memory. */
+   f->ribfp = mainstream.ribfp;
+
+   for ( i=0; i<HASHMOD && !f->failed; i++ )
+   {
+      for ( h=mainstream.ribhashtable[i]; h; h=h->next )
+      {
+	 c = (HASHATOM*)malloc( sizeof(HASHATOM) );
+	 if (!c)
+	 {
+	    f->failed = 1;
+	    break;
+	 }
+	 c->name = (char*)malloc( strlen(h->name)+1 );
+	 if (!c->name)
+	 {
+	    free( c );
+	    f->failed = 1;
+	    break;
+	 }
+	 strcpy( c->name, h->name );
+	 c->classNtype = h->classNtype;
+	 c->n = h->n;
+	 c->flags = 0;
+	 c->next = f->ribhashtable[i];
+	 f->ribhashtable[i] = c;
+      }
+   }
+
+   ribstream = f;
+
+   return (RtPointer)f;
+}
+
+
+RtVoid RiFragmentEnd( void )
+{
+   if (ribstream == &mainstream)
+     return;
+
+   RibFlush();
+
+   ribstream = &mainstream;
+}
+
+
+RtBoolean RiFragmentWrite( RtPointer fragment )
+{
+   RIBSTREAM         *f = (RIBSTREAM*)fragment;
+   PRIVATESTATEDATA  *m = &mainstream.state;
+   HASHATOM          *h;
+   RIBLOOKUP         *l;
+   int               i, classNtype, n, found;
+
+   if (!f || f->failed || ribstream != &mainstream)
+     return RI_FALSE;
+
+   /* The fragment must start where the main stream stands now and
+    *    leave all attribute blocks it opened.
+    */
+   if (f->start.LastObjectHandle != m->LastObjectHandle
+       || f->start.LastLightHandle != m->LastLightHandle
+       || f->start.nustep != m->nustep || f->start.nvstep != m->nvstep
+       || f->start.blocklevel != m->blocklevel
+       || f->start.ncolor != m->ncolor
+       || f->start.firstline != m->firstline
+       || f->start.prman36changes != m->prman36changes
+       || f->start.format != m->format
+       || f->start.precision != m->precision
+       || f->state.stepstack || f->state.blocklevel != m->blocklevel)
+     return RI_FALSE;
+
+   /* All declarations used from the main stream must still be the same. */
+   for ( i=0; i<f->nlookups; i++ )
+   {
+      l = &f->lookups[i];
+      found = GetFromHashTable( l->name, &classNtype, &n );
+      if (found != l->found
+	  || (found && (classNtype != l->classNtype || n != l->n)))
+	return RI_FALSE;
+   }
+
+   RibWrite( f->mem, f->memlen );
+
+   /* Take over the declarations and state of the fragment. */
+   for ( i=0; i<HASHMOD; i++ )
+   {
+      for ( h=f->ribhashtable[i]; h; h=h->next )
+      {
+	 if (h->flags & HASHATOM_DECLARED)
+	   AddToHashTable( h->name, h->classNtype, h->n );
+      }
+   }
+   m->LastObjectHandle = f->state.LastObjectHandle;
+   m->LastLightHandle = f->state.LastLightHandle;
+   m->nustep = f->state.nustep;
+   m->nvstep = f->state.nvstep;
+   m->ncolor = f->state.ncolor;
+   m->firstline = f->state.firstline;
+   m->prman36changes = f->state.prman36changes;
+
+   return RI_TRUE;
+}
+
+
+RtVoid RiFragmentFree( RtPointer fragment )
+{
+   RIBSTREAM  *f = (RIBSTREAM*)fragment;
+   HASHATOM   *h, *hh;
+   UVSTEPS    *p, *pp;
+   int        i;
+
+   if (!f || f == &mainstream)
+     return;
+
+   if (ribstream == f)
+     ribstream = &mainstream;
+
+   for ( i=0; i<f->nlookups; i++ )
+   {
+      if (!f->lookups[i].found)
+	free( f->lookups[i].name );
+   }
+   for ( i=0; i<HASHMOD; i++ )
+   {
+      h = f->ribhashtable[i];
+      while (h)
+      {
+	 hh = h->next;
+	 free( h->name );
+	 free( h );
+	 h = hh;
+      }
+   }
+   p = f->state.stepstack;
+   while (p)
+   {
+      pp = p;
+      p = p->next;
+      free(pp);
+   }
+   free( f->lookups );
+   free( f->mem );
+   free( f->buf );
+   free( f );
+}
+
+
 RtVoid RiFrameBegin( RtInt frame )
 {
    if (!fp)
@@ -1104,7 +1745,7 @@ RtVoid RiFrameBegin( RtInt frame )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "FrameBegin %d\n", frame );
+   RibPrintf( "FrameBegin %d\n", frame );
 }
 
 
@@ -1115,7 +1756,7 @@ RtVoid RiFrameEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "FrameEnd\n" );
+   RibPrintf( "FrameEnd\n" );
 }
 
 
@@ -1129,7 +1770,7 @@ RtObjectHandle RiObjectBegin( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ObjectBegin %u\n", gSRIBW.LastObjectHandle );
+   RibPrintf( "ObjectBegin %u\n", gSRIBW.LastObjectHandle );
    object = (RtObjectHandle)ay_otype_getpointer(gSRIBW.LastObjectHandle);
    gSRIBW.LastObjectHandle++;
    return object;
@@ -1143,7 +1784,7 @@ RtVoid RiObjectEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ObjectEnd\n" );
+   RibPrintf( "ObjectEnd\n" );
 }
 
 
@@ -1154,7 +1795,7 @@ RtVoid RiObjectInstance( RtObjectHandle handle )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ObjectInstance %u\n", *handle );
+   RibPrintf( "ObjectInstance %u\n", *handle );
 }
 
 
@@ -1170,19 +1811,19 @@ RtVoid RiMotionBegin( RtInt n, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MotionBegin [" );
+   RibPrintf( "MotionBegin [" );
    va_start(ap,n);
    for ( i=0; i<(n-1); i++)
    {
       /* RtFloat's get passed on the stack as doubles. */
       f = va_arg(ap,double);
-      fprintf( fp, "%g ", f );
+      RibPrintf( "%g ", f );
    }
    if (n>0)
    {
       /* RtFloat's get passed on the stack as doubles. */
       f = va_arg(ap,double);
-      fprintf( fp, "%g]\n", f );
+      RibPrintf( "%g]\n", f );
    }
    va_end(ap);
 }
@@ -1198,10 +1839,10 @@ RtVoid RiMotionBeginV( RtInt n, RtFloat times[] )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MotionBegin [" );
+   RibPrintf( "MotionBegin [" );
    for ( i=0; i<(n-1); i++)
-      fprintf( fp, "%g ", times[i] );
-   fprintf( fp, "%g]\n", times[i] );
+      RibPrintf( "%g ", times[i] );
+   RibPrintf( "%g]\n", times[i] );
 }
 
 
@@ -1212,7 +1853,7 @@ RtVoid RiMotionEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MotionEnd\n" );
+   RibPrintf( "MotionEnd\n" );
 }
 
 
@@ -1228,7 +1869,7 @@ RtVoid RiSolidBegin( RtToken operation )
        || !strcmp( operation, "union" )
        || !strcmp( operation, "difference" ))
    {
-      fprintf( fp, "SolidBegin \"%s\"\n", operation );
+      RibPrintf( "SolidBegin \"%s\"\n", operation );
    }
 }
 
@@ -1240,7 +1881,7 @@ RtVoid RiSolidEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "SolidEnd\n" );
+   RibPrintf( "SolidEnd\n" );
 }
 
 
@@ -1254,7 +1895,7 @@ RtVoid RiAtmosphere( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Atmosphere \"%s\" ", name );
+   RibPrintf( "Atmosphere \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1269,7 +1910,7 @@ RtVoid RiAtmosphereV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Atmosphere \"%s\" ", name );
+   RibPrintf( "Atmosphere \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1284,12 +1925,12 @@ RtVoid RiConcatTransform( RtMatrix transform)
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ConcatTransform [\n" );
+   RibPrintf( "ConcatTransform [\n" );
    
    for ( i=0; i < 4; i++)
-     fprintf( fp, "%g %g %g %g\n", transform[i][0], transform[i][1], 
+     RibPrintf( "%g %g %g %g\n", transform[i][0], transform[i][1], 
 	     transform[i][2], transform[i][3] );
-   fprintf( fp, "]\n" );
+   RibPrintf( "]\n" );
 }
 
 
@@ -1300,7 +1941,7 @@ RtVoid RiCoordinateSystem( RtToken space )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "CoordinateSystem \"%s\"\n", space );
+   RibPrintf( "CoordinateSystem \"%s\"\n", space );
 }
 
 
@@ -1311,7 +1952,7 @@ RtVoid RiCoordSysTransform( RtToken space )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "CoordSysTransform \"%s\"\n", space );
+   RibPrintf( "CoordSysTransform \"%s\"\n", space );
 }
 
 
@@ -1325,7 +1966,7 @@ RtVoid RiDeformation( RtToken name, ...)
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Deformation \"%s\" ", name );
+   RibPrintf( "Deformation \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1340,7 +1981,7 @@ RtVoid RiDeformationV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Deformation \"%s\" ", name );
+   RibPrintf( "Deformation \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1355,7 +1996,7 @@ RtVoid RiDisplacement( RtToken name, ...)
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Displacement \"%s\" ", name );
+   RibPrintf( "Displacement \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1370,7 +2011,7 @@ RtVoid RiDisplacementV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Displacement \"%s\" ", name );
+   RibPrintf( "Displacement \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1385,7 +2026,7 @@ RtVoid RiExterior( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Exterior \"%s\" ", name );
+   RibPrintf( "Exterior \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1400,7 +2041,7 @@ RtVoid RiExteriorV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Exterior \"%s\" ", name );
+   RibPrintf( "Exterior \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1412,7 +2053,7 @@ RtVoid RiFormat( RtInt xres, RtInt yres, RtFloat aspect )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Format %d %d %g\n", xres, yres, aspect );
+   RibPrintf( "Format %d %d %g\n", xres, yres, aspect );
 }
 
 
@@ -1423,7 +2064,7 @@ RtVoid RiFrameAspectRatio( RtFloat aspect )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "FrameAspectRatio %g\n", aspect );
+   RibPrintf( "FrameAspectRatio %g\n", aspect );
 }
 
 
@@ -1434,7 +2075,7 @@ RtVoid RiIlluminate( RtLightHandle light, RtBoolean onoff )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Illuminate %u %d\n", 
+   RibPrintf( "Illuminate %u %d\n", 
 	   *light, (onoff ? 1 : 0) );
 }
 
@@ -1449,7 +2090,7 @@ RtVoid RiInterior( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Interior \"%s\" ", name );
+   RibPrintf( "Interior \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1464,7 +2105,7 @@ RtVoid RiInteriorV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Interior \"%s\" ", name );
+   RibPrintf( "Interior \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1477,7 +2118,7 @@ RtVoid RiScreenWindow( RtFloat left, RtFloat right,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ScreenWindow %g %g %g %g\n",
+   RibPrintf( "ScreenWindow %g %g %g %g\n",
 	   left, right, bottom, top );
 }
 
@@ -1489,7 +2130,7 @@ RtVoid RiClipping( RtFloat hither, RtFloat yon )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Clipping %g %g\n", hither, yon );
+   RibPrintf( "Clipping %g %g\n", hither, yon );
 }
 
 
@@ -1500,7 +2141,7 @@ RtVoid RiCropWindow( RtFloat xmin, RtFloat xmax, RtFloat ymin, RtFloat ymax )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "CropWindow %g %g %g %g\n", xmin, xmax, ymin, ymax );
+   RibPrintf( "CropWindow %g %g %g %g\n", xmin, xmax, ymin, ymax );
 }
 
 
@@ -1512,11 +2153,11 @@ RtVoid RiDepthOfField( RtFloat fstop, RtFloat focallength,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "DepthOfField " );
+   RibPrintf( "DepthOfField " );
    if ( fstop == RI_INFINITY ) /* See pin-hole camera p. 26 [PIXA93]. */
-     fputc( '\n', fp );
+     RibPutc( '\n' );
    else
-     fprintf( fp, "%g %g %g\n", fstop, focallength, focaldistance );
+     RibPrintf( "%g %g %g\n", fstop, focallength, focaldistance );
 }
 
 
@@ -1530,7 +2171,7 @@ RtVoid RiProjection( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Projection \"%s\" ", name );
+   RibPrintf( "Projection \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1545,7 +2186,7 @@ RtVoid RiProjectionV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Projection \"%s\" ", name );
+   RibPrintf( "Projection \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1560,7 +2201,7 @@ RtVoid RiShutter( RtFloat min, RtFloat max )
    /* NOTE:  If min==max then no motion blur is done.  See RiShutter()
     *        p. 26 [PIXA93]. 
     */
-   fprintf( fp, "Shutter %g %g\n", min, max );
+   RibPrintf( "Shutter %g %g\n", min, max );
 }
 
 
@@ -1574,7 +2215,7 @@ RtVoid RiDisplay( char *name, RtToken type, RtToken mode, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Display \"%s\" \"%s\" \"%s\" ", name, type, mode );
+   RibPrintf( "Display \"%s\" \"%s\" \"%s\" ", name, type, mode );
    va_start(ap,mode);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1589,7 +2230,7 @@ RtVoid RiDisplayV( char *name, RtToken type, RtToken mode,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Display \"%s\" \"%s\" \"%s\" ", name, type, mode );
+   RibPrintf( "Display \"%s\" \"%s\" \"%s\" ", name, type, mode );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1601,7 +2242,7 @@ RtVoid RiExposure( RtFloat gain, RtFloat gamma )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Exposure %g %g\n", gain, gamma );
+   RibPrintf( "Exposure %g %g\n", gain, gamma );
 }
 
 
@@ -1615,7 +2256,7 @@ RtVoid RiImager( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Imager \"%s\" ", name );
+   RibPrintf( "Imager \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -1630,7 +2271,7 @@ RtVoid RiImagerV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Imager \"%s\" ", name );
+   RibPrintf( "Imager \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -1660,7 +2301,7 @@ RtVoid RiIdentity( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Identity\n" );
+   RibPrintf( "Identity\n" );
 }
 
 
@@ -1671,7 +2312,7 @@ RtVoid RiPerspective( RtFloat fov )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Perspective %g\n", fov );
+   RibPrintf( "Perspective %g\n", fov );
 }
 
 
@@ -1689,7 +2330,7 @@ RtVoid RiPixelFilter( RtFilterFunc filterfunc,
    p = HandleGettingFilterName( filterfunc );
    if (!p)
      return;
-   fprintf( fp, "PixelFilter \"%s\" %g %g\n", p, xwidth, ywidth );
+   RibPrintf( "PixelFilter \"%s\" %g %g\n", p, xwidth, ywidth );
 }
 
 
@@ -1700,7 +2341,7 @@ RtVoid RiPixelSamples( RtFloat xsamples, RtFloat ysamples )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PixelSamples %g %g\n", xsamples, ysamples );
+   RibPrintf( "PixelSamples %g %g\n", xsamples, ysamples );
 }
 
 
@@ -1711,7 +2352,7 @@ RtVoid RiPixelVariance( RtFloat variation )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PixelVariance %g\n", variation );
+   RibPrintf( "PixelVariance %g\n", variation );
 }
 
 
@@ -1724,7 +2365,7 @@ RtVoid RiQuantize( RtToken type, RtInt one,
    CheckIfFirstLine();
 
    /* PRMan default is RiQuantize(RI_RGBA, 255, 0, 255, .5). */
-   fprintf( fp, "Quantize \"%s\" %d %d %d %g\n", 
+   RibPrintf( "Quantize \"%s\" %d %d %d %g\n", 
 	   type, one, min, max, ampl ); 
 }
 
@@ -1736,7 +2377,7 @@ RtVoid RiRotate( RtFloat angle, RtFloat dx, RtFloat dy, RtFloat dz )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Rotate %g %g %g %g\n", angle, dx, dy, dz );
+   RibPrintf( "Rotate %g %g %g %g\n", angle, dx, dy, dz );
 }
 
 
@@ -1747,7 +2388,7 @@ RtVoid RiScale( RtFloat dx, RtFloat dy, RtFloat dz )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Scale %g %g %g\n", dx, dy, dz );
+   RibPrintf( "Scale %g %g %g\n", dx, dy, dz );
 }
 
 
@@ -1759,7 +2400,7 @@ RtVoid RiSkew( RtFloat angle, RtFloat dx1, RtFloat dy1, RtFloat dz1,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Skew %g %g %g %g %g %g %g\n", 
+   RibPrintf( "Skew %g %g %g %g %g %g %g\n", 
 	   angle, dx1, dy1, dz1, dx2, dy2, dz2 );
 }
 
@@ -1774,12 +2415,12 @@ RtVoid RiTransform( RtMatrix transform )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Transform [\n" );
+   RibPrintf( "Transform [\n" );
    
    for ( i=0; i < 4; i++)
-     fprintf( fp, "%g %g %g %g\n", transform[i][0], transform[i][1], 
+     RibPrintf( "%g %g %g %g\n", transform[i][0], transform[i][1], 
 	     transform[i][2], transform[i][3] );
-   fprintf( fp, "]\n" );
+   RibPrintf( "]\n" );
 }
 
 
@@ -1790,7 +2431,7 @@ RtVoid RiTransformBegin( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "TransformBegin\n" );
+   RibPrintf( "TransformBegin\n" );
 }
 
 
@@ -1801,7 +2442,7 @@ RtVoid RiTransformEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "TransformEnd\n" );
+   RibPrintf( "TransformEnd\n" );
 }
 
 
@@ -1821,7 +2462,7 @@ RtVoid RiTranslate( RtFloat dx, RtFloat dy, RtFloat dz )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Translate %g %g %g\n", dx, dy, dz );
+   RibPrintf( "Translate %g %g %g\n", dx, dy, dz );
 }
 
 
@@ -1832,7 +2473,7 @@ RtVoid RiMatte( RtBoolean onoff )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Matte %d\n", (onoff ? 1 : 0) );
+   RibPrintf( "Matte %d\n", (onoff ? 1 : 0) );
 }
 
 
@@ -1843,7 +2484,7 @@ RtVoid RiShadingRate( RtFloat size )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ShadingRate %g\n", size );
+   RibPrintf( "ShadingRate %g\n", size );
 }
 
 
@@ -1860,10 +2501,10 @@ RtVoid RiShadingInterpolation( RtToken type )
 #ifdef CHECKING
    if ( !strcmp( type, "constant" ) || !strcmp( type, "smooth" ) )
    {
-      fprintf( fp, "ShadingInterpolation \"%s\"\n", type );
+      RibPrintf( "ShadingInterpolation \"%s\"\n", type );
    }
 #else
-   fprintf( fp, "ShadingInterpolation \"%s\"\n", type );
+   RibPrintf( "ShadingInterpolation \"%s\"\n", type );
 #endif
 }
 
@@ -1883,44 +2524,44 @@ RtVoid RiSubdivisionMesh( RtToken scheme, RtInt nfaces,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "SubdivisionMesh \"%s\" [", scheme );
+   RibPrintf( "SubdivisionMesh \"%s\" [", scheme );
    v = 0;
    for ( i=0; i<nfaces-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] [", nvertices[i] );
+   RibPrintf( "%d] [", nvertices[i] );
    v += nvertices[i];
 
    l = vertices[0];
    for ( i=0; i<v-1; i++ )
    {
-      fprintf( fp, "%d ", vertices[i] );
+      RibPrintf( "%d ", vertices[i] );
       if ( vertices[i] > l )
 	l = vertices[i];
    }
    if ( vertices[i] > l )
      l = vertices[i];
-   fprintf( fp, "%d]\n", vertices[i] );
+   RibPrintf( "%d]\n", vertices[i] );
 
    if ( ntags )
    {
       /* Print tags[]. */
-      fprintf( fp, "[" );
+      RibPrintf( "[" );
       for ( i=0; i<ntags-1; i++ )
       {
-	 fprintf( fp, "\"%s\" ", tags[i] );
+	 RibPrintf( "\"%s\" ", tags[i] );
       }
-      fprintf( fp, "\"%s\"] [", tags[i] );
+      RibPrintf( "\"%s\"] [", tags[i] );
 
       /* Print nargs[]. */
       a = 2*(ntags-1);
       for ( i=0; i<a; i+=2 )
       {
-	 fprintf( fp, "%d %d", nargs[i], nargs[i+1] );
+	 RibPrintf( "%d %d", nargs[i], nargs[i+1] );
       }
-      fprintf( fp, "%d %d] [", nargs[i], nargs[i+1] );
+      RibPrintf( "%d %d] [", nargs[i], nargs[i+1] );
 
       /* Print intargs[]. */
       ia = 0;
@@ -1932,22 +2573,22 @@ RtVoid RiSubdivisionMesh( RtToken scheme, RtInt nfaces,
       }      
       for ( i=0; i<ia-1; i++ )
       {
-	 fprintf( fp, "%d ", intargs[i] );
+	 RibPrintf( "%d ", intargs[i] );
       }
       if (ia)
-	 fprintf( fp, "%d] [", intargs[i] );
+	 RibPrintf( "%d] [", intargs[i] );
       else
-	 fprintf( fp, "] [" );
+	 RibPrintf( "] [" );
       
       /* Print floatargs[]. */
       for ( i=0; i<fa-1; i++ )
       {
-	 fprintf( fp, "%g ", floatargs[i] );
+	 RibPrintf( "%g ", floatargs[i] );
       }
       if (fa)
-	 fprintf( fp, "%g]\n", floatargs[i] );
+	 RibPrintf( "%g]\n", floatargs[i] );
       else
-	 fprintf( fp, "]\n" );	 
+	 RibPrintf( "]\n" );	 
    }
 
    va_start(ap,floatargs);
@@ -1970,44 +2611,44 @@ RtVoid RiSubdivisionMeshV( RtToken scheme, RtInt nfaces,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "SubdivisionMesh \"%s\" [", scheme );
+   RibPrintf( "SubdivisionMesh \"%s\" [", scheme );
    v = 0;
    for ( i=0; i<nfaces-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] [", nvertices[i] );
+   RibPrintf( "%d] [", nvertices[i] );
    v += nvertices[i];
 
    l = vertices[0];
    for ( i=0; i<v-1; i++ )
    {
-      fprintf( fp, "%d ", vertices[i] );
+      RibPrintf( "%d ", vertices[i] );
       if ( vertices[i] > l )
 	l = vertices[i];
    }
    if ( vertices[i] > l )
      l = vertices[i];
-   fprintf( fp, "%d] ", vertices[i] );
+   RibPrintf( "%d] ", vertices[i] );
 
    if ( ntags )
    {
       /* Print tags[]. */
-      fprintf( fp, "[" );
+      RibPrintf( "[" );
       for ( i=0; i<ntags-1; i++ )
       {
-	 fprintf( fp, "\"%s\" ", tags[i] );
+	 RibPrintf( "\"%s\" ", tags[i] );
       }
-      fprintf( fp, "\"%s\"] [", tags[i] );
+      RibPrintf( "\"%s\"] [", tags[i] );
 
       /* Print nargs[]. */
       a = 2*(ntags-1);
       for ( i=0; i<a; i+=2 )
       {
-	 fprintf( fp, "%d %d ", nargs[i], nargs[i+1] );
+	 RibPrintf( "%d %d ", nargs[i], nargs[i+1] );
       }
-      fprintf( fp, "%d %d] [", nargs[i], nargs[i+1] );
+      RibPrintf( "%d %d] [", nargs[i], nargs[i+1] );
 
       /* Print intargs[]. */
       ia = 0;
@@ -2019,22 +2660,22 @@ RtVoid RiSubdivisionMeshV( RtToken scheme, RtInt nfaces,
       }      
       for ( i=0; i<ia-1; i++ )
       {
-	 fprintf( fp, "%d ", intargs[i] );
+	 RibPrintf( "%d ", intargs[i] );
       }
       if (ia)
-	 fprintf( fp, "%d]\n[", intargs[i] );
+	 RibPrintf( "%d]\n[", intargs[i] );
       else
-	 fprintf( fp, "] [" );
+	 RibPrintf( "] [" );
       
       /* Print floatargs[]. */
       for ( i=0; i<fa-1; i++ )
       {
-	 fprintf( fp, "%g ", floatargs[i] );
+	 RibPrintf( "%g ", floatargs[i] );
       }
       if (fa)
-	 fprintf( fp, "%g]\n", floatargs[i] );
+	 RibPrintf( "%g]\n", floatargs[i] );
       else
-	 fprintf( fp, "]\n" );	 
+	 RibPrintf( "]\n" );	 
    }
 
    HandleParamList( noap, n, tokens, parms, l+1, nfaces, l+1 );
@@ -2051,7 +2692,7 @@ RtVoid RiSurface( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Surface \"%s\" ", name );
+   RibPrintf( "Surface \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -2066,7 +2707,7 @@ RtVoid RiSurfaceV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Surface \"%s\" ", name );
+   RibPrintf( "Surface \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -2076,6 +2717,7 @@ RtVoid RiArchiveRecord( RtToken type, char *format, ... )
    char     *p;
    va_list  ap;
    int      hint = 0;
+   int      i;
 
 
    if (!fp)
@@ -2194,11 +2836,17 @@ RtVoid RiArchiveRecord( RtToken type, char *format, ... )
       gSRIBW.firstline=1;
    }
 
-   fprintf( fp, "%s", p );
+   RibPrintf( "%s", p );
+   /* The format is given by the caller, so use the C library; the text
+    *    of one record is limited to the size of the output buffer.
+    */
+   RibFlush();
    va_start(ap,format);
-   vfprintf( fp, format, ap );
+   i = vsnprintf( (char*)ribbuf, RIBBUFSIZE, format, ap );
    va_end(ap);
-   fprintf( fp, "\n" );
+   if (i > 0)
+     ribbuflen = (i < RIBBUFSIZE ? i : RIBBUFSIZE-1);
+   RibPrintf( "\n" );
 }
 
 
@@ -2215,7 +2863,7 @@ RtVoid RiReadArchive( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ReadArchive \"%s\" ", name );
+   RibPrintf( "ReadArchive \"%s\" ", name );
    va_start(ap,callback);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -2233,7 +2881,7 @@ RtVoid RiReadArchiveV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ReadArchive \"%s\" ", name );
+   RibPrintf( "ReadArchive \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -2247,7 +2895,7 @@ RtVoid RiAttribute( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Attribute \"%s\" ", name );
+   RibPrintf( "Attribute \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -2262,7 +2910,7 @@ RtVoid RiAttributeV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Attribute \"%s\" ", name );
+   RibPrintf( "Attribute \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -2274,7 +2922,7 @@ RtVoid RiAttributeBegin( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "AttributeBegin\n" );
+   RibPrintf( "AttributeBegin\n" );
 
    gSRIBW.blocklevel++;
 }
@@ -2311,7 +2959,7 @@ RtVoid RiAttributeEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "AttributeEnd\n" );
+   RibPrintf( "AttributeEnd\n" );
 }
 
 
@@ -2322,7 +2970,7 @@ RtVoid RiBound( RtBound bound )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Bound %g %g %g %g %g %g\n",
+   RibPrintf( "Bound %g %g %g %g %g %g\n",
 	   bound[0], bound[1], bound[2], bound[3], bound[4], bound[5] );
 }
 
@@ -2339,14 +2987,14 @@ RtVoid RiColor( RtColor color )
 
    if (gSRIBW.ncolor==3)
    {
-      fprintf( fp, "Color %g %g %g\n", color[0], color[1], color[2] );
+      RibPrintf( "Color %g %g %g\n", color[0], color[1], color[2] );
    }
    else
    {
-      fprintf( fp, "Color " );
+      RibPrintf( "Color " );
       for ( i=0; i<(gSRIBW.ncolor-1); i++ )
-	fprintf( fp, "%g ", color[i] );
-      fprintf( fp, "%g\n", color[i] );
+	RibPrintf( "%g ", color[i] );
+      RibPrintf( "%g\n", color[i] );
    }
 }
 
@@ -2363,14 +3011,52 @@ RtVoid RiOpacity( RtColor color)
 
    if (gSRIBW.ncolor==3)
    {
-      fprintf( fp, "Opacity %g %g %g\n", color[0], color[1], color[2] );
+      RibPrintf( "Opacity %g %g %g\n", color[0], color[1], color[2] );
    }
    else
    {
-      fprintf( fp, "Opacity " );
+      RibPrintf( "Opacity " );
       for ( i=0; i<(gSRIBW.ncolor-1); i++ )
-	fprintf( fp, "%g ", color[i] );
-      fprintf( fp, "%g\n", color[i] );
+	RibPrintf( "%g ", color[i] );
+      RibPrintf( "%g\n", color[i] );
+   }
+}
+
+
+/* Handle the writer options 'Option "rib" "format"' ("ascii", "binary",
+ *    "RISpec3.1" or "NuPatch3.6") and 'Option "rib" "compression"'
+ *    ("none" or "gzip").  Also see RiOption() below.
+ */
+static void HandleRibOption( char *option, char *setting )
+{
+   if ( !strcmp( option, "format" ) )
+   {
+      if ( !strcmp(setting,"RISpec3.1") )
+      {
+	 gSRIBW.prman36changes = RI_FALSE;
+      }
+      else if ( !strcmp( setting,"NuPatch3.6") )
+      {
+	 gSRIBW.prman36changes = RI_TRUE;
+      }
+      else if ( !strcmp( setting,"binary") )
+      {
+	 gSRIBW.format = RIBFORMAT_BINARY;
+      }
+      else if ( !strcmp( setting,"ascii") )
+      {
+	 gSRIBW.format = RIBFORMAT_ASCII;
+      }
+   }
+   else if ( !strcmp( option, "compression" ) )
+   {
+#ifdef AYUSEZLIB
+      gSRIBW.gzip = ( !strcmp( setting, "gzip" ) ? RI_TRUE : RI_FALSE );
+#else
+      if ( !strcmp( setting, "gzip" ) )
+	fprintf( stderr, "WARNING: Compressed RIB output not supported.\n" );
+      gSRIBW.gzip = RI_FALSE;
+#endif
    }
 }
 
@@ -2413,20 +3099,14 @@ RtVoid RiOption( RtToken name, ... )
 	 do 
 	 {
 	    option  = (char*)va_arg(ap,RtToken);
-	    if ( option )
+	    if ( option && !strcmp( option, "precision" ) )
+	    {
+	       gSRIBW.precision = *(RtInt*)va_arg(ap,RtPointer);
+	    }
+	    else if ( option )
 	    {
 	       setting = (char*)*(void**)va_arg(ap,RtToken);
-	       if ( !strcmp( option, "format" ) )
-	       {
-		  if ( !strcmp(setting,"RISpec3.1") )
-		  {
-		     gSRIBW.prman36changes = RI_FALSE;
-		  }
-		  else if ( !strcmp( setting,"NuPatch3.6") )
-		  {
-		     gSRIBW.prman36changes = RI_TRUE;
-		  }
-	       }
+	       HandleRibOption( option, setting );
 	    }
 	 } while (option);
 	 va_end(ap);
@@ -2449,7 +3129,7 @@ RtVoid RiOption( RtToken name, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Option \"%s\" ", name );
+   RibPrintf( "Option \"%s\" ", name );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -2468,16 +3148,13 @@ RtVoid RiOptionV( RtToken name,
       {
 	 for ( i=0; i<n; i++ )
 	 {
-	    if ( tokens[i] && !strcmp( tokens[i], "format" ) )
+	    if ( tokens[i] && !strcmp( tokens[i], "precision" ) )
 	    {
-	       if ( !strcmp( (char*)*(void**)parms[i],"RISpec3.1") )
-	       {
-		  gSRIBW.prman36changes = RI_FALSE;
-	       }
-	       else if ( !strcmp( (char*)*(void**)parms[i],"NuPatch3.6") )
-	       {
-		  gSRIBW.prman36changes = RI_TRUE;
-	       }
+	       gSRIBW.precision = *(RtInt*)parms[i];
+	    }
+	    else if ( tokens[i] )
+	    {
+	       HandleRibOption( tokens[i], (char*)*(void**)parms[i] );
 	    }
 	 }
       }
@@ -2493,7 +3170,7 @@ RtVoid RiOptionV( RtToken name,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Option \"%s\" ", name );
+   RibPrintf( "Option \"%s\" ", name );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -2508,7 +3185,7 @@ RtVoid RiResource( RtToken handle, RtToken type, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Resource \"%s\" \"%s\" ", handle, type );
+   RibPrintf( "Resource \"%s\" \"%s\" ", handle, type );
    va_start(ap,type);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -2523,7 +3200,7 @@ RtVoid RiResourceV( RtToken handle, RtToken type,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Resource \"%s\" \"%s\" ", handle, type );
+   RibPrintf( "Resource \"%s\" \"%s\" ", handle, type );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -2535,7 +3212,7 @@ RtVoid RiReverseOrientation( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ReverseOrientation\n" );
+   RibPrintf( "ReverseOrientation\n" );
 }
 
 
@@ -2549,7 +3226,7 @@ RtVoid RiTextureCoordinates( RtFloat s1, RtFloat t1,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "TextureCoordinates %g %g %g %g %g %g %g %g\n",
+   RibPrintf( "TextureCoordinates %g %g %g %g %g %g %g %g\n",
 	   s1, t1, s2, t2, s3, t3, s4, t4 );
 }
 
@@ -2561,7 +3238,7 @@ RtVoid RiSides( RtInt sides )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Sides %d\n", sides );
+   RibPrintf( "Sides %d\n", sides );
 }
 
 
@@ -2577,7 +3254,7 @@ RtLightHandle RiLightSource( RtToken name, ... )
    CheckIfFirstLine();
 
    light = (RtLightHandle)ay_otype_getpointer(gSRIBW.LastLightHandle);
-   fprintf( fp, "LightSource \"%s\" %u ", name, gSRIBW.LastLightHandle );
+   RibPrintf( "LightSource \"%s\" %u ", name, gSRIBW.LastLightHandle );
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);
@@ -2597,7 +3274,7 @@ RtLightHandle RiLightSourceV( RtToken name,
    CheckIfFirstLine();
 
    light = (RtLightHandle)ay_otype_getpointer(gSRIBW.LastLightHandle);
-   fprintf( fp, "LightSource \"%s\" %u ", name, gSRIBW.LastLightHandle );
+   RibPrintf( "LightSource \"%s\" %u ", name, gSRIBW.LastLightHandle );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
    gSRIBW.LastLightHandle++;
    return light;
@@ -2615,7 +3292,7 @@ RtLightHandle RiAreaLightSource( RtToken name, ... )
    CheckIfFirstLine();
 
    light = (RtLightHandle)ay_otype_getpointer(gSRIBW.LastLightHandle);
-   fprintf( fp, "AreaLightSource \"%s\" %u ", name, gSRIBW.LastLightHandle);
+   RibPrintf( "AreaLightSource \"%s\" %u ", name, gSRIBW.LastLightHandle);
 
    va_start(ap,name);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
@@ -2636,7 +3313,7 @@ RtLightHandle RiAreaLightSourceV( RtToken name,
    CheckIfFirstLine();
 
    light = (RtLightHandle)ay_otype_getpointer(gSRIBW.LastLightHandle);
-   fprintf( fp, "AreaLightSource \"%s\" %u ", name, gSRIBW.LastLightHandle);
+   RibPrintf( "AreaLightSource \"%s\" %u ", name, gSRIBW.LastLightHandle);
 
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
    gSRIBW.LastLightHandle++;
@@ -2681,7 +3358,7 @@ RtVoid RiBasis( RtBasis ubasis, RtInt ustep, RtBasis vbasis, RtInt vstep )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Basis " );
+   RibPrintf( "Basis " );
    uv = 1;
    do
    {
@@ -2689,35 +3366,35 @@ RtVoid RiBasis( RtBasis ubasis, RtInt ustep, RtBasis vbasis, RtInt vstep )
       step = ( uv ? ustep : vstep );
       if (basis == &RiBezierBasis[0][0] )
       {
-	 fprintf( fp, "\"bezier\" %d ", step );
+	 RibPrintf( "\"bezier\" %d ", step );
       }
       else if (basis == &RiBSplineBasis[0][0] )
       {
-	 fprintf( fp, "\"b-spline\" %d ", step );
+	 RibPrintf( "\"b-spline\" %d ", step );
       }
       else if (basis == &RiCatmullRomBasis[0][0] )
       {
-	 fprintf( fp, "\"catmull-rom\" %d ", step );
+	 RibPrintf( "\"catmull-rom\" %d ", step );
       }
       else if (basis == &RiHermiteBasis[0][0] )
       {
-	 fprintf( fp, "\"hermite\" %d ", step );
+	 RibPrintf( "\"hermite\" %d ", step );
       }
       else if (basis == &RiPowerBasis[0][0] )
       {
-	 fprintf( fp, "\"power\" %d ", step );
+	 RibPrintf( "\"power\" %d ", step );
       }
       else 
       {
-	 fputc( '[', fp );
+	 RibPutc( '[' );
 	 for ( i=0; i < 3; i++)
-	   fprintf( fp, "%g %g %g %g ", basis[i*4], basis[i*4+1], 
+	   RibPrintf( "%g %g %g %g ", basis[i*4], basis[i*4+1], 
 		   basis[i*4+2], basis[i*4+3] );
-	 fprintf( fp, "%g %g %g %g] %d ", basis[i*4], basis[i*4+1], 
+	 RibPrintf( "%g %g %g %g] %d ", basis[i*4], basis[i*4+1], 
 	         basis[i*4+2], basis[i*4+3], step );
       }
       if (!uv)
-	fputc( '\n', fp );
+	RibPutc( '\n' );
    } 
    while (uv--);
 
@@ -2744,7 +3421,7 @@ RtVoid RiPatch( RtToken type, ... )
       
    CheckIfFirstLine();
 
-   fprintf( fp, "Patch \"%s\" \n", type );
+   RibPrintf( "Patch \"%s\" \n", type );
    va_start(ap,type);
    HandleParamList( ap, -1, NULL, NULL, nvertex, 1, 4 );
    va_end(ap);
@@ -2769,7 +3446,7 @@ RtVoid RiPatchV( RtToken type,
       
    CheckIfFirstLine();
 
-   fprintf( fp, "Patch \"%s\" \n", type );
+   RibPrintf( "Patch \"%s\" \n", type );
    HandleParamList( noap, n, tokens, parms, nvertex, 1, 4 ); 
 }
 
@@ -2833,7 +3510,7 @@ RtVoid RiPatchMesh( RtToken type, RtInt nu, RtToken uwrap,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PatchMesh \"%s\" %d \"%s\" %d \"%s\" \n",
+   RibPrintf( "PatchMesh \"%s\" %d \"%s\" %d \"%s\" \n",
 	   type, nu, uwrap, nv, vwrap );
    va_start(ap,vwrap);
    HandleParamList( ap, -1, NULL, NULL, nu*nv, nupatches*nvpatches, nvarying );
@@ -2900,7 +3577,7 @@ RtVoid RiPatchMeshV( RtToken type, RtInt nu, RtToken uwrap,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PatchMesh \"%s\" %d \"%s\" %d \"%s\" \n",
+   RibPrintf( "PatchMesh \"%s\" %d \"%s\" %d \"%s\" \n",
 	   type, nu, uwrap, nv, vwrap );
    HandleParamList( noap, n,tokens,parms, nu*nv,nupatches*nvpatches,nvarying );
 }
@@ -2924,35 +3601,35 @@ RtVoid RiNuCurves( RtInt ncurves, RtInt nvertices[], RtInt order[],
     * Instead the length of nvertices is used to set the ncurves value
     * when reading a NuCurves statement.
     */
-   fprintf( fp, "NuCurves [");
+   RibPrintf( "NuCurves [");
    N = 0;
    O = 0;
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%d ", nvertices[i] );
+     RibPrintf( "%d ", nvertices[i] );
       N += nvertices[i];
       O += order[i];
    }
-   fprintf( fp, "] [" );
+   RibPrintf( "] [" );
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%d ", order[i] );
+     RibPrintf( "%d ", order[i] );
    }
    /* The number of knots is the number of control vertices plus the order. */
-   fprintf( fp, "]\n[" );
+   RibPrintf( "]\n[" );
    for ( i=0; i<N+O; i++ )
    {
-     fprintf( fp, "%g ", knot[i] );
+     RibPrintf( "%g ", knot[i] );
    }
-   fprintf( fp, "]\n[" );
+   RibPrintf( "]\n[" );
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%g ", min[i] );
+     RibPrintf( "%g ", min[i] );
    }
-   fprintf( fp, "]\n" );
+   RibPrintf( "]\n" );
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%g ", max[i] );
+     RibPrintf( "%g ", max[i] );
    }
 
    /* Calculate the number of uniform values. */
@@ -2985,35 +3662,35 @@ RtVoid RiNuCurvesV( RtInt ncurves, RtInt nvertices[], RtInt order[],
     * Instead the length of nvertices is used to set the ncurves value
     * when reading a NuCurves statement.
     */
-   fprintf( fp, "NuCurves [");
+   RibPrintf( "NuCurves [");
    N = 0;
    O = 0;
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%d ", nvertices[i] );
+     RibPrintf( "%d ", nvertices[i] );
       N += nvertices[i];
       O += order[i];
    }
-   fprintf( fp, "] [" );
+   RibPrintf( "] [" );
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%d ", order[i] );
+     RibPrintf( "%d ", order[i] );
    }
    /* The number of knots is the number of control vertices plus the order. */
-   fprintf( fp, "]\n[" );
+   RibPrintf( "]\n[" );
    for ( i=0; i<N+O; i++ )
    {
-     fprintf( fp, "%g ", knot[i] );
+     RibPrintf( "%g ", knot[i] );
    }
-   fprintf( fp, "]\n[" );
+   RibPrintf( "]\n[" );
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%g ", min[i] );
+     RibPrintf( "%g ", min[i] );
    }
-   fprintf( fp, "]\n" );
+   RibPrintf( "]\n" );
    for ( i=0; i<ncurves; i++ )
    {
-     fprintf( fp, "%g ", max[i] );
+     RibPrintf( "%g ", max[i] );
    }
 
    /* Calculate the number of uniform values. */
@@ -3031,7 +3708,6 @@ RtVoid RiNuPatch( RtInt nu, RtInt uorder, RtFloat uknot[],
 		 RtInt nv, RtInt vorder, RtFloat vknot[], 
 		 RtFloat vmin, RtFloat vmax, ... )
 {
-   register int  i;
    int           nvertex, nvarying, nuniform;
    va_list       ap;
 
@@ -3053,15 +3729,13 @@ RtVoid RiNuPatch( RtInt nu, RtInt uorder, RtFloat uknot[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "NuPatch %d %d [", nu, uorder );
-   for ( i=0; i<(uorder+nu); i++ )
-     fprintf( fp, "%g ", uknot[i] );
-   fprintf( fp, "] %g %g ", umin, umax );
+   RibPrintf( "NuPatch %d %d ", nu, uorder );
+   RibPutFloatArray( uknot, uorder+nu );
+   RibPrintf( " %g %g ", umin, umax );
 
-   fprintf( fp, "%d %d [", nv, vorder );
-   for ( i=0; i<(vorder+nv); i++ )
-     fprintf( fp, "%g ", vknot[i] );
-   fprintf( fp, "] %g %g ", vmin, vmax );
+   RibPrintf( "%d %d ", nv, vorder );
+   RibPutFloatArray( vknot, vorder+nv );
+   RibPrintf( " %g %g ", vmin, vmax );
 
    va_start(ap,vmax);
    HandleParamList( ap, -1, NULL, NULL, nvertex, nuniform, nvarying );
@@ -3075,7 +3749,6 @@ RtVoid RiNuPatchV( RtInt nu, RtInt uorder, RtFloat uknot[],
 		  RtFloat vmin, RtFloat vmax,
 		  RtInt n, RtToken tokens[], RtPointer parms[] )
 {
-   register int  i;
    int           nvertex, nvarying, nuniform;
 		
 
@@ -3096,15 +3769,13 @@ RtVoid RiNuPatchV( RtInt nu, RtInt uorder, RtFloat uknot[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "NuPatch %d %d [", nu, uorder );
-   for ( i=0; i<(uorder+nu); i++ )
-     fprintf( fp, "%g ", uknot[i] );
-   fprintf( fp, "] %g %g ", umin, umax );
+   RibPrintf( "NuPatch %d %d ", nu, uorder );
+   RibPutFloatArray( uknot, uorder+nu );
+   RibPrintf( " %g %g ", umin, umax );
 
-   fprintf( fp, "%d %d [", nv, vorder );
-   for ( i=0; i<(vorder+nv); i++ )
-     fprintf( fp, "%g ", vknot[i] );
-   fprintf( fp, "] %g %g ", vmin, vmax );
+   RibPrintf( "%d %d ", nv, vorder );
+   RibPutFloatArray( vknot, vorder+nv );
+   RibPrintf( " %g %g ", vmin, vmax );
 
    HandleParamList( noap, n, tokens, parms, nvertex, nuniform, nvarying );
 }
@@ -3129,54 +3800,54 @@ RtVoid RiTrimCurve( RtInt nloops, RtInt ncurves[], RtInt order[],
    CheckIfFirstLine();
 
    C = 0;
-   fprintf( fp, "TrimCurve [" );
+   RibPrintf( "TrimCurve [" );
    for ( i=0; i<nloops-1; i++ )
    {
-      fprintf( fp, "%d ", ncurves[i] );
+      RibPrintf( "%d ", ncurves[i] );
       C += ncurves[i];
    }
-   fprintf( fp, "%d] [", ncurves[i] );
+   RibPrintf( "%d] [", ncurves[i] );
    C += ncurves[i];
 
    nknots = 0;
    ncvs = 0;
    for ( i=0; i<C-1; i++ )
    {
-      fprintf( fp, "%d ", order[i] );
+      RibPrintf( "%d ", order[i] );
       nknots += order[i] + n[i];
       ncvs += n[i];
    }
-   fprintf( fp, "%d] [", order[i] );
+   RibPrintf( "%d] [", order[i] );
    nknots += order[i] + n[i];
    ncvs += n[i];
 
    for ( i=0; i<nknots-1; i++ )
-     fprintf( fp, "%g ", knot[i] );
-   fprintf( fp, "%g] [", knot[i] );
+     RibPrintf( "%g ", knot[i] );
+   RibPrintf( "%g] [", knot[i] );
 
    for ( i=0; i<C-1; i++ )
-     fprintf( fp, "%g ", min[i] );
-   fprintf( fp, "%g] [", min[i] );
+     RibPrintf( "%g ", min[i] );
+   RibPrintf( "%g] [", min[i] );
 
    for ( i=0; i<C-1; i++ )
-     fprintf( fp, "%g ", max[i] );
-   fprintf( fp, "%g] [", max[i] );
+     RibPrintf( "%g ", max[i] );
+   RibPrintf( "%g] [", max[i] );
 
    for ( i=0; i<C-1; i++ )
-     fprintf( fp, "%d ", n[i] );
-   fprintf( fp, "%d]\n[", n[i] );
+     RibPrintf( "%d ", n[i] );
+   RibPrintf( "%d]\n[", n[i] );
 
    for ( i=0; i<ncvs-1; i++ )
-     fprintf( fp, "%g ", u[i] );
-   fprintf( fp, "%g]\n[", u[i] );
+     RibPrintf( "%g ", u[i] );
+   RibPrintf( "%g]\n[", u[i] );
 
    for ( i=0; i<ncvs-1; i++ )
-     fprintf( fp, "%g ", v[i] );
-   fprintf( fp, "%g]\n[", v[i] );
+     RibPrintf( "%g ", v[i] );
+   RibPrintf( "%g]\n[", v[i] );
 
    for ( i=0; i<ncvs-1; i++ )
-     fprintf( fp, "%g ", w[i] );
-   fprintf( fp, "%g]\n", w[i] );
+     RibPrintf( "%g ", w[i] );
+   RibPrintf( "%g]\n", w[i] );
 }
 
 
@@ -3190,7 +3861,7 @@ RtVoid RiCone( RtFloat height, RtFloat radius, RtFloat thetamax, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Cone %g %g %g ", height, radius, thetamax );
+   RibPrintf( "Cone %g %g %g ", height, radius, thetamax );
    va_start(ap,thetamax);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
    va_end(ap);  
@@ -3205,7 +3876,7 @@ RtVoid RiConeV( RtFloat height, RtFloat radius, RtFloat thetamax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Cone %g %g %g ", height, radius, thetamax );
+   RibPrintf( "Cone %g %g %g ", height, radius, thetamax );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
 
@@ -3265,12 +3936,12 @@ RtVoid RiCurves( RtToken type, RtInt ncurves, RtInt nvertices[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Curves \"%s\" [", type );
+   RibPrintf( "Curves \"%s\" [", type );
    for ( i=0; i<(ncurves-1); i++)
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
    }
-   fprintf( fp, "%d] \"%s\" ", nvertices[i], wrap );
+   RibPrintf( "%d] \"%s\" ", nvertices[i], wrap );
 
    va_start(ap,wrap);
    HandleParamList( ap, -1, NULL, NULL, 
@@ -3336,12 +4007,12 @@ RtVoid RiCurvesV( RtToken type, RtInt ncurves, RtInt nvertices[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Curves \"%s\" [", type );
+   RibPrintf( "Curves \"%s\" [", type );
    for ( i=0; i<(ncurves-1); i++)
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
    }
-   fprintf( fp, "%d] \"%s\" ", nvertices[i], wrap );
+   RibPrintf( "%d] \"%s\" ", nvertices[i], wrap );
 
    HandleParamList( noap, 
 		   n, tokens, parms, 
@@ -3362,7 +4033,7 @@ RtVoid RiCylinder( RtFloat radius,RtFloat zmin,RtFloat zmax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Cylinder %g %g %g %g ", radius, zmin, zmax, thetamax );
+   RibPrintf( "Cylinder %g %g %g %g ", radius, zmin, zmax, thetamax );
    va_start(ap,thetamax);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
    va_end(ap);  
@@ -3377,7 +4048,7 @@ RtVoid RiCylinderV( RtFloat radius,RtFloat zmin,RtFloat zmax,RtFloat thetamax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Cylinder %g %g %g %g ", radius, zmin, zmax, thetamax );
+   RibPrintf( "Cylinder %g %g %g %g ", radius, zmin, zmax, thetamax );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
 
@@ -3392,7 +4063,7 @@ RtVoid RiDisk( RtFloat height, RtFloat radius, RtFloat thetamax, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Disk %g %g %g ", height, radius, thetamax );
+   RibPrintf( "Disk %g %g %g ", height, radius, thetamax );
    va_start(ap,thetamax);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
    va_end(ap);  
@@ -3407,7 +4078,7 @@ RtVoid RiDiskV( RtFloat height, RtFloat radius, RtFloat thetamax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Disk %g %g %g ", height, radius, thetamax );
+   RibPrintf( "Disk %g %g %g ", height, radius, thetamax );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
 
@@ -3422,7 +4093,7 @@ RtVoid RiHyperboloid( RtPoint point1, RtPoint point2, RtFloat thetamax, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Hyperboloid %g %g %g %g %g %g %g ", 
+   RibPrintf( "Hyperboloid %g %g %g %g %g %g %g ", 
 	   point1[0], point1[1], point1[2], 
 	   point2[0], point2[1], point2[2], 
 	   thetamax );
@@ -3440,7 +4111,7 @@ RtVoid RiHyperboloidV( RtPoint point1, RtPoint point2, RtFloat thetamax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Hyperboloid %g %g %g %g %g %g %g ", 
+   RibPrintf( "Hyperboloid %g %g %g %g %g %g %g ", 
 	   point1[0], point1[1], point1[2], 
 	   point2[0], point2[1], point2[2], 
 	   thetamax );
@@ -3459,7 +4130,7 @@ RtVoid RiParaboloid( RtFloat rmax,RtFloat zmin,RtFloat zmax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Paraboloid %g %g %g %g ", rmax, zmin, zmax, thetamax );
+   RibPrintf( "Paraboloid %g %g %g %g ", rmax, zmin, zmax, thetamax );
    va_start(ap,thetamax);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
    va_end(ap);  
@@ -3474,7 +4145,7 @@ RtVoid RiParaboloidV( RtFloat rmax,RtFloat zmin,RtFloat zmax,RtFloat thetamax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Paraboloid %g %g %g %g ", rmax, zmin, zmax, thetamax );
+   RibPrintf( "Paraboloid %g %g %g %g ", rmax, zmin, zmax, thetamax );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
 
@@ -3490,7 +4161,7 @@ RtVoid RiSphere( RtFloat radius,RtFloat zmin,RtFloat zmax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Sphere %g %g %g %g ", radius, zmin, zmax, thetamax );
+   RibPrintf( "Sphere %g %g %g %g ", radius, zmin, zmax, thetamax );
    va_start(ap,thetamax);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
    va_end(ap);  
@@ -3505,7 +4176,7 @@ RtVoid RiSphereV( RtFloat radius,RtFloat zmin,RtFloat zmax, RtFloat thetamax,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Sphere %g %g %g %g ", radius, zmin, zmax, thetamax );
+   RibPrintf( "Sphere %g %g %g %g ", radius, zmin, zmax, thetamax );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
 
@@ -3521,7 +4192,7 @@ RtVoid RiTorus( RtFloat majorradius, RtFloat minorradius,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Torus %g %g %g %g %g ", majorradius, minorradius,
+   RibPrintf( "Torus %g %g %g %g %g ", majorradius, minorradius,
 	   phimin, phimax, thetamax );
    va_start(ap,thetamax);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
@@ -3538,7 +4209,7 @@ RtVoid RiTorusV( RtFloat majorradius, RtFloat minorradius,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Torus %g %g %g %g %g ", majorradius, minorradius,
+   RibPrintf( "Torus %g %g %g %g %g ", majorradius, minorradius,
 	   phimin, phimax, thetamax );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
@@ -3556,13 +4227,13 @@ RtVoid RiGeneralPolygon( RtInt nloops, RtInt nvertices[], ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "GeneralPolygon [" );
+   RibPrintf( "GeneralPolygon [" );
    for ( i=0; i< nloops-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] ", nvertices[i] );
+   RibPrintf( "%d] ", nvertices[i] );
    v += nvertices[i];
 
    va_start(ap,nvertices);
@@ -3583,13 +4254,13 @@ RtVoid RiGeneralPolygonV( RtInt nloops, RtInt nvertices[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "GeneralPolygon [" );
+   RibPrintf( "GeneralPolygon [" );
    for ( i=0; i< nloops-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d]\n ", nvertices[i] );
+   RibPrintf( "%d]\n ", nvertices[i] );
    v += nvertices[i];
 
    HandleParamList( noap, n, tokens, parms, v, 1, v );
@@ -3606,7 +4277,7 @@ RtVoid RiPoints( RtInt npoints, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Points " );
+   RibPrintf( "Points " );
 
    va_start(ap,npoints);
    HandleParamList( ap, -1, NULL, NULL, npoints, 1, npoints );
@@ -3621,7 +4292,7 @@ RtVoid RiPointsV( RtInt npoints, RtInt n, RtToken tokens[], RtPointer parms[] )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Points " );
+   RibPrintf( "Points " );
 
    HandleParamList( noap, n, tokens, parms, npoints, 1, npoints );
 }
@@ -3639,35 +4310,35 @@ RtVoid RiPointsGeneralPolygons( RtInt npolys, RtInt nloops[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PointsGeneralPolygons [" );
+   RibPrintf( "PointsGeneralPolygons [" );
    l = 0;
    for ( i=0; i< npolys-1; i++ )
    {
-      fprintf( fp, "%d ", nloops[i] );
+      RibPrintf( "%d ", nloops[i] );
       l += nloops[i];
    }
-   fprintf( fp, "%d] [", nloops[i] );
+   RibPrintf( "%d] [", nloops[i] );
    l += nloops[i];
 
    v = 0;
    for ( i=0; i< l-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] [", nvertices[i] );
+   RibPrintf( "%d] [", nvertices[i] );
    v += nvertices[i];
 
    l = vertices[0];
    for ( i=0; i< v-1; i++ )
    {
-      fprintf( fp, "%d ", vertices[i] );
+      RibPrintf( "%d ", vertices[i] );
       if ( vertices[i] > l )
 	l = vertices[i];
    }
    if ( vertices[i] > l )
      l = vertices[i];
-   fprintf( fp, "%d] ", vertices[i] );
+   RibPrintf( "%d] ", vertices[i] );
 
    va_start(ap,vertices);
    HandleParamList( ap, -1, NULL, NULL, l+1, npolys, l+1 );
@@ -3687,35 +4358,35 @@ RtVoid RiPointsGeneralPolygonsV( RtInt npolys, RtInt nloops[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PointsGeneralPolygons [" );
+   RibPrintf( "PointsGeneralPolygons [" );
    l = 0;
    for ( i=0; i< npolys-1; i++ )
    {
-      fprintf( fp, "%d ", nloops[i] );
+      RibPrintf( "%d ", nloops[i] );
       l += nloops[i];
    }
-   fprintf( fp, "%d] [", nloops[i] );
+   RibPrintf( "%d] [", nloops[i] );
    l += nloops[i];
 
    v = 0;
    for ( i=0; i< l-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] [", nvertices[i] );
+   RibPrintf( "%d] [", nvertices[i] );
    v += nvertices[i];
 
    l = vertices[0];
    for ( i=0; i< v-1; i++ )
    {
-      fprintf( fp, "%d ", vertices[i] );
+      RibPrintf( "%d ", vertices[i] );
       if ( vertices[i] > l )
 	l = vertices[i];
    }
    if ( vertices[i] > l )
      l = vertices[i];
-   fprintf( fp, "%d] ", vertices[i] );
+   RibPrintf( "%d] ", vertices[i] );
 
    HandleParamList( noap, n, tokens, parms, l+1, npolys, l+1 );
 }
@@ -3733,27 +4404,27 @@ RtVoid RiPointsPolygons( RtInt npolys,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PointsPolygons [" );
+   RibPrintf( "PointsPolygons [" );
 
    v = 0;
    for ( i=0; i < npolys-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] [", nvertices[i] );
+   RibPrintf( "%d] [", nvertices[i] );
    v += nvertices[i];
 
    l = vertices[0];
    for ( i=0; i< v-1; i++ )
    {
-      fprintf( fp, "%d ", vertices[i] );
+      RibPrintf( "%d ", vertices[i] );
       if ( vertices[i] > l )
 	l = vertices[i];
    }
    if ( vertices[i] > l )
      l = vertices[i];
-   fprintf( fp, "%d] ", vertices[i] );
+   RibPrintf( "%d] ", vertices[i] );
 
    va_start(ap,vertices);
    HandleParamList( ap, -1, NULL, NULL, l+1, npolys, l+1 );
@@ -3772,27 +4443,27 @@ RtVoid RiPointsPolygonsV( RtInt npolys, RtInt nvertices[], RtInt vertices[],
 
    CheckIfFirstLine();
 
-   fprintf( fp, "PointsPolygons [" );
+   RibPrintf( "PointsPolygons [" );
 
    v = 0;
    for ( i=0; i < npolys-1; i++ )
    {
-      fprintf( fp, "%d ", nvertices[i] );
+      RibPrintf( "%d ", nvertices[i] );
       v += nvertices[i];
    }
-   fprintf( fp, "%d] [", nvertices[i] );
+   RibPrintf( "%d] [", nvertices[i] );
    v += nvertices[i];
 
    l = vertices[0];
    for ( i=0; i< v-1; i++ )
    {
-      fprintf( fp, "%d ", vertices[i] );
+      RibPrintf( "%d ", vertices[i] );
       if ( vertices[i] > l )
 	l = vertices[i];
    }
    if ( vertices[i] > l )
      l = vertices[i];
-   fprintf( fp, "%d] ", vertices[i] );
+   RibPrintf( "%d] ", vertices[i] );
 
    HandleParamList( noap, n, tokens, parms, l+1, npolys, l+1 );
 }
@@ -3808,7 +4479,7 @@ RtVoid RiPolygon( RtInt nvertices, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Polygon " );
+   RibPrintf( "Polygon " );
 
    va_start(ap,nvertices);
    HandleParamList( ap, -1, NULL, NULL, nvertices, 1, nvertices );
@@ -3824,7 +4495,7 @@ RtVoid RiPolygonV( RtInt nvertices,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Polygon " );
+   RibPrintf( "Polygon " );
 
    HandleParamList( noap, n, tokens, parms, nvertices, 1, nvertices );
 }
@@ -3842,14 +4513,14 @@ RtVoid RiColorSamples( RtInt n, RtFloat nRGB[], RtFloat RGBn[] )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ColorSamples [" );
+   RibPrintf( "ColorSamples [" );
    for ( i=0; i<(n*3 - 1); i++ )
-     fprintf( fp, "%g ", nRGB[i] );
-   fprintf( fp, "%g] [", nRGB[i] );
+     RibPrintf( "%g ", nRGB[i] );
+   RibPrintf( "%g] [", nRGB[i] );
 
    for ( i=0; i<(n*3-1); i++ )
-     fprintf( fp, "%g ", RGBn[i] );
-   fprintf( fp, "%g]\n", RGBn[i] );
+     RibPrintf( "%g ", RGBn[i] );
+   RibPrintf( "%g]\n", RGBn[i] );
 }
 
 
@@ -3863,7 +4534,7 @@ RtVoid RiHider( RtToken type, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Hider \"%s\" ", type );
+   RibPrintf( "Hider \"%s\" ", type );
 
    va_start(ap,type);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
@@ -3879,7 +4550,7 @@ RtVoid RiHiderV( RtToken type,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Hider \"%s\" ", type );
+   RibPrintf( "Hider \"%s\" ", type );
 
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
@@ -3892,7 +4563,7 @@ RtVoid RiDetail( RtBound bound )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Detail %g %g %g %g %g %g\n",
+   RibPrintf( "Detail %g %g %g %g %g %g\n",
 	   bound[0], bound[1], bound[2], bound[3], bound[4], bound[5] );
 }
 
@@ -3905,7 +4576,7 @@ RtVoid RiDetailRange( RtFloat minvisible, RtFloat lowertransition,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "DetailRange %g %g %g %g\n", 
+   RibPrintf( "DetailRange %g %g %g %g\n", 
 	   minvisible, lowertransition, 
 	   uppertransition, maxvisible );
 }
@@ -3918,7 +4589,7 @@ RtVoid RiGeometricApproximation( RtToken type, RtFloat value )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "GeometricApproximation \"%s\" %g\n", type, value );
+   RibPrintf( "GeometricApproximation \"%s\" %g\n", type, value );
 }
 
 
@@ -3929,7 +4600,7 @@ RtVoid RiGeometricRepresentation( RtToken type )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "GeometricRepresentation \"%s\"\n", type );
+   RibPrintf( "GeometricRepresentation \"%s\"\n", type );
 }
 
 
@@ -3943,7 +4614,7 @@ RtVoid RiGeometry( RtToken type, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Geometry \"%s\" ", type );
+   RibPrintf( "Geometry \"%s\" ", type );
    va_start(ap,type);
    HandleParamList( ap, -1, NULL, NULL, 4, 1, 4 );
    va_end(ap);  
@@ -3958,7 +4629,7 @@ RtVoid RiGeometryV( RtToken type,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Geometry \"%s\" ", type );
+   RibPrintf( "Geometry \"%s\" ", type );
    HandleParamList( noap, n, tokens, parms, 4, 1, 4 );
 }
 
@@ -3973,7 +4644,7 @@ RtVoid RiOrientation( RtToken orientation )
    {
       CheckIfFirstLine();
 
-      fprintf( fp, "Orientation \"%s\"\n", orientation );
+      RibPrintf( "Orientation \"%s\"\n", orientation );
    }
 }
 
@@ -4014,16 +4685,16 @@ RtVoid RiProcedural( RtPointer data, RtBound bound,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "Procedural \"%s\" ", type );
+   RibPrintf( "Procedural \"%s\" ", type );
    if (data2)
    {
-      fprintf( fp, "[\"%s\" \"%s\"] ", data1, data2 );
+      RibPrintf( "[\"%s\" \"%s\"] ", data1, data2 );
    }
    else
    {
-      fprintf( fp, "[\"%s\"] ", data1 );
+      RibPrintf( "[\"%s\"] ", data1 );
    }
-   fprintf( fp, "[%g %g %g %g %g %g]\n", 
+   RibPrintf( "[%g %g %g %g %g %g]\n", 
 	   bound[0], bound[1], bound[2], bound[3], bound[4], bound[5] );
 
    return;
@@ -4037,7 +4708,7 @@ RtVoid RiRelativeDetail( RtFloat relativedetail )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "RelativeDetail %g\n", relativedetail );
+   RibPrintf( "RelativeDetail %g\n", relativedetail );
 }
 
 
@@ -4059,7 +4730,7 @@ RtVoid RiMakeBump( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeBump \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
+   RibPrintf( "MakeBump \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
 	  picturename, texturename, swrap, twrap, p, swidth, twidth );
    va_start(ap,twidth);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
@@ -4084,7 +4755,7 @@ RtVoid RiMakeBumpV( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeBump \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
+   RibPrintf( "MakeBump \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
 	  picturename, texturename, swrap, twrap, p, swidth, twidth );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
@@ -4109,7 +4780,7 @@ RtVoid RiMakeCubeFaceEnvironment( char *px, char *nx, char *py, char *ny,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeCubeFaceEnvironment "                             \
+   RibPrintf( "MakeCubeFaceEnvironment "                             \
 	  "\"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g "  \
 	  "\"%s\" %g %g ",
 	  px, nx, py, ny, pz, nz, texturename, fov, p, swidth, twidth );
@@ -4139,7 +4810,7 @@ RtVoid RiMakeCubeFaceEnvironmentV( char *px, char *nx, char *py, char *ny,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeCubeFaceEnvironment "                        \
+   RibPrintf( "MakeCubeFaceEnvironment "                        \
 	  "\"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g "  \
 	  "\"%s\" %g %g ",
 	  px, nx, py, ny, pz, nz, texturename, fov, p, swidth, twidth );
@@ -4164,7 +4835,7 @@ RtVoid RiMakeLatLongEnvironment( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeLatLongEnvironment \"%s\" \"%s\" \"%s\" %g %g ",
+   RibPrintf( "MakeLatLongEnvironment \"%s\" \"%s\" \"%s\" %g %g ",
 	  picturename, texturename, p, swidth, twidth );
    va_start(ap,twidth);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
@@ -4190,7 +4861,7 @@ RtVoid RiMakeLatLongEnvironmentV( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeLatLongEnvironment \"%s\" \"%s\" \"%s\" %g %g ",
+   RibPrintf( "MakeLatLongEnvironment \"%s\" \"%s\" \"%s\" %g %g ",
 	  picturename, texturename, p, swidth, twidth );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
@@ -4206,7 +4877,7 @@ RtVoid RiMakeShadow( char *picturename, char *texturename, ... )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeShadow \"%s\" \"%s\" ", picturename, texturename );
+   RibPrintf( "MakeShadow \"%s\" \"%s\" ", picturename, texturename );
    va_start(ap,texturename);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
    va_end(ap);  
@@ -4221,7 +4892,7 @@ RtVoid RiMakeShadowV( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeShadow \"%s\" \"%s\" ", picturename, texturename );
+   RibPrintf( "MakeShadow \"%s\" \"%s\" ", picturename, texturename );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
 
@@ -4244,7 +4915,7 @@ RtVoid RiMakeTexture( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeTexture \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
+   RibPrintf( "MakeTexture \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
 	  picturename, texturename, swrap, twrap, p, swidth, twidth );
    va_start(ap,twidth);
    HandleParamList( ap, -1, NULL, NULL, 1, 1, 1 );
@@ -4269,7 +4940,7 @@ RtVoid RiMakeTextureV( char *picturename, char *texturename,
 
    CheckIfFirstLine();
 
-   fprintf( fp, "MakeTexture \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
+   RibPrintf( "MakeTexture \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" %g %g ",
 	  picturename, texturename, swrap, twrap, p, swidth, twidth );
    HandleParamList( noap, n, tokens, parms, 1, 1, 1 );
 }
@@ -4281,7 +4952,7 @@ RtVoid RiWorldBegin( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "WorldBegin\n" );
+   RibPrintf( "WorldBegin\n" );
 }
 
 
@@ -4292,7 +4963,7 @@ RtVoid RiWorldEnd( void )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "WorldEnd\n" );
+   RibPrintf( "WorldEnd\n" );
 }
 
 
@@ -4319,7 +4990,7 @@ RtVoid RiErrorHandler( /* RtFunc (3.5 CHANGE)*/ RtErrorHandler handler )
 
    CheckIfFirstLine();
 
-   fprintf( fp, "ErrorHandler \"%s\"\n", s );
+   RibPrintf( "ErrorHandler \"%s\"\n", s );
 
    return;
 }
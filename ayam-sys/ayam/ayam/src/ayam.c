@@ -90,6 +90,10 @@ ay_ftable ay_sevalcbt;
 
 ay_ftable ay_peekcbt;
 
+ay_ftable ay_breadcbt;
+
+ay_ftable ay_bwritecbt;
+
 /* registered languages */
 Tcl_HashTable ay_languagesht;
 
@@ -230,6 +234,10 @@ unsigned int ay_peek_tagtype;
 
 char *ay_peek_tagname = "PE";
 
+unsigned int ay_lz_tagtype;
+
+char *ay_lz_tagname = "LZ";
+
 /* default logging directory and file */
 static char *ay_log = "/tmp/ay.log";
 
@@ -327,6 +335,12 @@ ay_init(Tcl_Interp *interp)
   if((ay_status = ay_table_initftable(&ay_peekcbt)))
     { ay_error(ay_status, fname, NULL); return AY_ERROR; }
 
+  if((ay_status = ay_table_initftable(&ay_breadcbt)))
+    { ay_error(ay_status, fname, NULL); return AY_ERROR; }
+
+  if((ay_status = ay_table_initftable(&ay_bwritecbt)))
+    { ay_error(ay_status, fname, NULL); return AY_ERROR; }
+
   /* Languages */
   Tcl_InitHashTable(&ay_languagesht, TCL_STRING_KEYS);
 
@@ -360,6 +374,12 @@ ay_init(Tcl_Interp *interp)
   /* initialize wrib module */
   ay_wrib_init(interp);
 
+  /* initialize bbc module */
+  ay_bbc_init();
+
+  /* initialize selp module */
+  ay_selp_init();
+
   /* initialize tree module */
   ay_tree_init(interp);
 
@@ -591,6 +611,9 @@ ay_init(Tcl_Interp *interp)
   /* register PE (Peek) tag type */
   (void)ay_tags_register(ay_peek_tagname, &ay_peek_tagtype);
 
+  /* register LZ (Lazy load) tag type */
+  (void)ay_tags_register(ay_lz_tagname, &ay_lz_tagtype);
+
 
   /* create root object */
   if((ay_status = ay_object_create(AY_IDROOT, &ay_root)))
@@ -1510,6 +1533,9 @@ ay_safeinit(Tcl_Interp *interp)
   Tcl_CreateCommand(interp, "torsionNC", ay_nct_getcurvaturetcmd,
 		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
+  Tcl_CreateCommand(interp, "intersectNC", ay_nct_intersecttcmd,
+		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+
   /* nurbs/npt.c */
   Tcl_CreateCommand(interp, "crtNSphere", ay_npt_crtnspheretcmd,
 		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
@@ -1526,6 +1552,12 @@ ay_safeinit(Tcl_Interp *interp)
   Tcl_CreateCommand(interp, "topoly", ay_tess_npatchtcmd,
 		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
+  Tcl_CreateCommand(interp, "tessNPs", ay_tess_npatchestcmd,
+		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+
+  Tcl_CreateCommand(interp, "adTessNP", ay_tess_npatchadaptivetcmd,
+		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+
   Tcl_CreateCommand(interp, "elevateuNP", ay_npt_elevateuvtcmd,
 		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
@@ -1619,6 +1651,9 @@ ay_safeinit(Tcl_Interp *interp)
   Tcl_CreateCommand(interp, "curvatNP", ay_npt_getcurvaturetcmd,
 		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
+  Tcl_CreateCommand(interp, "findUVNP", ay_npt_finduvtcmd,
+		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
+
   Tcl_CreateCommand(interp, "fairNP", ay_npt_fairnptcmd,
 		    (ClientData) NULL, (Tcl_CmdDeleteProc *) NULL);
 
@@ -439,6 +439,22 @@ typedef struct ay_root_object_s
 } ay_root_object;
 
 
+/** retained vertex arrays for shading (see ay_shade_vbufdraw());
+ *  vertices are stored interleaved with their normals, the triangles
+ *  are drawn with a single glDrawElements() call
+ */
+typedef struct ay_vbuf_s {
+  int valid; /**< AY_TRUE if the arrays match the owning object */
+  int mode; /**< how the arrays were built (owner specific) */
+  unsigned int nv; /**< number of vertices in v */
+  unsigned int vlen; /**< allocated number of vertices in v */
+  double *v; /**< vertices and normals [vlen*6], may be NULL */
+  unsigned int nidx; /**< number of triangle vertex indices */
+  unsigned int idxlen; /**< allocated number of indices */
+  unsigned int *idx; /**< triangle vertex indices [idxlen] */
+} ay_vbuf;
+
+
 /** a tesselated NURBS curve */
 typedef struct ay_stess_curve_s {
   int tesslen; /**< number of points in tesselation */
@@ -473,17 +489,20 @@ typedef struct ay_nurbcurve_object_s
 } ay_nurbcurve_object;
 
 
-/** a tesselated NURBS patch point */
-typedef struct ay_stess_uvp_s {
-  struct ay_stess_uvp_s *next; /**< next point */
-  struct ay_stess_uvp_s *prev; /**< previous point */
-  int type; /**< 0 - original point, 1 - trimloop point */
-  int dir; /**< direction of associated trimcurve, 0 - cw, 1 - ccw */
-  /*@{*//** associated parametric values of this point */
-  double u, v;
-  /*@}*/
-  double C[6]; /**< geometric coordinates and normal of this point */
-} ay_stess_uvp;
+/** tesselated lines of a trimmed NURBS patch in one parametric dimension;
+ *  the points of all lines are stored consecutively (structure of arrays)
+ *  in a single memory block, points of line i are in the index range
+ *  starts[i] to starts[i+1]-1
+ */
+typedef struct ay_stess_lines_s {
+  int numlines; /**< number of lines */
+  int numpoints; /**< total number of points in all lines */
+  int *starts; /**< index of first point of each line [numlines+1] */
+  char *types; /**< 0 - original point, 1 - trimloop point [numpoints] */
+  double *uv; /**< associated parametric values [numpoints*2] */
+  double *C; /**< geometric coordinates and normals [numpoints*6] */
+  void *arena; /**< memory block holding all arrays above */
+} ay_stess_lines;
 
 
 /** a tesselated NURBS patch */
@@ -495,10 +514,8 @@ typedef struct ay_stess_patch_s {
   double *tessv; /**< tesselated points and normals [tessw*tessh*6] */
 
   /* trimmed patch */
-  int upslen; /**< number of arrays of tesselated points (U) */
-  int vpslen; /**< number of arrays of tesselated points (V) */
-  ay_stess_uvp **ups; /**< lists of tesselated points [upslen] */
-  ay_stess_uvp **vps; /**< lists of tesselated points [vpslen] */
+  ay_stess_lines ups; /**< tesselated lines along U */
+  ay_stess_lines vps; /**< tesselated lines along V */
 
   int ft_cw; /**< first trim is oriented clockwise? */
   int tcslen; /**< number of tesselated trim curves */
@@ -507,6 +524,9 @@ typedef struct ay_stess_patch_s {
 
   struct ay_pomesh_object_s *pomesh;  /**< tesselated planar trimmed patch */
   double normal[3]; /**< normal of tesselated planar mesh */
+
+  ay_vbuf vb; /**< shading arrays (indices into tessv/ups.C) */
+  ay_vbuf vpsvb; /**< shading arrays of trimmed patch (indices into vps.C) */
 } ay_stess_patch;
 
 
@@ -659,7 +679,7 @@ typedef struct ay_pomesh_object_s {
   double *controlv; /**< control points [ncontrols * stride] */
   double *face_normals; /**< face normals [npolys * 3] */
 
-  /*  GLuint list;*/
+  ay_vbuf *vb; /**< cached shading arrays, NULL if not shaded yet */
 } ay_pomesh_object;
 
 
@@ -1433,6 +1453,7 @@ typedef struct ay_preferences_s
   int lazynotify; /**< control notification */
   int completenotify; /**< control complete notification */
   int undo_levels; /**< number of undo levels, -1 turns undo off */
+  int undo_memory; /**< memory budget of the undo buffer (MB), 0 - none */
   int globalmark; /**< maintain a global mark? */
   int createatmark; /**< create objects at the mark? */
   int rationalpoints; /**< type of rational points (0 - euclidean,
@@ -1449,6 +1470,10 @@ typedef struct ay_preferences_s
   int defaultmat; /**< default material: 0 no, 1 matte, 2 "default" */
   int writeident; /**< write object names as RI comments? */
   int excludehidden; /**< exclude hidden objects from RIB export? */
+  int ribformat; /**< RIB format (0 - ASCII, 1 - precise ASCII, 2 - binary) */
+  int ribcompress; /**< write gzip compressed RIB files? */
+  int ribcache; /**< cache object RIB archives between exports? */
+  int ribparallel; /**< export top-level objects in parallel? */
 
   /* Mops Import prefs */
   int mopsiresetdisplaymode; /**< reset display mode for Mops import? */
@@ -1500,6 +1525,8 @@ typedef struct ay_preferences_s
   int sdmode; /**< silhouette detection mode (0 off, 1 z, 2 color, 3 both) */
 
   int cullfaces; /**< enable culling of back faces in OpenGL? */
+  int cullobjects; /**< skip objects outside of the view frustum? */
+  int cullsize; /**< draw smaller objects as box in actions (pixels) */
 
   /* error handling */
   char onerror; /**< what to do if errors occur? 0 stop, 1 continue */
@@ -1562,6 +1589,9 @@ typedef struct ay_preferences_s
   int converttagslen; /**< number of tag types in converttags */
 
   int disablefailedscripts;  /**< disable scripts after errors */
+
+  /** load object data from binary scene files on demand? */
+  int lazyload;
 } ay_preferences;
 
 
@@ -1584,6 +1614,23 @@ typedef struct ay_otable_s
 } ay_otable;
 
 
+/** binary scene file (see bin.c) */
+typedef struct ay_binfile_s
+{
+  FILE *fileptr; /**< scene file */
+  FILE *tmp; /**< temporary file for text encoded objects (writing) */
+  unsigned char *data; /**< mapped file (reading) or chunk (writing) */
+  size_t size; /**< size of data */
+  size_t pos; /**< current read/write position in data */
+  size_t end; /**< end of current chunk (reading) */
+  int mapped; /**< is data memory mapped? */
+  int version; /**< version of the container format (reading) */
+  unsigned int refcount; /**< number of objects not loaded yet */
+  unsigned int hash[3]; /**< content hash (FNV-1a, 64 bits) and check sum
+			   (writing without scene file) */
+} ay_binfile;
+
+
 /* Callbacks */
 
 /** Create callback, think constructor */
@@ -1615,6 +1662,12 @@ typedef int (ay_readcb) (FILE *fileptr, ay_object *o);
 /** Write (to Ayam scene file) callback */
 typedef int (ay_writecb) (FILE *fileptr, ay_object *o);
 
+/** Read (from binary Ayam scene file) callback */
+typedef int (ay_breadcb) (ay_binfile *bf, ay_object *o);
+
+/** Write (to binary Ayam scene file) callback */
+typedef int (ay_bwritecb) (ay_binfile *bf, ay_object *o);
+
 /** Notification (update after changes to children) callback  */
 typedef int (ay_notifycb) (ay_object *o);
 
@@ -1647,6 +1700,9 @@ typedef int (ay_delpntcb) (ay_object *o, int *index, double *objXYZ);
 /** Generic operation callback */
 typedef int (ay_genericcb) (ay_object *o, int op);
 
+/** Thread pool work callback */
+typedef int (ay_tpworkcb) (void *data, int item, int thread);
+
 
 /* Globals */
 
@@ -1736,6 +1792,10 @@ extern ay_ftable ay_convertcbt;
 extern ay_ftable ay_providecbt;
 /** all registered peek callbacks */
 extern ay_ftable ay_peekcbt;
+/** all registered binary read callbacks */
+extern ay_ftable ay_breadcbt;
+/** all registered binary write callbacks */
+extern ay_ftable ay_bwritecbt;
 /*@}*/
 
 /** all registered script evaluation callbacks */
@@ -1824,6 +1884,8 @@ extern unsigned int ay_sbc_tagtype;
 extern char *ay_sbc_tagname;
 extern unsigned int ay_peek_tagtype;
 extern char *ay_peek_tagname;
+extern unsigned int ay_lz_tagtype;
+extern char *ay_lz_tagname;
 /*@}*/
 
 /** \name Generic Error Message Strings */
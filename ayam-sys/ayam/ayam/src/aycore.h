@@ -34,6 +34,113 @@ int ay_bbc_fromlist(ay_object *o, int update, double *bbox);
 int ay_bbc_gettcmd(ClientData clientData, Tcl_Interp *interp,
 		   int argc, char *argv[]);
 
+/** get cached bounding box of object o and children for view culling
+ */
+int ay_bbc_getcull(ay_object *o, double *bb);
+
+/** start a new frame for the view culling bounding box cache
+ */
+void ay_bbc_cachenewframe(void);
+
+/** forget cached view culling bounding box of object o
+ */
+void ay_bbc_cacheinvalidate(ay_object *o);
+
+/** initialize bbc module
+ */
+void ay_bbc_init(void);
+
+/* bin.c */
+
+/** register binary read and write callbacks
+ */
+int ay_bin_register(ay_breadcb *rcb, ay_bwritecb *wcb, unsigned int type_id);
+
+/** write integer to binary scene file
+ */
+int ay_bin_writeint(ay_binfile *bf, int i);
+
+/** write unsigned integers to binary scene file
+ */
+int ay_bin_writeuints(ay_binfile *bf, size_t n, unsigned int *v);
+
+/** write doubles to binary scene file
+ */
+int ay_bin_writedoubles(ay_binfile *bf, size_t n, double *v);
+
+/** write string to binary scene file
+ */
+int ay_bin_writestring(ay_binfile *bf, char *str);
+
+/** write the buffered data to the binary scene file (or hash it)
+ */
+int ay_bin_flush(ay_binfile *bf);
+
+/** prepare a binary file without scene file for hashing
+ */
+void ay_bin_hashinit(ay_binfile *bf);
+
+/** read integer from binary scene file
+ */
+int ay_bin_readint(ay_binfile *bf, int *result);
+
+/** read unsigned integers from binary scene file
+ */
+int ay_bin_readuints(ay_binfile *bf, size_t n, unsigned int *result);
+
+/** read doubles from binary scene file
+ */
+int ay_bin_readdoubles(ay_binfile *bf, size_t n, double *result);
+
+/** read string from binary scene file
+ */
+int ay_bin_readstring(ay_binfile *bf, char **result);
+
+/** write the binary scene file header
+ */
+int ay_bin_writeheader(ay_binfile *bf);
+
+/** save an object to a binary scene file
+ */
+int ay_bin_writeobject(ay_binfile *bf, ay_object *o);
+
+/** release all resources of a binary scene file
+ */
+void ay_bin_close(ay_binfile *bf);
+
+/** check whether a scene file is a binary scene file
+ */
+int ay_bin_isbinary(FILE *fileptr);
+
+/** read all objects from a binary scene file
+ */
+int ay_bin_readscene(FILE *fileptr);
+
+/** check whether the data of an object has not been loaded yet
+ */
+int ay_bin_islazy(ay_object *o);
+
+/** get bounding box of an object whose data has not been loaded yet
+ */
+int ay_bin_getbbox(ay_object *o, double *bbox);
+
+/** load the data of a lazily read object
+ */
+int ay_bin_load(ay_object *o);
+
+/** load the data of all lazily read objects in a hierarchy
+ */
+void ay_bin_loadall(ay_object *o);
+
+/** load the data of all lazily read objects in a list and their children
+ */
+void ay_bin_loadlist(ay_list_object *l);
+
+/** forget about the data of a lazily read object
+ */
+void ay_bin_release(ay_object *o);
+
+
 /* clear.c */
 
 /** remove all objects from the scene
@@ -186,6 +293,18 @@ int ay_convert_nptoolobj(ay_object *o, ay_object *p, ay_object *cb,
 
 /* draw.c */
 
+/** draw a bounding box as stand-in of a culled object
+ */
+void ay_draw_cullbox(double *bb);
+
+/** reset OpenGL names of a culled object and its children
+ */
+void ay_draw_cullnames(ay_object *o);
+
+/** check whether an object may be culled from the view
+ */
+int ay_draw_cull(struct Togl *togl, ay_object *o, int selected, double *bb);
+
 /** draw an object
  */
 void ay_draw_object(struct Togl *togl, ay_object *o, int selected);
@@ -476,6 +595,26 @@ int ay_notify_findparents(ay_object *o, ay_object *r,
  */
 int ay_notify_complete(ay_object *r);
 
+/** do complete notification for multiple objects
+ */
+int ay_notify_completemulti(int n, ay_object **r);
+
+/** add linked object to dependency graph of complete notification
+ */
+void ay_notify_graphlink(ay_object *o, ay_object *parent);
+
+/** remove unlinked object from dependency graph of complete notification
+ */
+void ay_notify_graphunlink(ay_object *o);
+
+/** remove deleted object from dependency graph of complete notification
+ */
+void ay_notify_graphremove(ay_object *o);
+
+/** invalidate dependency graph of complete notification
+ */
+void ay_notify_graphinvalidate(void);
+
 /** manage blocking of automatic notifications
  */
 void ay_notify_block(int scope, int block);
@@ -1219,6 +1358,10 @@ int ay_read_header(FILE *fileptr);
  */
 int ay_read_attributes(FILE *fileptr, ay_object *o);
 
+/** look up the type of a freshly read tag
+ */
+int ay_read_tagtype(ay_tag *tag);
+
 /** read object tags from Ayam scene file
  */
 int ay_read_tags(FILE *fileptr, ay_object *o);
@@ -1227,6 +1370,14 @@ int ay_read_tags(FILE *fileptr, ay_object *o);
  */
 int ay_read_shader(FILE *fileptr, ay_shader **result);
 
+/** get type id from object type name (autoloading plugins)
+ */
+int ay_read_gettype(char *typename, unsigned int *type);
+
+/** link freshly read object to the scene
+ */
+void ay_read_linkobject(ay_object *o, int has_child);
+
 /** read object from Ayam scene file
  */
 int ay_read_object(FILE *fileptr);
@@ -1418,6 +1569,26 @@ void ay_selp_updatempselection(unsigned int n, ay_point *selp, ay_mpoint *mp);
  */
 int ay_selp_find(ay_point *selp, double *point);
 
+/** Find the point of an object nearest to a given point.
+ */
+int ay_selp_nearest(ay_object *o, unsigned int arrlen, int stride, int ishom,
+		    double *arr, double *p, double *min_dist,
+		    unsigned int *index);
+
+/** Find all points of an object inside four planes.
+ */
+int ay_selp_inside(ay_object *o, unsigned int arrlen, int stride, int ishom,
+		   double *arr, double *pl, unsigned int *num,
+		   unsigned int **indices);
+
+/** Forget the point picking index of an object.
+ */
+void ay_selp_cacheinvalidate(ay_object *o);
+
+/** Initialize the selp module.
+ */
+void ay_selp_init(void);
+
 
 /* shade.c */
 
@@ -1429,6 +1600,23 @@ void ay_shade_object(struct Togl *togl, ay_object *o, int push_name);
  */
 int ay_shade_view(struct Togl *togl);
 
+/** free the arrays of a shading vertex buffer
+ */
+void ay_shade_vbuffree(ay_vbuf *vb);
+
+/** append a vertex to a shading vertex buffer
+ */
+int ay_shade_vbufaddvert(ay_vbuf *vb, double *p, double *n);
+
+/** append a triangle to a shading vertex buffer
+ */
+int ay_shade_vbufaddtri(ay_vbuf *vb, unsigned int a, unsigned int b,
+			unsigned int c);
+
+/** shade the triangles of a vertex buffer using vertex arrays
+ */
+void ay_shade_vbufdraw(ay_vbuf *vb, double *v);
+
 
 /* shader.c */
 
@@ -1748,6 +1936,25 @@ void ay_toglcb_reshape(struct Togl *togl);
 void ay_toglcb_display(struct Togl *togl);
 
 
+/* tp.c */
+
+/** get number of worker threads used by the thread pool
+ */
+int ay_tp_getnumthreads(void);
+
+/** set number of worker threads used by the thread pool
+ */
+void ay_tp_setnumthreads(int n);
+
+/** process a number of independent work items in parallel
+ */
+int ay_tp_run(int nitems, ay_tpworkcb *cb, void *data);
+
+/** check whether the calling thread processes work items
+ */
+int ay_tp_inworker(void);
+
+
 /* trafo.c */
 
 /** apply trafo to point (3D)
@@ -2111,6 +2318,10 @@ void ay_wrib_placecamera(RtPoint position, RtPoint direction, double roll);
  */
 void ay_wrib_rioptions(int searchpathsonly);
 
+/** set the format of the RIB files to write according to the preferences
+ */
+void ay_wrib_ribformat(void);
+
 /** look through the scene whether there are any lights switched on
  */
 int ay_wrib_checklights(ay_object *o);
@@ -2151,6 +2362,38 @@ char *ay_wrib_geniafilename(char *base, char *oi);
  */
 int ay_wrib_refobject(char *file, ay_object *o);
 
+/** forget all content hashes of the RIB archive cache
+ */
+void ay_wrib_cacheclear(void);
+
+/** forget the content hash of a changed object
+ */
+void ay_wrib_cacheinvalidate(ay_object *o);
+
+/** prepare the RIB archive cache for an export
+ */
+void ay_wrib_cachebegin(char *file);
+
+/** get the name of the cached archive of an object
+ */
+char *ay_wrib_cachename(char *file, ay_object *o, int master);
+
+/** check whether an archive file exists
+ */
+int ay_wrib_cacheexists(char *archive);
+
+/** write the archives of all changed top-level objects
+ */
+int ay_wrib_cachewrite(char *file, ay_object *o);
+
+/** export a top-level object using its cached archive
+ */
+int ay_wrib_cachedobject(char *file, ay_object *o);
+
+/** export a list of top-level objects, possibly in parallel
+ */
+int ay_wrib_objects(char *file, ay_object *o);
+
 /** export the scene to a RIB file
  */
 int ay_wrib_scene(char *file, char *image, char *driver, int temp, int target,
@@ -2219,7 +2462,7 @@ int ay_write_object(FILE *fileptr, ay_object *o);
 
 /** save the scene to a scene file
  */
-int ay_write_scene(char *fname, int selected);
+int ay_write_scene(char *fname, int selected, int binary);
 
 /** Tcl command to save the scene to a scene file
  */
@@ -14,6 +14,37 @@
 
 /* bbc.c - bounding box calculation */
 
+/* View culling cache:
+ * the own bounding box of an object (as delivered by its bbc callback,
+ * without children and transformations) is computed once and stored
+ * in ay_bbc_cacheht until ay_bbc_cacheinvalidate() is called for the
+ * object (which happens upon notification and deletion);
+ * the bounding box of an object including its children is combined
+ * from the cached boxes and the current transformations at most once
+ * per frame (see ay_bbc_cachenewframe()), so that transforming objects
+ * needs no invalidation
+ */
+
+/* types local to this module: */
+typedef struct ay_bbc_entry_s {
+  int own; /* 0 - invalid, 1 - valid, 2 - none, 3 - exclusive, 4 - unknown */
+  double ownbb[6]; /* own bounding box (xmin, xmax, ymin, ymax, zmin, zmax) */
+  unsigned int frame; /* frame of subbb */
+  int subok; /* AY_TRUE if subbb is known */
+  double subbb[6]; /* bounding box including the children */
+} ay_bbc_entry;
+
+/* local variables: */
+static Tcl_HashTable ay_bbc_cacheht;
+
+static unsigned int ay_bbc_frame = 1;
+
+/* prototypes of functions local to this module: */
+void ay_bbc_getown(ay_object *o, ay_bbc_entry *e);
+
+void ay_bbc_merge(double *bb, double *c, int n);
+
+
 /* ay_bbc_get:
  *  changes to this function also need to be applied to:
  *  objects/instance.c/ay_instance_bbccb()
@@ -41,6 +72,10 @@ ay_bbc_get(ay_object *o, double *bbox)
   if(!o || !bbox)
     return AY_ENULL;
 
+  /* objects not loaded yet carry their bounding box */
+  if(!o->refine && !ay_bin_getbbox(o, bbox))
+    return AY_OK;
+
   /* get transformations */
   if(AY_ISTRAFO(o))
     {
@@ -433,3 +468,253 @@ ay_bbc_gettcmd(ClientData clientData, Tcl_Interp *interp,
  return TCL_OK;
 } /* ay_bbc_gettcmd */
 
+
+
+/* ay_bbc_merge:
+ *  merge the <n> points <c> into the bounding box <bb>
+ *  (xmin, xmax, ymin, ymax, zmin, zmax)
+ */
+void
+ay_bbc_merge(double *bb, double *c, int n)
+{
+ int i;
+
+  for(i = 0; i < n; i++)
+    {
+      if(c[0] < bb[0])
+	bb[0] = c[0];
+      if(c[0] > bb[1])
+	bb[1] = c[0];
+      if(c[1] < bb[2])
+	bb[2] = c[1];
+      if(c[1] > bb[3])
+	bb[3] = c[1];
+      if(c[2] < bb[4])
+	bb[4] = c[2];
+      if(c[2] > bb[5])
+	bb[5] = c[2];
+      c += 3;
+    }
+
+ return;
+} /* ay_bbc_merge */
+
+
+/* ay_bbc_getown:
+ *  compute the own bounding box of object <o> into cache entry <e>
+ */
+void
+ay_bbc_getown(ay_object *o, ay_bbc_entry *e)
+{
+ ay_voidfp *arr = NULL;
+ ay_bbccb *cb = NULL;
+ double bbt[24] = {0};
+ int flags = 0;
+
+  e->own = 4;
+
+  /* objects not loaded yet carry a transformed bounding box */
+  if(!o->refine)
+    return;
+
+  arr = ay_bbccbt.arr;
+  cb = (ay_bbccb *)(arr[o->type]);
+  if(!cb || cb(o, bbt, &flags))
+    return;
+
+  switch(flags)
+    {
+    case 0:
+    case 1:
+      e->ownbb[0] = DBL_MAX; e->ownbb[1] = -DBL_MAX;
+      e->ownbb[2] = DBL_MAX; e->ownbb[3] = -DBL_MAX;
+      e->ownbb[4] = DBL_MAX; e->ownbb[5] = -DBL_MAX;
+      ay_bbc_merge(e->ownbb, bbt, 8);
+      e->own = flags?3:1;
+      break;
+    case 2:
+      e->own = 2;
+      break;
+    default:
+      /* bounding box contains transformations */
+      break;
+    } /* switch */
+
+ return;
+} /* ay_bbc_getown */
+
+
+/** ay_bbc_getcull:
+ *  get the bounding box of object <o> and its visible children in the
+ *  coordinate system of <o> (i.e. without the transformations of <o>)
+ *  for view culling, using the cache
+ *
+ * \param[in] o object to process
+ * \param[in,out] bb where to store the bounding box
+ *  (xmin, xmax, ymin, ymax, zmin, zmax) [6]
+ *
+ * \returns AY_OK on success, AY_ERROR if the bounding box is not known
+ *  (then the object must be drawn)
+ */
+int
+ay_bbc_getcull(ay_object *o, double *bb)
+{
+ Tcl_HashEntry *entry = NULL;
+ ay_bbc_entry *e = NULL;
+ ay_object *d;
+ double c[24], m[16], sub[6];
+ int i, new_item = 0, have_bb = AY_FALSE, ok = AY_TRUE;
+
+  if(!o || !bb)
+    return AY_ENULL;
+
+  entry = Tcl_CreateHashEntry(&ay_bbc_cacheht, (char*)o, &new_item);
+  if(new_item)
+    {
+      if(!(e = calloc(1, sizeof(ay_bbc_entry))))
+	{
+	  Tcl_DeleteHashEntry(entry);
+	  return AY_EOMEM;
+	}
+      Tcl_SetHashValue(entry, (ClientData)e);
+    }
+  else
+    {
+      e = (ay_bbc_entry *)Tcl_GetHashValue(entry);
+      if(e->frame == ay_bbc_frame)
+	{
+	  if(!e->subok)
+	    return AY_ERROR;
+	  memcpy(bb, e->subbb, 6*sizeof(double));
+	  return AY_OK;
+	}
+    }
+
+  /* mark as unknown first, this also stops cyclic references */
+  e->frame = ay_bbc_frame;
+  e->subok = AY_FALSE;
+
+  bb[0] = DBL_MAX; bb[1] = -DBL_MAX;
+  bb[2] = DBL_MAX; bb[3] = -DBL_MAX;
+  bb[4] = DBL_MAX; bb[5] = -DBL_MAX;
+
+  if(o->type == AY_IDINSTANCE)
+    {
+      /* instances draw the master (without its transformations) */
+      if(!o->refine || (o->tags && ay_instance_hasrptrafo(o)) ||
+	 ay_bbc_getcull((ay_object *)o->refine, sub))
+	return AY_ERROR;
+      memcpy(bb, sub, 6*sizeof(double));
+      have_bb = AY_TRUE;
+    }
+  else
+    {
+      if(!e->own)
+	ay_bbc_getown(o, e);
+
+      if(e->own == 4)
+	return AY_ERROR;
+
+      if(e->own == 1 || e->own == 3)
+	{
+	  memcpy(bb, e->ownbb, 6*sizeof(double));
+	  have_bb = AY_TRUE;
+	}
+    } /* if */
+
+  if(e->own != 3 && !o->hide_children && o->down)
+    {
+      d = o->down;
+      while(d->next)
+	{
+	  if(!d->hide)
+	    {
+	      if(!o->inherit_trafos || ay_bbc_getcull(d, sub))
+		{
+		  ok = AY_FALSE;
+		  break;
+		}
+
+	      c[0] = sub[0]; c[1] = sub[2]; c[2] = sub[4];
+	      c[3] = sub[1]; c[4] = sub[2]; c[5] = sub[4];
+	      c[6] = sub[0]; c[7] = sub[3]; c[8] = sub[4];
+	      c[9] = sub[1]; c[10] = sub[3]; c[11] = sub[4];
+	      for(i = 0; i < 12; i++)
+		c[i+12] = c[i];
+	      for(i = 14; i < 24; i += 3)
+		c[i] = sub[5];
+
+	      if(AY_ISTRAFO(d))
+		{
+		  ay_trafo_creatematrix(d, m);
+		  ay_trafo_apply3v(c, 8, 3, m);
+		}
+
+	      ay_bbc_merge(bb, c, 8);
+	      have_bb = AY_TRUE;
+	    } /* if */
+	  d = d->next;
+	} /* while */
+    } /* if */
+
+  if(!ok || !have_bb)
+    return AY_ERROR;
+
+  memcpy(e->subbb, bb, 6*sizeof(double));
+  e->subok = AY_TRUE;
+
+ return AY_OK;
+} /* ay_bbc_getcull */
+
+
+/** ay_bbc_cachenewframe:
+ *  start a new frame, i.e. let ay_bbc_getcull() combine the bounding
+ *  boxes of all objects anew (as transformations may have changed)
+ */
+void
+ay_bbc_cachenewframe(void)
+{
+
+  ay_bbc_frame++;
+
+ return;
+} /* ay_bbc_cachenewframe */
+
+
+/** ay_bbc_cacheinvalidate:
+ *  forget the cached bounding box of object <o>
+ *
+ * \param[in] o changed or deleted object
+ */
+void
+ay_bbc_cacheinvalidate(ay_object *o)
+{
+ Tcl_HashEntry *entry = NULL;
+
+  if(!o)
+    return;
+
+  ay_bbc_frame++;
+
+  entry = Tcl_FindHashEntry(&ay_bbc_cacheht, (char*)o);
+  if(entry)
+    {
+      free(Tcl_GetHashValue(entry));
+      Tcl_DeleteHashEntry(entry);
+    }
+
+ return;
+} /* ay_bbc_cacheinvalidate */
+
+
+/** ay_bbc_init:
+ *  initialize the bounding box module
+ */
+void
+ay_bbc_init(void)
+{
+
+  Tcl_InitHashTable(&ay_bbc_cacheht, TCL_ONE_WORD_KEYS);
+
+ return;
+} /* ay_bbc_init */
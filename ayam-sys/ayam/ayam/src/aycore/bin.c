@@ -0,0 +1,1681 @@
+/*
+ * Ayam, a free 3D modeler for the RenderMan interface.
+ *
+ * Ayam is copyrighted 1998-2021 by Randolf Schultz
+ * (randolf.schultz@gmail.com) and others.
+ *
+ * All rights reserved.
+ *
+ * See the file License for details.
+ *
+ */
+
+#include "ayam.h"
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/** \file bin.c \brief binary scene files */
+
+/* A binary scene file starts with the magic AY_BINMAGIC, the version
+ * of the container format, the scene file version of text encoded
+ * object data (see below), and the version string of the writing Ayam.
+ * Then follow chunks, each consisting of a four character id,
+ * a 64 bit length, and the chunk data; unknown chunks are skipped.
+ * All numbers are stored in little endian byte order, strings are
+ * stored as 32 bit length followed by the characters.
+ *
+ * Each object is stored in an AY_BINCHUNKOBJ chunk holding the type,
+ * attributes, and tags of the object, followed by the object type
+ * specific data, which is either written by a registered binary write
+ * callback (raw arrays of doubles and integers that are bulk copied
+ * from the memory mapped file on reading) or, for all other object
+ * types, by the normal write callback in the text format.
+ * Binary encoded object data is preceded by the bounding box of the
+ * object (since version 2).
+ * The objects appear in the same order as in text scene files.
+ *
+ * If the LazyLoad preference is set, binary encoded objects are
+ * linked to the scene without their data; the chunk positions and
+ * bounding boxes are kept in LZ tags and the file stays mapped until
+ * all objects have been loaded by ay_bin_load() (which happens on
+ * first use, e.g. for drawing, selection, or export) or deleted.
+ * Drawing, shading, and picking load an object only after it passed
+ * the view frustum culling against its stored bounding box, hidden
+ * and culled objects stay unloaded; if the CullObjects preference is
+ * not set, the first redraw of a view loads all visible objects.
+ */
+
+/** magic bytes at the start of a binary scene file */
+#define AY_BINMAGIC "AyamBin\n"
+
+/** length of AY_BINMAGIC */
+#define AY_BINMAGICLEN 8
+
+/** version of the container format */
+#define AY_BINVERSION 2
+
+/** scene file version of text encoded objects (see ay_read_version) */
+#define AY_BINTEXTVERSION 17
+
+/** id of object chunks */
+#define AY_BINCHUNKOBJ "OBJ "
+
+/** object data is text encoded */
+#define AY_BINENCTEXT 0
+
+/** object data is binary encoded */
+#define AY_BINENCBIN 1
+
+
+/* types local to this module */
+
+/** object data not loaded yet (payload of LZ tags) */
+typedef struct ay_binlazy_s
+{
+  ay_binfile *bf; /**< mapped file (shared, see ay_binfile.refcount) */
+  size_t pos; /**< start of object data in bf */
+  size_t end; /**< end of object data in bf */
+  double bbox[24]; /**< bounding box of the object */
+} ay_binlazy;
+
+
+/* prototypes of functions local to this module */
+
+int ay_bin_islittle(void);
+
+void ay_bin_swap(unsigned char *p, int size, size_t cnt);
+
+int ay_bin_reserve(ay_binfile *bf, size_t n);
+
+int ay_bin_map(FILE *fileptr, ay_binfile *bf);
+
+void ay_bin_unmap(ay_binfile *bf);
+
+int ay_bin_readsize(ay_binfile *bf, size_t *result);
+
+int ay_bin_writeattributes(ay_binfile *bf, ay_object *o);
+
+int ay_bin_writetags(ay_binfile *bf, ay_object *o);
+
+int ay_bin_readattributes(ay_binfile *bf, ay_object *o);
+
+int ay_bin_readtags(ay_binfile *bf, ay_object *o);
+
+int ay_bin_readobject(ay_binfile *bf);
+
+void ay_bin_unref(ay_binfile *bf);
+
+ay_tag *ay_bin_findlz(ay_object *o, int unlink);
+
+int ay_bin_defer(ay_binfile *bf, ay_object *o, double *bbox);
+
+
+/* functions */
+
+/** ay_bin_register:
+ * register binary read and write callbacks
+ *
+ * \param[in] rcb  binary read callback
+ * \param[in] wcb  binary write callback
+ * \param[in] type_id  object type for which to register the callbacks
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_register(ay_breadcb *rcb, ay_bwritecb *wcb, unsigned int type_id)
+{
+ int ay_status = AY_OK;
+
+  ay_status = ay_table_addcallback(&ay_breadcbt, (ay_voidfp)rcb, type_id);
+
+  if(!ay_status)
+    ay_status = ay_table_addcallback(&ay_bwritecbt, (ay_voidfp)wcb,
+				     type_id);
+
+ return ay_status;
+} /* ay_bin_register */
+
+
+/** ay_bin_islittle:
+ * check byte order of the machine
+ *
+ * \returns AY_TRUE if the machine is little endian
+ */
+int
+ay_bin_islittle(void)
+{
+ unsigned int one = 1;
+
+ return (*((unsigned char *)&one) == 1);
+} /* ay_bin_islittle */
+
+
+/** ay_bin_swap:
+ * reverse the byte order of \a cnt numbers of size \a size
+ *
+ * \param[in,out] p  numbers to process
+ * \param[in] size  size of a number (4 or 8)
+ * \param[in] cnt  number of numbers
+ */
+void
+ay_bin_swap(unsigned char *p, int size, size_t cnt)
+{
+ size_t i;
+ int j;
+ unsigned char t;
+
+  for(i = 0; i < cnt; i++)
+    {
+      for(j = 0; j < size/2; j++)
+	{
+	  t = p[j];
+	  p[j] = p[size-1-j];
+	  p[size-1-j] = t;
+	}
+      p += size;
+    }
+
+ return;
+} /* ay_bin_swap */
+
+
+/** ay_bin_reserve:
+ * make room for \a n more bytes in the chunk buffer
+ *
+ * \param[in,out] bf  binary file to process
+ * \param[in] n  number of bytes to write next
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_reserve(ay_binfile *bf, size_t n)
+{
+ unsigned char *t;
+ size_t newsize;
+
+  if(bf->pos + n <= bf->size)
+    return AY_OK;
+
+  newsize = bf->size?bf->size*2:4096;
+  while(newsize < bf->pos + n)
+    newsize *= 2;
+
+  if(!(t = realloc(bf->data, newsize)))
+    return AY_EOMEM;
+
+  bf->data = t;
+  bf->size = newsize;
+
+ return AY_OK;
+} /* ay_bin_reserve */
+
+
+/** ay_bin_hashinit:
+ * prepare a binary file without scene file for hashing, i.e. set
+ * the offset basis of the content hash (see ay_bin_flush())
+ *
+ * \param[in,out] bf  binary file to process
+ */
+void
+ay_bin_hashinit(ay_binfile *bf)
+{
+
+  bf->fileptr = NULL;
+  bf->hash[0] = 0xcbf29ce4U;
+  bf->hash[1] = 0x84222325U;
+  bf->hash[2] = 0;
+
+ return;
+} /* ay_bin_hashinit */
+
+
+/** ay_bin_flush:
+ * write the chunk buffer to the file;
+ * if there is no file, the chunk is folded into the content hash
+ * instead (see ay_wrib_cachename()): a 64 bit FNV-1a hash (computed
+ * with 32 bit arithmetic in hash[0] (high) and hash[1] (low)) and
+ * an independent sdbm check sum (hash[2]) to detect collisions
+ *
+ * \param[in,out] bf  binary file to process
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_flush(ay_binfile *bf)
+{
+ size_t i;
+ unsigned int hi, lo, p0, p1, c;
+
+  if(bf->pos)
+    {
+      if(!bf->fileptr)
+	{
+	  hi = bf->hash[0];
+	  lo = bf->hash[1];
+	  c = bf->hash[2];
+	  for(i = 0; i < bf->pos; i++)
+	    {
+	      lo ^= bf->data[i];
+	      /* multiply by the FNV prime 2^40 + 0x1b3 */
+	      p0 = (lo & 0xffffU) * 0x1b3U;
+	      p1 = (lo >> 16) * 0x1b3U + (p0 >> 16);
+	      hi = (hi * 0x1b3U + (p1 >> 16) + (lo << 8)) & 0xffffffffU;
+	      lo = ((p1 << 16) | (p0 & 0xffffU)) & 0xffffffffU;
+
+	      c = bf->data[i] + (c << 6) + (c << 16) - c;
+	    }
+	  bf->hash[0] = hi;
+	  bf->hash[1] = lo;
+	  bf->hash[2] = c & 0xffffffffU;
+	}
+      else
+	{
+	  if(fwrite(bf->data, 1, bf->pos, bf->fileptr) != bf->pos)
+	    return AY_ERROR;
+	}
+    }
+
+  bf->pos = 0;
+
+ return AY_OK;
+} /* ay_bin_flush */
+
+
+/** ay_bin_writeint:
+ * write an integer
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] i  integer to write
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writeint(ay_binfile *bf, int i)
+{
+ unsigned int u = (unsigned int)i;
+
+ return ay_bin_writeuints(bf, 1, &u);
+} /* ay_bin_writeint */
+
+
+/** ay_bin_writeuints:
+ * write an array of 32 bit unsigned integers
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] n  number of integers to write
+ * \param[in] v  integers to write [n]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writeuints(ay_binfile *bf, size_t n, unsigned int *v)
+{
+ int ay_status;
+ unsigned char *p;
+ size_t i;
+
+  if(!n)
+    return AY_OK;
+
+  if((ay_status = ay_bin_reserve(bf, n*4)))
+    return ay_status;
+
+  p = &(bf->data[bf->pos]);
+
+  if(ay_bin_islittle() && sizeof(unsigned int) == 4)
+    {
+      memcpy(p, v, n*4);
+    }
+  else
+    {
+      for(i = 0; i < n; i++)
+	{
+	  p[0] = (unsigned char)(v[i] & 0xff);
+	  p[1] = (unsigned char)((v[i] >> 8) & 0xff);
+	  p[2] = (unsigned char)((v[i] >> 16) & 0xff);
+	  p[3] = (unsigned char)((v[i] >> 24) & 0xff);
+	  p += 4;
+	}
+    }
+
+  bf->pos += n*4;
+
+ return AY_OK;
+} /* ay_bin_writeuints */
+
+
+/** ay_bin_writedoubles:
+ * write an array of doubles
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] n  number of doubles to write
+ * \param[in] v  doubles to write [n]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writedoubles(ay_binfile *bf, size_t n, double *v)
+{
+ int ay_status;
+
+  if(!n)
+    return AY_OK;
+
+  if((ay_status = ay_bin_reserve(bf, n*sizeof(double))))
+    return ay_status;
+
+  memcpy(&(bf->data[bf->pos]), v, n*sizeof(double));
+
+  if(!ay_bin_islittle())
+    ay_bin_swap(&(bf->data[bf->pos]), sizeof(double), n);
+
+  bf->pos += n*sizeof(double);
+
+ return AY_OK;
+} /* ay_bin_writedoubles */
+
+
+/** ay_bin_writestring:
+ * write a string
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] str  string to write (may be NULL)
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writestring(ay_binfile *bf, char *str)
+{
+ int ay_status;
+ unsigned int len = 0;
+
+  if(str)
+    len = (unsigned int)strlen(str);
+
+  if((ay_status = ay_bin_writeuints(bf, 1, &len)))
+    return ay_status;
+
+  if(len)
+    {
+      if((ay_status = ay_bin_reserve(bf, len)))
+	return ay_status;
+      memcpy(&(bf->data[bf->pos]), str, len);
+      bf->pos += len;
+    }
+
+ return AY_OK;
+} /* ay_bin_writestring */
+
+
+/** ay_bin_readint:
+ * read an integer
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in,out] result  where to store the integer
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readint(ay_binfile *bf, int *result)
+{
+ int ay_status;
+ unsigned int u = 0;
+
+  if(!(ay_status = ay_bin_readuints(bf, 1, &u)))
+    *result = (int)u;
+
+ return ay_status;
+} /* ay_bin_readint */
+
+
+/** ay_bin_readuints:
+ * read an array of 32 bit unsigned integers
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in] n  number of integers to read
+ * \param[in,out] result  where to store the integers [n]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readuints(ay_binfile *bf, size_t n, unsigned int *result)
+{
+ unsigned char *p;
+ size_t i;
+
+  if(n > (bf->end - bf->pos)/4)
+    return AY_EUEOF;
+
+  p = &(bf->data[bf->pos]);
+
+  if(ay_bin_islittle() && sizeof(unsigned int) == 4)
+    {
+      memcpy(result, p, n*4);
+    }
+  else
+    {
+      for(i = 0; i < n; i++)
+	{
+	  result[i] = (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+	    ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+	  p += 4;
+	}
+    }
+
+  bf->pos += n*4;
+
+ return AY_OK;
+} /* ay_bin_readuints */
+
+
+/** ay_bin_readdoubles:
+ * read an array of doubles
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in] n  number of doubles to read
+ * \param[in,out] result  where to store the doubles [n]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readdoubles(ay_binfile *bf, size_t n, double *result)
+{
+
+  if(n > (bf->end - bf->pos)/sizeof(double))
+    return AY_EUEOF;
+
+  memcpy(result, &(bf->data[bf->pos]), n*sizeof(double));
+
+  if(!ay_bin_islittle())
+    ay_bin_swap((unsigned char*)result, sizeof(double), n);
+
+  bf->pos += n*sizeof(double);
+
+ return AY_OK;
+} /* ay_bin_readdoubles */
+
+
+/** ay_bin_readstring:
+ * read a string; empty strings are not returned
+ * (same as ay_read_string())
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in,out] result  where to store the new string
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readstring(ay_binfile *bf, char **result)
+{
+ int ay_status;
+ unsigned int len = 0;
+
+  if((ay_status = ay_bin_readuints(bf, 1, &len)))
+    return ay_status;
+
+  if(len > bf->end - bf->pos)
+    return AY_EUEOF;
+
+  if(len)
+    {
+      if(!(*result = malloc((len+1)*sizeof(char))))
+	return AY_EOMEM;
+      memcpy(*result, &(bf->data[bf->pos]), len);
+      (*result)[len] = '\0';
+      bf->pos += len;
+    }
+
+ return AY_OK;
+} /* ay_bin_readstring */
+
+
+/** ay_bin_readsize:
+ * read a 64 bit size
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in,out] result  where to store the size
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readsize(ay_binfile *bf, size_t *result)
+{
+ int ay_status;
+ unsigned int lh[2];
+
+  if((ay_status = ay_bin_readuints(bf, 2, lh)))
+    return ay_status;
+
+  if(sizeof(size_t) < 8)
+    {
+      if(lh[1])
+	return AY_EFORMAT;
+      *result = (size_t)lh[0];
+    }
+  else
+    {
+      /* shift in two steps to keep compilers with 32 bit size_t quiet */
+      *result = (((size_t)lh[1] << 16) << 16) | (size_t)lh[0];
+    }
+
+ return AY_OK;
+} /* ay_bin_readsize */
+
+
+/** ay_bin_map:
+ * map a complete file into memory
+ * (falls back to reading the file, if mapping is not possible)
+ *
+ * \param[in] fileptr  file to map
+ * \param[in,out] bf  where to store the mapping
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_map(FILE *fileptr, ay_binfile *bf)
+{
+#ifdef WIN32
+ HANDLE h, m;
+ LARGE_INTEGER s;
+
+  h = (HANDLE)_get_osfhandle(_fileno(fileptr));
+
+  if(!GetFileSizeEx(h, &s))
+    return AY_ERROR;
+
+  if((sizeof(size_t) < 8) && s.HighPart)
+    return AY_EOMEM;
+
+  bf->size = (size_t)s.QuadPart;
+
+  if((m = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL)))
+    {
+      /* the view keeps the mapping alive */
+      bf->data = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(m);
+    }
+#else
+ struct stat st;
+ void *p;
+
+  if(fstat(fileno(fileptr), &st))
+    return AY_ERROR;
+
+  bf->size = (size_t)st.st_size;
+
+  if(bf->size)
+    {
+      p = mmap(NULL, bf->size, PROT_READ, MAP_PRIVATE, fileno(fileptr), 0);
+      if(p != MAP_FAILED)
+	{
+	  bf->data = p;
+	  (void)madvise(p, bf->size, MADV_SEQUENTIAL);
+	}
+    }
+#endif
+
+  if(bf->data)
+    {
+      bf->mapped = AY_TRUE;
+      return AY_OK;
+    }
+
+  /* mapping failed, read the file instead */
+  if(!(bf->data = malloc(bf->size?bf->size:1)))
+    return AY_EOMEM;
+
+  rewind(fileptr);
+  if(fread(bf->data, 1, bf->size, fileptr) != bf->size)
+    {
+      free(bf->data);
+      bf->data = NULL;
+      return AY_EUEOF;
+    }
+
+ return AY_OK;
+} /* ay_bin_map */
+
+
+/** ay_bin_unmap:
+ * release the memory of a file mapped by ay_bin_map()
+ *
+ * \param[in,out] bf  binary file to process
+ */
+void
+ay_bin_unmap(ay_binfile *bf)
+{
+
+  if(!bf->data)
+    return;
+
+  if(bf->mapped)
+    {
+#ifdef WIN32
+      UnmapViewOfFile(bf->data);
+#else
+      munmap(bf->data, bf->size);
+#endif
+    }
+  else
+    {
+      free(bf->data);
+    }
+
+  bf->data = NULL;
+  bf->mapped = AY_FALSE;
+
+ return;
+} /* ay_bin_unmap */
+
+
+/** ay_bin_writeheader:
+ * write the binary scene file header
+ *
+ * \param[in,out] bf  binary file to write to
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writeheader(ay_binfile *bf)
+{
+ int ay_status = AY_OK;
+
+  bf->pos = 0;
+
+  if((ay_status = ay_bin_reserve(bf, AY_BINMAGICLEN)))
+    return ay_status;
+
+  memcpy(bf->data, AY_BINMAGIC, AY_BINMAGICLEN);
+  bf->pos = AY_BINMAGICLEN;
+
+  ay_status = ay_bin_writeint(bf, AY_BINVERSION);
+  ay_status += ay_bin_writeint(bf, AY_BINTEXTVERSION);
+  ay_status += ay_bin_writestring(bf, AY_VERSIONSTR);
+
+  if(ay_status)
+    return AY_ERROR;
+
+ return ay_bin_flush(bf);
+} /* ay_bin_writeheader */
+
+
+/** ay_bin_writeattributes:
+ * write the standard attributes of an object;
+ * the transformation attributes are omitted when hashing
+ * (see ay_bin_writeobject())
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] o  object to process
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writeattributes(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ double trafos[13];
+
+  if(bf->fileptr)
+    {
+      trafos[0] = o->movx;
+  trafos[1] = o->movy;
+  trafos[2] = o->movz;
+  trafos[3] = o->rotx;
+  trafos[4] = o->roty;
+  trafos[5] = o->rotz;
+  memcpy(&(trafos[6]), o->quat, 4*sizeof(double));
+  trafos[10] = o->scalx;
+  trafos[11] = o->scaly;
+      trafos[12] = o->scalz;
+
+      ay_status = ay_bin_writedoubles(bf, 13, trafos);
+    }
+
+  ay_status += ay_bin_writeint(bf, o->parent);
+  ay_status += ay_bin_writeint(bf, o->inherit_trafos);
+  ay_status += ay_bin_writeint(bf, o->hide);
+  ay_status += ay_bin_writeint(bf, o->hide_children);
+  ay_status += ay_bin_writestring(bf, o->name);
+
+  if(ay_status)
+    return AY_ERROR;
+
+ return AY_OK;
+} /* ay_bin_writeattributes */
+
+
+/** ay_bin_writetags:
+ * write the tags of an object
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] o  object to process
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writetags(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_tag *tag;
+ int tcount = 0;
+
+  /* count tags */
+  tag = o->tags;
+  while(tag)
+    {
+      if(tag->name && tag->val && !tag->is_intern && !tag->is_binary)
+	tcount++;
+      tag = tag->next;
+    }
+
+  ay_status = ay_bin_writeint(bf, tcount);
+
+  /* write tags */
+  tag = o->tags;
+  while(tag && !ay_status)
+    {
+      if(tag->name && tag->val && !tag->is_intern && !tag->is_binary)
+	{
+	  ay_status = ay_bin_writestring(bf, tag->name);
+	  ay_status += ay_bin_writestring(bf, (char*)tag->val);
+	}
+      tag = tag->next;
+    }
+
+  if(ay_status)
+    return AY_ERROR;
+
+ return AY_OK;
+} /* ay_bin_writetags */
+
+
+/** ay_bin_writeobject:
+ * write an object (and its children) to a binary scene file;
+ * if there is no scene file, only the object itself (without children
+ * and transformation attributes) is folded into the content hash of \a bf
+ * (the RIB archive cache combines the hashes of the children itself,
+ * see ay_wrib_cachehier())
+ *
+ * \param[in,out] bf  binary file to write to
+ * \param[in] o  object to write
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_writeobject(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ char fname[] = "bin_writeobject";
+ ay_bwritecb *bcb = NULL;
+ ay_writecb *cb = NULL;
+ ay_object *down = NULL;
+ unsigned int lh[2];
+ long len;
+ size_t start;
+ double bbox[24];
+
+  if(!o)
+    return AY_OK;
+
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
+  /* chunk header, the length is filled in below */
+  bf->pos = 0;
+  if((ay_status = ay_bin_reserve(bf, 4)))
+    return ay_status;
+  memcpy(bf->data, AY_BINCHUNKOBJ, 4);
+  bf->pos = 4;
+  lh[0] = 0;
+  lh[1] = 0;
+  if((ay_status = ay_bin_writeuints(bf, 2, lh)))
+    return ay_status;
+  start = bf->pos;
+
+  if(o->type < AY_IDLAST)
+    {
+      ay_status = ay_bin_writeint(bf, 0);
+      ay_status += ay_bin_writeint(bf, (int)o->type);
+    }
+  else
+    {
+      ay_status = ay_bin_writeint(bf, 1);
+      ay_status += ay_bin_writestring(bf, ay_object_gettypename(o->type));
+    }
+
+  ay_status += ay_bin_writeint(bf, (o->down && o->down->next)?1:0);
+
+  if(ay_status)
+    return AY_ERROR;
+
+  ay_status = ay_bin_writeattributes(bf, o);
+
+  if(ay_status)
+    {
+      ay_error(ay_status, fname, "error saving attributes");
+      return AY_ERROR;
+    }
+
+  ay_status = ay_bin_writetags(bf, o);
+
+  if(ay_status)
+    {
+      ay_error(ay_status, fname, "error saving tags");
+      return AY_ERROR;
+    }
+
+  if(o->type < ay_bwritecbt.size)
+    bcb = (ay_bwritecb *)(ay_bwritecbt.arr[o->type]);
+
+  if(bcb)
+    {
+      ay_status = ay_bin_writeint(bf, AY_BINENCBIN);
+      if(!ay_bbc_get(o, bbox))
+	{
+	  ay_status += ay_bin_writeint(bf, 1);
+	  ay_status += ay_bin_writedoubles(bf, 24, bbox);
+	}
+      else
+	{
+	  ay_status += ay_bin_writeint(bf, 0);
+	}
+      if(!ay_status)
+	ay_status = bcb(bf, o);
+    }
+  else
+    {
+      ay_status = ay_bin_writeint(bf, AY_BINENCTEXT);
+      cb = (ay_writecb *)(ay_writecbt.arr[o->type]);
+      if(cb && !ay_status)
+	{
+	  /* let the write callback write to a temporary file,
+	     then copy its output into the chunk */
+	  if(!bf->tmp && !(bf->tmp = tmpfile()))
+	    {
+	      ay_error(AY_EOPENFILE, fname, "could not create temporary file");
+	      return AY_ERROR;
+	    }
+	  rewind(bf->tmp);
+	  ay_status = cb(bf->tmp, o);
+	  len = ftell(bf->tmp);
+	  rewind(bf->tmp);
+	  if(!ay_status && len > 0)
+	    {
+	      ay_status = ay_bin_reserve(bf, (size_t)len);
+	      if(!ay_status)
+		{
+		  if(fread(&(bf->data[bf->pos]), 1, (size_t)len, bf->tmp) !=
+		     (size_t)len)
+		    ay_status = AY_ERROR;
+		  bf->pos += (size_t)len;
+		}
+	    }
+	} /* if */
+    } /* if */
+
+  if(ay_status)
+    {
+      ay_error(ay_status, fname, "write callback failed");
+      return AY_ERROR;
+    }
+
+  /* fill in the chunk length */
+  lh[0] = (unsigned int)((bf->pos - start) & 0xffffffff);
+  lh[1] = (unsigned int)(((bf->pos - start) >> 16) >> 16);
+  start = bf->pos;
+  bf->pos = 4;
+  (void)ay_bin_writeuints(bf, 2, lh);
+  bf->pos = start;
+
+  if((ay_status = ay_bin_flush(bf)))
+    {
+      ay_error(ay_status, fname, strerror(errno));
+      return AY_ERROR;
+    }
+
+  /* write children */
+  if(bf->fileptr && o->down && o->down->next)
+    {
+      down = o->down;
+      while(down)
+	{
+	  ay_status = ay_bin_writeobject(bf, down);
+	  if(ay_status)
+	    {
+	      return ay_status;
+	    }
+	  down = down->next;
+	}
+    }
+
+ return ay_status;
+} /* ay_bin_writeobject */
+
+
+/** ay_bin_close:
+ * release all resources of a binary file
+ * (but do not close the scene file itself)
+ *
+ * \param[in,out] bf  binary file to process
+ */
+void
+ay_bin_close(ay_binfile *bf)
+{
+
+  if(bf->tmp)
+    fclose(bf->tmp);
+  bf->tmp = NULL;
+
+  if(bf->mapped)
+    {
+      ay_bin_unmap(bf);
+    }
+  else
+    {
+      if(bf->data)
+	free(bf->data);
+      bf->data = NULL;
+    }
+
+  bf->size = 0;
+  bf->pos = 0;
+  bf->end = 0;
+
+ return;
+} /* ay_bin_close */
+
+
+/** ay_bin_readattributes:
+ * read the standard attributes of an object
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in,out] o  object to process
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readattributes(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ double trafos[13];
+
+  if((ay_status = ay_bin_readdoubles(bf, 13, trafos)))
+    return ay_status;
+
+  o->movx = trafos[0];
+  o->movy = trafos[1];
+  o->movz = trafos[2];
+  o->rotx = trafos[3];
+  o->roty = trafos[4];
+  o->rotz = trafos[5];
+  memcpy(o->quat, &(trafos[6]), 4*sizeof(double));
+  o->scalx = trafos[10];
+  o->scaly = trafos[11];
+  o->scalz = trafos[12];
+
+  ay_quat_norm(o->quat);
+
+  if((ay_status = ay_bin_readint(bf, &o->parent)))
+    return ay_status;
+  if((ay_status = ay_bin_readint(bf, &o->inherit_trafos)))
+    return ay_status;
+  if((ay_status = ay_bin_readint(bf, &o->hide)))
+    return ay_status;
+  if((ay_status = ay_bin_readint(bf, &o->hide_children)))
+    return ay_status;
+
+  ay_status = ay_bin_readstring(bf, &(o->name));
+
+ return ay_status;
+} /* ay_bin_readattributes */
+
+
+/** ay_bin_readtags:
+ * read the tags of an object
+ *
+ * \param[in,out] bf  binary file to read from
+ * \param[in,out] o  object to process
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readtags(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_tag *tag = NULL, **next = NULL;
+ int tcount = 0, i = 0;
+
+  if((ay_status = ay_bin_readint(bf, &tcount)))
+    return ay_status;
+
+  next = &(o->tags);
+
+  for(i = 0; i < tcount; i++)
+    {
+      if(!(tag = calloc(1, sizeof(ay_tag))))
+	return AY_EOMEM;
+
+      ay_status = ay_bin_readstring(bf, &(tag->name));
+
+      if(!ay_status && !tag->name)
+	ay_status = AY_ERROR;
+
+      if(!ay_status)
+	ay_status = ay_bin_readstring(bf, (char**)(void*)&(tag->val));
+
+      /* avoid null value */
+      if(!ay_status && !tag->val)
+	{
+	  if(!(tag->val = calloc(1, sizeof(char))))
+	    ay_status = AY_EOMEM;
+	}
+
+      if(!ay_status)
+	ay_status = ay_read_tagtype(tag);
+
+      if(ay_status)
+	{
+	  ay_tags_free(tag);
+	  return ay_status;
+	}
+
+      *next = tag;
+      next = &(tag->next);
+    } /* for */
+
+ return AY_OK;
+} /* ay_bin_readtags */
+
+
+/** ay_bin_readobject:
+ * read the next chunk from a binary scene file and, if it is
+ * an object, link the object to the scene
+ *
+ * \param[in,out] bf  binary file to read from
+ *
+ * \returns AY_OK on success, AY_EEOF at the end of the file,
+ *  error code otherwise.
+ */
+int
+ay_bin_readobject(ay_binfile *bf)
+{
+ int ay_status = AY_OK;
+ char fname[] = "bin_readobject";
+ int has_typename = 0, has_child = 0, encoding = 0;
+ unsigned int type = 0;
+ ay_object *o = NULL;
+ ay_tag tag = {0};
+ ay_breadcb *bcb = NULL;
+ ay_readcb *cb = NULL;
+ char *typename = NULL;
+ size_t len, end;
+ int is_obj, has_bbox = AY_FALSE, defer = AY_FALSE;
+ double bbox[24];
+
+  if(bf->pos == bf->size)
+    return AY_EEOF;
+
+  /* read chunk header */
+  bf->end = bf->size;
+  if(bf->size - bf->pos < 12)
+    return AY_EUEOF;
+
+  is_obj = !memcmp(&(bf->data[bf->pos]), AY_BINCHUNKOBJ, 4);
+  bf->pos += 4;
+
+  if((ay_status = ay_bin_readsize(bf, &len)))
+    return ay_status;
+
+  if(len > bf->size - bf->pos)
+    return AY_EUEOF;
+
+  end = bf->pos + len;
+
+  if(!is_obj)
+    {
+      /* skip unknown chunk */
+      bf->pos = end;
+      return AY_OK;
+    }
+
+  bf->end = end;
+
+  if(!(o = calloc(1, sizeof(ay_object))))
+    return AY_EOMEM;
+
+  ay_object_defaults(o);
+
+  /* get type of object */
+  if((ay_status = ay_bin_readint(bf, &has_typename)))
+    goto cleanup;
+
+  if(has_typename)
+    {
+      ay_status = ay_bin_readstring(bf, &typename);
+      if(ay_status)
+	goto cleanup;
+
+      if(!typename)
+	{ ay_status = AY_ERROR; goto cleanup; }
+
+      ay_status = ay_read_gettype(typename, &type);
+      free(typename);
+      if(ay_status)
+	{
+	  /* skip object of unknown type */
+	  ay_status = AY_OK;
+	  goto cleanup;
+	}
+    }
+  else
+    {
+      if((ay_status = ay_bin_readuints(bf, 1, &type)))
+	goto cleanup;
+    } /* if */
+
+  if(type >= ay_readcbt.size)
+    {
+      ay_status = AY_EFORMAT;
+      goto cleanup;
+    }
+
+  o->type = type;
+
+  if((ay_status = ay_bin_readint(bf, &has_child)))
+    goto cleanup;
+
+  if((ay_status = ay_bin_readattributes(bf, o)))
+    goto cleanup;
+
+  if((ay_status = ay_bin_readtags(bf, o)))
+    goto cleanup;
+
+  if((ay_status = ay_bin_readint(bf, &encoding)))
+    goto cleanup;
+
+  /* inform object to read that there follow children;
+     this, currently, is only interesting for views */
+  if(has_child)
+    {
+      tag.type = ay_hc_tagtype;
+      tag.next = o->tags;
+      o->tags = &tag;
+    }
+
+  /* get and execute read callback */
+  if(encoding == AY_BINENCBIN)
+    {
+      if(bf->version > 1)
+	{
+	  ay_status = ay_bin_readint(bf, &has_bbox);
+	  if(!ay_status && has_bbox)
+	    ay_status = ay_bin_readdoubles(bf, 24, bbox);
+	}
+      if(type < ay_breadcbt.size)
+	bcb = (ay_breadcb *)(ay_breadcbt.arr[type]);
+      if(!bcb)
+	ay_status = AY_EFORMAT;
+      if(!ay_status)
+	{
+	  /* masters of instances are loaded right away,
+	     as instances access their data directly */
+	  if(has_bbox && ay_prefs.lazyload &&
+	     !ay_tags_hastag(o, ay_oi_tagtype))
+	    defer = AY_TRUE;
+	  else
+	    ay_status = bcb(bf, o);
+	}
+    }
+  else
+    {
+      cb = (ay_readcb *)(ay_readcbt.arr[type]);
+      if(cb)
+	{
+	  /* the text encoded data directly follows in the file */
+#ifdef WIN32
+	  if(_fseeki64(bf->fileptr, (__int64)bf->pos, SEEK_SET))
+#else
+	  if(fseeko(bf->fileptr, (off_t)bf->pos, SEEK_SET))
+#endif
+	    ay_status = AY_ERROR;
+	  else
+	    ay_status = cb(bf->fileptr, o);
+	}
+    }
+
+  /* restore tags */
+  if(has_child)
+    {
+      o->tags = tag.next;
+    }
+
+  if(defer)
+    ay_status = ay_bin_defer(bf, o, bbox);
+
+  if(ay_status)
+    {
+      if(ay_status == AY_EDONOTLINK)
+	{
+	  ay_status = AY_OK;
+	}
+      else
+	{
+	  ay_error(ay_status, fname, NULL);
+	  ay_error(AY_ERROR, fname, "read callback failed");
+	}
+      goto cleanup;
+    } /* if */
+
+  ay_read_linkobject(o, has_child);
+  o = NULL;
+
+cleanup:
+
+  if(o)
+    ay_object_delete(o);
+
+  /* continue with the next chunk in any case */
+  bf->pos = end;
+
+ return ay_status;
+} /* ay_bin_readobject */
+
+
+/** ay_bin_isbinary:
+ * check whether a scene file is a binary scene file;
+ * if it is not, the file position is reset to the start of the file
+ *
+ * \param[in] fileptr  scene file to check
+ *
+ * \returns AY_TRUE if the file is a binary scene file
+ */
+int
+ay_bin_isbinary(FILE *fileptr)
+{
+ char buf[AY_BINMAGICLEN];
+
+  if(fread(buf, 1, AY_BINMAGICLEN, fileptr) == AY_BINMAGICLEN &&
+     !memcmp(buf, AY_BINMAGIC, AY_BINMAGICLEN))
+    return AY_TRUE;
+
+  rewind(fileptr);
+
+ return AY_FALSE;
+} /* ay_bin_isbinary */
+
+
+/** ay_bin_readscene:
+ * read all objects from a binary scene file
+ * (see also ay_read_scene())
+ *
+ * \param[in] fileptr  scene file to read from
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_readscene(FILE *fileptr)
+{
+ int ay_status = AY_OK;
+ char fname[] = "read_scene";
+ ay_binfile *bf = NULL;
+ char *version_str = NULL;
+ size_t pos;
+
+  if(!fileptr)
+    return AY_ENULL;
+
+  /* the file may outlive this function (see ay_bin_defer()) */
+  if(!(bf = calloc(1, sizeof(ay_binfile))))
+    return AY_EOMEM;
+
+  bf->fileptr = fileptr;
+
+  if((ay_status = ay_bin_map(fileptr, bf)))
+    {
+      free(bf);
+      ay_error(ay_status, fname, "could not map file");
+      return AY_ERROR;
+    }
+
+  /* read header */
+  bf->pos = AY_BINMAGICLEN;
+  bf->end = bf->size;
+
+  ay_status = ay_bin_readint(bf, &bf->version);
+  if(!ay_status && bf->version > AY_BINVERSION)
+    {
+      ay_error(AY_ERROR, fname, "Unsupported binary scene file version!");
+      ay_status = AY_EFORMAT;
+    }
+  if(!ay_status)
+    ay_status = ay_bin_readint(bf, &ay_read_version);
+  if(!ay_status)
+    ay_status = ay_bin_readstring(bf, &version_str);
+
+  if(version_str)
+    free(version_str);
+
+  /* read objects */
+  while(!ay_status)
+    {
+      pos = bf->pos;
+      ay_status = ay_bin_readobject(bf);
+      if(ay_status)
+	{
+	  if(ay_status != AY_EEOF)
+	    {
+	      /* issue errmsg */
+	      ay_error(ay_status, fname, NULL);
+	      /* errors in a complete chunk are recoverable */
+	      if(ay_prefs.onerror && bf->pos > pos)
+		{
+		  ay_status = AY_OK;
+		} /* if */
+	    } /* if */
+	} /* if */
+    } /* while */
+
+  if(ay_status == AY_EEOF)
+    ay_status = AY_OK;
+
+  /* keep the mapping for deferred objects */
+  bf->fileptr = NULL;
+  bf->refcount++;
+  ay_bin_unref(bf);
+
+ return ay_status;
+} /* ay_bin_readscene */
+
+
+/** ay_bin_unref:
+ * release a reference to a mapped binary file;
+ * if it was the last, unmap and free the file
+ *
+ * \param[in,out] bf  binary file to release
+ */
+void
+ay_bin_unref(ay_binfile *bf)
+{
+
+  if(bf->refcount)
+    bf->refcount--;
+
+  if(!bf->refcount)
+    {
+      ay_bin_close(bf);
+      free(bf);
+    }
+
+ return;
+} /* ay_bin_unref */
+
+
+/** ay_bin_findlz:
+ * find the LZ tag of an object
+ *
+ * \param[in,out] o  object to search
+ * \param[in] unlink  if AY_TRUE, remove the tag from the object
+ *
+ * \returns the tag or NULL, if the object has no LZ tag
+ */
+ay_tag *
+ay_bin_findlz(ay_object *o, int unlink)
+{
+ ay_tag *tag, **prev;
+
+  prev = &(o->tags);
+  tag = o->tags;
+  while(tag)
+    {
+      if(tag->type == ay_lz_tagtype && tag->is_binary)
+	{
+	  if(unlink)
+	    {
+	      *prev = tag->next;
+	      tag->next = NULL;
+	    }
+	  return tag;
+	}
+      prev = &(tag->next);
+      tag = tag->next;
+    }
+
+ return NULL;
+} /* ay_bin_findlz */
+
+
+/** ay_bin_defer:
+ * remember where the data of an object is located in a mapped file,
+ * so that the data may be loaded later by ay_bin_load()
+ *
+ * \param[in,out] bf  binary file, positioned at the object data
+ * \param[in,out] o  object to process
+ * \param[in] bbox  bounding box of the object [24]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_defer(ay_binfile *bf, ay_object *o, double *bbox)
+{
+ ay_binlazy *lz = NULL;
+ ay_tag *tag = NULL;
+
+  if(!(lz = malloc(sizeof(ay_binlazy))))
+    return AY_EOMEM;
+
+  lz->bf = bf;
+  lz->pos = bf->pos;
+  lz->end = bf->end;
+  memcpy(lz->bbox, bbox, 24*sizeof(double));
+
+  if(!(tag = calloc(1, sizeof(ay_tag))))
+    {
+      free(lz);
+      return AY_EOMEM;
+    }
+
+  tag->type = ay_lz_tagtype;
+  tag->is_intern = AY_TRUE;
+  tag->is_binary = AY_TRUE;
+
+  if(!(tag->val = malloc(sizeof(ay_btval))))
+    {
+      free(tag);
+      free(lz);
+      return AY_EOMEM;
+    }
+
+  ((ay_btval*)tag->val)->size = sizeof(ay_binlazy);
+  ((ay_btval*)tag->val)->payload = lz;
+
+  tag->next = o->tags;
+  o->tags = tag;
+
+  bf->refcount++;
+
+ return AY_OK;
+} /* ay_bin_defer */
+
+
+/** ay_bin_islazy:
+ * check whether the data of an object has not been loaded yet
+ *
+ * \param[in] o  object to check
+ *
+ * \returns AY_TRUE if the object data still needs to be loaded
+ */
+int
+ay_bin_islazy(ay_object *o)
+{
+
+  if(!o || o->refine)
+    return AY_FALSE;
+
+ return ay_bin_findlz(o, AY_FALSE)?AY_TRUE:AY_FALSE;
+} /* ay_bin_islazy */
+
+
+/** ay_bin_getbbox:
+ * get the bounding box of an object whose data has not been loaded yet
+ *
+ * \param[in] o  object to process
+ * \param[in,out] bbox  where to store the bounding box [24]
+ *
+ * \returns AY_OK on success, AY_ERROR if the object is loaded already.
+ */
+int
+ay_bin_getbbox(ay_object *o, double *bbox)
+{
+ ay_tag *tag;
+
+  if(!o || !bbox)
+    return AY_ENULL;
+
+  if(o->refine || !(tag = ay_bin_findlz(o, AY_FALSE)))
+    return AY_ERROR;
+
+  memcpy(bbox, ((ay_binlazy*)((ay_btval*)tag->val)->payload)->bbox,
+	 24*sizeof(double));
+
+ return AY_OK;
+} /* ay_bin_getbbox */
+
+
+/** ay_bin_load:
+ * load the data of an object that was read lazily from a binary
+ * scene file; does nothing for all other objects
+ *
+ * \param[in,out] o  object to process
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_bin_load(ay_object *o)
+{
+ int ay_status = AY_OK;
+ char fname[] = "bin_load";
+ ay_tag *tag = NULL;
+ ay_binlazy *lz = NULL;
+ ay_binfile bf;
+ ay_breadcb *cb = NULL;
+ ay_createcb *ccb = NULL;
+
+  if(!o)
+    return AY_ENULL;
+
+  if(!(tag = ay_bin_findlz(o, AY_TRUE)))
+    return AY_OK;
+
+  lz = (ay_binlazy*)((ay_btval*)tag->val)->payload;
+
+  if(!o->refine)
+    {
+      /* read from a private view of the shared mapping */
+      memcpy(&bf, lz->bf, sizeof(ay_binfile));
+      bf.fileptr = NULL;
+      bf.tmp = NULL;
+      bf.pos = lz->pos;
+      bf.end = lz->end;
+
+      cb = (ay_breadcb *)(ay_breadcbt.arr[o->type]);
+      ay_status = cb(&bf, o);
+    }
+
+  ay_bin_unref(lz->bf);
+  ay_tags_free(tag);
+
+  if(ay_status || !o->refine)
+    {
+      ay_error(ay_status, fname, "could not load object data");
+
+      /* avoid leaving an object without data in the scene */
+      ccb = (ay_createcb *)(ay_createcbt.arr[o->type]);
+      if(!o->refine && ccb)
+	(void)ccb(0, NULL, o);
+
+      return AY_ERROR;
+    }
+
+  (void)ay_notify_object(o);
+
+ return AY_OK;
+} /* ay_bin_load */
+
+
+/** ay_bin_loadall:
+ * load the data of all lazily read objects in a hierarchy
+ *
+ * \param[in,out] o  first object of the hierarchy to process
+ */
+void
+ay_bin_loadall(ay_object *o)
+{
+
+  while(o)
+    {
+      if(!o->refine)
+	(void)ay_bin_load(o);
+
+      if(o->down)
+	ay_bin_loadall(o->down);
+
+      o = o->next;
+    }
+
+ return;
+} /* ay_bin_loadall */
+
+
+/** ay_bin_loadlist:
+ * load the data of all lazily read objects in a list of objects
+ * (e.g. the selection) and their children
+ *
+ * \param[in,out] l  list of objects to process
+ */
+void
+ay_bin_loadlist(ay_list_object *l)
+{
+
+  while(l)
+    {
+      if(l->object)
+	{
+	  if(!l->object->refine)
+	    (void)ay_bin_load(l->object);
+
+	  if(l->object->down)
+	    ay_bin_loadall(l->object->down);
+	}
+      l = l->next;
+    }
+
+ return;
+} /* ay_bin_loadlist */
+
+
+/** ay_bin_release:
+ * forget about the data of a lazily read object, e.g. because the
+ * object is about to be deleted
+ *
+ * \param[in,out] o  object to process
+ */
+void
+ay_bin_release(ay_object *o)
+{
+ ay_tag *tag;
+
+  if(!o || !(tag = ay_bin_findlz(o, AY_TRUE)))
+    return;
+
+  ay_bin_unref(((ay_binlazy*)((ay_btval*)tag->val)->payload)->bf);
+  ay_tags_free(tag);
+
+ return;
+} /* ay_bin_release */
@@ -91,6 +91,8 @@ ay_clear_scene(void)
 
   ay_prefs.save_rootviews = AY_TRUE;
 
+  ay_notify_graphinvalidate();
+
  return AY_OK;
 } /* ay_clear_scene */
 
@@ -418,6 +418,8 @@ ay_clipb_replacetcmd(ClientData clientData, Tcl_Interp *interp,
   clipend->next = selend->next;
   selend->next = NULL;
 
+  ay_notify_graphinvalidate();
+
   /* notify new objects */
   clip = *presel;
   while(clip && clip != clipend)
@@ -1065,7 +1065,7 @@ ay_comp_pamesh(ay_object *o1, ay_object *o2)
 	return AY_FALSE;
     }
 
- return AY_OK;
+ return AY_TRUE;
 } /* ay_comp_pamesh */
 
 
@@ -1240,18 +1240,18 @@ ay_comp_pomesh(ay_object *o1, ay_object *o2)
 
   if(p1->has_normals)
     {
-      if(!memcmp(p1->controlv, p2->controlv,
+      if(memcmp(p1->controlv, p2->controlv,
 		 p1->ncontrols*6*sizeof(double)))
 	return AY_FALSE;
     }
   else
     {
-      if(!memcmp(p1->controlv, p2->controlv,
+      if(memcmp(p1->controlv, p2->controlv,
 		 p1->ncontrols*3*sizeof(double)))
 	return AY_FALSE;
     }
 
-  if(!memcmp(p1->nloops, p2->nloops, p1->npolys*sizeof(unsigned int)))
+  if(memcmp(p1->nloops, p2->nloops, p1->npolys*sizeof(unsigned int)))
     return AY_FALSE;
 
   for(i = 0; i < p1->npolys; i++)
@@ -1259,7 +1259,7 @@ ay_comp_pomesh(ay_object *o1, ay_object *o2)
       total_loops += p1->nloops[i];
     } /* for */
 
-  if(!memcmp(p1->nverts, p2->nverts, total_loops*sizeof(unsigned int)))
+  if(memcmp(p1->nverts, p2->nverts, total_loops*sizeof(unsigned int)))
     return AY_FALSE;
 
   for(i = 0; i < total_loops; i++)
@@ -1267,12 +1267,12 @@ ay_comp_pomesh(ay_object *o1, ay_object *o2)
       total_verts += p1->nverts[i];
     } /* for */
 
-  if(!memcmp(p1->verts, p2->verts, total_verts*sizeof(unsigned int)))
+  if(memcmp(p1->verts, p2->verts, total_verts*sizeof(unsigned int)))
     return AY_FALSE;
 
   if(p1->face_normals && p2->face_normals)
     {
-      if(!memcmp(p1->face_normals, p2->face_normals,
+      if(memcmp(p1->face_normals, p2->face_normals,
 		 p1->ncontrols*3*sizeof(double)))
 	return AY_FALSE;
     }
@@ -1305,10 +1305,10 @@ ay_comp_sdmesh(ay_object *o1, ay_object *o2)
   if(p1->ncontrols != p2->ncontrols)
     return AY_FALSE;
 
-  if(!memcmp(p1->controlv, p2->controlv, p1->ncontrols * 3 * sizeof(double)))
+  if(memcmp(p1->controlv, p2->controlv, p1->ncontrols * 3 * sizeof(double)))
     return AY_FALSE;
 
-  if(!memcmp(p1->nverts, p2->nverts, p1->nfaces * sizeof(unsigned int)))
+  if(memcmp(p1->nverts, p2->nverts, p1->nfaces * sizeof(unsigned int)))
     return AY_FALSE;
 
   for(i = 0; i < p1->nfaces; i++)
@@ -1316,7 +1316,7 @@ ay_comp_sdmesh(ay_object *o1, ay_object *o2)
       total_verts += p1->nverts[i];
     } /* for */
 
-  if(!memcmp(p1->verts, p2->verts, total_verts * sizeof(unsigned int)))
+  if(memcmp(p1->verts, p2->verts, total_verts * sizeof(unsigned int)))
     return AY_FALSE;
 
   /* XXXX compare the tags */
@@ -54,6 +54,9 @@ ay_convert_object(ay_object *o, int in_place)
   if(!o)
     return AY_ENULL;
 
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
   /* call the conversion callback */
   arr = ay_convertcbt.arr;
   cb = (ay_convertcb *)(arr[o->type]);
@@ -17,6 +17,160 @@
 void ay_draw_annos(struct Togl *togl, int draw_offset);
 
 
+/* ay_draw_cullbox:
+ *  draw the bounding box <bb> (xmin, xmax, ymin, ymax, zmin, zmax)
+ *  as stand-in of an object that is too small to be drawn
+ */
+void
+ay_draw_cullbox(double *bb)
+{
+
+  glPushAttrib(GL_ENABLE_BIT);
+  glDisable(GL_LIGHTING);
+
+  glBegin(GL_LINE_STRIP);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[2], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[2], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[3], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[3], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[2], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[2], (GLdouble)bb[5]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[2], (GLdouble)bb[5]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[3], (GLdouble)bb[5]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[3], (GLdouble)bb[5]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[2], (GLdouble)bb[5]);
+  glEnd();
+
+  glBegin(GL_LINES);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[2], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[2], (GLdouble)bb[5]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[3], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[1], (GLdouble)bb[3], (GLdouble)bb[5]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[3], (GLdouble)bb[4]);
+   glVertex3d((GLdouble)bb[0], (GLdouble)bb[3], (GLdouble)bb[5]);
+  glEnd();
+
+  glPopAttrib();
+
+ return;
+} /* ay_draw_cullbox */
+
+
+/* ay_draw_cullnames:
+ *  reset the OpenGL names of object <o> and its children,
+ *  so that culled objects can not be picked by stale names
+ */
+void
+ay_draw_cullnames(ay_object *o)
+{
+ ay_object *down;
+
+  o->glname = 0;
+
+  down = o->down;
+  while(down)
+    {
+      ay_draw_cullnames(down);
+      down = down->next;
+    }
+
+ return;
+} /* ay_draw_cullnames */
+
+
+/* ay_draw_cull:
+ *  check whether object <o> (whose transformations are already
+ *  applied to the current modelview matrix) and its children lie
+ *  completely outside of the view frustum of view <togl>;
+ *  if <selected> is AY_FALSE (normal drawing/shading) also check,
+ *  whether the object is smaller than CullSize pixels while an
+ *  action is active in the view
+ *  returns 0 if the object is to be drawn, 1 if it is to be culled,
+ *  and 2 if its bounding box (returned in <bb>) is to be drawn instead
+ */
+int
+ay_draw_cull(struct Togl *togl, ay_object *o, int selected, double *bb)
+{
+ ay_view_object *view = (ay_view_object *)Togl_GetClientData(togl);
+ GLdouble mm[16], pm[16];
+ double m[16], c[4], w, x, y, minx = DBL_MAX, maxx = -DBL_MAX,
+   miny = DBL_MAX, maxy = -DBL_MAX;
+ int i, j, out[6] = {0}, allw = AY_TRUE;
+
+  if(!ay_prefs.cullobjects)
+    return 0;
+
+  if(ay_bbc_getcull(o, bb))
+    return 0;
+
+  glGetDoublev(GL_MODELVIEW_MATRIX, mm);
+  glGetDoublev(GL_PROJECTION_MATRIX, pm);
+
+  /* m = pm * mm (column major) */
+  for(i = 0; i < 4; i++)
+    for(j = 0; j < 4; j++)
+      m[j*4+i] = pm[i]*mm[j*4] + pm[4+i]*mm[j*4+1] +
+	pm[8+i]*mm[j*4+2] + pm[12+i]*mm[j*4+3];
+
+  /* transform the corners to clip space and classify them
+     against the six planes of the frustum */
+  for(i = 0; i < 8; i++)
+    {
+      x = bb[(i&1)?1:0];
+      y = bb[(i&2)?3:2];
+      w = bb[(i&4)?5:4];
+      for(j = 0; j < 4; j++)
+	c[j] = m[j]*x + m[4+j]*y + m[8+j]*w + m[12+j];
+
+      if(c[0] < -c[3])
+	out[0]++;
+      if(c[0] > c[3])
+	out[1]++;
+      if(c[1] < -c[3])
+	out[2]++;
+      if(c[1] > c[3])
+	out[3]++;
+      if(c[2] < -c[3])
+	out[4]++;
+      if(c[2] > c[3])
+	out[5]++;
+
+      if(c[3] > AY_EPSILON)
+	{
+	  x = c[0]/c[3];
+	  y = c[1]/c[3];
+	  if(x < minx)
+	    minx = x;
+	  if(x > maxx)
+	    maxx = x;
+	  if(y < miny)
+	    miny = y;
+	  if(y > maxy)
+	    maxy = y;
+	}
+      else
+	{
+	  allw = AY_FALSE;
+	}
+    } /* for */
+
+  for(i = 0; i < 6; i++)
+    if(out[i] == 8)
+      return 1;
+
+  /* small feature culling (only while an action is active) */
+  if(selected == AY_FALSE && view->action_state && ay_prefs.cullsize > 0 &&
+     allw)
+    {
+      if((maxx-minx)*0.5*Togl_Width(togl) < ay_prefs.cullsize &&
+	 (maxy-miny)*0.5*Togl_Height(togl) < ay_prefs.cullsize)
+	return 2;
+    }
+
+ return 0;
+} /* ay_draw_cull */
+
+
 /* ay_draw_object:
  *  draw a single object o (and children) in view togl
  *  o if selected is AY_FALSE, selected objects
@@ -33,7 +187,8 @@ ay_draw_object(struct Togl *togl, ay_object *o, int selected)
  ay_voidfp *arr = NULL;
  ay_drawcb *cb = NULL;
  ay_object *down;
- double m[16];
+ double m[16], bb[6];
+ int cull;
 
   if(selected == AY_FALSE)
     if(o->selected)
@@ -52,6 +207,21 @@ ay_draw_object(struct Togl *togl, ay_object *o, int selected)
    glMultMatrixd((GLdouble*)m);
    glScaled((GLdouble)o->scalx, (GLdouble)o->scaly, (GLdouble)o->scalz);
 
+   if((cull = ay_draw_cull(togl, o, selected, bb)))
+     {
+       if(cull == 2)
+	 ay_draw_cullbox(bb);
+       else
+	 if(selected == 2)
+	   ay_draw_cullnames(o);
+       glPopMatrix();
+       return;
+     }
+
+   /* load lazily loaded objects only when they are actually drawn */
+   if(!o->refine)
+     (void)ay_bin_load(o);
+
    if(selected == AY_TRUE)
      {
        if(view->drawobjectcs)
@@ -120,6 +290,9 @@ ay_draw_view(struct Togl *togl, int draw_offset)
  ay_point *point = NULL;
  double m[16];
 
+  /* transformations may have changed since the last frame */
+  ay_bbc_cachenewframe();
+
   glDisable(GL_LIGHTING);
   glMatrixMode(GL_MODELVIEW);
 
@@ -352,7 +352,9 @@ ay_instt_createinstanceids(ay_object *o)
 
 
 /* ay_instt_wribiarchives:
- *  wrib instance archives
+ *  wrib instance archives;
+ *  if the RIB archive cache is active, the archives are named after
+ *  the content of the masters and only written if they do not exist
  *  End-Level-Terminators must be present (i.e. the objects must be
  *  properly linked to the scene).
  */
@@ -364,7 +366,7 @@ ay_instt_wribiarchives(char *file, ay_object *o)
  int down_is_prim = AY_FALSE;
  ay_object *down = NULL;
  ay_tag *tag = NULL;
- char *iafilename = NULL, *ext = NULL;
+ char *iafilename = NULL, *ext = NULL, *cachename = NULL;
  ay_voidfp *arr = NULL;
  ay_wribcb *cb = NULL;
  ay_level_object *l = NULL;
@@ -388,6 +390,27 @@ ay_instt_wribiarchives(char *file, ay_object *o)
 		    {
 		      RiBegin(tag->val);
 		    }
+		  else
+		  if((cachename = ay_wrib_cachename(file, o, AY_TRUE)))
+		    {
+		      /* cached archive, still up to date? */
+		      if(ay_wrib_cacheexists(cachename))
+			{
+			  free(cachename);
+			  cachename = NULL;
+			  found = AY_TRUE;
+			  break;
+			}
+		      if(!(iafilename = malloc((strlen(cachename)+5)*
+					       sizeof(char))))
+			{
+			  free(cachename);
+			  return AY_EOMEM;
+			}
+		      sprintf(iafilename, "%s.tmp", cachename);
+
+		      RiBegin(iafilename);
+		    }
 		  else
 		    {
 		      if(!(iafilename = malloc((strlen(tag->val)+
@@ -545,6 +568,17 @@ ay_instt_wribiarchives(char *file, ay_object *o)
 		  RiAttributeEnd();
 		  RiEnd();
 
+		  if(cachename)
+		    {
+		      /* move the complete archive into place */
+		      (void)remove(cachename);
+		      if(rename(iafilename, cachename))
+			ay_status = AY_ERROR;
+		      free(iafilename);
+		      free(cachename);
+		      cachename = NULL;
+		    }
+
 		  found = AY_TRUE;
 		} /* if */
 	      tag = tag->next;
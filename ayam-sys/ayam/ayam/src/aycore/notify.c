@@ -34,6 +34,59 @@ static int ay_notify_blockparent = 0;
 static int ay_notify_blockobject = 0;
 
 
+/* types local to this module: */
+
+/* node of the dependency graph of a complete notification */
+typedef struct ay_notify_node_s {
+  ay_object *o; /* the object */
+  int parent; /* node of the parent object, -1 for top level objects
+		 and masters outside of the scene */
+  int firstinst; /* first instance of this object, -1 if none */
+  int nextinst; /* next instance of the same master, -1 if none */
+  int dirty; /* position in the list of affected objects + 1,
+		0 if the object is not affected */
+} ay_notify_node;
+
+/* dependency graph of a complete notification */
+typedef struct ay_notify_graph_s {
+  int valid; /* graph matches the scene? */
+  int nnodes; /* number of nodes (including removed nodes) */
+  int nalloc; /* number of allocated nodes */
+  ay_notify_node *nodes; /* the nodes */
+  unsigned int T; /* tablesize (power of two) */
+  int *table; /* node index per object (open addressing),
+		 -1 marks empty slots, -2 slots of removed nodes */
+} ay_notify_graph;
+
+/* the dependency graph of the scene; it is built on demand by
+   ay_notify_completemulti() and then kept up to date by
+   ay_object_link(), ay_object_unlink(), and ay_object_delete() */
+static ay_notify_graph ay_notify_g = {0};
+
+
+/* prototypes of functions local to this module: */
+
+unsigned int ay_notify_countobjects(ay_object *o);
+
+int ay_notify_getslot(ay_notify_graph *g, ay_object *o);
+
+int ay_notify_getnode(ay_notify_graph *g, ay_object *o, int add);
+
+void ay_notify_remnode(ay_notify_graph *g, ay_object *o, int keepmasters);
+
+void ay_notify_remobjects(ay_notify_graph *g, ay_object *o);
+
+int ay_notify_addobjects(ay_notify_graph *g, ay_object *o, int parent,
+			 int siblings);
+
+int ay_notify_buildgraph(ay_notify_graph *g);
+
+int ay_notify_ischild(ay_notify_graph *g, int i, int a);
+
+int ay_notify_dirtyfrom(ay_notify_graph *g, int x, int verify,
+			int *aff, int *naff);
+
+
 /* functions: */
 
 /** ay_notify_register:
@@ -75,11 +128,30 @@ ay_notify_parent(void)
  int ay_status = AY_OK;
  char fname[] = "notify_parent";
  ay_list_object *lev = ay_currentlevel, *sel = ay_selection;
- ay_object *o = NULL;
+ ay_object *o = NULL, **mod = NULL;
  ay_voidfp *arr = NULL;
  ay_notifycb *cb = NULL;
  ay_tag *tag = NULL;
- int did_notify = AY_FALSE;
+ int did_notify = AY_FALSE, nmod = 0;
+
+  /* the archives of the selected objects and of all parents are
+     outdated now (see ay_wrib_cachehier()) */
+  while(sel)
+    {
+      ay_wrib_cacheinvalidate(sel->object);
+      sel = sel->next;
+    }
+  sel = ay_selection;
+
+  while(lev)
+    {
+      if(lev->next && lev->next->object)
+	ay_wrib_cacheinvalidate(lev->next->object);
+      lev = lev->next;
+      if(lev)
+	lev = lev->next;
+    }
+  lev = ay_currentlevel;
 
   if(ay_notify_blockparent)
     return AY_OK;
@@ -90,18 +162,34 @@ ay_notify_parent(void)
       /* Yes.*/
 
       /* loop through selected objects and check for changed ones;
-         do complete notify for all of them */
+         do one complete notify for all of them */
       while(sel)
 	{
-	  o = sel->object;
-	  if(o->modified)
-	    {
-	      ay_status = ay_notify_complete(o);
-	      o->modified = AY_FALSE;
-	      did_notify = AY_TRUE;
-	    }
+	  if(sel->object->modified)
+	    nmod++;
 	  sel = sel->next;
-	} /* while */
+	}
+
+      if(nmod)
+	{
+	  if(!(mod = malloc(nmod*sizeof(ay_object *))))
+	    return AY_EOMEM;
+	  nmod = 0;
+	  sel = ay_selection;
+	  while(sel)
+	    {
+	      o = sel->object;
+	      if(o->modified)
+		{
+		  mod[nmod++] = o;
+		  o->modified = AY_FALSE;
+		}
+	      sel = sel->next;
+	    } /* while */
+	  ay_status = ay_notify_completemulti(nmod, mod);
+	  free(mod);
+	  did_notify = AY_TRUE;
+	} /* if */
 
       /* in case we did not call any notification callbacks up to now,
          maybe the structure of the current level changed using e.g.
@@ -142,11 +230,19 @@ ay_notify_parent(void)
 	      tag = tag->next;
 	    }
 
+	  /* the bounding box and point index of the parent are outdated now */
+	  ay_bbc_cacheinvalidate(o);
+	  ay_selp_cacheinvalidate(o);
+
 	  /* now get and execute notify callback */
 	  arr = ay_notifycbt.arr;
 	  cb = (ay_notifycb *)(arr[o->type]);
 	  if(cb)
-	    ay_status = cb(o);
+	    {
+	      if(!o->refine)
+		(void)ay_bin_load(o);
+	      ay_status = cb(o);
+	    }
 
 	  if(ay_status)
 	    {
@@ -210,9 +306,19 @@ ay_notify_object(ay_object *o)
  ay_notifycb *cb = NULL;
  ay_tag *tag = NULL;
 
+  /* the bounding box, point index, and archive of the object
+     are outdated now */
+  ay_bbc_cacheinvalidate(o);
+  ay_selp_cacheinvalidate(o);
+  ay_wrib_cacheinvalidate(o);
+
   if(ay_notify_blockobject)
     return AY_OK;
 
+  /* objects not loaded yet get notified by ay_bin_load() */
+  if(ay_bin_islazy(o))
+    return AY_OK;
+
   /* call notification callbacks of children first */
   if(o->down && o->down->next)
     {
@@ -241,7 +347,17 @@ ay_notify_object(ay_object *o)
   arr = ay_notifycbt.arr;
   cb = (ay_notifycb *)(arr[o->type]);
   if(cb)
-    ay_status = cb(o);
+    {
+      /* the callback may need the data of the children */
+      od = o->down;
+      while(od && od->next)
+	{
+	  if(!od->refine)
+	    (void)ay_bin_load(od);
+	  od = od->next;
+	}
+      ay_status = cb(o);
+    }
 
   if(ay_status)
     {
@@ -613,25 +729,344 @@ ay_notify_findparents(ay_object *o, ay_object *r, ay_list_object **parents)
 } /* ay_notify_findparents */
 
 
-/** ay_notify_complete:
- * Start a complete notification for object \a r.
- * The complete notification updates all objects in the scene that depend
- * on object \a r regardless of whether they are parents of \a r or not.
- * Such dependencies are created by instances.
- * The complete notification is efficient, i.e. no object is updated twice.
+/* ay_notify_countobjects:
+ *  count all objects in the hierarchy starting at <o>
+ */
+unsigned int
+ay_notify_countobjects(ay_object *o)
+{
+ unsigned int n = 0;
+
+  while(o && o != ay_endlevel)
+    {
+      n++;
+      if(o->down && o->down->next)
+	n += ay_notify_countobjects(o->down);
+      o = o->next;
+    }
+
+ return n;
+} /* ay_notify_countobjects */
+
+
+/* ay_notify_getslot:
+ *  find the slot of the hash table of graph <g> that holds the node
+ *  of object <o>
+ *  returns the index of the slot or -1 if there is no node for <o>
+ */
+int
+ay_notify_getslot(ay_notify_graph *g, ay_object *o)
+{
+ unsigned int i, mask = g->T-1;
+ size_t h = (size_t)o;
+
+  h ^= h >> 4;
+  h *= 2654435761U;
+  h ^= h >> 16;
+
+  i = (unsigned int)h & mask;
+  while(g->table[i] != -1)
+    {
+      if(g->table[i] >= 0 && g->nodes[g->table[i]].o == o)
+	return (int)i;
+      i = (i+1) & mask;
+    }
+
+ return -1;
+} /* ay_notify_getslot */
+
+
+/* ay_notify_getnode:
+ *  find the dependency graph node of object <o>, if <add> is AY_TRUE
+ *  a new node is created if there is none yet
+ *  returns the index of the node or -1 if there is none (or there
+ *  is no room for a new node)
+ */
+int
+ay_notify_getnode(ay_notify_graph *g, ay_object *o, int add)
+{
+ unsigned int i, mask = g->T-1;
+ int slot;
+ ay_notify_node *n;
+ size_t h = (size_t)o;
+
+  slot = ay_notify_getslot(g, o);
+  if(slot != -1)
+    return g->table[slot];
+
+  if(!add || g->nnodes == g->nalloc)
+    return -1;
+
+  /* find a free slot, slots of removed nodes may be reused */
+  h ^= h >> 4;
+  h *= 2654435761U;
+  h ^= h >> 16;
+
+  i = (unsigned int)h & mask;
+  while(g->table[i] >= 0)
+    i = (i+1) & mask;
+
+  n = &(g->nodes[g->nnodes]);
+  n->o = o;
+  n->parent = -1;
+  n->firstinst = -1;
+  n->nextinst = -1;
+  n->dirty = 0;
+  g->table[i] = g->nnodes;
+  g->nnodes++;
+
+ return g->table[i];
+} /* ay_notify_getnode */
+
+
+/* ay_notify_remnode:
+ *  remove the node of object <o> from the dependency graph <g>;
+ *  if <keepmasters> is AY_TRUE, nodes of masters with instances are
+ *  kept (as the instances still depend on them), but lose their parent
+ */
+void
+ay_notify_remnode(ay_notify_graph *g, ay_object *o, int keepmasters)
+{
+ int slot, i, m, *k;
+
+  slot = ay_notify_getslot(g, o);
+  if(slot == -1)
+    return;
+
+  i = g->table[slot];
+  g->nodes[i].parent = -1;
+
+  if(keepmasters && g->nodes[i].firstinst != -1)
+    return;
+
+  /* remove instance/master edge */
+  if(o->type == AY_IDINSTANCE && o->refine &&
+     ((m = ay_notify_getnode(g, (ay_object *)o->refine, AY_FALSE)) != -1))
+    {
+      k = &(g->nodes[m].firstinst);
+      while(*k != -1 && *k != i)
+	k = &(g->nodes[*k].nextinst);
+      if(*k == i)
+	*k = g->nodes[i].nextinst;
+    }
+
+  g->nodes[i].o = NULL;
+  g->table[slot] = -2;
+
+ return;
+} /* ay_notify_remnode */
+
+
+/* ay_notify_remobjects:
+ *  remove the nodes of object <o> and all its children from the
+ *  dependency graph <g>
+ */
+void
+ay_notify_remobjects(ay_notify_graph *g, ay_object *o)
+{
+ ay_object *d;
+
+  if(o->down && o->down->next)
+    {
+      d = o->down;
+      while(d && d != ay_endlevel)
+	{
+	  ay_notify_remobjects(g, d);
+	  d = d->next;
+	}
+    }
+
+  ay_notify_remnode(g, o, AY_TRUE);
+
+ return;
+} /* ay_notify_remobjects */
+
+
+/* ay_notify_addobjects:
+ *  add all objects in the hierarchy starting at <o> (which are children
+ *  of the object of node <parent>) to the dependency graph <g>;
+ *  if <siblings> is AY_FALSE, the objects following <o> are not added;
+ *  returns AY_ERROR if there is no room for new nodes
+ */
+int
+ay_notify_addobjects(ay_notify_graph *g, ay_object *o, int parent,
+		     int siblings)
+{
+ int i, m, nnodes;
+
+  while(o && o != ay_endlevel)
+    {
+      nnodes = g->nnodes;
+      if((i = ay_notify_getnode(g, o, AY_TRUE)) == -1)
+	return AY_ERROR;
+      g->nodes[i].parent = parent;
+
+      /* instance/master edge */
+      if(o->type == AY_IDINSTANCE && o->refine && g->nnodes > nnodes)
+	{
+	  if((m = ay_notify_getnode(g, (ay_object *)o->refine,
+				    AY_TRUE)) == -1)
+	    return AY_ERROR;
+	  g->nodes[i].nextinst = g->nodes[m].firstinst;
+	  g->nodes[m].firstinst = i;
+	}
+
+      /* parent/child edges (the children of the root are views,
+	 nothing depends on them) */
+      if(o != ay_root && o->down && o->down->next)
+	{
+	  if(ay_notify_addobjects(g, o->down, i, AY_TRUE))
+	    return AY_ERROR;
+	}
+
+      if(!siblings)
+	break;
+
+      o = o->next;
+    } /* while */
+
+ return AY_OK;
+} /* ay_notify_addobjects */
+
+
+/* ay_notify_buildgraph:
+ *  (re)build the dependency graph <g> of the scene in a single pass
+ */
+int
+ay_notify_buildgraph(ay_notify_graph *g)
+{
+ unsigned int count;
+
+  g->valid = AY_FALSE;
+  g->nnodes = 0;
+
+  /* masters of instances may be outside of the scene, hence the two
+     nodes per object; the remaining nodes are for objects linked to
+     the scene later on */
+  count = ay_notify_countobjects(ay_root);
+  if(g->nalloc < (int)(2*count+64))
+    {
+      if(g->nodes)
+	free(g->nodes);
+      g->nalloc = 4*count+64;
+      if(!(g->nodes = malloc(g->nalloc*sizeof(ay_notify_node))))
+	{ g->nalloc = 0; return AY_EOMEM; }
+
+      if(g->table)
+	free(g->table);
+      g->T = 16;
+      while(g->T < 2*(unsigned int)g->nalloc)
+	g->T *= 2;
+      if(!(g->table = malloc(g->T*sizeof(int))))
+	{ g->T = 0; g->nalloc = 0; return AY_EOMEM; }
+    }
+  memset(g->table, 0xff, g->T*sizeof(int));
+
+  if(ay_notify_addobjects(g, ay_root, -1, AY_TRUE))
+    return AY_ERROR;
+
+  g->valid = AY_TRUE;
+
+ return AY_OK;
+} /* ay_notify_buildgraph */
+
+
+/* ay_notify_ischild:
+ *  check, whether the object of node <i> is really a child of the
+ *  object of node <a> (the scene may have been changed without
+ *  updating the graph)
+ */
+int
+ay_notify_ischild(ay_notify_graph *g, int i, int a)
+{
+ ay_object *d;
+
+  if(!g->nodes[a].o)
+    return AY_FALSE;
+
+  d = g->nodes[a].o->down;
+  while(d && d != g->nodes[i].o)
+    d = d->next;
+
+ return (d != NULL);
+} /* ay_notify_ischild */
+
+
+/* ay_notify_dirtyfrom:
+ *  mark all objects that depend on the object of node <x> (i.e. all
+ *  parents of that object and of its instances) dirty and append them
+ *  to the list of affected objects <aff>;
+ *  if <verify> is AY_TRUE, every parent/child edge is checked
+ *  against the scene before use
+ *  returns AY_ERROR if the graph does not match the scene
+ */
+int
+ay_notify_dirtyfrom(ay_notify_graph *g, int x, int verify,
+		    int *aff, int *naff)
+{
+ int i, a, c;
+
+  i = x;
+  if(g->nodes[x].parent == -1)
+    i = g->nodes[x].firstinst;
+
+  while(i != -1)
+    {
+      c = i;
+      a = g->nodes[i].parent;
+      while(a != -1 && !g->nodes[a].dirty)
+	{
+	  if(verify && !ay_notify_ischild(g, c, a))
+	    return AY_ERROR;
+	  aff[*naff] = a;
+	  (*naff)++;
+	  g->nodes[a].dirty = *naff;
+	  c = a;
+	  a = g->nodes[a].parent;
+	}
+      if(verify && a != -1 && !ay_notify_ischild(g, c, a))
+	return AY_ERROR;
+      if(i == x)
+	i = g->nodes[x].firstinst;
+      else
+	i = g->nodes[i].nextinst;
+    } /* while */
+
+ return AY_OK;
+} /* ay_notify_dirtyfrom */
+
+
+/** ay_notify_completemulti:
+ * Start a complete notification for the objects in \a r.
+ * All objects depending on any of the objects in \a r are updated
+ * exactly once and in dependency order, i.e. an object is updated
+ * after all objects it depends on (its children and the masters of
+ * the instances below it).
+ * To this end, dirty flags are propagated along the edges of a
+ * dependency graph (parent/child and instance/master edges) of the
+ * scene, and the affected objects are sorted topologically.
+ * The graph is created in a single pass on demand and then maintained
+ * by ay_object_link(), ay_object_unlink(), and ay_object_delete();
+ * as the scene may also be changed by direct pointer manipulation,
+ * every edge is checked before use and the graph is rebuilt if it
+ * does not match the scene.
+ * Only the objects in \a r get their modified flag cleared.
  *
- * \param[in] r object for which to start the notification
+ * \param[in] n number of objects in \a r
+ * \param[in] r objects for which to start the notification
  *
  * \returns AY_OK on success, error code otherwise.
  */
 int
-ay_notify_complete(ay_object *r)
+ay_notify_completemulti(int n, ay_object **r)
 {
+ int ay_status = AY_OK;
  static int lock = 0;
- int propagate = AY_TRUE;
+ ay_notify_graph *g = &ay_notify_g;
+ ay_notify_node *nd;
  ay_object *o;
- ay_tag *tag;
- ay_list_object *l = NULL, *s, *t, *u;
+ int *aff = NULL, *order = NULL, *indeg = NULL, naff = 0, norder = 0;
+ int i, j, k, a, head, rebuilt = AY_FALSE;
 
   /* avoid recursive calls that may happen with Script objects */
   if(lock)
@@ -639,96 +1074,286 @@ ay_notify_complete(ay_object *r)
       return AY_OK;
     }
 
-  lock = 1;
-
   if(!r)
     {
-      lock = 0;
       return AY_ENULL;
     }
 
-  o = ay_root;
+  lock = 1;
 
-  while(o)
+  for(j = 0; j < n; j++)
     {
-      (void)ay_notify_findparents(o, r, &l);
-      o = o->next;
-    } /* while */
+      if(r[j])
+	r[j]->modified = AY_FALSE;
+    }
 
-  u = NULL;
-  while(propagate)
+  if(!g->valid)
     {
-      propagate = AY_FALSE;
-      t = l;
-      s = l;
-      while(s && (s != u))
-	{
-	  if(s->object && (s->object->refcount > 0))
-	    {
-	      o = ay_root->next;
-	      while(o)
-		{
-		  (void)ay_notify_findparents(o, s->object, &l);
-		  o = o->next;
-		} /* while */
-	    } /* if */
-	  s = s->next;
-	} /* while */
+      ay_status = ay_notify_buildgraph(g);
+      if(ay_status)
+	goto cleanup;
+      rebuilt = AY_TRUE;
+    }
+
+propagate:
 
-      if(l != t)
+  if(!(aff = malloc((g->nnodes+1)*sizeof(int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  /* propagate the dirty flags, objects unknown to the graph and
+     edges not matching the scene lead to a rebuild of the graph */
+  for(j = 0; j < n; j++)
+    {
+      if(!r[j])
+	continue;
+      k = ay_notify_getnode(g, r[j], AY_FALSE);
+      if(k == -1 && !rebuilt)
+	goto rebuild;
+      if(k != -1 && ay_notify_dirtyfrom(g, k, !rebuilt, aff, &naff))
+	goto rebuild;
+    }
+
+  for(j = 0; j < naff; j++)
+    {
+      nd = &(g->nodes[aff[j]]);
+      if(nd->o->refcount > 0)
 	{
-	  /* added some objects, need to continue propagating... */
-	  propagate = AY_TRUE;
+	  if(ay_notify_dirtyfrom(g, aff[j], !rebuilt, aff, &naff))
+	    goto rebuild;
 	}
+    }
 
-      /* for consecutive iterations, arrange to stop at old list, because
-	 we processed that already */
-      u = t;
-    } /* while */
+  if(naff == 0)
+    goto cleanup;
+
+  /* sort the affected objects topologically (Kahn), an object
+     depends on its children and on the masters of its instances */
+  if(!(indeg = calloc(naff, sizeof(int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  if(!(order = malloc(naff*sizeof(int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
 
-  /* revert list */
-  s = NULL;
-  while(l)
+  for(j = 0; j < naff; j++)
     {
-      t = l;
-      l = l->next;
-      o = t->object;
-      if(o && o->tags && (o->tags->type == ay_nc_tagtype))
+      nd = &(g->nodes[aff[j]]);
+      if(nd->parent != -1 && g->nodes[nd->parent].dirty)
+	indeg[g->nodes[nd->parent].dirty-1]++;
+      for(k = nd->firstinst; k != -1; k = g->nodes[k].nextinst)
 	{
-	  o->tags->val = (char*)o->tags->val + 1;
+	  a = g->nodes[k].parent;
+	  if(a != -1 && g->nodes[a].dirty)
+	    indeg[g->nodes[a].dirty-1]++;
 	}
-      t->next = s;
-      s = t;
-    } /* while */
+    } /* for */
 
-  while(s)
+  for(j = 0; j < naff; j++)
     {
-      o = s->object;
-      if(o && o->tags && (o->tags->type == ay_nc_tagtype))
+      if(indeg[j] == 0)
+	order[norder++] = j;
+    }
+
+  for(head = 0; head < norder; head++)
+    {
+      nd = &(g->nodes[aff[order[head]]]);
+      if(nd->parent != -1 && g->nodes[nd->parent].dirty)
+	{
+	  a = g->nodes[nd->parent].dirty-1;
+	  if(--indeg[a] == 0)
+	    order[norder++] = a;
+	}
+      for(k = nd->firstinst; k != -1; k = g->nodes[k].nextinst)
 	{
-	  o->tags->val = (char*)o->tags->val - 1;
-	  if(o->tags->val == 0)
+	  a = g->nodes[k].parent;
+	  if(a != -1 && g->nodes[a].dirty)
 	    {
-	      (void)ay_notify_object(o);
-	      if(o->tags && (o->tags->type == ay_nc_tagtype))
-		{
-		  tag = o->tags;
-		  o->tags = tag->next;
-		  free(tag);
-		}
-	    } /* if */
-	} /* if */
-      t = s->next;
-      free(s);
-      s = t;
-    } /* while */
+	      a = g->nodes[a].dirty-1;
+	      if(--indeg[a] == 0)
+		order[norder++] = a;
+	    }
+	}
+    } /* for */
+
+  /* cyclic dependencies (should not happen) are resolved by
+     discovery order */
+  if(norder < naff)
+    {
+      for(j = 0; j < naff; j++)
+	{
+	  if(indeg[j] > 0)
+	    order[norder++] = j;
+	}
+    }
+
+  /* reset the dirty flags (the callbacks below may change the graph) */
+  for(j = 0; j < naff; j++)
+    {
+      g->nodes[aff[j]].dirty = 0;
+    }
+
+  /* finally, update the objects */
+  for(j = 0; j < naff; j++)
+    {
+      order[j] = aff[order[j]];
+    }
+  for(j = 0; j < naff; j++)
+    {
+      /* the object may have been removed by a callback */
+      if((o = g->nodes[order[j]].o))
+	(void)ay_notify_object(o);
+    }
+  naff = 0;
+
+  goto cleanup;
+
+rebuild:
+
+  for(i = 0; i < naff; i++)
+    {
+      g->nodes[aff[i]].dirty = 0;
+    }
+  naff = 0;
+  free(aff);
+  aff = NULL;
+
+  ay_status = ay_notify_buildgraph(g);
+  if(ay_status)
+    goto cleanup;
+  rebuilt = AY_TRUE;
+
+  goto propagate;
+
+cleanup:
+
+  if(aff)
+    {
+      for(j = 0; j < naff; j++)
+	{
+	  g->nodes[aff[j]].dirty = 0;
+	}
+      free(aff);
+    }
+
+  if(indeg)
+    free(indeg);
+
+  if(order)
+    free(order);
 
   lock = 0;
 
- return AY_OK;
+ return ay_status;
+} /* ay_notify_completemulti */
+
+
+/** ay_notify_complete:
+ * Start a complete notification for object \a r.
+ * The complete notification updates all objects in the scene that depend
+ * on object \a r regardless of whether they are parents of \a r or not.
+ * Such dependencies are created by instances.
+ * The complete notification is efficient, i.e. no object is updated twice.
+ *
+ * \param[in] r object for which to start the notification
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_notify_complete(ay_object *r)
+{
+
+  if(!r)
+    return AY_ENULL;
+
+ return ay_notify_completemulti(1, &r);
 } /* ay_notify_complete */
 
 
+/** ay_notify_graphlink:
+ * Add an object that was just linked to the scene (and all its
+ * children) to the dependency graph of the complete notification.
+ *
+ * \param[in] o the linked object
+ * \param[in] parent parent object of \a o, NULL for top level objects
+ */
+void
+ay_notify_graphlink(ay_object *o, ay_object *parent)
+{
+ ay_notify_graph *g = &ay_notify_g;
+ int p = -1;
+
+  if(!g->valid || !o)
+    return;
+
+  if(parent && ((p = ay_notify_getnode(g, parent, AY_FALSE)) == -1))
+    {
+      g->valid = AY_FALSE;
+      return;
+    }
+
+  if(ay_notify_addobjects(g, o, p, AY_FALSE))
+    g->valid = AY_FALSE;
+
+ return;
+} /* ay_notify_graphlink */
+
+
+/** ay_notify_graphunlink:
+ * Remove an object that was just unlinked from the scene (and all its
+ * children) from the dependency graph of the complete notification.
+ *
+ * \param[in] o the unlinked object
+ */
+void
+ay_notify_graphunlink(ay_object *o)
+{
+ ay_notify_graph *g = &ay_notify_g;
+
+  if(!g->valid || !o)
+    return;
+
+  ay_notify_remobjects(g, o);
+
+ return;
+} /* ay_notify_graphunlink */
+
+
+/** ay_notify_graphremove:
+ * Remove an object that is about to be deleted from the dependency
+ * graph of the complete notification (so that its address may be
+ * re-used).
+ *
+ * \param[in] o the object to be deleted
+ */
+void
+ay_notify_graphremove(ay_object *o)
+{
+ ay_notify_graph *g = &ay_notify_g;
+
+  if(!g->valid || !o)
+    return;
+
+  ay_notify_remnode(g, o, AY_FALSE);
+
+ return;
+} /* ay_notify_graphremove */
+
+
+/** ay_notify_graphinvalidate:
+ * Invalidate the dependency graph of the complete notification;
+ * must be called after changes of the scene hierarchy that do not use
+ * ay_object_link() or ay_object_unlink(); the graph will be rebuilt
+ * on the next complete notification.
+ */
+void
+ay_notify_graphinvalidate(void)
+{
+
+  ay_notify_g.valid = AY_FALSE;
+
+ return;
+} /* ay_notify_graphinvalidate */
+
+
 /** ay_notify_block:
  * Manage blocking of automatic notifications.
  *
@@ -780,6 +1405,9 @@ ay_notify_objectsafetcmd(ClientData clientData, Tcl_Interp *interp,
       /* call the notification callback */
       if(cb)
 	{
+	  ay_bbc_cacheinvalidate(o);
+	  ay_selp_cacheinvalidate(o);
+	  ay_wrib_cacheinvalidate(o);
 	  ay_status = cb(o);
 	  if(ay_status)
 	    {
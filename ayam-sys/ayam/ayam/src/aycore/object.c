@@ -239,6 +239,15 @@ ay_object_delete(ay_object *o)
   if(o == ay_endlevel)
     return AY_OK;
 
+  /* release the file of data not loaded yet */
+  if(!o->refine)
+    ay_bin_release(o);
+
+  /* the address may be re-used by a new object */
+  ay_bbc_cacheinvalidate(o);
+  ay_selp_cacheinvalidate(o);
+  ay_wrib_cacheinvalidate(o);
+
   /* delete children first */
   while(o->down && (o->down != ay_endlevel))
     {
@@ -254,6 +263,8 @@ ay_object_delete(ay_object *o)
 	} /* if */
     } /* while have children */
 
+  ay_notify_graphremove(o);
+
   if(o->refine)
     {
       arr = ay_deletecbt.arr;
@@ -583,6 +594,13 @@ ay_object_link(ay_object *o)
       o->down = ay_endlevel;
     }
 
+  /* keep the dependency graph of the complete notification up to date */
+  if(ay_currentlevel && ay_currentlevel->object != ay_root &&
+     ay_currentlevel->next)
+    ay_notify_graphlink(o, ay_currentlevel->next->object);
+  else
+    ay_notify_graphlink(o, NULL);
+
   /* just in case that we are linking the very first object to
      an empty sub-level (ay_currentlevel points to the end-level object)
      we need to correct ay_currentlevel to point to the new object instead */
@@ -652,6 +670,8 @@ ay_object_unlink(ay_object *o)
 	} /* while */
     } /* if */
 
+  ay_notify_graphunlink(o);
+
  return;
 } /* ay_object_unlink */
 
@@ -844,6 +864,9 @@ ay_object_copy(ay_object *src, ay_object **dst)
       return AY_OK;
     }
 
+  if(!src->refine)
+    (void)ay_bin_load(src);
+
   /* copy generic object */
   if(!(new = malloc(sizeof(ay_object))))
     {
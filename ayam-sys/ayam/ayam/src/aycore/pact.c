@@ -102,6 +102,9 @@ ay_pact_getpoint(int mode, ay_object *o, double *obj, ay_pointedit *pe)
   if(!o || ((mode != 3) && (!obj || !pe)))
     return AY_ENULL;
 
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
   arr = ay_getpntcbt.arr;
   cb = (ay_getpntcb *)(arr[o->type]);
   if(!cb)
@@ -129,6 +132,9 @@ ay_pact_pickpoint(ay_object *o, ay_view_object *view,
   if(!o || !obj || !pe || !view)
     return AY_ENULL;
 
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
   oldpickepsilon = ay_prefs.pick_epsilon;
 
   /* adapt pick epsilon to view zoom, level and object scale */
@@ -17,56 +17,95 @@
 
 /* types local to this module */
 
-typedef struct ay_pomesht_listobject_s
+/* state of the tesselation of general polygons into a vertex buffer */
+typedef struct ay_pomesht_vbtess_s
 {
-  struct ay_pomesht_listobject_s *next;
-  void *data;
-} ay_pomesht_listobject;
-
-typedef struct ay_pomesht_htentry_s
+  ay_vbuf *vb; /* target vertex buffer */
+  unsigned int tri[3]; /* vertex indices of the current triangle */
+  int n; /* number of vertices in tri */
+  int status; /* AY_EOMEM if a vertex or triangle could not be stored */
+} ay_pomesht_vbtess;
+
+/* slot of the vertex hash table */
+typedef struct ay_pomesht_hslot_s
 {
-  struct ay_pomesht_htentry_s *next;
-  unsigned int index;
-  double x, y, z, nx, ny, nz;
-} ay_pomesht_htentry;
+  unsigned int hash; /* hash value of the grid cell of this slot */
+  int head; /* newest vertex in this cell, -1 if the slot is empty */
+} ay_pomesht_hslot;
 
+/* grid cell based vertex hash */
 typedef struct ay_pomesh_hash_s
 {
-  int found;
-  unsigned int index;
-  int c;
-  int T; /* tablesize */
-  ay_pomesht_htentry **table;
+  int found; /* result of the last lookup */
+  unsigned int index; /* result of the last lookup */
+  unsigned int T; /* tablesize (power of two) */
+  ay_pomesht_hslot *table; /* open addressing table */
+  int *next; /* next (older) vertex in the same cell [n] */
+  double h; /* edge length of the grid cells */
+  double *cv; /* vertices to optimize */
+  unsigned int n; /* number of vertices to optimize */
+  int stride; /* stride in cv and newcv */
+  double *newcv; /* optimized vertices (in the hash) */
+  double *cells; /* grid cells of all vertices in cv [n*3] */
+  unsigned int *hashes; /* hash values of the grid cells [n] */
+  unsigned int chunk; /* vertices per work item of parallel hashing */
 } ay_pomesht_hash;
 
+/* edge length of the grid cells of the vertex hash (in multiples of
+   AY_EPSILON); vertices are compared with AY_EPSILON tolerance, so that
+   most lookups visit only one cell */
+#define AY_POMESHTCELLSIZE 16.0
+
+/* grid cell of coordinate x; the cells are centered around multiples of
+   the cell size, so that vertices with "round" coordinates (e.g. 0.0)
+   are not placed on cell boundaries (where every lookup would have to
+   visit two cells); adding 0.0 turns -0.0 into 0.0 */
+#define AY_POMESHTCELL(x, h) (floor((x)/(h) + 0.5) + 0.0)
+
+/* grid cells beyond this magnitude (2^52) can not be stepped exactly */
+#define AY_POMESHTMAXCELL 4503599627370496.0
+
+/* minimum number of vertices for parallel hashing */
+#define AY_POMESHTMINPARVERTS 65536
+
 #define AYVCOMP(x1,y1,z1,x2,y2,z2) ((fabs(x1-x2)<=AY_EPSILON) && \
            (fabs(y1-y2)<=AY_EPSILON)&&(fabs(z1-z2)<= AY_EPSILON))
 
 
 /* prototypes of functions local to this module */
 
-void ay_pomesht_tcbBegin(GLenum prim);
+void ay_pomesht_vbBegin(GLenum prim, void *data);
 
-void ay_pomesht_tcbVertex(void *data);
+void ay_pomesht_vbEdgeFlag(GLboolean flag, void *data);
 
-void ay_pomesht_tcbVertexN(void *data);
+void ay_pomesht_vbVertex(void *vdata, void *data);
 
-void ay_pomesht_tcbEnd(void);
+void ay_pomesht_vbCombine(GLdouble c[3], void *d[4], GLfloat w[4],
+			  void **out, void *data);
 
-void ay_pomesht_tcbCombine(GLdouble c[3], void *d[4], GLfloat w[4],
-			   void **out);
+int ay_pomesht_vbpoly(ay_pomesh_object *pomesh, unsigned int i,
+		      unsigned int l, unsigned int m, unsigned int n,
+		      unsigned int base, ay_vbuf *vb);
 
-void ay_pomesht_tcbCombineN(GLdouble c[3], void *d[4], GLfloat w[4],
-			    void **out);
+int ay_pomesht_buildvb(ay_pomesh_object *pomesh, ay_vbuf *vb);
 
-void ay_pomesht_ManageCombined(void *data);
+int ay_pomesht_hashcb(void *data, int item, int thread);
 
-int ay_pomesht_inithash(ay_pomesht_hash *hash);
+unsigned int ay_pomesht_hashcell(double *cell);
+
+int ay_pomesht_inithash(ay_pomesht_hash *hash, double *cv, unsigned int n,
+			int stride, double *newcv);
 
 void ay_pomesht_destroyhash(ay_pomesht_hash *hash);
 
-int ay_pomesht_addvertextohash(ay_pomesht_hash *phash, double normal_epsilon,
-			       double *point);
+ay_pomesht_hslot *ay_pomesht_findslot(ay_pomesht_hash *hash, double *cell,
+				      unsigned int h);
+
+int ay_pomesht_matchvertex(ay_pomesht_hash *phash, double normal_epsilon,
+			   int e, double *point);
+
+void ay_pomesht_addvertextohash(ay_pomesht_hash *phash,
+				double normal_epsilon, unsigned int i);
 
 void ay_pomesht_alignpoints(ay_point *p1, ay_point *p2, unsigned int p2len,
 			    int p2closed);
@@ -99,140 +138,171 @@ ay_pomesht_destroy(ay_pomesh_object *pomesh)
     free(pomesh->controlv);
   if(pomesh->face_normals)
     free(pomesh->face_normals);
+  if(pomesh->vb)
+    {
+      ay_shade_vbuffree(pomesh->vb);
+      free(pomesh->vb);
+    }
   free(pomesh);
 
  return AY_OK;
 } /* ay_pomesht_destroy */
 
 
-/* tesselation callbacks needed by GLU */
+/* tesselation callbacks needed by GLU;
+   the vertex data are vertex buffer indices plus one */
 void
-ay_pomesht_tcbBegin(GLenum prim)
+ay_pomesht_vbBegin(GLenum prim, void *data)
 {
-  glBegin(prim);
-} /* ay_pomesht_tcbBegin */
+  ((ay_pomesht_vbtess *)data)->n = 0;
+} /* ay_pomesht_vbBegin */
 
 
 void
-ay_pomesht_tcbVertex(void *data)
+ay_pomesht_vbEdgeFlag(GLboolean flag, void *data)
 {
-  glVertex3dv((GLdouble *)data);
-} /* ay_pomesht_tcbVertex */
+  /* registering this callback makes GLU emit just GL_TRIANGLES */
+  return;
+} /* ay_pomesht_vbEdgeFlag */
 
 
 void
-ay_pomesht_tcbVertexN(void *data)
+ay_pomesht_vbVertex(void *vdata, void *data)
 {
-  glNormal3dv(((GLdouble *)data)+3);
-  glVertex3dv((GLdouble *)data);
-} /* ay_pomesht_tcbVertexN */
+ ay_pomesht_vbtess *t = (ay_pomesht_vbtess *)data;
 
+  t->tri[t->n] = (unsigned int)((size_t)vdata-1);
+  t->n++;
+  if(t->n == 3)
+    {
+      if(!t->status)
+	t->status = ay_shade_vbufaddtri(t->vb, t->tri[0], t->tri[1],
+					t->tri[2]);
+      t->n = 0;
+    }
 
-void
-ay_pomesht_tcbEnd(void)
-{
-  glEnd();
-} /* ay_pomesht_tcbEnd */
+ return;
+} /* ay_pomesht_vbVertex */
 
 
 void
-ay_pomesht_tcbCombine(GLdouble c[3], void *d[4], GLfloat w[4], void **out)
+ay_pomesht_vbCombine(GLdouble c[3], void *d[4], GLfloat w[4], void **out,
+		     void *data)
 {
- GLdouble *nv = NULL;
+ ay_pomesht_vbtess *t = (ay_pomesht_vbtess *)data;
+ double n[3] = {0}, *v;
+ int i;
 
-  if(!(nv = (GLdouble *) malloc(sizeof(GLdouble)*3)))
-    return;
+  /* interpolate the normal */
+  for(i = 0; i < 4; i++)
+    {
+      if(d[i])
+	{
+	  v = &(t->vb->v[((size_t)d[i]-1)*6+3]);
+	  n[0] += w[i]*v[0];
+	  n[1] += w[i]*v[1];
+	  n[2] += w[i]*v[2];
+	}
+    }
 
-  nv[0] = c[0];
-  nv[1] = c[1];
-  nv[2] = c[2];
+  if(!t->status)
+    t->status = ay_shade_vbufaddvert(t->vb, c, n);
 
-  /* remember pointer to free it later */
-  ay_pomesht_ManageCombined((void*)nv);
+  *out = (void *)((size_t)t->vb->nv);
 
-  *out = nv;
-} /* ay_pomesht_tcbCombine */
+ return;
+} /* ay_pomesht_vbCombine */
 
 
-void
-ay_pomesht_tcbCombineN(GLdouble c[3], void *d[4], GLfloat w[4], void **out)
+/* ay_pomesht_vbpoly:
+ *  tesselate the general polygon <i> of PolyMesh <pomesh> into
+ *  triangles of the vertex buffer <vb>;
+ *  <l>, <m>, and <n> point into nloops, nverts, and verts of the polygon;
+ *  the vertices of the polygon are in <vb> at index <base> (in the order
+ *  of verts) or, if <pomesh> has vertex normals, at their own index
+ */
+int
+ay_pomesht_vbpoly(ay_pomesh_object *pomesh, unsigned int i,
+		  unsigned int l, unsigned int m, unsigned int n,
+		  unsigned int base, ay_vbuf *vb)
 {
- GLdouble *nv = NULL;
-
-  if(!(nv = (GLdouble *) malloc(sizeof(GLdouble)*6)))
-    return;
-
-  nv[0] = c[0];
-  nv[1] = c[1];
-  nv[2] = c[2];
-
-  nv[3] = w[0]*((double*)d[0])[3] + w[1]*((double*)d[1])[3] +
-    w[2]*((double*)d[2])[3] + w[3]*((double*)d[3])[3];
-
-  nv[4] = w[0]*((double*)d[0])[4] + w[1]*((double*)d[1])[4] +
-    w[2]*((double*)d[2])[4] + w[3]*((double*)d[3])[4];
-
-  nv[5] = w[0]*((double*)d[0])[5] + w[1]*((double*)d[1])[5] +
-    w[2]*((double*)d[2])[5] + w[3]*((double*)d[3])[5];
-
-  /* remember pointer to free it later */
-  ay_pomesht_ManageCombined((void*)nv);
-
-  *out = nv;
-} /* ay_pomesht_tcbCombineN */
+#ifndef GLU_VERSION_1_2
+ return AY_OK;
+#else
+ unsigned int j, k, a, b;
+ int stride;
+ GLUtesselator *tess = NULL;
+ ay_pomesht_vbtess t = {0};
 
+  stride = pomesh->has_normals?6:3;
 
-void
-ay_pomesht_ManageCombined(void *data)
-{
- static ay_pomesht_listobject *list = NULL;
- ay_pomesht_listobject *new = NULL;
+  if(!(tess = gluNewTess()))
+    return AY_EOMEM;
 
-  if(data)
-    { /* add new pointer to the list */
-      if(!(new = malloc(sizeof(ay_pomesht_listobject))))
-	return;
+  t.vb = vb;
 
-      new->data = data;
-      new->next = list;
-      list = new;
-    }
-  else
-    { /* data == NULL => free the list */
-      while(list)
-	{
-	  new = list;
-	  list = new->next;
-	  free(new->data);
-	  free(new);
-	} /* while */
-    } /* if */
+  gluTessCallback(tess, GLU_TESS_ERROR, AYGLUCBTYPE ay_error_glucb);
+  gluTessCallback(tess, GLU_TESS_BEGIN_DATA, AYGLUCBTYPE ay_pomesht_vbBegin);
+  gluTessCallback(tess, GLU_TESS_EDGE_FLAG_DATA,
+		  AYGLUCBTYPE ay_pomesht_vbEdgeFlag);
+  gluTessCallback(tess, GLU_TESS_VERTEX_DATA,
+		  AYGLUCBTYPE ay_pomesht_vbVertex);
+  gluTessCallback(tess, GLU_TESS_COMBINE_DATA,
+		  AYGLUCBTYPE ay_pomesht_vbCombine);
 
- return;
-} /* ay_pomesht_ManageCombined */
+  if(!pomesh->has_normals)
+    gluTessNormal(tess, pomesh->face_normals[i*3],
+		  pomesh->face_normals[i*3+1], pomesh->face_normals[i*3+2]);
+
+  b = base;
+  gluTessBeginPolygon(tess, (GLvoid*)(&t));
+   for(j = 0; j < pomesh->nloops[l]; j++)
+     {
+       gluTessBeginContour(tess);
+	for(k = 0; k < pomesh->nverts[m]; k++)
+	  {
+	    a = pomesh->verts[n++];
+	    gluTessVertex(tess,
+			  (GLdouble*)(&(pomesh->controlv[a*stride])),
+			  (void*)((size_t)(pomesh->has_normals?a:b)+1));
+	    b++;
+	  } /* for */
+       gluTessEndContour(tess);
+       m++;
+     } /* for */
+  gluTessEndPolygon(tess);
+
+  gluDeleteTess(tess);
+
+ return t.status;
+#endif
+} /* ay_pomesht_vbpoly */
 
 
-/* ay_pomesht_tesselate:
- *  tesselate PolyMesh <pomesh> into triangles and draw them
- *  immediately using OpenGL
+/* ay_pomesht_buildvb:
+ *  tesselate PolyMesh <pomesh> into the triangles of the
+ *  vertex buffer <vb>; if the PolyMesh has no vertex normals,
+ *  the vertices are duplicated per face to carry the face normals
  */
 int
-ay_pomesht_tesselate(ay_pomesh_object *pomesh)
+ay_pomesht_buildvb(ay_pomesh_object *pomesh, ay_vbuf *vb)
 {
  int ay_status = AY_OK;
  unsigned int i = 0, j = 0, k = 0, l = 0, m = 0, n = 0;
- unsigned int a;
- int stride = 0;
- GLUtesselator *tess = NULL;
+ unsigned int a, b, nv;
  double *fn = NULL;
 
   if(pomesh->has_normals)
     {
-      stride = 6;
+      for(i = 0; i < pomesh->ncontrols; i++)
+	{
+	  if((ay_status = ay_shade_vbufaddvert(vb, &(pomesh->controlv[i*6]),
+					       &(pomesh->controlv[i*6+3]))))
+	    return ay_status;
+	}
     }
   else
     {
-      stride = 3;
       if(pomesh->face_normals)
 	{
 	  fn = pomesh->face_normals;
@@ -249,142 +319,97 @@ ay_pomesht_tesselate(ay_pomesh_object *pomesh)
 
   for(i = 0; i < pomesh->npolys; i++)
     {
-      /* is this polygon a simple triangle or quad? */
-      if((pomesh->nloops[i] == 1) && (pomesh->nverts[m] < 5))
+      /* count the vertices of this polygon */
+      nv = 0;
+      for(j = 0; j < pomesh->nloops[l]; j++)
+	nv += pomesh->nverts[m+j];
+
+      /* get the vertex buffer indices of the vertices */
+      b = vb->nv;
+      if(!pomesh->has_normals)
 	{
-	  switch(pomesh->nverts[m])
+	  for(k = 0; k < nv; k++)
 	    {
-	    case 0:
-	      break;
-	    case 1:
-	      n++;
-	      break;
-	    case 2:
-	      n += 2;
-	      break;
-	    case 3:
-	      /* is triangle */
-	      glBegin(GL_TRIANGLES);
-	       a = pomesh->verts[n++];
-	       if(pomesh->has_normals)
-		 {
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		 }
-	       else
-		 {
-		   glNormal3dv(&(fn[i*3]));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		 }
-	      glEnd();
-	      break;
-	    case 4:
-	      /* is quad */
-	      glBegin(GL_QUADS);
-	       a = pomesh->verts[n++];
-	       if(pomesh->has_normals)
-		 {
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glNormal3dv((GLdouble*)(&(pomesh->controlv[a*stride+3])));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		 }
-	       else
-		 {
-		   glNormal3dv(&(fn[i*3]));
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		   a = pomesh->verts[n++];
-		   glVertex3dv((GLdouble*)(&(pomesh->controlv[a*stride])));
-		 }
-	      glEnd();
-	      break;
-	    default:
-	      break;
-	    } /* switch */
-	  m++;
-	  l++;
+	      a = pomesh->verts[n+k];
+	      if((ay_status = ay_shade_vbufaddvert(vb,
+					  &(pomesh->controlv[a*3]),
+					  &(fn[i*3]))))
+		return ay_status;
+	    }
 	}
-      else
-	{
-	  /* general polygon */
-	  if(!(tess = gluNewTess()))
-	    return AY_EOMEM;
-
-	  gluTessCallback(tess, GLU_TESS_ERROR,
-			  AYGLUCBTYPE ay_error_glucb);
-	  gluTessCallback(tess, GLU_TESS_BEGIN,
-			  AYGLUCBTYPE ay_pomesht_tcbBegin);
 
-	  if(!pomesh->has_normals)
+      /* is this polygon a simple triangle or quad? */
+      if((pomesh->nloops[l] == 1) && (nv == 3 || nv == 4))
+	{
+	  if(pomesh->has_normals)
 	    {
-	      gluTessCallback(tess, GLU_TESS_VERTEX,
-			      AYGLUCBTYPE ay_pomesht_tcbVertex);
-	      gluTessCallback(tess, GLU_TESS_COMBINE,
-			      AYGLUCBTYPE ay_pomesht_tcbCombine);
+	      ay_status = ay_shade_vbufaddtri(vb, pomesh->verts[n],
+					      pomesh->verts[n+1],
+					      pomesh->verts[n+2]);
+	      if(!ay_status && nv == 4)
+		ay_status = ay_shade_vbufaddtri(vb, pomesh->verts[n],
+						pomesh->verts[n+2],
+						pomesh->verts[n+3]);
 	    }
 	  else
 	    {
-	      gluTessCallback(tess, GLU_TESS_VERTEX,
-			      AYGLUCBTYPE ay_pomesht_tcbVertexN);
-	      gluTessCallback(tess, GLU_TESS_COMBINE,
-			      AYGLUCBTYPE ay_pomesht_tcbCombineN);
-	    } /* if */
-
-	  gluTessCallback(tess, GLU_TESS_END,
-			  AYGLUCBTYPE ay_pomesht_tcbEnd);
-
-	  /* GLU 1.2 only: */
-	  /*gluTessBeginPolygon(tess, NULL);*/
-	  gluBeginPolygon(tess);
-	   if(!pomesh->has_normals)
-	     {
-	       glNormal3dv(&(fn[i*3]));
-	     }
-
-	   for(j = 0; j < pomesh->nloops[l]; j++)
-	     {
-	       /*gluTessBeginContour(tess);*/
-	       for(k = 0; k < pomesh->nverts[m]; k++)
-		 {
-		   a = pomesh->verts[n++];
-		   gluTessVertex(tess,
-				 (GLdouble*)(&(pomesh->controlv[a*stride])),
-				 (GLdouble*)(&(pomesh->controlv[a*stride])));
-		 } /* for */
-	       /*gluTessEndContour(tess);*/
-	       gluNextContour(tess, GLU_INTERIOR);
-	       m++;
-	     } /* for */
-	   /*      gluTessEndPolygon(tess);*/
-	  gluEndPolygon(tess);
-	  gluDeleteTess(tess);
-	  /* free combined vertices */
-	  ay_pomesht_ManageCombined(NULL);
-	  l++;
+	      ay_status = ay_shade_vbufaddtri(vb, b, b+1, b+2);
+	      if(!ay_status && nv == 4)
+		ay_status = ay_shade_vbufaddtri(vb, b, b+2, b+3);
+	    }
+	}
+      else
+	{
+	  if(nv > 2)
+	    {
+	      /* general polygon */
+	      ay_status = ay_pomesht_vbpoly(pomesh, i, l, m, n, b, vb);
+	    }
 	} /* if */
+
+      if(ay_status)
+	return ay_status;
+
+      m += pomesh->nloops[l];
+      n += nv;
+      l++;
     } /* for */
 
+ return AY_OK;
+} /* ay_pomesht_buildvb */
+
+
+/* ay_pomesht_tesselate:
+ *  tesselate PolyMesh <pomesh> into triangles and draw them
+ *  using OpenGL vertex arrays; the triangles are cached in the
+ *  PolyMesh until the next notification
+ */
+int
+ay_pomesht_tesselate(ay_pomesh_object *pomesh)
+{
+ int ay_status = AY_OK;
+
+  if(!pomesh->vb)
+    {
+      if(!(pomesh->vb = calloc(1, sizeof(ay_vbuf))))
+	return AY_EOMEM;
+    }
+
+  if(!pomesh->vb->valid)
+    {
+      ay_status = ay_pomesht_buildvb(pomesh, pomesh->vb);
+
+      if(ay_status)
+	{
+	  ay_shade_vbuffree(pomesh->vb);
+	  return ay_status;
+	}
+
+      pomesh->vb->valid = AY_TRUE;
+    }
+
+  ay_shade_vbufdraw(pomesh->vb, NULL);
+
  return AY_OK;
 } /* ay_pomesht_tesselate */
 
@@ -899,158 +924,321 @@ cleanup:
 } /* ay_pomesht_optimizepv */
 
 
+/* ay_pomesht_hashcb:
+ *  work callback of ay_pomesht_inithash(), calculates the grid cells
+ *  and hash values of one chunk of vertices
+ */
+int
+ay_pomesht_hashcb(void *data, int item, int thread)
+{
+ ay_pomesht_hash *hash = (ay_pomesht_hash *)data;
+ unsigned int i, a, end;
+ double *p, *c;
+
+  a = item * hash->chunk;
+  end = a + hash->chunk;
+  if(end > hash->n)
+    end = hash->n;
+
+  for(i = a; i < end; i++)
+    {
+      p = &(hash->cv[i*hash->stride]);
+      c = &(hash->cells[i*3]);
+      c[0] = AY_POMESHTCELL(p[0], hash->h);
+      c[1] = AY_POMESHTCELL(p[1], hash->h);
+      c[2] = AY_POMESHTCELL(p[2], hash->h);
+      hash->hashes[i] = ay_pomesht_hashcell(c);
+    } /* for */
+
+ return AY_OK;
+} /* ay_pomesht_hashcb */
+
+
+/* ay_pomesht_hashcell:
+ *  calculate the hash value of a grid cell
+ */
+unsigned int
+ay_pomesht_hashcell(double *cell)
+{
+ unsigned int h = 2166136261U, w[2];
+ int i, j;
+
+  for(i = 0; i < 3; i++)
+    {
+      memcpy(w, &(cell[i]), sizeof(double));
+      for(j = 0; j < 2; j++)
+	{
+	  h ^= w[j];
+	  h *= 16777619U;
+	  h ^= h >> 15;
+	}
+    }
+
+  h ^= h >> 13;
+  h *= 0x5bd1e995U;
+  h ^= h >> 15;
+
+ return h;
+} /* ay_pomesht_hashcell */
+
+
 /* ay_pomesht_inithash:
  *  helper for ay_pomesht_optimizecoords() below
- *  initialize the hash table
+ *  initialize the hash table for the <n> vertices in <cv>, this also
+ *  calculates the grid cells of all vertices (in parallel)
  */
 int
-ay_pomesht_inithash(ay_pomesht_hash *hash)
+ay_pomesht_inithash(ay_pomesht_hash *hash, double *cv, unsigned int n,
+		    int stride, double *newcv)
 {
+ int ay_status = AY_OK;
+ unsigned int i;
+ int nchunks = 1;
 
-  hash->table = (ay_pomesht_htentry **)calloc(1,
-				    sizeof(ay_pomesht_htentry *)*hash->T);
-  if(hash->table)
-    return AY_OK;
-  else
-    return AY_EOMEM;
+  memset(hash, 0, sizeof(ay_pomesht_hash));
+
+  hash->cv = cv;
+  hash->n = n;
+  hash->stride = stride;
+  hash->newcv = newcv;
+  hash->h = AY_POMESHTCELLSIZE*AY_EPSILON;
+
+  /* there are at most n different cells, keep the load below 50% */
+  hash->T = 16;
+  while(hash->T < 2*n)
+    hash->T *= 2;
+
+  if(!(hash->table = malloc(hash->T*sizeof(ay_pomesht_hslot))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  for(i = 0; i < hash->T; i++)
+    hash->table[i].head = -1;
+
+  if(!(hash->next = malloc(n*sizeof(int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  if(!(hash->cells = malloc(n*3*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  if(!(hash->hashes = malloc(n*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  if(n >= AY_POMESHTMINPARVERTS)
+    nchunks = ay_tp_getnumthreads()*4;
+  hash->chunk = (n + nchunks - 1) / nchunks;
+  if(hash->chunk == 0)
+    hash->chunk = 1;
+  nchunks = (n + hash->chunk - 1) / hash->chunk;
+
+  ay_status = ay_tp_run(nchunks, ay_pomesht_hashcb, hash);
+
+cleanup:
+
+  if(ay_status)
+    ay_pomesht_destroyhash(hash);
+
+ return ay_status;
 } /* ay_pomesht_inithash */
 
 
-/* ay_pomesht_inithash:
+/* ay_pomesht_destroyhash:
  *  helper for ay_pomesht_optimizecoords() below
  *  destroy the hash table
  */
 void
 ay_pomesht_destroyhash(ay_pomesht_hash *hash)
 {
- int i;
- ay_pomesht_htentry *entry;
- ay_pomesht_htentry *tmp;
 
-  if(hash)
-    {
-      for(i = 0; i < hash->T; i++)
-	{
-	  entry = hash->table[i];
-	  tmp = entry;
+  if(hash->table)
+    free(hash->table);
 
-	  while(tmp)
-	    {
-	      tmp = entry->next;
-	      free(entry);
-	      entry = tmp;
-	    } /* while */
-	} /* for */
+  if(hash->next)
+    free(hash->next);
 
-      if(hash->table)
-	free(hash->table);
+  if(hash->cells)
+    free(hash->cells);
 
-      free(hash);
-    } /* if */
+  if(hash->hashes)
+    free(hash->hashes);
+
+  memset(hash, 0, sizeof(ay_pomesht_hash));
 
  return;
 } /* ay_pomesht_destroyhash */
 
 
-/* ay_pomesht_addvertextohash:
+/* ay_pomesht_findslot:
  *  helper for ay_pomesht_optimizecoords() below
- *  add point <point> to the hash table <phash>
- *  (if it is not present already)
+ *  find the slot of grid cell <cell> (with hash value <h>) in the
+ *  hash table (open addressing, linear probing); returns the slot
+ *  of the cell or the empty slot where the cell would be entered
  */
-int
-ay_pomesht_addvertextohash(ay_pomesht_hash *phash, double normal_epsilon,
-			   double *point)
+ay_pomesht_hslot *
+ay_pomesht_findslot(ay_pomesht_hash *hash, double *cell, unsigned int h)
 {
- unsigned int index;
- ay_pomesht_htentry *entry;
- ay_pomesht_htentry *chain;
- double x, y, z, angle, V1[3], *V2;
+ ay_pomesht_hslot *slot;
+ unsigned int i, mask = hash->T-1;
+ double *q;
+
+  i = h & mask;
+  while(1)
+    {
+      slot = &(hash->table[i]);
+      if(slot->head == -1)
+	return slot;
+      if(slot->hash == h)
+	{
+	  /* compare with the cell of the newest vertex in this slot */
+	  q = &(hash->newcv[slot->head*hash->stride]);
+	  if(AY_POMESHTCELL(q[0], hash->h) == cell[0] &&
+	     AY_POMESHTCELL(q[1], hash->h) == cell[1] &&
+	     AY_POMESHTCELL(q[2], hash->h) == cell[2])
+	    return slot;
+	}
+      i = (i+1) & mask;
+    }
 
-  x = point[0];
-  y = point[1];
-  z = point[2];
+ /* not reached */
+} /* ay_pomesht_findslot */
 
-  index = (unsigned int)((3 * fabs(x) + 5 * fabs(y) + 7 * fabs(z)) *
-			 phash->c + 0.5f) % phash->T;
 
-  entry = phash->table[index];
+/* ay_pomesht_matchvertex:
+ *  helper for ay_pomesht_addvertextohash() below
+ *  check whether the new vertex <e> equals <point> (within AY_EPSILON,
+ *  and within <normal_epsilon> degrees regarding the normals)
+ */
+int
+ay_pomesht_matchvertex(ay_pomesht_hash *phash, double normal_epsilon,
+		       int e, double *point)
+{
+ double *q, *n1, *n2, angle;
 
-  phash->found = AY_FALSE;
+  q = &(phash->newcv[e*phash->stride]);
+  if(!AYVCOMP(q[0], q[1], q[2], point[0], point[1], point[2]))
+    return AY_FALSE;
 
-  if(entry)
+  /* honour normals? */
+  if(normal_epsilon != DBL_MAX)
     {
-      chain = entry;
+      n1 = &(q[3]);
+      n2 = &(point[3]);
+      angle = AY_V3DOT(n1, n2);
+      if(angle <= -1.0)
+	angle = -180.0;
+      else
+	if(angle >= 1.0)
+	  angle = 0.0;
+	else
+	  angle = AY_R2D(acos(angle));
+      if(angle > normal_epsilon)
+	return AY_FALSE;
+    }
+
+ return AY_TRUE;
+} /* ay_pomesht_matchvertex */
+
+
+/* ay_pomesht_addvertextohash:
+ *  helper for ay_pomesht_optimizecoords() below
+ *  look up vertex <i> (of the vertices the hash was initialized with)
+ *  in the hash table <phash>; all vertices within AY_EPSILON (and
+ *  within <normal_epsilon> degrees regarding their normals) are
+ *  considered equal, if there are multiple matches the oldest entry
+ *  is used; if no entry was found (phash->found is AY_FALSE), vertex <i>
+ *  is added with index phash->index (it must already be copied to
+ *  phash->newcv at this index);
+ *  vertices with non-finite coordinates or with grid cells that can
+ *  not be represented exactly are looked up by a linear search
+ */
+void
+ay_pomesht_addvertextohash(ay_pomesht_hash *phash, double normal_epsilon,
+			   unsigned int i)
+{
+ ay_pomesht_hslot *slot;
+ double *point, *c, lo[3], hi[3], cell[3];
+ int e, best = -1, stride = phash->stride, d0, d1, d2;
+
+  point = &(phash->cv[i*stride]);
+  c = &(phash->cells[i*3]);
 
-      while(chain)
+  if(!(fabs(c[0]) < AY_POMESHTMAXCELL) ||
+     !(fabs(c[1]) < AY_POMESHTMAXCELL) ||
+     !(fabs(c[2]) < AY_POMESHTMAXCELL))
+    {
+      /* linear search */
+      for(e = 0; e < (int)phash->index; e++)
 	{
-	  /* ignore normals? */
-          if(normal_epsilon == DBL_MAX)
+	  if(ay_pomesht_matchvertex(phash, normal_epsilon, e, point))
 	    {
-	      if(AYVCOMP(chain->x, chain->y, chain->z, x, y, z))
-		{
-		  phash->index = chain->index;
-		  phash->found = AY_TRUE;
-		  break;
-		} /* if */
+	      best = e;
+	      break;
 	    }
-	  else
+	}
+    }
+  else
+    {
+      /* the cells touched by the epsilon box around the vertex;
+	 as AY_EPSILON is smaller than half a cell, these are
+	 direct neighbors of the cell of the vertex */
+      lo[0] = AY_POMESHTCELL(point[0]-AY_EPSILON, phash->h);
+      lo[1] = AY_POMESHTCELL(point[1]-AY_EPSILON, phash->h);
+      lo[2] = AY_POMESHTCELL(point[2]-AY_EPSILON, phash->h);
+      hi[0] = AY_POMESHTCELL(point[0]+AY_EPSILON, phash->h);
+      hi[1] = AY_POMESHTCELL(point[1]+AY_EPSILON, phash->h);
+      hi[2] = AY_POMESHTCELL(point[2]+AY_EPSILON, phash->h);
+
+      for(d0 = -1; d0 <= 1; d0++)
+	{
+	  cell[0] = c[0] + d0;
+	  if(cell[0] < lo[0] || cell[0] > hi[0])
+	    continue;
+	  for(d1 = -1; d1 <= 1; d1++)
 	    {
-	      if(AYVCOMP(chain->x, chain->y, chain->z, x, y, z))
+	      cell[1] = c[1] + d1;
+	      if(cell[1] < lo[1] || cell[1] > hi[1])
+		continue;
+	      for(d2 = -1; d2 <= 1; d2++)
 		{
-		  V1[0] = chain->nx;
-		  V1[1] = chain->ny;
-		  V1[2] = chain->nz;
-		  V2 = &(point[3]);
-		  angle = AY_V3DOT(V1, V2);
-		  if(angle <= -1.0)
-		    angle = -180.0;
+		  cell[2] = c[2] + d2;
+		  if(cell[2] < lo[2] || cell[2] > hi[2])
+		    continue;
+
+		  if(!d0 && !d1 && !d2)
+		    slot = ay_pomesht_findslot(phash, cell,
+					       phash->hashes[i]);
 		  else
-		    if(angle >= 1.0)
-		      angle = 0.0;
-		    else
-		      angle = AY_R2D(acos(angle));
-		  if(angle <= normal_epsilon)
+		    slot = ay_pomesht_findslot(phash, cell,
+					       ay_pomesht_hashcell(cell));
+
+		  for(e = slot->head; e != -1; e = phash->next[e])
 		    {
-		      phash->index = chain->index;
-		      phash->found = AY_TRUE;
-		      break;
-		    } /* if */
-		} /* if */
-	    } /* if */
-	  chain = chain->next;
-	} /* while */
+		      if(best != -1 && e > best)
+			continue;
+		      if(ay_pomesht_matchvertex(phash, normal_epsilon, e,
+						 point))
+			best = e;
+		    } /* for */
+		} /* for */
+	    } /* for */
+	} /* for */
     } /* if */
 
-  /* add new entry? */
-  if(!phash->found)
+  if(best != -1)
     {
-      ay_pomesht_htentry *new;
-
-      if(!(new = (ay_pomesht_htentry *)calloc(1, sizeof(ay_pomesht_htentry))))
-	{
-	  return AY_EOMEM;
-	}
-
-      new->index = phash->index;
-      new->x = x;
-      new->y = y;
-      new->z = z;
-
-      /* use normals? */
-      if(normal_epsilon != DBL_MAX)
-	{
-	  new->nx = point[3];
-	  new->ny = point[4];
-	  new->nz = point[5];
-	}
+      phash->found = AY_TRUE;
+      phash->index = (unsigned int)best;
+      return;
+    }
 
-      if(entry)
-	new->next = entry;
+  phash->found = AY_FALSE;
 
-      phash->table[index] = new;
-    } /* if */
+  /* add new entry */
+  slot = ay_pomesht_findslot(phash, c, phash->hashes[i]);
+  slot->hash = phash->hashes[i];
+  phash->next[phash->index] = slot->head;
+  slot->head = (int)phash->index;
 
- return AY_OK;
+ return;
 } /* ay_pomesht_addvertextohash */
 
 
@@ -1080,10 +1268,11 @@ ay_pomesht_optimizecoords(ay_pomesh_object *pomesh, double normal_epsilon,
 {
  int ay_status = AY_OK;
  ay_point *s;
- ay_pomesht_hash *phash;
+ ay_pomesht_hash hash = {0};
  unsigned int i, total_loops = 0, total_verts = 0;
- unsigned int p, dp, *newverts = NULL;
- int found, stride;
+ unsigned int c, dp, *newverts = NULL, *map = NULL;
+ int stride;
+ char *selected = NULL;
  double *newcontrolv = NULL, *tmp = NULL;
 
   /* can we optimize at all? */
@@ -1103,7 +1292,7 @@ ay_pomesht_optimizecoords(ay_pomesh_object *pomesh, double normal_epsilon,
 
   if(!(newverts = (unsigned int *)calloc(1, sizeof(unsigned int) *
 					 total_verts)))
-    { return AY_EOMEM; }
+    { ay_status = AY_EOMEM; goto cleanup; }
 
   if(pomesh->has_normals)
     stride = 6;
@@ -1112,14 +1301,31 @@ ay_pomesht_optimizecoords(ay_pomesh_object *pomesh, double normal_epsilon,
 
   if(!(newcontrolv = (double *)calloc(1, pomesh->ncontrols * stride *
 				      sizeof(double))))
-    { free(newverts); return AY_EOMEM; }
+    { ay_status = AY_EOMEM; goto cleanup; }
 
-  phash = (ay_pomesht_hash *)calloc(1, sizeof(ay_pomesht_hash));
-  phash->T = total_verts/5;		/* hashtablesize */
-  phash->c = 1024;
+  /* map from old to new vertex indices, vertices referenced multiple
+     times need to be looked up only once */
+  if(!(map = malloc(pomesh->ncontrols * sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  memset(map, 0xff, pomesh->ncontrols * sizeof(unsigned int));
 
-  if(ay_pomesht_inithash(phash) == AY_EOMEM)
-    { free(newverts); free(newcontrolv); return AY_EOMEM; }
+  if(selp)
+    {
+      if(!(selected = calloc(pomesh->ncontrols, sizeof(char))))
+	{ ay_status = AY_EOMEM; goto cleanup; }
+      s = selp;
+      while(s)
+	{
+	  if(s->index < pomesh->ncontrols)
+	    selected[s->index] = AY_TRUE;
+	  s = s->next;
+	}
+    }
+
+  ay_status = ay_pomesht_inithash(&hash, pomesh->controlv,
+				  pomesh->ncontrols, stride, newcontrolv);
+  if(ay_status)
+    goto cleanup;
 
   dp = 0;
 
@@ -1130,92 +1336,72 @@ ay_pomesht_optimizecoords(ay_pomesh_object *pomesh, double normal_epsilon,
 
   for(i = 0; i < total_verts; i++)
     {
-      p = pomesh->verts[i] * stride;
+      c = pomesh->verts[i];
 
-      phash->found = AY_FALSE;
-      phash->index = dp;
+      if(map[c] == (unsigned int)-1)
+	{
+	  hash.found = AY_FALSE;
+	  hash.index = dp;
 
-      ay_status = ay_pomesht_addvertextohash(phash, normal_epsilon,
-					     &(pomesh->controlv[p]));
+	  memcpy(&(newcontrolv[dp*stride]), &(pomesh->controlv[c*stride]),
+		 stride * sizeof(double));
 
-      if(ay_status)
-	{
-	  break;
-	}
+	  ay_pomesht_addvertextohash(&hash, normal_epsilon, c);
 
-      if(phash->found)
-	{
-	  if(!selp)
+	  /* only optimize selected points */
+	  if(hash.found && (!selected || selected[c]))
 	    {
-	      newverts[i] = phash->index;
+	      map[c] = hash.index;
 	    }
 	  else
 	    {
-	      /* only optimize selected points */
-	      found = AY_FALSE;
-	      s = selp;
-	      while(s)
-		{
-		  if(s->index == pomesh->verts[i])
-		    {
-		      found = AY_TRUE;
-		      newverts[i] = phash->index;
-		      break;
-		    }
-		  s = s->next;
-		}
-
-	      if(!found)
-		{
-		  newverts[i] = dp;
-		  memcpy(&(newcontrolv[dp*stride]), &(pomesh->controlv[p]),
-			 stride * sizeof(double));
-		  if(ois)
-		    ois[dp] = pomesh->verts[i];
-		  dp++;
-		}
-	    }
-	}
-      else
-	{
-	  newverts[i] = dp;
-	  memcpy(&(newcontrolv[dp*stride]), &(pomesh->controlv[p]),
-		 stride * sizeof(double));
-	  if(ois)
-	    ois[dp] = pomesh->verts[i];
-	  dp++;
+	      if(ois)
+		ois[dp] = c;
+	      map[c] = dp;
+	      dp++;
+	    } /* if */
 	} /* if */
-    } /* for */
 
-  ay_pomesht_destroyhash(phash);
+      newverts[i] = map[c];
+    } /* for */
 
-  if(!ay_status)
-    {
-      if(pomesh->verts)
-	free(pomesh->verts);
+  if(pomesh->verts)
+    free(pomesh->verts);
 
-      if(pomesh->controlv)
-	free(pomesh->controlv);
+  if(pomesh->controlv)
+    free(pomesh->controlv);
 
-      pomesh->verts = newverts;
-      pomesh->controlv = newcontrolv;
-      pomesh->ncontrols = dp;
-      if((tmp = realloc(pomesh->controlv, pomesh->ncontrols * stride *
-			sizeof(double))))
-	{
-	  pomesh->controlv = tmp;
-	}
-      if(ois && oislen)
-	{
-	  *oislen = dp;
-	}
+  pomesh->verts = newverts;
+  newverts = NULL;
+  pomesh->controlv = newcontrolv;
+  newcontrolv = NULL;
+  pomesh->ncontrols = dp;
+  if((tmp = realloc(pomesh->controlv, pomesh->ncontrols * stride *
+		    sizeof(double))))
+    {
+      pomesh->controlv = tmp;
     }
-  else
+  if(ois && oislen)
     {
-      free(newverts);
-      free(newcontrolv);
+      *oislen = dp;
     }
 
+cleanup:
+
+  ay_pomesht_destroyhash(&hash);
+
+  if(newverts)
+    free(newverts);
+
+  if(newcontrolv)
+    free(newcontrolv);
+
+  if(map)
+    free(map);
+
+  if(selected)
+    free(selected);
+
  return ay_status;
 } /* ay_pomesht_optimizecoords */
 
@@ -36,6 +36,10 @@ ay_prefs_gettcmd(ClientData clientData, Tcl_Interp *interp,
 		Tcl_NewIntObj(ay_prefs.lazynotify),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 
+  Tcl_SetVar2Ex(interp, arr, "LazyLoad",
+		Tcl_NewIntObj(ay_prefs.lazyload),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
   Tcl_SetVar2Ex(interp, arr, "CompleteNotify",
 		Tcl_NewIntObj(ay_prefs.completenotify),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
@@ -72,6 +76,10 @@ ay_prefs_gettcmd(ClientData clientData, Tcl_Interp *interp,
 		Tcl_NewIntObj(ay_prefs.undo_levels),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 
+  Tcl_SetVar2Ex(interp, arr, "UndoMemory",
+		Tcl_NewIntObj(ay_prefs.undo_memory),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
   Tcl_SetVar2Ex(interp, arr, "Snap3D",
 		Tcl_NewIntObj(ay_prefs.snap3d),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
@@ -216,6 +224,14 @@ ay_prefs_gettcmd(ClientData clientData, Tcl_Interp *interp,
 		Tcl_NewIntObj(ay_prefs.cullfaces),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 
+  Tcl_SetVar2Ex(interp, arr, "CullObjects",
+		Tcl_NewIntObj(ay_prefs.cullobjects),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
+  Tcl_SetVar2Ex(interp, arr, "CullSize",
+		Tcl_NewIntObj(ay_prefs.cullsize),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
   Tcl_SetVar2Ex(interp, arr, "ResInstances",
 		Tcl_NewIntObj(ay_prefs.resolveinstances),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
@@ -244,6 +260,22 @@ ay_prefs_gettcmd(ClientData clientData, Tcl_Interp *interp,
 		Tcl_NewIntObj(ay_prefs.excludehidden),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 
+  Tcl_SetVar2Ex(interp, arr, "RIBFormat",
+		Tcl_NewIntObj(ay_prefs.ribformat),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
+  Tcl_SetVar2Ex(interp, arr, "RIBCompress",
+		Tcl_NewIntObj(ay_prefs.ribcompress),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
+  Tcl_SetVar2Ex(interp, arr, "RIBCache",
+		Tcl_NewIntObj(ay_prefs.ribcache),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
+  Tcl_SetVar2Ex(interp, arr, "RIBParallel",
+		Tcl_NewIntObj(ay_prefs.ribparallel),
+		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+
   Tcl_SetVar2Ex(interp, arr, "SingleWindow",
 		Tcl_NewIntObj(ay_prefs.single_window),
 		TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
@@ -477,6 +509,16 @@ ay_prefs_settcmd(ClientData clientData, Tcl_Interp *interp,
 	to = Tcl_GetVar2Ex(interp, arr, "CullFaces",
 			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	Tcl_GetIntFromObj(interp, to, &(ay_prefs.cullfaces));
+
+	to = Tcl_GetVar2Ex(interp, arr, "CullObjects",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.cullobjects));
+
+	to = Tcl_GetVar2Ex(interp, arr, "CullSize",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.cullsize));
+	if(ay_prefs.cullsize < 0)
+	  ay_prefs.cullsize = 0;
       } /* C... */
 
     if(setall || (argv[i][0] == 'D'))
@@ -535,6 +577,10 @@ ay_prefs_settcmd(ClientData clientData, Tcl_Interp *interp,
 			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	Tcl_GetIntFromObj(interp, to, &(ay_prefs.lazynotify));
 
+	to = Tcl_GetVar2Ex(interp, arr, "LazyLoad",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.lazyload));
+
 	to = Tcl_GetVar2Ex(interp, arr, "LineWidth",
 			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	Tcl_GetDoubleFromObj(interp, to, &(ay_prefs.linewidth));
@@ -691,6 +737,22 @@ ay_prefs_settcmd(ClientData clientData, Tcl_Interp *interp,
 	to = Tcl_GetVar2Ex(interp, arr, "RIStandard",
 			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	Tcl_GetIntFromObj(interp, to, &(ay_prefs.ristandard));
+
+	to = Tcl_GetVar2Ex(interp, arr, "RIBFormat",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.ribformat));
+
+	to = Tcl_GetVar2Ex(interp, arr, "RIBCompress",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.ribcompress));
+
+	to = Tcl_GetVar2Ex(interp, arr, "RIBCache",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.ribcache));
+
+	to = Tcl_GetVar2Ex(interp, arr, "RIBParallel",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.ribparallel));
       } /* R... */
 
     if(setall || (argv[i][0] == 'S'))
@@ -798,6 +860,12 @@ ay_prefs_settcmd(ClientData clientData, Tcl_Interp *interp,
 	    ay_prefs.undo_levels = itemp;
 	  } /* if */
 
+	to = Tcl_GetVar2Ex(interp, arr, "UndoMemory",
+			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+	Tcl_GetIntFromObj(interp, to, &(ay_prefs.undo_memory));
+	if(ay_prefs.undo_memory < 0)
+	  ay_prefs.undo_memory = 0;
+
 	to = Tcl_GetVar2Ex(interp, arr, "UseMatColor",
 			   TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	Tcl_GetIntFromObj(interp, to, &(ay_prefs.use_materialcolor));
@@ -92,6 +92,7 @@ ay_prop_settcmd(ClientData clientData, Tcl_Interp *interp,
   cb = (ay_propcb *)(arr[o->type]);
   if(cb)
     {
+      ay_wrib_cacheinvalidate(o);
       ay_status = cb(interp, argc, argv, o);
     }
 
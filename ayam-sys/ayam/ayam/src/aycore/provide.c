@@ -55,6 +55,9 @@ ay_provide_object(ay_object *o, unsigned int type, ay_object **result)
   if(!o)
     return AY_ENULL;
 
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
   /* call the provide callback */
   arr = ay_providecbt.arr;
   cb = (ay_providecb *)(arr[o->type]);
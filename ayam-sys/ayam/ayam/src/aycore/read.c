@@ -422,24 +422,65 @@ ay_read_attributes(FILE *fileptr, ay_object *o)
 } /* ay_read_attributes */
 
 
-/* ay_read_tags:
- *
+/* ay_read_tagtype:
+ *  look up the type of the freshly read tag <tag> (from its name) and,
+ *  if there is no safe interpreter, disable ANS/BNS tags
  */
 int
-ay_read_tags(FILE *fileptr, ay_object *o)
+ay_read_tagtype(ay_tag *tag)
 {
  int ay_status = AY_OK;
- ay_tag *tag = NULL, **next = NULL;
  Tcl_HashEntry *entry = NULL;
- int tcount = 0, i = 0;
  char fname[] = "read_tags";
 #ifdef AYNOSAFEINTERP
  int deactivate = 0;
- char a1[] = "ay", n1[] = "scriptdisable";
  char script_disable_cmd[] = "script_disable";
  Tcl_Obj *to = NULL;
 #endif
 
+  if(!tag || !tag->name)
+    return AY_ENULL;
+
+  if(!(entry = Tcl_FindHashEntry(&ay_tagtypesht, tag->name)))
+    {
+      if(ay_prefs.wutag)
+	ay_error(AY_EWARN, fname, "Tag type is not registered!");
+    }
+  else
+    {
+      tag->type = *((unsigned int *)Tcl_GetHashValue(entry));
+    }
+
+#ifdef AYNOSAFEINTERP
+  /* if there is no safe interpreter, disable all ANS/BNS tags
+     by manipulating their type */
+  if(tag->type == ay_bns_tagtype || tag->type == ay_ans_tagtype)
+    {
+      Tcl_Eval(ay_interp, script_disable_cmd);
+      to = Tcl_GetVar2Ex(ay_interp, "ay", "scriptdisable",
+			 TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
+      if(to)
+	Tcl_GetIntFromObj(ay_interp, to, &(deactivate));
+
+      if(deactivate)
+	ay_status = ay_ns_disable(tag);
+    } /* if is bns or ans */
+#endif /* AYNOSAFEINTERP */
+
+ return ay_status;
+} /* ay_read_tagtype */
+
+
+/* ay_read_tags:
+ *
+ */
+int
+ay_read_tags(FILE *fileptr, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_tag *tag = NULL, **next = NULL;
+ int tcount = 0, i = 0;
+
   if(!o)
     return AY_ENULL;
 
@@ -460,16 +501,6 @@ ay_read_tags(FILE *fileptr, ay_object *o)
       if(!tag->name)
 	{ free(tag); return AY_ERROR; }
 
-      if(!(entry = Tcl_FindHashEntry(&ay_tagtypesht, tag->name)))
-	{
-	  if(ay_prefs.wutag)
-	    ay_error(AY_EWARN, fname, "Tag type is not registered!");
-	}
-      else
-	{
-	  tag->type = *((unsigned int *)Tcl_GetHashValue(entry));
-	}
-
      ay_status = ay_read_string(fileptr, (char**)(void*)&(tag->val));
 
       if(ay_status)
@@ -484,46 +515,12 @@ ay_read_tags(FILE *fileptr, ay_object *o)
 
       ay_tags_vttonl((char*)tag->val);
 
-#ifdef AYNOSAFEINTERP
-     /* if there is no safe interpreter, disable all ANS/BNS tags
-	by manipulating their type */
-     if(tag->type == ay_bns_tagtype)
-       {
-	 Tcl_Eval(ay_interp, script_disable_cmd);
-	 to = Tcl_GetVar2Ex(ay_interp, "ay", "scriptdisable",
-			     TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
-	 if(to)
-	   Tcl_GetIntFromObj(ay_interp, to, &(deactivate));
-
-	 if(deactivate)
-	   {
-	     ay_status = ay_ns_disable(tag);
-	     if(ay_status)
-	       {
-		 ay_tags_free(tag);
-		 break;
-	       }
-	   }
-       } /* if is bns */
-     if(tag->type == ay_ans_tagtype)
-       {
-	 Tcl_Eval(ay_interp, script_disable_cmd);
-	 to = Tcl_GetVar2Ex(ay_interp, "ay", "scriptdisable",
-			     TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
-	 if(to)
-	   Tcl_GetIntFromObj(ay_interp, to, &(deactivate));
-
-	 if(deactivate)
-	   {
-	     ay_status = ay_ns_disable(tag);
-	     if(ay_status)
-	       {
-		 ay_tags_free(tag);
-		 break;
-	       }
-	   }
-       } /* if is ans */
-#endif /* AYNOSAFEINTERP */
+      ay_status = ay_read_tagtype(tag);
+      if(ay_status)
+	{
+	  ay_tags_free(tag);
+	  break;
+	}
 
       *next = tag;
       next = &(tag->next);
@@ -623,6 +620,83 @@ cleanup:
 } /* ay_read_shader */
 
 
+/* ay_read_gettype:
+ *  get the type id <type> of the object type named <typename>,
+ *  trying to autoload a plugin of that name if the type is not
+ *  registered yet
+ */
+int
+ay_read_gettype(char *typename, unsigned int *type)
+{
+ char fname[] = "read_object";
+ Tcl_HashEntry *entry = NULL;
+ Tcl_DString ds;
+
+  if(!typename || !type)
+    return AY_ENULL;
+
+  /* is the type name registered? */
+  if((entry = Tcl_FindHashEntry(&ay_otypesht, typename)))
+    {
+      /* yes */
+      /* get type id of name */
+      *type = *((unsigned int*)Tcl_GetHashValue(entry));
+    }
+  else
+    {
+      /* no */
+      /* try to autoload the custom object/plugin */
+      Tcl_DStringInit(&ds);
+      Tcl_DStringAppend(&ds, "loadPlugin ", -1);
+      Tcl_DStringAppend(&ds, typename, -1);
+      Tcl_Eval(ay_interp, Tcl_DStringValue(&ds));
+      Tcl_DStringFree(&ds);
+
+      /* check again whether type name is registered */
+      if((entry = Tcl_FindHashEntry(&ay_otypesht, typename)))
+	{
+	  /* yes */
+	  /* get type id of name */
+	  *type = *((unsigned int *)Tcl_GetHashValue(entry));
+	}
+      else
+	{
+	  ay_error(AY_ENTYPE, fname, typename);
+	  return AY_ENTYPE;
+	} /* if */
+    } /* if */
+
+ return AY_OK;
+} /* ay_read_gettype */
+
+
+/* ay_read_linkobject:
+ *  link the freshly read object <o> to the scene and go down
+ *  into it, if children follow (<has_child>)
+ */
+void
+ay_read_linkobject(ay_object *o, int has_child)
+{
+
+  if(o->parent && (!o->down))
+    {
+      o->down = ay_endlevel;
+    }
+
+  ay_object_link(o);
+
+  if(has_child)
+    {
+      /* go down */
+      ay_clevel_add(o);
+      ay_clevel_add(o->down);
+      ay_next = &(o->down);
+    }
+
+ return;
+} /* ay_read_linkobject */
+
+
 /* ay_read_object:
  *
  */
@@ -638,8 +712,6 @@ ay_read_object(FILE *fileptr)
  ay_voidfp *arr = NULL;
  ay_readcb *cb = NULL;
  char *typename = NULL;
- Tcl_HashEntry *entry = NULL;
- Tcl_DString ds;
 
   if(feof(fileptr))
     return AY_EEOF;
@@ -671,39 +743,13 @@ ay_read_object(FILE *fileptr)
       if(!typename)
 	{ ay_object_delete(o); return AY_ERROR; }
 
-      /* is the type name registered? */
-      if((entry = Tcl_FindHashEntry(&ay_otypesht, typename)))
+      ay_status = ay_read_gettype(typename, &type);
+      free(typename);
+      if(ay_status)
 	{
-	  /* yes */
-	  /* get type id of name */
-	  type = *((unsigned int*)Tcl_GetHashValue(entry));
+	  ay_object_delete(o);
+	  return AY_OK;
 	}
-      else
-	{
-	  /* no */
-	  /* try to autoload the custom object/plugin */
-	  Tcl_DStringInit(&ds);
-	  Tcl_DStringAppend(&ds, "loadPlugin ", -1);
-	  Tcl_DStringAppend(&ds, typename, -1);
-	  Tcl_Eval(ay_interp, Tcl_DStringValue(&ds));
-	  Tcl_DStringFree(&ds);
-
-	  /* check again whether type name is registered */
-	  if((entry = Tcl_FindHashEntry(&ay_otypesht, typename)))
-	    {
-	      /* yes */
-	      /* get type id of name */
-	      type = *((unsigned int *)Tcl_GetHashValue(entry));
-	    }
-	  else
-	    {
-	      ay_error(AY_ENTYPE, fname, typename);
-	      free(typename);
-	      ay_object_delete(o);
-	      return AY_OK;
-	    } /* if */
-	} /* if */
-      free(typename);
     }
   else
     {
@@ -762,25 +808,12 @@ ay_read_object(FILE *fileptr)
 	} /* if */
     } /* if */
 
-  if(o->parent && (!o->down))
-    {
-      o->down = ay_endlevel;
-    }
-
-  ay_object_link(o);
-
   if(ay_read_version == 0)
     {
       fscanf(fileptr, "%d\n", &has_child);
     }
 
-  if(has_child)
-    {
-      /* go down */
-      ay_clevel_add(o);
-      ay_clevel_add(o->down);
-      ay_next = &(o->down);
-    }
+  ay_read_linkobject(o, has_child);
 
  return ay_status;
 } /* ay_read_object */
@@ -823,36 +856,44 @@ ay_read_scene(Tcl_Interp *interp, char *filename, int insert)
       return AY_ERROR;
     }
 
-  ay_status = ay_read_header(fileptr);
-
-  if(ay_status)
+  if(ay_bin_isbinary(fileptr))
     {
-      fclose(fileptr);
-      ay_error(ay_status, fname, filename);
-      ay_prefs.save_rootviews = old_save_rv;
-      return AY_ERROR;
+      /* binary scene file */
+      ay_status = ay_bin_readscene(fileptr);
     }
-
-  while(!ay_status)
+  else
     {
-      ay_status = ay_read_object(fileptr);
+      ay_status = ay_read_header(fileptr);
+
       if(ay_status)
 	{
-	  if(ay_status != AY_EEOF)
+	  fclose(fileptr);
+	  ay_error(ay_status, fname, filename);
+	  ay_prefs.save_rootviews = old_save_rv;
+	  return AY_ERROR;
+	}
+
+      while(!ay_status)
+	{
+	  ay_status = ay_read_object(fileptr);
+	  if(ay_status)
 	    {
-	      /* issue errmsg */
-	      ay_error(ay_status, fname, NULL);
-	      if(ay_prefs.onerror)
+	      if(ay_status != AY_EEOF)
 		{
-		  ay_status = AY_OK;
+		  /* issue errmsg */
+		  ay_error(ay_status, fname, NULL);
+		  if(ay_prefs.onerror)
+		    {
+		      ay_status = AY_OK;
+		    } /* if */
 		} /* if */
 	    } /* if */
-	} /* if */
 
-    } /* while */
+	} /* while */
 
-  if(ay_status == AY_EEOF)
-    ay_status = AY_OK;
+      if(ay_status == AY_EEOF)
+	ay_status = AY_OK;
+    } /* if */
 
   fclose(fileptr);
 
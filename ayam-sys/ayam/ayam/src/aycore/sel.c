@@ -70,6 +70,10 @@ ay_sel_add(ay_object *o, int set_selflag)
       return AY_EOMEM;
     }
 
+  /* selected objects are subject to editing */
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
   new_sel->object = o;
   if(set_selflag)
     {
@@ -14,6 +14,65 @@
 
 /* selp.c - selected points related functions */
 
+/* Point picking index:
+ * to pick points of objects with many points in logarithmic time,
+ * the (object space) coordinates of the points are sorted into a
+ * bounding volume hierarchy that is cached per object in
+ * ay_selp_pindexht until ay_selp_cacheinvalidate() is called for the
+ * object (which happens upon notification and deletion);
+ * the index also remembers the point array it was built from, so that
+ * a changed array (address, length, stride, rational mode) leads to a
+ * rebuild
+ */
+
+/* minimum number of points for which an index is built */
+#define AY_SELP_PINDEXMIN 128
+
+/* maximum number of points in a leaf of the index */
+#define AY_SELP_PLEAFSIZE 8
+
+/* types local to this module: */
+typedef struct ay_selp_pinode_s {
+  double bb[6]; /* xmin, xmax, ymin, ymax, zmin, zmax */
+  unsigned int start; /* first point (in perm) */
+  unsigned int count; /* number of points */
+  unsigned int left, right; /* children (0 for leaves) */
+} ay_selp_pinode;
+
+typedef struct ay_selp_pindex_s {
+  double *arr; /* point array the index was built from */
+  unsigned int arrlen; /* number of points in arr */
+  int stride; /* stride of arr */
+  int ishom; /* multiply coordinates with weight? */
+  double *pnts; /* (euclidean) coordinates [arrlen*3] */
+  unsigned int *perm; /* point indices, sorted by the nodes [arrlen] */
+  ay_selp_pinode *nodes; /* nodes, nodes[0] is the root */
+  unsigned int nodeslen; /* number of used nodes */
+  unsigned int nodesalloc; /* number of allocated nodes */
+} ay_selp_pindex;
+
+/* local variables: */
+static Tcl_HashTable ay_selp_pindexht;
+
+/* prototypes of functions local to this module: */
+void ay_selp_pindexfree(ay_selp_pindex *pi);
+
+int ay_selp_pindexbuild(ay_selp_pindex *pi, unsigned int start,
+			unsigned int count, unsigned int *node);
+
+ay_selp_pindex *ay_selp_getpindex(ay_object *o, unsigned int arrlen,
+				  int stride, int ishom, double *arr);
+
+void ay_selp_pindexnearest(ay_selp_pindex *pi, unsigned int n, double *p,
+			   double *min_dist, unsigned int *index, int *found);
+
+int ay_selp_pindexinside(ay_selp_pindex *pi, unsigned int n, double *pl,
+			 unsigned int *num, unsigned int *alloc,
+			 unsigned int **indices);
+
+int ay_selp_cmpindex(const void *a, const void *b);
+
+
 /* ay_selp_clear:
  *  clear list of selected points from object o
  */
@@ -1011,11 +1070,10 @@ ay_selp_getpnts(int mode, ay_object *o, double *p, ay_pointedit *pe,
 		int readonly, int arrlen, int stride, int ishom, double *arr)
 {
  ay_point *pnt = NULL, **lastpnt = NULL;
- double min_dist = ay_prefs.pick_epsilon, dist = 0.0;
- double **pecoords = NULL, **pecoordstmp, *pecoord = NULL, *c;
- double h[3];
- int i = 0, j = 0, a = 0;
- unsigned int *peindices = NULL, *peindicestmp, peindex = 0;
+ double min_dist = ay_prefs.pick_epsilon;
+ double **pecoords = NULL, *pecoord = NULL;
+ int i = 0, a = 0;
+ unsigned int *peindices = NULL, peindex = 0, num = 0;
 
   if(!o || !arr)
     return AY_ENULL;
@@ -1055,33 +1113,12 @@ ay_selp_getpnts(int mode, ay_object *o, double *p, ay_pointedit *pe,
       break;
     case 1:
       /* selection based on a single point */
-      for(i = 0; i < arrlen; i++)
-	{
-	  if(stride == 4 && ishom)
-	    {
-	      dist = AY_VLEN((p[0] - arr[j]*arr[j+3]),
-			     (p[1] - arr[j+1]*arr[j+3]),
-			     (p[2] - arr[j+2]*arr[j+3]));
-	    }
-	  else
-	    {
-	      dist = AY_VLEN((p[0] - arr[j]),
-			     (p[1] - arr[j+1]),
-			     (p[2] - arr[j+2]));
-	    }
-	  if(dist < min_dist)
-	    {
-	      pecoord = &(arr[j]);
-	      peindex = i;
-	      min_dist = dist;
-	    }
-
-	  j += stride;
-	} /* for */
-
-      if(!pecoord)
+      if(!ay_selp_nearest(o, (unsigned int)arrlen, stride,
+			  (stride == 4 && ishom), arr, p, &min_dist, &peindex))
 	return AY_OK; /* XXXX should this return a 'AY_EPICK' ? */
 
+      pecoord = &(arr[peindex*stride]);
+
       if(!(pe->coords = malloc(sizeof(double *))))
 	return AY_EOMEM;
 
@@ -1094,62 +1131,25 @@ ay_selp_getpnts(int mode, ay_object *o, double *p, ay_pointedit *pe,
       break;
     case 2:
       /* selection based on planes */
-      j = 0;
-      a = 0;
-      for(i = 0; i < arrlen; i++)
-	{
-	  if(stride == 4 && ishom)
-	    {
-	      c = h;
-	      h[0] = arr[j]*arr[j+3];
-	      h[1] = arr[j+1]*arr[j+3];
-	      h[2] = arr[j+2]*arr[j+3];
-	    }
-	  else
-	    {
-	      c = &(arr[j]);
-	    }
-
-	  /* test point c against the four planes in p */
-	  if(((p[0]*c[0] + p[1]*c[1] + p[2]*c[2] + p[3]) < 0.0) &&
-	     ((p[4]*c[0] + p[5]*c[1] + p[6]*c[2] + p[7]) < 0.0) &&
-	     ((p[8]*c[0] + p[9]*c[1] + p[10]*c[2] + p[11]) < 0.0) &&
-	     ((p[12]*c[0] + p[13]*c[1] + p[14]*c[2] + p[15]) < 0.0))
-	    {
-	      if(!(pecoordstmp = realloc(pecoords, (a+1)*sizeof(double *))))
-		{
-		  if(pecoords)
-		    free(pecoords);
-		  if(peindices)
-		    free(peindices);
-		  return AY_EOMEM;
-		}
-	      pecoords = pecoordstmp;
-	      if(!(peindicestmp = realloc(peindices,
-				       (a+1)*sizeof(unsigned int))))
-		{
-		  if(pecoords)
-		    free(pecoords);
-		  if(peindices)
-		    free(peindices);
-		  return AY_EOMEM;
-		}
-	      peindices = peindicestmp;
+      if(ay_selp_inside(o, (unsigned int)arrlen, stride,
+			(stride == 4 && ishom), arr, p, &num, &peindices))
+	return AY_EOMEM;
 
-	      pecoords[a] = &(arr[j]);
-	      peindices[a] = i;
-	      a++;
-	    } /* if */
+      if(!peindices)
+	return AY_OK; /* XXXX should this return a 'AY_EPICK' ? */
 
-	  j += stride;
-	} /* for */
+      if(!(pecoords = malloc(num*sizeof(double *))))
+	{
+	  free(peindices);
+	  return AY_EOMEM;
+	}
 
-      if(!pecoords)
-	return AY_OK; /* XXXX should this return a 'AY_EPICK' ? */
+      for(a = 0; a < (int)num; a++)
+	pecoords[a] = &(arr[peindices[a]*stride]);
 
       pe->coords = pecoords;
       pe->indices = peindices;
-      pe->num = a;
+      pe->num = num;
       break;
     case 3:
       /* rebuild from o->selp */
@@ -1816,3 +1816,578 @@ ay_selp_find(ay_point *selp, double *point)
 
  return AY_FALSE;
 } /* ay_selp_find */
+
+
+/* ay_selp_pindexfree:
+ *  free the point picking index <pi>
+ */
+void
+ay_selp_pindexfree(ay_selp_pindex *pi)
+{
+
+  if(!pi)
+    return;
+
+  if(pi->pnts)
+    free(pi->pnts);
+  if(pi->perm)
+    free(pi->perm);
+  if(pi->nodes)
+    free(pi->nodes);
+
+  free(pi);
+
+ return;
+} /* ay_selp_pindexfree */
+
+
+/* ay_selp_pindexbuild:
+ *  build the (sub-)hierarchy for the <count> points at <start> in the
+ *  permutation of point picking index <pi>, the index of the new node
+ *  is returned in <node>
+ */
+int
+ay_selp_pindexbuild(ay_selp_pindex *pi, unsigned int start,
+		    unsigned int count, unsigned int *node)
+{
+ int ay_status = AY_OK;
+ ay_selp_pinode *nd, *tnodes;
+ double *c, *bb, pivot;
+ unsigned int mid, t, n, axis = 0;
+ int i, j, l, r;
+
+  if(pi->nodeslen == pi->nodesalloc)
+    {
+      if(!(tnodes = realloc(pi->nodes,
+			    2*pi->nodesalloc*sizeof(ay_selp_pinode))))
+	return AY_EOMEM;
+      pi->nodes = tnodes;
+      pi->nodesalloc *= 2;
+    }
+
+  n = pi->nodeslen;
+  pi->nodeslen++;
+  *node = n;
+
+  nd = &(pi->nodes[n]);
+  nd->start = start;
+  nd->count = count;
+  nd->left = 0;
+  nd->right = 0;
+
+  bb = nd->bb;
+  bb[0] = DBL_MAX; bb[1] = -DBL_MAX;
+  bb[2] = DBL_MAX; bb[3] = -DBL_MAX;
+  bb[4] = DBL_MAX; bb[5] = -DBL_MAX;
+  for(t = start; t < start+count; t++)
+    {
+      c = &(pi->pnts[pi->perm[t]*3]);
+      for(j = 0; j < 3; j++)
+	{
+	  if(c[j] < bb[j*2])
+	    bb[j*2] = c[j];
+	  if(c[j] > bb[j*2+1])
+	    bb[j*2+1] = c[j];
+	}
+    }
+
+  if(count <= AY_SELP_PLEAFSIZE)
+    return AY_OK;
+
+  /* split at the median of the largest extent */
+  if((bb[3]-bb[2]) > (bb[1]-bb[0]))
+    axis = 1;
+  if((bb[5]-bb[4]) > (bb[axis*2+1]-bb[axis*2]))
+    axis = 2;
+
+  if((bb[axis*2+1]-bb[axis*2]) <= 0.0)
+    return AY_OK;
+
+  /* quickselect the median into perm[mid] */
+  mid = start + count/2;
+  l = (int)start;
+  r = (int)(start + count - 1);
+  while(l < r)
+    {
+      pivot = pi->pnts[pi->perm[(l+r)/2]*3+axis];
+      i = l;
+      j = r;
+      while(i <= j)
+	{
+	  while(pi->pnts[pi->perm[i]*3+axis] < pivot)
+	    i++;
+	  while(pi->pnts[pi->perm[j]*3+axis] > pivot)
+	    j--;
+	  if(i <= j)
+	    {
+	      t = pi->perm[i];
+	      pi->perm[i] = pi->perm[j];
+	      pi->perm[j] = t;
+	      i++;
+	      j--;
+	    }
+	} /* while */
+      if((int)mid <= j)
+	r = j;
+      else
+	if((int)mid >= i)
+	  l = i;
+	else
+	  break;
+    } /* while */
+
+  /* nodes may move (realloc), always index them */
+  ay_status = ay_selp_pindexbuild(pi, start, mid-start, &t);
+  if(ay_status)
+    return ay_status;
+  pi->nodes[n].left = t;
+
+  ay_status = ay_selp_pindexbuild(pi, mid, start+count-mid, &t);
+  if(ay_status)
+    return ay_status;
+  pi->nodes[n].right = t;
+
+ return AY_OK;
+} /* ay_selp_pindexbuild */
+
+
+/* ay_selp_getpindex:
+ *  get the (cached) point picking index of the <arrlen> points in
+ *  <arr> (with <stride>) of object <o>, build it if necessary;
+ *  returns NULL if there are too few points for an index or an error
+ *  occured (then, the points are to be checked one by one)
+ */
+ay_selp_pindex *
+ay_selp_getpindex(ay_object *o, unsigned int arrlen, int stride, int ishom,
+		  double *arr)
+{
+ Tcl_HashEntry *entry = NULL;
+ ay_selp_pindex *pi = NULL;
+ double *c;
+ unsigned int i, root;
+ int new_item = 0;
+
+  if(arrlen < AY_SELP_PINDEXMIN)
+    return NULL;
+
+  entry = Tcl_CreateHashEntry(&ay_selp_pindexht, (char*)o, &new_item);
+  if(!new_item)
+    {
+      pi = (ay_selp_pindex *)Tcl_GetHashValue(entry);
+      if(pi->arr == arr && pi->arrlen == arrlen && pi->stride == stride &&
+	 pi->ishom == ishom)
+	return pi;
+      ay_selp_pindexfree(pi);
+      pi = NULL;
+    }
+
+  if(!(pi = calloc(1, sizeof(ay_selp_pindex))))
+    goto cleanup;
+
+  pi->arr = arr;
+  pi->arrlen = arrlen;
+  pi->stride = stride;
+  pi->ishom = ishom;
+
+  if(!(pi->pnts = malloc(arrlen*3*sizeof(double))))
+    goto cleanup;
+  if(!(pi->perm = malloc(arrlen*sizeof(unsigned int))))
+    goto cleanup;
+  pi->nodesalloc = 2*(arrlen/AY_SELP_PLEAFSIZE)+1;
+  if(!(pi->nodes = malloc(pi->nodesalloc*sizeof(ay_selp_pinode))))
+    goto cleanup;
+
+  c = arr;
+  for(i = 0; i < arrlen; i++)
+    {
+      if(ishom)
+	{
+	  pi->pnts[i*3]   = c[0]*c[3];
+	  pi->pnts[i*3+1] = c[1]*c[3];
+	  pi->pnts[i*3+2] = c[2]*c[3];
+	}
+      else
+	{
+	  memcpy(&(pi->pnts[i*3]), c, 3*sizeof(double));
+	}
+      pi->perm[i] = i;
+      c += stride;
+    }
+
+  if(ay_selp_pindexbuild(pi, 0, arrlen, &root))
+    goto cleanup;
+
+  Tcl_SetHashValue(entry, (ClientData)pi);
+
+ return pi;
+
+cleanup:
+
+  ay_selp_pindexfree(pi);
+  Tcl_DeleteHashEntry(entry);
+
+ return NULL;
+} /* ay_selp_getpindex */
+
+
+/* ay_selp_pindexnearest:
+ *  find the point nearest to <p> (closer than <min_dist>) in the
+ *  sub-hierarchy at node <n> of point picking index <pi>;
+ *  of equally distant points, the one with the lowest index is found
+ */
+void
+ay_selp_pindexnearest(ay_selp_pindex *pi, unsigned int n, double *p,
+		      double *min_dist, unsigned int *index, int *found)
+{
+ ay_selp_pinode *nd = &(pi->nodes[n]), *l, *r;
+ double d[3], dist, dl, dr, *c;
+ unsigned int i, j, first, second;
+
+  /* distance to the bounding box of the node */
+  for(j = 0; j < 3; j++)
+    {
+      if(p[j] < nd->bb[j*2])
+	d[j] = nd->bb[j*2] - p[j];
+      else
+	if(p[j] > nd->bb[j*2+1])
+	  d[j] = p[j] - nd->bb[j*2+1];
+	else
+	  d[j] = 0.0;
+    }
+  if(AY_VLEN(d[0], d[1], d[2]) > *min_dist)
+    return;
+
+  if(!nd->left)
+    {
+      for(i = nd->start; i < nd->start+nd->count; i++)
+	{
+	  c = &(pi->pnts[pi->perm[i]*3]);
+	  dist = AY_VLEN((p[0] - c[0]), (p[1] - c[1]), (p[2] - c[2]));
+	  if((dist < *min_dist) ||
+	     (*found && (dist == *min_dist) && (pi->perm[i] < *index)))
+	    {
+	      *min_dist = dist;
+	      *index = pi->perm[i];
+	      *found = AY_TRUE;
+	    }
+	}
+      return;
+    }
+
+  /* descend into the child that is nearer to p first */
+  l = &(pi->nodes[nd->left]);
+  r = &(pi->nodes[nd->right]);
+  dl = 0.0;
+  dr = 0.0;
+  for(j = 0; j < 3; j++)
+    {
+      dist = 2.0*p[j] - l->bb[j*2] - l->bb[j*2+1];
+      dl += dist*dist;
+      dist = 2.0*p[j] - r->bb[j*2] - r->bb[j*2+1];
+      dr += dist*dist;
+    }
+  if(dl <= dr)
+    {
+      first = nd->left;
+      second = nd->right;
+    }
+  else
+    {
+      first = nd->right;
+      second = nd->left;
+    }
+
+  ay_selp_pindexnearest(pi, first, p, min_dist, index, found);
+  ay_selp_pindexnearest(pi, second, p, min_dist, index, found);
+
+ return;
+} /* ay_selp_pindexnearest */
+
+
+/* ay_selp_pindexinside:
+ *  collect the indices of all points inside the four planes <pl>
+ *  in the sub-hierarchy at node <n> of point picking index <pi>
+ */
+int
+ay_selp_pindexinside(ay_selp_pindex *pi, unsigned int n, double *pl,
+		     unsigned int *num, unsigned int *alloc,
+		     unsigned int **indices)
+{
+ int ay_status = AY_OK;
+ ay_selp_pinode *nd = &(pi->nodes[n]);
+ double *c, *bb = nd->bb, *p, mind, maxd;
+ unsigned int i, j, *itmp;
+ int allin = AY_TRUE;
+
+  /* classify the bounding box of the node against the planes */
+  for(j = 0; j < 4; j++)
+    {
+      p = &(pl[j*4]);
+      mind = p[3];
+      maxd = p[3];
+      for(i = 0; i < 3; i++)
+	{
+	  if(p[i] > 0.0)
+	    {
+	      mind += p[i]*bb[i*2];
+	      maxd += p[i]*bb[i*2+1];
+	    }
+	  else
+	    {
+	      mind += p[i]*bb[i*2+1];
+	      maxd += p[i]*bb[i*2];
+	    }
+	}
+      if(mind >= 0.0)
+	return AY_OK;
+      if(maxd >= 0.0)
+	allin = AY_FALSE;
+    } /* for */
+
+  if(!allin && nd->left)
+    {
+      ay_status = ay_selp_pindexinside(pi, nd->left, pl, num, alloc, indices);
+      if(!ay_status)
+	ay_status = ay_selp_pindexinside(pi, nd->right, pl, num, alloc,
+					 indices);
+      return ay_status;
+    }
+
+  if(*num + nd->count > *alloc)
+    {
+      if(!(itmp = realloc(*indices, 2*(*num + nd->count)*
+			  sizeof(unsigned int))))
+	return AY_EOMEM;
+      *indices = itmp;
+      *alloc = 2*(*num + nd->count);
+    }
+
+  for(i = nd->start; i < nd->start+nd->count; i++)
+    {
+      c = &(pi->pnts[pi->perm[i]*3]);
+      /* test point c against the four planes in pl */
+      if(allin ||
+	 (((pl[0]*c[0] + pl[1]*c[1] + pl[2]*c[2] + pl[3]) < 0.0) &&
+	  ((pl[4]*c[0] + pl[5]*c[1] + pl[6]*c[2] + pl[7]) < 0.0) &&
+	  ((pl[8]*c[0] + pl[9]*c[1] + pl[10]*c[2] + pl[11]) < 0.0) &&
+	  ((pl[12]*c[0] + pl[13]*c[1] + pl[14]*c[2] + pl[15]) < 0.0)))
+	{
+	  (*indices)[*num] = pi->perm[i];
+	  (*num)++;
+	}
+    }
+
+ return AY_OK;
+} /* ay_selp_pindexinside */
+
+
+/* ay_selp_cmpindex:
+ *  qsort() helper to sort point indices
+ */
+int
+ay_selp_cmpindex(const void *a, const void *b)
+{
+  if(*(const unsigned int *)a < *(const unsigned int *)b)
+    return -1;
+  if(*(const unsigned int *)a > *(const unsigned int *)b)
+    return 1;
+
+ return 0;
+} /* ay_selp_cmpindex */
+
+
+/** ay_selp_nearest:
+ *  find the point of an object nearest to a given point,
+ *  uses a cached index for objects with many points
+ *
+ * \param[in] o object the points belong to (used as cache key)
+ * \param[in] arrlen number of points in \a arr
+ * \param[in] stride stride of \a arr (3, 4, or 6)
+ * \param[in] ishom if AY_TRUE, the coordinates are multiplied by
+ *  the weight (4th component)
+ * \param[in] arr point array
+ * \param[in] p point to check against [3]
+ * \param[in,out] min_dist maximum distance, returns the distance of the
+ *  found point
+ * \param[in,out] index where to store the index of the found point
+ *
+ * \returns AY_TRUE if a point closer than \a min_dist was found
+ *  (of equally distant points, the first is found), AY_FALSE else
+ */
+int
+ay_selp_nearest(ay_object *o, unsigned int arrlen, int stride, int ishom,
+		double *arr, double *p, double *min_dist, unsigned int *index)
+{
+ ay_selp_pindex *pi = NULL;
+ double dist, *c;
+ unsigned int i;
+ int found = AY_FALSE;
+
+  if(!arrlen)
+    return AY_FALSE;
+
+  pi = ay_selp_getpindex(o, arrlen, stride, ishom, arr);
+
+  if(pi)
+    {
+      ay_selp_pindexnearest(pi, 0, p, min_dist, index, &found);
+      return found;
+    }
+
+  c = arr;
+  for(i = 0; i < arrlen; i++)
+    {
+      if(ishom)
+	{
+	  dist = AY_VLEN((p[0] - c[0]*c[3]),
+			 (p[1] - c[1]*c[3]),
+			 (p[2] - c[2]*c[3]));
+	}
+      else
+	{
+	  dist = AY_VLEN((p[0] - c[0]),
+			 (p[1] - c[1]),
+			 (p[2] - c[2]));
+	}
+      if(dist < *min_dist)
+	{
+	  *min_dist = dist;
+	  *index = i;
+	  found = AY_TRUE;
+	}
+      c += stride;
+    } /* for */
+
+ return found;
+} /* ay_selp_nearest */
+
+
+/** ay_selp_inside:
+ *  find all points of an object inside of four planes (as created
+ *  from a selection rectangle by ay_viewt_objrecttoplanes()),
+ *  uses a cached index for objects with many points
+ *
+ * \param[in] o object the points belong to (used as cache key)
+ * \param[in] arrlen number of points in \a arr
+ * \param[in] stride stride of \a arr (3, 4, or 6)
+ * \param[in] ishom if AY_TRUE, the coordinates are multiplied by
+ *  the weight (4th component)
+ * \param[in] arr point array
+ * \param[in] pl four planes [16]
+ * \param[in,out] num where to store the number of found points
+ * \param[in,out] indices where to store the ascending indices of the
+ *  found points (NULL if no point is inside)
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_selp_inside(ay_object *o, unsigned int arrlen, int stride, int ishom,
+	       double *arr, double *pl, unsigned int *num,
+	       unsigned int **indices)
+{
+ int ay_status = AY_OK;
+ ay_selp_pindex *pi = NULL;
+ double h[3], *c;
+ unsigned int i, alloc = 0, *itmp;
+
+  *num = 0;
+  *indices = NULL;
+
+  if(!arrlen)
+    return AY_OK;
+
+  pi = ay_selp_getpindex(o, arrlen, stride, ishom, arr);
+
+  if(pi)
+    {
+      ay_status = ay_selp_pindexinside(pi, 0, pl, num, &alloc, indices);
+      if(!ay_status && *num > 1)
+	qsort(*indices, *num, sizeof(unsigned int), ay_selp_cmpindex);
+    }
+  else
+    {
+      c = h;
+      for(i = 0; i < arrlen; i++)
+	{
+	  if(ishom)
+	    {
+	      h[0] = arr[0]*arr[3];
+	      h[1] = arr[1]*arr[3];
+	      h[2] = arr[2]*arr[3];
+	    }
+	  else
+	    {
+	      c = arr;
+	    }
+
+	  /* test point c against the four planes in pl */
+	  if(((pl[0]*c[0] + pl[1]*c[1] + pl[2]*c[2] + pl[3]) < 0.0) &&
+	     ((pl[4]*c[0] + pl[5]*c[1] + pl[6]*c[2] + pl[7]) < 0.0) &&
+	     ((pl[8]*c[0] + pl[9]*c[1] + pl[10]*c[2] + pl[11]) < 0.0) &&
+	     ((pl[12]*c[0] + pl[13]*c[1] + pl[14]*c[2] + pl[15]) < 0.0))
+	    {
+	      if(*num == alloc)
+		{
+		  alloc = alloc?2*alloc:16;
+		  if(!(itmp = realloc(*indices, alloc*sizeof(unsigned int))))
+		    {
+		      ay_status = AY_EOMEM;
+		      break;
+		    }
+		  *indices = itmp;
+		}
+	      (*indices)[*num] = i;
+	      (*num)++;
+	    } /* if */
+
+	  arr += stride;
+	} /* for */
+    } /* if */
+
+  if(ay_status || !*num)
+    {
+      if(*indices)
+	free(*indices);
+      *indices = NULL;
+      *num = 0;
+    }
+
+ return ay_status;
+} /* ay_selp_inside */
+
+
+/** ay_selp_cacheinvalidate:
+ *  forget the point picking index of object <o>
+ *
+ * \param[in] o changed or deleted object
+ */
+void
+ay_selp_cacheinvalidate(ay_object *o)
+{
+ Tcl_HashEntry *entry = NULL;
+
+  if(!o)
+    return;
+
+  entry = Tcl_FindHashEntry(&ay_selp_pindexht, (char*)o);
+  if(entry)
+    {
+      ay_selp_pindexfree((ay_selp_pindex *)Tcl_GetHashValue(entry));
+      Tcl_DeleteHashEntry(entry);
+    }
+
+ return;
+} /* ay_selp_cacheinvalidate */
+
+
+/** ay_selp_init:
+ *  initialize the selp module
+ */
+void
+ay_selp_init(void)
+{
+
+  Tcl_InitHashTable(&ay_selp_pindexht, TCL_ONE_WORD_KEYS);
+
+ return;
+} /* ay_selp_init */
@@ -653,12 +653,13 @@ ay_shade_object(struct Togl *togl, ay_object *o, int push_name)
  ay_voidfp *arr = NULL;
  ay_drawcb *cb = NULL;
  ay_object *down;
- double m[16];
+ double m[16], bb[6];
  GLfloat oldcolor[4] = {0.0f,0.0f,0.0f,0.0f}, color[4] = {0.0f,0.0f,0.0f,0.0f};
  ay_object *mo = NULL;
  int reset_color = AY_FALSE, toggled_normals = AY_FALSE;
  /* static*/ int cw = AY_TRUE;
  GLint ff = GL_CCW;
+ int cull;
 
   if(o->hide)
     {
@@ -700,6 +701,21 @@ ay_shade_object(struct Togl *togl, ay_object *o, int push_name)
    glMultMatrixd((GLdouble *)m);
    glScaled((GLdouble)o->scalx, (GLdouble)o->scaly, (GLdouble)o->scalz);
 
+   if((cull = ay_draw_cull(togl, o, push_name?AY_TRUE:AY_FALSE, bb)))
+     {
+       if(cull == 2)
+	 ay_draw_cullbox(bb);
+       else
+	 if(push_name)
+	   ay_draw_cullnames(o);
+       push_name = AY_FALSE;
+       goto cleanup;
+     }
+
+   /* load lazily loaded objects only when they are actually shaded */
+   if(!o->refine)
+     (void)ay_bin_load(o);
+
    if(push_name)
      {
        o->glname = ++ay_glname;
@@ -813,6 +829,9 @@ ay_shade_view(struct Togl *togl)
  double m[16];
  unsigned char *sil = NULL, *silsel = NULL;
 
+  /* transformations may have changed since the last frame */
+  ay_bbc_cachenewframe();
+
   if(view->dirty)
     {
       ay_toglcb_reshape(togl);
@@ -1135,3 +1154,117 @@ ay_shade_view(struct Togl *togl)
  return AY_OK;
 } /* ay_shade_view */
 
+
+
+/* ay_shade_vbuffree:
+ *  free the arrays of the shading vertex buffer <vb>
+ *  and mark it invalid
+ */
+void
+ay_shade_vbuffree(ay_vbuf *vb)
+{
+
+  if(!vb)
+    return;
+
+  if(vb->v)
+    free(vb->v);
+
+  if(vb->idx)
+    free(vb->idx);
+
+  memset(vb, 0, sizeof(ay_vbuf));
+
+ return;
+} /* ay_shade_vbuffree */
+
+
+/* ay_shade_vbufaddvert:
+ *  append the vertex <p> with normal <n> to the shading vertex buffer
+ *  <vb>; the index of the new vertex is vb->nv-1 afterwards
+ */
+int
+ay_shade_vbufaddvert(ay_vbuf *vb, double *p, double *n)
+{
+ double *t;
+ unsigned int newlen;
+
+  if(vb->nv >= vb->vlen)
+    {
+      newlen = vb->vlen?vb->vlen*2:64;
+      if(!(t = realloc(vb->v, newlen*6*sizeof(double))))
+	return AY_EOMEM;
+      vb->v = t;
+      vb->vlen = newlen;
+    }
+
+  t = &(vb->v[vb->nv*6]);
+  memcpy(t, p, 3*sizeof(double));
+  memcpy(t+3, n, 3*sizeof(double));
+  vb->nv++;
+
+ return AY_OK;
+} /* ay_shade_vbufaddvert */
+
+
+/* ay_shade_vbufaddtri:
+ *  append the triangle <a>, <b>, <c> (vertex indices) to the shading
+ *  vertex buffer <vb>
+ */
+int
+ay_shade_vbufaddtri(ay_vbuf *vb, unsigned int a, unsigned int b,
+		    unsigned int c)
+{
+ unsigned int *t, newlen;
+
+  if(vb->nidx+3 > vb->idxlen)
+    {
+      newlen = vb->idxlen?vb->idxlen*2:192;
+      if(!(t = realloc(vb->idx, newlen*sizeof(unsigned int))))
+	return AY_EOMEM;
+      vb->idx = t;
+      vb->idxlen = newlen;
+    }
+
+  t = &(vb->idx[vb->nidx]);
+  t[0] = a;
+  t[1] = b;
+  t[2] = c;
+  vb->nidx += 3;
+
+ return AY_OK;
+} /* ay_shade_vbufaddtri */
+
+
+/* ay_shade_vbufdraw:
+ *  shade the triangles of the vertex buffer <vb> with OpenGL vertex
+ *  arrays (OpenGL 1.1, so that this also works with software
+ *  implementations); the vertices and normals are taken from <v>
+ *  ([x,y,z,nx,ny,nz] per vertex), or from vb->v if <v> is NULL
+ */
+void
+ay_shade_vbufdraw(ay_vbuf *vb, double *v)
+{
+
+  if(!vb || !vb->nidx)
+    return;
+
+  if(!v)
+    v = vb->v;
+
+  if(!v)
+    return;
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+
+  glVertexPointer(3, GL_DOUBLE, 6*sizeof(double), v);
+  glNormalPointer(GL_DOUBLE, 6*sizeof(double), v+3);
+
+  glDrawElements(GL_TRIANGLES, (GLsizei)vb->nidx, GL_UNSIGNED_INT, vb->idx);
+
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+ return;
+} /* ay_shade_vbufdraw */
@@ -752,7 +752,17 @@ ay_shader_wrib(ay_shader *shader, int type, RtLightHandle *light_handle)
 	  break;
 #endif
 	default:
-	  ay_error(AY_ERROR, fname, "Skipping shader of unknown type.");
+	  if(ay_tp_inworker())
+	    {
+	      /* fail, so that the object is exported again by the
+		 main thread, which reports the error
+		 (see ay_wrib_objects()) */
+	      ay_status = AY_ERROR;
+	    }
+	  else
+	    {
+	      ay_error(AY_ERROR, fname, "Skipping shader of unknown type.");
+	    }
 	  break;
 	} /* switch type */
 
@@ -293,6 +293,7 @@ ay_tags_settcmd(ClientData clientData, Tcl_Interp *interp,
 
       /* find tag */
       o = sel->object;
+      ay_wrib_cacheinvalidate(o);
       new = o->tags;
       while(new)
 	{
@@ -372,6 +373,7 @@ ay_tags_settcmd(ClientData clientData, Tcl_Interp *interp,
 
       /* find tag */
       o = sel->object;
+      ay_wrib_cacheinvalidate(o);
       new = o->tags;
       next = &(o->tags);
       while(new)
@@ -419,6 +421,7 @@ ay_tags_settcmd(ClientData clientData, Tcl_Interp *interp,
   while(sel)
     {
       o = sel->object;
+      ay_wrib_cacheinvalidate(o);
 
       if(!pasteProp)
 	{
@@ -566,6 +569,7 @@ ay_tags_addtcmd(ClientData clientData, Tcl_Interp *interp,
   while(sel)
     {
       o = sel->object;
+      ay_wrib_cacheinvalidate(o);
 
       if(!(new = calloc(1, sizeof(ay_tag))))
 	{
@@ -882,6 +886,8 @@ ay_tags_delete(ay_object *o, unsigned int type)
   if(!o)
     return;
 
+  ay_wrib_cacheinvalidate(o);
+
   tag = o->tags;
   last = &(o->tags);
   while(tag)
@@ -934,6 +940,7 @@ ay_tags_deletetcmd(ClientData clientData, Tcl_Interp *interp,
   while(sel)
     {
       o = sel->object;
+      ay_wrib_cacheinvalidate(o);
 
       last = &(o->tags);
       tag = o->tags;
@@ -368,6 +368,7 @@ ay_tgui_update(Tcl_Interp *interp, int argc, char *argv[])
 
       /* PolyMesh objects have no children (trim curves)... */
       oref->object->down = NULL;
+      ay_notify_graphinvalidate();
 
       oref = oref->next;
       o = o->next;
@@ -513,6 +514,7 @@ ay_tgui_cancel(void)
       oref->object->refine = o->refine;
       /* move children (trim curves) */
       oref->object->down = o->down;
+      ay_notify_graphinvalidate();
 
       /* move tags */
       ay_tags_delall(oref->object);
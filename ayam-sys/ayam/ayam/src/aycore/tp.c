@@ -0,0 +1,277 @@
+/*
+ * Ayam, a free 3D modeler for the RenderMan interface.
+ *
+ * Ayam is copyrighted 1998-2020 by Randolf Schultz
+ * (randolf.schultz@gmail.com) and others.
+ *
+ * All rights reserved.
+ *
+ * See the file License for details.
+ *
+ */
+
+#include "ayam.h"
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+/** \file tp.c \brief thread pool for data parallel tasks */
+
+/** maximum number of worker threads */
+#define AY_TPMAXTHREADS 64
+
+/* types local to this module */
+
+typedef struct ay_tp_job_s {
+  ay_tpworkcb *cb; /**< work callback */
+  void *data; /**< user data for the work callback */
+  int nitems; /**< total number of work items */
+  int next; /**< next work item to hand out */
+  int status; /**< first error status returned by the callback */
+  Tcl_Mutex mutex; /**< protects next and status */
+} ay_tp_job;
+
+typedef struct ay_tp_worker_s {
+  ay_tp_job *job; /**< the job to work on */
+  int thread; /**< index of this worker */
+} ay_tp_worker;
+
+typedef struct ay_tp_tsd_s {
+  int inworker; /**< thread currently processes work items? */
+} ay_tp_tsd;
+
+
+/* global variables */
+
+/** number of worker threads (0 - use number of processors) */
+static int ay_tp_numthreads = 0;
+
+/** key of the thread specific data */
+static Tcl_ThreadDataKey ay_tp_tsdkey;
+
+
+/* prototypes of functions local to this module */
+
+void ay_tp_work(ay_tp_worker *w);
+
+Tcl_ThreadCreateType ay_tp_threadproc(ClientData clientData);
+
+
+/* functions */
+
+/** ay_tp_getnumthreads:
+ *  Get the number of worker threads used by ay_tp_run().
+ *  If no number was set explicitly, the number of available
+ *  processors is returned.
+ *
+ * \returns number of threads (always >= 1)
+ */
+int
+ay_tp_getnumthreads(void)
+{
+ int n = ay_tp_numthreads;
+#ifdef WIN32
+ SYSTEM_INFO si;
+#endif
+
+  if(n <= 0)
+    {
+#ifdef WIN32
+      GetSystemInfo(&si);
+      n = (int)si.dwNumberOfProcessors;
+#else
+#ifdef _SC_NPROCESSORS_ONLN
+      n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+#endif
+    }
+
+  if(n < 1)
+    n = 1;
+
+  if(n > AY_TPMAXTHREADS)
+    n = AY_TPMAXTHREADS;
+
+ return n;
+} /* ay_tp_getnumthreads */
+
+
+/** ay_tp_setnumthreads:
+ *  Set the number of worker threads used by ay_tp_run().
+ *
+ * \param[in] n number of threads, 1 disables multi threading,
+ *  0 uses the number of available processors
+ */
+void
+ay_tp_setnumthreads(int n)
+{
+
+  if(n < 0)
+    n = 0;
+
+  ay_tp_numthreads = n;
+
+ return;
+} /* ay_tp_setnumthreads */
+
+
+/** ay_tp_work:
+ *  Process work items of a job until there are no more items
+ *  left or an error occurred.
+ *
+ * \param[in] w worker
+ */
+void
+ay_tp_work(ay_tp_worker *w)
+{
+ ay_tp_job *job = w->job;
+ ay_tp_tsd *tsd;
+ int item, status, inworker;
+
+  /* mark this thread as worker, so that nested calls
+     of ay_tp_run() from the work callback run serially */
+  tsd = (ay_tp_tsd *)Tcl_GetThreadData(&ay_tp_tsdkey, sizeof(ay_tp_tsd));
+  inworker = tsd->inworker;
+  tsd->inworker = AY_TRUE;
+
+  while(1)
+    {
+      Tcl_MutexLock(&(job->mutex));
+      if(job->status || (job->next >= job->nitems))
+	{
+	  Tcl_MutexUnlock(&(job->mutex));
+	  break;
+	}
+      item = job->next;
+      job->next++;
+      Tcl_MutexUnlock(&(job->mutex));
+
+      status = job->cb(job->data, item, w->thread);
+
+      if(status)
+	{
+	  Tcl_MutexLock(&(job->mutex));
+	  if(!job->status)
+	    job->status = status;
+	  Tcl_MutexUnlock(&(job->mutex));
+	}
+    } /* while */
+
+  tsd->inworker = inworker;
+
+ return;
+} /* ay_tp_work */
+
+
+/** ay_tp_threadproc:
+ *  Thread procedure of the worker threads.
+ *
+ * \param[in] clientData worker (ay_tp_worker *)
+ */
+Tcl_ThreadCreateType
+ay_tp_threadproc(ClientData clientData)
+{
+
+  ay_tp_work((ay_tp_worker *)clientData);
+
+  TCL_THREAD_CREATE_RETURN;
+} /* ay_tp_threadproc */
+
+
+/** ay_tp_run:
+ *  Process <nitems> independent work items in parallel by calling
+ *  <cb> for each item from a pool of worker threads.
+ *  The calling thread takes part in the processing and the function
+ *  returns only when all items are done.
+ *  If no threads can be created (e.g. because Tcl was compiled
+ *  without thread support) all items are processed by the calling
+ *  thread.
+ *  Calls from within a work callback (nested jobs) are also processed
+ *  serially by the calling thread, as all processors are busy
+ *  with the outer job already.
+ *  The work callback receives the index of the item and the index
+ *  of the worker (0 - number of threads - 1), which may be used
+ *  to select per-thread scratch memory.
+ *  As the Tcl interpreter is not thread safe, work callbacks must
+ *  not report errors via ay_error() but return an error code
+ *  instead; the first error stops the processing of further items.
+ *
+ * \param[in] nitems number of work items
+ * \param[in] cb work callback
+ * \param[in] data user data handed to the work callback
+ *
+ * \returns AY_OK on success, first error code returned by <cb> else
+ */
+int
+ay_tp_run(int nitems, ay_tpworkcb *cb, void *data)
+{
+ ay_tp_job job = {0};
+ ay_tp_worker workers[AY_TPMAXTHREADS];
+ Tcl_ThreadId tids[AY_TPMAXTHREADS];
+ ay_tp_tsd *tsd;
+ int i, nthreads, started = 0, result;
+
+  if(!cb)
+    return AY_ENULL;
+
+  if(nitems <= 0)
+    return AY_OK;
+
+  job.cb = cb;
+  job.data = data;
+  job.nitems = nitems;
+
+  nthreads = ay_tp_getnumthreads();
+  if(nthreads > nitems)
+    nthreads = nitems;
+
+  tsd = (ay_tp_tsd *)Tcl_GetThreadData(&ay_tp_tsdkey, sizeof(ay_tp_tsd));
+  if(tsd->inworker)
+    nthreads = 1;
+
+  /* start the additional worker threads */
+  for(i = 1; i < nthreads; i++)
+    {
+      workers[started+1].job = &job;
+      workers[started+1].thread = started+1;
+      if(Tcl_CreateThread(&(tids[started+1]), ay_tp_threadproc,
+			  (ClientData)&(workers[started+1]),
+			  TCL_THREAD_STACK_DEFAULT,
+			  TCL_THREAD_JOINABLE) != TCL_OK)
+	break;
+      started++;
+    } /* for */
+
+  /* the calling thread is worker 0 */
+  workers[0].job = &job;
+  workers[0].thread = 0;
+  ay_tp_work(&(workers[0]));
+
+  /* wait for the other workers */
+  for(i = 1; i <= started; i++)
+    {
+      (void)Tcl_JoinThread(tids[i], &result);
+    }
+
+  Tcl_MutexFinalize(&(job.mutex));
+
+ return job.status;
+} /* ay_tp_run */
+
+
+/** ay_tp_inworker:
+ *  Check whether the calling thread currently processes work items
+ *  of ay_tp_run(), i.e. must not report errors via ay_error().
+ *
+ * \returns AY_TRUE if called from a work callback, AY_FALSE else
+ */
+int
+ay_tp_inworker(void)
+{
+ ay_tp_tsd *tsd;
+
+  tsd = (ay_tp_tsd *)Tcl_GetThreadData(&ay_tp_tsdkey, sizeof(ay_tp_tsd));
+
+ return tsd->inworker;
+} /* ay_tp_inworker */
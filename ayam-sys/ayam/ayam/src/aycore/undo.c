@@ -18,6 +18,9 @@
 #define UNDO_DBG 1
 */
 
+/* the undo buffer is a ring, UNDO_SLOT(i) delivers the i-th oldest state */
+#define UNDO_SLOT(i) (&(undo_buffer[(undo_first+(i))%undo_buffer_size]))
+
 /* types local to this module */
 typedef struct ay_undo_object_s
 {
@@ -27,6 +30,19 @@ typedef struct ay_undo_object_s
   int saved_children;
 } ay_undo_object;
 
+/* header of the arrays (control points, knots, mesh indices) of saved
+   NCurve, NPatch, and PoMesh objects; unchanged arrays are shared
+   between undo states (copy-on-write), the data follows the header */
+typedef union ay_undo_array_u
+{
+  struct
+  {
+    unsigned int refcount;
+    size_t size;
+  } h;
+  double align[2];
+} ay_undo_array;
+
 /* prototypes of functions local to this module */
 void ay_undo_deletemulti(ay_object *o);
 
@@ -58,6 +74,18 @@ int ay_undo_save(int save_children);
 
 int ay_undo_copysave(ay_object *src, ay_object **dst);
 
+void *ay_undo_sharearr(void *src, size_t size, void *prev);
+
+void ay_undo_freearr(void *arr);
+
+void ay_undo_freesnapshot(unsigned int type, void *refine);
+
+int ay_undo_snapshot(ay_object *src, ay_object *prev, void **dst);
+
+ay_object *ay_undo_findprev(ay_object *o);
+
+void ay_undo_evict(void);
+
 /* global variables */
 static ay_undo_object *undo_buffer;
 
@@ -65,6 +93,16 @@ static int undo_current;
 
 static int undo_buffer_size;
 
+static int undo_first; /* index of the oldest state in the undo ring */
+
+static size_t undo_memory; /* size of all arrays held by the undo buffer */
+
+static ay_undo_object *undo_prev; /* state searched by ay_undo_findprev() */
+
+static ay_list_object *undo_prevr; /* search position in undo_prev */
+
+static ay_object *undo_prevo;
+
 static int undo_last_op; /* last undo operation: -1: no op,
 			    1-4: see mode variable in ay_undo_undotcmd() */
 
@@ -99,6 +137,7 @@ ay_undo_init(int buffer_size)
     }
 
   undo_current = -1;
+  undo_first = 0;
   undo_buffer_size = buffer_size;
 
   undo_last_op = -1; /* no op */
@@ -148,6 +187,11 @@ ay_undo_deletemulti(ay_object *o)
 	case AY_IDINSTANCE:
 	case AY_IDLAST:
 	  break;
+	case AY_IDNCURVE:
+	case AY_IDNPATCH:
+	case AY_IDPOMESH:
+	  ay_undo_freesnapshot(d->type, d->refine);
+	  break;
 	default:
 	  arr = ay_deletecbt.arr;
 	  dcb = (ay_deletecb*)(arr[d->type]);
@@ -642,6 +686,11 @@ ay_undo_copy(ay_undo_object *uo)
 		  return ay_status;
 		}
 	    }
+	  /* saved curves/patches carry no multiple points */
+	  if(c->type == AY_IDNCURVE)
+	    ay_nct_recreatemp((ay_nurbcurve_object *)o->refine);
+	  if(c->type == AY_IDNPATCH)
+	    ay_npt_recreatemp((ay_nurbpatch_object *)o->refine);
 	  break;
 	} /* switch */
 
@@ -725,7 +774,7 @@ ay_undo_redo(void)
       return AY_ERROR;
     }
 
-  if((undo_buffer[undo_current+1]).references == NULL)
+  if((UNDO_SLOT(undo_current+1))->references == NULL)
     {
       ay_error(AY_ERROR, fname, "No further redo info available!");
       return AY_ERROR;
@@ -738,7 +787,7 @@ ay_undo_redo(void)
 
   undo_current++;
 
-  ay_status = ay_undo_copy(&(undo_buffer[undo_current]));
+  ay_status = ay_undo_copy(UNDO_SLOT(undo_current));
 
   undo_last_op = 1;
 
@@ -764,7 +813,7 @@ ay_undo_undo(void)
   if(undo_last_op == 2)
     { /* if last op was a save, we need to save current state too,
          to allow the user to get back to current state with redo */
-      ay_status = ay_undo_save((undo_buffer[undo_current]).saved_children);
+      ay_status = ay_undo_save((UNDO_SLOT(undo_current))->saved_children);
       if(ay_status)
 	ay_error(AY_EWARN, fname,
 		 "Undo save failed, the state before 'undo' will be lost!");
@@ -776,7 +825,7 @@ ay_undo_undo(void)
       undo_current--;
     }
 
-  ay_status = ay_undo_copy(&(undo_buffer[undo_current]));
+  ay_status = ay_undo_copy(UNDO_SLOT(undo_current));
 
   undo_current--;
 
@@ -812,7 +861,7 @@ ay_undo_rewind(int silent)
       return AY_ERROR;
     }
 
-  uo = &(undo_buffer[undo_current]);
+  uo = UNDO_SLOT(undo_current);
   ay_undo_clearuo(uo);
 
   undo_current--;
@@ -848,6 +897,9 @@ ay_undo_copysave(ay_object *src, ay_object **dst)
   if(!src || !dst)
     return AY_ENULL;
 
+  if(!src->refine)
+    (void)ay_bin_load(src);
+
   /* copy generic object */
   if(!(new = malloc(sizeof(ay_object))))
     return AY_EOMEM;
@@ -911,6 +963,18 @@ ay_undo_copysave(ay_object *src, ay_object **dst)
     case AY_IDINSTANCE:
       new->refine = src->refine;
       break;
+    case AY_IDNCURVE:
+    case AY_IDNPATCH:
+    case AY_IDPOMESH:
+      new->refine = NULL;
+      ay_status = ay_undo_snapshot(src, ay_undo_findprev(src),
+				   &(new->refine));
+      if(ay_status)
+	{
+	  ay_error(ay_status, fname, "could not save object");
+	  goto cleanup;
+	}
+      break;
     default:
       arr = ay_copycbt.arr;
       cb = (ay_copycb*)(arr[src->type]);
@@ -970,6 +1034,12 @@ cleanup:
 
   if(new)
     {
+      if((new->type == AY_IDNCURVE) || (new->type == AY_IDNPATCH) ||
+	 (new->type == AY_IDPOMESH))
+	{
+	  ay_undo_freesnapshot(new->type, new->refine);
+	  new->refine = NULL;
+	}
       new->mat = NULL;
       ay_object_delete(new);
     }
@@ -978,6 +1048,316 @@ cleanup:
 } /* ay_undo_copysave */
 
 
+/* ay_undo_sharearr:
+ *  get an array of <size> bytes with the contents of <src> for
+ *  the undo buffer; if <prev> (an array of an older undo state)
+ *  holds the same data, it is shared instead of copied
+ *  returns NULL if <src> is NULL or out of memory
+ */
+void *
+ay_undo_sharearr(void *src, size_t size, void *prev)
+{
+ ay_undo_array *a = NULL;
+
+  if(!src || !size)
+    return NULL;
+
+  if(prev)
+    {
+      a = ((ay_undo_array *)prev) - 1;
+      if((a->h.size == size) && !memcmp(prev, src, size))
+	{
+	  a->h.refcount++;
+	  return prev;
+	}
+    }
+
+  if(!(a = malloc(sizeof(ay_undo_array) + size)))
+    return NULL;
+
+  a->h.refcount = 1;
+  a->h.size = size;
+  memcpy(a + 1, src, size);
+
+  undo_memory += size;
+
+ return (void *)(a + 1);
+} /* ay_undo_sharearr */
+
+
+/* ay_undo_freearr:
+ *  release an array obtained from ay_undo_sharearr()
+ */
+void
+ay_undo_freearr(void *arr)
+{
+ ay_undo_array *a = NULL;
+
+  if(!arr)
+    return;
+
+  a = ((ay_undo_array *)arr) - 1;
+  a->h.refcount--;
+  if(!a->h.refcount)
+    {
+      undo_memory -= a->h.size;
+      free(a);
+    }
+
+ return;
+} /* ay_undo_freearr */
+
+
+/* ay_undo_freesnapshot:
+ *  free the type specific part <refine> of a saved NCurve, NPatch,
+ *  or PoMesh object of type <type>
+ */
+void
+ay_undo_freesnapshot(unsigned int type, void *refine)
+{
+ ay_nurbcurve_object *nc = NULL;
+ ay_nurbpatch_object *np = NULL;
+ ay_pomesh_object *pm = NULL;
+
+  if(!refine)
+    return;
+
+  switch(type)
+    {
+    case AY_IDNCURVE:
+      nc = (ay_nurbcurve_object *)refine;
+      ay_undo_freearr(nc->controlv);
+      ay_undo_freearr(nc->knotv);
+      break;
+    case AY_IDNPATCH:
+      np = (ay_nurbpatch_object *)refine;
+      ay_undo_freearr(np->controlv);
+      ay_undo_freearr(np->uknotv);
+      ay_undo_freearr(np->vknotv);
+      break;
+    case AY_IDPOMESH:
+      pm = (ay_pomesh_object *)refine;
+      ay_undo_freearr(pm->nloops);
+      ay_undo_freearr(pm->nverts);
+      ay_undo_freearr(pm->verts);
+      ay_undo_freearr(pm->controlv);
+      ay_undo_freearr(pm->face_normals);
+      break;
+    default:
+      break;
+    } /* switch */
+
+  free(refine);
+
+ return;
+} /* ay_undo_freesnapshot */
+
+
+/* ay_undo_snapshot:
+ *  save the type specific part of NCurve, NPatch, or PoMesh object <src>;
+ *  the arrays are shared with <prev> (the saved state of <src> in the
+ *  previous undo state, may be NULL) where they did not change, so that
+ *  saving a big unchanged object costs no extra memory; the caches
+ *  (tesselations, multiple points) are not saved
+ */
+int
+ay_undo_snapshot(ay_object *src, ay_object *prev, void **dst)
+{
+ int ay_status = AY_OK;
+ ay_nurbcurve_object *nc = NULL, *newnc = NULL, *prevnc = NULL;
+ ay_nurbpatch_object *np = NULL, *newnp = NULL, *prevnp = NULL;
+ ay_pomesh_object *pm = NULL, *newpm = NULL, *prevpm = NULL;
+ unsigned int i, total_loops = 0, total_verts = 0, stride;
+ void *new = NULL;
+
+  if(!src || !src->refine || !dst)
+    return AY_ENULL;
+
+  if(prev && (prev->type != src->type))
+    prev = NULL;
+
+  switch(src->type)
+    {
+    case AY_IDNCURVE:
+      nc = (ay_nurbcurve_object *)src->refine;
+      if(prev)
+	prevnc = (ay_nurbcurve_object *)prev->refine;
+      if(!(newnc = malloc(sizeof(ay_nurbcurve_object))))
+	return AY_EOMEM;
+      new = newnc;
+      memcpy(newnc, nc, sizeof(ay_nurbcurve_object));
+      newnc->breakv = NULL;
+      newnc->no = NULL;
+      newnc->fltcv = NULL;
+      memset(newnc->stess, 0, 2*sizeof(ay_stess_curve));
+      newnc->mpoints = NULL;
+
+      newnc->knotv = ay_undo_sharearr(nc->knotv,
+			       (nc->length+nc->order)*sizeof(double),
+				      prevnc?prevnc->knotv:NULL);
+      newnc->controlv = ay_undo_sharearr(nc->controlv,
+					 nc->length*4*sizeof(double),
+					 prevnc?prevnc->controlv:NULL);
+      if(!newnc->knotv || !newnc->controlv)
+	ay_status = AY_EOMEM;
+      break;
+    case AY_IDNPATCH:
+      np = (ay_nurbpatch_object *)src->refine;
+      if(prev)
+	prevnp = (ay_nurbpatch_object *)prev->refine;
+      if(!(newnp = malloc(sizeof(ay_nurbpatch_object))))
+	return AY_EOMEM;
+      new = newnp;
+      memcpy(newnp, np, sizeof(ay_nurbpatch_object));
+      newnp->breakv = NULL;
+      newnp->no = NULL;
+      newnp->fltcv = NULL;
+      memset(newnp->stess, 0, 2*sizeof(ay_stess_patch));
+      newnp->caps_and_bevels = NULL;
+      newnp->mpoints = NULL;
+
+      newnp->uknotv = ay_undo_sharearr(np->uknotv,
+			       (np->width+np->uorder)*sizeof(double),
+				       prevnp?prevnp->uknotv:NULL);
+      newnp->vknotv = ay_undo_sharearr(np->vknotv,
+			       (np->height+np->vorder)*sizeof(double),
+				       prevnp?prevnp->vknotv:NULL);
+      newnp->controlv = ay_undo_sharearr(np->controlv,
+			       np->width*np->height*4*sizeof(double),
+					 prevnp?prevnp->controlv:NULL);
+      if(!newnp->uknotv || !newnp->vknotv || !newnp->controlv)
+	ay_status = AY_EOMEM;
+      break;
+    case AY_IDPOMESH:
+      pm = (ay_pomesh_object *)src->refine;
+      if(prev)
+	prevpm = (ay_pomesh_object *)prev->refine;
+      if(!(newpm = malloc(sizeof(ay_pomesh_object))))
+	return AY_EOMEM;
+      new = newpm;
+      memcpy(newpm, pm, sizeof(ay_pomesh_object));
+      newpm->vb = NULL;
+
+      if(pm->nloops)
+	for(i = 0; i < pm->npolys; i++)
+	  total_loops += pm->nloops[i];
+      if(pm->nverts)
+	for(i = 0; i < total_loops; i++)
+	  total_verts += pm->nverts[i];
+      stride = pm->has_normals?6:3;
+
+      newpm->nloops = ay_undo_sharearr(pm->nloops,
+				       pm->npolys*sizeof(unsigned int),
+				       prevpm?prevpm->nloops:NULL);
+      newpm->nverts = ay_undo_sharearr(pm->nverts,
+				       total_loops*sizeof(unsigned int),
+				       prevpm?prevpm->nverts:NULL);
+      newpm->verts = ay_undo_sharearr(pm->verts,
+				      total_verts*sizeof(unsigned int),
+				      prevpm?prevpm->verts:NULL);
+      newpm->controlv = ay_undo_sharearr(pm->controlv,
+				     pm->ncontrols*stride*sizeof(double),
+					 prevpm?prevpm->controlv:NULL);
+      newpm->face_normals = ay_undo_sharearr(pm->face_normals,
+					 pm->npolys*3*sizeof(double),
+					 prevpm?prevpm->face_normals:NULL);
+      if((pm->npolys && pm->nloops && !newpm->nloops) ||
+	 (total_loops && pm->nverts && !newpm->nverts) ||
+	 (total_verts && pm->verts && !newpm->verts) ||
+	 (pm->ncontrols && pm->controlv && !newpm->controlv) ||
+	 (pm->npolys && pm->face_normals && !newpm->face_normals))
+	ay_status = AY_EOMEM;
+      break;
+    default:
+      return AY_ERROR;
+    } /* switch */
+
+  if(ay_status)
+    {
+      ay_undo_freesnapshot(src->type, new);
+      return ay_status;
+    }
+
+  *dst = new;
+
+ return AY_OK;
+} /* ay_undo_snapshot */
+
+
+/* ay_undo_findprev:
+ *  find the saved state of object <o> in the previous undo state;
+ *  the search continues after the last match, so that saving
+ *  the objects in the same order as before needs just one comparison
+ *  per object
+ *  returns NULL if <o> was not saved in the previous undo state
+ */
+ay_object *
+ay_undo_findprev(ay_object *o)
+{
+ ay_list_object *r = NULL, *start = NULL;
+ ay_object *c = NULL;
+
+  if(!o || !undo_prev || !undo_prev->references)
+    return NULL;
+
+  r = undo_prevr;
+  c = undo_prevo;
+  if(!r)
+    {
+      r = undo_prev->references;
+      c = undo_prev->objects;
+    }
+
+  start = r;
+  do
+    {
+      if((r->object == o) && (c->type == o->type))
+	{
+	  undo_prevr = r->next;
+	  undo_prevo = c->next;
+	  return c;
+	}
+
+      r = r->next;
+      c = c->next;
+      if(!r)
+	{
+	  r = undo_prev->references;
+	  c = undo_prev->objects;
+	}
+    }
+  while(r != start);
+
+ return NULL;
+} /* ay_undo_findprev */
+
+
+/* ay_undo_evict:
+ *  clear the oldest undo states until the memory used by the undo
+ *  buffer fits into the budget set by the UndoMemory preference
+ *  (in megabytes, 0 means no limit); the last two states are kept
+ */
+void
+ay_undo_evict(void)
+{
+ size_t budget;
+
+  if(ay_prefs.undo_memory <= 0)
+    return;
+
+  budget = (size_t)ay_prefs.undo_memory * 1048576;
+
+  while((undo_memory > budget) && (undo_current > 1))
+    {
+      ay_undo_clearuo(UNDO_SLOT(0));
+      undo_first = (undo_first+1) % undo_buffer_size;
+      undo_current--;
+    }
+
+ return;
+} /* ay_undo_evict */
+
+
 /* ay_undo_savechildren:
  *  _recursively_ save all children of <o> to undo state <uo>
  */
@@ -1058,26 +1438,11 @@ ay_undo_save(int save_children)
   if(undo_current+1 == undo_buffer_size)
     {
       /* yes, we need to clear the oldest saved state
-       * and then shift all states, so that the top
-       * of the undo buffer is empty again
+       * and then rotate the ring, so that the cleared
+       * state becomes the top of the undo buffer
        */
-
-      /* clear oldest state */
-      uo = &(undo_buffer[0]);
-      ay_undo_clearuo(uo);
-      /* shift all states down */
-      for(i = 0; i < undo_buffer_size-1; i++)
-	{
-	  uo = &(undo_buffer[i]);
-	  uo2 = &(undo_buffer[i+1]);
-
-	  uo->objects = uo2->objects;
-	  uo->references = uo2->references;
-	  uo->operation = uo2->operation;
-	}
-      uo = &(undo_buffer[undo_buffer_size-1]);
-      uo->objects = NULL;
-      uo->references = NULL;
+      ay_undo_clearuo(UNDO_SLOT(0));
+      undo_first = (undo_first+1) % undo_buffer_size;
     }
   else
     {
@@ -1093,7 +1458,7 @@ ay_undo_save(int save_children)
 	  /* clear tail of undo buffer */
 	  for(i = undo_current; i < undo_buffer_size; i++)
 	    {
-	      uo = &(undo_buffer[i]);
+	      uo = UNDO_SLOT(i);
 	      ay_undo_clearuo(uo);
 	    }
 	}
@@ -1103,11 +1468,18 @@ ay_undo_save(int save_children)
 	} /* if */
     } /* if */
 
-  uo = &(undo_buffer[undo_current]);
+  uo = UNDO_SLOT(undo_current);
 
   if(!uo)
     return AY_ENULL;
 
+  /* unchanged arrays will be shared with the previous state */
+  undo_prev = NULL;
+  if(undo_current > 0)
+    undo_prev = UNDO_SLOT(undo_current-1);
+  undo_prevr = NULL;
+  undo_prevo = NULL;
+
   /* link name of saved modelling operation to this undo object */
   uo->operation = undo_saved_op;
   /* avoid alias */
@@ -1217,7 +1589,7 @@ ay_undo_save(int save_children)
    */
   if(undo_current > 0)
     {
-      uo2 = &(undo_buffer[undo_current-1]);
+      uo2 = UNDO_SLOT(undo_current-1);
       lso = uo2->objects;
       lsr = uo2->references;
       while(lso)
@@ -1317,6 +1689,10 @@ ay_undo_save(int save_children)
 	} /* while */
     } /* if */
 
+  undo_prev = NULL;
+
+  ay_undo_evict();
+
   undo_last_op = 2;
 
  return AY_OK;
@@ -1339,6 +1715,7 @@ ay_undo_clear(void)
     }
 
   undo_current = -1;
+  undo_first = 0;
   undo_last_op = -1; /* no op */
 
   if(undo_saved_op)
@@ -1523,9 +1900,9 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	  /* set undo prompt */
 	  if(undo_current > -1)
 	    {
-	      if((undo_buffer[undo_current]).operation)
+	      if((UNDO_SLOT(undo_current))->operation)
 		Tcl_SetVar2(interp, a, n3,
-			    (undo_buffer[undo_current]).operation,
+			    (UNDO_SLOT(undo_current))->operation,
 			    TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	      else
 		Tcl_SetVar2(interp, a, n3, vnull,
@@ -1538,9 +1915,9 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	    }
 	  if(undo_current+1 < undo_buffer_size)
 	    {
-	      if((undo_buffer[undo_current+1]).operation)
+	      if((UNDO_SLOT(undo_current+1))->operation)
 		Tcl_SetVar2(interp, a, n4,
-			    (undo_buffer[undo_current+1]).operation,
+			    (UNDO_SLOT(undo_current+1))->operation,
 			    TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	      else
 		Tcl_SetVar2(interp, a, n4, vnull,
@@ -1560,9 +1937,9 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	  /* set undo prompt */
 	  if(undo_current > 0)
 	    {
-	      if((undo_buffer[undo_current-1]).operation)
+	      if((UNDO_SLOT(undo_current-1))->operation)
 		Tcl_SetVar2(interp, a, n3,
-			    (undo_buffer[undo_current-1]).operation,
+			    (UNDO_SLOT(undo_current-1))->operation,
 			    TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	      else
 		Tcl_SetVar2(interp, a, n3, vnull,
@@ -1570,9 +1947,9 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	    }
 	  if(undo_current+1 < undo_buffer_size)
 	    {
-	      if((undo_buffer[undo_current]).operation)
+	      if((UNDO_SLOT(undo_current))->operation)
 		Tcl_SetVar2(interp, a, n4,
-			    (undo_buffer[undo_current]).operation,
+			    (UNDO_SLOT(undo_current))->operation,
 			    TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	      else
 		Tcl_SetVar2(interp, a, n4, vnull,
@@ -1617,7 +1994,7 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
       if(ay_status)
 	{
 	  ay_error(AY_ERROR, argv[0], "undo save failed");
-	  ay_undo_clearuo(&(undo_buffer[uc]));
+	  ay_undo_clearuo(UNDO_SLOT(undo_current));
 	  if(undo_saved_op)
 	    {
 	      free(undo_saved_op);
@@ -1627,10 +2004,11 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	}
       else
 	{
-	  uc++;
+	  /* old states may have been cleared to stay in the memory budget */
+	  uc = undo_current+1;
 	  /* set undo prompt */
-	  if((undo_buffer[undo_current]).operation)
-	    Tcl_SetVar2(interp, a, n3, (undo_buffer[undo_current]).operation,
+	  if((UNDO_SLOT(undo_current))->operation)
+	    Tcl_SetVar2(interp, a, n3, (UNDO_SLOT(undo_current))->operation,
 			TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	  Tcl_SetVar2(interp, a, n4, vnone, TCL_LEAVE_ERR_MSG |
 		      TCL_GLOBAL_ONLY);
@@ -1664,9 +2042,9 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	  /* set undo prompt */
 	  if(undo_current > -1)
 	    {
-	      if((undo_buffer[undo_current]).operation)
+	      if((UNDO_SLOT(undo_current))->operation)
 		Tcl_SetVar2(interp, a, n3,
-			    (undo_buffer[undo_current]).operation,
+			    (UNDO_SLOT(undo_current))->operation,
 			    TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	      else
 		Tcl_SetVar2(interp, a, n3, vnull,
@@ -1679,9 +2057,9 @@ ay_undo_undotcmd(ClientData clientData, Tcl_Interp *interp,
 	    }
 	  if(undo_current+1 < undo_buffer_size)
 	    {
-	      if((undo_buffer[undo_current+1]).operation)
+	      if((UNDO_SLOT(undo_current+1))->operation)
 		Tcl_SetVar2(interp, a, n4,
-			    (undo_buffer[undo_current+1]).operation,
+			    (UNDO_SLOT(undo_current+1))->operation,
 			    TCL_LEAVE_ERR_MSG | TCL_GLOBAL_ONLY);
 	      else
 		Tcl_SetVar2(interp, a, n4, vnull,
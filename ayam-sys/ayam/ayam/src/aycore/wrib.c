@@ -20,6 +20,29 @@ int ay_wrib_framenum = 0;
 
 unsigned int ay_wrib_primlevel = 0;
 
+static int ay_wrib_cacheactive = AY_FALSE;
+
+static Tcl_HashTable ay_wrib_cacheht;
+
+static Tcl_HashTable ay_wrib_cachehierht;
+
+static Tcl_HashTable ay_wrib_cachechkht;
+
+static unsigned int ay_wrib_cacheprefs[8];
+
+#ifdef AYUSEAFFINE
+/* types local to this module: */
+
+/** data of a parallel export, see ay_wrib_objects() */
+typedef struct ay_wrib_pjob_s {
+  char *file; /**< RIB file name */
+  ay_object **objects; /**< top-level objects to export */
+  char **archives; /**< cached archive names of the objects (or NULL) */
+  RtPointer *fragments; /**< RIB fragments written by the workers */
+  int *status; /**< export status of the objects */
+} ay_wrib_pjob;
+#endif
+
 
 /* prototypes of functions local to this module: */
 
@@ -32,6 +55,34 @@ void ay_wrib_displaydriver(char *driver);
 
 int ay_wrib_lights(char *file, ay_object *o);
 
+int ay_wrib_children(char *file, ay_object *o);
+
+int ay_wrib_objectarchive(char *file, ay_object *o, char *archive);
+
+int ay_wrib_cachehaslights(ay_object *o);
+
+void ay_wrib_cachefreeht(Tcl_HashTable *ht, int keytype);
+
+int ay_wrib_cachefold(ay_binfile *bf, unsigned int *hash);
+
+int ay_wrib_cacheown(ay_object *o, unsigned int *hash);
+
+int ay_wrib_cachehier(ay_object *o, unsigned int *hash);
+
+int ay_wrib_cachehash(ay_object *o, unsigned int *hash);
+
+#ifdef AYUSEAFFINE
+int ay_wrib_parallelsafetags(ay_object *o);
+
+int ay_wrib_parallelsafetrims(ay_object *t);
+
+int ay_wrib_parallelsafenp(ay_object *o);
+
+int ay_wrib_parallelsafe(ay_object *o);
+
+int ay_wrib_objectcb(void *data, int item, int thread);
+#endif
+
 
 /* functions: */
 
@@ -299,6 +350,44 @@ FrameCamera(double zoom, double framewidth, double frameheight)
 }*/
 
 
+/** ay_wrib_ribformat:
+ * set the format (ASCII, precise ASCII, binary) and compression of the
+ * RIB files written next according to the preferences; must be called
+ * before RiBegin()
+ */
+void
+ay_wrib_ribformat(void)
+{
+ RtString format, compression;
+#ifdef AYUSEAFFINE
+ RtInt precision = 0;
+#endif
+
+  if(ay_prefs.ribformat == 2)
+    format = "binary";
+  else
+    format = "ascii";
+
+  if(ay_prefs.ribcompress)
+    compression = "gzip";
+  else
+    compression = "none";
+
+  RiOption((RtToken)"rib", (RtToken)"format", (RtPointer)&format,
+	   (RtToken)"compression", (RtPointer)&compression, RI_NULL);
+
+#ifdef AYUSEAFFINE
+  /* number of significant digits, 9 suffice for single precision floats */
+  if(ay_prefs.ribformat == 1)
+    precision = 9;
+  RiOption((RtToken)"rib", (RtToken)"precision", (RtPointer)&precision,
+	   RI_NULL);
+#endif
+
+ return;
+} /* ay_wrib_ribformat */
+
+
 /** ay_wrib_rioptions:
  * export all RIB option settings from the root object to the currently
  * open RIB stream
@@ -547,7 +636,9 @@ ay_wrib_refobject(char *file, ay_object *o)
 	     }
 	   else
 	     {
-	       iafilename = ay_wrib_geniafilename(file, tag->val);
+	       iafilename = ay_wrib_cachename(file, o, AY_TRUE);
+	       if(!iafilename)
+		 iafilename = ay_wrib_geniafilename(file, tag->val);
 	       if(iafilename)
 		 {
 		   RiReadArchive(iafilename, (RtVoid*)RI_NULL, RI_NULL);
@@ -562,263 +653,1258 @@ ay_wrib_refobject(char *file, ay_object *o)
       tag = tag->next;
     } /* while */
 
-  if(!found)
-    return AY_ERROR; /* This should never happen! */
+  if(!found)
+    return AY_ERROR; /* This should never happen! */
+
+ return ay_status;
+} /* ay_wrib_refobject */
+
+
+/** ay_wrib_children:
+ * Export the child objects of an object to a RIB, including the
+ * necessary solid blocks and switching of local lights.
+ *
+ * \param[in] file RIB
+ * \param[in] o object whose children to export
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_children(char *file, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_object *down = NULL;
+ ay_level_object *l = NULL;
+ ay_light_object *light = NULL;
+ int down_is_prim = AY_FALSE;
+
+  /* do not descend into light sources as the arealight geometry
+     has been written long ago in the lights section of the RIB;  */
+  if(!o->down || !o->down->next || (o->type == AY_IDLIGHT) ||
+     o->hide_children)
+    return AY_OK;
+
+  /* first, if the current object is a level object,
+     write appropriate SolidBegin statements */
+  if(o->type == AY_IDLEVEL)
+    {
+      l = (ay_level_object*)o->refine;
+      switch(l->type)
+	{
+	case AY_LTUNION:
+	  RiSolidBegin(RI_UNION);
+	  break;
+	case AY_LTDIFF:
+	  RiSolidBegin(RI_DIFFERENCE);
+	  break;
+	case AY_LTINT:
+	  RiSolidBegin(RI_INTERSECTION);
+	  break;
+	case AY_LTPRIM:
+	  if(!ay_wrib_primlevel)
+	    {
+	      RiSolidBegin(RI_PRIMITIVE);
+	    }
+	  ay_wrib_primlevel++;
+	  break;
+	default:
+	  break;
+	} /* switch */
+    } /* if */
+
+  /* before writing the child objects, check for local lights
+     and switch them on */
+  down = o->down;
+  while(down->next)
+    {
+      if(down->type == AY_IDLIGHT)
+	{
+	  light = (ay_light_object*) down->refine;
+	  if(light->type != AY_LITCUSTOM)
+	    {
+	      if(light->on && light->local)
+		{
+		  RiIlluminate(light->light_handle, RI_TRUE);
+		}
+	    }
+	  else
+	    {
+	      if(light->lshader && light->on && light->local)
+		{
+		  RiIlluminate(light->light_handle, RI_TRUE);
+		}
+	    }
+	} /* if */
+      down = down->next;
+    } /* while */
+
+  /* finally, write the child objects */
+  down = o->down;
+  while(down->next)
+    {
+      down_is_prim = AY_FALSE;
+      if(ay_wrib_isprimitive(down))
+	{
+	  down_is_prim = AY_TRUE;
+	  if(l && ((l->type == AY_LTUNION) || (l->type == AY_LTDIFF) ||
+		   (l->type == AY_LTINT)))
+	    {
+	      if(!ay_wrib_primlevel)
+		{
+		  RiSolidBegin(RI_PRIMITIVE);
+		}
+	      ay_wrib_primlevel++;
+	    } /* if */
+	} /* if */
+
+      ay_status = ay_wrib_object(file, down);
+      if(ay_status)
+	return ay_status;
+
+      if(down_is_prim)
+	{
+	  if(l && ((l->type == AY_LTUNION) || (l->type == AY_LTDIFF) ||
+		   (l->type == AY_LTINT)))
+	    {
+	      ay_wrib_primlevel--;
+	      if(!ay_wrib_primlevel)
+		{
+		  RiSolidEnd();
+		}
+	    } /* if */
+	} /* if */
+
+      down = down->next;
+    } /* while */
+
+  /* after writing the child objects, check for local lights
+     and switch them off again */
+  down = o->down;
+  while(down->next)
+    {
+      if(down->type == AY_IDLIGHT)
+	{
+	  light = (ay_light_object*) down->refine;
+	  if(light->type != AY_LITCUSTOM)
+	    {
+	      if(light->on && light->local)
+		{
+		  RiIlluminate(light->light_handle, RI_FALSE);
+		}
+	    }
+	  else
+	    {
+	      if(light->lshader && light->on && light->local)
+		{
+		  RiIlluminate(light->light_handle, RI_FALSE);
+		}
+	    }
+	} /* if */
+      down = down->next;
+    } /* while */
+
+  /* write appropriate SolidEnd statements */
+  if(l)
+    {
+      if(l->type > 1)
+	{
+	  if(l->type == AY_LTPRIM)
+	    {
+	      ay_wrib_primlevel--;
+	      if(!ay_wrib_primlevel)
+		{
+		  RiSolidEnd();
+		}
+	    }
+	  else
+	    {
+	      RiSolidEnd();
+	    } /* if */
+	} /* if */
+    } /* if */
+
+ return ay_status;
+} /* ay_wrib_children */
+
+
+/** ay_wrib_objectarchive:
+ * Export a single object to a RIB; if \a archive is not NULL, the
+ * geometry of the object and its children are not written but
+ * read from this (cached) archive file.
+ *
+ * \param[in] file RIB
+ * \param[in] o object to export
+ * \param[in] archive archive file name, may be NULL
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_objectarchive(char *file, ay_object *o, char *archive)
+{
+ int ay_status = AY_OK;
+ ay_voidfp *arr = NULL;
+ ay_wribcb *cb = NULL;
+ char *parname = "name";
+
+  if(!o)
+    return AY_ENULL;
+
+  if(ay_prefs.excludehidden && o->hide)
+    return AY_OK;
+
+  if(ay_tags_hastag(o, ay_noexport_tagtype))
+    return AY_OK;
+
+  if(!o->refine && !archive)
+    (void)ay_bin_load(o);
+
+  arr = ay_wribcbt.arr;
+  cb = (ay_wribcb *)(arr[o->type]);
+
+  if((!ay_prefs.resolveinstances) && (o->type != AY_IDMATERIAL) &&
+     (o->refcount) && (cb))
+    {
+      return ay_wrib_refobject(file, o);
+    }
+
+  if(cb)
+    {
+      /* write name */
+      if(ay_prefs.writeident)
+	{
+	  if(o->name)
+	    {
+	      if(!ay_prefs.ristandard)
+		{
+		  RiDeclare(parname, "string");
+		  RiAttribute("identifier", parname,
+			      (RtPointer)&o->name, RI_NULL);
+		}
+	      else
+		{
+		  RiArchiveRecord(RI_COMMENT, o->name);
+		}
+	    }
+	}
+      else
+	{
+	  if(o->name)
+	    {
+	      RiArchiveRecord(RI_COMMENT, o->name);
+	    }
+	}
+
+      RiAttributeBegin();
+      RiTransformBegin();
+
+      /* write transformations */
+      ay_wrib_trafos(o);
+
+      /* write material information */
+      if(o->type != AY_IDINSTANCE)
+	{
+	  if(o->mat)
+	    {
+	      ay_status = ay_matt_wrib(o->mat);
+	    }
+
+	  /* write tags */
+	  if(o->tags)
+	    {
+	      ay_status += ay_riattr_wrib(o);
+	      ay_status += ay_tc_wrib(o);
+	    } /* if */
+
+	  if(ay_status)
+	    {
+	      return AY_ERROR;
+	    }
+	} /* if */
+    } /* if have export callback */
+
+  if(cb && archive)
+    {
+      RiReadArchive(archive, (RtVoid*)RI_NULL, RI_NULL);
+    }
+  else
+    {
+      /* write child objects */
+      ay_status = ay_wrib_children(file, o);
+      if(ay_status)
+	return ay_status;
+
+      if(cb)
+	{
+	  ay_status = cb(file, o);
+	}
+    } /* if */
+
+  if(cb)
+    {
+      RiTransformEnd();
+      RiAttributeEnd();
+    } /* if */
+
+ return ay_status;
+} /* ay_wrib_objectarchive */
+
+
+/** ay_wrib_object:
+ * Export a single object to a RIB.
+ *
+ * \param[in] file RIB
+ * \param[in] o object to export
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_object(char *file, ay_object *o)
+{
+ return ay_wrib_objectarchive(file, o, NULL);
+} /* ay_wrib_object */
+
+/* RIB archive cache:
+ * the geometry of top-level objects and of masters is written to
+ * archive files, named after a 64 bit hash of the object content
+ * (including all children, materials, and masters of instances), that
+ * are re-used by subsequent exports as long as the content does not
+ * change;
+ * the own hash of an object (its serialization without children and
+ * without transformation attributes, see ay_bin_writeobject()) is
+ * computed once and kept in ay_wrib_cacheht until
+ * ay_wrib_cacheinvalidate() is called for the object (which happens
+ * upon notification of the object or its children, property and tag
+ * edits, and deletion);
+ * the hash of a hierarchy is combined from the own hashes and the
+ * transformations of the children (and the hashes of the materials
+ * and masters used) by each export, so that any change of an object
+ * reaches the hashes of all its ancestors without serializing them
+ * anew; the hierarchy hashes are kept in ay_wrib_cachehierht only for
+ * the duration of the export, so that masters used by many instances
+ * are combined only once;
+ * a check sum of each archive name handed out is kept in
+ * ay_wrib_cachechkht to detect hash collisions
+ */
+
+/** ay_wrib_cachefreeht:
+ * forget all entries of a hash table of the RIB archive cache
+ *
+ * \param[in,out] ht hash table to clear
+ * \param[in] keytype type of keys in \a ht
+ */
+void
+ay_wrib_cachefreeht(Tcl_HashTable *ht, int keytype)
+{
+ Tcl_HashEntry *entry = NULL;
+ Tcl_HashSearch search;
+
+  entry = Tcl_FirstHashEntry(ht, &search);
+  while(entry)
+    {
+      free(Tcl_GetHashValue(entry));
+      entry = Tcl_NextHashEntry(&search);
+    }
+
+  Tcl_DeleteHashTable(ht);
+  Tcl_InitHashTable(ht, keytype);
+
+ return;
+} /* ay_wrib_cachefreeht */
+
+
+/** ay_wrib_cacheclear:
+ * forget all content hashes of the RIB archive cache
+ * (but do not remove any archive files)
+ */
+void
+ay_wrib_cacheclear(void)
+{
+
+  ay_wrib_cachefreeht(&ay_wrib_cacheht, TCL_ONE_WORD_KEYS);
+  ay_wrib_cachefreeht(&ay_wrib_cachehierht, TCL_ONE_WORD_KEYS);
+  ay_wrib_cachefreeht(&ay_wrib_cachechkht, TCL_STRING_KEYS);
+
+ return;
+} /* ay_wrib_cacheclear */
+
+
+/** ay_wrib_cacheinvalidate:
+ * forget the own content hash of object \a o; the hashes of all
+ * hierarchies containing \a o are combined anew by the next export
+ *
+ * \param[in] o changed or deleted object
+ */
+void
+ay_wrib_cacheinvalidate(ay_object *o)
+{
+ Tcl_HashEntry *entry = NULL;
+
+  if(!o)
+    return;
+
+  entry = Tcl_FindHashEntry(&ay_wrib_cacheht, (char*)o);
+  if(entry)
+    {
+      free(Tcl_GetHashValue(entry));
+      Tcl_DeleteHashEntry(entry);
+    }
+
+ return;
+} /* ay_wrib_cacheinvalidate */
+
+
+/** ay_wrib_cachebegin:
+ * prepare the RIB archive cache for an export to \a file;
+ * the cache is only active, if enabled in the preferences and
+ * when writing to a file
+ *
+ * \param[in] file RIB file name, may be NULL
+ */
+void
+ay_wrib_cachebegin(char *file)
+{
+
+  ay_wrib_cacheactive = AY_FALSE;
+
+  /* forget the hierarchy hashes of the last export */
+  ay_wrib_cachefreeht(&ay_wrib_cachehierht, TCL_ONE_WORD_KEYS);
+
+  if(!file || !ay_prefs.ribcache)
+    return;
+
+  /* the hashes depend on all preferences that change the
+     content of the archives */
+  ay_wrib_cacheprefs[0] = (unsigned int)ay_prefs.ribformat;
+  ay_wrib_cacheprefs[1] = (unsigned int)ay_prefs.ribcompress;
+  ay_wrib_cacheprefs[2] = (unsigned int)ay_prefs.writeident;
+  ay_wrib_cacheprefs[3] = (unsigned int)ay_prefs.ristandard;
+  ay_wrib_cacheprefs[4] = (unsigned int)ay_prefs.resolveinstances;
+  ay_wrib_cacheprefs[5] = (unsigned int)ay_prefs.excludehidden;
+  ay_wrib_cacheprefs[6] = (unsigned int)ay_prefs.use_sm;
+  ay_wrib_cacheprefs[7] = 0;
+
+  ay_wrib_cacheactive = AY_TRUE;
+
+ return;
+} /* ay_wrib_cachebegin */
+
+
+/** ay_wrib_cachehaslights:
+ * check whether a hierarchy contains light sources; their
+ * handles are only valid in the main RIB, so objects with lights
+ * below can not be cached
+ *
+ * \param[in] o object (list) to check
+ *
+ * \returns AY_TRUE if there are lights, AY_FALSE else
+ */
+int
+ay_wrib_cachehaslights(ay_object *o)
+{
+
+  while(o && o->next)
+    {
+      if(o->type == AY_IDLIGHT)
+	return AY_TRUE;
+
+      if(o->down && ay_wrib_cachehaslights(o->down))
+	return AY_TRUE;
+
+      o = o->next;
+    }
+
+ return AY_FALSE;
+} /* ay_wrib_cachehaslights */
+
+
+/** ay_wrib_cachefold:
+ * fold a hash into the content hash of \a bf
+ *
+ * \param[in,out] bf binary file without scene file, holding the hash
+ * \param[in] hash hash to fold [3]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_cachefold(ay_binfile *bf, unsigned int *hash)
+{
+ int ay_status = AY_OK;
+
+  ay_status = ay_bin_writeuints(bf, 3, hash);
+  if(!ay_status)
+    ay_status = ay_bin_flush(bf);
+
+ return ay_status;
+} /* ay_wrib_cachefold */
+
+
+/** ay_wrib_cacheown:
+ * get the own content hash of an object, i.e. the hash of the
+ * object without its children and transformation attributes
+ *
+ * \param[in] o object to process
+ * \param[in,out] hash where to store the hash [3]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_cacheown(ay_object *o, unsigned int *hash)
+{
+ int ay_status = AY_OK;
+ int new_item = 0;
+ Tcl_HashEntry *entry = NULL;
+ unsigned int *h = NULL;
+ ay_binfile bf = {0};
+
+  if((entry = Tcl_FindHashEntry(&ay_wrib_cacheht, (char*)o)))
+    {
+      memcpy(hash, Tcl_GetHashValue(entry), 3*sizeof(unsigned int));
+      return AY_OK;
+    }
+
+  if(!(h = malloc(3*sizeof(unsigned int))))
+    return AY_EOMEM;
+
+  ay_bin_hashinit(&bf);
+
+  ay_status = ay_bin_writeobject(&bf, o);
+
+  ay_bin_close(&bf);
+
+  if(ay_status)
+    {
+      free(h);
+      return ay_status;
+    }
+
+  memcpy(h, bf.hash, 3*sizeof(unsigned int));
+  memcpy(hash, h, 3*sizeof(unsigned int));
+
+  entry = Tcl_CreateHashEntry(&ay_wrib_cacheht, (char*)o, &new_item);
+  Tcl_SetHashValue(entry, (ClientData)h);
+
+ return AY_OK;
+} /* ay_wrib_cacheown */
+
+
+/** ay_wrib_cachehier:
+ * get the content hash of a hierarchy; the hash covers the object
+ * (except for its own transformation attributes, that are always
+ * written to the main RIB), its children, and all materials and
+ * masters they use
+ *
+ * \param[in] o object to process
+ * \param[in,out] hash where to store the hash [3]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_cachehier(ay_object *o, unsigned int *hash)
+{
+ int ay_status = AY_OK;
+ int new_item = 0;
+ Tcl_HashEntry *entry = NULL;
+ unsigned int *h = NULL;
+ ay_binfile bf = {0};
+ ay_object *d;
+ double trafos[13];
+
+  if((entry = Tcl_FindHashEntry(&ay_wrib_cachehierht, (char*)o)))
+    {
+      memcpy(hash, Tcl_GetHashValue(entry), 3*sizeof(unsigned int));
+      return AY_OK;
+    }
+
+  if(!(h = malloc(3*sizeof(unsigned int))))
+    return AY_EOMEM;
+
+  ay_bin_hashinit(&bf);
+
+  ay_status = ay_wrib_cacheown(o, h);
+  if(!ay_status)
+    ay_status = ay_wrib_cachefold(&bf, h);
+
+  /* materials and masters used */
+  if(!ay_status && o->mat && o->mat->objptr)
+    {
+      ay_status = ay_wrib_cachehier(o->mat->objptr, h);
+      if(!ay_status)
+	ay_status = ay_wrib_cachefold(&bf, h);
+    }
+
+  if(!ay_status && (o->type == AY_IDINSTANCE) && o->refine)
+    {
+      ay_status = ay_wrib_cachehier((ay_object*)o->refine, h);
+      if(!ay_status)
+	ay_status = ay_wrib_cachefold(&bf, h);
+    }
+
+  /* children, including their transformation attributes */
+  d = o->down;
+  while(!ay_status && d && d->next)
+    {
+      trafos[0] = d->movx;
+      trafos[1] = d->movy;
+      trafos[2] = d->movz;
+      trafos[3] = d->rotx;
+      trafos[4] = d->roty;
+      trafos[5] = d->rotz;
+      memcpy(&(trafos[6]), d->quat, 4*sizeof(double));
+      trafos[10] = d->scalx;
+      trafos[11] = d->scaly;
+      trafos[12] = d->scalz;
+
+      ay_status = ay_bin_writedoubles(&bf, 13, trafos);
+      if(!ay_status)
+	ay_status = ay_wrib_cachehier(d, h);
+      if(!ay_status)
+	ay_status = ay_wrib_cachefold(&bf, h);
+
+      d = d->next;
+    } /* while */
+
+  ay_bin_close(&bf);
+
+  if(ay_status)
+    {
+      free(h);
+      return ay_status;
+    }
+
+  memcpy(h, bf.hash, 3*sizeof(unsigned int));
+  memcpy(hash, h, 3*sizeof(unsigned int));
+
+  entry = Tcl_CreateHashEntry(&ay_wrib_cachehierht, (char*)o, &new_item);
+  Tcl_SetHashValue(entry, (ClientData)h);
+
+ return AY_OK;
+} /* ay_wrib_cachehier */
+
+
+/** ay_wrib_cachehash:
+ * get the content hash of an archive of an object, i.e. the hash
+ * of the hierarchy (see ay_wrib_cachehier()) and the preferences
+ *
+ * \param[in] o object to process
+ * \param[in,out] hash where to store the hash [3]
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_cachehash(ay_object *o, unsigned int *hash)
+{
+ int ay_status = AY_OK;
+ ay_binfile bf = {0};
+ unsigned int h[3];
+
+  ay_bin_hashinit(&bf);
+
+  /* the preferences change the content of the archives */
+  ay_status = ay_bin_writeuints(&bf, 8, ay_wrib_cacheprefs);
+  if(!ay_status)
+    ay_status = ay_bin_flush(&bf);
+
+  if(!ay_status)
+    ay_status = ay_wrib_cachehier(o, h);
+
+  if(!ay_status)
+    ay_status = ay_wrib_cachefold(&bf, h);
+
+  ay_bin_close(&bf);
+
+  if(!ay_status)
+    memcpy(hash, bf.hash, 3*sizeof(unsigned int));
+
+ return ay_status;
+} /* ay_wrib_cachehash */
+
+
+/** ay_wrib_cachename:
+ * get the name of the cached archive of an object
+ *
+ * \param[in] file RIB file name, base for the archive file name
+ * \param[in] o object to process
+ * \param[in] master if AY_TRUE, the archive holds a master for
+ *  instances (see ay_instt_wribiarchives()), otherwise the archive
+ *  holds the geometry of a top-level object
+ *
+ * \returns archive file name (allocated, free it!), or NULL if the
+ *  cache is not active or the object can not be cached
+ */
+char *
+ay_wrib_cachename(char *file, ay_object *o, int master)
+{
+ char fname[] = "wrib_cachename";
+ ay_wribcb *cb = NULL;
+ Tcl_HashEntry *entry = NULL;
+ unsigned int hash[3], *check = NULL;
+ int new_item = 0;
+ char hstr[20];
+
+  if(!ay_wrib_cacheactive || !file || !o)
+    return NULL;
+
+  if(o->type < ay_wribcbt.size)
+    cb = (ay_wribcb *)(ay_wribcbt.arr[o->type]);
+
+  if(!cb || (o->type == AY_IDLIGHT) || (o->type == AY_IDMATERIAL))
+    return NULL;
+
+  if(!master)
+    {
+      if((ay_prefs.excludehidden && o->hide) ||
+	 ay_tags_hastag(o, ay_noexport_tagtype))
+	return NULL;
+
+      /* masters are exported via ay_wrib_refobject() */
+      if(o->refcount && !ay_prefs.resolveinstances)
+	return NULL;
+    }
+
+  if(ay_wrib_cachehaslights(o->down))
+    return NULL;
+
+  if(ay_wrib_cachehash(o, hash))
+    return NULL;
+
+  sprintf(hstr, "%c%08x%08x", master?'m':'o', hash[0], hash[1]);
+
+  /* different content with the same hash must not share an archive */
+  entry = Tcl_CreateHashEntry(&ay_wrib_cachechkht, hstr, &new_item);
+  if(new_item)
+    {
+      if(!(check = malloc(sizeof(unsigned int))))
+	{
+	  Tcl_DeleteHashEntry(entry);
+	  return NULL;
+	}
+      *check = hash[2];
+      Tcl_SetHashValue(entry, (ClientData)check);
+    }
+  else
+    {
+      check = (unsigned int *)Tcl_GetHashValue(entry);
+      if(*check != hash[2])
+	{
+	  ay_error(AY_EWARN, fname,
+		   "Hash collision, exporting object without archive cache:");
+	  ay_error(AY_EWARN, fname, o->name?o->name:hstr);
+	  return NULL;
+	}
+    }
+
+ return ay_wrib_geniafilename(file, hstr);
+} /* ay_wrib_cachename */
+
+
+/** ay_wrib_cacheexists:
+ * check whether an archive file has been written before
+ *
+ * \param[in] archive archive file name
+ *
+ * \returns AY_TRUE if the file exists, AY_FALSE else
+ */
+int
+ay_wrib_cacheexists(char *archive)
+{
+ FILE *fileptr = NULL;
+
+  if((fileptr = fopen(archive, "rb")))
+    {
+      fclose(fileptr);
+      return AY_TRUE;
+    }
+
+ return AY_FALSE;
+} /* ay_wrib_cacheexists */
+
+
+/** ay_wrib_cachewrite:
+ * write the archives of all top-level objects whose content changed
+ * since the last export; must be called before RiBegin() of the
+ * main RIB (and after ay_wrib_ribformat())
+ *
+ * \param[in] file RIB file name
+ * \param[in] o first top-level object
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_cachewrite(char *file, ay_object *o)
+{
+ int ay_status = AY_OK;
+ char fname[] = "wrib_cachewrite";
+ char *archive = NULL, *tmpname = NULL;
+ ay_wribcb *cb = NULL;
+
+  while(o && o->next && !ay_status)
+    {
+      archive = ay_wrib_cachename(file, o, AY_FALSE);
+      if(archive && !ay_wrib_cacheexists(archive))
+	{
+	  if(!(tmpname = malloc((strlen(archive)+5)*sizeof(char))))
+	    {
+	      free(archive);
+	      return AY_EOMEM;
+	    }
+	  sprintf(tmpname, "%s.tmp", archive);
+
+	  if(!o->refine)
+	    (void)ay_bin_load(o);
+
+	  cb = (ay_wribcb *)(ay_wribcbt.arr[o->type]);
+
+	  /* write to a temporary file first, so that an interrupted
+	     export leaves no incomplete archive behind */
+	  RiBegin(tmpname);
+	   ay_status = ay_wrib_children(file, o);
+	   if(!ay_status)
+	     ay_status = cb(file, o);
+	  RiEnd();
+
+	  if(!ay_status)
+	    {
+	      (void)remove(archive);
+	      if(rename(tmpname, archive))
+		{
+		  ay_error(AY_ERROR, fname, "could not rename archive:");
+		  ay_error(AY_ERROR, fname, tmpname);
+		  ay_status = AY_ERROR;
+		}
+	    }
+	  else
+	    {
+	      (void)remove(tmpname);
+	    }
+	  free(tmpname);
+	} /* if */
+
+      if(archive)
+	free(archive);
+
+      o = o->next;
+    } /* while */
+
+ return ay_status;
+} /* ay_wrib_cachewrite */
+
+
+/** ay_wrib_cachedobject:
+ * Export a top-level object to a RIB, reading its geometry from the
+ * cached archive written by ay_wrib_cachewrite() if possible.
+ *
+ * \param[in] file RIB
+ * \param[in] o object to export
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_cachedobject(char *file, ay_object *o)
+{
+ int ay_status = AY_OK;
+ char *archive = NULL;
+
+  archive = ay_wrib_cachename(file, o, AY_FALSE);
+
+  ay_status = ay_wrib_objectarchive(file, o, archive);
+
+  if(archive)
+    free(archive);
+
+ return ay_status;
+} /* ay_wrib_cachedobject */
+
+
+#ifdef AYUSEAFFINE
+/** ay_wrib_parallelsafetags:
+ * check whether the tags of an object and its material permit
+ * parallel export (see ay_wrib_parallelsafe())
+ *
+ * \param[in] o object to check
+ *
+ * \returns AY_TRUE if the tags permit parallel export, AY_FALSE else
+ */
+int
+ay_wrib_parallelsafetags(ay_object *o)
+{
+ ay_mat_object *mat = NULL;
+
+  if(o->tags && (ay_tags_hastag(o, ay_pv_tagtype) ||
+		 ay_tags_hastag(o, ay_riattr_tagtype) ||
+		 ay_tags_hastag(o, ay_tc_tagtype)))
+    return AY_FALSE;
+
+  mat = o->mat;
+  if(mat && mat->objptr && mat->objptr->tags &&
+     (ay_tags_hastag(mat->objptr, ay_riattr_tagtype) ||
+      ay_tags_hastag(mat->objptr, ay_tc_tagtype)))
+    return AY_FALSE;
+
+ return AY_TRUE;
+} /* ay_wrib_parallelsafetags */
+
+
+/** ay_wrib_parallelsafetrims:
+ * check whether the trim curves of a NURBS patch may be exported
+ * by a worker thread; this is the case if all trim curves are
+ * NURBS curves (possibly in levels), as other objects would have to
+ * be asked to provide NURBS curves
+ *
+ * \param[in] t trim curves (children of the patch) to check
+ *
+ * \returns AY_TRUE if the trim curves may be exported in parallel,
+ *  AY_FALSE else
+ */
+int
+ay_wrib_parallelsafetrims(ay_object *t)
+{
+ ay_object *l;
+
+  while(t && t->next)
+    {
+      switch(t->type)
+	{
+	case AY_IDNCURVE:
+	  break;
+	case AY_IDLEVEL:
+	  l = t->down;
+	  while(l && l->next)
+	    {
+	      if(l->type != AY_IDNCURVE)
+		return AY_FALSE;
+	      l = l->next;
+	    }
+	  break;
+	default:
+	  return AY_FALSE;
+	} /* switch */
+      t = t->next;
+    } /* while */
 
- return ay_status;
-} /* ay_wrib_refobject */
+ return AY_TRUE;
+} /* ay_wrib_parallelsafetrims */
 
 
-/** ay_wrib_object:
- * Export a single object to a RIB.
+/** ay_wrib_parallelsafenp:
+ * check whether a list of NURBS patches created by a tool object
+ * (e.g. the surface or the caps and bevels of a Sweep) may be exported
+ * by a worker thread
  *
- * \param[in] file RIB
- * \param[in] o object to export
+ * \param[in] o patches (a NULL terminated list) to check
  *
- * \returns AY_OK on success, error code otherwise.
+ * \returns AY_TRUE if the patches may be exported in parallel,
+ *  AY_FALSE else
  */
 int
-ay_wrib_object(char *file, ay_object *o)
+ay_wrib_parallelsafenp(ay_object *o)
 {
- int ay_status = AY_OK;
- ay_object *down = NULL;
- ay_voidfp *arr = NULL;
- ay_wribcb *cb = NULL;
- ay_level_object *l = NULL;
- ay_light_object *light = NULL;
- int down_is_prim = AY_FALSE;
- char *parname = "name";
+ ay_nurbpatch_object *np = NULL;
 
-  if(!o)
-    return AY_ENULL;
+  while(o)
+    {
+      if(o->type != AY_IDNPATCH || !o->refine)
+	return AY_FALSE;
 
-  if(ay_prefs.excludehidden && o->hide)
-    return AY_OK;
+      if(!ay_wrib_parallelsafetags(o))
+	return AY_FALSE;
 
-  if(ay_tags_hastag(o, ay_noexport_tagtype))
-    return AY_OK;
+      np = (ay_nurbpatch_object*)o->refine;
+      if(np->caps_and_bevels)
+	return AY_FALSE;
 
-  arr = ay_wribcbt.arr;
-  cb = (ay_wribcb *)(arr[o->type]);
+      if(o->down && o->down->next &&
+	 (!ay_wrib_parallelsafetrims(o->down) ||
+	  !ay_wrib_parallelsafe(o->down)))
+	return AY_FALSE;
 
-  if((!ay_prefs.resolveinstances) && (o->type != AY_IDMATERIAL) &&
-     (o->refcount) && (cb))
-    {
-      return ay_wrib_refobject(file, o);
-    }
+      o = o->next;
+    } /* while */
 
-  if(cb)
+ return AY_TRUE;
+} /* ay_wrib_parallelsafenp */
+
+
+/** ay_wrib_parallelsafe:
+ * check whether an object hierarchy may be exported by a worker
+ * thread; this is the case if all objects are of a type whose
+ * export only reads the object data and neither reports errors
+ * (which is not possible outside of the main thread) nor depends
+ * on global state (light handles, CSG, RIB archive cache);
+ * tags that are parsed with strtok() or may be faulty (PV, RiAttribute,
+ * TC) also prevent parallel export;
+ * tool objects (Revolve, Extrude, Sweep, Birail1, Birail2, Skin, Gordon)
+ * are safe if their patches, caps, and bevels are
+ *
+ * \param[in] o object (list) to check
+ *
+ * \returns AY_TRUE if the hierarchy may be exported in parallel,
+ *  AY_FALSE else
+ */
+int
+ay_wrib_parallelsafe(ay_object *o)
+{
+ ay_level_object *level = NULL;
+ ay_nurbpatch_object *np = NULL;
+ ay_pamesh_object *pm = NULL;
+ ay_object *tnp = NULL, *tcb = NULL;
+
+  while(o && o->next)
     {
-      /* write name */
-      if(ay_prefs.writeident)
-	{
-	  if(o->name)
-	    {
-	      if(!ay_prefs.ristandard)
-		{
-		  RiDeclare(parname, "string");
-		  RiAttribute("identifier", parname,
-			      (RtPointer)&o->name, RI_NULL);
-		}
-	      else
-		{
-		  RiArchiveRecord(RI_COMMENT, o->name);
-		}
-	    }
-	}
-      else
-	{
-	  if(o->name)
-	    {
-	      RiArchiveRecord(RI_COMMENT, o->name);
-	    }
-	}
+      if(!o->refine)
+	return AY_FALSE;
 
-      RiAttributeBegin();
-      RiTransformBegin();
+      /* masters are referenced via the archive cache */
+      if(o->refcount && ay_wrib_cacheactive)
+	return AY_FALSE;
 
-      /* write transformations */
-      ay_wrib_trafos(o);
+      if(!ay_wrib_parallelsafetags(o))
+	return AY_FALSE;
 
-      /* write material information */
-      if(o->type != AY_IDINSTANCE)
+      tnp = NULL;
+      tcb = NULL;
+      switch(o->type)
 	{
-	  if(o->mat)
-	    {
-	      ay_status = ay_matt_wrib(o->mat);
-	    }
+	case AY_IDNPATCH:
+	  /* caps are provided by other objects */
+	  np = (ay_nurbpatch_object*)o->refine;
+	  if(np->caps_and_bevels || !ay_wrib_parallelsafetrims(o->down))
+	    return AY_FALSE;
+	  break;
+	case AY_IDREVOLVE:
+	  tnp = ((ay_revolve_object*)o->refine)->npatch;
+	  tcb = ((ay_revolve_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDEXTRUDE:
+	  tnp = ((ay_extrude_object*)o->refine)->npatch;
+	  tcb = ((ay_extrude_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDSWEEP:
+	  tnp = ((ay_sweep_object*)o->refine)->npatch;
+	  tcb = ((ay_sweep_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDBIRAIL1:
+	  tnp = ((ay_birail1_object*)o->refine)->npatch;
+	  tcb = ((ay_birail1_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDBIRAIL2:
+	  tnp = ((ay_birail2_object*)o->refine)->npatch;
+	  tcb = ((ay_birail2_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDSKIN:
+	  tnp = ((ay_skin_object*)o->refine)->npatch;
+	  tcb = ((ay_skin_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDGORDON:
+	  tnp = ((ay_gordon_object*)o->refine)->npatch;
+	  tcb = ((ay_gordon_object*)o->refine)->caps_and_bevels;
+	  break;
+	case AY_IDPAMESH:
+	  pm = (ay_pamesh_object*)o->refine;
+	  if(pm->caps_and_bevels)
+	    return AY_FALSE;
+	  break;
+	case AY_IDLEVEL:
+	  level = (ay_level_object*)o->refine;
+	  if(level->type != AY_LTLEVEL)
+	    return AY_FALSE;
+	  if(o->down && !ay_wrib_parallelsafe(o->down))
+	    return AY_FALSE;
+	  break;
+	case AY_IDINSTANCE:
+	  /* references to masters use the archive cache */
+	  if(ay_prefs.resolveinstances || ay_wrib_cacheactive)
+	    return AY_FALSE;
+	  break;
+	case AY_IDNCURVE:
+	case AY_IDBOX:
+	case AY_IDBPATCH:
+	case AY_IDSPHERE:
+	case AY_IDDISK:
+	case AY_IDCONE:
+	case AY_IDCYLINDER:
+	case AY_IDPARABOLOID:
+	case AY_IDHYPERBOLOID:
+	case AY_IDTORUS:
+	case AY_IDPOMESH:
+	case AY_IDSDMESH:
+	  break;
+	default:
+	  return AY_FALSE;
+	} /* switch */
 
-	  /* write tags */
-	  if(o->tags)
-	    {
-	      ay_status += ay_riattr_wrib(o);
-	      ay_status += ay_tc_wrib(o);
-	    } /* if */
+      /* the tool objects export their patches, caps, and bevels */
+      if(!ay_wrib_parallelsafenp(tnp) || !ay_wrib_parallelsafenp(tcb))
+	return AY_FALSE;
 
-	  if(ay_status)
-	    {
-	      return AY_ERROR;
-	    }
-	} /* if */
-    } /* if have export callback */
+      /* the children (e.g. trim curves or the parameter curves of
+	 tool objects) are exported as well */
+      if(o->type != AY_IDLEVEL && o->down && o->down->next &&
+	 !ay_wrib_parallelsafe(o->down))
+	return AY_FALSE;
 
-  /* write child objects, but do not descend into light sources as
-     the arealight geometry has been written long ago in the lights
-     section of the RIB;  */
-  if(o->down && o->down->next && (o->type != AY_IDLIGHT) &&
-     !o->hide_children)
-    {
-      /* first, if the current object is a level object,
-	 write appropriate SolidBegin statements */
-      l = NULL;
-      if(o->type == AY_IDLEVEL)
-	{
-	  l = (ay_level_object*)o->refine;
-	  switch(l->type)
-	    {
-	    case AY_LTUNION:
-	      RiSolidBegin(RI_UNION);
-	      break;
-	    case AY_LTDIFF:
-	      RiSolidBegin(RI_DIFFERENCE);
-	      break;
-	    case AY_LTINT:
-	      RiSolidBegin(RI_INTERSECTION);
-	      break;
-	    case AY_LTPRIM:
-	      if(!ay_wrib_primlevel)
-		{
-		  RiSolidBegin(RI_PRIMITIVE);
-		}
-	      ay_wrib_primlevel++;
-	      break;
-	    default:
-	      break;
-	    } /* switch */
-	} /* if */
+      o = o->next;
+    } /* while */
 
-      /* before writing the child objects, check for local lights
-	 and switch them on */
-      down = o->down;
-      while(down->next)
-	{
-	  if(down->type == AY_IDLIGHT)
-	    {
-	      light = (ay_light_object*) down->refine;
-	      if(light->type != AY_LITCUSTOM)
-		{
-		  if(light->on && light->local)
-		    {
-		      RiIlluminate(light->light_handle, RI_TRUE);
-		    }
-		}
-	      else
-		{
-		  if(light->lshader && light->on && light->local)
-		    {
-		      RiIlluminate(light->light_handle, RI_TRUE);
-		    }
-		}
-	    } /* if */
-	  down = down->next;
-	} /* while */
+ return AY_TRUE;
+} /* ay_wrib_parallelsafe */
 
-      /* finally, write the child objects */
-      down = o->down;
-      while(down->next)
-	{
-	  down_is_prim = AY_FALSE;
-	  if(ay_wrib_isprimitive(down))
-	    {
-	      down_is_prim = AY_TRUE;
-	      if(l && ((l->type == AY_LTUNION) || (l->type == AY_LTDIFF) ||
-		       (l->type == AY_LTINT)))
-		{
-		  if(!ay_wrib_primlevel)
-		    {
-		      RiSolidBegin(RI_PRIMITIVE);
-		    }
-		  ay_wrib_primlevel++;
-		} /* if */
-	    } /* if */
 
-	  ay_status = ay_wrib_object(file, down);
-	  if(ay_status)
-	    return ay_status;
+/** ay_wrib_objectcb:
+ * work callback of ay_wrib_objects(), export one top-level object
+ * to a RIB fragment
+ *
+ * \param[in,out] data the job (ay_wrib_pjob)
+ * \param[in] item index of the object to export
+ * \param[in] thread index of worker thread (unused)
+ *
+ * \returns AY_OK (errors are kept in the job, so that the other
+ *  objects are still exported)
+ */
+int
+ay_wrib_objectcb(void *data, int item, int thread)
+{
+ ay_wrib_pjob *job = (ay_wrib_pjob*)data;
 
-	  if(down_is_prim)
-	    {
-	      if(l && ((l->type == AY_LTUNION) || (l->type == AY_LTDIFF) ||
-		       (l->type == AY_LTINT)))
-		{
-		  ay_wrib_primlevel--;
-		  if(!ay_wrib_primlevel)
-		    {
-		      RiSolidEnd();
-		    }
-		} /* if */
-	    } /* if */
+  job->fragments[item] = RiFragmentBegin();
+  if(!job->fragments[item])
+    {
+      job->status[item] = AY_EOMEM;
+      return AY_OK;
+    }
+  job->status[item] = ay_wrib_objectarchive(job->file, job->objects[item],
+					    job->archives[item]);
+  RiFragmentEnd();
+
+ return AY_OK;
+} /* ay_wrib_objectcb */
+#endif /* AYUSEAFFINE */
+
+
+/** ay_wrib_objects:
+ * Export a list of top-level objects to a RIB, using the RIB archive
+ * cache (see ay_wrib_cachedobject()); if enabled in the preferences,
+ * the objects are exported in parallel to RIB fragments that are
+ * then written in scene order; objects that are not safe to export
+ * in parallel (see ay_wrib_parallelsafe()), whose export failed in the
+ * worker (e.g. to report an error, see ay_shader_wrib()), or whose
+ * fragment can not be used (see RiFragmentWrite()) are exported in
+ * the main thread, so that the resulting RIB is the same as with a
+ * serial export.
+ *
+ * \param[in] file RIB
+ * \param[in] o first top-level object
+ *
+ * \returns AY_OK on success, error code otherwise.
+ */
+int
+ay_wrib_objects(char *file, ay_object *o)
+{
+ int ay_status = AY_OK;
+#ifdef AYUSEAFFINE
+ ay_wrib_pjob job = {0};
+ ay_object *p;
+ int i, n = 0, np = 0;
+#endif
 
-	  down = down->next;
-	} /* while */
+#ifdef AYUSEAFFINE
+  if(ay_prefs.ribparallel && (ay_tp_getnumthreads() > 1))
+    {
+      /* export needs all data loaded, which can not happen
+	 in the worker threads */
+      ay_bin_loadall(o);
 
-      /* after writing the child objects, check for local lights
-	 and switch them off again */
-      down = o->down;
-      while(down->next)
+      p = o;
+      while(p && p->next)
 	{
-	  if(down->type == AY_IDLIGHT)
-	    {
-	      light = (ay_light_object*) down->refine;
-	      if(light->type != AY_LITCUSTOM)
-		{
-		  if(light->on && light->local)
-		    {
-		      RiIlluminate(light->light_handle, RI_FALSE);
-		    }
-		}
-	      else
-		{
-		  if(light->lshader && light->on && light->local)
-		    {
-		      RiIlluminate(light->light_handle, RI_FALSE);
-		    }
-		}
-	    } /* if */
-	  down = down->next;
-	} /* while */
+	  n++;
+	  p = p->next;
+	}
 
-      /* write appropriate SolidEnd statements */
-      if(l)
+      if(n > 1)
 	{
-	  if(l->type > 1)
+	  if(!(job.objects = calloc(n, sizeof(ay_object*))) ||
+	     !(job.archives = calloc(n, sizeof(char*))) ||
+	     !(job.fragments = calloc(n, sizeof(RtPointer))) ||
+	     !(job.status = calloc(n, sizeof(int))))
+	    {
+	      ay_status = AY_EOMEM;
+	      goto cleanup;
+	    }
+	  job.file = file;
+
+	  /* collect the objects that may be exported in parallel,
+	     archive names are computed here as the cache is not
+	     thread safe */
+	  p = o;
+	  while(p && p->next)
 	    {
-	      if(l->type == AY_LTPRIM)
+	      if(ay_wrib_parallelsafe(p))
 		{
-		  ay_wrib_primlevel--;
-		  if(!ay_wrib_primlevel)
-		    {
-		      RiSolidEnd();
-		    }
+		  job.archives[np] = ay_wrib_cachename(file, p, AY_FALSE);
+		  job.objects[np] = p;
+		  np++;
 		}
-	      else
-		{
-		  RiSolidEnd();
-		} /* if */
-	    } /* if */
+	      p = p->next;
+	    }
+
+	  if(np > 1)
+	    (void)ay_tp_run(np, ay_wrib_objectcb, &job);
+	  else
+	    np = 0;
 	} /* if */
     } /* if */
 
-  if(cb)
+  /* write all objects in scene order */
+  i = 0;
+  while(o && o->next)
     {
-      ay_status = cb(file, o);
+      if(i < np && job.objects[i] == o)
+	{
+	  if(job.status[i] || !RiFragmentWrite(job.fragments[i]))
+	    ay_status = ay_wrib_objectarchive(file, o, job.archives[i]);
+	  RiFragmentFree(job.fragments[i]);
+	  job.fragments[i] = NULL;
+	  i++;
+	}
+      else
+	{
+	  ay_status = ay_wrib_cachedobject(file, o);
+	}
+      if(ay_status)
+	break;
+      o = o->next;
+    } /* while */
 
-      RiTransformEnd();
-      RiAttributeEnd();
-    } /* if */
+cleanup:
+  if(job.fragments)
+    {
+      for(i = 0; i < np; i++)
+	RiFragmentFree(job.fragments[i]);
+      free(job.fragments);
+    }
+  if(job.archives)
+    {
+      for(i = 0; i < np; i++)
+	if(job.archives[i])
+	  free(job.archives[i]);
+      free(job.archives);
+    }
+  if(job.objects)
+    free(job.objects);
+  if(job.status)
+    free(job.status);
+#else
+  while(o && o->next)
+    {
+      ay_status = ay_wrib_cachedobject(file, o);
+      if(ay_status)
+	break;
+      o = o->next;
+    }
+#endif /* AYUSEAFFINE */
 
  return ay_status;
-} /* ay_wrib_object */
+} /* ay_wrib_objects */
 
 
 /** ay_wrib_toolobject:
@@ -1785,6 +2871,9 @@ ay_wrib_scene(char *file, char *image, char *driver, int temp, int target,
 
   ay_wrib_primlevel = 0;
 
+  /* the instance archives below use the same format */
+  ay_wrib_ribformat();
+
   /* create obj-file name (for use with ShadowMaps) */
   if(ay_prefs.use_sm >= 1)
     {
@@ -1811,6 +2900,8 @@ ay_wrib_scene(char *file, char *image, char *driver, int temp, int target,
 	}
     }
 
+  /* use cached object archives? */
+  ay_wrib_cachebegin(file);
 
   if(!ay_prefs.resolveinstances)
     {
@@ -1838,6 +2929,17 @@ ay_wrib_scene(char *file, char *image, char *driver, int temp, int target,
 	}
     } /* if */
 
+  /* write archives of changed objects */
+  if(ay_wrib_cacheactive)
+    {
+      if(ay_prefs.use_sm >= 1)
+	ay_status = ay_wrib_cachewrite(objfile, ay_root->next);
+      else
+	ay_status = ay_wrib_cachewrite(file, ay_root->next);
+      if(ay_status)
+	goto cleanup;
+    }
+
   ay_wrib_framenum = 1;
 
   /* assemble args */
@@ -2100,14 +3202,7 @@ ay_wrib_scene(char *file, char *image, char *driver, int temp, int target,
     /* write objects */
     if(!ay_prefs.use_sm)
       {
-	o = ay_root->next;
-	while(o->next)
-	  {
-	    ay_status = ay_wrib_object(file, o);
-	    if(ay_status)
-	      break;
-	    o = o->next;
-	  }
+	ay_status = ay_wrib_objects(file, ay_root->next);
       }
     else
       {
@@ -2134,19 +3229,15 @@ ay_wrib_scene(char *file, char *image, char *driver, int temp, int target,
   if(ay_prefs.use_sm >= 1)
     {
       RiBegin(objfile);
-       o = ay_root->next;
-       while(o->next)
-	 {
-	   ay_status = ay_wrib_object(objfile, o);
-	   if(ay_status)
-	     break;
-	   o = o->next;
-	 }
+       ay_status = ay_wrib_objects(objfile, ay_root->next);
       RiEnd();
     } /* if */
 
 cleanup:
   /* clean up */
+  ay_wrib_cacheactive = AY_FALSE;
+  ay_wrib_cacheclear();
+
   if(objfile)
     {
       free(objfile);
@@ -2208,6 +3299,8 @@ ay_wrib_sm(char *file, int width, int height, int selonly)
 
   ay_wrib_framenum = 1;
 
+  ay_wrib_ribformat();
+
   if(!file) /* dump .rib to stdout? */
     RiBegin(RI_NULL);
   else
@@ -2512,6 +3605,7 @@ ay_wrib_tcmd(ClientData clientData, Tcl_Interp *interp,
 	      /* thus, always resolve instances */
 	      ay_prefs.resolveinstances = AY_TRUE;
 
+	      ay_wrib_ribformat();
 	      RiBegin(filename);
 	       while(sel)
 		 {
@@ -2529,6 +3623,7 @@ ay_wrib_tcmd(ClientData clientData, Tcl_Interp *interp,
 	    {
 	      /* export all objects */
 	      o = ay_root->next;
+	      ay_wrib_ribformat();
 	      RiBegin(filename);
 	       while(o)
 		 {
@@ -2857,7 +3952,7 @@ ay_wrib_pprevclose()
 
 /* ay_wrib_init:
  *  initialize wrib module by registering the RiDisplay, RiHider, and
- *  NoExport tag types
+ *  NoExport tag types, and by initializing the RIB archive cache
  */
 void
 ay_wrib_init(Tcl_Interp *interp)
@@ -2872,5 +3967,10 @@ ay_wrib_init(Tcl_Interp *interp)
   /* register NoExport tag type */
   (void)ay_tags_register(ay_noexport_tagname, &ay_noexport_tagtype);
 
+  /* initialize the RIB archive cache */
+  Tcl_InitHashTable(&ay_wrib_cacheht, TCL_ONE_WORD_KEYS);
+  Tcl_InitHashTable(&ay_wrib_cachehierht, TCL_ONE_WORD_KEYS);
+  Tcl_InitHashTable(&ay_wrib_cachechkht, TCL_STRING_KEYS);
+
  return;
 } /* ay_wrib_init */
@@ -284,15 +284,17 @@ ay_write_object(FILE *fileptr, ay_object *o)
 
 
 /* ay_write_scene:
- *
+ *  save the scene (or the <selected> objects) to the scene file <fname>,
+ *  if <binary> is AY_TRUE, use the binary format (see bin.c)
  */
 int
-ay_write_scene(char *fname, int selected)
+ay_write_scene(char *fname, int selected, int binary)
 {
  int ay_status = AY_OK;
  ay_object *o = ay_root;
  FILE *fileptr = NULL;
  char funcname[] = "write_scene";
+ ay_binfile bf = {0};
 
   if(selected)
     {
@@ -316,6 +318,10 @@ ay_write_scene(char *fname, int selected)
   if(!fname)
     return AY_ENULL;
 
+  /* load all lazily read data first, the file we are about to
+     overwrite may be the one it is mapped from */
+  ay_bin_loadall(ay_root);
+
   if(!(fileptr = fopen(fname, "wb")))
     {
       ay_error(AY_EOPENFILE, funcname, fname);
@@ -349,25 +355,31 @@ ay_write_scene(char *fname, int selected)
     }
 
   /* write header information */
-  ay_write_header(fileptr);
+  if(binary)
+    {
+      bf.fileptr = fileptr;
+      ay_status = ay_bin_writeheader(&bf);
+      if(ay_status)
+	goto cleanup;
+    }
+  else
+    {
+      ay_write_header(fileptr);
+    }
 
   /* omit EndLevel-object in top level! */
   while(o->next)
     {
-      if(selected)
+      if(!selected || o->selected)
 	{
-	  if(o->selected)
-	    {
-	      ay_status = ay_write_object(fileptr, o);
-	    }
-	}
-      else
-	{
-	  ay_status = ay_write_object(fileptr, o);
+	  if(binary)
+	    ay_status = ay_bin_writeobject(&bf, o);
+	  else
+	    ay_status = ay_write_object(fileptr, o);
 	}
 
       if(ay_status)
-	{ fclose(fileptr); return ay_status; }
+	goto cleanup;
       o = o->next;
     }
 
@@ -378,6 +390,8 @@ ay_write_scene(char *fname, int selected)
 
 cleanup:
 
+  ay_bin_close(&bf);
+
   if(fclose(fileptr))
     {
       ay_error(AY_ERROR, fname, strerror(errno));
@@ -395,19 +409,22 @@ ay_write_scenetcmd(ClientData clientData, Tcl_Interp *interp,
 		   int argc, char *argv[])
 {
  /*int ay_status = AY_OK;*/
- int selected = AY_FALSE;
+ int selected = AY_FALSE, binary = AY_FALSE;
 
   /* check args */
   if(argc < 2)
     {
-      ay_error(AY_EARGS, argv[0], "filename [1|0]");
+      ay_error(AY_EARGS, argv[0], "filename [selected [binary]]");
       return TCL_OK;
     }
 
   if(argc > 2)
     selected = atoi(argv[2]);
 
-  ay_write_scene(argv[1], selected);
+  if(argc > 3)
+    binary = atoi(argv[3]);
+
+  ay_write_scene(argv[1], selected, binary);
 
  return TCL_OK;
 } /* ay_write_scenetcmd */
@@ -97,6 +97,16 @@ int ay_objsel_processcb(struct Togl *togl, int argc, char *argv[]);
 int ay_objsel_getnmfrmndtcmd(ClientData clientData, Tcl_Interp *interp,
 			     int argc, char *argv[]);
 
+/** calculate the pick projection matrix of a view
+ */
+void ay_objsel_pickmatrix(struct Togl *togl, double x, double y,
+			  double boxw, double boxh, double *pm);
+
+/** pick a line strip
+ */
+int ay_objsel_hitstrip(double *mvp, double *v, int n, int stride, int rat,
+		       double *depth);
+
 /*! \file contrib.h \brief Ayam contrib API */
 
 #endif /* __contrib_h__ */
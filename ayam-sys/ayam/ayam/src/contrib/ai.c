@@ -19,6 +19,16 @@
 
 #include "ayam.h"
 
+/* types local to this module */
+
+/* candidate object for instancing */
+typedef struct ay_ai_entry_s {
+  ay_object *o; /* the object, NULL if it has been deleted */
+  unsigned int hash; /* fingerprint */
+  unsigned int last; /* index of last entry in the subtree of the object */
+  struct ay_ai_entry_s *next; /* next entry with the same fingerprint */
+} ay_ai_entry;
+
 /* variables local to this module */
 
 int comp_true, comp_false;
@@ -27,17 +37,42 @@ int ay_ai_ignoretags;
 int ay_ai_ignoremat;
 int ay_ai_scope;
 
+/* all candidate objects (in depth first order) */
+static ay_ai_entry *ay_ai_entries;
+static unsigned int ay_ai_numentries;
+
+/* entries by object */
+static Tcl_HashTable ay_ai_objectht;
+
+/* first entries of the lists of entries with the same fingerprint */
+static Tcl_HashTable ay_ai_hashht;
+
 /* prototypes of functions local to this module */
 
 int ay_ai_instanceabletype(unsigned int type);
 
 int ay_ai_compchildren(ay_object *o1, ay_object *o2);
 
+unsigned int ay_ai_hashbytes(unsigned int h, const void *data, size_t len);
+
+unsigned int ay_ai_hashdoubles(unsigned int h, const double *d, size_t n);
+
+unsigned int ay_ai_fingerprint(ay_object *o);
+
+unsigned int ay_ai_countobjects(ay_object *o);
+
+void ay_ai_indexobjects(ay_object *o, ay_ai_entry **postorder,
+			unsigned int *npost);
+
+int ay_ai_buildindex(ay_object *level, ay_list_object *sel);
+
+void ay_ai_freeindex(void);
+
 int ay_ai_instanceobject(ay_object *inst, ay_object *ref);
 
-int ay_ai_createinstances(ay_object *ref, ay_object *o);
+int ay_ai_createinstances(ay_object *ref);
 
-int ay_ai_makeinstances(ay_object *o, ay_object *level, ay_list_object *sel);
+int ay_ai_makeinstances(ay_object *o);
 
 int ay_ai_resolveinstances(ay_object *o, ay_convertcb *cb);
 
@@ -103,6 +138,341 @@ ay_ai_compchildren(ay_object *o1, ay_object *o2)
 } /* ay_comp_children */
 
 
+/* ay_ai_hashbytes:
+ *  fold <len> bytes at <data> into the (FNV-1a) hash <h>
+ */
+unsigned int
+ay_ai_hashbytes(unsigned int h, const void *data, size_t len)
+{
+ const unsigned char *c = (const unsigned char *)data;
+ size_t i;
+
+  for(i = 0; i < len; i++)
+    {
+      h ^= c[i];
+      h *= 16777619U;
+    }
+
+ return h;
+} /* ay_ai_hashbytes */
+
+
+/* ay_ai_hashdoubles:
+ *  fold <n> doubles at <d> into the hash <h>; -0.0 and 0.0 compare
+ *  equal and thus deliver the same hash
+ */
+unsigned int
+ay_ai_hashdoubles(unsigned int h, const double *d, size_t n)
+{
+ size_t i;
+ double v;
+
+  for(i = 0; i < n; i++)
+    {
+      v = d[i];
+      if(v == 0.0)
+	v = 0.0;
+      h = ay_ai_hashbytes(h, &v, sizeof(double));
+    }
+
+ return h;
+} /* ay_ai_hashdoubles */
+
+
+/* ay_ai_fingerprint:
+ *  calculate a hash of all properties of object <o> that are checked
+ *  by ay_ai_createinstances() (type, geometry as compared by the
+ *  comparison callbacks, tags, material, number of children and their
+ *  transformation attributes); objects that may become instances of
+ *  each other always have the same fingerprint
+ */
+unsigned int
+ay_ai_fingerprint(ay_object *o)
+{
+ unsigned int h = 2166136261U, total = 0, totalv = 0, i;
+ int n = 0;
+ ay_nurbpatch_object *np;
+ ay_nurbcurve_object *nc;
+ ay_pomesh_object *pm;
+ ay_sdmesh_object *sm;
+ ay_pamesh_object *pa;
+ ay_box_object *box;
+ ay_object *d;
+ ay_tag *tag;
+
+  h = ay_ai_hashbytes(h, &(o->type), sizeof(unsigned int));
+
+  if(o->refine)
+    {
+      switch(o->type)
+	{
+	case AY_IDNPATCH:
+	  np = (ay_nurbpatch_object *)o->refine;
+	  h = ay_ai_hashbytes(h, &(np->width), sizeof(int));
+	  h = ay_ai_hashbytes(h, &(np->height), sizeof(int));
+	  h = ay_ai_hashbytes(h, &(np->uorder), sizeof(int));
+	  h = ay_ai_hashbytes(h, &(np->vorder), sizeof(int));
+	  h = ay_ai_hashdoubles(h, np->uknotv, np->width+np->uorder);
+	  h = ay_ai_hashdoubles(h, np->vknotv, np->height+np->vorder);
+	  h = ay_ai_hashdoubles(h, np->controlv, 4*np->width*np->height);
+	  break;
+	case AY_IDNCURVE:
+	  nc = (ay_nurbcurve_object *)o->refine;
+	  h = ay_ai_hashbytes(h, &(nc->length), sizeof(int));
+	  h = ay_ai_hashbytes(h, &(nc->order), sizeof(int));
+	  h = ay_ai_hashdoubles(h, nc->knotv, nc->length+nc->order);
+	  h = ay_ai_hashdoubles(h, nc->controlv, 4*nc->length);
+	  break;
+	case AY_IDPOMESH:
+	  pm = (ay_pomesh_object *)o->refine;
+	  h = ay_ai_hashbytes(h, &(pm->npolys), sizeof(unsigned int));
+	  h = ay_ai_hashbytes(h, &(pm->ncontrols), sizeof(unsigned int));
+	  h = ay_ai_hashdoubles(h, pm->controlv,
+				pm->ncontrols*(pm->has_normals?6:3));
+	  h = ay_ai_hashbytes(h, pm->nloops, pm->npolys*sizeof(unsigned int));
+	  for(i = 0; i < pm->npolys; i++)
+	    total += pm->nloops[i];
+	  h = ay_ai_hashbytes(h, pm->nverts, total*sizeof(unsigned int));
+	  for(i = 0; i < total; i++)
+	    totalv += pm->nverts[i];
+	  h = ay_ai_hashbytes(h, pm->verts, totalv*sizeof(unsigned int));
+	  break;
+	case AY_IDSDMESH:
+	  sm = (ay_sdmesh_object *)o->refine;
+	  h = ay_ai_hashbytes(h, &(sm->nfaces), sizeof(unsigned int));
+	  h = ay_ai_hashbytes(h, &(sm->ncontrols), sizeof(unsigned int));
+	  h = ay_ai_hashdoubles(h, sm->controlv, sm->ncontrols*3);
+	  h = ay_ai_hashbytes(h, sm->nverts, sm->nfaces*sizeof(unsigned int));
+	  for(i = 0; i < sm->nfaces; i++)
+	    total += sm->nverts[i];
+	  h = ay_ai_hashbytes(h, sm->verts, total*sizeof(unsigned int));
+	  break;
+	case AY_IDPAMESH:
+	  pa = (ay_pamesh_object *)o->refine;
+	  h = ay_ai_hashbytes(h, &(pa->width), sizeof(int));
+	  h = ay_ai_hashbytes(h, &(pa->height), sizeof(int));
+	  h = ay_ai_hashbytes(h, &(pa->type), sizeof(int));
+	  if(pa->controlv)
+	    h = ay_ai_hashdoubles(h, pa->controlv, 4*pa->width*pa->height);
+	  break;
+	case AY_IDBOX:
+	  box = (ay_box_object *)o->refine;
+	  h = ay_ai_hashdoubles(h, &(box->width), 1);
+	  h = ay_ai_hashdoubles(h, &(box->length), 1);
+	  h = ay_ai_hashdoubles(h, &(box->height), 1);
+	  break;
+	case AY_IDLEVEL:
+	  h = ay_ai_hashbytes(h, o->refine, sizeof(ay_level_object));
+	  break;
+	default:
+	  /* other types are distinguished by the comparison only */
+	  break;
+	} /* switch */
+    } /* if */
+
+  if(!ay_ai_ignoretags)
+    {
+      tag = o->tags;
+      while(tag)
+	{
+	  h = ay_ai_hashbytes(h, &(tag->type), sizeof(unsigned int));
+	  if(!tag->is_binary && tag->val)
+	    h = ay_ai_hashbytes(h, tag->val, strlen(tag->val));
+	  tag = tag->next;
+	}
+    }
+
+  if(!ay_ai_ignoremat)
+    h = ay_ai_hashbytes(h, &(o->mat), sizeof(ay_mat_object *));
+
+  /* children are compared by reference and transformation
+     attributes (see ay_ai_compchildren()), the references may
+     change while instances are created */
+  d = o->down;
+  while(d && d->next)
+    {
+      h = ay_ai_hashdoubles(h, &(d->movx), 1);
+      h = ay_ai_hashdoubles(h, &(d->movy), 1);
+      h = ay_ai_hashdoubles(h, &(d->movz), 1);
+      h = ay_ai_hashdoubles(h, &(d->scalx), 1);
+      h = ay_ai_hashdoubles(h, &(d->scaly), 1);
+      h = ay_ai_hashdoubles(h, &(d->scalz), 1);
+      h = ay_ai_hashbytes(h, d->quat, 4*sizeof(double));
+      n++;
+      d = d->next;
+    }
+  h = ay_ai_hashbytes(h, &n, sizeof(int));
+
+ return h;
+} /* ay_ai_fingerprint */
+
+
+/* ay_ai_countobjects:
+ *  count the objects in the hierarchy <o>
+ */
+unsigned int
+ay_ai_countobjects(ay_object *o)
+{
+ unsigned int n = 0;
+
+  while(o && o->next)
+    {
+      n++;
+      if(o->down)
+	n += ay_ai_countobjects(o->down);
+      o = o->next;
+    }
+
+ return n;
+} /* ay_ai_countobjects */
+
+
+/* ay_ai_indexobjects:
+ *  create the entries of all objects in the hierarchy <o> (in depth
+ *  first order) and remember them in <postorder> in the order in
+ *  which ay_ai_createinstances() visits them (children first)
+ */
+void
+ay_ai_indexobjects(ay_object *o, ay_ai_entry **postorder,
+		   unsigned int *npost)
+{
+ ay_ai_entry *e;
+ Tcl_HashEntry *entry;
+ int new_item = 0;
+
+  while(o && o->next)
+    {
+      e = &(ay_ai_entries[ay_ai_numentries]);
+      ay_ai_numentries++;
+      e->o = o;
+      e->hash = ay_ai_fingerprint(o);
+
+      entry = Tcl_CreateHashEntry(&ay_ai_objectht, (char *)o, &new_item);
+      Tcl_SetHashValue(entry, (ClientData)e);
+
+      if(o->down)
+	ay_ai_indexobjects(o->down, postorder, npost);
+
+      e->last = ay_ai_numentries-1;
+      postorder[*npost] = e;
+      (*npost)++;
+
+      o = o->next;
+    } /* while */
+
+ return;
+} /* ay_ai_indexobjects */
+
+
+/* ay_ai_buildindex:
+ *  calculate the fingerprints of all candidate objects (the objects
+ *  in the hierarchies of <sel> or, if <sel> is NULL, <level>) and
+ *  sort them into lists of objects with the same fingerprint
+ */
+int
+ay_ai_buildindex(ay_object *level, ay_list_object *sel)
+{
+ unsigned int n = 0, npost = 0, i;
+ ay_ai_entry **postorder = NULL, *e;
+ ay_list_object *l;
+ ay_object *next;
+ Tcl_HashEntry *entry;
+ int new_item = 0;
+
+  Tcl_InitHashTable(&ay_ai_objectht, TCL_ONE_WORD_KEYS);
+  Tcl_InitHashTable(&ay_ai_hashht, TCL_ONE_WORD_KEYS);
+
+  if(sel)
+    {
+      l = sel;
+      while(l)
+	{
+	  /* count the object and its children only */
+	  next = l->object->next;
+	  if(next)
+	    n += ay_ai_countobjects(l->object);
+	  l = l->next;
+	}
+    }
+  else
+    {
+      n = ay_ai_countobjects(level);
+    }
+
+  if(!n)
+    return AY_OK;
+
+  if(!(ay_ai_entries = calloc(n, sizeof(ay_ai_entry))))
+    return AY_EOMEM;
+  if(!(postorder = malloc(n*sizeof(ay_ai_entry *))))
+    {
+      free(ay_ai_entries);
+      ay_ai_entries = NULL;
+      return AY_EOMEM;
+    }
+
+  ay_ai_numentries = 0;
+
+  if(sel)
+    {
+      l = sel;
+      while(l)
+	{
+	  /* only index the object and its children,
+	     not its siblings */
+	  if(l->object->next)
+	    {
+	      next = l->object->next;
+	      l->object->next = ay_endlevel;
+	      ay_ai_indexobjects(l->object, postorder, &npost);
+	      l->object->next = next;
+	    }
+	  l = l->next;
+	}
+    }
+  else
+    {
+      ay_ai_indexobjects(level, postorder, &npost);
+    }
+
+  /* sort into lists (that keep the order of postorder) */
+  for(i = npost; i > 0; i--)
+    {
+      e = postorder[i-1];
+      entry = Tcl_CreateHashEntry(&ay_ai_hashht, (char *)(size_t)e->hash,
+				  &new_item);
+      if(new_item)
+	e->next = NULL;
+      else
+	e->next = (ay_ai_entry *)Tcl_GetHashValue(entry);
+      Tcl_SetHashValue(entry, (ClientData)e);
+    }
+
+  free(postorder);
+
+ return AY_OK;
+} /* ay_ai_buildindex */
+
+
+/* ay_ai_freeindex:
+ *  free the index created by ay_ai_buildindex()
+ */
+void
+ay_ai_freeindex(void)
+{
+
+  Tcl_DeleteHashTable(&ay_ai_objectht);
+  Tcl_DeleteHashTable(&ay_ai_hashht);
+
+  if(ay_ai_entries)
+    free(ay_ai_entries);
+  ay_ai_entries = NULL;
+  ay_ai_numentries = 0;
+
+ return;
+} /* ay_ai_freeindex */
+
+
 /* ay_ai_instanceobject:
  *  free all object specific memory and create instance
  */
@@ -185,32 +555,36 @@ ay_ai_instanceobject(ay_object *inst, ay_object *ref)
 
 
 /* ay_ai_createinstances:
- *  find matching objects and create instances
- *  for now check all objects in tree each time
+ *  find matching objects and create instances;
+ *  only the objects with the same fingerprint as <ref>
+ *  (see ay_ai_buildindex()) are checked
  */
 int
-ay_ai_createinstances(ay_object *ref, ay_object *o)
+ay_ai_createinstances(ay_object *ref)
 {
  int ay_status, ret = 0;
- ay_object *d = NULL;
+ unsigned int i;
+ ay_ai_entry *r, *e;
+ Tcl_HashEntry *entry;
+ ay_object *o;
 
-  /* do not create instance of reference object itself */
-  if(o != ref)
-    {
+  if(!(entry = Tcl_FindHashEntry(&ay_ai_objectht, (char *)ref)))
+    return 0;
+  r = (ay_ai_entry *)Tcl_GetHashValue(entry);
 
-      /* process children first */
-      if(o->down && o->down->next)
-	{
-	  d = o->down;
-	  while(d->next)
-	    {
-	      ret += ay_ai_createinstances(ref, d);
-	      d = d->next;
-	    }
-	}
+  if(!(entry = Tcl_FindHashEntry(&ay_ai_hashht, (char *)(size_t)r->hash)))
+    return 0;
+  e = (ay_ai_entry *)Tcl_GetHashValue(entry);
+
+  while(e)
+    {
+      o = e->o;
 
-      /* easy/fast checks first */
-      if((ref->type == o->type) && (o->refcount == 0))
+      /* do not create instance of reference object itself
+	 or of objects below it */
+      if(o && (e != r) &&
+	 !((e > r) && ((unsigned int)(e - ay_ai_entries) <= r->last)) &&
+	 (ref->type == o->type) && (o->refcount == 0))
 	{
 	  /* could become an instance, check it out */
 	  if((ay_comp_objects(ref, o)) &&
@@ -224,11 +598,15 @@ ay_ai_createinstances(ay_object *ref, ay_object *o)
 	      if(ay_status)
 		return ret;
 	      ret++;
-	    } /* if */
 
+	      /* the children of the new instance are gone */
+	      for(i = (unsigned int)(e - ay_ai_entries)+1; i <= e->last; i++)
+		ay_ai_entries[i].o = NULL;
+	    } /* if */
 	} /* if */
 
-    } /* if */
+      e = e->next;
+    } /* while */
 
  return ret;
 } /* ay_ai_createinstances */
@@ -236,9 +614,10 @@ ay_ai_createinstances(ay_object *ref, ay_object *o)
 
 /* ay_ai_makeinstances:
  * find identical objects and create instances
+ * (the candidates must have been indexed with ay_ai_buildindex())
  */
 int
-ay_ai_makeinstances(ay_object *o, ay_object *level, ay_list_object *sel)
+ay_ai_makeinstances(ay_object *o)
 {
  int ret = 0;
  ay_object *d = NULL;
@@ -251,7 +630,7 @@ ay_ai_makeinstances(ay_object *o, ay_object *level, ay_list_object *sel)
 	{
 	  if(d->type != AY_IDNPATCH)
 	    {
-	      ret += ay_ai_makeinstances(d, level, sel);
+	      ret += ay_ai_makeinstances(d);
 	    }
 	  d = d->next;
 	}
@@ -260,29 +639,7 @@ ay_ai_makeinstances(ay_object *o, ay_object *level, ay_list_object *sel)
   /* now create instances of "o", if "o" isnt an instance itself */
   if(ay_ai_instanceabletype(o->type))
     {
-      /* avoid working on the root */
-      if(sel && (sel->object == ay_root))
-	{
-	  sel = sel->next;
-	}
-
-      if(sel)
-	{
-	  while(sel)
-	    {
-	      ret += ay_ai_createinstances(o, sel->object);
-	      sel = sel->next;
-	    }
-	}
-      else
-	{
-	  d = level;
-	  while(d->next)
-	    {
-	      ret += ay_ai_createinstances(o, d);
-	      d = d->next;
-	    }
-	} /* if */
+      ret += ay_ai_createinstances(o);
     } /* if */
 
  return ret;
@@ -388,6 +745,10 @@ ay_ai_tcmd(ClientData clientData, Tcl_Interp *interp,
       break;
     }
 
+  /* load all lazily read data first, instances may reference
+     masters outside of the scope */
+  ay_bin_loadall(ay_root);
+
   if(cursel)
     {
       do
@@ -436,13 +797,21 @@ ay_ai_tcmd(ClientData clientData, Tcl_Interp *interp,
   comp_false = 0;
   */
 
+  /* fingerprint all candidates in one pass, so that each object
+     is only compared to the objects with the same fingerprint */
+  if(ay_ai_buildindex(level, cursel))
+    {
+      ay_ai_freeindex();
+      ay_error(AY_EOMEM, fname, NULL);
+      goto cleanup;
+    }
+
   if(cursel)
     {
       sel = cursel;
       while(sel)
 	{
-	  numinst += ay_ai_makeinstances(sel->object, ay_currentlevel->object,
-					 cursel);
+	  numinst += ay_ai_makeinstances(sel->object);
 	  sel = sel->next;
 	}
     }
@@ -451,11 +820,13 @@ ay_ai_tcmd(ClientData clientData, Tcl_Interp *interp,
       o = level;
       while(o)
 	{
-	  numinst += ay_ai_makeinstances(o, level, NULL);
+	  numinst += ay_ai_makeinstances(o);
 	  o = o->next;
 	}
     } /* if */
 
+  ay_ai_freeindex();
+
   sprintf(str, "%d instances created", numinst);
 
   ay_error(AY_EOUTPUT, fname, str);
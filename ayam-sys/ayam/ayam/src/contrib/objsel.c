@@ -14,277 +14,1186 @@
 
 /* objsel.c - select objects on a viewport */
 
+/* Objects are picked on the CPU: the scene hierarchy is traversed with
+ * the cached bounding boxes of the objects and their children (see
+ * ay_bbc_getcull()) serving as bounding volume hierarchy; the own
+ * geometry of objects whose boxes touch the pick region is then clipped
+ * against the pick region exactly (in clip space, like OpenGL would do
+ * in selection mode), which also delivers the depth of each hit;
+ * objects without a CPU representation of their geometry are collected
+ * and picked afterwards in a single (small) OpenGL selection pass
+ */
+
+/* types local to this module: */
+
+/** a picked object */
+typedef struct ay_objsel_hit_s {
+  ay_object *o; /* picked object */
+  char *node; /* node name of picked object (e.g. "root:1:0") */
+  double depth; /* depth of hit (0.0 - 1.0) */
+  unsigned int seq; /* order of traversal */
+} ay_objsel_hit;
+
+/** an object to be picked using OpenGL */
+typedef struct ay_objsel_cand_s {
+  ay_object *o; /* object */
+  char *node; /* node name of object */
+  double m[16]; /* modelling transformation of object */
+  unsigned int seq; /* order of traversal */
+} ay_objsel_cand;
+
+/** picking state */
+typedef struct ay_objsel_pick_s {
+  int shade; /* pick shaded or drawn representation? */
+  double pm[16]; /* projection (including pick region) */
+  Tcl_DString node; /* node name of current object */
+  ay_objsel_hit *hits; /* picked objects [hitslen] */
+  unsigned int hitslen, hitsalloc;
+  ay_objsel_cand *cands; /* objects to pick using OpenGL [candslen] */
+  unsigned int candslen, candsalloc;
+  unsigned int seq; /* traversal counter */
+} ay_objsel_pick;
+
 
 /* prototypes of functions local to this module: */
 
-void ay_objsel_pushzeros(ay_list_object *lo);
+int ay_objsel_clip(double *v, int n, double *depth);
+
+int ay_objsel_hitprim(double *mvp, double *p1, double *p2, double *p3,
+		      double *depth);
+
+int ay_objsel_hitbox(double *mvp, double *bb);
+
+int ay_objsel_hitpomesh(ay_objsel_pick *pick, double *mvp, ay_object *o,
+			double *depth);
+
+int ay_objsel_hitncurve(ay_objsel_pick *pick, double *mvp, ay_object *o,
+			double *depth);
+
+int ay_objsel_hitlines(double *mvp, ay_stess_lines *lines, double *depth);
+
+int ay_objsel_hitnpatch(ay_objsel_pick *pick, double *mvp, ay_object *o,
+			double *m, double *depth);
+
+int ay_objsel_hitgeom(ay_objsel_pick *pick, ay_object *o, double *m,
+		      double *depth);
+
+int ay_objsel_hittree(ay_objsel_pick *pick, ay_object *o, double *pm,
+		      double *depth);
+
+int ay_objsel_addhit(ay_objsel_pick *pick, ay_object *o, double depth,
+		     double *m);
+
+void ay_objsel_pickobject(ay_objsel_pick *pick, ay_object *o, double *pm,
+			  int index);
+
+void ay_objsel_levelnode(ay_list_object *lo, Tcl_DString *ds);
 
-void ay_objsel_pushlnames(ay_list_object *lo);
+int ay_objsel_glpick(struct Togl *togl, ay_objsel_pick *pick);
 
-void ay_objsel_poplnames(ay_list_object *lo);
+int ay_objsel_cmphits(const void *a, const void *b);
 
-void ay_objsel_process_hits(GLint hits, GLuint buffer[], char *var);
+void ay_objsel_clearpick(ay_objsel_pick *pick);
 
 void ay_objsel_drawobjects(struct Togl *togl, int n, ay_object **o);
 
 void ay_objsel_flashobjects(struct Togl *togl, int n, ay_object **o);
 
-void ay_objsel_draw_hits(GLint hits, GLuint buffer[], struct Togl *togl);
-
 
 /* functions: */
 
-/* ay_objsel_pushzeros:
- *  Recursively set all glnames of objects from the current level
- *  on upwards to the ay_root to zero. This is needed when views in
- *  draw-level-only mode are used for picking.
- *  If we do not set it to zero, ay_objsel_process_hits() may select
- *  old selections again (because the glnames were never reset).
+/* ay_objsel_pickmatrix:
+ *  calculate the projection matrix <pm> of view <togl> restricted to
+ *  the pick region (window coordinates <x>, <y>, <boxw>, <boxh>);
+ *  this is the CPU equivalent of gluPickMatrix(), glFrustum()/glOrtho(),
+ *  and gluLookAt() as used for picking
  */
 void
-ay_objsel_pushzeros(ay_list_object *lo)
+ay_objsel_pickmatrix(struct Togl *togl, double x, double y,
+		     double boxw, double boxh, double *pm)
 {
- ay_object *o = NULL;
+ ay_view_object *view = (ay_view_object *)Togl_GetClientData(togl);
+ int width = Togl_Width(togl);
+ int height = Togl_Height(togl);
+ double aspect = ((double) width) / ((double) height);
+ double l, r, b, t, n, f, m[16] = {0}, fw[3], s[3], u[3], len;
 
-  if(!lo)
-    return;
+  ay_trafo_identitymatrix(pm);
+
+  if(boxw < 1.0)
+    boxw = 1.0;
+  if(boxh < 1.0)
+    boxh = 1.0;
+
+  /* pick region */
+  ay_trafo_translatematrix((width - 2.0*x)/boxw,
+			   (height - 2.0*(height - y))/boxh, 0.0, pm);
+  ay_trafo_scalematrix(width/boxw, height/boxh, 1.0, pm);
+
+  l = -aspect * view->zoom;
+  r = aspect * view->zoom;
+  b = -1.0 * view->zoom;
+  t = 1.0 * view->zoom;
+
+  if(view->type == AY_VTPERSP)
+    {
+      n = 1.0;
+      f = 1000.0;
+      m[0] = 2.0*n/(r-l);
+      m[5] = 2.0*n/(t-b);
+      m[8] = (r+l)/(r-l);
+      m[9] = (t+b)/(t-b);
+      m[10] = -(f+n)/(f-n);
+      m[11] = -1.0;
+      m[14] = -2.0*f*n/(f-n);
+    }
+  else
+    {
+      n = -100.0;
+      f = 100.0;
+      m[0] = 2.0/(r-l);
+      m[5] = 2.0/(t-b);
+      m[10] = -2.0/(f-n);
+      m[12] = -(r+l)/(r-l);
+      m[13] = -(t+b)/(t-b);
+      m[14] = -(f+n)/(f-n);
+      m[15] = 1.0;
+    }
+  ay_trafo_multmatrix(pm, m);
+
+  if(view->roll != 0.0)
+    ay_trafo_rotatematrix(view->roll, 0.0, 0.0, 1.0, pm);
+
+  /* look at */
+  fw[0] = view->to[0] - view->from[0];
+  fw[1] = view->to[1] - view->from[1];
+  fw[2] = view->to[2] - view->from[2];
+  len = AY_V3LEN(fw);
+  if(len > AY_EPSILON)
+    AY_V3SCAL(fw, 1.0/len);
+
+  AY_V3CROSS(s, fw, view->up);
+  len = AY_V3LEN(s);
+  if(len > AY_EPSILON)
+    AY_V3SCAL(s, 1.0/len);
+
+  AY_V3CROSS(u, s, fw);
 
-  if(lo->next)
+  ay_trafo_identitymatrix(m);
+  m[0] = s[0]; m[4] = s[1]; m[8] = s[2];
+  m[1] = u[0]; m[5] = u[1]; m[9] = u[2];
+  m[2] = -fw[0]; m[6] = -fw[1]; m[10] = -fw[2];
+  ay_trafo_multmatrix(pm, m);
+
+  ay_trafo_translatematrix(-view->from[0], -view->from[1], -view->from[2],
+			   pm);
+
+ return;
+} /* ay_objsel_pickmatrix */
+
+
+/* ay_objsel_clip:
+ *  clip the polygon (or line, if <n> is 2) <v> of <n> vertices
+ *  in homogeneous clip coordinates against the pick volume
+ *  (-w <= x,y,z <= w);
+ *  returns AY_TRUE if anything remains and the minimum depth of
+ *  the remainder in <depth>
+ */
+int
+ay_objsel_clip(double *v, int n, double *depth)
+{
+ double buf1[16*4], buf2[16*4], *in = v, *out = buf1, *a, *b, da, db, t;
+ int i, j, k, m, plane, axis;
+ double sign;
+
+  for(plane = 0; plane < 6; plane++)
     {
-      o = lo->next->object;
-      if(o == ay_root)
+      axis = plane/2;
+      sign = (plane%2)?-1.0:1.0;
+      m = 0;
+      for(i = 0; i < n; i++)
 	{
-	  o = o->next;
+	  /* for lines, do not close the polygon */
+	  if(n == 2 && i == 1)
+	    {
+	      a = &(in[4]);
+	      if(a[3] + sign*a[axis] >= 0.0)
+		{
+		  memcpy(&(out[m*4]), a, 4*sizeof(double));
+		  m++;
+		}
+	      break;
+	    }
+	  a = &(in[i*4]);
+	  b = &(in[((i+1)%n)*4]);
+	  da = a[3] + sign*a[axis];
+	  db = b[3] + sign*b[axis];
+	  if(da >= 0.0)
+	    {
+	      memcpy(&(out[m*4]), a, 4*sizeof(double));
+	      m++;
+	    }
+	  if((da >= 0.0) != (db >= 0.0))
+	    {
+	      t = da/(da - db);
+	      for(k = 0; k < 4; k++)
+		out[m*4+k] = a[k] + t*(b[k] - a[k]);
+	      m++;
+	    }
+	} /* for */
+
+      if(m == 0)
+	return AY_FALSE;
+
+      /* a line that got clipped at both ends may have three vertices
+	 now (start, intersection, end), keep it a line */
+      if(n == 2 && m > 2)
+	{
+	  memcpy(&(out[4]), &(out[(m-1)*4]), 4*sizeof(double));
+	  m = 2;
 	}
-      while(o)
+      if(n == 2 && m == 1)
 	{
-	  o->glname = 0;
-	  o = o->next;
+	  memcpy(&(out[4]), out, 4*sizeof(double));
+	  m = 2;
 	}
-    } /* if */
 
-  if(lo->next)
+      n = m;
+      in = out;
+      out = (out == buf1)?buf2:buf1;
+    } /* for */
+
+  *depth = DBL_MAX;
+  for(j = 0; j < n; j++)
     {
-      ay_objsel_pushzeros(lo->next->next);
+      t = (in[j*4+2]/in[j*4+3] + 1.0)*0.5;
+      if(t < *depth)
+	*depth = t;
     }
 
-  return;
-} /* ay_objsel_pushzeros */
+ return AY_TRUE;
+} /* ay_objsel_clip */
 
 
-/* ay_objsel_pushlnames:
- *  Recursively set all glnames of objects from ay_root on downwards
- *  to the current level. This is needed when views in draw-level-only
- *  mode are used for picking.
- *  This, effectively, lays a "trail of breadcrumbs" for the function
- *  ay_objsel_process_hits() from the ay_root to the current level.
+/* ay_objsel_hitprim:
+ *  check whether the line <p1>-<p2> (if <p3> is NULL) or the
+ *  triangle <p1>-<p2>-<p3> (transformed by <mvp>) touches the
+ *  pick volume, updating the minimum <depth>
  */
-void
-ay_objsel_pushlnames(ay_list_object *lo)
+int
+ay_objsel_hitprim(double *mvp, double *p1, double *p2, double *p3,
+		  double *depth)
 {
- ay_object *o = NULL;
+ double v[3*4], *p[3], d;
+ int i, n = p3?3:2;
 
-  if(!lo)
-    return;
+  p[0] = p1;
+  p[1] = p2;
+  p[2] = p3;
 
-  if(lo->next)
-    ay_objsel_pushlnames(lo->next->next);
+  for(i = 0; i < n; i++)
+    {
+      v[i*4]   = mvp[0]*p[i][0] + mvp[4]*p[i][1] + mvp[8]*p[i][2] + mvp[12];
+      v[i*4+1] = mvp[1]*p[i][0] + mvp[5]*p[i][1] + mvp[9]*p[i][2] + mvp[13];
+      v[i*4+2] = mvp[2]*p[i][0] + mvp[6]*p[i][1] + mvp[10]*p[i][2] + mvp[14];
+      v[i*4+3] = mvp[3]*p[i][0] + mvp[7]*p[i][1] + mvp[11]*p[i][2] + mvp[15];
+    }
 
-  if(lo->object)
+  if(ay_objsel_clip(v, n, &d))
     {
-      o = lo->object;
-      o->glname = ++ay_glname;
-      glPushName(o->glname);
+      if(d < *depth)
+	*depth = d;
+      return AY_TRUE;
     }
 
- return;
-} /* ay_objsel_pushlnames */
+ return AY_FALSE;
+} /* ay_objsel_hitprim */
 
 
-/* ay_objsel_poplnames:
- *  remove all names pushed onto the stack by
- *  ay_objsel_pushlnames() above
+/* ay_objsel_hitbox:
+ *  check whether the bounding box <bb> (xmin, xmax, ymin, ymax, zmin,
+ *  zmax, transformed by <mvp>) may touch the pick volume
  */
-void
-ay_objsel_poplnames(ay_list_object *lo)
+int
+ay_objsel_hitbox(double *mvp, double *bb)
 {
+ double c[4], x, y, z;
+ int i, j, out[6] = {0};
 
-  if(!lo)
-    return;
+  for(i = 0; i < 8; i++)
+    {
+      x = bb[(i&1)?1:0];
+      y = bb[(i&2)?3:2];
+      z = bb[(i&4)?5:4];
+      for(j = 0; j < 4; j++)
+	c[j] = mvp[j]*x + mvp[4+j]*y + mvp[8+j]*z + mvp[12+j];
+
+      if(c[0] < -c[3])
+	out[0]++;
+      if(c[0] > c[3])
+	out[1]++;
+      if(c[1] < -c[3])
+	out[2]++;
+      if(c[1] > c[3])
+	out[3]++;
+      if(c[2] < -c[3])
+	out[4]++;
+      if(c[2] > c[3])
+	out[5]++;
+    } /* for */
 
-  if(lo->next)
-    ay_objsel_poplnames(lo->next->next);
+  for(i = 0; i < 6; i++)
+    if(out[i] == 8)
+      return AY_FALSE;
 
-  if(lo->object)
+ return AY_TRUE;
+} /* ay_objsel_hitbox */
+
+
+/* ay_objsel_hitpomesh:
+ *  pick the PolyMesh <o>: the polygon outlines (as drawn) or the cached
+ *  shading triangles (as shaded)
+ *  returns AY_TRUE if picked, AY_FALSE if not, and AY_ERROR if the
+ *  shading triangles are not available
+ */
+int
+ay_objsel_hitpomesh(ay_objsel_pick *pick, double *mvp, ay_object *o,
+		    double *depth)
+{
+ ay_pomesh_object *pomesh = (ay_pomesh_object *)o->refine;
+ ay_vbuf *vb;
+ unsigned int i, j, k, l = 0, m = 0, n = 0, first;
+ int stride, hit = AY_FALSE;
+
+  if(!pomesh)
+    return AY_FALSE;
+
+  if(pick->shade)
     {
-      glPopName();
+      vb = pomesh->vb;
+      if(!vb || !vb->valid || !vb->v)
+	return AY_ERROR;
+
+      for(i = 0; i < vb->nidx; i += 3)
+	{
+	  if(ay_objsel_hitprim(mvp, &(vb->v[vb->idx[i]*6]),
+			       &(vb->v[vb->idx[i+1]*6]),
+			       &(vb->v[vb->idx[i+2]*6]), depth))
+	    hit = AY_TRUE;
+	}
+
+      return hit;
     }
 
- return;
-} /* ay_objsel_poplnames */
+  stride = pomesh->has_normals?6:3;
+
+  for(i = 0; i < pomesh->npolys; i++)
+    {
+      for(j = 0; j < pomesh->nloops[l]; j++)
+	{
+	  first = n;
+	  for(k = 0; k < pomesh->nverts[m]; k++)
+	    {
+	      if(ay_objsel_hitprim(mvp,
+		  &(pomesh->controlv[pomesh->verts[n]*stride]),
+		  &(pomesh->controlv[pomesh->verts[(k+1 < pomesh->nverts[m])?
+						   n+1:first]*stride]),
+				   NULL, depth))
+		hit = AY_TRUE;
+	      n++;
+	    }
+	  m++;
+	} /* for */
+      l++;
+    } /* for */
+
+ return hit;
+} /* ay_objsel_hitpomesh */
 
 
-/* ay_objsel_process_hits: process data returned by the selection mode of
- * OpenGL in order to find which objects have been selected
+/* ay_objsel_hitstrip:
+ *  pick the line strip of <n> points in <v> (<stride> doubles apart);
+ *  if <rat> is AY_TRUE, the points are rational (euclidean coordinates
+ *  and weight) and picked in homogeneous coordinates (as drawn with
+ *  rationalpoints enabled)
  */
-void
-ay_objsel_process_hits(GLint hits, GLuint buffer[], char *var)
+int
+ay_objsel_hitstrip(double *mvp, double *v, int n, int stride, int rat,
+		   double *depth)
 {
-  char fname[] = "objsel_process_hits";
-  char *node = NULL, *nodetmp, *tmp = NULL, *tmptmp;
-  int i = 0;
-  unsigned int size = 0;
-  GLint *ptr = NULL;
+ double p1[3], p2[3];
+ int i, j, hit = AY_FALSE;
+
+  if(n < 2)
+    return AY_FALSE;
 
-  ptr = (GLint *) buffer;
+  for(j = 0; j < 3; j++)
+    p2[j] = rat?v[j]*v[3]:v[j];
 
-  /* Allocate memory to store temporary datas */
-  tmp = (char*) malloc(256 * sizeof(char));
-  if(!tmp)
+  for(i = 1; i < n; i++)
     {
-      ay_error(AY_EOMEM, fname, NULL);
-      return;
+      memcpy(p1, p2, 3*sizeof(double));
+      v += stride;
+      for(j = 0; j < 3; j++)
+	p2[j] = rat?v[j]*v[3]:v[j];
+
+      if(ay_objsel_hitprim(mvp, p1, p2, NULL, depth))
+	hit = AY_TRUE;
     }
 
-  /* Allocate memory to store the node address */
-  node = (char*) malloc(256 * sizeof(char));
-  if(!node)
+ return hit;
+} /* ay_objsel_hitstrip */
+
+
+/* ay_objsel_hitncurve:
+ *  pick the NURBS curve <o>: the control hull and/or the stess
+ *  tesselation of the curve (which is also used for the GLU display
+ *  modes), mimicking ay_ncurve_drawcb();
+ *  curves are not shaded, thus can not be picked in shaded views
+ */
+int
+ay_objsel_hitncurve(ay_objsel_pick *pick, double *mvp, ay_object *o,
+		    double *depth)
+{
+ ay_nurbcurve_object *ncurve = (ay_nurbcurve_object *)o->refine;
+ ay_stess_curve *stc;
+ int display_mode = ay_prefs.nc_display_mode, qf = ay_prefs.stess_qf;
+ int hit = AY_FALSE;
+
+  if(!ncurve || pick->shade)
+    return AY_FALSE;
+
+  if(ncurve->display_mode != 0)
+    display_mode = ncurve->display_mode-1;
+
+  /* control hull */
+  if(display_mode == 0 || display_mode == 1 || display_mode == 3)
     {
-      free(tmp);
-      ay_error(AY_EOMEM, fname, NULL);
-      return;
+      if(ay_objsel_hitstrip(mvp, ncurve->controlv, ncurve->length, 4,
+			    ncurve->is_rat && ay_prefs.rationalpoints,
+			    depth))
+	hit = AY_TRUE;
     }
-  size = 256;
-  node[0] = 0;
 
-  for(i = 0; i < hits; i++)
+  if(display_mode == 0)
+    return hit;
+
+  /* curve */
+  if(ncurve->order == 2)
     {
-      ay_object *o = NULL;
-      GLuint object_name = 0;
-      int n = 0;
-      unsigned int j = 0;
-      GLuint namecnt = *ptr;
+      if(ay_objsel_hitstrip(mvp, ncurve->controlv, ncurve->length, 4,
+			    AY_FALSE, depth))
+	hit = AY_TRUE;
+      return hit;
+    }
+
+  if(ncurve->glu_sampling_tolerance > 0.0)
+    qf = ay_stess_GetQF(ncurve->glu_sampling_tolerance);
+
+  /* use (and fill) the same cache as ay_ncurve_drawstess() */
+  stc = &(ncurve->stess[0]);
+  if(stc->tessqf != qf && stc->tessv)
+    {
+      free(stc->tessv);
+      stc->tessv = NULL;
+      stc->tesslen = 0;
+    }
+
+  if(!stc->tessv)
+    {
+      if(ay_stess_CurvePoints3D(ncurve->length, ncurve->order-1,
+				ncurve->knotv, ncurve->controlv,
+				ncurve->is_rat, qf,
+				&stc->tesslen, &stc->tessv))
+	return AY_ERROR;
+      stc->tessqf = qf;
+    }
+
+  if(ay_objsel_hitstrip(mvp, stc->tessv, stc->tesslen, 3, AY_FALSE, depth))
+    hit = AY_TRUE;
 
-      ptr += 3;
+ return hit;
+} /* ay_objsel_hitncurve */
 
-      /*
-      float z1 = 0.0f, z2 = 0.0f;
-      z1 =(float) *(ptr++) / 0x7fffffff;
-      z2 =(float) *(ptr++) / 0x7fffffff;
-      printf("%f %f\n", z1, z2);
-      */
-      o = ay_root;
-      strncat(node, "root", (size_t)size);
 
-      for(j = 0; j < namecnt; j++)
+/* ay_objsel_hitlines:
+ *  pick the tesselated lines of a trimmed NURBS patch <lines>,
+ *  mimicking ay_stess_DrawLines()
+ */
+int
+ay_objsel_hitlines(double *mvp, ay_stess_lines *lines, double *depth)
+{
+ int i, k, s, e, in, hit = AY_FALSE;
+
+  for(i = 0; i < lines->numlines; i++)
+    {
+      s = lines->starts[i];
+      e = lines->starts[i+1];
+      in = AY_FALSE;
+      for(k = s; k < e; k++)
 	{
-	  n = 0;
-	  object_name = *(ptr++);
+	  if(in && k > s)
+	    {
+	      if(ay_objsel_hitprim(mvp, &(lines->C[(k-1)*6]),
+				   &(lines->C[k*6]), NULL, depth))
+		hit = AY_TRUE;
+	    }
+	  /* trim loop points start and end the drawn line strips */
+	  if(lines->types[k] > 0)
+	    in = !in;
+	} /* for */
+    } /* for */
 
-	  /* Skip the root object from the list */
-	  if(object_name == ay_root->glname) {
-	    ptr += namecnt - j - 1;
-	    break;
-	  }
+ return hit;
+} /* ay_objsel_hitlines */
 
-	  if(object_name)
+
+/* ay_objsel_hitnpatch:
+ *  pick the NURBS patch <o> (with transformation <m>) and its caps
+ *  and bevels: the control hull or the stess tesselation (which is
+ *  also used for the GLU display modes), as drawn (grid lines) or as
+ *  shaded (triangles), mimicking ay_npatch_drawcb()/ay_npatch_shadecb();
+ *  returns AY_ERROR if the required tesselation is not available
+ */
+int
+ay_objsel_hitnpatch(ay_objsel_pick *pick, double *mvp, ay_object *o,
+		    double *m, double *depth)
+{
+ ay_nurbpatch_object *npatch = (ay_nurbpatch_object *)o->refine;
+ ay_stess_patch *stess;
+ ay_vbuf *vb;
+ ay_object *b;
+ double *v;
+ unsigned int k;
+ int i, tessw, tessh, status, hit = AY_FALSE;
+ int display_mode = ay_prefs.np_display_mode, qf = ay_prefs.stess_qf;
+
+  if(!npatch)
+    return AY_FALSE;
+
+  if(npatch->display_mode != 0)
+    display_mode = npatch->display_mode-1;
+
+  stess = &(npatch->stess[0]);
+
+  if(display_mode == 0)
+    {
+      /* control hull */
+      if(pick->shade)
+	{
+	  /* the triangles of the control hull are cached by
+	     ay_npatch_shadech() */
+	  vb = &(stess->vb);
+	  if(stess->tessw != -1 || !vb->valid || !vb->v ||
+	     vb->mode != ay_prefs.rationalpoints)
+	    return AY_ERROR;
+
+	  for(k = 0; k < vb->nidx; k += 3)
 	    {
-	      while(o->next)
-		{
-		  if(o->glname == object_name)
-		    break;
+	      if(ay_objsel_hitprim(mvp, &(vb->v[vb->idx[k]*6]),
+				   &(vb->v[vb->idx[k+1]*6]),
+				   &(vb->v[vb->idx[k+2]*6]), depth))
+		hit = AY_TRUE;
+	    }
+	}
+      else
+	{
+	  v = npatch->controlv;
+	  for(i = 0; i < npatch->width; i++)
+	    {
+	      if(ay_objsel_hitstrip(mvp, &(v[i*npatch->height*4]),
+				    npatch->height, 4,
+				npatch->is_rat && ay_prefs.rationalpoints,
+				    depth))
+		hit = AY_TRUE;
+	    }
+	  for(i = 0; i < npatch->height; i++)
+	    {
+	      if(ay_objsel_hitstrip(mvp, &(v[i*4]), npatch->width,
+				    npatch->height*4,
+				npatch->is_rat && ay_prefs.rationalpoints,
+				    depth))
+		hit = AY_TRUE;
+	    }
+	} /* if */
+    }
+  else
+    {
+      /* stess tesselation, use (and fill) the same cache as
+	 ay_npatch_drawstess()/ay_npatch_shadestess() */
+      if(npatch->glu_sampling_tolerance != 0.0)
+	qf = ay_stess_GetQF(npatch->glu_sampling_tolerance);
 
-		  o = o->next;
-		  n++;
-		}
+      if(stess->qf != qf)
+	ay_stess_destroy(stess);
 
-	      /* If we have reached the end of the current level
-	       * (i.e. o->next == NULL) then we must verify that the object
-	       * is the one we are looking for else we leave...
-	       */
-	      if(o->glname != object_name)
-	        {
-		  o = NULL;
-		  node[0] = 0;
-		  break;
-		}
+      if(stess->qf != qf || stess->tessw == -1)
+	{
+	  if(ay_stess_TessNP(o, qf, stess))
+	    return AY_ERROR;
+	}
 
-	      /* Goes down one level */
-	      if((j != namecnt - 1) && (o->down) && (o->down->next))
+      if(pick->shade)
+	{
+	  if(stess->tessv)
+	    {
+	      /* untrimmed, pick the grid cells directly */
+	      tessw = stess->tessw;
+	      tessh = stess->tessh;
+	      v = stess->tessv;
+	      for(i = 0; i < (tessw-1)*tessh; i++)
 		{
-		  o = o->down;
+		  if((i+1) % tessh)
+		    {
+		      if(ay_objsel_hitprim(mvp, &(v[i*6]),
+					   &(v[(i+tessh)*6]),
+					   &(v[(i+tessh+1)*6]), depth))
+			hit = AY_TRUE;
+		      if(ay_objsel_hitprim(mvp, &(v[i*6]),
+					   &(v[(i+tessh+1)*6]),
+					   &(v[(i+1)*6]), depth))
+			hit = AY_TRUE;
+		    }
 		}
-
-	      /* Stores the level number */
-	      sprintf(tmp, ":%d", n);
-
-	      /* Allocate more memory to node if needed */
-	      if((strlen(node) + strlen(tmp) + 10) > size)
+	    }
+	  else
+	    {
+	      /* trimmed, pick the triangles cached for shading */
+	      if(!stess->vb.valid)
 		{
-		  size += 256;
-		  nodetmp = (char*) realloc(node,
-					    (size_t)(size * sizeof(char)));
-		  if(!nodetmp)
+		  if(ay_stess_TrimmedSurfaceVB(stess))
 		    {
-		      if(node)
-			free(node);
-		      if(tmp)
-			free(tmp);
-		      ay_error(AY_EOMEM, fname, NULL);
-		      return;
+		      ay_shade_vbuffree(&(stess->vb));
+		      ay_shade_vbuffree(&(stess->vpsvb));
+		      return AY_ERROR;
 		    }
-		  node = nodetmp;
+		  stess->vb.valid = AY_TRUE;
 		}
 
-	      /* Adds the level number to the node */
-	      strncat(node, tmp, (size_t)size);
+	      vb = &(stess->vb);
+	      v = stess->pomesh?vb->v:stess->ups.C;
+	      for(i = 0; i < 2; i++)
+		{
+		  if(v)
+		    {
+		      for(k = 0; k < vb->nidx; k += 3)
+			{
+			  if(ay_objsel_hitprim(mvp, &(v[vb->idx[k]*6]),
+					       &(v[vb->idx[k+1]*6]),
+					       &(v[vb->idx[k+2]*6]), depth))
+			    hit = AY_TRUE;
+			}
+		    }
+		  if(stess->pomesh)
+		    break;
+		  vb = &(stess->vpsvb);
+		  v = stess->vps.C;
+		} /* for */
 	    } /* if */
-	} /* for */
+	}
+      else
+	{
+	  if(stess->tessv)
+	    {
+	      tessw = stess->tessw;
+	      tessh = stess->tessh;
+	      for(i = 0; i < tessw; i++)
+		{
+		  if(ay_objsel_hitstrip(mvp, &(stess->tessv[i*tessh*6]),
+					tessh, 6, AY_FALSE, depth))
+		    hit = AY_TRUE;
+		}
+	      for(i = 0; i < tessh; i++)
+		{
+		  if(ay_objsel_hitstrip(mvp, &(stess->tessv[i*6]), tessw,
+					tessh*6, AY_FALSE, depth))
+		    hit = AY_TRUE;
+		}
+	    }
+	  else
+	    {
+	      if(ay_objsel_hitlines(mvp, &(stess->ups), depth))
+		hit = AY_TRUE;
+	      if(ay_objsel_hitlines(mvp, &(stess->vps), depth))
+		hit = AY_TRUE;
+	      v = stess->tcspnts;
+	      for(i = 0; i < stess->tcslen; i++)
+		{
+		  if(ay_objsel_hitstrip(mvp, v, stess->tcslens[i], 3,
+					AY_FALSE, depth))
+		    hit = AY_TRUE;
+		  v += stess->tcslens[i]*3;
+		}
+	    } /* if */
+	} /* if */
+    } /* if */
 
-      strncat(node, " ", (size_t)size);
+  /* caps and bevels */
+  b = npatch->caps_and_bevels;
+  while(b)
+    {
+      status = ay_objsel_hittree(pick, b, m, depth);
+      if(status == AY_ERROR)
+	return AY_ERROR;
+      if(status)
+	hit = AY_TRUE;
+      b = b->next;
+    }
 
-      /* If OpenGL found that the grid or the coordinate system are in the
-       * selection then a stand-alone "root " (i.e. an empty node) is generated
-       * because the grid and the coord. system are not AYAM objects. When this
-       * happens we have to remove this extra "root ".
-       */
-      if(strlen(node) >= 5)
-        {
-          if(!strncmp (&node[strlen(node) - 5], "root ", 5))
-	    node[strlen(node) - 5] = 0;
+ return hit;
+} /* ay_objsel_hitnpatch */
+
+
+/* ay_objsel_hitgeom:
+ *  pick the own geometry of object <o> (with transformation <m>)
+ *  returns AY_TRUE if picked (depth of hit in <depth>), AY_FALSE if not,
+ *  and AY_ERROR if the object has to be picked using OpenGL
+ */
+int
+ay_objsel_hitgeom(ay_objsel_pick *pick, ay_object *o, double *m,
+		  double *depth)
+{
+ ay_voidfp *arr = NULL;
+ ay_object *master, *down;
+ double mvp[16], mm[16];
+ int status, hit = AY_FALSE;
+
+  if(pick->shade)
+    arr = ay_shadecbt.arr;
+  else
+    arr = ay_drawcbt.arr;
+
+  /* objects that are not displayed can not be picked */
+  if(!arr[o->type])
+    return AY_FALSE;
+
+  memcpy(mvp, pick->pm, 16*sizeof(double));
+  ay_trafo_multmatrix(mvp, m);
+
+  switch(o->type)
+    {
+    case AY_IDLEVEL:
+      return AY_FALSE;
+    case AY_IDPOMESH:
+      return ay_objsel_hitpomesh(pick, mvp, o, depth);
+    case AY_IDNCURVE:
+      return ay_objsel_hitncurve(pick, mvp, o, depth);
+    case AY_IDNPATCH:
+      return ay_objsel_hitnpatch(pick, mvp, o, m, depth);
+    case AY_IDINSTANCE:
+      /* instances display the master and its children */
+      master = (ay_object *)o->refine;
+      if(!master || (o->tags && ay_instance_hasrptrafo(o)))
+	return AY_ERROR;
+
+      status = ay_objsel_hitgeom(pick, master, m, depth);
+      if(status == AY_ERROR)
+	return AY_ERROR;
+      if(status)
+	hit = AY_TRUE;
+
+      if(master->down && master->down->next && !master->hide_children)
+	{
+	  if(!master->inherit_trafos)
+	    ay_trafo_identitymatrix(mm);
+	  else
+	    memcpy(mm, m, 16*sizeof(double));
+
+	  down = master->down;
+	  while(down->next)
+	    {
+	      status = ay_objsel_hittree(pick, down, mm, depth);
+	      if(status == AY_ERROR)
+		return AY_ERROR;
+	      if(status)
+		hit = AY_TRUE;
+	      down = down->next;
+	    } /* while */
+	} /* if */
+      return hit;
+    default:
+      break;
+    } /* switch */
+
+ return AY_ERROR;
+} /* ay_objsel_hitgeom */
+
+
+/* ay_objsel_hittree:
+ *  pick object <o> and its children (with parent transformation <pm>)
+ *  as part of an instance, mimicking ay_draw_object();
+ *  returns AY_TRUE if anything was picked (depth of hit in <depth>),
+ *  AY_FALSE if not, and AY_ERROR if OpenGL has to be used
+ */
+int
+ay_objsel_hittree(ay_objsel_pick *pick, ay_object *o, double *pm,
+		  double *depth)
+{
+ ay_object *down;
+ double m[16], mt[16];
+ int status, hit = AY_FALSE;
+
+  if(o->hide)
+    return AY_FALSE;
+
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
+  memcpy(m, pm, 16*sizeof(double));
+  if(AY_ISTRAFO(o))
+    {
+      ay_trafo_creatematrix(o, mt);
+      ay_trafo_multmatrix(m, mt);
+    }
+
+  status = ay_objsel_hitgeom(pick, o, m, depth);
+  if(status == AY_ERROR)
+    return AY_ERROR;
+  if(status)
+    hit = AY_TRUE;
+
+  if(!o->hide_children && o->down)
+    {
+      if(!o->inherit_trafos)
+	ay_trafo_identitymatrix(m);
+
+      down = o->down;
+      while(down->next)
+	{
+	  status = ay_objsel_hittree(pick, down, m, depth);
+	  if(status == AY_ERROR)
+	    return AY_ERROR;
+	  if(status)
+	    hit = AY_TRUE;
+	  down = down->next;
 	}
-    } /* for */
+    }
+
+ return hit;
+} /* ay_objsel_hittree */
+
+
+/* ay_objsel_addhit:
+ *  record object <o> (with transformation <m>) as picked with <depth>,
+ *  or, if <m> is not NULL, as to be picked using OpenGL
+ */
+int
+ay_objsel_addhit(ay_objsel_pick *pick, ay_object *o, double depth, double *m)
+{
+ ay_objsel_hit *th;
+ ay_objsel_cand *tc;
+ char *node;
+
+  if(!(node = malloc((Tcl_DStringLength(&pick->node)+1)*sizeof(char))))
+    return AY_EOMEM;
+  strcpy(node, Tcl_DStringValue(&pick->node));
+
+  if(m)
+    {
+      if(pick->candslen == pick->candsalloc)
+	{
+	  pick->candsalloc = pick->candsalloc?2*pick->candsalloc:64;
+	  if(!(tc = realloc(pick->cands,
+			    pick->candsalloc*sizeof(ay_objsel_cand))))
+	    {
+	      free(node);
+	      return AY_EOMEM;
+	    }
+	  pick->cands = tc;
+	}
+      tc = &(pick->cands[pick->candslen]);
+      tc->o = o;
+      tc->node = node;
+      memcpy(tc->m, m, 16*sizeof(double));
+      tc->seq = pick->seq;
+      pick->candslen++;
+    }
+  else
+    {
+      if(pick->hitslen == pick->hitsalloc)
+	{
+	  pick->hitsalloc = pick->hitsalloc?2*pick->hitsalloc:64;
+	  if(!(th = realloc(pick->hits,
+			    pick->hitsalloc*sizeof(ay_objsel_hit))))
+	    {
+	      free(node);
+	      return AY_EOMEM;
+	    }
+	  pick->hits = th;
+	}
+      th = &(pick->hits[pick->hitslen]);
+      th->o = o;
+      th->node = node;
+      th->depth = depth;
+      th->seq = pick->seq;
+      pick->hitslen++;
+    } /* if */
+
+ return AY_OK;
+} /* ay_objsel_addhit */
+
+
+/* ay_objsel_pickobject:
+ *  pick object <o> (the <index>th object in its level) and its children,
+ *  <pm> is the transformation of the parent
+ */
+void
+ay_objsel_pickobject(ay_objsel_pick *pick, ay_object *o, double *pm,
+		     int index)
+{
+ ay_object *down;
+ double m[16], mt[16], mvp[16], bb[6], depth = DBL_MAX;
+ char buf[64];
+ int status, oldlen, i;
+
+  if(o->hide || o == ay_root)
+    return;
+
+  memcpy(m, pm, 16*sizeof(double));
+  if(AY_ISTRAFO(o))
+    {
+      ay_trafo_creatematrix(o, mt);
+      ay_trafo_multmatrix(m, mt);
+    }
+
+  /* check the bounding box of the object and its children */
+  if(!ay_bbc_getcull(o, bb))
+    {
+      memcpy(mvp, pick->pm, 16*sizeof(double));
+      ay_trafo_multmatrix(mvp, m);
+      if(!ay_objsel_hitbox(mvp, bb))
+	return;
+    }
+
+  /* load lazily loaded objects only when their boxes are hit */
+  if(!o->refine)
+    (void)ay_bin_load(o);
+
+  oldlen = Tcl_DStringLength(&pick->node);
+  sprintf(buf, ":%d", index);
+  Tcl_DStringAppend(&pick->node, buf, -1);
 
-  /* Remove the space at the end of 'node' */
-  if((strlen(node) > 0) && (node[strlen(node) - 1] == ' '))
-    node[strlen(node) - 1] = 0;
+  pick->seq++;
 
-  /* Verify that 'tmp' is big enough to store the Tcl command */
-  if((strlen(node) + strlen(var) + 16) > 256)
+  status = ay_objsel_hitgeom(pick, o, m, &depth);
+  if(status == AY_ERROR)
+    (void)ay_objsel_addhit(pick, o, 0.0, m);
+  else
+    if(status)
+      (void)ay_objsel_addhit(pick, o, depth, NULL);
+
+  if(!o->hide_children && o->down)
     {
-      tmptmp = (char*) realloc(tmp, (strlen(node) + strlen(var) + 16) *
-			     sizeof(char));
-      if(!tmptmp)
+      if(!o->inherit_trafos && !pick->shade)
+	ay_trafo_identitymatrix(m);
+
+      i = 0;
+      down = o->down;
+      while(down->next)
 	{
-	  if(node)
-	    free(node);
-	  if(tmp)
-	    free(tmp);
-	  ay_error(AY_EOMEM, fname, NULL);
-	  return;
+	  ay_objsel_pickobject(pick, down, m, i);
+	  i++;
+	  down = down->next;
 	}
-      tmp = tmptmp;
     }
 
-  /* Store the result in the Tcl variable : node */
-  sprintf(tmp, "set %s \"%s\"", var, node);
-  Tcl_Eval(ay_interp, tmp);
+  Tcl_DStringSetLength(&pick->node, oldlen);
+
+ return;
+} /* ay_objsel_pickobject */
+
+
+/* ay_objsel_levelnode:
+ *  append the node name of the level <lo> (part of the current level
+ *  stack) to <ds>
+ */
+void
+ay_objsel_levelnode(ay_list_object *lo, Tcl_DString *ds)
+{
+ ay_object *o;
+ char buf[64];
+ int n = 0;
+
+  if(!lo || !lo->next)
+    return;
+
+  ay_objsel_levelnode(lo->next->next, ds);
+
+  o = lo->next->object;
+  while(o && o != lo->object)
+    {
+      n++;
+      o = o->next;
+    }
+
+  sprintf(buf, ":%d", n);
+  Tcl_DStringAppend(ds, buf, -1);
+
+ return;
+} /* ay_objsel_levelnode */
+
+
+/* ay_objsel_glpick:
+ *  pick the objects that have no CPU representation of their geometry
+ *  using the OpenGL selection mode; the selection buffer grows as needed
+ */
+int
+ay_objsel_glpick(struct Togl *togl, ay_objsel_pick *pick)
+{
+ ay_voidfp *arr = NULL;
+ ay_drawcb *cb = NULL;
+ GLuint *selectbuf = NULL, *s, namecnt, name;
+ GLint hits = -1, i, j;
+ GLsizei selectbuflen;
+ double tolerance;
+ unsigned int k;
+
+  if(!pick->candslen)
+    return AY_OK;
+
+  if(pick->shade)
+    arr = ay_shadecbt.arr;
+  else
+    arr = ay_drawcbt.arr;
+
+  tolerance = ay_prefs.glu_sampling_tolerance;
+  ay_prefs.glu_sampling_tolerance = 120.0;
+
+  Togl_MakeCurrent(togl);
+
+  /* each object delivers at most one hit record of four values */
+  selectbuflen = (GLsizei)(pick->candslen*4+4);
+
+  while(hits < 0)
+    {
+      if(selectbuf)
+	free(selectbuf);
+      if(!(selectbuf = malloc(selectbuflen*sizeof(GLuint))))
+	{
+	  ay_prefs.glu_sampling_tolerance = tolerance;
+	  return AY_EOMEM;
+	}
+
+      glSelectBuffer(selectbuflen, selectbuf);
+      glRenderMode(GL_SELECT);
+
+      glInitNames();
+      glPushName(0);
+
+      glMatrixMode(GL_PROJECTION);
+      glPushMatrix();
+      glLoadMatrixd((GLdouble*)pick->pm);
+      glMatrixMode(GL_MODELVIEW);
+      glPushMatrix();
+
+      if(pick->shade)
+	glDisable(GL_LIGHTING);
+
+      for(k = 0; k < pick->candslen; k++)
+	{
+	  cb = (ay_drawcb *)(arr[pick->cands[k].o->type]);
+	  if(cb)
+	    {
+	      glLoadMatrixd((GLdouble*)pick->cands[k].m);
+	      glLoadName((GLuint)(k+1));
+	      (void)cb(togl, pick->cands[k].o);
+	    }
+	}
+
+      if(pick->shade)
+	glEnable(GL_LIGHTING);
+
+      glMatrixMode(GL_MODELVIEW);
+      glPopMatrix();
+      glMatrixMode(GL_PROJECTION);
+      glPopMatrix();
+      glMatrixMode(GL_MODELVIEW);
+      glPopName();
+      glFinish();
+
+      hits = glRenderMode(GL_RENDER);
+
+      /* buffer overflow, try again with a bigger buffer */
+      if(hits < 0)
+	selectbuflen *= 2;
+    } /* while */
+
+  ay_prefs.glu_sampling_tolerance = tolerance;
+
+  /* process hits */
+  s = selectbuf;
+  for(i = 0; i < hits; i++)
+    {
+      namecnt = s[0];
+      for(j = 0; j < (GLint)namecnt; j++)
+	{
+	  name = s[3+j];
+	  if(name > 0 && name <= pick->candslen)
+	    {
+	      pick->seq = pick->cands[name-1].seq;
+	      Tcl_DStringSetLength(&pick->node, 0);
+	      Tcl_DStringAppend(&pick->node, pick->cands[name-1].node, -1);
+	      (void)ay_objsel_addhit(pick, pick->cands[name-1].o,
+				     s[1]/4294967295.0, NULL);
+	    }
+	}
+      s += 3+namecnt;
+    } /* for */
+
+  free(selectbuf);
+
+ return AY_OK;
+} /* ay_objsel_glpick */
+
+
+/* ay_objsel_cmphits:
+ *  qsort() helper to sort hits by depth (and order of traversal)
+ */
+int
+ay_objsel_cmphits(const void *a, const void *b)
+{
+ const ay_objsel_hit *ha = (const ay_objsel_hit *)a;
+ const ay_objsel_hit *hb = (const ay_objsel_hit *)b;
+
+  if(ha->depth < hb->depth)
+    return -1;
+  if(ha->depth > hb->depth)
+    return 1;
+  if(ha->seq < hb->seq)
+    return -1;
+  if(ha->seq > hb->seq)
+    return 1;
+
+ return 0;
+} /* ay_objsel_cmphits */
+
+
+/* ay_objsel_clearpick:
+ *  free all resources of picking state <pick>
+ */
+void
+ay_objsel_clearpick(ay_objsel_pick *pick)
+{
+ unsigned int i;
+
+  for(i = 0; i < pick->hitslen; i++)
+    free(pick->hits[i].node);
+  if(pick->hits)
+    free(pick->hits);
+  pick->hits = NULL;
+  pick->hitslen = 0;
+
+  for(i = 0; i < pick->candslen; i++)
+    free(pick->cands[i].node);
+  if(pick->cands)
+    free(pick->cands);
+  pick->cands = NULL;
+  pick->candslen = 0;
 
-  free(node);
-  free(tmp);
+  Tcl_DStringFree(&pick->node);
 
  return;
-} /* ay_objsel_process_hits */
+} /* ay_objsel_clearpick */
 
 
 void
@@ -395,102 +1304,25 @@ ay_objsel_flashobjects(struct Togl *togl, int n, ay_object **o)
  return;
 } /* ay_objsel_flashobjects */
 
-
-/* ay_objsel_draw_hits:
- */
-void
-ay_objsel_draw_hits(GLint hits, GLuint buffer[], struct Togl *togl)
-{
- int i = 0, n = 0;
- GLint *ptr = NULL;
- ay_object **picked = NULL;
- ay_object *o = NULL;
- GLuint object_name = 0;
- GLuint namecnt = 0;
- unsigned int j = 0;
-
-  if(hits)
-    {
-      ptr = (GLint *) buffer;
-
-      if(!(picked = calloc(hits, sizeof(ay_object *))))
-	return;
-
-      for(i = 0; i < hits; i++)
-	{
-	  namecnt = *ptr;
-	  ptr += 3;
-	  o = ay_root;
-
-	  for(j = 0; j < namecnt; j++)
-	    {
-	      object_name = *(ptr++);
-
-	      /* Skip the root object from the list */
-	      if(object_name == ay_root->glname)
-		{
-		  ptr += namecnt - j - 1;
-		  break;
-		}
-
-	      if(object_name)
-		{
-		  while(o->next)
-		    {
-		      if(o->glname == object_name)
-			break;
-
-		      o = o->next;
-		    }
-
-		  if(o->glname != object_name)
-		    {
-		      o = NULL;
-		      break;
-		    }
-
-		  if((j != namecnt - 1) && (o->down) && (o->down->next))
-		    {
-		      o = o->down;
-		    }
-		} /* if */
-	    } /* for */
-
-
-	  if(o && o != ay_root)
-	    {
-	      picked[n] = o;
-	      n++;
-	    }
-	} /* for */
-    } /* if have hits i*/
-
-  ay_objsel_flashobjects(togl, n, picked);
-
- return;
-} /* ay_objsel_draw_hits */
-
-
 /* ay_objsel_processcb:
  *  Togl action callback for object picking
  */
 int
 ay_objsel_processcb(struct Togl *togl, int argc, char *argv[])
 {
+ int ay_status = AY_OK;
  Tcl_Interp *interp = ay_interp;
  ay_view_object *view = (ay_view_object *) Togl_GetClientData(togl);
- /* char fname[] = "objsel_process"; */
- ay_object *o = ay_root->next;
+ char fname[] = "objsel_process";
+ ay_object *o = ay_root, **picked = NULL;
  ay_list_object *sel = ay_selection;
- int width = Togl_Width(togl);
- int height = Togl_Height(togl);
- GLdouble aspect = ((GLdouble) width) / ((GLdouble) height);
- double tolerance;
+ ay_objsel_pick pick = {0};
+ Tcl_DString ds;
  double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
  double x = 0.0, y = 0.0, boxw = 0.0, boxh = 0.0;
- GLuint selectBuf[1024];
- GLint hits;
- GLint viewport[4];
+ double pm[16];
+ int i, level = AY_FALSE, prefixlen = 0;
+ unsigned int k;
 
   if(argv[2][0] == '+')
     {
@@ -525,122 +1357,99 @@ ay_objsel_processcb(struct Togl *togl, int argc, char *argv[])
       boxw = ay_prefs.object_pick_epsilon;
     }
 
-  tolerance = ay_prefs.glu_sampling_tolerance;
-  ay_prefs.glu_sampling_tolerance = 120.0;
-
-  Togl_MakeCurrent(togl);
-
-  glGetIntegerv(GL_VIEWPORT, viewport);
-
-  glSelectBuffer(1024, selectBuf);
-  glRenderMode(GL_SELECT);
-
-  glInitNames();
-  glPushName(0);
-
-  glMatrixMode(GL_PROJECTION);
-  glPushMatrix();
-  glLoadIdentity();
-  gluPickMatrix(x, (GLdouble) (viewport[3] - y), boxw, boxh, viewport);
+  pick.shade = view->drawmode;
+  ay_objsel_pickmatrix(togl, x, y, boxw, boxh, pick.pm);
+  Tcl_DStringInit(&pick.node);
+  Tcl_DStringAppend(&pick.node, "root", -1);
 
-  /* Setup projection code from viewt.c */
-  if(view->type == AY_VTPERSP)
-    glFrustum(-aspect * view->zoom, aspect * view->zoom,
-	       -1.0 * view->zoom, 1.0 * view->zoom, 1, 1000.0);
-  else
-    glOrtho(-aspect * view->zoom, aspect * view->zoom,
-	     -1.0 * view->zoom, 1.0 * view->zoom, -100.0, 100.0);
-
-  if(view->roll != 0.0)
-    glRotated(view->roll, 0.0, 0.0, 1.0);
-  if(view->type != AY_VTTOP)
-    gluLookAt(view->from[0], view->from[1], view->from[2],
-	       view->to[0], view->to[1], view->to[2],
-	       view->up[0], view->up[1], view->up[2]);
-  else
-    gluLookAt(view->from[0], view->from[1], view->from[2],
-	       view->to[0], view->to[1], view->to[2],
-	       view->up[0], view->up[1], view->up[2]);
-
-  glMatrixMode(GL_MODELVIEW);
-
-  ay_glname = 1;
-  ay_root->glname = 1;
+  ay_trafo_identitymatrix(pm);
 
   if(view->drawlevel || view->type == AY_VTTRIM)
     {
+      level = AY_TRUE;
       o = ay_currentlevel->object;
-      glPushMatrix();
-      glLoadIdentity();
-      ay_trafo_concatparent(ay_currentlevel->next);
-      ay_objsel_pushzeros(ay_currentlevel->next);
-      ay_objsel_pushlnames(ay_currentlevel->next);
+      ay_trafo_getparent(ay_currentlevel->next, pm);
     }
 
-  if(!view->drawmode)
+  if(level || view->drawsel)
     {
-      if(!view->drawsel)
-	{
-	  while(o->next)
-	    {
-	      ay_draw_object(togl, o, 2);
-	      o = o->next;
-	    }
-	}
-      else
+      ay_objsel_levelnode(ay_currentlevel->next, &pick.node);
+      prefixlen = Tcl_DStringLength(&pick.node);
+    }
+
+  ay_bbc_cachenewframe();
+
+  if(!view->drawsel)
+    {
+      i = 0;
+      while(o->next)
 	{
-	  while(sel)
-	    {
-	      ay_draw_object(togl, sel->object, 2);
-	      sel = sel->next;
-	    }
+	  ay_objsel_pickobject(&pick, o, pm, i);
+	  i++;
+	  o = o->next;
 	}
     }
   else
     {
-      glDisable(GL_LIGHTING);
-      if(!view->drawsel)
+      while(sel)
 	{
-	  while(o->next)
+	  /* get index of selected object in the current level */
+	  i = 0;
+	  o = ay_currentlevel->object;
+	  while(o && o != sel->object)
 	    {
-	      ay_shade_object(togl, o, AY_TRUE);
+	      i++;
 	      o = o->next;
 	    }
+	  Tcl_DStringSetLength(&pick.node, prefixlen);
+	  ay_objsel_pickobject(&pick, sel->object, pm, i);
+	  sel = sel->next;
 	}
-      else
-	{
-	  while(sel)
-	    {
-	      ay_shade_object(togl, sel->object, AY_TRUE);
-	      sel = sel->next;
-	    }
-	}
-      glEnable(GL_LIGHTING);
     }
 
-  if(view->drawlevel || view->type == AY_VTTRIM)
+  /* pick the remaining objects using OpenGL */
+  ay_status = ay_objsel_glpick(togl, &pick);
+
+  if(ay_status)
     {
-      glMatrixMode(GL_MODELVIEW);
-      glPopMatrix();
-      ay_objsel_poplnames(ay_currentlevel->next);
+      ay_error(ay_status, fname, NULL);
+      ay_objsel_clearpick(&pick);
+      return TCL_OK;
     }
 
-  glMatrixMode(GL_PROJECTION);
-  glPopMatrix();
-  glPopName();
-  glFinish();
-
-  hits = glRenderMode(GL_RENDER);
-
-  ay_prefs.glu_sampling_tolerance = tolerance;
+  /* closest objects first */
+  if(pick.hitslen > 1)
+    qsort(pick.hits, pick.hitslen, sizeof(ay_objsel_hit), ay_objsel_cmphits);
 
   if(argv[2][0] == '-')
     {
-      if(view->drawmode == AY_DMWIRE)
-	ay_objsel_draw_hits(hits, selectBuf, togl);
+      if(pick.hitslen)
+	{
+	  if(!(picked = calloc(pick.hitslen, sizeof(ay_object *))))
+	    {
+	      ay_error(AY_EOMEM, fname, NULL);
+	      ay_objsel_clearpick(&pick);
+	      return TCL_OK;
+	    }
+	  for(k = 0; k < pick.hitslen; k++)
+	    picked[k] = pick.hits[k].o;
+	}
+      ay_objsel_flashobjects(togl, (int)pick.hitslen, picked);
     }
   else
-    ay_objsel_process_hits(hits, selectBuf, argv[2]);
+    {
+      Tcl_DStringInit(&ds);
+      for(k = 0; k < pick.hitslen; k++)
+	{
+	  if(k > 0)
+	    Tcl_DStringAppend(&ds, " ", -1);
+	  Tcl_DStringAppend(&ds, pick.hits[k].node, -1);
+	}
+      Tcl_SetVar(interp, argv[2], Tcl_DStringValue(&ds), TCL_LEAVE_ERR_MSG);
+      Tcl_DStringFree(&ds);
+    }
+
+  ay_objsel_clearpick(&pick);
 
  return TCL_OK;
 } /* ay_objsel_processcb */
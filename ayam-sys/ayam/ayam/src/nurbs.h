@@ -26,13 +26,16 @@ int ay_act_leastSquares(double *Q, int m, int n, int p, int kt,
 int ay_act_leastSquaresClosed(double *Q, int m, int n, int p, int kt,
 			      double **U, double **P);
 
-/** Multiply two matrices.
+/** Set up and factorize banded least squares normal equations.
  */
-int ay_act_multmatrixmn(int m, int n, double *M1, double *M2, double *R);
+int ay_act_lsqfactor(int m, int n, int p, int clamped, double *ub, double *U,
+		     int *spans, double *funs, double *NN, int *pivot);
 
-/** Solve A*X=B.
+/** Solve least squares problem factorized by ay_act_lsqfactor().
  */
-int ay_act_solve(int m, int n, double *A, double *B, double *X);
+void ay_act_lsqsolve(int m, int n, int p, int clamped,
+		     int *spans, double *funs, double *NN, int *pivot,
+		     double *Q, int Qstride, double *R, double *P, int Pstride);
 
 /** Resize a approximating curve.
  */
@@ -427,6 +430,15 @@ int ay_nb_LUDecompose(int n, double *A, int *pivot);
  */
 int ay_nb_LUInvert(int n, double *inv, int *pivot);
 
+/** Do a LU decomposition of the NxN band matrix A.
+ */
+int ay_nb_BandLUDecompose(int N, int kl, int ku, double *A, int *pivot);
+
+/** Solve A*X=B with a band matrix decomposed by ay_nb_BandLUDecompose().
+ */
+void ay_nb_BandLUSolve(int N, int kl, int ku, double *A, int *pivot,
+		       int nrhs, double *B);
+
 /** Interpolate the n+1 4D points in Q.
  */
 int ay_nb_GlobalInterpolation4D(int n, double *Q, double *ub, double *Uc,
@@ -567,6 +579,18 @@ int ay_nb_FirstDerSurf3DMSize(int p, int q);
 void ay_nb_FirstDerSurf3DM(int n, int m, int p, int q, double *U, double *V,
 			   double *P, double u, double v, double *C);
 
+/** Calculate many points (and derivatives) on a NURBS curve at once.
+ */
+int ay_nb_CurvePoints4D(int n, int p, double *U, double *Pw, int is_rat,
+			int npts, double *u, int stride, double *C, double *D);
+
+/** Calculate a grid of points (and normals) on a NURBS surface at once.
+ */
+int ay_nb_SurfacePointsGrid4D(int n, int m, int p, int q, double *U,
+			      double *V, double *Pw, int is_rat,
+			      int nu, double *u, int nv, double *v,
+			      int stride, double *C, double *N);
+
 void ay_nb_SecondDerSurf3D(int n, int m, int p, int q, double *U, double *V,
 			   double *P, double u, double v, double *C);
 
@@ -896,10 +920,15 @@ int ay_nct_curvplottcmd(ClientData clientData, Tcl_Interp *interp,
 int ay_nct_getcurvaturetcmd(ClientData clientData, Tcl_Interp *interp,
 			    int argc, char *argv[]);
 
-/** Unfinished.
+/** Calculate all intersections of two curves.
  */
 int ay_nct_intersect(ay_nurbcurve_object *cu, ay_nurbcurve_object *cv,
-		     double *intersection);
+		     double tol, int *nis, double **is);
+
+/** Tcl command to calculate the intersections of two curves.
+ */
+int ay_nct_intersecttcmd(ClientData clientData, Tcl_Interp *interp,
+			 int argc, char *argv[]);
 
 /** Calculate intersections of two sets of curves.
  */
@@ -1487,11 +1516,26 @@ int ay_npt_extractnptcmd(ClientData clientData, Tcl_Interp *interp,
 int ay_npt_offset(ay_object *o, int mode, double offset,
 		  ay_nurbpatch_object **np);
 
+/** Find point on NURBS surface closest to a point.
+ */
+int ay_npt_projectpnt(ay_nurbpatch_object *np, double *p,
+		      double *u, double *v, double *res);
+
+/** Find first intersection of a ray with a NURBS surface.
+ */
+int ay_npt_intersectray(ay_nurbpatch_object *np, double *ro, double *rd,
+			double *u, double *v, double *res);
+
 /** Find point on NURBS surface.
  */
 int ay_npt_finduv(struct Togl *togl, ay_object *o,
 		  double *winXY, double *worldXYZ, double *u, double *v);
 
+/** Tcl command to find a point on a NURBS surface.
+ */
+int ay_npt_finduvtcmd(ClientData clientData, Tcl_Interp *interp,
+		      int argc, char *argv[]);
+
 /** Find point on NURBS surface modelling action.
  */
 int ay_npt_finduvcb(struct Togl *togl, int argc, char *argv[]);
@@ -1722,6 +1766,14 @@ void ay_stess_DrawTrimmedSurface(ay_stess_patch *stess);
  */
 void ay_stess_ShadeTrimmedSurface(ay_stess_patch *stess);
 
+/** Build the shading triangles of a tesselated trimmed NURBS surface.
+ */
+int ay_stess_TrimmedSurfaceVB(ay_stess_patch *stess);
+
+/** Shade tesselation of a NURBS surface (trimmed or untrimmed).
+ */
+void ay_stess_ShadeSurface(ay_stess_patch *stess);
+
 /** Tesselate all trim curves of a NURBS surface.
  */
 int ay_stess_TessTrimCurves(ay_object *o, int qf, int *nt, double ***tt,
@@ -1763,6 +1815,34 @@ int ay_tess_npatch(ay_object *o,
 int ay_tess_npatchtcmd(ClientData clientData, Tcl_Interp *interp,
 		       int argc, char *argv[]);
 
+/** Tesselate untrimmed NURBS patch on a regular grid without GLU.
+ */
+int ay_tess_npatchgrid(ay_nurbpatch_object *npatch, int qf, int primitives,
+		       ay_object **pm);
+
+/** Adaptively tesselate (trimmed) NURBS patch without GLU.
+ */
+int ay_tess_npatchadaptive(ay_nurbpatch_object *npatch, int ntrims,
+			   double **trims, int *trimslens, double cdev,
+			   double ndev, int primitives, ay_object **pm);
+
+/** Tcl command to adaptively tesselate selected NURBS patches
+ *  without GLU.
+ */
+int ay_tess_npatchadaptivetcmd(ClientData clientData, Tcl_Interp *interp,
+			       int argc, char *argv[]);
+
+/** Tesselate all NURBS patches in a list of objects in parallel.
+ */
+int ay_tess_npatches(ay_list_object *l, int qf, int primitives,
+		     ay_object **result);
+
+/** Tcl command to tesselate all NURBS patches in the selected objects
+ *  in parallel.
+ */
+int ay_tess_npatchestcmd(ClientData clientData, Tcl_Interp *interp,
+			 int argc, char *argv[]);
+
 /** Tesselate a single polymesh face with GLU.
  */
 int ay_tess_pomeshf(ay_pomesh_object *pomesh,
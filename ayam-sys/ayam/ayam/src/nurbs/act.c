@@ -14,484 +14,143 @@
 
 /* act.c - approximating curve tools */
 
-/* prototypes of functions local to this module: */
-
-int ay_act_svd(int m, int n, int withu, int withv,
-	       double eps, double tol,
-	       double *a, double *q, double *u, double *v);
-
-
 /* functions: */
 
-/* ay_act_svd:
- *  singular value decomposition of matrix <a[m][n]> into <q>, <u> and <v>
- *  <withu> and <withv> should be 1, <eps>, and <tol> >= AY_EPSILON
+/* ay_act_lsqfactor:
+ *  set up and factorize the normal equations N^T*N*P = N^T*Q of the
+ *  least squares approximation of <m> data points at the parameters <ub>
+ *  with <n> B-Spline basis functions of degree <p> over the knots <U>;
+ *  as every data point only influences p+1 consecutive control points,
+ *  N^T*N is a band matrix with p sub- and super-diagonals and is stored
+ *  and decomposed as such (see ay_nb_BandLUDecompose());
+ *  if <clamped> is set, the first and last control point are not part
+ *  of the system (they are set to the first and last data point);
+ *  <spans[m]>, <funs[m*(p+1)]>, <NN[n*(3*p+1)]>, and <pivot[n]> have to be
+ *  allocated outside and are to be fed into ay_act_lsqsolve() below,
+ *  which may be called for any number of data point sets sharing <ub>
  */
 int
-ay_act_svd(int m, int n, int withu, int withv, double eps, double tol,
-	   double *a, double *q, double *u, double *v)
+ay_act_lsqfactor(int m, int n, int p, int clamped, double *ub, double *U,
+		 int *spans, double *funs, double *NN, int *pivot)
 {
- int i, j, k, l = 0, l1, iter, retval;
- double c, f, g, h, s, x, y, z;
- double *e;
+ int w = 3*p+1, nu, i, j, k, r, c, span;
+ double *f;
 
-  if(!(e = (double *)calloc(n, sizeof(double))))
-    return 1;
-  retval = 0;
+  if(!ub || !U || !spans || !funs || !NN || !pivot)
+    return AY_ENULL;
 
-  /* Copy 'a' to 'u' */
-  for(i = 0; i < m; i++)
-    {
-      for(j = 0; j < n; j++)
-	{
-	  /*u[i][j] = a[i][j];*/
-	  u[i*m+j] = a[i*m+j];
-	}
-    }
-  /* Householder's reduction to bidiagonal form. */
-  g = x = 0.0;
-  for(i = 0; i < n; i++)
-    {
-      e[i] = g;
-      s = 0.0;
-      l = i+1;
-      for(j = i; j < m; j++)
-	{
-	  s += (u[j*m+i]*u[j*m+i]);
-	}
-      if(s < tol)
-	{
-	  g = 0.0;
-	}
-      else
-	{
-	  f = u[i*m+i];
-	  g = (f < 0) ? sqrt(s) : -sqrt(s);
-	  h = f * g - s;
-	  u[i*m+i] = f - g;
-	  for(j = l; j < n; j++)
-	    {
-	      s = 0.0;
-	      for(k = i; k < m; k++)
-		{
-		  s += (u[k*m+i] * u[k*m+j]);
-		}
-	      f = s / h;
-	      for(k = i; k < m; k++)
-		{
-		  u[k*m+j] += (f * u[k*m+i]);
-		}
-	    } /* for */
-	} /* if */
-      q[i] = g;
-      s = 0.0;
-      for(j = l; j < n; j++)
-	{
-	  s += (u[i*m+j] * u[i*m+j]);
-	}
-      if(s < tol)
-	{
-	  g = 0.0;
-	}
-      else
-	{
-	  f = u[i*m+i+1];
-	  g = (f < 0) ? sqrt(s) : -sqrt(s);
-	  h = f * g - s;
-	  u[i*m+i+1] = f - g;
-	  for(j=l;j<n;j++)
-	    {
-	      e[j] = u[i*m+j]/h;
-	    }
-	  for(j=l;j<m;j++)
-	    {
-	      s = 0.0;
-	      for(k = l; k < n; k++)
-		{
-		  s += (u[j*m+k] * u[i*m+k]);
-		}
-	      for(k = l; k < n; k++)
-		{
-		  u[j*m+k] += (s * e[k]);
-		}
-	    } /* for */
-	} /* if */
-      y = fabs(q[i]) + fabs(e[i]);
-      if(y > x)
-	x = y;
-    } /* end i */
+  /* number of unknowns */
+  nu = clamped?n-2:n;
 
-  /* accumulation of right-hand transformations */
-  if(withv)
-    {
-      for(i = n-1; i >= 0; i--)
-	{
-	  if(g != 0.0)
-	    {
-	      h = u[i*m+i+1] * g;
-	      for(j = l; j < n; j++)
-		{
-		  v[j*m+i] = u[i*m+j]/h;
-		}
-	      for(j = l; j < n; j++)
-		{
-		  s = 0.0;
-		  for(k = l; k < n; k++)
-		    {
-		      s += (u[i*m+k] * v[k*m+j]);
-		    }
-		  for(k = l; k < n; k++)
-		    {
-		      v[k*m+j] += (s * v[k*m+i]);
-		    }
-		} /* for */
-	    } /* if */
-	  for(j = l; j < n; j++)
-	    {
-	      v[i*m+j] = v[j*m+i] = 0.0;
-	    }
-	  v[i*m+i] = 1.0;
-	  g = e[i];
-	  l = i;
-	} /* for */
-    } /* end withv, parens added for clarity */
+  if(nu <= 0)
+    return AY_OK;
 
-  /* accumulation of left-hand transformations */
-  if(withu)
-    {
-      for(i = n; i < m; i++)
-	{
-	  for(j = n; j < m; j++)
-	    {
-	      u[i*m+j] = 0.0;
-	    }
-	  u[i*m+i] = 1.0;
-	}
+  memset(NN, 0, nu*w*sizeof(double));
 
-      for(i = n-1; i >= 0; i--)
-	{
-	  l = i + 1;
-	  g = q[i];
-	  for(j = l; j < m; j++)  /* upper limit was 'n' */
-	    {
-	      u[i*m+j] = 0.0;
-	    }
-	  if(g != 0.0)
-	    {
-	      h = u[i*m+i] * g;
-	      for(j = l; j < m; j++) /* upper limit was 'n' */
-		{
-		  s = 0.0;
-		  for(k = l; k < m; k++)
-		    {
-		      s += (u[k*m+i] * u[k*m+j]);
-		    }
-		  f = s / h;
-		  for(k = i; k < m; k++)
-		    {
-		      u[k*m+j] += (f * u[k*m+i]);
-		    }
-		} /* end j */
-	      for(j = i; j < m; j++)
-		{
-		  u[j*m+i] /= g;
-		}
-	    } /* end g */
-	  else
-	    {
-	      for(j = i; j < m; j++)
-		{
-		  u[j*m+i] = 0.0;
-		}
-	    }
-	  u[i*m+i] += 1.0;
-	} /* end i*/
-    } /* end withu, parens added for clarity */
-
-  /* diagonalization of the bidiagonal form */
-  eps *= x;
-  for(k = n-1; k >= 0; k--)
+  for(i = 0; i < m; i++)
     {
-      iter = 0;
-test_f_splitting:
-      for(l = k; l >= 0; l--)
-	{
-	  if(fabs(e[l]) <= eps) goto test_f_convergence;
-	  if(fabs(q[l-1]) <= eps) goto cancellation;
-	} /* end l */
-
-      /* cancellation of e[l] if l > 0 */
-cancellation:
-      c = 0.0;
-      s = 1.0;
-      l1 = l - 1;
-      for(i = l; i <= k; i++)
-	{
-	  f = s * e[i];
-	  e[i] *= c;
-	  if(fabs(f) <= eps) goto test_f_convergence;
-	  g = q[i];
-	  h = q[i] = sqrt(f*f + g*g);
-	  c = g / h;
-	  s = -f / h;
-	  if(withu)
-	    {
-	      for(j = 0; j < m; j++)
-		{
-		  y = u[j*m+l1];
-		  z = u[j*m+i];
-		  u[j*m+l1] = y * c + z * s;
-		  u[j*m+i] = -y * s + z * c;
-		} /* end j */
-	    } /* end withu, parens added for clarity */
-	} /* end i */
-test_f_convergence:
-      z = q[k];
-      if(l == k) goto convergence;
-
-      /* shift from bottom 2x2 minor */
-      iter++;
-      if(iter > 30) {
-	retval = k;
-	break;
-      }
-      x = q[l];
-      y = q[k-1];
-      g = e[k-1];
-      h = e[k];
-      f = ((y-z)*(y+z) + (g-h)*(g+h)) / (2*h*y);
-      g = sqrt(f*f + 1.0);
-      f = ((x-z)*(x+z) + h*(y/((f<0)?(f-g):(f+g))-h))/x;
-      /* next QR transformation */
-      c = s = 1.0;
-      for(i = l+1; i <= k; i++)
-	{
-	  g = e[i];
-	  y = q[i];
-	  h = s * g;
-	  g *= c;
-	  e[i-1] = z = sqrt(f*f+h*h);
-	  c = f / z;
-	  s = h / z;
-	  f = x * c + g * s;
-	  g = -x * s + g * c;
-	  h = y * s;
-	  y *= c;
-	  if(withv)
-	    {
-	      for(j = 0; j < n; j++)
-		{
-		  x = v[j*m+i-1];
-		  z = v[j*m+i];
-		  v[j*m+i-1] = x * c + z * s;
-		  v[j*m+i] = -x * s + z * c;
-		} /* end j */
-	    } /* end withv, parens added for clarity */
-	  q[i-1] = z = sqrt(f*f + h*h);
-	  c = f/z;
-	  s = h/z;
-	  f = c * g + s * y;
-	  x = -s * g + c * y;
-	  if(withu)
-	    {
-	      for(j = 0; j < m; j++)
-		{
-		  y = u[j*m+i-1];
-		  z = u[j*m+i];
-		  u[j*m+i-1] = y * c + z * s;
-		  u[j*m+i] = -y * s + z * c;
-		} /* end j */
-	    } /* end withu, parens added for clarity */
-	} /* end i */
-      e[l] = 0.0;
-      e[k] = f;
-      q[k] = x;
-      goto test_f_splitting;
-convergence:
-      if(z < 0.0)
-	{
-	  /* q[k] is made non-negative */
-	  q[k] = - z;
-	  if(withv)
-	    {
-	      for(j = 0; j < n; j++)
-		v[j*m+k] = -v[j*m+k];
-	    } /* end withv, parens added for clarity */
-	} /* end z */
-    } /* end k */
-
-  free(e);
-
- return retval;
-} /* ay_act_svd */
+      span = ay_nb_FindSpan(n, p, ub[i], U);
 
+      /* protect BasisFuns() from bad spans */
+      if(span >= n)
+	span = n-1;
 
-/* ay_act_multmatrixmn:
- *  multiply two compatible rectangular matrices <M1[m][n]> and <M2[n][m]>,
- *  write result to <R[n][n]> (allocated outside!)
- *  compatibility will not be checked
- */
-int
-ay_act_multmatrixmn(int m, int n, double *M1, double *M2, double *R)
-{
- int i, j, k;
- int a, b, c = 0;
- double t;
-
-  if(!M1 || !M2 || !R)
-    return AY_ENULL;
-
-  /* M1 is mxn, M2 is nxm; R will be nxn */
+      spans[i] = span;
+      f = &(funs[i*(p+1)]);
+      memset(f, 0, (p+1)*sizeof(double));
+      ay_nb_BasisFuns(span, ub[i], p, U, f);
 
-  /* i shall be column number for R (and M1) */
-  for(i = 0; i < n; i++)
-    {
-      /* j shall be row number for R (and M2) */
-      for(j = 0; j < n; j++)
+      /* accumulate the outer product of the row of N into N^T*N,
+	 element (r, c) lives at NN[r*w+c-r+p] (see AY_NBBAND) */
+      for(j = 0; j <= p; j++)
 	{
-	  /* arrange to access row j in M1 */
-	  a = j;
-	  /* arrange to access column i in M2 */
-	  b = i*m;
-	  t = 0.0;
-	  for(k = 0; k < m; k++)
+	  r = span-p+j-clamped;
+	  if(r < 0 || r >= nu || f[j] == 0.0)
+	    continue;
+	  for(k = 0; k <= p; k++)
 	    {
-	      t += M1[a] * M2[b];
-	      /* forward one column in M1 */
-	      a += n;
-	      /* forward one row in M2 */
-	      b++;
-	    } /* for */
-	  R[c] = t;
-	  /* forward one row in R */
-	  c++;
-	} /* for */
+	      c = span-p+k-clamped;
+	      if(c < 0 || c >= nu)
+		continue;
+	      NN[r*w+c-r+p] += f[j]*f[k];
+	    }
+	}
     } /* for */
 
- return AY_OK;
-} /* ay_act_multmatrixmn */
+ return ay_nb_BandLUDecompose(nu, p, p, NN, pivot);
+} /* ay_act_lsqfactor */
 
 
-/* ay_act_solve:
- *  solve the linear equation system: A*X=B
- *  (A[m*n], X[n*stride], B[n*stride], m >= n)
- *  will change A! X allocated outside!
+/* ay_act_lsqsolve:
+ *  solve the least squares problem set up by ay_act_lsqfactor() above
+ *  for the <m> data points in <Q> (stride <Qstride>, only x, y, and z
+ *  are used) and store the <n> resulting control points in <P>
+ *  (stride <Pstride>, only x, y, and z are written);
+ *  <R[n*3]> is workspace that has to be allocated outside
  */
-int
-ay_act_solve(int m, int n, double *A, double *B, double *X)
+void
+ay_act_lsqsolve(int m, int n, int p, int clamped,
+		int *spans, double *funs, double *NN, int *pivot,
+		double *Q, int Qstride, double *R, double *P, int Pstride)
 {
- int ay_status = AY_OK, svd_status = 0;
- int stride = 3, i, j, k, l;
- double t, *q = NULL, *u = NULL, *v = NULL, *tmp = NULL;
- int *pivot = NULL;
+ int nu, i, j, r;
+ double *f, *q, *ql = NULL, f0, fl, rk[3];
 
-  if(!A || !B || !X)
-    return AY_ENULL;
+  nu = clamped?n-2:n;
 
-  if(m == n)
+  if(nu > 0)
     {
-      /* A is square => use LU decomposition to solve */
-      if(!(pivot = calloc(n, sizeof(int))))
-	{ ay_status = AY_EOMEM; goto cleanup; }
-
-      ay_status = ay_nb_LUDecompose(n, A, pivot);
-
-      if(ay_status)
-	{ goto cleanup; }
-
-      ay_status = ay_nb_LUInvert(n, A, pivot);
+      memset(R, 0, nu*3*sizeof(double));
 
-      if(ay_status)
-	{ goto cleanup; }
+      if(clamped)
+	ql = &(Q[(m-1)*Qstride]);
 
-      /* multiply through: X = A(^-1)*B, and store results */
-      for(i = 0; i < n; i++)
+      /* set up R = N^T*rk */
+      q = Q;
+      for(i = 0; i < m; i++)
 	{
-	  for(j = 0; j < stride; j++)
+	  f = &(funs[i*(p+1)]);
+	  memcpy(rk, q, 3*sizeof(double));
+
+	  if(clamped)
 	    {
-	      t = 0.0;
-	      for(k = 0; k < n; k++)
-		{
-		  t += (A[i*n+k] * B[k*stride+j]);
-		}
-	      X[i*stride+j] = t;
+	      /*rk[i] = Q[i]-N(0,i)*Q[0]-N(n-1,i)*Q[m-1];*/
+	      f0 = (spans[i] == p)?f[0]:0.0;
+	      fl = (spans[i] == n-1)?f[p]:0.0;
+	      rk[0] -= f0*Q[0] + fl*ql[0];
+	      rk[1] -= f0*Q[1] + fl*ql[1];
+	      rk[2] -= f0*Q[2] + fl*ql[2];
 	    }
-	}
-    }
-  else
-    {
-      /* A is not square => use SV decomposition to solve */
-      if(!(q = calloc(m, sizeof(double))))
-	{ ay_status = AY_EOMEM; goto cleanup; }
-
-      if(!(u = calloc(m*m, sizeof(double))))
-	{ ay_status = AY_EOMEM; goto cleanup; }
 
-      if(!(v = calloc(m*m, sizeof(double))))
-	{ ay_status = AY_EOMEM; goto cleanup; }
-
-      if(!(tmp = (double *)calloc(m, sizeof(double))))
-	{ ay_status = AY_EOMEM; goto cleanup; }
-
-      svd_status = ay_act_svd(m, n, 1, 1,
-			      1.5/*AY_EPSILON*/, /*0.25*/AY_EPSILON,
-			      A, q, u, v);
-
-      if(svd_status)
-	{ ay_status = AY_ERROR; goto cleanup; }
-
-      for(l = 0; l < stride; l++)
-	{
-	  for(i = 0; i < n; i++)
-	    {
-	      tmp[i] = 0.0;
-	      /* XXXX ?Use different constant/tol? */
-	      if(fabs(q[i]) > AY_EPSILON)
-		{
-		  for(j = 0; j < m; j++)
-		    {
-		      tmp[i] += (u[j*m+i] * B[i*stride+l]); /* U'.b */
-		    }
-		  tmp[i] /= q[i]; /* (1/q).U'.b */
-		}
-	      /* XXXX ?report error? */
-	      /*
-	      else
-		{
-		 ay_status = AY_ERROR; goto cleanup;
-		}
-	      */
-	    } /* for */
-	  for(i = 0; i < n; i++)
+	  for(j = 0; j <= p; j++)
 	    {
-	      X[i*stride+l] = 0.0;
-	      for(j = 0; j < n; j++)
-		{
-		  X[i*stride+l] += (v[i*m+j] * tmp[j]); /* V.(1/q).U'.b */
-		}
+	      r = spans[i]-p+j-clamped;
+	      if(r < 0 || r >= nu)
+		continue;
+	      R[r*3]   += f[j]*rk[0];
+	      R[r*3+1] += f[j]*rk[1];
+	      R[r*3+2] += f[j]*rk[2];
 	    }
+	  q += Qstride;
 	} /* for */
-    } /* if */
-
-cleanup:
-
-  if(pivot)
-    free(pivot);
 
-  if(q)
-    free(q);
+      ay_nb_BandLUSolve(nu, p, p, NN, pivot, 3, R);
 
-  if(u)
-    free(u);
-
-  if(v)
-    free(v);
+      for(i = 0; i < nu; i++)
+	{
+	  memcpy(&(P[(i+clamped)*Pstride]), &(R[i*3]), 3*sizeof(double));
+	}
+    } /* if */
 
-  if(tmp)
-    free(tmp);
+  if(clamped)
+    {
+      /* first and last points are data points */
+      memcpy(P, Q, 3*sizeof(double));
+      memcpy(&(P[(n-1)*Pstride]), &(Q[(m-1)*Qstride]), 3*sizeof(double));
+    }
 
- return ay_status;
-} /* ay_act_solve */
+ return;
+} /* ay_act_lsqsolve */
 
 
 /* ay_act_leastSquares:
@@ -503,11 +162,10 @@ ay_act_leastSquares(double *Q, int m, int n, int p, int kt,
 		    double **U, double **P)
 {
  int ay_status = AY_OK;
- int a, i, i2, j, k, istride = 3, ostride = 4, span;
+ int a, i, i2, j, k, istride = 3, ostride = 4;
+ int *spans = NULL, *pivot = NULL;
  double da, d, *ub = NULL;
- double *Ns = NULL, *Nt = NULL, *NN = NULL;
- double *R = NULL, *rk = NULL, *N = NULL, *X = NULL;
- double *funs = NULL;
+ double *NN = NULL, *R = NULL, *funs = NULL;
 
   if(!Q || !U || !P)
     return AY_ENULL;
@@ -570,153 +228,39 @@ ay_act_leastSquares(double *Q, int m, int n, int p, int kt,
       goto cleanup;
     }
 
-  if(!(rk = calloc(m*istride, sizeof(double))))
+  if(!(spans = malloc(m*sizeof(int))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  /* Note well: N is nxm! (not mxn, as suggested by the NURBS book) */
-  if(!(N = calloc(n*m, sizeof(double))))
+  if(!(funs = malloc(m*(p+1)*sizeof(double))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  if(!(funs = calloc(p+1, sizeof(double))))
+  if(!(NN = malloc(n*(3*p+1)*sizeof(double))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  /* set up N and rk */
-  for(i = 0; i < m; i++)
-    {
-      span = ay_nb_FindSpan(n, p, ub[i], *U);
-
-      /* protect BasisFuns() from bad spans */
-      if(span >= n)
-	span = n-1;
-
-      memset(funs, 0, (p+1)*sizeof(double));
-      ay_nb_BasisFuns(span, ub[i], p, *U, funs);
-
-      for(j = 0; j <= p; j++)
-	{
-	  a = (span-p+j)*m+i;
-	  N[a] = funs[j];
-	  /*
-	  if(isnan(N[a]))
-	  {
-	    ay_status = AY_ERROR; goto cleanup;
-	  }
-	  */
-	}
-
-      /*rk[i] = Q[i]-N(0,i)*Q[0]-N(n-1,i)*Q[m-1];*/
-      rk[i*istride]   = Q[i*istride]   - N[i] * Q[0] -
-	N[(n-1)*m+i] * Q[(m-1)*istride];
-
-      rk[i*istride+1] = Q[i*istride+1] - N[i] * Q[1] -
-	N[(n-1)*m+i] * Q[(m-1)*istride+1];
-
-      rk[i*istride+2] = Q[i*istride+2] - N[i] * Q[2] -
-	N[(n-1)*m+i] * Q[(m-1)*istride+2];
-    } /* for */
-
-  /* set up R */
-  for(i = 0; i < n; i++)
-    {
-      /*R[i*istride] = 0.0;*/
-      memset(&(R[i*istride]), 0, istride*sizeof(double));
-
-      for(j = 0; j < m; j++)
-	{
-	  /*R[i] += N(i,j)*rk[j] ;*/
-	  R[i*istride]   += N[i*m+j]*rk[j*istride];
-	  R[i*istride+1] += N[i*m+j]*rk[j*istride+1];
-	  R[i*istride+2] += N[i*m+j]*rk[j*istride+2];
-	}
-      /*
-      if(R[i*istride]   * R[i*istride]   < AY_EPSILON &&
-	 R[i*istride+1] * R[i*istride+1] < AY_EPSILON &&
-	 R[i*istride+2] * R[i*istride+2] < AY_EPSILON)
-	{
-	  ay_status = AY_ERROR;
-	  goto cleanup;
-	}
-      */
-    } /* for */
-
-  /* solve N^T*N*P = R */
-
-  if(n > 2)
+  if(!(pivot = malloc(n*sizeof(int))))
     {
-      if(!(Ns = calloc((n-2)*(m-2), sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-      if(!(Nt = calloc((m-2)*(n-2), sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-      if(!(NN = calloc((n-2)*(n-2), sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-      if(!(X = calloc((n-2)*istride, sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-
-      /* fill Ns & Nt */
-      a = 0;
-      for(i = 1; i < n-1; i++)
-	{
-	  for(j = 1; j < m-1; j++)
-	    {
-	      Ns[a] = N[i*m+j];
-	      a++;
-	    }
-	}
-      a = 0;
-      for(i = 1; i < m-1; i++)
-	{
-	  for(j = 1; j < n-1; j++)
-	    {
-	      Nt[a] = N[j*m+i];
-	      a++;
-	    }
-	}
-
-      /* do NN=N^T*N */
-      ay_act_multmatrixmn(m-2, n-2, Nt, Ns, NN);
-
-      /* solve the linear equation system NN*X=R */
-      ay_status = ay_act_solve(n-2, n-2, NN, &(R[istride]), X);
-
-      if(ay_status)
-	{ goto cleanup; }
+      ay_status = AY_EOMEM;
+      goto cleanup;
+    }
 
-      /* save results from X */
-      j = 0;
-      for(i = 1; i < n-1; i++)
-	{
-	  memcpy(&((*P)[i*ostride]), &(X[j*istride]), istride*sizeof(double));
-	  j++;
-	}
+  /* solve N^T*N*P = N^T*rk */
+  ay_status = ay_act_lsqfactor(m, n, p, /*clamped=*/1, ub, *U,
+			       spans, funs, NN, pivot);
 
-    } /* if */
+  if(ay_status)
+    { goto cleanup; }
 
-  /* first and last points are data points */
-  /*P[0] = Q[0];*/
-  memcpy(*P, Q, istride*sizeof(double));
-  /*P[n-1] = Q[m-1];*/
-  memcpy(&((*P)[(n-1)*ostride]), &(Q[(m-1)*istride]), istride*sizeof(double));
+  ay_act_lsqsolve(m, n, p, /*clamped=*/1, spans, funs, NN, pivot,
+		  Q, istride, R, *P, ostride);
 
   /* set weights */
   a = 3;
@@ -745,26 +289,17 @@ cleanup:
   if(R)
     free(R);
 
-  if(rk)
-    free(rk);
-
-  if(N)
-    free(N);
+  if(spans)
+    free(spans);
 
   if(funs)
     free(funs);
 
-  if(Ns)
-    free(Ns);
-
-  if(Nt)
-    free(Nt);
-
   if(NN)
     free(NN);
 
-  if(X)
-    free(X);
+  if(pivot)
+    free(pivot);
 
  return ay_status;
 } /* ay_act_leastSquares */
@@ -779,11 +314,10 @@ ay_act_leastSquaresClosed(double *Q, int m, int n, int p, int kt,
 			  double **U, double **P)
 {
  int ay_status = AY_OK;
- int a, i, j, istride = 3, ostride = 4, span;
+ int a, i, j, istride = 3, ostride = 4;
+ int *spans = NULL, *pivot = NULL;
  double d, *ub = NULL;
- double *Nt = NULL, *NN = NULL;
- double *R = NULL, *N = NULL, *X = NULL;
- double *funs = NULL, alpha;
+ double *NN = NULL, *R = NULL, *funs = NULL, alpha;
 
   if(!Q || !U || !P)
     return AY_ENULL;
@@ -849,115 +383,39 @@ ay_act_leastSquaresClosed(double *Q, int m, int n, int p, int kt,
       goto cleanup;
     }
 
-  /* Note well: N is nxm! (not mxn, as suggested by the NURBS book) */
-  if(!(N = calloc(n*m, sizeof(double))))
+  if(!(spans = malloc(m*sizeof(int))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  if(!(funs = calloc(p+1, sizeof(double))))
+  if(!(funs = malloc(m*(p+1)*sizeof(double))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  /* set up N */
-  for(i = 0; i < m; i++)
-    {
-      span = ay_nb_FindSpan(n, p, ub[i], &((*U)[p-1])/**U*/);
-
-      /* protect BasisFuns() from bad spans */
-      if(span >= n)
-	span = n-1;
-
-      memset(funs, 0, (p+1)*sizeof(double));
-      ay_nb_BasisFuns(span, ub[i], p, &((*U)[p-1])/**U*/, funs);
-
-      for(j = 0; j <= p; j++)
-	{
-	  a = (span-p+j)*m+i;
-	  N[a] = funs[j];
-	  /*
-	  if(isnan(N[a]))
-	  {
-	    ay_status = AY_ERROR; goto cleanup;
-	  }
-	  */
-	}
-    } /* for */
-
-  /* set up R */
-  for(i = 0; i < n; i++)
-    {
-      /*R[i*istride] = 0.0;*/
-      memset(&(R[i*istride]), 0, istride*sizeof(double));
-
-      for(j = 0; j < m; j++)
-	{
-	  /*R[i] += N(i,j)*Q[j] ;*/
-	  R[i*istride]   += N[i*m+j]*Q[j*istride];
-	  R[i*istride+1] += N[i*m+j]*Q[j*istride+1];
-	  R[i*istride+2] += N[i*m+j]*Q[j*istride+2];
-	}
-      /*
-      if(R[i*istride]   * R[i*istride]   < AY_EPSILON &&
-	 R[i*istride+1] * R[i*istride+1] < AY_EPSILON &&
-	 R[i*istride+2] * R[i*istride+2] < AY_EPSILON)
-	{
-	  ay_status = AY_ERROR;
-	  goto cleanup;
-	}
-      */
-    } /* for */
-
-  /* solve N^T*N*P = R */
-
-  if(!(Nt = calloc(m*n, sizeof(double))))
-    {
-      ay_status = AY_EOMEM;
-      goto cleanup;
-    }
-
-  if(!(NN = calloc(n*n, sizeof(double))))
+  if(!(NN = malloc(n*(3*p+1)*sizeof(double))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  /* fill Nt */
-  a = 0;
-  for(i = 0; i < m; i++)
-    {
-      for(j = 0; j < n; j++)
-	{
-	  Nt[a] = N[j*m+i];
-	  a++;
-	}
-    }
-
-  /* do NN=N^T*N */
-  ay_act_multmatrixmn(m, n, Nt, N, NN);
-
-  if(!(X = calloc(n*istride, sizeof(double))))
+  if(!(pivot = malloc(n*sizeof(int))))
     {
       ay_status = AY_EOMEM;
       goto cleanup;
     }
 
-  /* solve the linear equation system NN*X=R */
-  ay_status = ay_act_solve(n, n, NN, R, X);
+  /* solve N^T*N*P = N^T*Q */
+  ay_status = ay_act_lsqfactor(m, n, p, /*clamped=*/0, ub, &((*U)[p-1]),
+			       spans, funs, NN, pivot);
 
   if(ay_status)
     { goto cleanup; }
 
-  /* save results from X */
-  j = 0;
-  for(i = 0; i < n; i++)
-    {
-      memcpy(&((*P)[i*ostride]), &(X[j*istride]), istride*sizeof(double));
-      j++;
-    }
+  ay_act_lsqsolve(m, n, p, /*clamped=*/0, spans, funs, NN, pivot,
+		  Q, istride, R, *P, ostride);
 
   /* for the final operations we increase n again to the full output length */
   n += p;
@@ -992,20 +450,17 @@ cleanup:
   if(R)
     free(R);
 
-  if(N)
-    free(N);
+  if(spans)
+    free(spans);
 
   if(funs)
     free(funs);
 
-  if(Nt)
-    free(Nt);
-
   if(NN)
     free(NN);
 
-  if(X)
-    free(X);
+  if(pivot)
+    free(pivot);
 
  return ay_status;
 } /* ay_act_leastSquaresClosed */
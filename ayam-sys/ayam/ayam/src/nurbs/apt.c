@@ -294,26 +294,57 @@ cleanup:
 } /* ay_apt_createknots */
 
 
+/* the factorized least squares system of one approximation direction,
+   shared by all rows/columns of an APatch (see ay_act_lsqfactor()) */
 typedef struct ay_lsarrays {
- double *ub;
- double *Ns, *Nt, *NN;
- double *R, *rk, *N, *X;
- double *funs;
+ double *ub, *U;
+ int m, n, p, closed;
+ int *spans, *pivot;
+ double *funs, *NN, *R;
 } ay_lsarrays;
 
 
+/** ay_apt_freelsarrays:
+ * Free the memory of a factorized least squares system
+ * and prepare the arrays for a new setup.
+ *
+ * \param[in,out] lsa  least squares arrays to process
+ */
+void
+ay_apt_freelsarrays(ay_lsarrays *lsa)
+{
+
+  if(lsa->spans)
+    free(lsa->spans);
+  if(lsa->pivot)
+    free(lsa->pivot);
+  if(lsa->funs)
+    free(lsa->funs);
+  if(lsa->NN)
+    free(lsa->NN);
+  if(lsa->R)
+    free(lsa->R);
+
+  memset(lsa, 0, sizeof(ay_lsarrays));
+
+ return;
+} /* ay_apt_freelsarrays */
+
+
 /** ay_apt_leastSquares:
- *  approximate the data points in <Q[m>] with a NURBS curve of degree <p>
- *  with <n> control points, return results in <P>
+ * Approximate the data points in \a Q with a NURBS curve.
+ * The factorized normal equations are kept in \a lsa and re-used
+ * by all subsequent calls with the same parameters and knots.
  *
- * \param[in] Q  data points [Qstride*m]
+ * \param[in] Q  data points to approximate
  * \param[in] Qstride  size of a data point (3 or 4)
  * \param[in] Pstride  desired output point size (3 or 4)
  * \param[in] m  number of data points
  * \param[in] n  desired number of resulting points
  * \param[in] p  desired order
  * \param[in] closed  whether to create a closed curve
- * \param[in] lsa  unused
+ * \param[in,out] lsa  factorized system, shared by all calls that use
+ *  the same \a ub and \a U, must be freed with \a ay_apt_freelsarrays()
  * \param[in] ub  parameter vector (created by \a ay_apt_createknots())
  * \param[in] U  knot vector (created by \a ay_apt_createknots())
  * \param[in,out] P  where to store the result
@@ -326,12 +357,10 @@ ay_apt_leastSquares(double *Q, int Qstride, int Pstride,
 		    ay_lsarrays *lsa, double *ub, double *U, double **P)
 {
  int ay_status = AY_OK;
- int a, i, j, span;
- double *Ns = NULL, *Nt = NULL, *NN = NULL;
- double *R = NULL, *rk = NULL, *N = NULL, *X = NULL;
- double *funs = NULL;
+ int a, i, nn;
+ double *UU;
 
-  if(!Q || !U || !P)
+  if(!Q || !lsa || !U || !P)
     return AY_ENULL;
 
   if(closed)
@@ -354,293 +383,75 @@ ay_apt_leastSquares(double *Q, int Qstride, int Pstride,
 	}
     }
 
-  /* solve N^T*N*P = R */
-
   if(closed)
     {
-      /* closed */
-      /* the following section operates on a reduced number of output points
+      /* the system operates on a reduced number of output points
 	 since the last p output points will be equal to the first p output
 	 points anyway */
-      n -= p;
+      nn = n-p;
+      UU = &(U[p-1]);
+    }
+  else
+    {
+      nn = n;
+      UU = U;
+    }
 
-      if(!(R = calloc(n*3, sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
+  /* set up and factorize N^T*N (only once per direction) */
+  if(lsa->ub != ub || lsa->U != U || lsa->m != m || lsa->n != n ||
+     lsa->p != p || lsa->closed != closed)
+    {
+      ay_apt_freelsarrays(lsa);
 
-      /* Note well: N is nxm! (not mxn, as suggested by the NURBS book) */
-      if(!(N = calloc(n*m, sizeof(double))))
+      if(!(lsa->spans = malloc(m*sizeof(int))))
 	{
 	  ay_status = AY_EOMEM;
 	  goto cleanup;
 	}
-
-      if(!(funs = calloc(p+1, sizeof(double))))
+      if(!(lsa->pivot = malloc(nn*sizeof(int))))
 	{
 	  ay_status = AY_EOMEM;
 	  goto cleanup;
 	}
-
-      /* set up N */
-      for(i = 0; i < m; i++)
-	{
-	  span = ay_nb_FindSpan(n, p, ub[i], &(U[p-1])/**U*/);
-
-	  /* protect BasisFuns() from bad spans */
-	  if(span >= n)
-	    span = n-1;
-
-	  memset(funs, 0, (p+1)*sizeof(double));
-	  ay_nb_BasisFuns(span, ub[i], p, &(U[p-1])/**U*/, funs);
-
-	  for(j = 0; j <= p; j++)
-	    {
-	      a = (span-p+j)*m+i;
-	      N[a] = funs[j];
-	      /*
-		if(isnan(N[a]))
-		{
-		ay_status = AY_ERROR; goto cleanup;
-		}
-	      */
-	    }
-	} /* for */
-
-      /* set up R */
-      for(i = 0; i < n; i++)
-	{
-	  /*R[i*Qstride] = 0.0;*/
-	  memset(&(R[i*3]), 0, 3*sizeof(double));
-
-	  for(j = 0; j < m; j++)
-	    {
-	      /*R[i] += N(i,j)*Q[j] ;*/
-	      R[i*3]   += N[i*m+j]*Q[j*Qstride];
-	      R[i*3+1] += N[i*m+j]*Q[j*Qstride+1];
-	      R[i*3+2] += N[i*m+j]*Q[j*Qstride+2];
-	    }
-	  /*
-	    if(R[i*3]   * R[i*3]   < AY_EPSILON &&
-	    R[i*3+1] * R[i*3+1] < AY_EPSILON &&
-	    R[i*3+2] * R[i*3+2] < AY_EPSILON)
-	    {
-	    ay_status = AY_ERROR;
-	    goto cleanup;
-	    }
-	  */
-	} /* for */
-
-      /* solve N^T*N*P = R */
-
-      if(!(Nt = calloc(m*n, sizeof(double))))
+      if(!(lsa->funs = malloc(m*(p+1)*sizeof(double))))
 	{
 	  ay_status = AY_EOMEM;
 	  goto cleanup;
 	}
-
-      if(!(NN = calloc(n*n, sizeof(double))))
+      if(!(lsa->NN = malloc(nn*(3*p+1)*sizeof(double))))
 	{
 	  ay_status = AY_EOMEM;
 	  goto cleanup;
 	}
-
-      /* fill Nt */
-      a = 0;
-      for(i = 0; i < m; i++)
-	{
-	  for(j = 0; j < n; j++)
-	    {
-	      Nt[a] = N[j*m+i];
-	      a++;
-	    }
-	}
-
-      /* do NN=N^T*N */
-      ay_act_multmatrixmn(m, n, Nt, N, NN);
-
-      if(!(X = calloc(n*3, sizeof(double))))
+      if(!(lsa->R = malloc(nn*3*sizeof(double))))
 	{
 	  ay_status = AY_EOMEM;
 	  goto cleanup;
 	}
 
-      /* solve the linear equation system NN*X=R */
-      ay_status = ay_act_solve(n, n, NN, R, X);
-
+      ay_status = ay_act_lsqfactor(m, nn, p, !closed, ub, UU,
+				   lsa->spans, lsa->funs, lsa->NN,
+				   lsa->pivot);
       if(ay_status)
-	{ goto cleanup; }
+	goto cleanup;
 
-      /* save results from X */
-      j = 0;
-      for(i = 0; i < n; i++)
-	{
-	  memcpy(&((*P)[i*Pstride]), &(X[j*3]), 3*sizeof(double));
-	  j++;
-	}
-      /* for the final operations we increase n again to the full
-	 output length */
-      n += p;
+      lsa->ub = ub;
+      lsa->U = U;
+      lsa->m = m;
+      lsa->n = n;
+      lsa->p = p;
+      lsa->closed = closed;
+    } /* if */
+
+  /* solve N^T*N*P = R */
+  ay_act_lsqsolve(m, nn, p, !closed, lsa->spans, lsa->funs, lsa->NN,
+		  lsa->pivot, Q, Qstride, lsa->R, *P, Pstride);
 
+  if(closed)
+    {
       /* copy the periodic points */
       memcpy(&((*P)[(n-p)*Pstride]), *P, p*Pstride*sizeof(double));
     }
-  else
-    {
-      /* open */
-
-      if(!(R = calloc(n*3, sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-
-      if(!(rk = calloc(m*3, sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-
-      /* Note well: N is nxm! (not mxn, as suggested by the NURBS book) */
-      if(!(N = calloc(n*m, sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-
-      if(!(funs = calloc(p+1, sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-
-      /* set up N and rk */
-      for(i = 0; i < m; i++)
-	{
-	  span = ay_nb_FindSpan(n, p, ub[i], U);
-
-	  /* protect BasisFuns() from bad spans */
-	  if(span >= n)
-	    span = n-1;
-
-	  memset(funs, 0, (p+1)*sizeof(double));
-	  ay_nb_BasisFuns(span, ub[i], p, U, funs);
-
-	  for(j = 0; j <= p; j++)
-	    {
-	      a = (span-p+j)*m+i;
-	      N[a] = funs[j];
-	      /*
-		if(isnan(N[a]))
-		{
-		ay_status = AY_ERROR; goto cleanup;
-		}
-	      */
-	    }
-
-	  /*rk[i] = Q[i]-N(0,i)*Q[0]-N(n-1,i)*Q[m-1];*/
-	  rk[i*3]   = Q[i*Qstride]   - N[i] * Q[0] -
-	    N[(n-1)*m+i] * Q[(m-1)*Qstride];
-
-	  rk[i*3+1] = Q[i*Qstride+1] - N[i] * Q[1] -
-	    N[(n-1)*m+i] * Q[(m-1)*Qstride+1];
-
-	  rk[i*3+2] = Q[i*Qstride+2] - N[i] * Q[2] -
-	    N[(n-1)*m+i] * Q[(m-1)*Qstride+2];
-	} /* for */
-
-      /* set up R */
-      for(i = 0; i < n; i++)
-	{
-	  /*R[i*3] = 0.0;*/
-	  memset(&(R[i*3]), 0, 3*sizeof(double));
-
-	  for(j = 0; j < m; j++)
-	    {
-	      /*R[i] += N(i,j)*rk[j] ;*/
-	      R[i*3]   += N[i*m+j]*rk[j*3];
-	      R[i*3+1] += N[i*m+j]*rk[j*3+1];
-	      R[i*3+2] += N[i*m+j]*rk[j*3+2];
-	    }
-	  /*
-	    if(R[i*3]   * R[i*3]   < AY_EPSILON &&
-	    R[i*3+1] * R[i*3+1] < AY_EPSILON &&
-	    R[i*3+2] * R[i*3+2] < AY_EPSILON)
-	    {
-	    ay_status = AY_ERROR;
-	    goto cleanup;
-	    }
-	  */
-	} /* for */
-
-      if(n > 2)
-	{
-	  if(!(Ns = calloc((n-2)*(m-2), sizeof(double))))
-	    {
-	      ay_status = AY_EOMEM;
-	      goto cleanup;
-	    }
-	  if(!(Nt = calloc((m-2)*(n-2), sizeof(double))))
-	    {
-	      ay_status = AY_EOMEM;
-	      goto cleanup;
-	    }
-	  if(!(NN = calloc((n-2)*(n-2), sizeof(double))))
-	    {
-	      ay_status = AY_EOMEM;
-	      goto cleanup;
-	    }
-	  if(!(X = calloc((n-2)*3, sizeof(double))))
-	    {
-	      ay_status = AY_EOMEM;
-	      goto cleanup;
-	    }
-
-	  /* fill Ns & Nt */
-	  a = 0;
-	  for(i = 1; i < n-1; i++)
-	    {
-	      for(j = 1; j < m-1; j++)
-		{
-		  Ns[a] = N[i*m+j];
-		  a++;
-		}
-	    }
-	  a = 0;
-	  for(i = 1; i < m-1; i++)
-	    {
-	      for(j = 1; j < n-1; j++)
-		{
-		  Nt[a] = N[j*m+i];
-		  a++;
-		}
-	    }
-
-	  /* do NN=N^T*N */
-	  ay_act_multmatrixmn(m-2, n-2, Nt, Ns, NN);
-
-	  /* solve the linear equation system NN*X=R */
-	  ay_status = ay_act_solve(n-2, n-2, NN, &(R[3]), X);
-
-	  if(ay_status)
-	    { goto cleanup; }
-
-	  /* save results from X */
-	  j = 0;
-	  for(i = 1; i < n-1; i++)
-	    {
-	      memcpy(&((*P)[i*Pstride]), &(X[j*3]), 3*sizeof(double));
-	      j++;
-	    }
-	} /* if */
-
-      /* first and last points are data points */
-      /*P[0] = Q[0];*/
-      memcpy(*P, Q, 3*sizeof(double));
-      /*P[n-1] = Q[m-1];*/
-      memcpy(&((*P)[(n-1)*Pstride]), &(Q[(m-1)*Qstride]), 3*sizeof(double));
-    } /* if */
 
   /* set weights */
   if(Pstride > 3)
@@ -657,35 +468,13 @@ cleanup:
 
   if(ay_status)
     {
+      ay_apt_freelsarrays(lsa);
+
       if(*P)
 	free(*P);
       *P = NULL;
     }
 
-  if(R)
-    free(R);
-
-  if(rk)
-    free(rk);
-
-  if(N)
-    free(N);
-
-  if(funs)
-    free(funs);
-
-  if(Ns)
-    free(Ns);
-
-  if(Nt)
-    free(Nt);
-
-  if(NN)
-    free(NN);
-
-  if(X)
-    free(X);
-
  return ay_status;
 } /* ay_apt_leastSquares */
 
@@ -787,6 +576,8 @@ ay_apt_approximateuv(double *cv, int width, int height,
       a += 3;
     }
 
+  ay_apt_freelsarrays(&lsa);
+
   free(mean);
   mean = NULL;
 
@@ -850,6 +641,8 @@ cleanup:
   if(ub)
     free(ub);
 
+  ay_apt_freelsarrays(&lsa);
+
  return ay_status;
 } /* ay_apt_approximateuv */
 
@@ -941,6 +734,8 @@ ay_apt_approximatevu(double *cv, int width, int height,
       a += height*3;
     }
 
+  ay_apt_freelsarrays(&lsa);
+
   free(mean);
   mean = NULL;
 
@@ -1012,6 +807,8 @@ cleanup:
   if(vb)
     free(vb);
 
+  ay_apt_freelsarrays(&lsa);
+
  return ay_status;
 } /* ay_apt_approximatevu */
 
@@ -1129,6 +926,8 @@ cleanup:
   if(Q)
     free(Q);
 
+  ay_apt_freelsarrays(&lsa);
+
  return ay_status;
 } /* ay_apt_approximateu */
 
@@ -1235,5 +1034,7 @@ cleanup:
   if(mean)
     free(mean);
 
+  ay_apt_freelsarrays(&lsa);
+
  return ay_status;
 } /* ay_apt_approximatev */
@@ -12,6 +12,20 @@
 
 #include "ayam.h"
 
+/* vector instructions for the batch evaluation kernels
+   (define AYNOSIMD to always use the scalar variants) */
+#ifndef AYNOSIMD
+#if defined(__AVX__)
+#include <immintrin.h>
+#define AY_NBAVX 1
+#else
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AY_NBSSE2 1
+#endif
+#endif
+#endif
+
 /* nb.c - various NURBS related functions */
 
 /*
@@ -33,6 +47,20 @@
  *   (weights not multiplied in).
  */
 
+/* access element (i, j) of a band matrix with kl sub-diagonals
+   stored by rows of width w (see ay_nb_BandLUDecompose()) */
+#define AY_NBBAND(A, w, kl, i, j) ((A)[(i)*(w)+(j)-(i)+(kl)])
+
+/* prototypes of functions local to this module */
+
+void ay_nb_Blend4(int cnt, double *N, double *P, double *R);
+
+void ay_nb_Axpy4(int cnt, double a, double *X, double *Y);
+
+double *ay_nb_Homogenize(int cnt, double *Pw, int is_rat);
+
+int ay_nb_FindSpanNear(int n, int p, double u, double *U, int span);
+
 
 /*
  * ay_nb_LUDecompose: (NURBS++)
@@ -202,83 +230,210 @@ ay_nb_LUInvert(int n, double *inv, int *pivot)
 } /* ay_nb_LUInvert */
 
 
+/*
+ * ay_nb_BandLUDecompose:
+ * LU decomposition with partial pivoting of the NxN band matrix A
+ * with kl sub- and ku super-diagonals;
+ * A is stored by rows, each row i holding the 2*kl+ku+1 elements
+ * of the columns i-kl to i+kl+ku (see AY_NBBAND), the additional kl
+ * super-diagonals receive the fill-in caused by pivoting;
+ * on return A contains U and the multipliers of L;
+ * pivot[N] has to be allocated outside and fed into
+ * ay_nb_BandLUSolve() below
+ */
+int
+ay_nb_BandLUDecompose(int N, int kl, int ku, double *A, int *pivot)
+{
+ int w = 2*kl+ku+1, i, j, k, p, last, lastc;
+ double m, t, l;
+
+  for(k = 0; k < N; k++)
+    {
+      last = k+kl;
+      if(last > N-1)
+	last = N-1;
+      lastc = k+kl+ku;
+      if(lastc > N-1)
+	lastc = N-1;
+
+      /* find pivot */
+      p = k;
+      m = fabs(AY_NBBAND(A, w, kl, k, k));
+      for(i = k+1; i <= last; i++)
+	{
+	  t = fabs(AY_NBBAND(A, w, kl, i, k));
+	  if(t > m)
+	    {
+	      m = t;
+	      p = i;
+	    }
+	}
+
+      pivot[k] = p;
+
+      if(m == 0.0)
+	return AY_ERROR;
+
+      if(p != k)
+	{
+	  for(j = k; j <= lastc; j++)
+	    {
+	      t = AY_NBBAND(A, w, kl, k, j);
+	      AY_NBBAND(A, w, kl, k, j) = AY_NBBAND(A, w, kl, p, j);
+	      AY_NBBAND(A, w, kl, p, j) = t;
+	    }
+	}
+
+      /* eliminate */
+      for(i = k+1; i <= last; i++)
+	{
+	  l = AY_NBBAND(A, w, kl, i, k) / AY_NBBAND(A, w, kl, k, k);
+	  AY_NBBAND(A, w, kl, i, k) = l;
+	  if(l != 0.0)
+	    {
+	      for(j = k+1; j <= lastc; j++)
+		AY_NBBAND(A, w, kl, i, j) -= l * AY_NBBAND(A, w, kl, k, j);
+	    }
+	}
+    } /* for */
+
+ return AY_OK;
+} /* ay_nb_BandLUDecompose */
+
+
+/*
+ * ay_nb_BandLUSolve:
+ * solve A*X=B for the NxN band matrix A, decomposed by
+ * ay_nb_BandLUDecompose() above, and nrhs right hand sides
+ * in B[N*nrhs] (stored by rows); B is overwritten with X;
+ * a decomposed matrix may be used for any number of solves
+ */
+void
+ay_nb_BandLUSolve(int N, int kl, int ku, double *A, int *pivot,
+		  int nrhs, double *B)
+{
+ int w = 2*kl+ku+1, i, j, k, p, last;
+ double l, t, *bk, *bi;
+
+  /* forward substitution (L) */
+  for(k = 0; k < N; k++)
+    {
+      bk = &(B[k*nrhs]);
+      p = pivot[k];
+      if(p != k)
+	{
+	  bi = &(B[p*nrhs]);
+	  for(j = 0; j < nrhs; j++)
+	    {
+	      t = bk[j];
+	      bk[j] = bi[j];
+	      bi[j] = t;
+	    }
+	}
+      last = k+kl;
+      if(last > N-1)
+	last = N-1;
+      for(i = k+1; i <= last; i++)
+	{
+	  l = AY_NBBAND(A, w, kl, i, k);
+	  if(l != 0.0)
+	    {
+	      bi = &(B[i*nrhs]);
+	      for(j = 0; j < nrhs; j++)
+		bi[j] -= l * bk[j];
+	    }
+	}
+    } /* for */
+
+  /* backward substitution (U) */
+  for(k = N-1; k >= 0; k--)
+    {
+      bk = &(B[k*nrhs]);
+      last = k+kl+ku;
+      if(last > N-1)
+	last = N-1;
+      for(i = k+1; i <= last; i++)
+	{
+	  l = AY_NBBAND(A, w, kl, k, i);
+	  if(l != 0.0)
+	    {
+	      bi = &(B[i*nrhs]);
+	      for(j = 0; j < nrhs; j++)
+		bk[j] -= l * bi[j];
+	    }
+	}
+      l = AY_NBBAND(A, w, kl, k, k);
+      for(j = 0; j < nrhs; j++)
+	bk[j] /= l;
+    } /* for */
+
+ return;
+} /* ay_nb_BandLUSolve */
+
+
 /*
  * ay_nb_GlobalInterpolation4D: (NURBS++)
  * interpolate the n+1 4D points in Q[] with
  * n+1 precalculated parametric values in ub[]
  * and n+d+1 knots in Uc[] with desired degree d (d <= n!)
+ * the collocation matrix is banded, hence the system is solved
+ * via banded LU decomposition in O(n*d^2)
  */
 int
 ay_nb_GlobalInterpolation4D(int n, double *Q, double *ub, double *Uc, int d)
 {
  int ay_status = AY_OK;
- int i, j, k, span, ind, *pivot = NULL;
- double t, *A = NULL, *U, *N = NULL;
- double *qq = NULL, *xx = NULL;
-
-  if(!(A = calloc((n+1)*(n+1), sizeof(double))))
-    return AY_EOMEM;
-
-  if(!(N = calloc((d+1), sizeof(double))))
-    { ay_status = AY_EOMEM; goto cleanup; }
+ int i, j, w, kl = 0, ku = 0, *span = NULL, *pivot = NULL;
+ double *A = NULL, *U, *N = NULL;
 
-  if(!(qq = calloc((n+1)*4, sizeof(double))))
+  if(!(N = malloc((n+1)*(d+1)*sizeof(double))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
-  if(!(xx = calloc((n+1)*4, sizeof(double))))
+  if(!(span = malloc((n+1)*sizeof(int))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
-  if(!(pivot = calloc(n+1, sizeof(int))))
+  if(!(pivot = malloc((n+1)*sizeof(int))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
   U = Uc;
 
-  /* Fill A */
+  /* calculate the basis functions of all rows
+     and the bandwidth of the matrix */
   for(i = 1; i < n; i++)
     {
-      span = ay_nb_FindSpan(n, d, ub[i], U);
-      ay_status = ay_nb_BasisFuns(span, ub[i], d, U, N);
+      span[i] = ay_nb_FindSpan(n, d, ub[i], U);
+      ay_status = ay_nb_BasisFuns(span[i], ub[i], d, U, &(N[i*(d+1)]));
       if(ay_status)
-	{ free(A); free(N); free(qq); free(xx); free(pivot); return ay_status; }
+	{ goto cleanup; }
+      if(i - (span[i]-d) > kl)
+	kl = i - (span[i]-d);
+      if(span[i] - i > ku)
+	ku = span[i] - i;
+    }
+
+  /* Fill A */
+  w = 2*kl+ku+1;
+  if(!(A = calloc((n+1)*w, sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  for(i = 1; i < n; i++)
+    {
       for(j = 0; j <= d; j++)
 	{
-	  ind = (i*(n+1)) + (span-d+j);
-	  A[ind] = N[j];
+	  AY_NBBAND(A, w, kl, i, span[i]-d+j) = N[i*(d+1)+j];
 	}
     }
 
-  A[0] = 1.0;
-  A[n*(n+1)+n] = 1.0;
-
-  ay_status = ay_nb_LUDecompose(n+1, A, pivot);
-
-  if(ay_status)
-    { goto cleanup; }
+  AY_NBBAND(A, w, kl, 0, 0) = 1.0;
+  AY_NBBAND(A, w, kl, n, n) = 1.0;
 
-  ay_status = ay_nb_LUInvert(n+1, A, pivot);
+  ay_status = ay_nb_BandLUDecompose(n+1, kl, ku, A, pivot);
 
   if(ay_status)
     { goto cleanup; }
 
-  /* Init matrix for LSE */
-  memcpy(qq, Q, (n+1)*4*sizeof(double));
-
-  /* Multiply through: xx = A(^-1)*qq */
-  for(i = 0; i < (n+1); i++)
-    {
-      for(j = 0; j < 4; j++)
-	{
-	  t = 0.0;
-	  for(k = 0; k < (n+1); k++)
-	    {
-	      t += (A[i*(n+1)+k] * qq[k*4+j]);
-	    }
-	  xx[i*4+j] = t;
-	}
-    }
-
-  /* Store the results */
-  memcpy(Q, xx, (n+1)*4*sizeof(double));
+  /* Solve, this stores the results in Q */
+  ay_nb_BandLUSolve(n+1, kl, ku, A, pivot, 4, Q);
 
 cleanup:
 
@@ -286,10 +441,8 @@ cleanup:
     free(A);
   if(N)
     free(N);
-  if(qq)
-    free(qq);
-  if(xx)
-    free(xx);
+  if(span)
+    free(span);
   if(pivot)
     free(pivot);
 
@@ -305,101 +458,85 @@ cleanup:
  * and end derivatives D1 (start) and D2 (end)
  * Q has to be of size n+3 and filled sparsely:
  * P[0],,P[1],...,P[n-1],,P[n]!
+ * the system is solved via banded LU decomposition in O(n*d^2)
  */
 int
 ay_nb_GlobalInterpolation4DD(int n, double *Q, double *ub, double *Uc, int d,
 			     double *D1, double *D2)
 {
  int ay_status = AY_OK;
- int i, j, k, span, ind, *pivot = NULL;
- double t, *A = NULL, *U, *N = NULL;
- double *qq = NULL, *xx = NULL;
-
-  if(!(A = calloc((n+3)*(n+3), sizeof(double))))
-    return AY_EOMEM;
-
-  if(!(N = calloc((d+1), sizeof(double))))
-    { ay_status = AY_EOMEM; goto cleanup; }
+ int i, j, k, w, kl = 1, ku = 1, *span = NULL, *pivot = NULL;
+ double *A = NULL, *U, *N = NULL;
 
-  if(!(qq = calloc((n+3)*4, sizeof(double))))
+  if(!(N = malloc((n+3)*(d+1)*sizeof(double))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
-  if(!(xx = calloc((n+3)*4, sizeof(double))))
+  if(!(span = malloc((n+3)*sizeof(int))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
-  if(!(pivot = calloc(n+3, sizeof(int))))
+  if(!(pivot = malloc((n+3)*sizeof(int))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
   U = Uc;
 
-  /* Fill A */
+  /* calculate the basis functions of all rows
+     and the bandwidth of the matrix */
   k = 1;
   for(i = 2; i < n+1; i++)
     {
-      span = ay_nb_FindSpan(n+2, d, ub[k], U);
+      span[i] = ay_nb_FindSpan(n+2, d, ub[k], U);
 
-      ay_status = ay_nb_BasisFuns(span, ub[k], d, U, N);
+      ay_status = ay_nb_BasisFuns(span[i], ub[k], d, U, &(N[i*(d+1)]));
 
       if(ay_status)
 	{ goto cleanup; }
 
-      for(j = 0; j <= d; j++)
-	{
-	  ind = (i*(n+3)) + (span-d+j);
-	  A[ind] = N[j];
-	}
+      if(i - (span[i]-d) > kl)
+	kl = i - (span[i]-d);
+      if(span[i] - i > ku)
+	ku = span[i] - i;
       k++;
     }
 
-  A[0] = 1.0;
-  A[(n+3)] = -1.0;
-  A[(n+3)+1] = 1.0;
+  /* Fill A */
+  w = 2*kl+ku+1;
+  if(!(A = calloc((n+3)*w, sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
 
-  A[((n+3)*(n+3))-1-(n+3)-1] = -1.0;
-  A[((n+3)*(n+3))-1-(n+3)] = 1.0;
-  A[((n+3)*(n+3))-1] = 1.0;
+  for(i = 2; i < n+1; i++)
+    {
+      for(j = 0; j <= d; j++)
+	{
+	  AY_NBBAND(A, w, kl, i, span[i]-d+j) = N[i*(d+1)+j];
+	}
+    }
 
-  ay_status = ay_nb_LUDecompose(n+3, A, pivot);
+  AY_NBBAND(A, w, kl, 0, 0) = 1.0;
+  AY_NBBAND(A, w, kl, 1, 0) = -1.0;
+  AY_NBBAND(A, w, kl, 1, 1) = 1.0;
 
-  if(ay_status)
-    { goto cleanup; }
+  AY_NBBAND(A, w, kl, n+1, n+1) = -1.0;
+  AY_NBBAND(A, w, kl, n+1, n+2) = 1.0;
+  AY_NBBAND(A, w, kl, n+2, n+2) = 1.0;
 
-  ay_status = ay_nb_LUInvert(n+3, A, pivot);
+  ay_status = ay_nb_BandLUDecompose(n+3, kl, ku, A, pivot);
 
   if(ay_status)
     { goto cleanup; }
 
-  /* Init matrix for LSE */
-  memcpy(qq,Q,(n+3)*4*sizeof(double));
-
   /* Insert Derivatives */
-  qq[4] = /*(U[d+1]/d)**/D1[0];
-  qq[5] = /*(U[d+1]/d)**/D1[1];
-  qq[6] = /*(U[d+1]/d)**/D1[2];
-  qq[7] = 1.0;
+  Q[4] = /*(U[d+1]/d)**/D1[0];
+  Q[5] = /*(U[d+1]/d)**/D1[1];
+  Q[6] = /*(U[d+1]/d)**/D1[2];
+  Q[7] = 1.0;
   /*ind = n+2;*/
-  qq[(n+1)*4] = /*((1.0-U[ind])/d)**/D2[0];
-  qq[((n+1)*4)+1] = /*((1.0-U[ind])/d)**/D2[1];
-  qq[((n+1)*4)+2] = /*((1.0-U[ind])/d)**/D2[2];
-  qq[((n+1)*4)+3] = 1.0;
+  Q[(n+1)*4] = /*((1.0-U[ind])/d)**/D2[0];
+  Q[((n+1)*4)+1] = /*((1.0-U[ind])/d)**/D2[1];
+  Q[((n+1)*4)+2] = /*((1.0-U[ind])/d)**/D2[2];
+  Q[((n+1)*4)+3] = 1.0;
 
-
-  /* Multiply through: xx = A(^-1)*qq */
-  for(i = 0; i < (n+3); i++)
-    {
-      for(j = 0; j < 4; j++)
-	{
-	  t = 0.0;
-	  for(k = 0; k < (n+3); k++)
-	    {
-	      t += (A[i*(n+3)+k] * qq[k*4+j]);
-	    }
-	  xx[i*4+j] = t;
-	}
-    }
-
-  /* Store the results */
-  memcpy(Q,xx,(n+3)*4*sizeof(double));
+  /* Solve, this stores the results in Q */
+  ay_nb_BandLUSolve(n+3, kl, ku, A, pivot, 4, Q);
 
   j = 3;
   for(i = 0; i < (n+3); i++)
@@ -414,10 +551,8 @@ cleanup:
     free(A);
   if(N)
     free(N);
-  if(qq)
-    free(qq);
-  if(xx)
-    free(xx);
+  if(span)
+    free(span);
   if(pivot)
     free(pivot);
 
@@ -2743,6 +2878,388 @@ ay_nb_FirstDerSurf3DM(int n, int m, int p, int q, double *U, double *V,
 } /* ay_nb_FirstDerSurf3DM */
 
 
+/*
+ * ay_nb_Blend4:
+ * calculate the weighted sum R[4] of <cnt> consecutive
+ * 4D points P[cnt*4] using the weights N[cnt]
+ */
+void
+ay_nb_Blend4(int cnt, double *N, double *P, double *R)
+{
+ int k;
+#ifdef AY_NBAVX
+ __m256d acc = _mm256_setzero_pd();
+
+  for(k = 0; k < cnt; k++)
+    {
+      acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_set1_pd(N[k]),
+					     _mm256_loadu_pd(P)));
+      P += 4;
+    }
+  _mm256_storeu_pd(R, acc);
+#else
+#ifdef AY_NBSSE2
+ __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd(), w;
+
+  for(k = 0; k < cnt; k++)
+    {
+      w = _mm_set1_pd(N[k]);
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(w, _mm_loadu_pd(P)));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(w, _mm_loadu_pd(P+2)));
+      P += 4;
+    }
+  _mm_storeu_pd(R, acc0);
+  _mm_storeu_pd(R+2, acc1);
+#else
+ double r0 = 0.0, r1 = 0.0, r2 = 0.0, r3 = 0.0;
+
+  for(k = 0; k < cnt; k++)
+    {
+      r0 += N[k]*P[0];
+      r1 += N[k]*P[1];
+      r2 += N[k]*P[2];
+      r3 += N[k]*P[3];
+      P += 4;
+    }
+  R[0] = r0;
+  R[1] = r1;
+  R[2] = r2;
+  R[3] = r3;
+#endif
+#endif
+
+ return;
+} /* ay_nb_Blend4 */
+
+
+/*
+ * ay_nb_Axpy4:
+ * add <a> times the <cnt> consecutive 4D points X[cnt*4]
+ * to the 4D points Y[cnt*4]
+ */
+void
+ay_nb_Axpy4(int cnt, double a, double *X, double *Y)
+{
+ int k;
+#ifdef AY_NBAVX
+ __m256d va = _mm256_set1_pd(a);
+
+  for(k = 0; k < cnt; k++)
+    {
+      _mm256_storeu_pd(Y, _mm256_add_pd(_mm256_loadu_pd(Y),
+				      _mm256_mul_pd(va, _mm256_loadu_pd(X))));
+      X += 4;
+      Y += 4;
+    }
+#else
+#ifdef AY_NBSSE2
+ __m128d va = _mm_set1_pd(a);
+
+  for(k = 0; k < cnt; k++)
+    {
+      _mm_storeu_pd(Y, _mm_add_pd(_mm_loadu_pd(Y),
+				  _mm_mul_pd(va, _mm_loadu_pd(X))));
+      _mm_storeu_pd(Y+2, _mm_add_pd(_mm_loadu_pd(Y+2),
+				    _mm_mul_pd(va, _mm_loadu_pd(X+2))));
+      X += 4;
+      Y += 4;
+    }
+#else
+  for(k = 0; k < cnt; k++)
+    {
+      Y[0] += a*X[0];
+      Y[1] += a*X[1];
+      Y[2] += a*X[2];
+      Y[3] += a*X[3];
+      X += 4;
+      Y += 4;
+    }
+#endif
+#endif
+
+ return;
+} /* ay_nb_Axpy4 */
+
+
+/*
+ * ay_nb_Homogenize:
+ * create a copy of the <cnt> 4D control points Pw[cnt*4] with
+ * the weights multiplied in (is_rat) or all weights set to 1.0
+ * (!is_rat), ready to be blended with ay_nb_Blend4()/ay_nb_Axpy4()
+ * returns NULL if memory is exhausted
+ */
+double *
+ay_nb_Homogenize(int cnt, double *Pw, int is_rat)
+{
+ double *Pwh, w;
+ int i, a = 0;
+
+  if(!(Pwh = malloc(cnt*4*sizeof(double))))
+    return NULL;
+
+  for(i = 0; i < cnt; i++)
+    {
+      if(is_rat)
+	{
+	  w = Pw[a+3];
+	  if(fabs(w) > AY_EPSILON)
+	    {
+	      Pwh[a]   = Pw[a]*w;
+	      Pwh[a+1] = Pw[a+1]*w;
+	      Pwh[a+2] = Pw[a+2]*w;
+	    }
+	  else
+	    {
+	      memcpy(&(Pwh[a]), &(Pw[a]), 3*sizeof(double));
+	    }
+	  Pwh[a+3] = w;
+	}
+      else
+	{
+	  memcpy(&(Pwh[a]), &(Pw[a]), 3*sizeof(double));
+	  Pwh[a+3] = 1.0;
+	}
+      a += 4;
+    } /* for */
+
+ return Pwh;
+} /* ay_nb_Homogenize */
+
+
+/*
+ * ay_nb_FindSpanNear:
+ * find the knot span of u like ay_nb_FindSpan() but start the
+ * search at the span <span> (which, e.g., is the span of the
+ * previous parameter value); this is much faster than a binary
+ * search for ordered or clustered parameter values
+ */
+int
+ay_nb_FindSpanNear(int n, int p, double u, double *U, int span)
+{
+
+  if(span < p || span > n)
+    return ay_nb_FindSpan(n, p, u, U);
+
+  if(u >= U[n+1])
+    return n;
+
+  if(u <= U[p])
+    return p;
+
+  while(span < n && u >= U[span+1])
+    span++;
+
+  while(span > p && u < U[span])
+    span--;
+
+ return span;
+} /* ay_nb_FindSpanNear */
+
+
+/*
+ * ay_nb_CurvePoints4D:
+ * calculate <npts> points on the NURBS curve (n, p, U, Pw) at the
+ * parametric values u[npts] (preferably, but not necessarily in
+ * ascending order) in C[npts*stride], and, if D is not NULL, the
+ * first derivatives in D[npts*stride];
+ * Pw are always 4D points (see above), the weights are only
+ * taken into account if is_rat is true;
+ * stride must be >= 3
+ * returns AY_OK on success
+ */
+int
+ay_nb_CurvePoints4D(int n, int p, double *U, double *Pw, int is_rat,
+		    int npts, double *u, int stride, double *C, double *D)
+{
+ int span = -1, i, k;
+ double *Pwh = NULL, *N = NULL, Cw[4], Dw[4];
+
+  if(!U || !Pw || !u || !C)
+    return AY_ENULL;
+
+  if(!(Pwh = ay_nb_Homogenize(n+1, Pw, is_rat)))
+    return AY_EOMEM;
+
+  if(!(N = malloc(((p+1)*(p+1)+6*(p+1))*sizeof(double))))
+    {
+      free(Pwh);
+      return AY_EOMEM;
+    }
+
+  for(i = 0; i < npts; i++)
+    {
+      span = ay_nb_FindSpanNear(n, p, u[i], U, span);
+      k = (span-p)*4;
+
+      if(D)
+	{
+	  ay_nb_DersBasisFunsM(span, u[i], p, 1, U, N);
+	  ay_nb_Blend4(p+1, N, &(Pwh[k]), Cw);
+	  ay_nb_Blend4(p+1, &(N[p+1]), &(Pwh[k]), Dw);
+	}
+      else
+	{
+	  ay_nb_BasisFunsM(span, u[i], p, U, N);
+	  ay_nb_Blend4(p+1, N, &(Pwh[k]), Cw);
+	}
+
+      C[0] = Cw[0]/Cw[3];
+      C[1] = Cw[1]/Cw[3];
+      C[2] = Cw[2]/Cw[3];
+
+      if(D)
+	{
+	  /* quotient rule: C' = (Cw' - w'C)/w */
+	  D[0] = (Dw[0]-Dw[3]*C[0])/Cw[3];
+	  D[1] = (Dw[1]-Dw[3]*C[1])/Cw[3];
+	  D[2] = (Dw[2]-Dw[3]*C[2])/Cw[3];
+	  D += stride;
+	}
+
+      C += stride;
+    } /* for */
+
+  free(N);
+  free(Pwh);
+
+ return AY_OK;
+} /* ay_nb_CurvePoints4D */
+
+
+/*
+ * ay_nb_SurfacePointsGrid4D:
+ * calculate the points of the NURBS surface (n, m, p, q, U, V, Pw)
+ * on the grid of parametric values u[nu] x v[nv] (preferably, but not
+ * necessarily in ascending order) in C[nu*nv*stride], and, if N is not
+ * NULL, the (not normalized) normals (Su x Sv) in N[nu*nv*stride];
+ * the results are stored in u major order, i.e. the point for u[a], v[b]
+ * is at C[(a*nv+b)*stride];
+ * the spans and basis functions are calculated only once per parameter
+ * value and all control points of a row are blended at once;
+ * Pw are always 4D points (see above), the weights are only taken into
+ * account if is_rat is true;
+ * stride must be >= 3, C and N may point into the same array
+ * (e.g. N = C+3 with stride 6)
+ * returns AY_OK on success
+ */
+int
+ay_nb_SurfacePointsGrid4D(int n, int m, int p, int q, double *U, double *V,
+			  double *Pw, int is_rat, int nu, double *u,
+			  int nv, double *v, int stride, double *C, double *N)
+{
+ int ay_status = AY_OK;
+ int a, b, i, span, nbu, nbv, *spansu = NULL, *spansv;
+ double *Pwh = NULL, *Nu = NULL, *Nv, *scratch, *R0, *R1, *Nua, *Nvb, *R;
+ double Sw[4], Suw[4], Svw[4], *S, Su[3], Sv[3], w;
+
+  if(!U || !V || !Pw || !u || !v || !C)
+    return AY_ENULL;
+
+  if(nu <= 0 || nv <= 0)
+    return AY_OK;
+
+  /* number of basis function values to store per parameter value */
+  nbu = 2*(p+1);
+  nbv = 2*(q+1);
+
+  if(!(Pwh = ay_nb_Homogenize((n+1)*(m+1), Pw, is_rat)))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  if(!(spansu = malloc((nu+nv)*sizeof(int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  spansv = spansu + nu;
+
+  i = (p > q)?p:q;
+  if(!(Nu = malloc((nu*nbu + nv*nbv + (i+1)*(i+1)+6*(i+1) +
+		    2*(m+1)*4)*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  Nv = Nu + nu*nbu;
+  scratch = Nv + nv*nbv;
+  R0 = scratch + (i+1)*(i+1)+6*(i+1);
+  R1 = R0 + (m+1)*4;
+
+  /* calculate spans and basis functions (and their first derivatives)
+     once for all parameter values */
+  span = -1;
+  for(a = 0; a < nu; a++)
+    {
+      span = ay_nb_FindSpanNear(n, p, u[a], U, span);
+      spansu[a] = span;
+      ay_nb_DersBasisFunsM(span, u[a], p, 1, U, scratch);
+      memcpy(&(Nu[a*nbu]), scratch, nbu*sizeof(double));
+    }
+
+  span = -1;
+  for(b = 0; b < nv; b++)
+    {
+      span = ay_nb_FindSpanNear(m, q, v[b], V, span);
+      spansv[b] = span;
+      ay_nb_DersBasisFunsM(span, v[b], q, 1, V, scratch);
+      memcpy(&(Nv[b*nbv]), scratch, nbv*sizeof(double));
+    }
+
+  for(a = 0; a < nu; a++)
+    {
+      /* blend the p+1 relevant rows of control points in u direction,
+	 R0 receives the row for the surface point, R1 the row for
+	 the derivative along u */
+      Nua = &(Nu[a*nbu]);
+      memset(R0, 0, 2*(m+1)*4*sizeof(double));
+      for(i = 0; i <= p; i++)
+	{
+	  R = &(Pwh[(spansu[a]-p+i)*(m+1)*4]);
+	  ay_nb_Axpy4(m+1, Nua[i], R, R0);
+	  if(N)
+	    ay_nb_Axpy4(m+1, Nua[p+1+i], R, R1);
+	}
+
+      for(b = 0; b < nv; b++)
+	{
+	  /* blend the q+1 relevant points of the rows in v direction */
+	  Nvb = &(Nv[b*nbv]);
+	  i = (spansv[b]-q)*4;
+	  ay_nb_Blend4(q+1, Nvb, &(R0[i]), Sw);
+
+	  S = &(C[(a*nv+b)*stride]);
+	  w = Sw[3];
+	  S[0] = Sw[0]/w;
+	  S[1] = Sw[1]/w;
+	  S[2] = Sw[2]/w;
+
+	  if(N)
+	    {
+	      ay_nb_Blend4(q+1, Nvb, &(R1[i]), Suw);
+	      ay_nb_Blend4(q+1, &(Nvb[q+1]), &(R0[i]), Svw);
+
+	      /* quotient rule: S' = (Sw' - w'S)/w */
+	      Su[0] = (Suw[0]-Suw[3]*S[0])/w;
+	      Su[1] = (Suw[1]-Suw[3]*S[1])/w;
+	      Su[2] = (Suw[2]-Suw[3]*S[2])/w;
+	      Sv[0] = (Svw[0]-Svw[3]*S[0])/w;
+	      Sv[1] = (Svw[1]-Svw[3]*S[1])/w;
+	      Sv[2] = (Svw[2]-Svw[3]*S[2])/w;
+
+	      R = &(N[(a*nv+b)*stride]);
+	      AY_V3CROSS(R, Su, Sv);
+	    } /* if */
+	} /* for */
+    } /* for */
+
+cleanup:
+
+  if(Pwh)
+    free(Pwh);
+
+  if(spansu)
+    free(spansu);
+
+  if(Nu)
+    free(Nu);
+
+ return ay_status;
+} /* ay_nb_SurfacePointsGrid4D */
+
+
 /*
  * ay_nb_SecondDerSurf3D:
  * compute the second derivatives of non-rational surface
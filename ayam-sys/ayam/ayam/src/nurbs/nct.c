@@ -21,12 +21,79 @@
 typedef void (ay_nct_gndcb) (char dir, ay_nurbcurve_object *nc,
 			     double *p, double **dp);
 
+/* Bezier segments of a curve for the intersection engine */
+typedef struct ay_nct_isbez_s {
+  int order; /* order of the segments */
+  int nseg; /* number of segments */
+  double *cv; /* homogeneous control points [nseg*order*4] */
+  double *u; /* parametric ranges of the segments [nseg+1] */
+  int nnodes; /* number of hierarchy nodes */
+  int *nodes; /* first, last segment, left, right child [nnodes*4] */
+  double *boxes; /* bounding boxes of the nodes [nnodes*6] */
+} ay_nct_isbez;
+
+/* state of the intersection engine */
+typedef struct ay_nct_isctx_s {
+  ay_nurbcurve_object *c[2]; /* the curves */
+  ay_nct_isbez bz[2]; /* their Bezier segments */
+  double tol; /* tolerance */
+  int pairs; /* number of segment pairs examined */
+  int overlaps; /* number of collinear flat segment pairs */
+  int status; /* first error */
+  int nres; /* number of results */
+  int ares; /* number of allocated results */
+  double *res; /* results [ares*AY_NCTISRESSTRIDE] */
+} ay_nct_isctx;
+
+/* maximum subdivision depth of the curve intersection */
+#define AY_NCTISMAXDEPTH 52
+
+/* maximum number of Bezier segment pairs examined by the curve
+   intersection (guards against overlapping curves) */
+#define AY_NCTISMAXPAIRS 1000000
+
+/* maximum number of collinear flat segment pairs before the curves
+   are considered overlapping (tangential intersections create only
+   a few of them) */
+#define AY_NCTISMAXOVERLAPS 256
+
+/* maximum number of Newton iterations of the curve intersection */
+#define AY_NCTISMAXITER 16
+
+/* parametric tolerance (relative to the domain) for the detection
+   of duplicate intersections */
+#define AY_NCTISPARTOL 1.0e-07
+
+/* parametric tolerance (relative to the domain) within which
+   intersections are merged, if the curves meet in between */
+#define AY_NCTISMERGETOL 1.0e-03
+
+/* number of doubles per result: u1, u2, x, y, z, distance */
+#define AY_NCTISRESSTRIDE 6
+
+#define AY_NCTISCLAMP01(x) ((x) < 0.0 ? 0.0 : ((x) > 1.0 ? 1.0 : (x)))
+
+/* data of the parallel evaluation of a trajectory for ay_nct_arrange() */
+typedef struct ay_nct_arrangejob_s {
+  ay_nurbcurve_object *tr; /* trajectory */
+  double *trcv; /* (transformed) control points of the trajectory */
+  unsigned int n; /* number of objects to arrange */
+  int rotate; /* calculate tangents? */
+  int chunk; /* number of objects per work item */
+  double *res; /* results: point and derivative [n*6] */
+} ay_nct_arrangejob;
+
+/* minimum number of objects arranged in parallel */
+#define AY_NCTMINPARARRANGE 256
+
 /* prototypes of functions local to this module: */
 int ay_nct_offsetsection(ay_object *o, double offset,
 			 ay_nurbcurve_object **nc);
 
 int ay_nct_splitdisc(ay_object *src, double u, ay_object **result);
 
+int ay_nct_arrangecb(void *data, int item, int thread);
+
 void ay_nct_gnd(char dir, ay_nurbcurve_object *nc, double *p,
 		double **dp);
 
@@ -36,6 +103,34 @@ void ay_nct_gndc(char dir, ay_nurbcurve_object *nc, double *p,
 void ay_nct_gndp(char dir, ay_nurbcurve_object *nc, double *p,
 		 double **dp);
 
+int ay_nct_isdecompose(ay_nurbcurve_object *nc, ay_nct_isbez *bz);
+
+void ay_nct_isfree(ay_nct_isbez *bz);
+
+void ay_nct_isbox(double *cv, int order, double *box);
+
+int ay_nct_isbvh(ay_nct_isbez *bz, int first, int last);
+
+int ay_nct_isoverlap(double *b1, double *b2, double tol);
+
+int ay_nct_isflat(double *cv, int order, double tol);
+
+int ay_nct_iscollinear(double *P, int op, double *Q, int oq, double tol);
+
+void ay_nct_issplit(double *cv, int order, double *left, double *right);
+
+double ay_nct_ischords(double *P, int op, double *Q, int oq,
+		       double *a, double *b);
+
+void ay_nct_ispolish(ay_nct_isctx *ctx, double s, double t);
+
+void ay_nct_isbezier(ay_nct_isctx *ctx, double *P, double s0, double s1,
+		     double *Q, double t0, double t1, int depth);
+
+void ay_nct_istraverse(ay_nct_isctx *ctx, int na, int nb);
+
+int ay_nct_iscompare(const void *a, const void *b);
+
 /* local variables: */
 char ay_nct_ncname[] = "NCurve";
 
@@ -5474,11 +5569,64 @@ ay_nct_fillgaps(int closed, int order, double tanlen, ay_object *curves)
 } /* ay_nct_fillgaps */
 
 
+/* ay_nct_arrangecb:
+ *  work callback of ay_nct_arrange(), evaluate the trajectory
+ *  (and its first derivative) for one chunk of objects
+ */
+int
+ay_nct_arrangecb(void *data, int item, int thread)
+{
+ int ay_status = AY_OK;
+ ay_nct_arrangejob *job = (ay_nct_arrangejob *)data;
+ ay_nurbcurve_object *tr = job->tr;
+ unsigned int i, a, b;
+ double u, p1[4], plen;
+
+  a = (unsigned int)item * job->chunk;
+  b = a + job->chunk;
+  if(b > job->n)
+    b = job->n;
+
+  plen = fabs(tr->knotv[tr->length] - tr->knotv[tr->order-1]);
+
+  for(i = a; i < b; i++)
+    {
+      if(tr->type == AY_CTOPEN)
+	{
+	  if(job->n > 1)
+	    u = tr->knotv[tr->order-1]+(((double)i/(job->n-1))*plen);
+	  else
+	    u = tr->knotv[tr->order-1];
+	}
+      else
+	{
+	  u = tr->knotv[tr->order-1]+(((double)i/job->n)*plen);
+	}
+
+      ay_status = ay_nb_CurvePoint4D(tr->length-1, tr->order-1, tr->knotv,
+				     job->trcv, u, p1);
+      if(ay_status)
+	return ay_status;
+
+      memcpy(&(job->res[i*6]), p1, 3*sizeof(double));
+
+      if(job->rotate)
+	ay_nb_FirstDer4D(tr->length-1, tr->order-1, tr->knotv,
+			 job->trcv, u, &(job->res[i*6+3]));
+    } /* for */
+
+ return AY_OK;
+} /* ay_nct_arrangecb */
+
+
 /* ay_nct_arrange:
  *  arrange objects in o along trajectory t (a NURBS curve);
  *  if rotate is AY_TRUE, additionally rotate all objects in
  *  o so that their local X axis is parallel to the curve
- *  points tangent
+ *  points tangent;
+ *  the trajectory is evaluated for many objects in parallel,
+ *  the rotations depend on each other and are accumulated in
+ *  order afterwards
  */
 int
 ay_nct_arrange(ay_object *o, ay_object *t, int rotate)
@@ -5486,12 +5634,12 @@ ay_nct_arrange(ay_object *o, ay_object *t, int rotate)
  int ay_status = AY_OK;
  ay_object *l;
  ay_nurbcurve_object *tr;
- int i = 0, a = 0, stride;
- double u, p1[4];
+ ay_nct_arrangejob job;
+ int i = 0, a = 0, stride, nchunks = 1;
+ double *p1, *T1;
  double T0[3] = {0.0,0.0,-1.0};
- double T1[3] = {0.0,0.0,0.0};
  double A[3] = {0.0,0.0,0.0};
- double len = 0.0, plen = 0.0;
+ double len = 0.0;
  double mtr[16];
  double *trcv = NULL, angle, quat[4], euler[3];
  unsigned int n = 0;
@@ -5533,7 +5681,26 @@ ay_nct_arrange(ay_object *o, ay_object *t, int rotate)
       trcv = tr->controlv;
     }
 
-  plen = fabs(tr->knotv[tr->length] - tr->knotv[tr->order-1]);
+  /* evaluate the trajectory for all objects */
+  if(!(job.res = calloc(n*6, sizeof(double))))
+    {
+      ay_status = AY_EOMEM;
+      goto cleanup;
+    }
+  job.tr = tr;
+  job.trcv = trcv;
+  job.n = n;
+  job.rotate = rotate;
+
+  /* use some more chunks than threads for a better load balance */
+  if(n >= AY_NCTMINPARARRANGE)
+    nchunks = ay_tp_getnumthreads()*4;
+  job.chunk = (n + nchunks - 1) / nchunks;
+  nchunks = (n + job.chunk - 1) / job.chunk;
+
+  ay_status = ay_tp_run(nchunks, ay_nct_arrangecb, &job);
+  if(ay_status)
+    goto cleanup;
 
   T0[0] = 1.0;
   T0[1] = 0.0;
@@ -5544,22 +5711,10 @@ ay_nct_arrange(ay_object *o, ay_object *t, int rotate)
 
   while(o)
     {
-      if(tr->type == AY_CTOPEN)
-	{
-	  if(n > 1)
-	    u = tr->knotv[tr->order-1]+(((double)i/(n-1))*plen);
-	  else
-	    u = tr->knotv[tr->order-1];
-	}
-      else
-	{
-	  u = tr->knotv[tr->order-1]+(((double)i/n)*plen);
-	}
-
-      /* calculate new translation */
-      ay_nb_CurvePoint4D(tr->length-1, tr->order-1, tr->knotv, trcv,
-			 u, p1);
+      p1 = &(job.res[i*6]);
+      T1 = &(job.res[i*6+3]);
 
+      /* set new translation */
       o->movx = p1[0];
       o->movy = p1[1];
       o->movz = p1[2];
@@ -5579,9 +5734,6 @@ ay_nct_arrange(ay_object *o, ay_object *t, int rotate)
 
       if(rotate)
 	{
-	  ay_nb_FirstDer4D(tr->length-1, tr->order-1, tr->knotv,
-			   trcv, u, T1);
-
 	  len = AY_V3LEN(T1);
 	  AY_V3SCAL(T1,(1.0/len));
 
@@ -5621,7 +5773,11 @@ ay_nct_arrange(ay_object *o, ay_object *t, int rotate)
       o = o->next;
     } /* while */
 
+cleanup:
   /* clean up */
+  if(job.res)
+    free(job.res);
+
   if(trcv != tr->controlv)
     free(trcv);
 
@@ -6184,178 +6340,941 @@ ay_nct_getcurvaturetcmd(ClientData clientData, Tcl_Interp *interp,
 } /* ay_nct_getcurvaturetcmd */
 
 
-/* ay_nct_intersect:
- *
+/* ay_nct_isdecompose:
+ *  decompose NURBS curve <nc> into homogeneous Bezier segments for
+ *  the intersection engine and build a bounding volume hierarchy
+ *  over the segments
  */
 int
-ay_nct_intersect(ay_nurbcurve_object *cu, ay_nurbcurve_object *cv,
-		 double *intersection)
+ay_nct_isdecompose(ay_nurbcurve_object *nc, ay_nct_isbez *bz)
 {
  int ay_status = AY_OK;
-#if 0
- double *bu = NULL, *bv = NULL; /* Bezier segment arrays */
- double *su, *sv;
- double cuminx, cumaxx, cvminx, cvmaxx;
- double cuminy, cumaxy, cvminy, cvmaxy;
- double cuminz, cumaxz, cvminz, cvmaxz;
- int nbu = 0, nbv = 0;
- int stride = 4, i, j, k, overlap;
-
-  if(!cu || !cv || !intersection)
-    return AY_ENULL;
+ ay_nurbcurve_object tc;
+ double w;
+ int i, j, a, stride = 4;
 
-  /* decompose both curves into Bezier segments */
-  if(!(bu = calloc(cu->order*stride, sizeof(double))))
-    return AY_EOMEM;
+  memset(bz, 0, sizeof(ay_nct_isbez));
 
-  ay_status = ay_nb_DecomposeCurve(4, cu->length, cu->order-1, cu->knotv,
-				   cu->controlv, &nbu, &bu);
+  /* work on a copy of control points and knots */
+  memcpy(&tc, nc, sizeof(ay_nurbcurve_object));
+  tc.controlv = NULL;
+  tc.knotv = NULL;
 
-  if(!(bv = calloc(cv->order*stride, sizeof(double))))
-    return AY_EOMEM;
+  if(!(tc.controlv = malloc(nc->length*stride*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  memcpy(tc.controlv, nc->controlv, nc->length*stride*sizeof(double));
 
-  ay_status = ay_nb_DecomposeCurve(4, cv->length, cv->order-1, cv->knotv,
-				   cv->controlv, &nbv, &bv);
-
-  /* find intersecting Bezier segments (use convex hull property to
-     exclude all pairs that cannot intersect) */
-  for(i = 0; i < nbu; i++)
-    {
-      /* get min/max of segment i in bu (X) */
-      su = &bu[i*stride];
-      cuminx = DBL_MAX;
-      cumaxx = DBL_MIN;
-      for(k = 0; k < cu->order; k++)
-	{
-	  if(*su < cuminx)
-	    cuminx = *su;
-	  if(*su > cumaxx)
-	    cumaxx = *su;
-	  su += stride;
-	}
-      /* get min/max of segment i in bu (Y) */
-      su = &bu[i*stride+1];
-      cuminy = DBL_MAX;
-      cumaxy = DBL_MIN;
-      for(k = 0; k < cu->order; k++)
-	{
-	  if(*su < cuminy)
-	    cuminy = *su;
-	  if(*su > cumaxy)
-	    cumaxy = *su;
-	  su += stride;
-	}
-      /* get min/max of segment i in bu (Z) */
-      su = &bu[i*stride+2];
-      cuminz = DBL_MAX;
-      cumaxz = DBL_MIN;
-      for(k = 0; k < cu->order; k++)
-	{
-	  if(*su < cuminz)
-	    cuminz = *su;
-	  if(*su > cumaxz)
-	    cumaxz = *su;
-	  su += stride;
-	}
-
-      /* now check against all segments in nbv */
-      for(j = 0; j < nbv; j++)
-	{
-	  overlap = AY_TRUE;
-	  /* get min/max of segment j in bv (Z) */
-	  sv = &bv[j*stride];
-	  cvminx = DBL_MAX;
-	  cvmaxx = DBL_MIN;
-	  for(k = 0; k < cv->order; k++)
-	    {
-	      if(*sv < cvminx)
-		cvminx = *su;
-	      if(*sv > cvmaxx)
-		cvmaxx = *sv;
-	      sv += stride;
-	    }
-	  if(!((cumaxx < cvminx)||(cvmaxx < cuminx)))
-	    {
-	      /* overlap in X => need to check Y */
-	      sv = &bv[j*stride+1];
-	      cvminy = DBL_MAX;
-	      cvmaxy = DBL_MIN;
-	      for(k = 0; k < cv->order; k++)
-		{
-		  if(*sv < cvminy)
-		    cvminy = *su;
-		  if(*sv > cvmaxy)
-		    cvmaxy = *sv;
-		  sv += stride;
-		}
-	      if(!((cumaxy < cvminy)||(cvmaxy < cuminy)))
-		{
-		  /* overlap in Y => need to check Z */
-		  sv = &bv[j*stride+2];
-		  cvminz = DBL_MAX;
-		  cvmaxz = DBL_MIN;
-		  for(k = 0; k < cv->order; k++)
-		    {
-		      if(*sv < cvminz)
-			cvminz = *su;
-		      if(*sv > cvmaxz)
-			cvmaxz = *sv;
-		      sv += stride;
-		    }
-		  if((cumaxz < cvminz)||(cvmaxz < cuminz))
-		    {
-		      /* no overlap in Z */
-		      overlap = AY_FALSE;
-		    }
-		}
-	      else
+  if(!(tc.knotv = malloc((nc->length+nc->order)*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  memcpy(tc.knotv, nc->knotv, (nc->length+nc->order)*sizeof(double));
+
+  if(!ay_knots_isclamped(/*side=*/0, tc.order, tc.knotv,
+			 tc.length+tc.order, AY_EPSILON))
+    {
+      ay_status = ay_nct_clamp(&tc, /*side=*/0);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  /* homogenize */
+  a = 0;
+  for(i = 0; i < tc.length; i++)
+    {
+      if(tc.is_rat)
+	{
+	  w = tc.controlv[a+3];
+	  tc.controlv[a]   *= w;
+	  tc.controlv[a+1] *= w;
+	  tc.controlv[a+2] *= w;
+	}
+      else
+	{
+	  tc.controlv[a+3] = 1.0;
+	}
+      a += stride;
+    } /* for */
+
+  /* decompose */
+  if(!(bz->cv = malloc(tc.order*stride*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  ay_status = ay_nb_DecomposeCurve(stride, tc.length-1, tc.order-1,
+				   tc.knotv, tc.controlv, &(bz->nseg),
+				   &(bz->cv));
+  if(ay_status)
+    goto cleanup;
+
+  bz->order = tc.order;
+
+  /* collect the parametric ranges of the segments */
+  if(!(bz->u = malloc((bz->nseg+1)*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  j = 0;
+  bz->u[0] = tc.knotv[tc.order-1];
+  for(i = tc.order; i <= tc.length && j < bz->nseg; i++)
+    {
+      if(tc.knotv[i] > bz->u[j])
+	{
+	  j++;
+	  bz->u[j] = tc.knotv[i];
+	}
+    }
+
+  if(j != bz->nseg)
+    { ay_status = AY_ERROR; goto cleanup; }
+
+  /* build the bounding volume hierarchy */
+  if(!(bz->nodes = malloc(2*bz->nseg*4*sizeof(int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  if(!(bz->boxes = malloc(2*bz->nseg*6*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  (void)ay_nct_isbvh(bz, 0, bz->nseg-1);
+
+cleanup:
+
+  if(tc.controlv)
+    free(tc.controlv);
+
+  if(tc.knotv)
+    free(tc.knotv);
+
+  if(ay_status)
+    ay_nct_isfree(bz);
+
+ return ay_status;
+} /* ay_nct_isdecompose */
+
+
+/* ay_nct_isfree:
+ *  free the Bezier segments and hierarchy of the intersection engine
+ */
+void
+ay_nct_isfree(ay_nct_isbez *bz)
+{
+
+  if(bz->cv)
+    free(bz->cv);
+
+  if(bz->u)
+    free(bz->u);
+
+  if(bz->nodes)
+    free(bz->nodes);
+
+  if(bz->boxes)
+    free(bz->boxes);
+
+  memset(bz, 0, sizeof(ay_nct_isbez));
+
+ return;
+} /* ay_nct_isfree */
+
+
+/* ay_nct_isbox:
+ *  calculate the bounding box (xmin, xmax, ymin, ymax, zmin, zmax)
+ *  of the homogeneous Bezier control points <cv> (which, for positive
+ *  weights, also bounds the curve)
+ */
+void
+ay_nct_isbox(double *cv, int order, double *box)
+{
+ int i, k;
+ double x;
+
+  for(k = 0; k < 3; k++)
+    {
+      box[k*2] = DBL_MAX;
+      box[k*2+1] = -DBL_MAX;
+    }
+
+  for(i = 0; i < order; i++)
+    {
+      for(k = 0; k < 3; k++)
+	{
+	  x = cv[k]/cv[3];
+	  if(x < box[k*2])
+	    box[k*2] = x;
+	  if(x > box[k*2+1])
+	    box[k*2+1] = x;
+	}
+      cv += 4;
+    }
+
+ return;
+} /* ay_nct_isbox */
+
+
+/* ay_nct_isbvh:
+ *  build the bounding volume hierarchy node for the Bezier segments
+ *  <first> to <last>, returns the index of the new node
+ */
+int
+ay_nct_isbvh(ay_nct_isbez *bz, int first, int last)
+{
+ int node, mid, l, r, k;
+ int *n;
+ double *box;
+
+  node = bz->nnodes;
+  bz->nnodes++;
+
+  n = &(bz->nodes[node*4]);
+  box = &(bz->boxes[node*6]);
+
+  n[0] = first;
+  n[1] = last;
+
+  if(first == last)
+    {
+      n[2] = -1;
+      n[3] = -1;
+      ay_nct_isbox(&(bz->cv[first*bz->order*4]), bz->order, box);
+    }
+  else
+    {
+      mid = (first+last)/2;
+      l = ay_nct_isbvh(bz, first, mid);
+      r = ay_nct_isbvh(bz, mid+1, last);
+      n[2] = l;
+      n[3] = r;
+      for(k = 0; k < 6; k += 2)
+	{
+	  box[k] = bz->boxes[l*6+k];
+	  if(bz->boxes[r*6+k] < box[k])
+	    box[k] = bz->boxes[r*6+k];
+	  box[k+1] = AY_MAX(bz->boxes[l*6+k+1], bz->boxes[r*6+k+1]);
+	}
+    } /* if */
+
+ return node;
+} /* ay_nct_isbvh */
+
+
+/* ay_nct_isoverlap:
+ *  check two bounding boxes for overlap (with tolerance)
+ */
+int
+ay_nct_isoverlap(double *b1, double *b2, double tol)
+{
+ int k;
+
+  for(k = 0; k < 3; k++)
+    {
+      if(b1[k*2+1] + tol < b2[k*2] || b2[k*2+1] + tol < b1[k*2])
+	return AY_FALSE;
+    }
+
+ return AY_TRUE;
+} /* ay_nct_isoverlap */
+
+
+/* ay_nct_isflat:
+ *  check whether all control points of the homogeneous Bezier
+ *  segment <cv> are within <tol> of the chord
+ */
+int
+ay_nct_isflat(double *cv, int order, double tol)
+{
+ double p0[3], p1[3], d[3], v[3], c[3], l, t;
+ int i;
+
+  p0[0] = cv[0]/cv[3];
+  p0[1] = cv[1]/cv[3];
+  p0[2] = cv[2]/cv[3];
+  i = (order-1)*4;
+  p1[0] = cv[i]/cv[i+3];
+  p1[1] = cv[i+1]/cv[i+3];
+  p1[2] = cv[i+2]/cv[i+3];
+
+  AY_V3SUB(d, p1, p0);
+  l = AY_V3DOT(d, d);
+
+  for(i = 1; i < order-1; i++)
+    {
+      v[0] = cv[i*4]/cv[i*4+3] - p0[0];
+      v[1] = cv[i*4+1]/cv[i*4+3] - p0[1];
+      v[2] = cv[i*4+2]/cv[i*4+3] - p0[2];
+      if(l > DBL_EPSILON)
+	{
+	  t = AY_V3DOT(v, d)/l;
+	  c[0] = v[0] - t*d[0];
+	  c[1] = v[1] - t*d[1];
+	  c[2] = v[2] - t*d[2];
+	}
+      else
+	{
+	  memcpy(c, v, 3*sizeof(double));
+	}
+      if(AY_V3DOT(c, c) > tol*tol)
+	return AY_FALSE;
+    } /* for */
+
+ return AY_TRUE;
+} /* ay_nct_isflat */
+
+
+/* ay_nct_iscollinear:
+ *  check whether the chords of two (flat) homogeneous Bezier segments
+ *  are collinear (within <tol>) and overlap substantially
+ */
+int
+ay_nct_iscollinear(double *P, int op, double *Q, int oq, double tol)
+{
+ double p0[3], q[2][3], d[3], v[3], l, t[2], lq;
+ int i;
+
+  p0[0] = P[0]/P[3]; p0[1] = P[1]/P[3]; p0[2] = P[2]/P[3];
+  i = (op-1)*4;
+  d[0] = P[i]/P[i+3] - p0[0];
+  d[1] = P[i+1]/P[i+3] - p0[1];
+  d[2] = P[i+2]/P[i+3] - p0[2];
+  l = AY_V3LEN(d);
+
+  i = (oq-1)*4;
+  q[0][0] = Q[0]/Q[3]; q[0][1] = Q[1]/Q[3]; q[0][2] = Q[2]/Q[3];
+  q[1][0] = Q[i]/Q[i+3]; q[1][1] = Q[i+1]/Q[i+3]; q[1][2] = Q[i+2]/Q[i+3];
+  AY_V3SUB(v, q[1], q[0]);
+  lq = AY_V3LEN(v);
+
+  if(l < 4.0*tol || lq < 4.0*tol)
+    return AY_FALSE;
+
+  for(i = 0; i < 2; i++)
+    {
+      AY_V3SUB(v, q[i], p0);
+      t[i] = AY_V3DOT(v, d)/l;
+      v[0] -= t[i]*d[0]/l;
+      v[1] -= t[i]*d[1]/l;
+      v[2] -= t[i]*d[2]/l;
+      if(AY_V3DOT(v, v) > 4.0*tol*tol)
+	return AY_FALSE;
+    }
+
+  /* length of the overlapping part of the chords */
+  if(t[0] > t[1])
+    {
+      l = t[0];
+      t[0] = t[1];
+      t[1] = l;
+      l = AY_V3LEN(d);
+    }
+  if(t[0] < 0.0)
+    t[0] = 0.0;
+  if(t[1] > l)
+    t[1] = l;
+
+  if((t[1] - t[0]) < 0.5*((l < lq)?l:lq))
+    return AY_FALSE;
+
+ return AY_TRUE;
+} /* ay_nct_iscollinear */
+
+
+/* ay_nct_issplit:
+ *  split the homogeneous Bezier segment <cv> in the middle
+ *  (de Casteljau) into <left> and <right>
+ */
+void
+ay_nct_issplit(double *cv, int order, double *left, double *right)
+{
+ int i, j, k;
+
+  memcpy(right, cv, order*4*sizeof(double));
+
+  for(i = 0; i < order; i++)
+    {
+      memcpy(&(left[i*4]), right, 4*sizeof(double));
+      for(j = 0; j < order-1-i; j++)
+	{
+	  for(k = 0; k < 4; k++)
+	    right[j*4+k] = 0.5*(right[j*4+k] + right[(j+1)*4+k]);
+	}
+    }
+
+ return;
+} /* ay_nct_issplit */
+
+
+/* ay_nct_ischords:
+ *  calculate the parameters <a> and <b> (in [0, 1]) of the closest
+ *  points of the chords of two (flat) homogeneous Bezier segments,
+ *  returns the distance of the closest points
+ */
+double
+ay_nct_ischords(double *P, int op, double *Q, int oq, double *a, double *b)
+{
+ double p0[3], p1[3], q0[3], q1[3], d1[3], d2[3], r[3], c1[3], c2[3];
+ double aa, e, f, c, bb, denom, s, t;
+ int i;
+
+  p0[0] = P[0]/P[3]; p0[1] = P[1]/P[3]; p0[2] = P[2]/P[3];
+  i = (op-1)*4;
+  p1[0] = P[i]/P[i+3]; p1[1] = P[i+1]/P[i+3]; p1[2] = P[i+2]/P[i+3];
+  q0[0] = Q[0]/Q[3]; q0[1] = Q[1]/Q[3]; q0[2] = Q[2]/Q[3];
+  i = (oq-1)*4;
+  q1[0] = Q[i]/Q[i+3]; q1[1] = Q[i+1]/Q[i+3]; q1[2] = Q[i+2]/Q[i+3];
+
+  AY_V3SUB(d1, p1, p0);
+  AY_V3SUB(d2, q1, q0);
+  AY_V3SUB(r, p0, q0);
+  aa = AY_V3DOT(d1, d1);
+  e = AY_V3DOT(d2, d2);
+  f = AY_V3DOT(d2, r);
+
+  /* closest points of two segments, see Ericson:
+     "Real-Time Collision Detection", 5.1.9 */
+  if(aa <= DBL_EPSILON && e <= DBL_EPSILON)
+    {
+      s = 0.0;
+      t = 0.0;
+    }
+  else
+    if(aa <= DBL_EPSILON)
+      {
+	s = 0.0;
+	t = AY_NCTISCLAMP01(f/e);
+      }
+    else
+      {
+	c = AY_V3DOT(d1, r);
+	if(e <= DBL_EPSILON)
+	  {
+	    t = 0.0;
+	    s = AY_NCTISCLAMP01(-c/aa);
+	  }
+	else
+	  {
+	    bb = AY_V3DOT(d1, d2);
+	    denom = aa*e - bb*bb;
+	    if(denom > DBL_EPSILON*aa*e)
+	      s = AY_NCTISCLAMP01((bb*f - c*e)/denom);
+	    else
+	      s = 0.5;
+	    t = (bb*s + f)/e;
+	    if(t < 0.0)
+	      {
+		t = 0.0;
+		s = AY_NCTISCLAMP01(-c/aa);
+	      }
+	    else
+	      if(t > 1.0)
 		{
-		  overlap = AY_FALSE;
+		  t = 1.0;
+		  s = AY_NCTISCLAMP01((bb - c)/aa);
 		}
-	    }
-	  else
-	    {
-	      overlap = AY_FALSE;
-	    }
+	  } /* if */
+      } /* if */
 
-	  if(overlap)
-	    {
-	      /* segments bu[i] and bv[j] overlap at least in one
-		 dimension => calculate smallest distance */
+  c1[0] = p0[0] + s*d1[0];
+  c1[1] = p0[1] + s*d1[1];
+  c1[2] = p0[2] + s*d1[2];
+  c2[0] = q0[0] + t*d2[0];
+  c2[1] = q0[1] + t*d2[1];
+  c2[2] = q0[2] + t*d2[2];
+  AY_V3SUB(r, c1, c2);
 
+  *a = s;
+  *b = t;
 
-	    }
+ return AY_V3LEN(r);
+} /* ay_nct_ischords */
 
-	} /* for */
-    } /* for */
 
+/* ay_nct_ispolish:
+ *  refine the intersection candidate <s>, <t> using Newton iterations
+ *  (Gauss-Newton on the distance of the two curve points) and add it
+ *  to the results, if the curves really meet there and the intersection
+ *  is not already known
+ */
+void
+ay_nct_ispolish(ay_nct_isctx *ctx, double s, double t)
+{
+ ay_nurbcurve_object *c1 = ctx->c[0], *c2 = ctx->c[1];
+ double C1[3], D1[3], C2[3], D2[3], F[3], dist, bestdist = DBL_MAX;
+ double a, b, c, r1, r2, det, ds, dt, bests = s, bestt = t;
+ double smin, smax, tmin, tmax, *res;
+ int i, dup;
+
+  smin = c1->knotv[c1->order-1];
+  smax = c1->knotv[c1->length];
+  tmin = c2->knotv[c2->order-1];
+  tmax = c2->knotv[c2->length];
 
-  /* first, calc middle point of control hull */
-  su = &(bu[i*stride]);
-  for(i = 0; i < nbu; i++)
+  for(i = 0; i < AY_NCTISMAXITER; i++)
     {
-      k = 0;
-      for(j = 0; j < cu->order; j++)
+      if(ay_nb_CurvePoints4D(c1->length-1, c1->order-1, c1->knotv,
+			     c1->controlv, c1->is_rat, 1, &s, 3, C1, D1) ||
+	 ay_nb_CurvePoints4D(c2->length-1, c2->order-1, c2->knotv,
+			     c2->controlv, c2->is_rat, 1, &t, 3, C2, D2))
 	{
+	  ctx->status = AY_EOMEM;
+	  return;
+	}
 
+      AY_V3SUB(F, C1, C2);
+      dist = AY_V3LEN(F);
+      if(dist < bestdist)
+	{
+	  bestdist = dist;
+	  bests = s;
+	  bestt = t;
+	}
+
+      if(dist < DBL_EPSILON)
+	break;
+
+      /* solve the normal equations of J = [D1, -D2] */
+      a = AY_V3DOT(D1, D1);
+      b = -AY_V3DOT(D1, D2);
+      c = AY_V3DOT(D2, D2);
+      r1 = AY_V3DOT(D1, F);
+      r2 = -AY_V3DOT(D2, F);
+      det = a*c - b*b;
+      if(fabs(det) <= DBL_EPSILON*a*c || det == 0.0)
+	break;
+
+      ds = (-r1*c + r2*b)/det;
+      dt = (-r2*a + r1*b)/det;
+
+      s += ds;
+      t += dt;
 
+      if(s < smin) s = smin;
+      if(s > smax) s = smax;
+      if(t < tmin) t = tmin;
+      if(t > tmax) t = tmax;
+
+      if(fabs(ds) < DBL_EPSILON*(smax-smin) &&
+	 fabs(dt) < DBL_EPSILON*(tmax-tmin))
+	break;
+    } /* for */
+
+  if(bestdist > ctx->tol)
+    return;
+
+  /* already known? */
+  for(i = 0; i < ctx->nres; i++)
+    {
+      res = &(ctx->res[i*AY_NCTISRESSTRIDE]);
+      dup = (fabs(res[0]-bests) < AY_NCTISPARTOL*(smax-smin) &&
+	     fabs(res[1]-bestt) < AY_NCTISPARTOL*(tmax-tmin));
+      if(!dup &&
+	 fabs(res[0]-bests) < AY_NCTISMERGETOL*(smax-smin) &&
+	 fabs(res[1]-bestt) < AY_NCTISMERGETOL*(tmax-tmin))
+	{
+	  /* close in parameter space, this is the same (tangential)
+	     intersection if the curves also meet in between */
+	  s = (res[0]+bests)*0.5;
+	  t = (res[1]+bestt)*0.5;
+	  (void)ay_nb_CurvePoints4D(c1->length-1, c1->order-1, c1->knotv,
+				    c1->controlv, c1->is_rat, 1, &s, 3,
+				    C1, NULL);
+	  (void)ay_nb_CurvePoints4D(c2->length-1, c2->order-1, c2->knotv,
+				    c2->controlv, c2->is_rat, 1, &t, 3,
+				    C2, NULL);
+	  AY_V3SUB(F, C1, C2);
+	  dup = (AY_V3LEN(F) <= ctx->tol);
+	}
+      if(dup)
+	{
+	  /* yes, keep the better one */
+	  if(bestdist < res[5])
+	    {
+	      res[0] = bests;
+	      res[1] = bestt;
+	      res[5] = bestdist;
+	      (void)ay_nb_CurvePoints4D(c1->length-1, c1->order-1,
+					c1->knotv, c1->controlv, c1->is_rat,
+					1, &bests, 3, &(res[2]), NULL);
+	    }
+	  return;
 	}
-      k+=stride;
     } /* for */
 
-  sv = &(bv[j*stride]);
+  if(ctx->nres >= ctx->ares)
+    {
+      i = ctx->ares?2*ctx->ares:16;
+      if(!(res = realloc(ctx->res, i*AY_NCTISRESSTRIDE*sizeof(double))))
+	{
+	  ctx->status = AY_EOMEM;
+	  return;
+	}
+      ctx->res = res;
+      ctx->ares = i;
+    }
 
-  /* compare x component */
+  res = &(ctx->res[ctx->nres*AY_NCTISRESSTRIDE]);
+  res[0] = bests;
+  res[1] = bestt;
+  (void)ay_nb_CurvePoints4D(c1->length-1, c1->order-1, c1->knotv,
+			    c1->controlv, c1->is_rat, 1, &bests, 3,
+			    &(res[2]), NULL);
+  res[5] = bestdist;
+  ctx->nres++;
+
+ return;
+} /* ay_nct_ispolish */
+
+
+/* ay_nct_isbezier:
+ *  intersect the homogeneous Bezier segments <P> (parametric range
+ *  s0 - s1) and <Q> (parametric range t0 - t1) by recursive
+ *  subdivision with bounding box pruning
+ */
+void
+ay_nct_isbezier(ay_nct_isctx *ctx, double *P, double s0, double s1,
+		double *Q, double t0, double t1, int depth)
+{
+ int op = ctx->bz[0].order, oq = ctx->bz[1].order, fp, fq, splitp;
+ double bp[6], bq[6], a, b, dist, dp, dq, *L = NULL, *R;
+
+  if(ctx->status)
+    return;
+
+  if(++(ctx->pairs) > AY_NCTISMAXPAIRS)
+    {
+      /* most likely overlapping curves */
+      ctx->status = AY_ERROR;
+      return;
+    }
+
+  ay_nct_isbox(P, op, bp);
+  ay_nct_isbox(Q, oq, bq);
+
+  if(!ay_nct_isoverlap(bp, bq, ctx->tol))
+    return;
+
+  fp = ay_nct_isflat(P, op, ctx->tol);
+  fq = ay_nct_isflat(Q, oq, ctx->tol);
+
+  if((fp && fq) || depth >= AY_NCTISMAXDEPTH)
+    {
+      /* both segments are (nearly) straight lines, intersect
+	 their chords to get a starting point for the polishing */
+      if(ay_nct_iscollinear(P, op, Q, oq, ctx->tol) &&
+	 (++(ctx->overlaps) > AY_NCTISMAXOVERLAPS))
+	{
+	  ctx->status = AY_ERROR;
+	  return;
+	}
+      dist = ay_nct_ischords(P, op, Q, oq, &a, &b);
+      if(dist <= 3.0*ctx->tol || depth >= AY_NCTISMAXDEPTH)
+	ay_nct_ispolish(ctx, s0+a*(s1-s0), t0+b*(t1-t0));
+      return;
+    }
+
+  /* subdivide the bigger (not flat) segment */
+  dp = (bp[1]-bp[0])+(bp[3]-bp[2])+(bp[5]-bp[4]);
+  dq = (bq[1]-bq[0])+(bq[3]-bq[2])+(bq[5]-bq[4]);
+  splitp = !fp && (fq || dp >= dq);
+
+  if(splitp)
+    {
+      if(!(L = malloc(2*op*4*sizeof(double))))
+	{ ctx->status = AY_EOMEM; return; }
+      R = L+op*4;
+      ay_nct_issplit(P, op, L, R);
+      ay_nct_isbezier(ctx, L, s0, (s0+s1)*0.5, Q, t0, t1, depth+1);
+      ay_nct_isbezier(ctx, R, (s0+s1)*0.5, s1, Q, t0, t1, depth+1);
+    }
+  else
+    {
+      if(!(L = malloc(2*oq*4*sizeof(double))))
+	{ ctx->status = AY_EOMEM; return; }
+      R = L+oq*4;
+      ay_nct_issplit(Q, oq, L, R);
+      ay_nct_isbezier(ctx, P, s0, s1, L, t0, (t0+t1)*0.5, depth+1);
+      ay_nct_isbezier(ctx, P, s0, s1, R, (t0+t1)*0.5, t1, depth+1);
+    }
+
+  free(L);
+
+ return;
+} /* ay_nct_isbezier */
+
+
+/* ay_nct_istraverse:
+ *  traverse the bounding volume hierarchies of both curves
+ *  starting at the nodes <na> and <nb>
+ */
+void
+ay_nct_istraverse(ay_nct_isctx *ctx, int na, int nb)
+{
+ ay_nct_isbez *bza = &(ctx->bz[0]), *bzb = &(ctx->bz[1]);
+ int *a, *b, la, lb;
+ double *boxa, *boxb, ea, eb;
+
+  if(ctx->status)
+    return;
+
+  boxa = &(bza->boxes[na*6]);
+  boxb = &(bzb->boxes[nb*6]);
+
+  if(!ay_nct_isoverlap(boxa, boxb, ctx->tol))
+    return;
+
+  a = &(bza->nodes[na*4]);
+  b = &(bzb->nodes[nb*4]);
+  la = (a[2] < 0);
+  lb = (b[2] < 0);
+
+  if(la && lb)
+    {
+      /* two overlapping leaves => intersect the Bezier segments */
+      ay_nct_isbezier(ctx, &(bza->cv[a[0]*bza->order*4]),
+		      bza->u[a[0]], bza->u[a[0]+1],
+		      &(bzb->cv[b[0]*bzb->order*4]),
+		      bzb->u[b[0]], bzb->u[b[0]+1], 0);
+      return;
+    }
+
+  ea = (boxa[1]-boxa[0])+(boxa[3]-boxa[2])+(boxa[5]-boxa[4]);
+  eb = (boxb[1]-boxb[0])+(boxb[3]-boxb[2])+(boxb[5]-boxb[4]);
+
+  /* descend into the bigger node */
+  if(lb || (!la && ea >= eb))
+    {
+      ay_nct_istraverse(ctx, a[2], nb);
+      ay_nct_istraverse(ctx, a[3], nb);
+    }
+  else
+    {
+      ay_nct_istraverse(ctx, na, b[2]);
+      ay_nct_istraverse(ctx, na, b[3]);
+    }
+
+ return;
+} /* ay_nct_istraverse */
+
+
+/* ay_nct_iscompare:
+ *  compare two intersections by their parametric value on the
+ *  first curve (for qsort())
+ */
+int
+ay_nct_iscompare(const void *a, const void *b)
+{
+ const double *da = (const double *)a, *db = (const double *)b;
+
+  if(da[0] < db[0])
+    return -1;
+  if(da[0] > db[0])
+    return 1;
+
+ return 0;
+} /* ay_nct_iscompare */
+
+
+/** ay_nct_intersect:
+ * Calculate all intersections of two NURBS curves.
+ * Both curves are decomposed into Bezier segments, overlapping segment
+ * pairs are found via bounding volume hierarchies and then intersected
+ * via recursive subdivision; the resulting candidates are finally
+ * polished using Newton iterations.
+ *
+ * \param[in] cu  first NURBS curve
+ * \param[in] cv  second NURBS curve
+ * \param[in] tol  tolerance, the curves intersect where they are closer
+ *  than tol
+ * \param[in,out] nis  where to store the number of intersections
+ * \param[in,out] is  where to store the intersections, for each
+ *  intersection: parametric value on cu, parametric value on cv, and the
+ *  coordinates of the intersection point (x, y, z), sorted by the
+ *  parametric values on cu [nis*5], may be NULL if nis is 0
+ *
+ * \returns AY_OK on success, error code otherwise
+ *  (AY_ERROR if the curves overlap)
+ */
+int
+ay_nct_intersect(ay_nurbcurve_object *cu, ay_nurbcurve_object *cv,
+		 double tol, int *nis, double **is)
+{
+ int ay_status = AY_OK;
+ ay_nct_isctx ctx = {0};
+ int i;
+
+  if(!cu || !cv || !nis || !is)
+    return AY_ENULL;
+
+  *nis = 0;
+  *is = NULL;
+
+  if(tol <= 0.0)
+    tol = AY_EPSILON;
+
+  ctx.c[0] = cu;
+  ctx.c[1] = cv;
+  ctx.tol = tol;
+
+  ay_status = ay_nct_isdecompose(cu, &(ctx.bz[0]));
+  if(ay_status)
+    goto cleanup;
+
+  ay_status = ay_nct_isdecompose(cv, &(ctx.bz[1]));
+  if(ay_status)
+    goto cleanup;
+
+  ay_nct_istraverse(&ctx, 0, 0);
+
+  ay_status = ctx.status;
+  if(ay_status)
+    goto cleanup;
+
+  if(ctx.nres > 0)
+    {
+      qsort(ctx.res, ctx.nres, AY_NCTISRESSTRIDE*sizeof(double),
+	    ay_nct_iscompare);
+
+      /* compact the results (remove the distances) */
+      for(i = 0; i < ctx.nres; i++)
+	{
+	  memmove(&(ctx.res[i*5]), &(ctx.res[i*AY_NCTISRESSTRIDE]),
+		  5*sizeof(double));
+	}
+
+      *nis = ctx.nres;
+      *is = ctx.res;
+      ctx.res = NULL;
+    }
+
+cleanup:
+
+  ay_nct_isfree(&(ctx.bz[0]));
+  ay_nct_isfree(&(ctx.bz[1]));
+
+  if(ctx.res)
+    free(ctx.res);
 
-#endif
  return ay_status;
 } /* ay_nct_intersect */
 
 
+/** ay_nct_intersecttcmd:
+ *  Calculate all intersections of the first two selected NURBS curves.
+ *  Implements the \a intersectNC scripting interface command.
+ *  See also the corresponding section in the \ayd{scintersectnc}.
+ *
+ *  \returns TCL_OK in any case.
+ */
+int
+ay_nct_intersecttcmd(ClientData clientData, Tcl_Interp *interp,
+		     int argc, char *argv[])
+{
+ int ay_status = AY_OK, tcl_status = TCL_OK;
+ ay_list_object *sel = ay_selection;
+ ay_object *curves = NULL, **next = &curves, *o, *po = NULL;
+ double tol = AY_EPSILON, *is = NULL;
+ int apply_trafo = AY_FALSE, i = 1, nis = 0;
+ Tcl_Obj *to = NULL;
+
+  if(!sel)
+    {
+      ay_error(AY_ENOSEL, argv[0], NULL);
+      return TCL_OK;
+    }
+
+  /* parse args */
+  while(i < argc)
+    {
+      if((argv[i][0] == '-') && (argv[i][1] == 't'))
+	{
+	  apply_trafo = AY_TRUE;
+	}
+      else
+	{
+	  tcl_status = Tcl_GetDouble(interp, argv[i], &tol);
+	  AY_CHTCLERRRET(tcl_status, argv[0], interp);
+	  if(tol <= 0.0)
+	    {
+	      ay_error(AY_ERROR, argv[0], "Tolerance must be > 0.");
+	      return TCL_OK;
+	    }
+	}
+      i++;
+    } /* while */
+
+  /* collect (copies of) the first two curves */
+  while(sel && (!curves || !curves->next))
+    {
+      o = sel->object;
+      if(o->type == AY_IDNCURVE)
+	{
+	  ay_status = ay_object_copy(o, next);
+	  if(ay_status)
+	    goto cleanup;
+	  next = &((*next)->next);
+	}
+      else
+	{
+	  po = NULL;
+	  ay_status = ay_provide_object(o, AY_IDNCURVE, &po);
+	  if(ay_status || !po)
+	    {
+	      ay_error(AY_EWARN, argv[0], ay_error_igntype);
+	    }
+	  else
+	    {
+	      *next = po;
+	      while(*next)
+		next = &((*next)->next);
+	    }
+	} /* if */
+      sel = sel->next;
+    } /* while */
+
+  if(!curves || !curves->next)
+    {
+      ay_error(AY_ERROR, argv[0], "Need two curves.");
+      goto cleanup;
+    }
+
+  if(apply_trafo)
+    {
+      (void)ay_nct_applytrafo(curves);
+      (void)ay_nct_applytrafo(curves->next);
+    }
+
+  ay_status = ay_nct_intersect((ay_nurbcurve_object *)curves->refine,
+			       (ay_nurbcurve_object *)curves->next->refine,
+			       tol, &nis, &is);
+  if(ay_status)
+    {
+      if(ay_status == AY_ERROR)
+	ay_error(AY_ERROR, argv[0], "Curves overlap.");
+      else
+	ay_error(ay_status, argv[0], NULL);
+      goto cleanup;
+    }
+
+  /* put result into Tcl context */
+  to = Tcl_NewListObj(0, NULL);
+  for(i = 0; i < nis*5; i++)
+    {
+      Tcl_ListObjAppendElement(interp, to, Tcl_NewDoubleObj(is[i]));
+    }
+  Tcl_SetObjResult(interp, to);
+
+cleanup:
+
+  if(curves)
+    (void)ay_object_deletemulti(curves, AY_FALSE);
+
+  if(is)
+    free(is);
+
+ return TCL_OK;
+} /* ay_nct_intersecttcmd */
+
+
 /** ay_nct_intersectsets:
  * Calculate the intersections of two sets of ordered intersecting
  * and isoparametric curves.
  * This is needed for the Gordon surface creation.
+ * Where the curves do not really intersect, the intersection points
+ * are estimated from the parametric values of the curve end points.
  *
  * XXXX Todo: this could be made more robust by also computing
  * intersection points from the u curves and then calculating
@@ -6379,8 +7298,8 @@ ay_nct_intersectsets(int ncu, ay_object *cu, int ncv, ay_object *cv,
  double *us = NULL, *vs = NULL, u, v, pnt[3];
  ay_object *cuo, *cvo;
  ay_nurbcurve_object *nc;
- double *a;
- int i, j;
+ double *a, *b, *is;
+ int i, j, k, nis;
 
   if(!(us = calloc(ncv, sizeof(double))))
     { ay_status = AY_EOMEM; goto cleanup; }
@@ -6451,11 +7370,34 @@ ay_nct_intersectsets(int ncu, ay_object *cu, int ncv, ay_object *cv,
   for(i = 0; i < ncv; i++)
     {
       nc = (ay_nurbcurve_object *)cvo->refine;
+      cuo = cu;
       for(j = 0; j < ncu; j++)
 	{
-	  ay_status = ay_nb_CurvePoint4D(nc->length-1, nc->order-1, nc->knotv,
-					 nc->controlv, vs[j], a);
+	  /* prefer a real intersection of the two curves (the one
+	     nearest to the estimated parameter), if there is one */
+	  nis = 0;
+	  is = NULL;
+	  (void)ay_nct_intersect(nc, (ay_nurbcurve_object *)cuo->refine,
+				 AY_EPSILON, &nis, &is);
+	  if(nis > 0)
+	    {
+	      b = is;
+	      for(k = 1; k < nis; k++)
+		{
+		  if(fabs(is[k*5]-vs[j]) < fabs(b[0]-vs[j]))
+		    b = &(is[k*5]);
+		}
+	      memcpy(a, &(b[2]), 3*sizeof(double));
+	      free(is);
+	    }
+	  else
+	    {
+	      ay_status = ay_nb_CurvePoint4D(nc->length-1, nc->order-1,
+					     nc->knotv, nc->controlv, vs[j],
+					     a);
+	    }
 	  a[3] = 1.0;
+	  cuo = cuo->next;
 	  /*
 	  printf("(%d,%d)=(%lg %lg %lg)\n",i,j,a[0],a[1],a[2]);
 	  */
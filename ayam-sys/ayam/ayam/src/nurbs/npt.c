@@ -28,6 +28,13 @@ typedef struct ay_objbid_s {
   unsigned int bid;
 } ay_objbid;
 
+/* knot span (Bezier patch) of a NURBS surface for point inversion */
+typedef struct ay_npt_invspan_s {
+  int i, j; /* index of knot span in u/v direction */
+  double key; /* sort key (distance to point or ray parameter) */
+  double bb[6]; /* bounding box of span (xmin, xmax, ymin, ...) */
+} ay_npt_invspan;
+
 
 /* prototypes of functions local to this module: */
 
@@ -77,6 +84,35 @@ int ay_npt_addobjbid(ay_objbid **objbids, unsigned int *objbidslen,
 		     unsigned int ni, ay_object *o, unsigned int pid,
 		     unsigned int bid);
 
+int ay_npt_hitbound(double *mvp, ay_object *o, unsigned int bound,
+		    int tcslen, int *tcslens, double *tps);
+
+int ay_npt_pickbounds(double *mvp, ay_object *o, ay_object *p,
+		      unsigned int pid, int complete, ay_objbid **objbids,
+		      unsigned int *objbidslen, unsigned int *ni);
+
+/** Helper for point inversion.
+ */
+int ay_npt_invspans(ay_nurbpatch_object *np, ay_npt_invspan **spans,
+		    int *nspans, double *size);
+
+int ay_npt_invcmp(const void *a, const void *b);
+
+void ay_npt_invclamp(ay_nurbpatch_object *np, double *u, double *v);
+
+double ay_npt_invnewtonpnt(ay_nurbpatch_object *np, double *p, double tol,
+			   double *u, double *v);
+
+double ay_npt_invdet(double *a, double *b, double *c);
+
+int ay_npt_invnewtonray(ay_nurbpatch_object *np, double *ro, double *rd,
+			double tol, double *u, double *v, double *t);
+
+int ay_npt_invraybox(double *ro, double *rd, double *bb, double *t);
+
+int ay_npt_invraytri(double *ro, double *rd, double *p0, double *p1,
+		     double *p2, double *t, double *b1, double *b2);
+
 
 /* functions: */
 
@@ -13680,359 +13716,976 @@ ay_npt_getnormal(ay_nurbpatch_object *np, int i, int j,
 } /* ay_npt_getnormal */
 
 
-/* ay_npt_finduv:
- *  transforms the window coordinates (winX, winY)
- *  to the corresponding parametric values u, v
- *  on the NURBS surface o
- *  This function needs a valid OpenGL rendering context!
- *
- *  XXXX ToDo: use gluPickMatrix() to speed this up
- *
+/* ay_npt_invspans:
+ *  collect the non-empty knot spans (Bezier patches) of NURBS surface <np>
+ *  together with the bounding boxes of their control points (which,
+ *  due to the strong convex hull property, also bound the respective
+ *  part of the surface) for point inversion; also delivers the diagonal
+ *  of the bounding box of the complete surface in <size>
  */
 int
-ay_npt_finduv(struct Togl *togl, ay_object *o,
-	      double *winXY, double *worldXYZ, double *u, double *v)
+ay_npt_invspans(ay_nurbpatch_object *np, ay_npt_invspan **spans,
+		int *nspans, double *size)
 {
- int ay_status = AY_OK;
- /*  int width = Togl_Width(togl);*/
- int height = Togl_Height(togl);
- GLint viewport[4];
- GLdouble modelMatrix[16], projMatrix[16], winx, winy;
- GLfloat winz = 0.0f;
- double m[16];
- GLfloat pixel1[3] = {0.9f,0.9f,0.9f}, pixel[3] = {0.0f,0.0f,0.0f};
- ay_nurbpatch_object *np = NULL;
- int dx[25] = {0,1,1,0,-1,-1,-1,0,1, 2,2,2,1,0,-1,-2,-2,-2,-2,-2,-1,0,1,2,2};
- int dy[25] = {0,0,-1,-1,-1,0,1,1,1, 0,-1,-2,-2,-2,-2,-2,-1,0,1,2,2,2,2,2,1};
- int found, i = 0, j = 0, k = 0, /*maxtry = 1000,*/ stride;
- int usamples = 10, vsamples = 10;
- int starti = 0, endi = 0;
- int startj = 0, endj = 0;
- double point[4] = {0}/*, guess = 0.0, e1 = 0.05, e2 = 0.05*/;
- double distance = 0.0, min_distance = 0.0;
- double *cp = NULL, *p = NULL;
- double U[10/* XXXX usamples! */] = {0}, startu, endu;
- double V[10/* XXXX vsamples! */] = {0}, startv, endv;
- ay_voidfp *arr = NULL;
- ay_drawcb *cb = NULL;
+ ay_npt_invspan *s;
+ int i, j, a, b, k, c, n = 0, p = np->uorder-1, q = np->vorder-1;
+ double *cv, bb[6] = {DBL_MAX, -DBL_MAX, DBL_MAX, -DBL_MAX,
+		      DBL_MAX, -DBL_MAX};
 
-  if(!o)
-    return AY_ENULL;
+  if(!(s = malloc((np->width-p)*(np->height-q)*sizeof(ay_npt_invspan))))
+    return AY_EOMEM;
 
-  if(o->type != AY_IDNPATCH)
-    return AY_EWTYPE;
+  for(i = p; i < np->width; i++)
+    {
+      if(np->uknotv[i] >= np->uknotv[i+1])
+	continue;
+      for(j = q; j < np->height; j++)
+	{
+	  if(np->vknotv[j] >= np->vknotv[j+1])
+	    continue;
 
-  np = (ay_nurbpatch_object *)o->refine;
+	  s[n].i = i;
+	  s[n].j = j;
+	  s[n].key = 0.0;
+	  for(c = 0; c < 3; c++)
+	    {
+	      s[n].bb[c*2] = DBL_MAX;
+	      s[n].bb[c*2+1] = -DBL_MAX;
+	    }
 
-  /* shade the selected object without lighting as we are mostly
-     interested in the corresponding Z-Buffer values */
-  arr = ay_shadecbt.arr;
-  cb = (ay_drawcb *)(arr[o->type]);
+	  for(a = i-p; a <= i; a++)
+	    {
+	      for(b = j-q; b <= j; b++)
+		{
+		  cv = &(np->controlv[(a*np->height+b)*4]);
+		  for(c = 0; c < 3; c++)
+		    {
+		      if(cv[c] < s[n].bb[c*2])
+			s[n].bb[c*2] = cv[c];
+		      if(cv[c] > s[n].bb[c*2+1])
+			s[n].bb[c*2+1] = cv[c];
+		    }
+		}
+	    }
 
-  glClear(GL_DEPTH_BUFFER_BIT);
-  glDisable(GL_LIGHTING);
-  /* set color for selected objects */
-  glColor3f((GLfloat)ay_prefs.ser, (GLfloat)ay_prefs.seg,
-	    (GLfloat)ay_prefs.seb);
+	  for(k = 0; k < 3; k++)
+	    {
+	      if(s[n].bb[k*2] < bb[k*2])
+		bb[k*2] = s[n].bb[k*2];
+	      if(s[n].bb[k*2+1] > bb[k*2+1])
+		bb[k*2+1] = s[n].bb[k*2+1];
+	    }
 
-  glMatrixMode(GL_MODELVIEW);
-  glPushMatrix();
-   if(ay_currentlevel->object != ay_root)
-     ay_trafo_concatparent(ay_currentlevel->next);
+	  n++;
+	} /* for */
+    } /* for */
 
-   glTranslated(o->movx, o->movy, o->movz);
-   ay_quat_torotmatrix(o->quat, m);
-   glMultMatrixd(m);
-   glScaled(o->scalx, o->scaly, o->scalz);
+  if(!n)
+    {
+      free(s);
+      return AY_ERROR;
+    }
 
-   if(cb)
-     ay_status = cb(togl, o);
+  *spans = s;
+  *nspans = n;
+  *size = AY_VLEN((bb[1]-bb[0]), (bb[3]-bb[2]), (bb[5]-bb[4]));
 
-   glGetDoublev(GL_MODELVIEW_MATRIX, modelMatrix);
-  glPopMatrix();
+ return AY_OK;
+} /* ay_npt_invspans */
 
-  glEnable(GL_LIGHTING);
 
-  pixel1[0] = (float)ay_prefs.ser;
-  pixel1[1] = (float)ay_prefs.seg;
-  pixel1[2] = (float)ay_prefs.seb;
+/* ay_npt_invcmp:
+ *  qsort() helper to sort knot spans by key
+ */
+int
+ay_npt_invcmp(const void *a, const void *b)
+{
+ double ka = ((const ay_npt_invspan *)a)->key;
+ double kb = ((const ay_npt_invspan *)b)->key;
 
-  /*
-  winx = winX;
-  winy = height - winY;
-  */
+  if(ka < kb)
+    return -1;
+  if(ka > kb)
+    return 1;
 
-  /*
-   * first, we try to find a point on the surface in window coordinates;
-   * we do this by comparing colors of rendered pixels
-   */
-  found = AY_FALSE;
-  while(!found)
-    {
-      winx = winXY[0]+dx[i];
-      winy = height-winXY[1]-dy[i];
-      i++;
+ return 0;
+} /* ay_npt_invcmp */
 
-      if(i > 24)
-	{
-	  return AY_ERROR;
-	}
 
-      glReadPixels((GLint)winx,(GLint)winy,1,1,
-		   GL_RGB,GL_FLOAT,&pixel);
+/* ay_npt_invclamp:
+ *  clamp the parametric values <u>, <v> to the domain of <np>
+ */
+void
+ay_npt_invclamp(ay_nurbpatch_object *np, double *u, double *v)
+{
+ double umin = np->uknotv[np->uorder-1], umax = np->uknotv[np->width];
+ double vmin = np->vknotv[np->vorder-1], vmax = np->vknotv[np->height];
+
+  if(*u < umin)
+    *u = umin;
+  if(*u > umax)
+    *u = umax;
+  if(*v < vmin)
+    *v = vmin;
+  if(*v > vmax)
+    *v = vmax;
 
-      if((pixel1[0] <= pixel[0]) &&
-	 (pixel1[1] <= pixel[1]) &&
-	 (pixel1[2] <= pixel[2]))
-	{
-	  found = AY_TRUE;
-	}
-    }
+ return;
+} /* ay_npt_invclamp */
 
-  /* get object coordinates of point on surface */
-  glGetIntegerv(GL_VIEWPORT, viewport);
 
-  glGetDoublev(GL_PROJECTION_MATRIX, projMatrix);
+/* ay_npt_invnewtonpnt:
+ *  refine the parametric values <u>, <v> of the point on NURBS surface
+ *  <np> closest to point <p> using Newton iteration on the first and
+ *  second derivatives; returns the squared distance of the final point
+ */
+double
+ay_npt_invnewtonpnt(ay_nurbpatch_object *np, double *p, double tol,
+		    double *u, double *v)
+{
+ double C[24], r[3], *S = C, *Sv = C+3, *Svv = C+6, *Su = C+9;
+ double *Suv = C+12, *Suu = C+18, f, g, a, b, d, det, du, dv, nu, nv;
+ double dist, ndist, pt[4];
+ int i, k;
 
-  /* get Z-Buffer value of picked point (winz) */
-  glReadPixels((GLint)winx,(GLint)winy,1,1,GL_DEPTH_COMPONENT,GL_FLOAT,&winz);
+  (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
+			     np->uorder-1, np->vorder-1,
+			     np->uknotv, np->vknotv, np->controlv,
+			     *u, *v, pt);
+  dist = AY_VLEN((pt[0]-p[0]), (pt[1]-p[1]), (pt[2]-p[2]));
 
-  gluUnProject(winx, winy, (GLdouble)winz, modelMatrix, projMatrix, viewport,
-	       &(point[0]), &(point[1]), &(point[2]));
+  for(i = 0; i < 32; i++)
+    {
+      ay_nb_SecondDerSurf4D(np->width-1, np->height-1,
+			    np->uorder-1, np->vorder-1,
+			    np->uknotv, np->vknotv, np->controlv,
+			    *u, *v, C);
 
-  /* in 7 iterations, search for matching parametric values of <point> */
-  stride = 4;
-  if(!(cp = malloc(usamples*vsamples*stride*sizeof(double))))
-    return AY_EOMEM;
+      AY_V3SUB(r, S, p);
 
-  startu = np->uknotv[np->uorder-1];
-  endu = np->uknotv[np->width];
-
-  startv = np->vknotv[np->vorder-1];
-  endv = np->vknotv[np->height];
-
-  for(k = 0; k < 7; k++)
-    {
-      U[0] = startu;
-      for(i = 1; i < usamples-1; i++)
-	{
-	  U[i] = U[i-1]+(endu - startu)/(usamples-1);
-	}
-      U[usamples-1] = endu;
-
-      V[0] = startv;
-      for(i = 1; i < vsamples-1; i++)
-	{
-	  V[i] = V[i-1]+(endv - startv)/(vsamples-1);
-	}
-      V[vsamples-1] = endv;
-      p = cp;
-      for(i = 0; i < usamples-1; i++)
-       {
-	 for(j = 0; j < vsamples-1; j++)
-	   {
-	     (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
-					np->uorder-1, np->vorder-1,
-					np->uknotv, np->vknotv,
-					np->controlv,
-					U[i]+((U[i+1]-U[i])/2.0),
-					V[j]+((V[j+1]-V[j])/2.0),
-					p);
-	     p += stride;
-	   } /* for */
-       } /* for */
-
-      min_distance = DBL_MAX;
-      p = cp;
-      for(i = 0; i < (usamples-1); i++)
-	{
-	 for(j = 0; j < (vsamples-1); j++)
-	   {
-	     distance = AY_VLEN((point[0] - p[0]),
-				(point[1] - p[1]),
-				(point[2] - p[2]));
-
-	     if(distance < min_distance)
-	       {
-		 *u = U[i]+((U[i+1]-U[i])/2.0);
-		 starti = i-1;
-		 endi = i+1;
-		 *v = V[i]+((V[i+1]-V[i])/2.0);
-		 startj = j-1;
-		 endj = j+1;
-		 min_distance = distance;
-	       }
-
-	     p += stride;
-	   } /* for */
-	} /* for */
+      f = AY_V3DOT(Su, r);
+      g = AY_V3DOT(Sv, r);
+      a = AY_V3DOT(Su, Su) + AY_V3DOT(r, Suu);
+      b = AY_V3DOT(Su, Sv) + AY_V3DOT(r, Suv);
+      d = AY_V3DOT(Sv, Sv) + AY_V3DOT(r, Svv);
 
-      if(starti < 0)
-	{
-	  startu = U[0];
-	}
-      else
-	{
-	  startu = U[starti];
-	}
+      det = a*d - b*b;
+      if(fabs(det) < DBL_MIN)
+	break;
 
-      if(endi >= usamples)
-	{
-	  endu = U[usamples-1];
-	}
-      else
-	{
-	  endu = U[endi];
+      du = (f*d - g*b)/det;
+      dv = (a*g - b*f)/det;
+
+      /* do not let the distance grow (halve the step if it does) */
+      for(k = 0; k < 8; k++)
+	{
+	  nu = *u - du;
+	  nv = *v - dv;
+	  ay_npt_invclamp(np, &nu, &nv);
+	  (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
+				     np->uorder-1, np->vorder-1,
+				     np->uknotv, np->vknotv, np->controlv,
+				     nu, nv, pt);
+	  ndist = AY_VLEN((pt[0]-p[0]), (pt[1]-p[1]), (pt[2]-p[2]));
+	  if(ndist <= dist)
+	    break;
+	  du *= 0.5;
+	  dv *= 0.5;
 	}
 
-      if(startj < 0)
-	{
-	  startv = V[0];
-	}
-      else
-	{
-	  startv = V[startj];
-	}
+      if(k == 8)
+	break;
 
-      if(endj >= vsamples)
-	{
-	  endv = V[vsamples-1];
-	}
-      else
-	{
-	  endv = V[endj];
-	}
+      du = nu - *u;
+      dv = nv - *v;
+      *u = nu;
+      *v = nv;
+      dist = ndist;
+
+      /* converged? */
+      if(fabs(du)*AY_V3LEN(Su) + fabs(dv)*AY_V3LEN(Sv) < tol)
+	break;
     } /* for */
 
-  /* compile/return results */
-  winXY[0] = winx;
-  winXY[1] = winy;
+ return dist;
+} /* ay_npt_invnewtonpnt */
 
-  (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
-			     np->uorder-1, np->vorder-1,
-			     np->uknotv, np->vknotv,
-			     np->controlv, *u, *v, point);
 
-  ay_trafo_apply3(point, modelMatrix);
+/* ay_npt_invdet:
+ *  compute the determinant of the 3x3 matrix with columns <a>, <b>, <c>
+ */
+double
+ay_npt_invdet(double *a, double *b, double *c)
+{
+ return (a[0]*(b[1]*c[2] - b[2]*c[1]) -
+	 b[0]*(a[1]*c[2] - a[2]*c[1]) +
+	 c[0]*(a[1]*b[2] - a[2]*b[1]));
+} /* ay_npt_invdet */
 
-  worldXYZ[0] = point[0];
-  worldXYZ[1] = point[1];
-  worldXYZ[2] = point[2];
 
-  free(cp);
+/* ay_npt_invnewtonray:
+ *  refine the parametric values <u>, <v> of the intersection of the ray
+ *  (<ro>, <rd>) with the NURBS surface <np> and the ray parameter <t>
+ *  using Newton iteration on the first derivatives;
+ *  returns AY_TRUE if the iteration converged
+ */
+int
+ay_npt_invnewtonray(ay_nurbpatch_object *np, double *ro, double *rd,
+		    double tol, double *u, double *v, double *t)
+{
+ double C[12], F[3], *S = C, *Sv = C+3, *Su = C+6, det, du, dv, dt;
+ double umin = np->uknotv[np->uorder-1], umax = np->uknotv[np->width];
+ double vmin = np->vknotv[np->vorder-1], vmax = np->vknotv[np->height];
+ int i;
 
- return ay_status;
-} /* ay_npt_finduv */
+  for(i = 0; i < 32; i++)
+    {
+      ay_nb_FirstDerSurf4D(np->width-1, np->height-1,
+			   np->uorder-1, np->vorder-1,
+			   np->uknotv, np->vknotv, np->controlv,
+			   *u, *v, C);
 
+      F[0] = S[0] - ro[0] - *t*rd[0];
+      F[1] = S[1] - ro[1] - *t*rd[1];
+      F[2] = S[2] - ro[2] - *t*rd[2];
 
-/* ay_npt_finduvcb:
- *  Togl callback to implement find parametric values
- *  u/v for a picked point on a NURBS surface
+      if(AY_V3LEN(F) < tol)
+	return AY_TRUE;
+
+      /* solve [Su Sv -rd] * [du dv dt] = F (Cramer's rule) */
+      det = ay_npt_invdet(Su, Sv, rd);
+      if(fabs(det) < DBL_MIN)
+	return AY_FALSE;
+
+      du = ay_npt_invdet(F, Sv, rd)/det;
+      dv = ay_npt_invdet(Su, F, rd)/det;
+      dt = -ay_npt_invdet(Su, Sv, F)/det;
+
+      *u -= du;
+      *v -= dv;
+      *t -= dt;
+
+      if(*u < umin || *u > umax || *v < vmin || *v > vmax)
+	{
+	  /* left the surface */
+	  ay_npt_invclamp(np, u, v);
+	  if(i > 2)
+	    return AY_FALSE;
+	}
+    } /* for */
+
+ return AY_FALSE;
+} /* ay_npt_invnewtonray */
+
+
+/** ay_npt_projectpnt:
+ * Find the point on a NURBS surface closest to a given point
+ * (point inversion/projection).
+ * The knot spans of the surface are visited in the order of the
+ * distance of their control point bounding boxes to the point, spans
+ * that can not contain a closer point are skipped; in each remaining
+ * span the closest point of a grid of surface points seeds a Newton
+ * iteration.
+ *
+ * \param[in] np  NURBS surface to process
+ * \param[in] p  the point (in object space of the surface) [3]
+ * \param[in,out] u  parametric value of the closest point
+ * \param[in,out] v  parametric value of the closest point
+ * \param[in,out] res  the closest point on the surface [3] (may be NULL)
+ *
+ * \returns AY_OK on success, error code otherwise.
  */
 int
-ay_npt_finduvcb(struct Togl *togl, int argc, char *argv[])
+ay_npt_projectpnt(ay_nurbpatch_object *np, double *p,
+		  double *u, double *v, double *res)
 {
  int ay_status = AY_OK;
- char fname[] = "findUV_cb";
- ay_view_object *view = (ay_view_object *)Togl_GetClientData(togl);
- Tcl_Interp *interp = Togl_Interp(togl);
- int i, j, drag = AY_FALSE, silence = AY_FALSE, success = AY_FALSE;
- int height = Togl_Height(togl);
- unsigned int ii;
- double winXY[8] = {0}, worldXYZ[3] = {0}, dt;
- static int fvalid = AY_FALSE;
- static double fX = 0.0, fY = 0.0, fwX = 0.0, fwY = 0.0, fwZ = 0.0;
- double obj[24] = {0}, pl[16] = {0}, mm[2] = {0};
- double minlevelscale = 1.0, u = 0.0, v = 0.0;
- Tcl_Obj *to = NULL;
- char cmd[] = "puts \"u: $u v: $v\"";
- ay_list_object *sel = ay_selection;
- ay_object *o, *pobject = NULL;
- ay_pointedit pe = {0};
- ay_nurbpatch_object *np;
+ ay_npt_invspan *spans = NULL, *s;
+ int n, i, j, k, ns;
+ double size, tol, d, dx, best = DBL_MAX, su, sv, tu, tv, pt[4];
+ double bestu = 0.0, bestv = 0.0, sbest;
 
-  if(argc > 2)
+  if(!np || !p || !u || !v)
+    return AY_ENULL;
+
+  if((ay_status = ay_npt_invspans(np, &spans, &n, &size)))
+    return ay_status;
+
+  tol = AY_EPSILON*AY_EPSILON*(1.0+size);
+
+  /* sort spans by the distance of their boxes to the point */
+  for(k = 0; k < n; k++)
     {
-      if(!strcmp(argv[2], "-start"))
+      d = 0.0;
+      for(i = 0; i < 3; i++)
 	{
-	  /*	  view->drawhandles = AY_FALSE;
-		  display_cb(togl);*/
-	  fvalid = AY_FALSE;
-	  return TCL_OK;
+	  if(p[i] < spans[k].bb[i*2])
+	    dx = spans[k].bb[i*2] - p[i];
+	  else
+	    if(p[i] > spans[k].bb[i*2+1])
+	      dx = p[i] - spans[k].bb[i*2+1];
+	    else
+	      dx = 0.0;
+	  d += dx*dx;
 	}
-      if(!strcmp(argv[2], "-end"))
-	{
-	  /* draw cross */
-	  if(fvalid)
-	    {
-	      view->markx = fX;
-	      view->marky = height-fY;
-	      view->markworld[0] = fwX;
-	      view->markworld[1] = fwY;
-	      view->markworld[2] = fwZ;
-	      view->drawmark = AY_TRUE;
+      spans[k].key = sqrt(d);
+    }
+  qsort(spans, n, sizeof(ay_npt_invspan), ay_npt_invcmp);
 
-	      if(ay_prefs.normalizemark)
+  ns = ((np->uorder > np->vorder)?np->uorder:np->vorder);
+  if(ns < 3)
+    ns = 3;
+
+  for(k = 0; k < n; k++)
+    {
+      s = &(spans[k]);
+
+      /* no closer point possible? */
+      if(s->key > best)
+	break;
+
+      /* seed from a grid of points in the span */
+      sbest = DBL_MAX;
+      su = np->uknotv[s->i];
+      sv = np->vknotv[s->j];
+      for(i = 0; i <= ns; i++)
+	{
+	  tu = np->uknotv[s->i] +
+	    i*(np->uknotv[s->i+1]-np->uknotv[s->i])/ns;
+	  for(j = 0; j <= ns; j++)
+	    {
+	      tv = np->vknotv[s->j] +
+		j*(np->vknotv[s->j+1]-np->vknotv[s->j])/ns;
+	      (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
+					 np->uorder-1, np->vorder-1,
+					 np->uknotv, np->vknotv, np->controlv,
+					 tu, tv, pt);
+	      d = AY_VLEN((pt[0]-p[0]), (pt[1]-p[1]), (pt[2]-p[2]));
+	      if(d < sbest)
 		{
-		  for(i = 0; i < 3; i++)
-		    {
-		      view->markworld[i] = ay_trafo_round(view->markworld[i],
-						     ay_prefs.normalizedigits);
-		    }
+		  sbest = d;
+		  su = tu;
+		  sv = tv;
 		}
+	    } /* for */
+	} /* for */
 
-	      ay_viewt_updatemark(togl, AY_FALSE);
-	      ay_viewt_printmark(view);
-	    }
+      d = ay_npt_invnewtonpnt(np, p, tol, &su, &sv);
 
-	  fvalid = AY_FALSE;
-	  return TCL_OK;
+      if(d < best)
+	{
+	  best = d;
+	  bestu = su;
+	  bestv = sv;
 	}
-    }
-  else
-    {
-      return TCL_OK;
-    }
-
-  if(!ay_selection)
-    {
-      ay_error(AY_ENOSEL, fname, NULL);
-      return TCL_OK;
-    }
+    } /* for */
 
-  if(argc > 4)
-    silence = AY_TRUE;
+  free(spans);
 
-  Tcl_GetDouble(interp, argv[2], &(winXY[0]));
-  Tcl_GetDouble(interp, argv[3], &(winXY[1]));
+  *u = bestu;
+  *v = bestv;
 
-  if(argc > 5)
+  if(res)
     {
-      drag = AY_TRUE;
-      Tcl_GetDouble(interp, argv[4], &(winXY[2]));
-      Tcl_GetDouble(interp, argv[5], &(winXY[3]));
-
-      if(argc > 6)
-	silence = AY_TRUE;
-      else
-	silence = AY_FALSE;
+      (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
+				 np->uorder-1, np->vorder-1,
+				 np->uknotv, np->vknotv, np->controlv,
+				 bestu, bestv, pt);
+      memcpy(res, pt, 3*sizeof(double));
     }
 
-  if(ay_prefs.errorlevel < 3)
-    silence = AY_TRUE;
+ return AY_OK;
+} /* ay_npt_projectpnt */
 
-  memcpy(&(winXY[4]), winXY, 4*sizeof(double));
 
-  minlevelscale = ay_pact_getminlevelscale();
+/* ay_npt_invraybox:
+ *  intersect ray (<ro>, <rd>) with the box <bb>,
+ *  returns AY_TRUE if the ray hits the box (entry parameter in <t>)
+ */
+int
+ay_npt_invraybox(double *ro, double *rd, double *bb, double *t)
+{
+ double tmin = 0.0, tmax = DBL_MAX, t1, t2, tt;
+ int i;
 
-  while(sel)
+  for(i = 0; i < 3; i++)
     {
-      o = sel->object;
-      pobject = NULL;
-
-      if(o->type != AY_IDNPATCH)
+      if(fabs(rd[i]) < DBL_MIN)
 	{
-	  if(!ay_provide_object(o, AY_IDNPATCH, NULL))
+	  if(ro[i] < bb[i*2] || ro[i] > bb[i*2+1])
+	    return AY_FALSE;
+	}
+      else
+	{
+	  t1 = (bb[i*2] - ro[i])/rd[i];
+	  t2 = (bb[i*2+1] - ro[i])/rd[i];
+	  if(t1 > t2)
+	    {
+	      tt = t1;
+	      t1 = t2;
+	      t2 = tt;
+	    }
+	  if(t1 > tmin)
+	    tmin = t1;
+	  if(t2 < tmax)
+	    tmax = t2;
+	  if(tmin > tmax)
+	    return AY_FALSE;
+	}
+    } /* for */
+
+  *t = tmin;
+
+ return AY_TRUE;
+} /* ay_npt_invraybox */
+
+
+/* ay_npt_invraytri:
+ *  intersect ray (<ro>, <rd>) with the triangle <p0>, <p1>, <p2>,
+ *  returns AY_TRUE if the ray hits the triangle in front of <ro>
+ *  (ray parameter in <t>, barycentric coordinates in <b1>, <b2>)
+ */
+int
+ay_npt_invraytri(double *ro, double *rd, double *p0, double *p1, double *p2,
+		 double *t, double *b1, double *b2)
+{
+ double e1[3], e2[3], pv[3], tv[3], qv[3], det;
+
+  AY_V3SUB(e1, p1, p0);
+  AY_V3SUB(e2, p2, p0);
+  AY_V3CROSS(pv, rd, e2);
+  det = AY_V3DOT(e1, pv);
+  if(fabs(det) < DBL_MIN)
+    return AY_FALSE;
+
+  AY_V3SUB(tv, ro, p0);
+  *b1 = AY_V3DOT(tv, pv)/det;
+  if(*b1 < 0.0 || *b1 > 1.0)
+    return AY_FALSE;
+
+  AY_V3CROSS(qv, tv, e1);
+  *b2 = AY_V3DOT(rd, qv)/det;
+  if(*b2 < 0.0 || *b1 + *b2 > 1.0)
+    return AY_FALSE;
+
+  *t = AY_V3DOT(e2, qv)/det;
+
+ return (*t >= 0.0);
+} /* ay_npt_invraytri */
+
+
+/** ay_npt_intersectray:
+ * Find the first intersection of a ray with a NURBS surface.
+ * The knot spans of the surface whose control point bounding boxes
+ * are hit by the ray are visited front to back; in each span the ray
+ * is intersected with a coarse triangulation of the span, the first
+ * hit seeds a Newton iteration.
+ *
+ * \param[in] np  NURBS surface to process
+ * \param[in] ro  origin of the ray (in object space of the surface) [3]
+ * \param[in] rd  direction of the ray [3]
+ * \param[in,out] u  parametric value of the intersection
+ * \param[in,out] v  parametric value of the intersection
+ * \param[in,out] res  the intersection point [3] (may be NULL)
+ *
+ * \returns AY_OK on success, AY_ERROR if the ray misses the surface,
+ *  error code otherwise.
+ */
+int
+ay_npt_intersectray(ay_nurbpatch_object *np, double *ro, double *rd,
+		    double *u, double *v, double *res)
+{
+ int ay_status = AY_OK;
+ ay_npt_invspan *spans = NULL, *s;
+ int n, i, j, k, l, m, ns, hit = AY_FALSE;
+ double size, tol, t, b1, b2, sthit, su = 0.0, sv = 0.0, st = 0.0;
+ double bestt = DBL_MAX, bestu = 0.0, bestv = 0.0, tu, tv;
+ double *grid = NULL, *pt, *c[4], cu[4], cv[4];
+ int tris[6] = {0, 1, 2, 0, 2, 3};
+
+  if(!np || !ro || !rd || !u || !v)
+    return AY_ENULL;
+
+  if(AY_V3LEN(rd) < DBL_MIN)
+    return AY_ERROR;
+
+  if((ay_status = ay_npt_invspans(np, &spans, &n, &size)))
+    return ay_status;
+
+  tol = AY_EPSILON*AY_EPSILON*(1.0+size);
+
+  /* sort the spans hit by the ray front to back */
+  m = 0;
+  for(k = 0; k < n; k++)
+    {
+      if(ay_npt_invraybox(ro, rd, spans[k].bb, &t))
+	{
+	  spans[m] = spans[k];
+	  spans[m].key = t;
+	  m++;
+	}
+    }
+  qsort(spans, m, sizeof(ay_npt_invspan), ay_npt_invcmp);
+
+  ns = ((np->uorder > np->vorder)?np->uorder:np->vorder);
+  if(ns < 3)
+    ns = 3;
+
+  if(!(grid = malloc((ns+1)*(ns+1)*4*sizeof(double))))
+    {
+      free(spans);
+      return AY_EOMEM;
+    }
+
+  for(k = 0; k < m; k++)
+    {
+      s = &(spans[k]);
+
+      /* no closer intersection possible? */
+      if(hit && s->key > bestt)
+	break;
+
+      /* tesselate the span */
+      pt = grid;
+      for(i = 0; i <= ns; i++)
+	{
+	  tu = np->uknotv[s->i] +
+	    i*(np->uknotv[s->i+1]-np->uknotv[s->i])/ns;
+	  for(j = 0; j <= ns; j++)
+	    {
+	      tv = np->vknotv[s->j] +
+		j*(np->vknotv[s->j+1]-np->vknotv[s->j])/ns;
+	      (void)ay_nb_SurfacePoint4D(np->width-1, np->height-1,
+					 np->uorder-1, np->vorder-1,
+					 np->uknotv, np->vknotv, np->controlv,
+					 tu, tv, pt);
+	      pt += 4;
+	    }
+	}
+
+      /* intersect ray with the triangles of the tesselation */
+      sthit = DBL_MAX;
+      for(i = 0; i < ns; i++)
+	{
+	  for(j = 0; j < ns; j++)
+	    {
+	      c[0] = &(grid[(i*(ns+1)+j)*4]);
+	      c[1] = &(grid[((i+1)*(ns+1)+j)*4]);
+	      c[2] = &(grid[((i+1)*(ns+1)+j+1)*4]);
+	      c[3] = &(grid[(i*(ns+1)+j+1)*4]);
+	      cu[0] = (double)i/ns;
+	      cu[1] = (double)(i+1)/ns;
+	      cu[2] = cu[1];
+	      cu[3] = cu[0];
+	      cv[0] = (double)j/ns;
+	      cv[1] = cv[0];
+	      cv[2] = (double)(j+1)/ns;
+	      cv[3] = cv[2];
+	      for(l = 0; l < 6; l += 3)
+		{
+		  if(ay_npt_invraytri(ro, rd, c[tris[l]], c[tris[l+1]],
+				      c[tris[l+2]], &t, &b1, &b2) &&
+		     (t < sthit))
+		    {
+		      sthit = t;
+		      tu = (1.0-b1-b2)*cu[tris[l]] + b1*cu[tris[l+1]] +
+			b2*cu[tris[l+2]];
+		      tv = (1.0-b1-b2)*cv[tris[l]] + b1*cv[tris[l+1]] +
+			b2*cv[tris[l+2]];
+		      su = np->uknotv[s->i] +
+			tu*(np->uknotv[s->i+1]-np->uknotv[s->i]);
+		      sv = np->vknotv[s->j] +
+			tv*(np->vknotv[s->j+1]-np->vknotv[s->j]);
+		      st = t;
+		    }
+		} /* for */
+	    } /* for */
+	} /* for */
+
+      if(sthit == DBL_MAX)
+	continue;
+
+      if(ay_npt_invnewtonray(np, ro, rd, tol, &su, &sv, &st) &&
+	 (st >= 0.0) && (st < bestt))
+	{
+	  hit = AY_TRUE;
+	  bestt = st;
+	  bestu = su;
+	  bestv = sv;
+	}
+    } /* for */
+
+  free(grid);
+  free(spans);
+
+  if(!hit)
+    return AY_ERROR;
+
+  *u = bestu;
+  *v = bestv;
+
+  if(res)
+    {
+      res[0] = ro[0] + bestt*rd[0];
+      res[1] = ro[1] + bestt*rd[1];
+      res[2] = ro[2] + bestt*rd[2];
+    }
+
+ return AY_OK;
+} /* ay_npt_intersectray */
+
+
+/* ay_npt_finduv:
+ *  transforms the window coordinates (winX, winY)
+ *  to the corresponding parametric values u, v
+ *  on the NURBS surface o by intersecting the surface
+ *  with the viewing ray through the window coordinates
+ *  (or through a neighboring pixel, if the ray misses);
+ *  on success, winXY holds the window coordinates (origin lower left)
+ *  and worldXYZ the world coordinates of the point found
+ *  This function needs a view with valid projection!
+ */
+int
+ay_npt_finduv(struct Togl *togl, ay_object *o,
+	      double *winXY, double *worldXYZ, double *u, double *v)
+{
+ int ay_status = AY_ERROR;
+ int width = Togl_Width(togl);
+ int height = Togl_Height(togl);
+ GLint viewport[4];
+ GLdouble modelMatrix[16], projMatrix[16], winx = 0.0, winy = 0.0;
+ ay_nurbpatch_object *np = NULL;
+ int dx[25] = {0,1,1,0,-1,-1,-1,0,1, 2,2,2,1,0,-1,-2,-2,-2,-2,-2,-1,0,1,2,2};
+ int dy[25] = {0,0,-1,-1,-1,0,1,1,1, 0,-1,-2,-2,-2,-2,-2,-1,0,1,2,2,2,2,2,1};
+ int i;
+ double ro[3], re[3], rd[3], point[3] = {0};
+
+  if(!o)
+    return AY_ENULL;
+
+  if(o->type != AY_IDNPATCH)
+    return AY_EWTYPE;
+
+  np = (ay_nurbpatch_object *)o->refine;
+
+  viewport[0] = 0;
+  viewport[1] = 0;
+  viewport[2] = width;
+  viewport[3] = height;
+
+  ay_viewt_setupprojection(togl);
+  glGetDoublev(GL_PROJECTION_MATRIX, projMatrix);
+
+  ay_trafo_identitymatrix(modelMatrix);
+  ay_trafo_getall(ay_currentlevel, o, modelMatrix);
+
+  for(i = 0; i < 25; i++)
+    {
+      winx = winXY[0]+dx[i];
+      winy = height-winXY[1]-dy[i];
+
+      /* get viewing ray in object space */
+      if(!gluUnProject(winx, winy, 0.0, modelMatrix, projMatrix, viewport,
+		       &(ro[0]), &(ro[1]), &(ro[2])) ||
+	 !gluUnProject(winx, winy, 1.0, modelMatrix, projMatrix, viewport,
+		       &(re[0]), &(re[1]), &(re[2])))
+	return AY_ERROR;
+
+      AY_V3SUB(rd, re, ro);
+
+      ay_status = ay_npt_intersectray(np, ro, rd, u, v, point);
+
+      if(ay_status != AY_ERROR)
+	break;
+    } /* for */
+
+  if(ay_status)
+    return ay_status;
+
+  /* compile/return results */
+  winXY[0] = winx;
+  winXY[1] = winy;
+
+  ay_trafo_apply3(point, modelMatrix);
+
+  worldXYZ[0] = point[0];
+  worldXYZ[1] = point[1];
+  worldXYZ[2] = point[2];
+
+ return AY_OK;
+} /* ay_npt_finduv */
+
+
+/** ay_npt_finduvtcmd:
+ *  find the parametric values of the point on a NURBS surface
+ *  that is closest to a given point or hit first by a given ray
+ *  Implements the \a findUVNP scripting interface command.
+ *  See also the corresponding section in the \ayd{scfinduvnp}.
+ *
+ *  \returns TCL_OK in any case.
+ */
+int
+ay_npt_finduvtcmd(ClientData clientData, Tcl_Interp *interp,
+		  int argc, char *argv[])
+{
+ int ay_status = AY_OK, tcl_status = TCL_OK;
+ ay_object *o = NULL, *po = NULL;
+ ay_nurbpatch_object *patch = NULL;
+ ay_list_object *sel = ay_selection;
+ double q[6] = {0}, p[3], d[3], pnt[3], m[16], mi[16], u = 0.0, v = 0.0;
+ int i = 1, n = 0, apply_trafo = AY_FALSE, freepo = AY_FALSE;
+ Tcl_Obj *to = NULL, *res = NULL, *lo = NULL;
+
+  /* parse args */
+  while(i < argc)
+    {
+      if((argv[i][0] == '-') && (argv[i][1] == 't'))
+	{
+	  apply_trafo = AY_TRUE;
+	}
+      else
+	{
+	  if(n > 5)
+	    {
+	      n++;
+	      break;
+	    }
+	  tcl_status = Tcl_GetDouble(interp, argv[i], &(q[n]));
+	  AY_CHTCLERRRET(tcl_status, argv[0], interp);
+	  if(q[n] != q[n])
+	    {
+	      ay_error_reportnan(argv[0], "point");
+	      return TCL_OK;
+	    }
+	  n++;
+	}
+      i++;
+    } /* while */
+
+  if(n != 3 && n != 6)
+    {
+      ay_error(AY_EARGS, argv[0], "[-t] x y z [dx dy dz]");
+      return TCL_OK;
+    }
+
+  if(!sel)
+    {
+      ay_error(AY_ENOSEL, argv[0], NULL);
+      return TCL_OK;
+    }
+
+  while(sel)
+    {
+      o = sel->object;
+      freepo = AY_FALSE;
+      patch = NULL;
+
+      if(o->type == AY_IDNPATCH)
+	{
+	  patch = (ay_nurbpatch_object*)o->refine;
+	}
+      else
+	{
+	  po = NULL;
+	  (void)ay_provide_object(sel->object, AY_IDNPATCH, &po);
+	  if(po)
+	    {
+	      patch = (ay_nurbpatch_object *)po->refine;
+	      freepo = AY_TRUE;
+	      o = po;
+	    }
+	}
+
+      if(patch)
+	{
+	  memcpy(p, q, 3*sizeof(double));
+	  memcpy(d, &(q[3]), 3*sizeof(double));
+
+	  if(apply_trafo)
+	    {
+	      /* transform point/ray to object space */
+	      ay_trafo_identitymatrix(m);
+	      ay_trafo_getall(ay_currentlevel, o, m);
+	      if(ay_trafo_invmatrix(m, mi))
+		{
+		  ay_error(AY_ERROR, argv[0], "Could not invert trafos.");
+		  goto cleanup;
+		}
+	      ay_trafo_apply3(p, mi);
+	      AY_V3ADD(d, d, q);
+	      ay_trafo_apply3(d, mi);
+	      AY_V3SUB(d, d, p);
+	    }
+
+	  if(n == 3)
+	    ay_status = ay_npt_projectpnt(patch, p, &u, &v, pnt);
+	  else
+	    ay_status = ay_npt_intersectray(patch, p, d, &u, &v, pnt);
+
+	  lo = Tcl_NewListObj(0, NULL);
+	  if(!ay_status)
+	    {
+	      if(apply_trafo)
+		ay_trafo_apply3(pnt, m);
+
+	      Tcl_ListObjAppendElement(interp, lo, Tcl_NewDoubleObj(u));
+	      Tcl_ListObjAppendElement(interp, lo, Tcl_NewDoubleObj(v));
+	      for(i = 0; i < 3; i++)
+		Tcl_ListObjAppendElement(interp, lo,
+					 Tcl_NewDoubleObj(pnt[i]));
+	    }
+	  else
+	    {
+	      if(ay_status != AY_ERROR)
+		ay_error(ay_status, argv[0], NULL);
+	    }
+
+	  if(to)
+	    {
+	      if(!res)
+		{
+		  res = Tcl_NewListObj(0, NULL);
+		  Tcl_ListObjAppendElement(interp, res, to);
+		}
+	      Tcl_ListObjAppendElement(interp, res, lo);
+	    }
+	  else
+	    {
+	      to = lo;
+	    }
+	}
+      else
+	{
+	  ay_error(AY_EWARN, argv[0], ay_error_igntype);
+	} /* if have NPatch */
+
+cleanup:
+      if(freepo)
+	{
+	  (void)ay_object_deletemulti(po, AY_FALSE);
+	}
+      sel = sel->next;
+    } /* while */
+
+  /* return result */
+  if(res)
+    Tcl_SetObjResult(interp, res);
+  else
+    if(to)
+      Tcl_SetObjResult(interp, to);
+
+ return TCL_OK;
+} /* ay_npt_finduvtcmd */
+
+
+/* ay_npt_finduvcb:
+ *  Togl callback to implement find parametric values
+ *  u/v for a picked point on a NURBS surface
+ */
+int
+ay_npt_finduvcb(struct Togl *togl, int argc, char *argv[])
+{
+ int ay_status = AY_OK;
+ char fname[] = "findUV_cb";
+ ay_view_object *view = (ay_view_object *)Togl_GetClientData(togl);
+ Tcl_Interp *interp = Togl_Interp(togl);
+ int i, j, drag = AY_FALSE, silence = AY_FALSE, success = AY_FALSE;
+ int height = Togl_Height(togl);
+ unsigned int ii;
+ double winXY[8] = {0}, worldXYZ[3] = {0}, dt;
+ static int fvalid = AY_FALSE;
+ static double fX = 0.0, fY = 0.0, fwX = 0.0, fwY = 0.0, fwZ = 0.0;
+ double obj[24] = {0}, pl[16] = {0}, mm[2] = {0};
+ double minlevelscale = 1.0, u = 0.0, v = 0.0;
+ Tcl_Obj *to = NULL;
+ char cmd[] = "puts \"u: $u v: $v\"";
+ ay_list_object *sel = ay_selection;
+ ay_object *o, *pobject = NULL;
+ ay_pointedit pe = {0};
+ ay_nurbpatch_object *np;
+
+  if(argc > 2)
+    {
+      if(!strcmp(argv[2], "-start"))
+	{
+	  /*	  view->drawhandles = AY_FALSE;
+		  display_cb(togl);*/
+	  fvalid = AY_FALSE;
+	  return TCL_OK;
+	}
+      if(!strcmp(argv[2], "-end"))
+	{
+	  /* draw cross */
+	  if(fvalid)
+	    {
+	      view->markx = fX;
+	      view->marky = height-fY;
+	      view->markworld[0] = fwX;
+	      view->markworld[1] = fwY;
+	      view->markworld[2] = fwZ;
+	      view->drawmark = AY_TRUE;
+
+	      if(ay_prefs.normalizemark)
+		{
+		  for(i = 0; i < 3; i++)
+		    {
+		      view->markworld[i] = ay_trafo_round(view->markworld[i],
+						     ay_prefs.normalizedigits);
+		    }
+		}
+
+	      ay_viewt_updatemark(togl, AY_FALSE);
+	      ay_viewt_printmark(view);
+	    }
+
+	  fvalid = AY_FALSE;
+	  return TCL_OK;
+	}
+    }
+  else
+    {
+      return TCL_OK;
+    }
+
+  if(!ay_selection)
+    {
+      ay_error(AY_ENOSEL, fname, NULL);
+      return TCL_OK;
+    }
+
+  if(argc > 4)
+    silence = AY_TRUE;
+
+  Tcl_GetDouble(interp, argv[2], &(winXY[0]));
+  Tcl_GetDouble(interp, argv[3], &(winXY[1]));
+
+  if(argc > 5)
+    {
+      drag = AY_TRUE;
+      Tcl_GetDouble(interp, argv[4], &(winXY[2]));
+      Tcl_GetDouble(interp, argv[5], &(winXY[3]));
+
+      if(argc > 6)
+	silence = AY_TRUE;
+      else
+	silence = AY_FALSE;
+    }
+
+  if(ay_prefs.errorlevel < 3)
+    silence = AY_TRUE;
+
+  memcpy(&(winXY[4]), winXY, 4*sizeof(double));
+
+  minlevelscale = ay_pact_getminlevelscale();
+
+  while(sel)
+    {
+      o = sel->object;
+      pobject = NULL;
+
+      if(o->type != AY_IDNPATCH)
+	{
+	  if(!ay_provide_object(o, AY_IDNPATCH, NULL))
 	    {
 	      (void)ay_provide_object(o, AY_IDNPATCH, &pobject);
 	      if(!pobject)
@@ -14161,10 +14814,7 @@ ay_npt_finduvcb(struct Togl *togl, int argc, char *argv[])
 	{
 	  /* knot picking failed, infer parametric values from surface point */
 	  if(!(ay_status = ay_npt_finduv(togl, o, winXY, worldXYZ, &u, &v)))
-	    {
-	      if(fabs(winXY[0]-obj[0])<3.0 && fabs(winXY[1]-obj[1])<3.0)
-		success = AY_TRUE;
-	    }
+	    success = AY_TRUE;
 	}
 
       if(success)
@@ -14185,11 +14835,6 @@ ay_npt_finduvcb(struct Togl *togl, int argc, char *argv[])
 	  if(!silence)
 	    Tcl_Eval(interp, cmd);
 	}
-      else
-	{
-	  /* need to repair the "damage" done by ay_npt_finduv() above */
-	  ay_toglcb_display(togl);
-	}
 
       if(pobject)
 	(void)ay_object_deletemulti(pobject, AY_FALSE);
@@ -17631,35 +18276,229 @@ ay_npt_addobjbid(ay_objbid **objbids, unsigned int *objbidslen,
 } /* ay_npt_addobjbid */
 
 
+/* ay_npt_hitbound:
+ *  helper for ay_npt_pickbounds() below;
+ *  pick boundary <bound> of the NURBS patch <o> as drawn by
+ *  ay_npatch_drawboundary() using the pick volume <mvp>;
+ *  the boundaries are picked via the control polygon (display mode 0),
+ *  the STESS tesselation (display mode 3), or the tesselated boundary
+ *  curve; trim curves (<bound> > 4) are picked via the <tcslen>
+ *  tesselated trim loops in <tps> (with <tcslens> points each)
+ */
+int
+ay_npt_hitbound(double *mvp, ay_object *o, unsigned int bound,
+		int tcslen, int *tcslens, double *tps)
+{
+ ay_nurbpatch_object *np = (ay_nurbpatch_object *)o->refine;
+ ay_stess_patch *stess = &(np->stess[0]);
+ ay_nurbcurve_object *nc = NULL;
+ double *cv, *pnts = NULL, depth = DBL_MAX;
+ int i, w, h, stride, npnts = 0, mode = ay_prefs.np_display_mode;
+ int hit = AY_FALSE;
+
+  if(bound == 4)
+    {
+      for(i = 0; i < 4; i++)
+	{
+	  if(ay_npt_hitbound(mvp, o, i, 0, NULL, NULL) == AY_TRUE)
+	    return AY_TRUE;
+	}
+      return AY_FALSE;
+    }
+
+  if(bound > 4)
+    {
+      if(!tps || (int)bound-5 >= tcslen)
+	return AY_FALSE;
+      for(i = 0; i < (int)bound-5; i++)
+	tps += tcslens[i]*3;
+      return ay_objsel_hitstrip(mvp, tps, tcslens[bound-5], 3, AY_FALSE,
+				&depth);
+    }
+
+  if(np->display_mode != 0)
+    mode = np->display_mode-1;
+
+  if(mode == 0 || (mode == 3 && stess->tessv))
+    {
+      if(mode == 0)
+	{
+	  cv = np->controlv;
+	  w = np->width;
+	  h = np->height;
+	  stride = 4;
+	}
+      else
+	{
+	  cv = stess->tessv;
+	  w = stess->tessw;
+	  h = stess->tessh;
+	  stride = 6;
+	}
+
+      switch(bound)
+	{
+	case 0:
+	  return ay_objsel_hitstrip(mvp, cv, w, stride*h, AY_FALSE, &depth);
+	case 1:
+	  return ay_objsel_hitstrip(mvp, &(cv[stride*(h-1)]), w, stride*h,
+				    AY_FALSE, &depth);
+	case 2:
+	  return ay_objsel_hitstrip(mvp, cv, h, stride, AY_FALSE, &depth);
+	case 3:
+	  return ay_objsel_hitstrip(mvp, &(cv[stride*h*(w-1)]), h, stride,
+				    AY_FALSE, &depth);
+	default:
+	  return AY_FALSE;
+	} /* switch */
+    }
+
+  /* tesselate the boundary curve */
+  if(ay_npt_extractnc(o, bound, 0.0, AY_FALSE, AY_FALSE, 0, NULL, &nc))
+    return AY_FALSE;
+
+  if(!ay_stess_CurvePoints3D(nc->length, nc->order-1, nc->knotv,
+			     nc->controlv, nc->is_rat, ay_prefs.stess_qf,
+			     &npnts, &pnts))
+    hit = ay_objsel_hitstrip(mvp, pnts, npnts, 3, AY_FALSE, &depth);
+
+  if(pnts)
+    free(pnts);
+
+  ay_nct_destroy(nc);
+
+ return hit;
+} /* ay_npt_hitbound */
+
+
+/* ay_npt_pickbounds:
+ *  helper for ay_npt_pickboundcb() below;
+ *  pick the boundaries of NURBS patch <p> (which is <o> or the
+ *  <pid>th patch provided by <o>) using the pick volume <mvp>
+ *  and record all hits in <objbids> (starting at index <ni>)
+ */
+int
+ay_npt_pickbounds(double *mvp, ay_object *o, ay_object *p, unsigned int pid,
+		  int complete, ay_objbid **objbids, unsigned int *objbidslen,
+		  unsigned int *ni)
+{
+ int ay_status = AY_OK;
+ ay_nurbpatch_object *np = (ay_nurbpatch_object *)p->refine;
+ ay_object *d;
+ double **tcs = NULL, *tps = NULL;
+ int i, tcslen = 0, *tcslens = NULL, cached = AY_FALSE;
+ unsigned int bid;
+
+  if(!np)
+    return AY_ENULL;
+
+  if(!complete)
+    {
+      for(bid = 0; bid < 4; bid++)
+	{
+	  if(ay_npt_hitbound(mvp, p, bid, 0, NULL, NULL) == AY_TRUE)
+	    {
+	      ay_status = ay_npt_addobjbid(objbids, objbidslen, *ni,
+					   o, pid, bid);
+	      if(ay_status)
+		return ay_status;
+	      (*ni)++;
+	    }
+	}
+      return AY_OK;
+    }
+
+  d = p->down;
+  if(!(d && d->next))
+    {
+      if(ay_npt_hitbound(mvp, p, 4, 0, NULL, NULL) == AY_TRUE)
+	{
+	  ay_status = ay_npt_addobjbid(objbids, objbidslen, *ni, o, pid, 4);
+	  if(!ay_status)
+	    (*ni)++;
+	}
+      return ay_status;
+    }
+
+  /* trim curves; use the tesselation of STESS, if present */
+  if(np->stess[0].tcspnts)
+    {
+      tcslen = np->stess[0].tcslen;
+      tcslens = np->stess[0].tcslens;
+      tps = np->stess[0].tcspnts;
+      cached = AY_TRUE;
+    }
+  else
+    {
+      if(ay_stess_TessTrimCurves(p, ay_prefs.stess_qf, &tcslen, &tcs,
+				 &tcslens, NULL))
+	goto cleanup;
+
+      if(ay_stess_ReTessTrimCurves(p, ay_prefs.stess_qf, tcslen, tcs,
+				   tcslens, &tps))
+	goto cleanup;
+    }
+
+  bid = 5;
+  while(d && d->next)
+    {
+      if(ay_npt_hitbound(mvp, p, bid, tcslen, tcslens, tps) == AY_TRUE)
+	{
+	  ay_status = ay_npt_addobjbid(objbids, objbidslen, *ni, o, pid, bid);
+	  if(ay_status)
+	    goto cleanup;
+	  (*ni)++;
+	}
+      bid++;
+      d = d->next;
+    }
+
+cleanup:
+
+  if(!cached)
+    {
+      if(tcs)
+	{
+	  for(i = 0; i < tcslen; i++)
+	    {
+	      free(tcs[i]);
+	    }
+	  free(tcs);
+	}
+
+      if(tcslens)
+	free(tcslens);
+
+      if(tps)
+	free(tps);
+    }
+
+ return ay_status;
+} /* ay_npt_pickbounds */
+
+
 /* ay_npt_pickboundcb:
  *  Togl callback to implement picking a boundary curve
- *  of a NURBS surface
+ *  of a NURBS surface;
+ *  the boundaries are picked on the CPU (see also contrib/objsel.c)
  */
 int
 ay_npt_pickboundcb(struct Togl *togl, int argc, char *argv[])
 {
  Tcl_Interp *interp = ay_interp;
  /*char fname[] = "pickBound_cb";*/
- ay_view_object *view = (ay_view_object *)Togl_GetClientData(togl);
- int width = Togl_Width(togl);
- int height = Togl_Height(togl);
- int i, k;
- GLdouble aspect = ((GLdouble) width) / ((GLdouble) height);
- double m[16];
+ int k;
+ double pm[16], m[16], mvp[16];
  double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
  double x = 0.0, y = 0.0, boxw = 0.0, boxh = 0.0;
  ay_list_object *sel = ay_selection;
- ay_object *o, *d;
+ ay_object *o;
  ay_object *pobject, **pobjects = NULL;
- GLuint j, ni = 1, *s, namecnt, name;
- GLuint selectbuf[1024];
- GLint hits;
- GLint viewport[4];
  ay_objbid *objbids = NULL;
- unsigned int objbidslen = 256, pid, bid;
+ unsigned int objbidslen = 256, ni = 1, name, pid, bid;
  int hit = AY_FALSE, drag = AY_FALSE, rem = AY_FALSE, flash = AY_FALSE;
  int complete = AY_FALSE;
- double *trafos = NULL, tolerance;
+ double *trafos = NULL;
 
   if(!(objbids = calloc(objbidslen, sizeof(ay_objbid))))
     return TCL_OK;
@@ -17691,49 +18530,14 @@ ay_npt_pickboundcb(struct Togl *togl, int argc, char *argv[])
       boxw = ay_prefs.object_pick_epsilon;
     }
 
-  tolerance = ay_prefs.glu_sampling_tolerance;
-  ay_prefs.glu_sampling_tolerance = 120.0;
-
-  Togl_MakeCurrent(togl);
-
-  glGetIntegerv(GL_VIEWPORT, viewport);
-
-  glSelectBuffer(1024, selectbuf);
-  glRenderMode(GL_SELECT);
-
-  glInitNames();
-  glPushName(0);
-
-  glMatrixMode(GL_PROJECTION);
-  glPushMatrix();
-  glLoadIdentity();
-  gluPickMatrix(x, (GLdouble) (viewport[3] - y), boxw, boxh, viewport);
-
-  /* Setup projection code from viewt.c */
-  if(view->type == AY_VTPERSP)
-    glFrustum(-aspect * view->zoom, aspect * view->zoom,
-	       -1.0 * view->zoom, 1.0 * view->zoom, 1, 1000.0);
-  else
-    glOrtho(-aspect * view->zoom, aspect * view->zoom,
-	     -1.0 * view->zoom, 1.0 * view->zoom, -100.0, 100.0);
-
-  if(view->roll != 0.0)
-    glRotated(view->roll, 0.0, 0.0, 1.0);
-  if(view->type != AY_VTTOP)
-    gluLookAt(view->from[0], view->from[1], view->from[2],
-	       view->to[0], view->to[1], view->to[2],
-	       view->up[0], view->up[1], view->up[2]);
-  else
-    gluLookAt(view->from[0], view->from[1], view->from[2],
-	       view->to[0], view->to[1], view->to[2],
-	       view->up[0], view->up[1], view->up[2]);
-
-  glMatrixMode(GL_MODELVIEW);
+  /* projection (restricted to the pick region) and parent transformations */
+  ay_objsel_pickmatrix(togl, x, y, boxw, boxh, pm);
 
   if(ay_currentlevel->object != ay_root)
     {
-      glPushMatrix();
-      ay_trafo_concatparent(ay_currentlevel->next);
+      ay_trafo_identitymatrix(m);
+      ay_trafo_getparent(ay_currentlevel->next, m);
+      ay_trafo_multmatrix(pm, m);
     }
 
   while(sel)
@@ -17742,190 +18546,85 @@ ay_npt_pickboundcb(struct Togl *togl, int argc, char *argv[])
 
       if(o->type == AY_IDNPATCH)
 	{
-	  glPushMatrix();
-	   glTranslated((GLdouble)o->movx, (GLdouble)o->movy,
-			(GLdouble)o->movz);
-	   ay_quat_torotmatrix(o->quat, m);
-	   glMultMatrixd((GLdouble*)m);
-	   glScaled((GLdouble)o->scalx, (GLdouble)o->scaly,
-		    (GLdouble)o->scalz);
-
-	   if(!complete)
-	     {
-	       for(i = 0; i < 4; i++)
-		 {
-		   if(ay_npt_addobjbid(&objbids, &objbidslen, ni, o, 0, i))
-		     goto cleanup;
-		   glPushName(ni);
-		    ay_npatch_drawboundary(o, NULL, i);
-		   glPopName();
-		   ni++;
-		 }
-	     }
-	   else
-	     {
-	       d = o->down;
-	       if(!(d && d->next))
-		 {
-		   if(ay_npt_addobjbid(&objbids, &objbidslen, ni, o, 0, 4))
-		     goto cleanup;
-		   glPushName(ni);
-		    ay_npatch_drawboundary(o, NULL, 4);
-		   glPopName();
-		   ni++;
-		 }
-
-	       i = 5;
-	       while(d && d->next)
-		 {
-		   if(ay_npt_addobjbid(&objbids, &objbidslen, ni, o, 0, i))
-		     goto cleanup;
-		   glPushName(ni);
-		    ay_npatch_drawboundary(o, NULL, i);
-		   glPopName();
-		   ni++;
-		   i++;
-
-		   d = d->next;
-		 }
-	     } /* if complete */
-	   glPopMatrix();
-	 }
-       else
-	 {
-	   k = 0;
-	   ay_peek_object(o, AY_IDNPATCH, &pobjects, &trafos);
-	   if(pobjects)
-	     {
-	       pobject = pobjects[0];
-	       while(pobject && pobject != ay_endlevel)
-		 {
-		   glPushMatrix();
-		   if(trafos)
-		     glMultMatrixd(&(trafos[k*16]));
-
-		   if(!complete)
-		     {
-		       for(i = 0; i < 4; i++)
-			 {
-			   if(ay_npt_addobjbid(&objbids, &objbidslen, ni,
-					       o, k, i))
-			     goto cleanup;
-			   glPushName(ni);
-			   ay_npatch_drawboundary(pobject, NULL, i);
-			   glPopName();
-			   ni++;
-			 }
-		     }
-		   else
-		     {
-		       d = pobject->down;
-		       if(!(d && d->next))
-			 {
-			   if(ay_npt_addobjbid(&objbids, &objbidslen, ni,
-					       o, 0, 4))
-			     goto cleanup;
-			   glPushName(ni);
-			    ay_npatch_drawboundary(o, NULL, 4);
-			   glPopName();
-			   ni++;
-			 }
-
-		       i = 5;
-		       while(d && d->next)
-			 {
-			   if(ay_npt_addobjbid(&objbids, &objbidslen, ni,
-					       o, k, i))
-			     goto cleanup;
-			   glPushName(ni);
-			    ay_npatch_drawboundary(pobject, NULL, i);
-			   glPopName();
-			   ni++;
-			   i++;
-
-			   d = d->next;
-			 }
-		     } /* if complete */
-		   glPopMatrix();
-		   k++;
-		   pobject = pobjects[k];
-		 } /* while */
-	       free(pobjects);
-	       pobjects = NULL;
-	       if(trafos)
-		 free(trafos);
-	       trafos = NULL;
-	     } /* if have provided objects */
-	 } /* if is NPatch */
-
-      sel = sel->next;
-    } /* while */
+	  memcpy(mvp, pm, 16*sizeof(double));
+	  ay_trafo_creatematrix(o, m);
+	  ay_trafo_multmatrix(mvp, m);
 
-  if(ay_currentlevel->object != ay_root)
-    {
-      glPopMatrix();
-    }
+	  if(ay_npt_pickbounds(mvp, o, o, 0, complete,
+			       &objbids, &objbidslen, &ni))
+	    goto cleanup;
+	}
+      else
+	{
+	  k = 0;
+	  ay_peek_object(o, AY_IDNPATCH, &pobjects, &trafos);
+	  if(pobjects)
+	    {
+	      pobject = pobjects[0];
+	      while(pobject && pobject != ay_endlevel)
+		{
+		  memcpy(mvp, pm, 16*sizeof(double));
+		  if(trafos)
+		    ay_trafo_multmatrix(mvp, &(trafos[k*16]));
 
-  glMatrixMode(GL_PROJECTION);
-  glPopMatrix();
-  glFinish();
+		  if(ay_npt_pickbounds(mvp, o, pobject, k, complete,
+				       &objbids, &objbidslen, &ni))
+		    goto cleanup;
 
-  hits = glRenderMode(GL_RENDER);
+		  k++;
+		  pobject = pobjects[k];
+		} /* while */
+	      free(pobjects);
+	      pobjects = NULL;
+	      if(trafos)
+		free(trafos);
+	      trafos = NULL;
+	    } /* if have provided objects */
+	} /* if is NPatch */
 
-  ay_prefs.glu_sampling_tolerance = tolerance;
+      sel = sel->next;
+    } /* while */
 
   /* process hits */
-  s = selectbuf;
-  for(i = 0; i < hits; i++)
+  for(name = 1; name < ni; name++)
     {
-      namecnt = *s;
-      s += 3;
-
-      for(j = 0; j < namecnt; j++)
+      /*printf("Got hit %u\n",name);*/
+      o = (objbids[name]).obj;
+      pid = (objbids[name]).pid;
+      bid = (objbids[name]).bid;
+      if(o)
 	{
-	  name = *s;
-	  if(name != 0)
+	  hit = AY_TRUE;
+	  if(flash)
+	    {
+	      /*ay_npatch_flashbound(o, (objbids[name]).bid);*/
+	    }
+	  else
 	    {
-	      /*printf("Got hit %u\n",name);*/
-	      o = (objbids[name]).obj;
-	      pid = (objbids[name]).pid;
-	      bid = (objbids[name]).bid;
-	      if(o)
+	      if(drag)
 		{
-		  hit = AY_TRUE;
-		  if(flash)
+		  /* mouse drag */
+		  if(rem)
 		    {
-		      /*ay_npatch_flashbound(o, (objbids[name]).bid);*/
+		      /* <shift> held */
+		      ay_npt_deselectbound(o, pid, bid);
 		    }
 		  else
 		    {
-		      if(drag)
-			{
-			  /* mouse drag */
-			  if(rem)
-			    {
-			      /* <shift> held */
-			      ay_npt_deselectbound(o, pid, bid);
-			    }
-			  else
-			    {
-			      if(!ay_npt_isboundselected(o, pid, bid))
-				ay_npt_selectbound(o, pid, bid, AY_TRUE);
-			    }
-			}
-		      else
-			{
-			  /* mouse click */
-			  if(ay_npt_isboundselected(o, pid, bid))
-			    ay_npt_deselectbound(o, pid, bid);
-			  else
-			    ay_npt_selectbound(o, pid, bid, AY_TRUE);
-			}
+		      if(!ay_npt_isboundselected(o, pid, bid))
+			ay_npt_selectbound(o, pid, bid, AY_TRUE);
 		    }
-		} /* if */
-	    } /* if */
-	  s++;
-	} /* for */
+		}
+	      else
+		{
+		  /* mouse click */
+		  if(ay_npt_isboundselected(o, pid, bid))
+		    ay_npt_deselectbound(o, pid, bid);
+		  else
+		    ay_npt_selectbound(o, pid, bid, AY_TRUE);
+		}
+	    }
+	} /* if */
     } /* for */
 
   if(drag && !hit)
@@ -17946,6 +18645,12 @@ cleanup:
   if(objbids)
     free(objbids);
 
+  if(pobjects)
+    free(pobjects);
+
+  if(trafos)
+    free(trafos);
+
  return TCL_OK;
 } /* ay_npt_pickboundcb */
 
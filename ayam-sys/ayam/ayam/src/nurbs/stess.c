@@ -18,11 +18,92 @@
 #define AY_STESSEPSILON 0.000001
 /*#define AY_STESSDBG 1*/
 
+/* minimum number of points for a parallel evaluation of the grid */
+#define AY_STESSMINPARPTS 4096
+/* initial number of points allocated per tesselated line */
+#define AY_STESSLINEINITSIZE 64
+
+/* types local to this module: */
+typedef struct ay_stess_gridjob_s {
+  int n, m, p, q; /* width, height, degrees */
+  double *U, *V, *Pw; /* knots and control points */
+  int is_rat;
+  int nu; /* number of parametric values in u */
+  double *us; /* parametric values in u */
+  int nv; /* number of parametric values in v */
+  double *vs; /* parametric values in v */
+  int chunk; /* number of u values per work item */
+  double *C; /* resulting points and normals */
+} ay_stess_gridjob;
+
+typedef struct ay_stess_line_s {
+  int len; /* number of points */
+  int alloc; /* number of allocated points */
+  char *types; /* point types (see ay_stess_lines) */
+  double *uv; /* parametric values */
+} ay_stess_line;
+
+/* triangle strip that is collected into a shading vertex buffer */
+typedef struct ay_stess_strip_s {
+  ay_vbuf *vb; /* target vertex buffer */
+  unsigned int a, b; /* indices of the last two vertices */
+  int n; /* number of vertices in the current strip */
+  int status; /* AY_EOMEM if a triangle could not be stored */
+} ay_stess_strip;
+
+typedef struct ay_stess_trimjob_s {
+  ay_nurbpatch_object *p; /* the patch to tesselate */
+  int numtrims; /* number of tesselated trim curves */
+  double **tcs; /* tesselated trim curves */
+  int *tcslens; /* number of points per trim curve */
+  int dir; /* 0 - lines of constant u, 1 - lines of constant v */
+  int numlines; /* number of lines */
+  double *params; /* constant parametric value per line */
+  double min[2], max[2], d[2]; /* parametric ranges and steps */
+  ay_stess_line *lines; /* temporary lines [numlines] */
+  int nthreads; /* number of threads */
+  ay_stess_line *isects; /* intersections per thread [nthreads] */
+  double **ders; /* derivative scratch memory per thread [nthreads] */
+  ay_stess_lines *result; /* final lines */
+} ay_stess_trimjob;
+
 /* prototypes of functions local to this module: */
+int ay_stess_SurfacePointsGridcb(void *data, int item, int thread);
+
+int ay_stess_LineAdd(ay_stess_line *l, double u, double v, char type);
+
+int ay_stess_TrimJobInit(ay_nurbpatch_object *p, int qf, int numtrims,
+			 double **tcs, int *tcslens, int dir, int numlines,
+			 ay_stess_trimjob *job);
+
+void ay_stess_TrimJobFree(ay_stess_trimjob *job);
+
+int ay_stess_TessTrimmedLinecb(void *data, int item, int thread);
+
+int ay_stess_EvalLinecb(void *data, int item, int thread);
+
+int ay_stess_TessTrimmedLines(ay_object *o, int qf, int numtrims,
+			      double **tcs, int *tcslens, int dir,
+			      ay_stess_lines *result);
+
+void ay_stess_FreeLines(ay_stess_lines *lines);
+
+void ay_stess_DrawLines(ay_stess_lines *lines);
+
+void ay_stess_StripBegin(ay_stess_strip *strip);
+
+void ay_stess_StripVertex(ay_stess_strip *strip, unsigned int i);
+
+int ay_stess_TrimmedSurfaceVB(ay_stess_patch *stess);
+
 void ay_stess_FindMultiplePoints(int n, int p, double *U, double *P,
 				 int dim, int is_rat, int stride,
 				 int *m, double **V);
 
+int ay_stess_SurfacePointsGrid(int n, int m, int p, int q,
+			       double *U, double *V, double *Pw, int is_rat,
+			       int qf, int *Cn, int *Cm, double **C);
+
 int ay_stess_IntersectLines2D(double *p1, double *p2, double *p3, double *p4,
 			      double *ip);
 
@@ -32,19 +113,7 @@ void ay_stess_TessTrimCurve(ay_object *o, double **tts, int *tls, int *tds,
 void ay_stess_TessLinearTrimCurve(ay_object *o, double **tts, int *tls,
 				  int *tds, int *i);
 
-int ay_stess_MergeUVectors(ay_stess_uvp *a, ay_stess_uvp *b);
-
-int ay_stess_MergeVVectors(ay_stess_uvp *a, ay_stess_uvp *b);
-
-void ay_stess_SortIntersections(ay_stess_uvp *list, int u);
-
-int ay_stess_TessTrimmedNPU(ay_object *o, int qf, int numtrims,
-			    double **tcs, int *tcslens, int *tcsdirs,
-			    int *reslen, ay_stess_uvp ***result);
-
-int ay_stess_TessTrimmedNPV(ay_object *o, int qf, int numtrims,
-			    double **tcs, int *tcslens, int *tcsdirs,
-			    int *reslen, ay_stess_uvp ***result);
+void ay_stess_SortIntersections(double *uv, int num, int dim);
 
 int ay_stess_AddBoundaryTrim(ay_object *o);
 
@@ -63,8 +132,6 @@ ay_stess_destroy(ay_stess_patch *stess)
 {
  ay_voidfp *arr = NULL;
  ay_deletecb *cb = NULL;
- ay_stess_uvp *p = NULL;
- int i;
 
   if(!stess)
     return;
@@ -72,33 +139,13 @@ ay_stess_destroy(ay_stess_patch *stess)
   if(stess->tessv)
     free(stess->tessv);
 
-  if(stess->ups)
-    {
-      for(i = 0; i < stess->upslen; i++)
-	{
-	  while(stess->ups[i])
-	    {
-	      p = stess->ups[i]->next;
-	      free(stess->ups[i]);
-	      stess->ups[i] = p;
-	    }
-	}
-      free(stess->ups);
-    }
+  ay_shade_vbuffree(&(stess->vb));
 
-  if(stess->vps)
-    {
-      for(i = 0; i < stess->vpslen; i++)
-	{
-	  while(stess->vps[i])
-	    {
-	      p = stess->vps[i]->next;
-	      free(stess->vps[i]);
-	      stess->vps[i] = p;
-	    }
-	}
-      free(stess->vps);
-    }
+  ay_shade_vbuffree(&(stess->vpsvb));
+
+  ay_stess_FreeLines(&(stess->ups));
+
+  ay_stess_FreeLines(&(stess->vps));
 
   if(stess->tcslens)
     free(stess->tcslens);
@@ -414,163 +461,131 @@ int
 ay_stess_CurvePoints3D(int n, int p, double *U, double *Pw, int is_rat, int qf,
 		       int *Clen, double **C)
 {
- int span, j, k, l, m, mc = 0, vi, incu, mc1 = 0;
- double *N = NULL, Cw[4], *Ct = NULL, u, ud, u1, *V;
+ int ay_status = AY_OK, l, mc = 0, vi, incu, mc1 = 0;
+ double *Ct = NULL, *us = NULL, u, ud, u1, *V;
 
   if(!U || !Pw || !Clen || !C)
     return AY_ENULL;
 
-  if(!(N = calloc(3*(p+1), sizeof(double))))
-    return AY_EOMEM;
-
   ay_stess_FindMultiplePoints(n, p, U, Pw, 3, is_rat, 4, &mc, &V);
 
   *Clen = ((4 + n) * qf);
 
   if(!(Ct = calloc((*Clen + mc) * 3, sizeof(double))))
     {
-      free(N);
-      if(V)
-	free(V);
-      return AY_EOMEM;
+      ay_status = AY_EOMEM;
+      goto cleanup;
     }
 
-  m = 0;
+  if(!(us = malloc((*Clen + mc) * sizeof(double))))
+    {
+      ay_status = AY_EOMEM;
+      goto cleanup;
+    }
+
+  /* first, compile all parametric values (including the
+     multiple points), then evaluate them in one go */
   ud = (U[n]-U[p])/((*Clen)-1);
   u = U[p];
   vi = 0;
-  if(is_rat)
-    {
-      /* curve is rational */
-      for(l = 0; l < (*Clen) + mc; l++)
-	{
-	  u1 = u;
-	  incu = AY_TRUE;
-	  /* are there unprocessed multiple points? */
-	  if((mc > 0) && (vi < mc))
-	    { /* yes */
-	      /* is V[vi] between u-ud and u? (by calculating u we would
-		 step over the multiple point V[vi]) */
-	      if((u-ud < V[vi]) && (V[vi] < u))
-		{
-		  /* is V[vi] sufficiently different from u? */
-		  if(fabs(u - V[vi]) > AY_EPSILON)
-		    { /* yes */
-		      /* calculate multiple point before u and remember
-			 to not increase u by ud in this iteration */
-		      u1 = V[vi];
-		      vi++;
-		      mc1++;
-		      incu = AY_FALSE;
-		    }
-		  else
-		    { /* no */
-		      /* simply skip this multiple point, it would not
-			 add value to the tesselation anyway */
-		      vi++;
-		    } /* if */
-		} /* if */
-	    } /* if */
-
-	  span = ay_nb_FindSpan(n-1, p, u1, U);
-
-	  ay_nb_BasisFunsM(span, u1, p, U, N);
-
-	  memset(Cw, 0, 4*sizeof(double));
-
-	  for(j = 0; j <= p; j++)
+  for(l = 0; l < (*Clen) + mc; l++)
+    {
+      u1 = u;
+      incu = AY_TRUE;
+      /* are there unprocessed multiple points? */
+      if((mc > 0) && (vi < mc))
+	{ /* yes */
+	  /* is V[vi] between u-ud and u? (by calculating u we would
+	     step over the multiple point V[vi]) */
+	  if((u-ud < V[vi]) && (V[vi] < u))
 	    {
-	      k = (span-p+j)*4;
-	      Cw[0] = Cw[0] + N[j]*Pw[k]*Pw[k+3];
-	      Cw[1] = Cw[1] + N[j]*Pw[k+1]*Pw[k+3];
-	      Cw[2] = Cw[2] + N[j]*Pw[k+2]*Pw[k+3];
-	      Cw[3] = Cw[3] + N[j]*Pw[k+3];
-	    }
-
-	  Ct[m]	  = Cw[0]/Cw[3];
-	  Ct[m+1] = Cw[1]/Cw[3];
-	  Ct[m+2] = Cw[2]/Cw[3];
-
-	  m += 3;
-	  if(incu)
-	    u += ud;
-	} /* for */
-    }
-  else
-    {
-      /* curve is not rational */
-      for(l = 0; l < (*Clen) + mc; l++)
-	{
-	  u1 = u;
-	  incu = AY_TRUE;
-	  /* are there unprocessed multiple points? */
-	  if((mc > 0) && (vi < mc))
-	    { /* yes */
-	      /* is V[vi] between u-ud and u (by calculating u we would
-		 step over the multiple point V[vi]) */
-	      if((u-ud < V[vi]) && (V[vi] < u))
+	      /* is V[vi] sufficiently different from u? */
+	      if(fabs(u - V[vi]) > AY_EPSILON)
 		{ /* yes */
-		  /* is V[vi] sufficiently different from u? */
-		  if(fabs(u - V[vi]) > AY_EPSILON)
-		    { /* yes */
-		      /* calculate multiple point before u and remember
-			 to not increase u by ud in this iteration */
-		      u1 = V[vi];
-		      vi++;
-		      mc1++;
-		      incu = AY_FALSE;
-		    }
-		  else
-		    { /* no */
-		      /* simply skip this multiple point, it would not
-			 add value to the tesselation anyway */
-		      vi++;
-		    } /* if */
+		  /* calculate multiple point before u and remember
+		     to not increase u by ud in this iteration */
+		  u1 = V[vi];
+		  vi++;
+		  mc1++;
+		  incu = AY_FALSE;
+		}
+	      else
+		{ /* no */
+		  /* simply skip this multiple point, it would not
+		     add value to the tesselation anyway */
+		  vi++;
 		} /* if */
 	    } /* if */
+	} /* if */
 
-	  span = ay_nb_FindSpan(n-1, p, u1, U);
-
-	  ay_nb_BasisFunsM(span, u1, p, U, N);
+      us[l] = u1;
 
-	  for(j = 0; j <= p; j++)
-	    {
-	      k = (span-p+j)*4;
-	      Ct[m]   = Ct[m]	+ N[j]*Pw[k];
-	      Ct[m+1] = Ct[m+1] + N[j]*Pw[k+1];
-	      Ct[m+2] = Ct[m+2] + N[j]*Pw[k+2];
-	    }
+      if(incu)
+	u += ud;
+    } /* for */
 
-	  m += 3;
-	  if(incu)
-	    u += ud;
-	} /* for */
-    } /* if */
+  ay_status = ay_nb_CurvePoints4D(n-1, p, U, Pw, is_rat, (*Clen) + mc, us,
+				  3, Ct, NULL);
+  if(ay_status)
+    goto cleanup;
 
   *C = Ct;
+  Ct = NULL;
   *Clen += mc1;
 
-  free(N);
+cleanup:
+
+  if(Ct)
+    free(Ct);
+  if(us)
+    free(us);
   if(V)
     free(V);
 
- return AY_OK;
+ return ay_status;
 } /* ay_stess_CurvePoints3D */
 
 
-/* ay_stess_SurfacePoints3D:
- *   calculate all points of an untrimmed NURBS surface
+/* ay_stess_SurfacePointsGridcb:
+ *   work callback of ay_stess_SurfacePointsGrid(), calculates the
+ *   points of one chunk of u values
  */
 int
-ay_stess_SurfacePoints3D(int n, int m, int p, int q, double *U, double *V,
-			 double *P, int qf, int *Cn, int *Cm, double **C)
+ay_stess_SurfacePointsGridcb(void *data, int item, int thread)
+{
+ ay_stess_gridjob *job = (ay_stess_gridjob *)data;
+ int a, cnt;
+ double *C;
+
+  a = item * job->chunk;
+  cnt = job->chunk;
+  if(a + cnt > job->nu)
+    cnt = job->nu - a;
+
+  C = &(job->C[a*job->nv*6]);
+
+ return ay_nb_SurfacePointsGrid4D(job->n-1, job->m-1, job->p, job->q,
+				  job->U, job->V, job->Pw, job->is_rat,
+				  cnt, &(job->us[a]), job->nv, job->vs,
+				  6, C, &(C[3]));
+} /* ay_stess_SurfacePointsGridcb */
+
+
+/* ay_stess_SurfacePointsGrid:
+ *   calculate all points of an untrimmed NURBS surface on a regular
+ *   grid of parametric values using the batch evaluation kernel;
+ *   big grids are split into chunks of u values that are evaluated
+ *   in parallel
+ */
+int
+ay_stess_SurfacePointsGrid(int n, int m, int p, int q, double *U, double *V,
+			   double *Pw, int is_rat, int qf, int *Cn, int *Cm,
+			   double **C)
 {
  int ay_status = AY_OK;
- int spanu = 0, spanv = 0, j = 0;
- int a, b;
- double u, v, ud, vd;
- double temp[3] = {0}, *Ct = NULL, *fder = NULL, *fd1, *fd2;
- int *spanus = NULL, *spanvs = NULL;
+ int a, nchunks = 1;
+ double ud, vd, *Ct = NULL, *us = NULL, *vs;
+ ay_stess_gridjob job;
 
   *Cn = (4 + n) * qf;
   ud = (U[n] - U[p]) / ((*Cn) - 1);
@@ -578,113 +593,49 @@ ay_stess_SurfacePoints3D(int n, int m, int p, int q, double *U, double *V,
   *Cm = (4 + m) * qf;
   vd = (V[m] - V[q]) / ((*Cm) - 1);
 
-  if(!(Ct = calloc((*Cn)*(*Cm)*6, sizeof(double))))
-    { ay_status = AY_EOMEM; goto cleanup; }
-
-  if(!(spanus = calloc((*Cn)+(*Cm), sizeof(int))))
+  if(!(us = malloc(((*Cn)+(*Cm))*sizeof(double))))
     { ay_status = AY_EOMEM; goto cleanup; }
-  spanvs = spanus + (*Cn);
+  vs = us + (*Cn);
 
-  if(!(fder = malloc(ay_nb_FirstDerSurf3DMSize(p, q)*sizeof(double))))
+  if(!(Ct = malloc((*Cn)*(*Cm)*6*sizeof(double))))
     { ay_status = AY_EOMEM; goto cleanup; }
 
-  fd1 = &(fder[3]);
-  fd2 = &(fder[6]);
-
-  /* employ linear variants of FindSpan() as they are much faster
-     than a binary search; especially, since we calculate
-     spans for all parameters in order */
-
-  u = U[p];
-  spanu = p;
   for(a = 0; a < (*Cn)-1; a++)
-    {
-      /*
-	if(u < U[p+1])
-	{
-	spanus[a] = p;
-	}
-	else
-	{
-	while(u >= U[spanu])
-	{
-	spanu++;
-	}
-	spanus[a] = spanu-1;
-	}
-      */
-
-      if(u > U[p+1])
-	{
-	  while(u > U[spanu+1])
-	    {
-	      spanu++;
-	    }
-	}
-      spanus[a] = spanu;
+    us[a] = U[p] + a*ud;
+  us[a] = U[n];
 
-      u += ud;
-    }
-  spanus[a] = spanus[a-1];
-
-  v = V[q];
-  spanv = q;
   for(a = 0; a < (*Cm)-1; a++)
-    {
-      /*
-	if(v < V[q+1])
-	{
-	spanvs[a] = q;
-	}
-	else
-	{
-	while(v > V[spanv])
-	{
-	spanv++;
-	}
-	spanvs[a] = spanv-1;
-	}
-      */
-
-      if(v > V[q+1])
-	{
-	  while(v > V[spanv+1])
-	    {
-	      spanv++;
-	    }
-	}
-      spanvs[a] = spanv;
-      v += vd;
-    }
-  spanvs[a] = spanvs[a-1];
-
-  u = U[p];
-  for(a = 0; a < (*Cn); a++)
-    {
-      spanu = spanus[a];
-      v = V[q];
-      for(b = 0; b < (*Cm); b++)
-	{
-	  spanv = spanvs[b];
-
-	  /* calculate point and normal */
-	  fder[0] = (double)spanu;
-	  fder[1] = (double)spanv;
-	  fder[2] = 0.0;
-	  fder[3] = 0.0;
-	  ay_nb_FirstDerSurf3DM(n-1, m-1, p, q, U, V, P, u, v, fder);
-	  memcpy(&(Ct[j]), fder, 3*sizeof(double));
-
-	  AY_V3CROSS(temp, fd2, fd1);
-	  memcpy(&(Ct[j+3]), temp, 3*sizeof(double));
-
-	  j += 6;
-	  v += vd;
-	} /* for */
-
-      u += ud;
-    } /* for */
+    vs[a] = V[q] + a*vd;
+  vs[a] = V[m];
+
+  job.n = n;
+  job.m = m;
+  job.p = p;
+  job.q = q;
+  job.U = U;
+  job.V = V;
+  job.Pw = Pw;
+  job.is_rat = is_rat;
+  job.nu = *Cn;
+  job.us = us;
+  job.nv = *Cm;
+  job.vs = vs;
+  job.C = Ct;
+
+  /* use some more chunks than threads for a better load balance */
+  if((*Cn)*(*Cm) >= AY_STESSMINPARPTS)
+    nchunks = ay_tp_getnumthreads()*4;
+  if(nchunks > *Cn)
+    nchunks = *Cn;
+  job.chunk = ((*Cn) + nchunks - 1) / nchunks;
+  nchunks = ((*Cn) + job.chunk - 1) / job.chunk;
+
+  /* calculate points and normals */
+  ay_status = ay_tp_run(nchunks, ay_stess_SurfacePointsGridcb, &job);
+  if(ay_status)
+    goto cleanup;
 
+  /* return result */
   *C = Ct;
   Ct = NULL;
 
@@ -693,13 +644,23 @@ cleanup:
   if(Ct)
     free(Ct);
 
-  if(fder)
-    free(fder);
-
-  if(spanus)
-    free(spanus);
+  if(us)
+    free(us);
 
  return ay_status;
+} /* ay_stess_SurfacePointsGrid */
+
+
+/* ay_stess_SurfacePoints3D:
+ *   calculate all points of an untrimmed NURBS surface
+ */
+int
+ay_stess_SurfacePoints3D(int n, int m, int p, int q, double *U, double *V,
+			 double *P, int qf, int *Cn, int *Cm, double **C)
+{
+
+ return ay_stess_SurfacePointsGrid(n, m, p, q, U, V, P, AY_FALSE, qf,
+				   Cn, Cm, C);
 } /* ay_stess_SurfacePoints3D */
 
 
@@ -710,170 +671,36 @@ int
 ay_stess_SurfacePoints4D(int n, int m, int p, int q, double *U, double *V,
 			 double *Pw, int qf, int *Cn, int *Cm, double **C)
 {
- int ay_status = AY_OK;
- int spanu = 0, spanv = 0, j = 0;
- int a, b;
- double u, v, ud, vd;
- double *Ct = NULL, temp[3] = {0}, *fder = NULL, *fd1, *fd2;
- int *spanus = NULL, *spanvs = NULL;
-
-  *Cn = (4 + n) * qf;
-  ud = (U[n] - U[p]) / ((*Cn) - 1);
-
-  *Cm = (4 + m) * qf;
-  vd = (V[m] - V[q]) / ((*Cm) - 1);
-
-  if(!(spanus = calloc((*Cn)+(*Cm), sizeof(int))))
-    { ay_status = AY_EOMEM; goto cleanup; }
-  spanvs = spanus + (*Cn);
 
-  if(!(fder = malloc(ay_nb_FirstDerSurf4DMSize(p, q)*sizeof(double))))
-    { ay_status = AY_EOMEM; goto cleanup; }
+ return ay_stess_SurfacePointsGrid(n, m, p, q, U, V, Pw, AY_TRUE, qf,
+				   Cn, Cm, C);
+} /* ay_stess_SurfacePoints4D */
 
-  if(!(Ct = calloc((*Cn)*(*Cm)*6, sizeof(double))))
-    { ay_status = AY_EOMEM; goto cleanup; }
 
-  fd1 = &(fder[3]);
-  fd2 = &(fder[6]);
+/* ay_stess_IntersectLines2D:
+ *  Code taken from the c.g.algorithms FAQ, which in turn points to:
+ *  Graphics Gems III pp. 199-202 "Faster Line Segment Intersection"
+ *
+ *  Input:   p1[2],p2[2]; p3[2],p4[2] - 2 2D line segments
+ *  Returns: 0 - no intersection in the given segments
+ *	     1 - segments intersect in point ip
+ */
+int
+ay_stess_IntersectLines2D(double *p1, double *p2, double *p3, double *p4,
+			  double *ip)
+{
+ double r, s, den;
 
-  /* employ linear variants of FindSpan() as they are much faster
-     than a binary search; especially, since we calculate
-     spans for all parameters in order */
+  if(((fabs(p1[0]-p3[0])<=2*AY_EPSILON)&&(fabs(p1[1]-p3[1])<=2*AY_EPSILON)) ||
+     ((fabs(p1[0]-p4[0])<=2*AY_EPSILON)&&(fabs(p1[1]-p4[1])<=2*AY_EPSILON)))
+    {
+      ip[0] = p1[0];
+      ip[1] = p1[1];
+      return 1;
+    }
 
-  u = U[p];
-  spanu = p;
-  for(a = 0; a < (*Cn)-1; a++)
-    {
-      /*
-	if(u < U[p+1])
-	{
-	spanus[a] = p;
-	}
-	else
-	{
-	while(u > U[spanu])
-	{
-	spanu++;
-	}
-	spanus[a] = spanu-1;
-	}
-      */
-
-      if(u > U[p+1])
-	{
-	  while(u > U[spanu+1])
-	    {
-	      spanu++;
-	    }
-	}
-      spanus[a] = spanu;
-      u += ud;
-    }
-  spanus[a] = spanus[a-1];
-
-
-  v = V[q];
-  spanv = q;
-  for(a = 0; a < (*Cm)-1; a++)
-    {
-      /*
-	if(v < V[q+1])
-	{
-	spanvs[a] = q;
-	}
-	else
-	{
-	while(v > V[spanv])
-	{
-	spanv++;
-	}
-	spanvs[a] = spanv-1;
-	}
-      */
-
-      if(v > V[q+1])
-	{
-	  while(v > V[spanv+1])
-	    {
-	      spanv++;
-	    }
-	}
-      spanvs[a] = spanv;
-      v += vd;
-    }
-  spanvs[a] = spanvs[a-1];
-
-  u = U[p];
-  for(a = 0; a < (*Cn); a++)
-    {
-      spanu = spanus[a];
-      v = V[q];
-
-      for(b = 0; b < (*Cm); b++)
-	{
-	  spanv = spanvs[b];
-
-	  /* calculate point and normal */
-	  fder[0] = (double)spanu;
-	  fder[1] = (double)spanv;
-	  fder[2] = 0.0;
-	  fder[3] = 0.0;
-	  ay_nb_FirstDerSurf4DM(n-1, m-1, p, q, U, V, Pw, u, v, fder);
-	  memcpy(&(Ct[j]), fder, 3*sizeof(double));
-
-	  AY_V3CROSS(temp, fd2, fd1);
-	  memcpy(&(Ct[j+3]), temp, 3*sizeof(double));
-
-	  j += 6;
-	  v += vd;
-	} /* for */
-
-      u += ud;
-    } /* for */
-
-  /* return result */
-  *C = Ct;
-  Ct = NULL;
-
-cleanup:
-
-  if(Ct)
-    free(Ct);
-
-  if(fder)
-    free(fder);
-
-  if(spanus)
-    free(spanus);
-
- return ay_status;
-} /* ay_stess_SurfacePoints4D */
-
-
-/* ay_stess_IntersectLines2D:
- *  Code taken from the c.g.algorithms FAQ, which in turn points to:
- *  Graphics Gems III pp. 199-202 "Faster Line Segment Intersection"
- *
- *  Input:   p1[2],p2[2]; p3[2],p4[2] - 2 2D line segments
- *  Returns: 0 - no intersection in the given segments
- *	     1 - segments intersect in point ip
- */
-int
-ay_stess_IntersectLines2D(double *p1, double *p2, double *p3, double *p4,
-			  double *ip)
-{
- double r, s, den;
-
-  if(((fabs(p1[0]-p3[0])<=2*AY_EPSILON)&&(fabs(p1[1]-p3[1])<=2*AY_EPSILON)) ||
-     ((fabs(p1[0]-p4[0])<=2*AY_EPSILON)&&(fabs(p1[1]-p4[1])<=2*AY_EPSILON)))
-    {
-      ip[0] = p1[0];
-      ip[1] = p1[1];
-      return 1;
-    }
-
-  if(((fabs(p2[0]-p3[0])<=2*AY_EPSILON)&&(fabs(p2[1]-p3[1])<=2*AY_EPSILON)) ||
-     ((fabs(p2[0]-p4[0])<=2*AY_EPSILON)&&(fabs(p2[1]-p4[1])<=2*AY_EPSILON)))
+  if(((fabs(p2[0]-p3[0])<=2*AY_EPSILON)&&(fabs(p2[1]-p3[1])<=2*AY_EPSILON)) ||
+     ((fabs(p2[0]-p4[0])<=2*AY_EPSILON)&&(fabs(p2[1]-p4[1])<=2*AY_EPSILON)))
     {
       ip[0] = p2[0];
       ip[1] = p2[1];
@@ -1338,638 +1165,526 @@ ay_stess_ReTessTrimCurves(ay_object *o, int qf, int numtrims, double **tt,
 
 
 /* ay_stess_SortIntersections:
- *  sort a list of intersections for faster merging
+ *  sort the <num> intersection points in <uv> (pairs of parametric
+ *  values) ascending; only the parametric values in dimension <dim>
+ *  (0 - u, 1 - v) are considered and moved
  */
 void
-ay_stess_SortIntersections(ay_stess_uvp *list, int u)
+ay_stess_SortIntersections(double *uv, int num, int dim)
 {
- int done = AY_FALSE;
- ay_stess_uvp *p1, *p2;
+ int i, j;
  double t;
 
-  if(!list || !list->next)
-    return;
-
-  while(!done)
+  /* the number of intersections per line is small,
+     use insertion sort */
+  for(i = 1; i < num; i++)
     {
-      done = AY_TRUE;
-
-      p1 = list;
-      p2 = p1->next;
-      while(p1 && p2)
+      t = uv[i*2+dim];
+      j = i-1;
+      while(j >= 0 && uv[j*2+dim] > t)
 	{
-	  if(u)
-	    {
-	      if(p1->u > p2->u)
-		{
-		  t = p1->u;
-		  p1->u = p2->u;
-		  p2->u = t;
-		  done = AY_FALSE;
-		}
-	    }
-	  else
-	    {
-	      if(p1->v > p2->v)
-		{
-		  t = p1->v;
-		  p1->v = p2->v;
-		  p2->v = t;
-		  done = AY_FALSE;
-		}
-	    }
-
-	  p1 = p1->next;
-	  p2 = p2->next;
-	} /* while p1 && p2 */
-    } /* while !done */
+	  uv[(j+1)*2+dim] = uv[j*2+dim];
+	  j--;
+	}
+      uv[(j+1)*2+dim] = t;
+    } /* for */
 
  return;
 } /* ay_stess_SortIntersections */
 
 
-/* ay_stess_TessTrimmedNPU:
- *  tesselate NURBS patch <o> into lines in parametric direction u
+/* ay_stess_LineAdd:
+ *  append a point to the temporary line <l>
  */
 int
-ay_stess_TessTrimmedNPU(ay_object *o, int qf, int numtrims,
-			double **tcs, int *tcslens, int *tcsdirs,
-			int *reslen, ay_stess_uvp ***result)
+ay_stess_LineAdd(ay_stess_line *l, double u, double v, char type)
 {
- int ay_status = AY_OK;
- ay_nurbpatch_object *p = NULL;
- ay_stess_uvp **uvps = NULL, *uvpptr, *newuvp, **nextuvp, *trimuvp;
- ay_stess_uvp *nexttrimuvp, *olduvp;
- double *tt, ipoint[2] = {0};
- double p3[2], p4[2], *U, *V, u, v;
- double *fd1, *fd2, temp[3] = {0}, *ders = NULL;
- double umin, umax, vmin, vmax, ud, vd;
- int i, k, l, ind;
- int out = 0;
- int Cm, Cn;
-
-  p = (ay_nurbpatch_object *)o->refine;
+ int alloc;
+ double *uv;
+ char *types;
 
-  Cn = (p->width + 4) * qf;
-  *reslen = Cn;
-  Cm = (p->height + 4) * qf;
-  if(!(uvps = calloc(Cn, sizeof(ay_stess_uvp *))))
+  if(l->len >= l->alloc)
     {
-      return AY_EOMEM;
-    }
-
-  U = p->uknotv;
-  umin = U[p->uorder-1];
-  umax = U[p->width];
-  ud = (umax-umin)/((Cn)-1);
+      if(l->alloc > 0)
+	alloc = 2*l->alloc;
+      else
+	alloc = AY_STESSLINEINITSIZE;
 
-  V = p->vknotv;
-  vmin = V[p->vorder-1];
-  vmax = V[p->height];
-  vd = (vmax-vmin)/((Cm)-1);
+      if(!(uv = realloc(l->uv, alloc*2*sizeof(double))))
+	return AY_EOMEM;
+      l->uv = uv;
 
-  u = umin;
-  p3[1] = vmin - AY_EPSILON;
-  p4[1] = vmax + AY_EPSILON;
+      if(!(types = realloc(l->types, alloc*sizeof(char))))
+	return AY_EOMEM;
+      l->types = types;
 
-  for(i = 0; i < Cn; i++)
-    {
-      nextuvp = &trimuvp;
-      olduvp = NULL;
-      trimuvp = NULL;
+      l->alloc = alloc;
+    } /* if */
 
-      if(i == Cn-1)
-	u = umax;
-      p3[0] = u;
-      p4[0] = u;
+  l->uv[l->len*2] = u;
+  l->uv[l->len*2+1] = v;
+  l->types[l->len] = type;
+  l->len++;
 
-      /* calc all intersections of all trimloops with current u */
-      for(k = 0; k < numtrims; k++)
-	{
-	  tt = tcs[k];
+ return AY_OK;
+} /* ay_stess_LineAdd */
 
-	  for(l = 0; l < (tcslens[k]-1); l++)
-	    {
-	      ind = l*2;
 
-	      /* is section crossing or touching u? */
-	      if(((tt[ind] <= (u + AY_EPSILON))
-		  && (tt[ind+2] >= (u - AY_EPSILON))) ||
-		 ((tt[ind] >= (u - AY_EPSILON)) &&
-		  (tt[ind+2] <= (u + AY_EPSILON))))
-		{
-		  /* weed out all sections that run (more or less)
-		     exactly along the current u-line, nothing good
-		     comes of them */
-		  if((fabs(tt[ind] - u) < AY_EPSILON) &&
-		     (fabs(tt[ind+2] - u) < AY_EPSILON))
-		    {
-#ifdef AY_STESSDBG
-		      printf("Discarding parallel section.\n");
-#endif
-		      continue;
-		    }
-		  ipoint[0] = 0.0;
-		  ipoint[1] = 0.0;
+/* ay_stess_TrimJobInit:
+ *  prepare a job for the parallel tesselation of the trimmed NURBS
+ *  patch <p> into <numlines> lines in dimension <dir> (0 - u, 1 - v)
+ */
+int
+ay_stess_TrimJobInit(ay_nurbpatch_object *p, int qf, int numtrims,
+		     double **tcs, int *tcslens, int dir, int numlines,
+		     ay_stess_trimjob *job)
+{
+ int i, nthreads, size;
+ int Cm, Cn;
+ double s;
 
-		  if((ay_stess_IntersectLines2D(&(tt[ind]),
-						&(tt[ind+2]),
-						p3, p4, ipoint)))
-		    {
-		      /* u-line intersects with trimcurve */
-		      /* => add new point (but avoid consecutive
-			 equal points; those appear if a loop touches
-			 start or end of the current u-line) */
-		      if(!olduvp ||
-			 fabs(olduvp->v - ipoint[1]) > AY_EPSILON)
-			{
-			  if(!(newuvp = calloc(1, sizeof(ay_stess_uvp))))
-			    {
-			      ay_status = AY_EOMEM;
-			      goto cleanup;
-			    }
-			  newuvp->type = 1;
-			  newuvp->dir = tcsdirs[k];
-			  newuvp->u = ipoint[0];
-			  newuvp->v = ipoint[1];
-			  olduvp = newuvp;
-			  *nextuvp = newuvp;
-			  nextuvp = &(newuvp->next);
-			}
-		    } /* if have intersection */
-		} /* if is not parallel */
-	    } /* for */
-	} /* for */
+  memset(job, 0, sizeof(ay_stess_trimjob));
 
-      nextuvp = &(uvps[i]);
+  job->p = p;
+  job->numtrims = numtrims;
+  job->tcs = tcs;
+  job->tcslens = tcslens;
+  job->dir = dir;
+  job->numlines = numlines;
 
-      if(trimuvp && trimuvp->next)
-	{
-	  /* we had trimloop points */
-	  ay_stess_SortIntersections(trimuvp, AY_FALSE);
+  Cn = (p->width + 4) * qf;
+  Cm = (p->height + 4) * qf;
 
-	  *nextuvp = trimuvp;
-	  nextuvp = &(trimuvp->next);
-	  nexttrimuvp = trimuvp->next;
+  job->min[0] = p->uknotv[p->uorder-1];
+  job->max[0] = p->uknotv[p->width];
+  job->d[0] = (job->max[0]-job->min[0])/((Cn)-1);
 
-	  v = vmin;
-	  while(v < trimuvp->v)
-	    v += vd;
+  job->min[1] = p->vknotv[p->vorder-1];
+  job->max[1] = p->vknotv[p->height];
+  job->d[1] = (job->max[1]-job->min[1])/((Cm)-1);
 
-	  out = 0;
+  if(!(job->lines = calloc(numlines, sizeof(ay_stess_line))))
+    return AY_EOMEM;
 
-	  while(nexttrimuvp)
-	    {
-	      while(v < (nexttrimuvp->v-4*AY_EPSILON))
-		{
-		  if(!out)
-		    {
-		      if(!(newuvp = calloc(1, sizeof(ay_stess_uvp))))
-			{
-			  ay_status = AY_EOMEM;
-			  goto cleanup;
-			}
-		      newuvp->u = u;
-		      newuvp->v = v;
-		      *nextuvp = newuvp;
-		      nextuvp = &(newuvp->next);
-		    }
-		  v += vd;
-		} /* while */
+  if(!(job->params = malloc(numlines*sizeof(double))))
+    return AY_EOMEM;
 
-	      out = !out;
+  /* the constant parametric values of the lines */
+  s = job->min[dir];
+  for(i = 0; i < numlines; i++)
+    {
+      if(i == numlines-1)
+	s = job->max[dir];
+      job->params[i] = s;
+      s += job->d[dir];
+    }
 
-	      *nextuvp = nexttrimuvp;
-	      nextuvp = &(nexttrimuvp->next);
+  nthreads = ay_tp_getnumthreads();
+  job->nthreads = nthreads;
 
-	      nexttrimuvp = nexttrimuvp->next;
-	    } /* while */
-	}
-      else
-	{
-	  if(trimuvp)
-	    free(trimuvp);
-	} /* if have multiple intersections */
+  if(!(job->isects = calloc(nthreads, sizeof(ay_stess_line))))
+    return AY_EOMEM;
 
-      u += ud;
-    } /* for */
+  if(!(job->ders = calloc(nthreads, sizeof(double *))))
+    return AY_EOMEM;
 
-  /* finally, calculate surfacepoints */
   if(p->is_rat)
+    size = ay_nb_FirstDerSurf4DMSize(p->uorder-1, p->vorder-1);
+  else
+    size = ay_nb_FirstDerSurf3DMSize(p->uorder-1, p->vorder-1);
+
+  for(i = 0; i < nthreads; i++)
     {
-      if(!(ders = malloc(
-	 ay_nb_FirstDerSurf4DMSize(p->uorder-1, p->vorder-1)*sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
+      if(!(job->ders[i] = malloc(size*sizeof(double))))
+	return AY_EOMEM;
     }
-  else
+
+ return AY_OK;
+} /* ay_stess_TrimJobInit */
+
+
+/* ay_stess_TrimJobFree:
+ *  free the temporary memory of a job prepared by ay_stess_TrimJobInit()
+ */
+void
+ay_stess_TrimJobFree(ay_stess_trimjob *job)
+{
+ int i;
+
+  if(job->lines)
     {
-      if(!(ders = malloc(
-	 ay_nb_FirstDerSurf3DMSize(p->uorder-1, p->vorder-1)*sizeof(double))))
+      for(i = 0; i < job->numlines; i++)
 	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
+	  if(job->lines[i].uv)
+	    free(job->lines[i].uv);
+	  if(job->lines[i].types)
+	    free(job->lines[i].types);
 	}
+      free(job->lines);
     }
 
-  fd1 = &(ders[3]);
-  fd2 = &(ders[6]);
-
-  for(i = 0; i < Cn; i++)
+  if(job->isects)
     {
-      uvpptr = uvps[i];
-
-      while(uvpptr)
+      for(i = 0; i < job->nthreads; i++)
 	{
-	  memset(ders, 0, 4*sizeof(double));
-
-	  if(p->is_rat)
-	    ay_nb_FirstDerSurf4DM(p->width-1, p->height-1,
-			       p->uorder-1, p->vorder-1, p->uknotv, p->vknotv,
-				  p->controlv, uvpptr->u, uvpptr->v, ders);
-	  else
-	    ay_nb_FirstDerSurf3DM(p->width-1, p->height-1,
-			       p->uorder-1, p->vorder-1, p->uknotv, p->vknotv,
-				  p->controlv, uvpptr->u, uvpptr->v, ders);
-
-	  memcpy(uvpptr->C, ders, 3*sizeof(double));
-
-	  AY_V3CROSS(temp, fd2, fd1);
-	  memcpy(&(uvpptr->C[3]), temp, 3*sizeof(double));
-	  if(uvpptr->next)
-	    {
-	      uvpptr->next->prev = uvpptr;
-	    }
-	  uvpptr = uvpptr->next;
-	} /* while */
-    } /* for */
-
-  free(ders);
-
-  /* return result */
-  *result = uvps;
-
-  /* prevent cleanup code from doing something harmful */
-  uvps = NULL;
+	  if(job->isects[i].uv)
+	    free(job->isects[i].uv);
+	  if(job->isects[i].types)
+	    free(job->isects[i].types);
+	}
+      free(job->isects);
+    }
 
-cleanup:
+  if(job->params)
+    free(job->params);
 
-  if(uvps)
+  if(job->ders)
     {
-      for(i = 0; i < Cn; i++)
+      for(i = 0; i < job->nthreads; i++)
 	{
-	  while(uvps[i])
-	    {
-	      uvpptr = uvps[i]->next;
-	      free(uvps[i]);
-	      uvps[i] = uvpptr;
-	    }
+	  if(job->ders[i])
+	    free(job->ders[i]);
 	}
-      free(uvps);
+      free(job->ders);
     }
 
- return ay_status;
-} /* ay_stess_TessTrimmedNPU */
+ return;
+} /* ay_stess_TrimJobFree */
 
 
-/* ay_stess_TessTrimmedNPV:
- *  tesselate NURBS patch <o> into lines in parametric direction v
+/* ay_stess_TessTrimmedLinecb:
+ *  work callback of ay_stess_TessTrimmedLines(), computes the
+ *  parametric values of the points of one line
  */
 int
-ay_stess_TessTrimmedNPV(ay_object *o, int qf, int numtrims,
-			double **tcs, int *tcslens, int *tcsdirs,
-			int *reslen, ay_stess_uvp ***result)
+ay_stess_TessTrimmedLinecb(void *data, int item, int thread)
 {
- int ay_status = AY_OK;
- ay_nurbpatch_object *p = NULL;
- ay_stess_uvp **uvps = NULL, *uvpptr, *newuvp, **nextuvp, *trimuvp;
- ay_stess_uvp *olduvp, *nexttrimuvp;
- double *tt, ipoint[2] = {0};
- double p3[2], p4[2], *U, *V, u, v;
- double *fd1, *fd2, temp[3] = {0}, *ders = NULL;
- double umin, umax, vmin, vmax, ud, vd;
- int i, k, l, ind;
+ ay_stess_trimjob *job = (ay_stess_trimjob *)data;
+ ay_stess_line *isects = &(job->isects[thread]);
+ ay_stess_line *line = &(job->lines[item]);
+ double *tt, *uv, ipoint[2] = {0};
+ double p3[2], p4[2], s, t;
+ int c, r, k, l, ind;
  int out = 0;
- int Cm, Cn;
 
-  p = (ay_nurbpatch_object *)o->refine;
-
-  Cn = (p->width + 4) * qf;
-  Cm = (p->height + 4) * qf;
-  *reslen = Cm;
-  if(!(uvps = calloc(Cm, sizeof(ay_stess_uvp *))))
-    {
-      return AY_EOMEM;
-    }
+  /* c: dimension of the constant parametric value of the line,
+     r: dimension in which the line runs */
+  c = job->dir;
+  r = !c;
 
-  U = p->uknotv;
-  umin = U[p->uorder-1];
-  umax = U[p->width];
-  ud = (umax-umin)/((Cn)-1);
+  isects->len = 0;
 
-  V = p->vknotv;
-  vmin = V[p->vorder-1];
-  vmax = V[p->height];
-  vd = (vmax-vmin)/((Cm)-1);
+  s = job->params[item];
+  p3[c] = s;
+  p4[c] = s;
+  p3[r] = job->min[r] - AY_EPSILON;
+  p4[r] = job->max[r] + AY_EPSILON;
 
-  v = vmin;
-  p3[0] = umin - AY_EPSILON;
-  p4[0] = umax + AY_EPSILON;
-
-  for(i = 0; i < Cm; i++)
+  /* calc all intersections of all trimloops with the current line */
+  for(k = 0; k < job->numtrims; k++)
     {
-      nextuvp = &trimuvp;
-      olduvp = NULL;
-      trimuvp = NULL;
-
-      if(i == Cm-1)
-	v = vmax;
-      p3[1] = v;
-      p4[1] = v;
+      tt = job->tcs[k];
 
-      /* calc all intersections of all trimloops with current v */
-      for(k = 0; k < numtrims; k++)
+      for(l = 0; l < (job->tcslens[k]-1); l++)
 	{
-	  tt = tcs[k];
+	  ind = l*2;
 
-	  for(l = 0; l < (tcslens[k]-1); l++)
+	  /* is section crossing or touching the line? */
+	  if(((tt[ind+c] <= (s + AY_EPSILON)) &&
+	      (tt[ind+2+c] >= (s - AY_EPSILON))) ||
+	     ((tt[ind+c] >= (s - AY_EPSILON)) &&
+	      (tt[ind+2+c] <= (s + AY_EPSILON))))
 	    {
-	      ind = l*2;
+	      /* weed out all sections that run (more or less)
+		 exactly along the current line, nothing good
+		 comes of them */
+	      if((fabs(tt[ind+c] - s) < AY_EPSILON) &&
+		 (fabs(tt[ind+2+c] - s) < AY_EPSILON))
+		{
+#ifdef AY_STESSDBG
+		  printf("Discarding parallel section.\n");
+#endif
+		  continue;
+		}
+	      ipoint[0] = 0.0;
+	      ipoint[1] = 0.0;
 
-	      /* is section crossing or touching v? */
-	      if(((tt[ind+1] <= (v + AY_EPSILON)) &&
-		  (tt[ind+2+1] >= (v - AY_EPSILON))) ||
-		 ((tt[ind+1] >= (v - AY_EPSILON)) &&
-		  (tt[ind+2+1] <= (v + AY_EPSILON))))
+	      if((ay_stess_IntersectLines2D(&(tt[ind]),
+					    &(tt[ind+2]),
+					    p3, p4, ipoint)))
 		{
-		  /* weed out all sections that run (more or less)
-		     exactly along the current v-line, nothing good
-		     comes of them */
-		  if((fabs(tt[ind+1] - v) < AY_EPSILON) &&
-		     (fabs(tt[ind+2+1] - v) < AY_EPSILON))
-		    continue;
-
-		  ipoint[0] = 0.0;
-		  ipoint[1] = 0.0;
-
-		  if((ay_stess_IntersectLines2D(&(tt[ind]),
-						&(tt[ind+2]),
-						p3, p4, ipoint)))
+		  /* line intersects with trimcurve */
+		  /* => add new point (but avoid consecutive
+		     equal points; those appear if a loop touches
+		     start or end of the current line) */
+		  if(!isects->len ||
+		     fabs(isects->uv[(isects->len-1)*2+r] - ipoint[r]) >
+		     AY_EPSILON)
 		    {
-		      /* v-line intersects with trimcurve */
-		      /* => add new point (but avoid consecutive
-			 equal points; those appear if a loop touches
-			 start or end of the current v-line) */
-		      if(!olduvp ||
-			 fabs(olduvp->u - ipoint[0]) > AY_EPSILON)
-			{
-			  if(!(newuvp = calloc(1, sizeof(ay_stess_uvp))))
-			    {
-			      ay_status = AY_EOMEM;
-			      goto cleanup;
-			    }
-			  newuvp->type = 1;
-			  newuvp->dir = tcsdirs[k];
-			  newuvp->u = ipoint[0];
-			  newuvp->v = ipoint[1];
-
-			  olduvp = newuvp;
-			  *nextuvp = newuvp;
-			  nextuvp = &(newuvp->next);
-			}
-		    } /* if have intersection */
-		} /* if is not parallel */
-	    } /* for */
+		      if(ay_stess_LineAdd(isects, ipoint[0], ipoint[1], 1))
+			return AY_EOMEM;
+		    }
+		} /* if have intersection */
+	    } /* if is not parallel */
 	} /* for */
+    } /* for */
 
-      u = umin;
-      nextuvp = &(uvps[i]);
+  if(isects->len < 2)
+    {
+      /* line is completely trimmed away */
+      return AY_OK;
+    }
 
-      if(trimuvp && trimuvp->next)
-	{
-	  /* we had trimloop points */
-	  ay_stess_SortIntersections(trimuvp, AY_TRUE);
+  /* we had trimloop points */
+  ay_stess_SortIntersections(isects->uv, isects->len, r);
 
-	  *nextuvp = trimuvp;
-	  nextuvp = &(trimuvp->next);
-	  nexttrimuvp = trimuvp->next;
+  uv = isects->uv;
+  if(ay_stess_LineAdd(line, uv[0], uv[1], 1))
+    return AY_EOMEM;
 
-	  u = umin;
-	  while(u < trimuvp->u)
-	    u += ud;
+  t = job->min[r];
+  while(t < uv[r])
+    t += job->d[r];
 
-	  out = 0;
+  out = 0;
 
-	  while(nexttrimuvp)
+  for(k = 1; k < isects->len; k++)
+    {
+      while(t < (uv[k*2+r]-4*AY_EPSILON))
+	{
+	  if(!out)
 	    {
-	      while(u < (nexttrimuvp->u-4*AY_EPSILON))
-		{
-		  if(!out)
-		    {
-		      if(!(newuvp = calloc(1, sizeof(ay_stess_uvp))))
-			{
-			  ay_status = AY_EOMEM;
-			  goto cleanup;
-			}
-		      newuvp->u = u;
-		      newuvp->v = v;
-		      *nextuvp = newuvp;
-		      nextuvp = &(newuvp->next);
-		    }
-		  u += ud;
-		} /* while */
+	      ipoint[c] = s;
+	      ipoint[r] = t;
+	      if(ay_stess_LineAdd(line, ipoint[0], ipoint[1], 0))
+		return AY_EOMEM;
+	    }
+	  t += job->d[r];
+	} /* while */
 
-	      out = !out;
+      out = !out;
 
-	      *nextuvp = nexttrimuvp;
-	      nextuvp = &(nexttrimuvp->next);
+      if(ay_stess_LineAdd(line, uv[k*2], uv[k*2+1], 1))
+	return AY_EOMEM;
+    } /* for */
 
-	      nexttrimuvp = nexttrimuvp->next;
-	    } /* while */
-	}
-      else
-	{
-	  if(trimuvp)
-	    free(trimuvp);
-	} /* if have multiple intersections */
+ return AY_OK;
+} /* ay_stess_TessTrimmedLinecb */
 
-      v += vd;
-    } /* for */
 
-  /* finally, calculate surfacepoints */
-  if(p->is_rat)
-    {
-      if(!(ders = malloc(
-	 ay_nb_FirstDerSurf4DMSize(p->uorder-1, p->vorder-1)*sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-    }
-  else
-    {
-      if(!(ders = malloc(
-	 ay_nb_FirstDerSurf3DMSize(p->uorder-1, p->vorder-1)*sizeof(double))))
-	{
-	  ay_status = AY_EOMEM;
-	  goto cleanup;
-	}
-    }
+/* ay_stess_EvalLinecb:
+ *  work callback of ay_stess_TessTrimmedLines(), calculates the
+ *  surface points and normals of all points of one line
+ */
+int
+ay_stess_EvalLinecb(void *data, int item, int thread)
+{
+ ay_stess_trimjob *job = (ay_stess_trimjob *)data;
+ ay_nurbpatch_object *p = job->p;
+ ay_stess_lines *res = job->result;
+ double *ders = job->ders[thread], *fd1, *fd2, *C, *uv;
+ int k;
 
   fd1 = &(ders[3]);
   fd2 = &(ders[6]);
 
-  for(i = 0; i < Cm; i++)
+  for(k = res->starts[item]; k < res->starts[item+1]; k++)
     {
-      uvpptr = uvps[i];
+      memset(ders, 0, 4*sizeof(double));
 
-      while(uvpptr)
-	{
-	  memset(ders, 0, 4*sizeof(double));
+      uv = &(res->uv[k*2]);
 
-	  if(p->is_rat)
-	    ay_nb_FirstDerSurf4DM(p->width-1, p->height-1,
-			       p->uorder-1, p->vorder-1, p->uknotv, p->vknotv,
-				  p->controlv, uvpptr->u, uvpptr->v, ders);
-	  else
-	    ay_nb_FirstDerSurf3DM(p->width-1, p->height-1,
-			       p->uorder-1, p->vorder-1, p->uknotv, p->vknotv,
-				  p->controlv, uvpptr->u, uvpptr->v, ders);
+      if(p->is_rat)
+	ay_nb_FirstDerSurf4DM(p->width-1, p->height-1,
+			      p->uorder-1, p->vorder-1, p->uknotv, p->vknotv,
+			      p->controlv, uv[0], uv[1], ders);
+      else
+	ay_nb_FirstDerSurf3DM(p->width-1, p->height-1,
+			      p->uorder-1, p->vorder-1, p->uknotv, p->vknotv,
+			      p->controlv, uv[0], uv[1], ders);
+
+      C = &(res->C[k*6]);
+      memcpy(C, ders, 3*sizeof(double));
+      C += 3;
+      AY_V3CROSS(C, fd2, fd1);
+    } /* for */
 
-	  memcpy(uvpptr->C, ders, 3*sizeof(double));
+ return AY_OK;
+} /* ay_stess_EvalLinecb */
 
-	  AY_V3CROSS(temp, fd2, fd1);
-	  memcpy(&(uvpptr->C[3]), temp, 3*sizeof(double));
-	  if(uvpptr->next)
-	    {
-	      uvpptr->next->prev = uvpptr;
-	    }
-	  uvpptr = uvpptr->next;
-	} /* while */
-    } /* for */
 
-  free(ders);
+/* ay_stess_TessTrimmedLines:
+ *  tesselate NURBS patch <o> into lines in parametric dimension
+ *  <dir> (0 - lines of constant u, 1 - lines of constant v);
+ *  the lines are processed in parallel and finally stored
+ *  compactly in <result>
+ */
+int
+ay_stess_TessTrimmedLines(ay_object *o, int qf, int numtrims,
+			  double **tcs, int *tcslens, int dir,
+			  ay_stess_lines *result)
+{
+ int ay_status = AY_OK;
+ ay_nurbpatch_object *p = NULL;
+ ay_stess_trimjob job;
+ ay_stess_line *line;
+ size_t size;
+ int i, numlines, numpoints = 0, a = 0;
 
-  /* return result */
-  *result = uvps;
+  p = (ay_nurbpatch_object *)o->refine;
 
-  /* prevent cleanup code from doing something harmful */
-  uvps = NULL;
+  ay_stess_FreeLines(result);
 
-cleanup:
+  if(dir)
+    numlines = (p->height + 4) * qf;
+  else
+    numlines = (p->width + 4) * qf;
+
+  ay_status = ay_stess_TrimJobInit(p, qf, numtrims, tcs, tcslens, dir,
+				   numlines, &job);
+  if(ay_status)
+    goto cleanup;
 
-  if(uvps)
+  /* compute the parametric values of all points */
+  ay_status = ay_tp_run(numlines, ay_stess_TessTrimmedLinecb, &job);
+  if(ay_status)
+    goto cleanup;
+
+  for(i = 0; i < numlines; i++)
+    numpoints += job.lines[i].len;
+
+  /* allocate all arrays of the result en bloc */
+  size = numpoints*8*sizeof(double) + (numlines+1)*sizeof(int) +
+    numpoints*sizeof(char);
+
+  if(!(result->arena = malloc(size)))
+    {
+      ay_status = AY_EOMEM;
+      goto cleanup;
+    }
+
+  result->numlines = numlines;
+  result->numpoints = numpoints;
+  result->C = (double *)result->arena;
+  result->uv = result->C + numpoints*6;
+  result->starts = (int *)(result->uv + numpoints*2);
+  result->types = (char *)(result->starts + numlines+1);
+
+  for(i = 0; i < numlines; i++)
     {
-      for(i = 0; i < Cm; i++)
+      line = &(job.lines[i]);
+      result->starts[i] = a;
+      if(line->len > 0)
 	{
-	  while(uvps[i])
-	    {
-	      uvpptr = uvps[i]->next;
-	      free(uvps[i]);
-	      uvps[i] = uvpptr;
-	    }
+	  memcpy(&(result->uv[a*2]), line->uv, line->len*2*sizeof(double));
+	  memcpy(&(result->types[a]), line->types, line->len*sizeof(char));
 	}
-      free(uvps);
-    }
+      a += line->len;
+    } /* for */
+  result->starts[numlines] = a;
+
+  /* calculate surface points */
+  job.result = result;
+  ay_status = ay_tp_run(numlines, ay_stess_EvalLinecb, &job);
+
+cleanup:
+
+  if(ay_status)
+    ay_stess_FreeLines(result);
+
+  ay_stess_TrimJobFree(&job);
 
  return ay_status;
-} /* ay_stess_TessTrimmedNPV */
+} /* ay_stess_TessTrimmedLines */
 
 
-/* ay_stess_DrawTrimmedSurface:
- *
+/* ay_stess_FreeLines:
+ *  free the tesselated lines <lines>
  */
 void
-ay_stess_DrawTrimmedSurface(ay_stess_patch *stess)
+ay_stess_FreeLines(ay_stess_lines *lines)
 {
- int i, j, a, out;
- ay_stess_uvp *uvpptr;
 
-  if(!stess)
+  if(!lines)
     return;
 
-  /* draw iso-u lines */
-  for(i = 0; i < stess->upslen; i++)
+  if(lines->arena)
+    free(lines->arena);
+
+  memset(lines, 0, sizeof(ay_stess_lines));
+
+ return;
+} /* ay_stess_FreeLines */
+
+
+/* ay_stess_DrawLines:
+ *  draw the tesselated lines <lines>
+ */
+void
+ay_stess_DrawLines(ay_stess_lines *lines)
+{
+ int i, k, s, e, out;
+ char *types = lines->types;
+ double *C = lines->C;
+
+  for(i = 0; i < lines->numlines; i++)
     {
-      uvpptr = stess->ups[i];
-      if(uvpptr && uvpptr->next)
+      s = lines->starts[i];
+      e = lines->starts[i+1];
+      if(e - s > 1)
 	{
 	  out = 1;
 
-	  while(uvpptr)
+	  for(k = s; k < e; k++)
 	    {
-	      if(uvpptr->type > 0)
+	      if(types[k] > 0)
 		{
 		  if(out)
 		    {
 		      glBegin(GL_LINE_STRIP);
-		      glVertex3dv((GLdouble*)(uvpptr->C));
+		      glVertex3dv((GLdouble*)&(C[k*6]));
 		      out = 0;
 		    }
 		  else
 		    {
-		      glVertex3dv((GLdouble*)(uvpptr->C));
+		      glVertex3dv((GLdouble*)&(C[k*6]));
 		      glEnd();
 		      out = 1;
 		    } /* if out */
 		}
 	      else
 		{
-		  glVertex3dv((GLdouble*)(uvpptr->C));
+		  glVertex3dv((GLdouble*)&(C[k*6]));
 		} /* if trim point */
-
-	      uvpptr = uvpptr->next;
-	    } /* while */
+	    } /* for */
 
 	  if(!out)
 	    {
 	      glEnd();
 	    }
 	} /* if have two points */
-    } /* for all u lines */
+    } /* for all lines */
 
-  /* draw iso-v lines */
-  for(i = 0; i < stess->vpslen; i++)
-    {
-      uvpptr = stess->vps[i];
+ return;
+} /* ay_stess_DrawLines */
 
-      if(uvpptr && uvpptr->next)
-	{
-	  out = 1;
 
-	  while(uvpptr)
-	    {
-	      if(uvpptr->type > 0)
-		{
-		  if(out)
-		    {
-		      glBegin(GL_LINE_STRIP);
-		      glVertex3dv((GLdouble*)(uvpptr->C));
-		      out = 0;
-		    }
-		  else
-		    {
-		      glVertex3dv((GLdouble*)(uvpptr->C));
-		      glEnd();
-		      out = 1;
-		    } /* if out */
-		}
-	      else
-		{
-		  glVertex3dv((GLdouble*)(uvpptr->C));
-		} /* if trim point */
+/* ay_stess_DrawTrimmedSurface:
+ *
+ */
+void
+ay_stess_DrawTrimmedSurface(ay_stess_patch *stess)
+{
+ int i, j, a;
 
-	      uvpptr = uvpptr->next;
-	    }  /* while */
+  if(!stess)
+    return;
 
-	  if(!out)
-	    {
-	      glEnd();
-	    }
-	} /* if have two points */
-    } /* for all v lines */
+  /* draw iso-u lines */
+  ay_stess_DrawLines(&(stess->ups));
+
+  /* draw iso-v lines */
+  ay_stess_DrawLines(&(stess->vps));
 
   /* draw trimcurves (outlines) */
   a = 0;
@@ -1988,339 +1703,373 @@ ay_stess_DrawTrimmedSurface(ay_stess_patch *stess)
 } /* ay_stess_DrawTrimmedSurface */
 
 
-/* ay_stess_ShadeTrimmedSurface:
- *
+/* ay_stess_StripBegin:
+ *  start a new triangle strip in <strip>
  */
 void
-ay_stess_ShadeTrimmedSurface(ay_stess_patch *stess)
+ay_stess_StripBegin(ay_stess_strip *strip)
+{
+
+  strip->n = 0;
+
+ return;
+} /* ay_stess_StripBegin */
+
+
+/* ay_stess_StripVertex:
+ *  add the vertex with index <i> to the triangle strip <strip>,
+ *  completed triangles are appended to strip->vb (keeping the
+ *  orientation of the strip)
+ */
+void
+ay_stess_StripVertex(ay_stess_strip *strip, unsigned int i)
+{
+
+  if(strip->n > 1 && !strip->status)
+    {
+      if(strip->n & 1)
+	strip->status = ay_shade_vbufaddtri(strip->vb, strip->b, strip->a, i);
+      else
+	strip->status = ay_shade_vbufaddtri(strip->vb, strip->a, strip->b, i);
+    }
+
+  strip->a = strip->b;
+  strip->b = i;
+  strip->n++;
+
+ return;
+} /* ay_stess_StripVertex */
+
+
+/* ay_stess_TrimmedSurfaceVB:
+ *  build the shading vertex buffers of the trimmed patch <stess>;
+ *  the points of the lines are addressed by their indices, the
+ *  points of line i are in the range s1 - e1-1, the points
+ *  of line i+1 in the range s2 - e2-1;
+ *  the triangle strips of the cells are collected as triangles
+ *  in stess->vb (u-direction, indices into ups.C) and stess->vpsvb
+ *  (v-direction, indices into vps.C)
+ */
+int
+ay_stess_TrimmedSurfaceVB(ay_stess_patch *stess)
 {
  int i, instrip = AY_FALSE;
+ int u1, u2, v1, v2, s1, s2, e1, e2;
  unsigned int j;
- ay_stess_uvp *u1, *u2, *v1, *v2;
  ay_pomesh_object *po;
- double *p;
-
-  if(!stess)
-    return;
+ ay_stess_strip strip = {0};
+ double *p, *UV;
+ char *T;
 
   if(stess->pomesh)
     {
       /* assume the pomesh is a triangle soup (from the tesselation) */
       po = stess->pomesh;
-      glBegin(GL_TRIANGLES);
-       p = stess->normal;
-       glNormal3dv((GLdouble*)p);
-       p = po->controlv;
-       for(j = 0; j < po->npolys; j++)
-	 {
-	   glVertex3dv((GLdouble*)p);
-	   p += 3;
-	   glVertex3dv((GLdouble*)p);
-	   p += 3;
-	   glVertex3dv((GLdouble*)p);
-	   p += 3;
-	 }
-      glEnd();
-      return;
+      p = po->controlv;
+      for(j = 0; j < po->npolys*3; j++)
+	{
+	  if(ay_shade_vbufaddvert(&(stess->vb), p, stess->normal))
+	    return AY_EOMEM;
+	  p += 3;
+	}
+      for(j = 0; j < po->npolys*3; j += 3)
+	{
+	  if(ay_shade_vbufaddtri(&(stess->vb), j, j+1, j+2))
+	    return AY_EOMEM;
+	}
+      return AY_OK;
     }
 
+  strip.vb = &(stess->vb);
+  UV = stess->ups.uv;
+  T = stess->ups.types;
+
   /* search for complete cells (all types 0) in u-direction */
-  for(i = 0; i < (stess->upslen-1); i++)
+  for(i = 0; i < (stess->ups.numlines-1); i++)
     {
-      u1 = stess->ups[i];
-      u2 = stess->ups[i+1];
+      s1 = stess->ups.starts[i];
+      e1 = stess->ups.starts[i+1];
+      s2 = e1;
+      e2 = stess->ups.starts[i+2];
+
+      u1 = s1;
+      u2 = s2;
 
       if(stess->ft_cw)
 	{
 	  /* forward to next complete grid-cell */
-	  while(u1)
+	  while(u1 < e1)
 	    {
-	      if(u1->type == 0 || u1->type == 2)
+	      if(T[u1] == 0 || T[u1] == 2)
 		break;
-	      u1 = u1->next;
+	      u1++;
 	    }
-	  while(u2)
+	  while(u2 < e2)
 	    {
-	      if(u2->type == 0 || u2->type == 2)
+	      if(T[u2] == 0 || T[u2] == 2)
 		break;
-	      u2 = u2->next;
+	      u2++;
 	    }
 	}
       else
 	{
 	  /* forward to first trim */
-	  while(u1 && u1->type == 0)
-	    u1 = u1->next;
+	  while(u1 < e1 && T[u1] == 0)
+	    u1++;
 
-	  while(u2 && u2->type == 0)
-	    u2 = u2->next;
+	  while(u2 < e2 && T[u2] == 0)
+	    u2++;
 	}
 
-      if(!u1 || !u2 || !u1->next || !u2->next)
+      if(u1+1 >= e1 || u2+1 >= e2)
 	{
 	  continue;
 	}
 
-      while(u1 && u1->type != 0)
-	u1 = u1->next;
+      while(u1 < e1 && T[u1] != 0)
+	u1++;
 
-      while(u2 && u2->type != 0)
-	u2 = u2->next;
+      while(u2 < e2 && T[u2] != 0)
+	u2++;
 
-      while(u1 && u1->next && u2 && u2->next)
+      while(u1+1 < e1 && u2+1 < e2)
 	{
-	  if(u1->type == 0 && u1->next->type == 0 &&
-	     u2->type == 0 && u2->next->type == 0 &&
-	     u1->v == u2->v)
+	  if(T[u1] == 0 && T[u1+1] == 0 &&
+	     T[u2] == 0 && T[u2+1] == 0 &&
+	     UV[u1*2+1] == UV[u2*2+1])
 	    {
 	      if(!instrip)
 		{
-		  glBegin(GL_TRIANGLE_STRIP);
+		  ay_stess_StripBegin(&strip);
 		  instrip = AY_TRUE;
 		}
-	      glNormal3dv((GLdouble*)&((u1->C)[3]));
-	      glVertex3dv((GLdouble*)(u1->C));
-	      glNormal3dv((GLdouble*)&((u2->C)[3]));
-	      glVertex3dv((GLdouble*)(u2->C));
-	      u1 = u1->next;
-	      u2 = u2->next;
-	      glNormal3dv((GLdouble*)&((u1->C)[3]));
-	      glVertex3dv((GLdouble*)(u1->C));
-	      glNormal3dv((GLdouble*)&((u2->C)[3]));
-	      glVertex3dv((GLdouble*)(u2->C));
+	      ay_stess_StripVertex(&strip, u1);
+	      ay_stess_StripVertex(&strip, u2);
+	      u1++;
+	      u2++;
+	      ay_stess_StripVertex(&strip, u1);
+	      ay_stess_StripVertex(&strip, u2);
 
 	      /* check next cell */
-	      if(!u1->next || !u2->next ||
-		 u1->next->type != 0 || u2->next->type != 0)
+	      if(u1+1 >= e1 || u2+1 >= e2 ||
+		 T[u1+1] != 0 || T[u2+1] != 0)
 		{
 		  if(instrip)
 		    {
-		      glEnd();
 		      instrip = AY_FALSE;
 		    }
 		}
 	    } /* have complete cell */
 
 	  /* forward to next candidate cell */
-	  while((u1 && u1->type != 0) ||
-		(u1 && u1->next && u1->next->type != 0))
-	    u1 = u1->next;
+	  while(u1 < e1 && (T[u1] != 0 || (u1+1 < e1 && T[u1+1] != 0)))
+	    u1++;
 
-	  while((u2 && u2->type != 0) ||
-		(u2 && u2->next && u2->next->type != 0))
-	    u2 = u2->next;
+	  while(u2 < e2 && (T[u2] != 0 || (u2+1 < e2 && T[u2+1] != 0)))
+	    u2++;
 
-	  if(!u1 || !u2)
+	  if(u1 >= e1 || u2 >= e2)
 	    break;
 
-	  if(u1->v != u2->v)
+	  if(UV[u1*2+1] != UV[u2*2+1])
 	    {
-	      if(u1->v < u2->v)
+	      if(UV[u1*2+1] < UV[u2*2+1])
 		{
-		  while(u1 && u1->v < u2->v)
-		    u1 = u1->next;
+		  while(u1 < e1 && UV[u1*2+1] < UV[u2*2+1])
+		    u1++;
 		}
 	      else
 		{
-		  while(u2 && u1->v > u2->v)
-		    u2 = u2->next;
+		  while(u2 < e2 && UV[u1*2+1] > UV[u2*2+1])
+		    u2++;
 		}
 	    }
 	} /* while */
 
       if(instrip)
 	{
-	  glEnd();
 	  instrip = AY_FALSE;
 	}
 
       /*
        * search for incomplete cells
        */
-      u1 = stess->ups[i];
-      u2 = stess->ups[i+1];
+      u1 = s1;
+      u2 = s2;
 
       if(stess->ft_cw)
 	{
-	  while(u1)
+	  while(u1 < e1)
 	    {
-	      if(u1->type == 0 || u1->type == 2)
+	      if(T[u1] == 0 || T[u1] == 2)
 		break;
-	      u1 = u1->next;
+	      u1++;
 	    }
-	  while(u2)
+	  while(u2 < e2)
 	    {
-	      if(u2->type == 0 || u2->type == 2)
+	      if(T[u2] == 0 || T[u2] == 2)
 		break;
-	      u2 = u2->next;
+	      u2++;
 	    }
 	}
       else
 	{
 	  /* forward to first trim */
-	  while(u1 && u1->type == 0)
-	    u1 = u1->next;
+	  while(u1 < e1 && T[u1] == 0)
+	    u1++;
 
-	  while(u2 && u2->type == 0)
-	    u2 = u2->next;
+	  while(u2 < e2 && T[u2] == 0)
+	    u2++;
 	}
 
-      if(!u1 || !u2 || !u1->next || !u2->next)
+      if(u1+1 >= e1 || u2+1 >= e2)
 	continue;
 
-      while(u1 && u1->type != 0)
-	u1 = u1->next;
+      while(u1 < e1 && T[u1] != 0)
+	u1++;
 
-      while(u2 && u2->type != 0)
-	u2 = u2->next;
+      while(u2 < e2 && T[u2] != 0)
+	u2++;
 
-      if(!u1 || !u2 || !u1->next || !u2->next)
+      if(u1+1 >= e1 || u2+1 >= e2)
 	continue;
 
-      while(u1 && u1->next && u2 && u2->next)
+      while(u1+1 < e1 && u2+1 < e2)
 	{
-	  if(u1->v != u2->v)
+	  if(UV[u1*2+1] != UV[u2*2+1])
 	    {
-	      if(u1->v < u2->v)
+	      if(UV[u1*2+1] < UV[u2*2+1])
 		{
-		  while(u1 && u1->v < u2->v)
-		    u1 = u1->next;
+		  while(u1 < e1 && UV[u1*2+1] < UV[u2*2+1])
+		    u1++;
 		}
 	      else
 		{
-		  while(u2 && u1->v > u2->v)
-		    u2 = u2->next;
+		  while(u2 < e2 && UV[u1*2+1] > UV[u2*2+1])
+		    u2++;
 		}
 	    }
 
-	  if(!u1 || !u2 || !u1->next || !u2->next)
+	  if(u1+1 >= e1 || u2+1 >= e2)
 	    break;
 
-	  if(u1->type == 0 && u2->type == 0 && u1->v == u2->v)
+	  if(T[u1] == 0 && T[u2] == 0 && UV[u1*2+1] == UV[u2*2+1])
 	    {
 	      /* check previous cell */
-	      if(u1->prev && u2->prev &&
-		 (u1->prev->type || u2->prev->type))
+	      if(u1 > s1 && u2 > s2 && (T[u1-1] || T[u2-1]))
 		{
-		  glBegin(GL_TRIANGLE_STRIP);
-		   glNormal3dv((GLdouble*)&((u1->prev->C)[3]));
-		   glVertex3dv((GLdouble*)(u1->prev->C));
-		   glNormal3dv((GLdouble*)&((u2->prev->C)[3]));
-		   glVertex3dv((GLdouble*)(u2->prev->C));
-		   glNormal3dv((GLdouble*)&((u1->C)[3]));
-		   glVertex3dv((GLdouble*)(u1->C));
-		   glNormal3dv((GLdouble*)&((u2->C)[3]));
-		   glVertex3dv((GLdouble*)(u2->C));
-		  glEnd();
+		  ay_stess_StripBegin(&strip);
+		  ay_stess_StripVertex(&strip, u1-1);
+		  ay_stess_StripVertex(&strip, u2-1);
+		  ay_stess_StripVertex(&strip, u1);
+		  ay_stess_StripVertex(&strip, u2);
 		}
 
 	      /* check next cell */
-	      if(u1->next->type || u2->next->type)
+	      if(T[u1+1] || T[u2+1])
 		{
-		  glBegin(GL_TRIANGLE_STRIP);
-		   glNormal3dv((GLdouble*)&((u1->C)[3]));
-		   glVertex3dv((GLdouble*)(u1->C));
-		   glNormal3dv((GLdouble*)&((u2->C)[3]));
-		   glVertex3dv((GLdouble*)(u2->C));
-		   glNormal3dv((GLdouble*)&((u1->next->C)[3]));
-		   glVertex3dv((GLdouble*)(u1->next->C));
-		   glNormal3dv((GLdouble*)&((u2->next->C)[3]));
-		   glVertex3dv((GLdouble*)(u2->next->C));
-		  glEnd();
+		  ay_stess_StripBegin(&strip);
+		  ay_stess_StripVertex(&strip, u1);
+		  ay_stess_StripVertex(&strip, u2);
+		  ay_stess_StripVertex(&strip, u1+1);
+		  ay_stess_StripVertex(&strip, u2+1);
 		}
 	    } /* if */
 
 	  /* forward to next candidate cell */
 	  do
-	    u1 = u1->next;
-	  while(u1 && u1->type != 0);
+	    u1++;
+	  while(u1 < e1 && T[u1] != 0);
 
 	  do
-	    u2 = u2->next;
-	  while(u2 && u2->type != 0);
+	    u2++;
+	  while(u2 < e2 && T[u2] != 0);
 
 	} /* while */
     } /* for */
 
   /****************************************************/
 
+  strip.vb = &(stess->vpsvb);
+  UV = stess->vps.uv;
+  T = stess->vps.types;
+
   /* search for complete cells (all types 0) in v-direction, but
      do not render them, just process the possibly incomplete
      cells right before/behind them */
-  for(i = 0; i < (stess->vpslen-1); i++)
+  for(i = 0; i < (stess->vps.numlines-1); i++)
     {
-      v1 = stess->vps[i];
-      v2 = stess->vps[i+1];
+      s1 = stess->vps.starts[i];
+      e1 = stess->vps.starts[i+1];
+      s2 = e1;
+      e2 = stess->vps.starts[i+2];
+
+      v1 = s1;
+      v2 = s2;
 
       if(stess->ft_cw)
 	{
 	  /* forward to next complete grid-cell */
-	  while(v1)
+	  while(v1 < e1)
 	    {
-	      if(v1->type == 0 || v1->type == 2)
+	      if(T[v1] == 0 || T[v1] == 2)
 		break;
-	      v1 = v1->next;
+	      v1++;
 	    }
-	  while(v2)
+	  while(v2 < e2)
 	    {
-	      if(v2->type == 0 || v2->type == 2)
+	      if(T[v2] == 0 || T[v2] == 2)
 		break;
-	      v2 = v2->next;
+	      v2++;
 	    }
 	}
       else
 	{
 	  /* forward to first trim */
-	  while(v1 && v1->type == 0)
-	    v1 = v1->next;
+	  while(v1 < e1 && T[v1] == 0)
+	    v1++;
 
-	  while(v2 && v2->type == 0)
-	    v2 = v2->next;
+	  while(v2 < e2 && T[v2] == 0)
+	    v2++;
 	}
 
-      if(!v1 || !v2 || !v1->next || !v2->next)
+      if(v1+1 >= e1 || v2+1 >= e2)
 	continue;
 
-      while(v1 && v1->type != 0)
-	v1 = v1->next;
+      while(v1 < e1 && T[v1] != 0)
+	v1++;
 
-      while(v2 && v2->type != 0)
-	v2 = v2->next;
+      while(v2 < e2 && T[v2] != 0)
+	v2++;
 
-      while(v1 && v1->next && v2 && v2->next)
+      while(v1+1 < e1 && v2+1 < e2)
 	{
-	  if(v1->type == 0 && v1->next->type == 0 &&
-	     v2->type == 0 && v2->next->type == 0 &&
-	     v1->u == v2->u)
+	  if(T[v1] == 0 && T[v1+1] == 0 &&
+	     T[v2] == 0 && T[v2+1] == 0 &&
+	     UV[v1*2] == UV[v2*2])
 	    {
 	      if(!instrip)
 		{
 		  /* here we would start the strip of complete cells,
 		     but in v direction, we only check, whether there
 		     is an incomplete cell before, and shade it */
-		  if(v1->prev && v2->prev &&
-		     (v1->prev->type || v2->prev->type))
+		  if(v1 > s1 && v2 > s2 && (T[v1-1] || T[v2-1]))
 		    {
-		      glBegin(GL_TRIANGLE_STRIP);
-		       glNormal3dv((GLdouble*)&((v1->prev->C)[3]));
-		       glVertex3dv((GLdouble*)(v1->prev->C));
-		       glNormal3dv((GLdouble*)&((v1->C)[3]));
-		       glVertex3dv((GLdouble*)(v1->C));
-		       glNormal3dv((GLdouble*)&((v2->prev->C)[3]));
-		       glVertex3dv((GLdouble*)(v2->prev->C));
-		       glNormal3dv((GLdouble*)&((v2->C)[3]));
-		       glVertex3dv((GLdouble*)(v2->C));
-		      glEnd();
+		      ay_stess_StripBegin(&strip);
+		      ay_stess_StripVertex(&strip, v1-1);
+		      ay_stess_StripVertex(&strip, v1);
+		      ay_stess_StripVertex(&strip, v2-1);
+		      ay_stess_StripVertex(&strip, v2);
 		    }
 		  instrip = AY_TRUE;
 		} /* if */
 
-	      v1 = v1->next;
-	      v2 = v2->next;
+	      v1++;
+	      v2++;
 
 	      /* check next cell */
-	      if(!v1->next || !v2->next ||
-		 v1->next->type != 0 || v2->next->type != 0)
+	      if(v1+1 >= e1 || v2+1 >= e2 ||
+		 T[v1+1] != 0 || T[v2+1] != 0)
 		{
 		  if(instrip)
 		    {
@@ -2330,47 +2079,40 @@ ay_stess_ShadeTrimmedSurface(ay_stess_patch *stess)
 		      /* here we would end the strip of complete cells,
 			 but in v direction, we only check, whether there
 			 is an incomplete cell following, and shade it */
-		      if(v1->next && v2->next &&
-			 (v1->next->type || v2->next->type))
+		      if(v1+1 < e1 && v2+1 < e2 &&
+			 (T[v1+1] || T[v2+1]))
 			{
-			  glBegin(GL_TRIANGLE_STRIP);
-			   glNormal3dv((GLdouble*)&((v1->C)[3]));
-			   glVertex3dv((GLdouble*)(v1->C));
-			   glNormal3dv((GLdouble*)&((v1->next->C)[3]));
-			   glVertex3dv((GLdouble*)(v1->next->C));
-			   glNormal3dv((GLdouble*)&((v2->C)[3]));
-			   glVertex3dv((GLdouble*)(v2->C));
-			   glNormal3dv((GLdouble*)&((v2->next->C)[3]));
-			   glVertex3dv((GLdouble*)(v2->next->C));
-			  glEnd();
+			  ay_stess_StripBegin(&strip);
+			  ay_stess_StripVertex(&strip, v1);
+			  ay_stess_StripVertex(&strip, v1+1);
+			  ay_stess_StripVertex(&strip, v2);
+			  ay_stess_StripVertex(&strip, v2+1);
 			}
 		    } /* if instrip */
 		} /* if */
 	    } /* if have complete cell */
 
 	  /* forward to next candidate cell */
-	  while((v1 && v1->type != 0) ||
-		(v1 && v1->next && v1->next->type != 0))
-	    v1 = v1->next;
+	  while(v1 < e1 && (T[v1] != 0 || (v1+1 < e1 && T[v1+1] != 0)))
+	    v1++;
 
-	  while((v2 && v2->type != 0) ||
-		(v2 && v2->next && v2->next->type != 0))
-	    v2 = v2->next;
+	  while(v2 < e2 && (T[v2] != 0 || (v2+1 < e2 && T[v2+1] != 0)))
+	    v2++;
 
-	  if(!v1 || !v2)
+	  if(v1 >= e1 || v2 >= e2)
 	    break;
 
-	  if(v1->u != v2->u)
+	  if(UV[v1*2] != UV[v2*2])
 	    {
-	      if(v1->u < v2->u)
+	      if(UV[v1*2] < UV[v2*2])
 		{
-		  while(v1 && v1->u < v2->u)
-		    v1 = v1->next;
+		  while(v1 < e1 && UV[v1*2] < UV[v2*2])
+		    v1++;
 		}
 	      else
 		{
-		  while(v2 && v1->u > v2->u)
-		    v2 = v2->next;
+		  while(v2 < e2 && UV[v1*2] > UV[v2*2])
+		    v2++;
 		}
 	    }
 	} /* while */
@@ -2381,15 +2123,100 @@ ay_stess_ShadeTrimmedSurface(ay_stess_patch *stess)
 	}
     } /* for */
 
+ return strip.status;
+} /* ay_stess_TrimmedSurfaceVB */
+
+
+/* ay_stess_ShadeTrimmedSurface:
+ *  shade the trimmed patch <stess> using vertex arrays; the arrays
+ *  are built on first use and live as long as the tesselation
+ */
+void
+ay_stess_ShadeTrimmedSurface(ay_stess_patch *stess)
+{
+
+  if(!stess)
+    return;
+
+  if(!stess->vb.valid)
+    {
+      if(ay_stess_TrimmedSurfaceVB(stess))
+	{
+	  ay_shade_vbuffree(&(stess->vb));
+	  ay_shade_vbuffree(&(stess->vpsvb));
+	  return;
+	}
+      stess->vb.valid = AY_TRUE;
+    }
+
+  if(stess->pomesh)
+    {
+      ay_shade_vbufdraw(&(stess->vb), NULL);
+    }
+  else
+    {
+      ay_shade_vbufdraw(&(stess->vb), stess->ups.C);
+      ay_shade_vbufdraw(&(stess->vpsvb), stess->vps.C);
+    }
+
  return;
 } /* ay_stess_ShadeTrimmedSurface */
 
 
+/* ay_stess_ShadeSurface:
+ *  shade the tesselated patch <stess> using vertex arrays;
+ *  for untrimmed patches, the triangles of the grid in tessv are
+ *  built on first use and live as long as the tesselation
+ */
+void
+ay_stess_ShadeSurface(ay_stess_patch *stess)
+{
+ int i, j, a, b, tessw, tessh;
+
+  if(!stess)
+    return;
+
+  if(!stess->tessv)
+    {
+      ay_stess_ShadeTrimmedSurface(stess);
+      return;
+    }
+
+  if(!stess->vb.valid)
+    {
+      tessw = stess->tessw;
+      tessh = stess->tessh;
+
+      for(i = 0; i < tessw-1; i++)
+	{
+	  a = i*tessh;
+	  b = a+tessh;
+	  for(j = 0; j < tessh-1; j++)
+	    {
+	      if(ay_shade_vbufaddtri(&(stess->vb), a, b, b+1) ||
+		 ay_shade_vbufaddtri(&(stess->vb), a, b+1, a+1))
+		{
+		  ay_shade_vbuffree(&(stess->vb));
+		  return;
+		}
+	      a++;
+	      b++;
+	    } /* for */
+	} /* for */
+      stess->vb.valid = AY_TRUE;
+    } /* if */
+
+  ay_shade_vbufdraw(&(stess->vb), stess->tessv);
+
+ return;
+} /* ay_stess_ShadeSurface */
+
+
 /** ay_stess_AddBoundaryTrim:
  * Add a extra boundary trim curve if there is no enclosing trim
  * and the trim curve direction of the first given trim curve leads
  * to a hole in the surface.
- * This way TessTrimmedNPU()/TessTrimmedNPV() can rely on the fact
+ * This way TessTrimmedLines() can rely on the fact
  * that the first trim always designates the start of the surface.
  *
  * \param[in,out] o NURBS patch to process
@@ -2470,16 +2297,16 @@ ay_stess_TessTrimmedNP(ay_object *o, int qf, ay_stess_patch *stess)
   if(ay_status)
     goto cleanup;
 
-  ay_status = ay_stess_TessTrimmedNPU(o, qf, stess->tcslen, tcs,
-				      stess->tcslens, tcsdirs,
-				      &(stess->upslen), &(stess->ups));
+  ay_status = ay_stess_TessTrimmedLines(o, qf, stess->tcslen, tcs,
+					stess->tcslens, /*dir=*/0,
+					&(stess->ups));
 
   if(ay_status)
     goto cleanup;
 
-  ay_status = ay_stess_TessTrimmedNPV(o, qf, stess->tcslen, tcs,
-				      stess->tcslens, tcsdirs,
-				      &(stess->vpslen), &(stess->vps));
+  ay_status = ay_stess_TessTrimmedLines(o, qf, stess->tcslen, tcs,
+					stess->tcslens, /*dir=*/1,
+					&(stess->vps));
 
   if(ay_status)
     goto cleanup;
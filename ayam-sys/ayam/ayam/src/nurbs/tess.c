@@ -84,6 +84,88 @@ typedef struct ay_tess_object_s {
   struct ay_tess_tri_s *tris;
 } ay_tess_object;
 
+typedef struct ay_tess_batch_s {
+  ay_object **patches; /* the patches to tesselate */
+  ay_object **results; /* resulting PolyMesh objects */
+  char *trimmed; /* patch is trimmed? */
+  int qf;
+  int primitives;
+} ay_tess_batch;
+
+/* maximum subdivision depth per knot span of the adaptive tesselation */
+#define AY_TESSADMAXDEPTH 8
+
+typedef struct ay_tess_adctx_s {
+  ay_nurbpatch_object *npatch; /* the patch to tesselate */
+  double *fder; /* scratch memory for ay_nb_FirstDerSurf[34]DM() */
+  double cdev; /* maximum chordal deviation */
+  double cosndev; /* cosine of maximum normal deviation */
+  int maxdepth; /* maximum subdivision depth */
+  double *params; /* refined parameters */
+  int paramslen;
+  int paramsalloc;
+} ay_tess_adctx;
+
+/* point of a trim loop for the trimmed adaptive tesselation */
+typedef struct ay_tess_adtp_s {
+  double u, v; /* parametric coordinates */
+  double t; /* parameter of a grid line crossing along the loop segment */
+  int onu; /* index of the U grid line the point is on, -1 if none */
+  int onv; /* index of the V grid line the point is on, -1 if none */
+  unsigned int index; /* index of the evaluated point */
+} ay_tess_adtp;
+
+/* piece of a trim loop inside a single grid cell */
+typedef struct ay_tess_adchain_s {
+  int cell; /* index of the grid cell */
+  int loop; /* index of the trim loop */
+  int start; /* index of the first point in the trim loop */
+  int end; /* index of the last point in the trim loop */
+  int closed; /* the chain is a complete trim loop inside the cell */
+  int used; /* the chain was assembled into a polygon already */
+  double sin; /* position of the first point on the cell boundary */
+  double sout; /* position of the last point on the cell boundary */
+} ay_tess_adchain;
+
+/* trim loops of the trimmed adaptive tesselation */
+typedef struct ay_tess_adtrim_s {
+  double *uparams; /* grid parameters in U */
+  int nu;
+  double *vparams; /* grid parameters in V */
+  int nv;
+  ay_tess_adtp **loops; /* oriented trim loops split at the grid lines */
+  int *loopslens;
+  double *areas; /* twice the signed parametric areas of the loops */
+  int nloops;
+  int implicit; /* the patch boundary is an implicit outer loop */
+  ay_tess_adchain *chains; /* all chains, sorted by cell */
+  int nchains;
+  int chainsalloc;
+} ay_tess_adtrim;
+
+/* growable polygon (or hole) of the trimmed adaptive tesselation */
+typedef struct ay_tess_adring_s {
+  unsigned int *ids; /* indices of the points */
+  int n;
+  int alloc;
+  int hole; /* -2: polygon, -1: unassigned hole, else enclosing polygon */
+  double area; /* twice the signed parametric area */
+} ay_tess_adring;
+
+/* result of the trimmed adaptive tesselation */
+typedef struct ay_tess_admesh_s {
+  double *v; /* evaluated points and normals [vlen*6] */
+  double *uv; /* parametric coordinates of the points [vlen*2] */
+  unsigned int vlen;
+  unsigned int valloc;
+  unsigned int *verts; /* point indices of the faces */
+  unsigned int vertslen;
+  unsigned int vertsalloc;
+  unsigned int *nverts; /* number of points per face */
+  unsigned int npolys;
+  unsigned int npolysalloc;
+} ay_tess_admesh;
+
 typedef struct ay_curvetess_s {
   int is_rat;
   double *verts;
@@ -136,6 +218,80 @@ int ay_tess_tristopomesh(ay_tess_tri *tris,
 			 int has_vn, int has_vc, int has_tc,
 			 char *myst, char *myvc, ay_object **result);
 
+int ay_tess_gridtopomesh(double *tessv, int tessw, int tessh, int primitives,
+			 ay_object **pm);
+
+void ay_tess_adeval(ay_tess_adctx *ctx, double u, double v, double *P);
+
+int ay_tess_adaddparam(ay_tess_adctx *ctx, double t);
+
+int ay_tess_adcheck(ay_tess_adctx *ctx, int dir, double a, double b,
+		    double *fixed, int nfixed);
+
+int ay_tess_adsplit(ay_tess_adctx *ctx, int dir, double a, double b,
+		    double *fixed, int nfixed, int depth);
+
+int ay_tess_adparams(ay_tess_adctx *ctx, int dir, double *knots, int nknots,
+		     double *fixed, int nfixed, double **params, int *nparams);
+
+int ay_tess_addistinctknots(double *U, int n, int order, double **knots,
+			    int *nknots);
+
+int ay_tess_adfind(double *params, int n, double t);
+
+double ay_tess_adorient(double *a, double *b, double *c);
+
+int ay_tess_adaddpoint(ay_tess_adctx *ctx, ay_tess_admesh *mesh,
+		       double u, double v, unsigned int *index);
+
+int ay_tess_adaddface(ay_tess_admesh *mesh, unsigned int *c, int n);
+
+int ay_tess_adringadd(ay_tess_adring *r, unsigned int index);
+
+double ay_tess_adringarea(ay_tess_admesh *mesh, ay_tess_adring *r);
+
+int ay_tess_adringinside(ay_tess_admesh *mesh, ay_tess_adring *r, double *p);
+
+int ay_tess_adcrossing(double *p1, double *p2, double *p3, double *p4);
+
+int ay_tess_advisible(ay_tess_admesh *mesh, ay_tess_adring *r, int nr,
+		      double *p, double *q);
+
+int ay_tess_adbridge(ay_tess_admesh *mesh, ay_tess_adring *rings,
+		     int nrings, int outer, int hole);
+
+int ay_tess_adearclip(ay_tess_admesh *mesh, ay_tess_adring *r);
+
+int ay_tess_adcmpcross(const void *a, const void *b);
+
+int ay_tess_adcmpchain(const void *a, const void *b);
+
+int ay_tess_adcmpdouble(const void *a, const void *b);
+
+double ay_tess_adnudge(double *params, int n, double t, double eps);
+
+int ay_tess_adcell(ay_tess_adtrim *trim, ay_tess_adtp *p, ay_tess_adtp *q);
+
+double ay_tess_adperim(ay_tess_adtrim *trim, int cell, ay_tess_adtp *p);
+
+int ay_tess_adloops(ay_tess_adctx *ctx, ay_tess_admesh *mesh,
+		    ay_tess_adtrim *trim, int ntrims, double **trims,
+		    int *trimslens);
+
+int ay_tess_adcolumn(ay_tess_adtrim *trim, int i, double **vs, int *nvs,
+		     int *vsalloc);
+
+int ay_tess_adtrimmed(ay_tess_adctx *ctx, double *uparams, int nu,
+		      double *vparams, int nv, int ntrims, double **trims,
+		      int *trimslens, int primitives, ay_object **pm);
+
+int ay_tess_collectnpatches(ay_object *o, double *m,
+			    ay_object ***patches, double **trafos,
+			    int *patcheslen, int *patchesalloc,
+			    ay_object ***provided);
+
+int ay_tess_npatchbatchcb(void *data, int item, int thread);
+
 
 /* functions */
 
@@ -3457,6 +3613,2388 @@ ay_tess_npatchtcmd(ClientData clientData, Tcl_Interp *interp,
 } /* ay_tess_npatchtcmd */
 
 
+/* ay_tess_gridtopomesh:
+ *  convert a regular grid of points and normals (as delivered by
+ *  the STESS surface point evaluation) to a PolyMesh object;
+ *  the grid array is consumed (becomes the control point array of
+ *  the PolyMesh or is freed);
+ *  cells with a collapsed edge (e.g. at poles) are emitted as triangles
+ *  cells with more collapsed edges are omitted
+ *
+ *  tessv - grid of points and normals [tessw*tessh*6]
+ *  tessw - number of points in U direction
+ *  tessh - number of points in V direction
+ *  primitives - what primitives to emit:
+ *   0: Triangles
+ *   1: Quads (same as 2)
+ *   2: Quads
+ *  pm - resulting PolyMesh object
+ */
+int
+ay_tess_gridtopomesh(double *tessv, int tessw, int tessh, int primitives,
+		     ay_object **pm)
+{
+ int ay_status = AY_OK;
+ ay_object *new = NULL;
+ ay_pomesh_object *po = NULL;
+ double *cv, *n, *p1, *p2, len;
+ int i, j, k, l, nc;
+ unsigned int a, b, f, maxpolys, c[4], d[4];
+
+  if(!tessv || !pm)
+    return AY_ENULL;
+
+  if(tessw < 2 || tessh < 2)
+    { ay_status = AY_ERROR; goto cleanup; }
+
+  if(!(new = calloc(1, sizeof(ay_object))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  ay_object_defaults(new);
+  new->type = AY_IDPOMESH;
+
+  if(!(po = calloc(1, sizeof(ay_pomesh_object))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  new->refine = po;
+
+  /* the tesselated points and normals become the control
+     points of the PolyMesh (normalizing the normals on the way) */
+  po->has_normals = AY_TRUE;
+  po->ncontrols = (unsigned int)(tessw*tessh);
+  po->controlv = tessv;
+  tessv = NULL;
+
+  cv = po->controlv;
+  for(a = 0; a < po->ncontrols; a++)
+    {
+      n = &(cv[3]);
+      len = AY_V3LEN(n);
+      if(len > AY_EPSILON)
+	AY_V3SCAL(n, 1.0/len);
+      cv += 6;
+    }
+
+  /* create the faces */
+  maxpolys = (unsigned int)((tessw-1)*(tessh-1)*2);
+
+  if(!(po->nloops = malloc(maxpolys*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  if(!(po->nverts = malloc(maxpolys*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  if(!(po->verts = malloc(maxpolys*3*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  /* the vertex order of the faces is chosen so that the faces
+     are oriented counter clockwise around the normals delivered
+     by the STESS surface point evaluation (du x dv) */
+  cv = po->controlv;
+  b = 0;
+  f = 0;
+  for(i = 0; i < tessw-1; i++)
+    {
+      for(j = 0; j < tessh-1; j++)
+	{
+	  c[0] = (unsigned int)(i*tessh+j);
+	  c[1] = c[0]+(unsigned int)tessh;
+	  c[2] = c[1]+1;
+	  c[3] = c[0]+1;
+
+	  if(!primitives)
+	    {
+	      if(ay_tess_checktri(&(cv[c[0]*6]), &(cv[c[1]*6]),
+				  &(cv[c[2]*6])))
+		{
+		  po->verts[b]   = c[0];
+		  po->verts[b+1] = c[1];
+		  po->verts[b+2] = c[2];
+		  po->nverts[f] = 3;
+		  b += 3;
+		  f++;
+		}
+	      if(ay_tess_checktri(&(cv[c[0]*6]), &(cv[c[2]*6]),
+				  &(cv[c[3]*6])))
+		{
+		  po->verts[b]   = c[0];
+		  po->verts[b+1] = c[2];
+		  po->verts[b+2] = c[3];
+		  po->nverts[f] = 3;
+		  b += 3;
+		  f++;
+		}
+	      continue;
+	    } /* if */
+
+	  /* remove corners that coincide with their successor */
+	  nc = 0;
+	  for(k = 0; k < 4; k++)
+	    {
+	      l = (k+1)%4;
+	      p1 = &(cv[c[k]*6]);
+	      p2 = &(cv[c[l]*6]);
+	      if(!AY_V3COMP(p1, p2))
+		{
+		  d[nc] = c[k];
+		  nc++;
+		}
+	    }
+
+	  if(nc < 3)
+	    continue;
+
+	  for(k = 0; k < nc; k++)
+	    po->verts[b+k] = d[k];
+	  po->nverts[f] = (unsigned int)nc;
+	  b += (unsigned int)nc;
+	  f++;
+	} /* for */
+    } /* for */
+
+  if(!f)
+    { ay_status = AY_ERROR; goto cleanup; }
+
+  po->npolys = f;
+  for(a = 0; a < f; a++)
+    po->nloops[a] = 1;
+
+  /* return result */
+  *pm = new;
+  new = NULL;
+
+cleanup:
+
+  if(tessv)
+    free(tessv);
+
+  if(new)
+    {
+      if(po)
+	{
+	  if(po->controlv)
+	    free(po->controlv);
+	  if(po->nloops)
+	    free(po->nloops);
+	  if(po->nverts)
+	    free(po->nverts);
+	  if(po->verts)
+	    free(po->verts);
+	  free(po);
+	}
+      free(new);
+    }
+
+ return ay_status;
+} /* ay_tess_gridtopomesh */
+
+
+/* ay_tess_npatchgrid:
+ *  tesselate the untrimmed NURBS patch <npatch> on a regular grid
+ *  of parametric values (using the STESS surface point evaluation);
+ *  this function does not use GLU and does not touch any global
+ *  state, so it may be called from multiple threads in parallel;
+ *  trim curves are ignored
+ *
+ *  qf - tesselation quality factor (see ay_stess_GetQF())
+ *  primitives - what primitives to emit:
+ *   0: Triangles
+ *   1: Quads (same as 2)
+ *   2: Quads
+ *  pm - resulting PolyMesh object
+ */
+int
+ay_tess_npatchgrid(ay_nurbpatch_object *npatch, int qf, int primitives,
+		   ay_object **pm)
+{
+ int ay_status = AY_OK;
+ double *tessv = NULL;
+ int tessw = 0, tessh = 0;
+
+  if(!npatch || !pm)
+    return AY_ENULL;
+
+  if(qf < 1)
+    qf = 1;
+
+  if(npatch->is_rat)
+    {
+      ay_status = ay_stess_SurfacePoints4D(npatch->width, npatch->height,
+					   npatch->uorder-1, npatch->vorder-1,
+					   npatch->uknotv, npatch->vknotv,
+					   npatch->controlv, qf,
+					   &tessw, &tessh, &tessv);
+    }
+  else
+    {
+      ay_status = ay_stess_SurfacePoints3D(npatch->width, npatch->height,
+					   npatch->uorder-1, npatch->vorder-1,
+					   npatch->uknotv, npatch->vknotv,
+					   npatch->controlv, qf,
+					   &tessw, &tessh, &tessv);
+    } /* if */
+
+  if(ay_status)
+    return ay_status;
+
+ return ay_tess_gridtopomesh(tessv, tessw, tessh, primitives, pm);
+} /* ay_tess_npatchgrid */
+
+
+/* ay_tess_adeval:
+ *  helper for adaptive tesselation,
+ *  evaluate point and (unnormalized) normal of the patch at <u>,<v>
+ *  into <P> [6]
+ */
+void
+ay_tess_adeval(ay_tess_adctx *ctx, double u, double v, double *P)
+{
+ ay_nurbpatch_object *np = ctx->npatch;
+ double *fder = ctx->fder, *fd1, *fd2, *n;
+
+  fd1 = &(fder[3]);
+  fd2 = &(fder[6]);
+
+  fder[0] = 0.0;
+  fder[1] = 0.0;
+  fder[2] = 0.0;
+  fder[3] = 0.0;
+
+  if(np->is_rat)
+    ay_nb_FirstDerSurf4DM(np->width-1, np->height-1,
+			  np->uorder-1, np->vorder-1,
+			  np->uknotv, np->vknotv, np->controlv, u, v, fder);
+  else
+    ay_nb_FirstDerSurf3DM(np->width-1, np->height-1,
+			  np->uorder-1, np->vorder-1,
+			  np->uknotv, np->vknotv, np->controlv, u, v, fder);
+
+  memcpy(P, fder, 3*sizeof(double));
+  n = &(P[3]);
+  AY_V3CROSS(n, fd2, fd1);
+
+ return;
+} /* ay_tess_adeval */
+
+
+/* ay_tess_adaddparam:
+ *  helper for adaptive tesselation,
+ *  append parameter value <t> to the parameter array of <ctx>
+ */
+int
+ay_tess_adaddparam(ay_tess_adctx *ctx, double t)
+{
+ double *tmp;
+
+  if(ctx->paramslen == ctx->paramsalloc)
+    {
+      ctx->paramsalloc = ctx->paramsalloc?(ctx->paramsalloc*2):64;
+      if(!(tmp = realloc(ctx->params, ctx->paramsalloc*sizeof(double))))
+	return AY_EOMEM;
+      ctx->params = tmp;
+    }
+
+  ctx->params[ctx->paramslen] = t;
+  ctx->paramslen++;
+
+ return AY_OK;
+} /* ay_tess_adaddparam */
+
+
+/* ay_tess_adcheck:
+ *  helper for adaptive tesselation,
+ *  check whether the parametric interval [<a>, <b>] in direction <dir>
+ *  (0 - U, 1 - V) needs to be subdivided, by testing chordal deviation
+ *  and normal deviation along all iso lines given by the <nfixed>
+ *  parameter values in <fixed> (of the other direction);
+ *  returns AY_TRUE if subdivision is needed
+ */
+int
+ay_tess_adcheck(ay_tess_adctx *ctx, int dir, double a, double b,
+		double *fixed, int nfixed)
+{
+ double P[5][6], t, d, len, chord[3], v[3], c[3], n0[3], n1[3], *n;
+ int i, k;
+
+  for(k = 0; k < nfixed; k++)
+    {
+      /* evaluate the iso line at the ends and at three interior points */
+      for(i = 0; i < 5; i++)
+	{
+	  t = a + (b - a)*i*0.25;
+	  if(dir == 0)
+	    ay_tess_adeval(ctx, t, fixed[k], P[i]);
+	  else
+	    ay_tess_adeval(ctx, fixed[k], t, P[i]);
+	}
+
+      /* check chordal deviation of the interior points */
+      AY_V3SUB(chord, P[4], P[0]);
+      len = AY_V3LEN(chord);
+      for(i = 1; i < 4; i++)
+	{
+	  AY_V3SUB(v, P[i], P[0]);
+	  if(len > AY_EPSILON)
+	    {
+	      AY_V3CROSS(c, v, chord);
+	      d = AY_V3LEN(c)/len;
+	    }
+	  else
+	    {
+	      d = AY_V3LEN(v);
+	    }
+	  if(d > ctx->cdev)
+	    return AY_TRUE;
+	} /* for */
+
+      /* check normal deviation */
+      if(ctx->cosndev > -1.0)
+	{
+	  n = &(P[0][3]);
+	  len = AY_V3LEN(n);
+	  if(len <= AY_EPSILON)
+	    continue;
+	  memcpy(n0, n, 3*sizeof(double));
+	  AY_V3SCAL(n0, 1.0/len);
+	  for(i = 1; i < 5; i++)
+	    {
+	      n = &(P[i][3]);
+	      len = AY_V3LEN(n);
+	      if(len <= AY_EPSILON)
+		continue;
+	      memcpy(n1, n, 3*sizeof(double));
+	      AY_V3SCAL(n1, 1.0/len);
+	      if(AY_V3DOT(n0, n1) < ctx->cosndev)
+		return AY_TRUE;
+	    } /* for */
+	} /* if */
+    } /* for */
+
+ return AY_FALSE;
+} /* ay_tess_adcheck */
+
+
+/* ay_tess_adsplit:
+ *  helper for adaptive tesselation,
+ *  recursively subdivide the parametric interval [<a>, <b>] in
+ *  direction <dir> and append all interior parameter values to the
+ *  parameter array of <ctx> (in ascending order)
+ */
+int
+ay_tess_adsplit(ay_tess_adctx *ctx, int dir, double a, double b,
+		double *fixed, int nfixed, int depth)
+{
+ int ay_status = AY_OK;
+ double m;
+
+  if(depth >= ctx->maxdepth)
+    return AY_OK;
+
+  if(!ay_tess_adcheck(ctx, dir, a, b, fixed, nfixed))
+    return AY_OK;
+
+  m = a + (b - a)*0.5;
+
+  ay_status = ay_tess_adsplit(ctx, dir, a, m, fixed, nfixed, depth+1);
+  if(ay_status)
+    return ay_status;
+
+  ay_status = ay_tess_adaddparam(ctx, m);
+  if(ay_status)
+    return ay_status;
+
+ return ay_tess_adsplit(ctx, dir, m, b, fixed, nfixed, depth+1);
+} /* ay_tess_adsplit */
+
+
+/* ay_tess_adparams:
+ *  helper for adaptive tesselation,
+ *  compute the (adaptively refined) parameter values in direction <dir>;
+ *  every knot span (Bezier segment) is subdivided on its own, so that
+ *  all knots end up in the parameter array
+ *
+ *  knots - distinct knots of direction <dir>
+ *  nknots - number of distinct knots
+ *  fixed - parameter values of iso lines of the other direction to test
+ *  nfixed - number of iso lines to test
+ *  params - resulting parameters
+ *  nparams - number of resulting parameters
+ */
+int
+ay_tess_adparams(ay_tess_adctx *ctx, int dir, double *knots, int nknots,
+		 double *fixed, int nfixed, double **params, int *nparams)
+{
+ int ay_status = AY_OK;
+ int i;
+
+  ctx->params = NULL;
+  ctx->paramslen = 0;
+  ctx->paramsalloc = 0;
+
+  for(i = 0; i < nknots-1; i++)
+    {
+      ay_status = ay_tess_adaddparam(ctx, knots[i]);
+      if(ay_status)
+	goto cleanup;
+
+      ay_status = ay_tess_adsplit(ctx, dir, knots[i], knots[i+1],
+				  fixed, nfixed, 0);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  ay_status = ay_tess_adaddparam(ctx, knots[nknots-1]);
+  if(ay_status)
+    goto cleanup;
+
+  /* return result */
+  *params = ctx->params;
+  *nparams = ctx->paramslen;
+  ctx->params = NULL;
+
+cleanup:
+
+  if(ctx->params)
+    free(ctx->params);
+  ctx->params = NULL;
+
+ return ay_status;
+} /* ay_tess_adparams */
+
+
+/* ay_tess_addistinctknots:
+ *  helper for adaptive tesselation,
+ *  get the distinct knots of the valid range of knot vector <U>
+ *  (of <n> control points and order <order>)
+ */
+int
+ay_tess_addistinctknots(double *U, int n, int order, double **knots,
+			int *nknots)
+{
+ double *k;
+ int i, l = 0;
+
+  if(!(k = malloc((n - order + 2)*sizeof(double))))
+    return AY_EOMEM;
+
+  for(i = order-1; i <= n; i++)
+    {
+      if(!l || (U[i] - k[l-1]) > AY_EPSILON)
+	{
+	  k[l] = U[i];
+	  l++;
+	}
+    }
+
+  if(l < 2)
+    {
+      free(k);
+      return AY_ERROR;
+    }
+
+  *knots = k;
+  *nknots = l;
+
+ return AY_OK;
+} /* ay_tess_addistinctknots */
+
+
+/* ay_tess_adfind:
+ *  helper for the trimmed adaptive tesselation,
+ *  find the interval [params[i], params[i+1]] of the <n> ascending
+ *  parameter values in <params> that contains <t>;
+ *  returns i (clamped to [0, n-2])
+ */
+int
+ay_tess_adfind(double *params, int n, double t)
+{
+ int lo = 0, hi = n-2, mid;
+
+  while(lo < hi)
+    {
+      mid = (lo+hi+1)/2;
+      if(params[mid] <= t)
+	lo = mid;
+      else
+	hi = mid-1;
+    }
+
+ return lo;
+} /* ay_tess_adfind */
+
+
+/* ay_tess_adorient:
+ *  helper for the trimmed adaptive tesselation,
+ *  returns twice the signed area of the parametric triangle <a>,<b>,<c>
+ *  (positive if the triangle is oriented counter clockwise)
+ */
+double
+ay_tess_adorient(double *a, double *b, double *c)
+{
+ return (b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]);
+} /* ay_tess_adorient */
+
+
+/* ay_tess_adaddpoint:
+ *  helper for the trimmed adaptive tesselation,
+ *  evaluate the surface at the parametric values <u>, <v> and append
+ *  the point to <mesh>, returning its index in <index>
+ */
+int
+ay_tess_adaddpoint(ay_tess_adctx *ctx, ay_tess_admesh *mesh,
+		   double u, double v, unsigned int *index)
+{
+ double *t;
+
+  if(mesh->vlen == mesh->valloc)
+    {
+      mesh->valloc = mesh->valloc?(mesh->valloc*2):256;
+      if(!(t = realloc(mesh->v, mesh->valloc*6*sizeof(double))))
+	return AY_EOMEM;
+      mesh->v = t;
+      if(!(t = realloc(mesh->uv, mesh->valloc*2*sizeof(double))))
+	return AY_EOMEM;
+      mesh->uv = t;
+    }
+
+  ay_tess_adeval(ctx, u, v, &(mesh->v[mesh->vlen*6]));
+  mesh->uv[mesh->vlen*2]   = u;
+  mesh->uv[mesh->vlen*2+1] = v;
+
+  if(index)
+    *index = mesh->vlen;
+  mesh->vlen++;
+
+ return AY_OK;
+} /* ay_tess_adaddpoint */
+
+
+/* ay_tess_adaddface:
+ *  helper for the trimmed adaptive tesselation,
+ *  append the triangle or quad (of <n> point indices in <c>) to <mesh>;
+ *  corners that coincide with their successor are removed and
+ *  degenerated faces are omitted
+ */
+int
+ay_tess_adaddface(ay_tess_admesh *mesh, unsigned int *c, int n)
+{
+ unsigned int d[4], *t;
+ double *cv = mesh->v;
+ int k, nc = 0;
+
+  if(n == 3)
+    {
+      if(!ay_tess_checktri(&(cv[c[0]*6]), &(cv[c[1]*6]), &(cv[c[2]*6])))
+	return AY_OK;
+      memcpy(d, c, 3*sizeof(unsigned int));
+      nc = 3;
+    }
+  else
+    {
+      for(k = 0; k < n; k++)
+	{
+	  if(!AY_V3COMP((&(cv[c[k]*6])), (&(cv[c[(k+1)%n]*6]))))
+	    {
+	      d[nc] = c[k];
+	      nc++;
+	    }
+	}
+      if(nc < 3)
+	return AY_OK;
+    }
+
+  if(mesh->vertslen+nc > mesh->vertsalloc)
+    {
+      mesh->vertsalloc = mesh->vertsalloc?(mesh->vertsalloc*2):1024;
+      if(!(t = realloc(mesh->verts, mesh->vertsalloc*sizeof(unsigned int))))
+	return AY_EOMEM;
+      mesh->verts = t;
+    }
+
+  if(mesh->npolys == mesh->npolysalloc)
+    {
+      mesh->npolysalloc = mesh->npolysalloc?(mesh->npolysalloc*2):256;
+      if(!(t = realloc(mesh->nverts,
+		       mesh->npolysalloc*sizeof(unsigned int))))
+	return AY_EOMEM;
+      mesh->nverts = t;
+    }
+
+  memcpy(&(mesh->verts[mesh->vertslen]), d, nc*sizeof(unsigned int));
+  mesh->vertslen += nc;
+  mesh->nverts[mesh->npolys] = (unsigned int)nc;
+  mesh->npolys++;
+
+ return AY_OK;
+} /* ay_tess_adaddface */
+
+
+/* ay_tess_adringadd:
+ *  helper for the trimmed adaptive tesselation,
+ *  append the point index <index> to the ring <r>
+ */
+int
+ay_tess_adringadd(ay_tess_adring *r, unsigned int index)
+{
+ unsigned int *t;
+
+  if(r->n == r->alloc)
+    {
+      r->alloc = r->alloc?(r->alloc*2):16;
+      if(!(t = realloc(r->ids, r->alloc*sizeof(unsigned int))))
+	return AY_EOMEM;
+      r->ids = t;
+    }
+  r->ids[r->n] = index;
+  r->n++;
+
+ return AY_OK;
+} /* ay_tess_adringadd */
+
+
+/* ay_tess_adringarea:
+ *  helper for the trimmed adaptive tesselation,
+ *  returns twice the signed parametric area of ring <r>
+ */
+double
+ay_tess_adringarea(ay_tess_admesh *mesh, ay_tess_adring *r)
+{
+ double area = 0.0, *p, *q;
+ int k;
+
+  for(k = 0; k < r->n; k++)
+    {
+      p = &(mesh->uv[r->ids[k]*2]);
+      q = &(mesh->uv[r->ids[(k+1)%r->n]*2]);
+      area += p[0]*q[1] - q[0]*p[1];
+    }
+
+ return area;
+} /* ay_tess_adringarea */
+
+
+/* ay_tess_adringinside:
+ *  helper for the trimmed adaptive tesselation,
+ *  check whether the parametric point <p> is inside of ring <r>
+ *  (even-odd rule)
+ */
+int
+ay_tess_adringinside(ay_tess_admesh *mesh, ay_tess_adring *r, double *p)
+{
+ double *a, *b;
+ int k, inside = AY_FALSE;
+
+  for(k = 0; k < r->n; k++)
+    {
+      a = &(mesh->uv[r->ids[k]*2]);
+      b = &(mesh->uv[r->ids[(k+1)%r->n]*2]);
+      if(((a[1] > p[1]) != (b[1] > p[1])) &&
+	 (p[0] < a[0] + (p[1]-a[1])*(b[0]-a[0])/(b[1]-a[1])))
+	inside = !inside;
+    }
+
+ return inside;
+} /* ay_tess_adringinside */
+
+
+/* ay_tess_adcrossing:
+ *  helper for the trimmed adaptive tesselation,
+ *  check whether the parametric segments <p1>-<p2> and <p3>-<p4>
+ *  intersect properly (i.e. not just touch)
+ */
+int
+ay_tess_adcrossing(double *p1, double *p2, double *p3, double *p4)
+{
+ double d1, d2, d3, d4;
+
+  d1 = ay_tess_adorient(p3, p4, p1);
+  d2 = ay_tess_adorient(p3, p4, p2);
+  d3 = ay_tess_adorient(p1, p2, p3);
+  d4 = ay_tess_adorient(p1, p2, p4);
+
+ return (((d1 > 0.0 && d2 < 0.0) || (d1 < 0.0 && d2 > 0.0)) &&
+	 ((d3 > 0.0 && d4 < 0.0) || (d3 < 0.0 && d4 > 0.0)));
+} /* ay_tess_adcrossing */
+
+
+/* ay_tess_advisible:
+ *  helper for the trimmed adaptive tesselation,
+ *  check whether the parametric segment <p>-<q> crosses no edge
+ *  of the rings <r> (of <nr> rings)
+ */
+int
+ay_tess_advisible(ay_tess_admesh *mesh, ay_tess_adring *r, int nr,
+		  double *p, double *q)
+{
+ double *a, *b;
+ int k, l;
+
+  for(l = 0; l < nr; l++)
+    {
+      for(k = 0; k < r[l].n; k++)
+	{
+	  a = &(mesh->uv[r[l].ids[k]*2]);
+	  b = &(mesh->uv[r[l].ids[(k+1)%r[l].n]*2]);
+	  if(ay_tess_adcrossing(p, q, a, b))
+	    return AY_FALSE;
+	}
+    }
+
+ return AY_TRUE;
+} /* ay_tess_advisible */
+
+
+/* ay_tess_adbridge:
+ *  helper for the trimmed adaptive tesselation,
+ *  merge the hole <rings>[<hole>] (clockwise) into the polygon
+ *  <rings>[<outer>] (counter clockwise) by connecting the hole point
+ *  with the largest U value to the nearest visible polygon point;
+ *  all <nrings> rings are checked for visibility
+ */
+int
+ay_tess_adbridge(ay_tess_admesh *mesh, ay_tess_adring *rings, int nrings,
+		 int outer, int hole)
+{
+ ay_tess_adring *o = &(rings[outer]), *h = &(rings[hole]);
+ unsigned int *t;
+ double *m, *p, d, mind = DBL_MAX;
+ int k, mi = 0, best = -1, pass;
+
+  for(k = 1; k < h->n; k++)
+    {
+      if(mesh->uv[h->ids[k]*2] > mesh->uv[h->ids[mi]*2])
+	mi = k;
+    }
+  m = &(mesh->uv[h->ids[mi]*2]);
+
+  /* prefer polygon points to the right of the hole */
+  for(pass = 0; pass < 2 && best == -1; pass++)
+    {
+      for(k = 0; k < o->n; k++)
+	{
+	  p = &(mesh->uv[o->ids[k]*2]);
+	  if(!pass && p[0] <= m[0])
+	    continue;
+	  d = (p[0]-m[0])*(p[0]-m[0]) + (p[1]-m[1])*(p[1]-m[1]);
+	  if(d < mind && ay_tess_advisible(mesh, rings, nrings, m, p))
+	    {
+	      mind = d;
+	      best = k;
+	    }
+	}
+    }
+
+  if(best == -1)
+    return AY_ERROR;
+
+  /* insert: ..., o[best], h[mi], ..., h[mi-1], h[mi], o[best], ... */
+  if(o->alloc < o->n+h->n+2)
+    {
+      if(!(t = realloc(o->ids, (o->n+h->n+2)*sizeof(unsigned int))))
+	return AY_EOMEM;
+      o->ids = t;
+      o->alloc = o->n+h->n+2;
+    }
+
+  memmove(&(o->ids[best+h->n+3]), &(o->ids[best+1]),
+	  (o->n-best-1)*sizeof(unsigned int));
+  for(k = 0; k <= h->n; k++)
+    o->ids[best+1+k] = h->ids[(mi+k)%h->n];
+  o->ids[best+h->n+2] = o->ids[best];
+  o->n += h->n+2;
+
+  h->n = 0;
+
+ return AY_OK;
+} /* ay_tess_adbridge */
+
+
+/* ay_tess_adearclip:
+ *  helper for the trimmed adaptive tesselation,
+ *  triangulate the polygon <r> (counter clockwise in parameter space,
+ *  holes already bridged) by ear clipping; the ring is consumed
+ */
+int
+ay_tess_adearclip(ay_tess_admesh *mesh, ay_tess_adring *r)
+{
+ int ay_status = AY_OK;
+ unsigned int *ids = r->ids, tri[3];
+ double *uv = mesh->uv, *a, *b, *c, *p, cr, mincr;
+ int k, ka, kc, m, n = r->n, found, mink;
+
+  while(n > 3)
+    {
+      found = AY_FALSE;
+      mink = 0;
+      mincr = DBL_MAX;
+      for(k = 0; k < n; k++)
+	{
+	  ka = (k+n-1)%n;
+	  kc = (k+1)%n;
+	  a = &(uv[ids[ka]*2]);
+	  b = &(uv[ids[k]*2]);
+	  c = &(uv[ids[kc]*2]);
+	  cr = ay_tess_adorient(a, b, c);
+	  if(fabs(cr) < mincr)
+	    {
+	      mincr = fabs(cr);
+	      mink = k;
+	    }
+	  if(cr <= 0.0)
+	    continue;
+
+	  /* an ear must not contain other points (points on the new
+	     diagonal included, to avoid T-junctions) */
+	  for(m = 0; m < n; m++)
+	    {
+	      if(ids[m] == ids[ka] || ids[m] == ids[k] || ids[m] == ids[kc])
+		continue;
+	      p = &(uv[ids[m]*2]);
+	      if(ay_tess_adorient(a, b, p) >= 0.0 &&
+		 ay_tess_adorient(b, c, p) >= 0.0 &&
+		 ay_tess_adorient(c, a, p) >= 0.0)
+		break;
+	    }
+	  if(m < n)
+	    continue;
+
+	  tri[0] = ids[ka];
+	  tri[1] = ids[k];
+	  tri[2] = ids[kc];
+	  ay_status = ay_tess_adaddface(mesh, tri, 3);
+	  if(ay_status)
+	    return ay_status;
+	  found = AY_TRUE;
+	  break;
+	} /* for */
+
+      /* if no ear was found, the polygon is degenerated:
+	 drop its flattest corner */
+      if(found)
+	mink = k;
+      memmove(&(ids[mink]), &(ids[mink+1]), (n-mink-1)*sizeof(unsigned int));
+      n--;
+    } /* while */
+
+  if(n == 3 &&
+     ay_tess_adorient(&(uv[ids[0]*2]), &(uv[ids[1]*2]), &(uv[ids[2]*2])) > 0.0)
+    ay_status = ay_tess_adaddface(mesh, ids, 3);
+
+  r->n = 0;
+
+ return ay_status;
+} /* ay_tess_adearclip */
+
+
+/* ay_tess_adcmpcross:
+ *  helper for the trimmed adaptive tesselation,
+ *  compare two grid line crossings by their segment parameter
+ *  (for qsort())
+ */
+int
+ay_tess_adcmpcross(const void *a, const void *b)
+{
+ const ay_tess_adtp *p = a, *q = b;
+
+  if(p->t < q->t)
+    return -1;
+  if(p->t > q->t)
+    return 1;
+
+ return 0;
+} /* ay_tess_adcmpcross */
+
+
+/* ay_tess_adcmpchain:
+ *  helper for the trimmed adaptive tesselation,
+ *  compare two chains by their cell (for qsort())
+ */
+int
+ay_tess_adcmpchain(const void *a, const void *b)
+{
+ const ay_tess_adchain *p = a, *q = b;
+
+  if(p->cell != q->cell)
+    return (p->cell < q->cell)?-1:1;
+  if(p->loop != q->loop)
+    return (p->loop < q->loop)?-1:1;
+
+ return (p->start < q->start)?-1:((p->start > q->start)?1:0);
+} /* ay_tess_adcmpchain */
+
+
+/* ay_tess_adcmpdouble:
+ *  helper for the trimmed adaptive tesselation,
+ *  compare two doubles (for qsort())
+ */
+int
+ay_tess_adcmpdouble(const void *a, const void *b)
+{
+ const double *p = a, *q = b;
+
+ return (*p < *q)?-1:((*p > *q)?1:0);
+} /* ay_tess_adcmpdouble */
+
+
+/* ay_tess_adnudge:
+ *  helper for the trimmed adaptive tesselation,
+ *  clamp the parametric value <t> into the interior of the grid
+ *  (given by the <n> ascending parameter values <params>) and
+ *  move it off the grid lines, so that trim loops never run along
+ *  grid lines or through grid points
+ */
+double
+ay_tess_adnudge(double *params, int n, double t, double eps)
+{
+ int i;
+
+  if(t < params[0]+eps)
+    t = params[0]+eps;
+  if(t > params[n-1]-eps)
+    t = params[n-1]-eps;
+
+  i = ay_tess_adfind(params, n, t);
+  if(t - params[i] < eps)
+    t = params[i]+eps;
+  else
+    if(params[i+1] - t < eps)
+      t = params[i+1]-eps;
+
+ return t;
+} /* ay_tess_adnudge */
+
+
+/* ay_tess_adcell:
+ *  helper for the trimmed adaptive tesselation,
+ *  get the grid cell containing the trim loop segment <p>-<q>
+ */
+int
+ay_tess_adcell(ay_tess_adtrim *trim, ay_tess_adtp *p, ay_tess_adtp *q)
+{
+ int i, j;
+
+  i = ay_tess_adfind(trim->uparams, trim->nu, (p->u+q->u)*0.5);
+  j = ay_tess_adfind(trim->vparams, trim->nv, (p->v+q->v)*0.5);
+
+ return i*(trim->nv-1)+j;
+} /* ay_tess_adcell */
+
+
+/* ay_tess_adperim:
+ *  helper for the trimmed adaptive tesselation,
+ *  get the position of trim loop point <p> (which is on a grid line)
+ *  on the boundary of the grid cell <cell>;
+ *  the boundary is parameterized counter clockwise from 0.0 (lower left
+ *  corner) over 1.0 (lower right), 2.0 (upper right) and 3.0 (upper left)
+ *  to 4.0 (lower left corner again)
+ */
+double
+ay_tess_adperim(ay_tess_adtrim *trim, int cell, ay_tess_adtp *p)
+{
+ int i = cell/(trim->nv-1), j = cell%(trim->nv-1);
+ double u0, u1, v0, v1, s, edge;
+
+  u0 = trim->uparams[i];
+  u1 = trim->uparams[i+1];
+  v0 = trim->vparams[j];
+  v1 = trim->vparams[j+1];
+
+  if(p->onv == j)
+    {
+      edge = 0.0;
+      s = (p->u-u0)/(u1-u0);
+    }
+  else
+    if(p->onu == i+1)
+      {
+	edge = 1.0;
+	s = (p->v-v0)/(v1-v0);
+      }
+    else
+      if(p->onv == j+1)
+	{
+	  edge = 2.0;
+	  s = (u1-p->u)/(u1-u0);
+	}
+      else
+	{
+	  edge = 3.0;
+	  s = (v1-p->v)/(v1-v0);
+	}
+
+  if(s < 0.0)
+    s = 0.0;
+  if(s > 1.0)
+    s = 1.0;
+
+  s += edge;
+  if(s >= 4.0)
+    s -= 4.0;
+
+ return s;
+} /* ay_tess_adperim */
+
+
+/* ay_tess_adloops:
+ *  helper for the trimmed adaptive tesselation,
+ *  prepare the trim loops: clamp them to the parametric domain, move
+ *  them off the grid lines, orient them (so that the trimmed surface
+ *  is always to the left), split them at all grid line crossings,
+ *  evaluate all their points, and cut them into chains per grid cell
+ */
+int
+ay_tess_adloops(ay_tess_adctx *ctx, ay_tess_admesh *mesh,
+		ay_tess_adtrim *trim, int ntrims, double **trims,
+		int *trimslens)
+{
+ int ay_status = AY_OK;
+ double *uparams = trim->uparams, *vparams = trim->vparams;
+ double epsu, epsv, u, v, a;
+ ay_tess_adtp *l, *q, *cr = NULL, p1, p2, tp, *t;
+ ay_tess_adchain *ch, *tc;
+ int nu = trim->nu, nv = trim->nv, nl = 0, n, k, m, i, lo, hi, ncr;
+ int crlen = 0, depth, inside, first, cell, last, len;
+
+  epsu = (uparams[nu-1]-uparams[0])*1.0e-10;
+  epsv = (vparams[nv-1]-vparams[0])*1.0e-10;
+
+  if(!(trim->loops = calloc(ntrims, sizeof(ay_tess_adtp *))))
+    return AY_EOMEM;
+  if(!(trim->loopslens = calloc(ntrims, sizeof(int))))
+    return AY_EOMEM;
+  if(!(trim->areas = calloc(ntrims, sizeof(double))))
+    return AY_EOMEM;
+
+  /* copy, clamp, and nudge the loops, removing duplicate points */
+  for(k = 0; k < ntrims; k++)
+    {
+      if(!trims[k] || trimslens[k] < 3)
+	continue;
+      if(!(l = malloc(trimslens[k]*sizeof(ay_tess_adtp))))
+	{ ay_status = AY_EOMEM; goto cleanup; }
+      n = 0;
+      for(m = 0; m < trimslens[k]; m++)
+	{
+	  u = ay_tess_adnudge(uparams, nu, trims[k][m*2], epsu);
+	  v = ay_tess_adnudge(vparams, nv, trims[k][m*2+1], epsv);
+	  if(n && l[n-1].u == u && l[n-1].v == v)
+	    continue;
+	  l[n].u = u;
+	  l[n].v = v;
+	  l[n].onu = -1;
+	  l[n].onv = -1;
+	  n++;
+	}
+      while(n > 1 && l[n-1].u == l[0].u && l[n-1].v == l[0].v)
+	n--;
+
+      a = 0.0;
+      for(m = 0; m < n; m++)
+	a += l[m].u*l[(m+1)%n].v - l[(m+1)%n].u*l[m].v;
+
+      if(n < 3 || a == 0.0)
+	{
+	  free(l);
+	  continue;
+	}
+
+      trim->loops[nl] = l;
+      trim->loopslens[nl] = n;
+      trim->areas[nl] = a;
+      nl++;
+    } /* for */
+
+  trim->nloops = nl;
+
+  /* no (valid) trim loops: the patch boundary is the only loop */
+  if(!nl)
+    {
+      trim->implicit = AY_TRUE;
+      goto cleanup;
+    }
+
+  /* if the first loop is clockwise, the patch boundary
+     is an implicit outer loop */
+  trim->implicit = (trim->areas[0] < 0.0);
+
+  /* orient the loops: the points just inside a loop are part of the
+     trimmed surface, if the number of loops containing them is odd
+     (plus the implicit loop), and those loops must be oriented counter
+     clockwise, all other loops clockwise */
+  for(k = 0; k < nl; k++)
+    {
+      tp = trim->loops[k][0];
+      depth = 0;
+      for(m = 0; m < nl; m++)
+	{
+	  if(m == k)
+	    continue;
+	  l = trim->loops[m];
+	  n = trim->loopslens[m];
+	  inside = AY_FALSE;
+	  for(i = 0; i < n; i++)
+	    {
+	      p1 = l[i];
+	      p2 = l[(i+1)%n];
+	      if(((p1.v > tp.v) != (p2.v > tp.v)) &&
+		 (tp.u < p1.u + (tp.v-p1.v)*(p2.u-p1.u)/(p2.v-p1.v)))
+		inside = !inside;
+	    }
+	  if(inside)
+	    depth++;
+	} /* for */
+
+      if((((depth%2) == 0) != trim->implicit) != (trim->areas[k] > 0.0))
+	{
+	  /* reverse the loop */
+	  l = trim->loops[k];
+	  n = trim->loopslens[k];
+	  for(i = 0; i < n/2; i++)
+	    {
+	      tp = l[i];
+	      l[i] = l[n-1-i];
+	      l[n-1-i] = tp;
+	    }
+	  trim->areas[k] = -trim->areas[k];
+	}
+    } /* for */
+
+  /* split the loops at the grid lines and evaluate their points */
+  for(k = 0; k < nl; k++)
+    {
+      l = trim->loops[k];
+      n = trim->loopslens[k];
+      len = n;
+      if(!(q = malloc(len*sizeof(ay_tess_adtp))))
+	{ ay_status = AY_EOMEM; goto cleanup; }
+      last = 0;
+      for(m = 0; m < n; m++)
+	{
+	  p1 = l[m];
+	  p2 = l[(m+1)%n];
+
+	  /* collect all crossings of the segment with grid lines */
+	  ncr = 0;
+	  for(i = 0; i < 2; i++)
+	    {
+	      if(!i)
+		{
+		  if(p1.u == p2.u)
+		    continue;
+		  lo = ay_tess_adfind(uparams, nu, (p1.u<p2.u)?p1.u:p2.u)+1;
+		  a = (p1.u<p2.u)?p2.u:p1.u;
+		  hi = nu;
+		}
+	      else
+		{
+		  if(p1.v == p2.v)
+		    continue;
+		  lo = ay_tess_adfind(vparams, nv, (p1.v<p2.v)?p1.v:p2.v)+1;
+		  a = (p1.v<p2.v)?p2.v:p1.v;
+		  hi = nv;
+		}
+	      for(; lo < hi && (i?vparams[lo]:uparams[lo]) < a; lo++)
+		{
+		  if(ncr == crlen)
+		    {
+		      crlen = crlen?(crlen*2):16;
+		      if(!(t = realloc(cr, crlen*sizeof(ay_tess_adtp))))
+			{ ay_status = AY_EOMEM; goto cleanup; }
+		      cr = t;
+		    }
+		  /* compute the crossings independently of the
+		     direction of the segment */
+		  if(!i)
+		    {
+		      tp.u = uparams[lo];
+		      if(p1.u < p2.u)
+			tp.v = p1.v + (tp.u-p1.u)*(p2.v-p1.v)/(p2.u-p1.u);
+		      else
+			tp.v = p2.v + (tp.u-p2.u)*(p1.v-p2.v)/(p1.u-p2.u);
+		      tp.t = (tp.u-p1.u)/(p2.u-p1.u);
+		      tp.onu = lo;
+		      tp.onv = -1;
+		    }
+		  else
+		    {
+		      tp.v = vparams[lo];
+		      if(p1.v < p2.v)
+			tp.u = p1.u + (tp.v-p1.v)*(p2.u-p1.u)/(p2.v-p1.v);
+		      else
+			tp.u = p2.u + (tp.v-p2.v)*(p1.u-p2.u)/(p1.v-p2.v);
+		      tp.t = (tp.v-p1.v)/(p2.v-p1.v);
+		      tp.onu = -1;
+		      tp.onv = lo;
+		    }
+		  cr[ncr] = tp;
+		  ncr++;
+		} /* for */
+	    } /* for */
+
+	  if(ncr > 1)
+	    qsort(cr, ncr, sizeof(ay_tess_adtp), ay_tess_adcmpcross);
+
+	  /* merge crossings through grid points */
+	  i = 0;
+	  for(lo = 0; lo < ncr; lo++)
+	    {
+	      if(i && (cr[lo].t - cr[i-1].t) < 1.0e-12 &&
+		 ((cr[lo].onu == -1) != (cr[i-1].onu == -1)))
+		{
+		  if(cr[lo].onu != -1)
+		    cr[i-1].onu = cr[lo].onu;
+		  else
+		    cr[i-1].onv = cr[lo].onv;
+		  cr[i-1].u = uparams[cr[i-1].onu];
+		  cr[i-1].v = vparams[cr[i-1].onv];
+		  continue;
+		}
+	      cr[i] = cr[lo];
+	      i++;
+	    }
+	  ncr = i;
+
+	  if(last+1+ncr > len)
+	    {
+	      len = (last+1+ncr)*2;
+	      if(!(t = realloc(q, len*sizeof(ay_tess_adtp))))
+		{ free(q); ay_status = AY_EOMEM; goto cleanup; }
+	      q = t;
+	    }
+	  q[last] = p1;
+	  last++;
+	  memcpy(&(q[last]), cr, ncr*sizeof(ay_tess_adtp));
+	  last += ncr;
+	} /* for */
+
+      free(trim->loops[k]);
+      trim->loops[k] = q;
+      trim->loopslens[k] = last;
+
+      /* evaluate the points; crossings through grid points
+	 use the respective grid point */
+      for(m = 0; m < last; m++)
+	{
+	  if(q[m].onu != -1 && q[m].onv != -1)
+	    {
+	      q[m].index = (unsigned int)(q[m].onu*nv+q[m].onv);
+	    }
+	  else
+	    {
+	      ay_status = ay_tess_adaddpoint(ctx, mesh, q[m].u, q[m].v,
+					     &(q[m].index));
+	      if(ay_status)
+		goto cleanup;
+	    }
+	}
+    } /* for */
+
+  /* cut the loops into chains per grid cell; loops that do not
+     cross any grid line become a single (closed) chain */
+  for(k = 0; k < nl; k++)
+    {
+      q = trim->loops[k];
+      n = trim->loopslens[k];
+
+      first = -1;
+      for(m = 0; m < n; m++)
+	{
+	  if(q[m].onu != -1 || q[m].onv != -1)
+	    {
+	      first = m;
+	      break;
+	    }
+	}
+
+      m = (first == -1)?0:first;
+      do
+	{
+	  /* find the end of the chain (next grid line crossing) */
+	  last = m;
+	  if(first != -1)
+	    {
+	      do
+		{
+		  last = (last+1)%n;
+		}
+	      while(q[last].onu == -1 && q[last].onv == -1);
+	    }
+
+	  if(trim->nchains == trim->chainsalloc)
+	    {
+	      trim->chainsalloc = trim->chainsalloc?(trim->chainsalloc*2):64;
+	      if(!(tc = realloc(trim->chains,
+				trim->chainsalloc*sizeof(ay_tess_adchain))))
+		{ ay_status = AY_EOMEM; goto cleanup; }
+	      trim->chains = tc;
+	    }
+
+	  cell = ay_tess_adcell(trim, &(q[m]), &(q[(m+1)%n]));
+	  ch = &(trim->chains[trim->nchains]);
+	  ch->cell = cell;
+	  ch->loop = k;
+	  ch->start = m;
+	  ch->end = last;
+	  ch->closed = (first == -1);
+	  ch->used = AY_FALSE;
+	  if(!ch->closed)
+	    {
+	      ch->sin = ay_tess_adperim(trim, cell, &(q[m]));
+	      ch->sout = ay_tess_adperim(trim, cell, &(q[last]));
+	    }
+	  trim->nchains++;
+
+	  m = last;
+	}
+      while(first != -1 && m != first);
+    } /* for */
+
+  if(trim->nchains > 1)
+    qsort(trim->chains, trim->nchains, sizeof(ay_tess_adchain),
+	  ay_tess_adcmpchain);
+
+cleanup:
+
+  if(cr)
+    free(cr);
+
+ return ay_status;
+} /* ay_tess_adloops */
+
+
+/* ay_tess_adcolumn:
+ *  helper for the trimmed adaptive tesselation,
+ *  get the sorted V values where the trim loops cross the middle
+ *  of grid column <i>
+ */
+int
+ay_tess_adcolumn(ay_tess_adtrim *trim, int i, double **vs, int *nvs,
+		 int *vsalloc)
+{
+ ay_tess_adtp *q, *a, *b;
+ double um, *t;
+ int k, m, n;
+
+  um = (trim->uparams[i]+trim->uparams[i+1])*0.5;
+  *nvs = 0;
+
+  for(k = 0; k < trim->nloops; k++)
+    {
+      q = trim->loops[k];
+      n = trim->loopslens[k];
+      for(m = 0; m < n; m++)
+	{
+	  a = &(q[m]);
+	  b = &(q[(m+1)%n]);
+	  if((a->u < um) != (b->u < um))
+	    {
+	      if(*nvs == *vsalloc)
+		{
+		  *vsalloc = *vsalloc?(*vsalloc*2):16;
+		  if(!(t = realloc(*vs, *vsalloc*sizeof(double))))
+		    return AY_EOMEM;
+		  *vs = t;
+		}
+	      (*vs)[*nvs] = a->v + (um-a->u)*(b->v-a->v)/(b->u-a->u);
+	      (*nvs)++;
+	    }
+	}
+    }
+
+  if(*nvs > 1)
+    qsort(*vs, *nvs, sizeof(double), ay_tess_adcmpdouble);
+
+ return AY_OK;
+} /* ay_tess_adcolumn */
+
+
+/* ay_tess_adtrimmed:
+ *  helper for ay_tess_npatchadaptive(),
+ *  tesselate the grid given by <uparams>/<vparams> clipped by the
+ *  trim loops <trims>;
+ *  the trim loops are split at all grid lines they cross, so that
+ *  every grid cell is either completely inside, completely outside,
+ *  or clipped by some pieces (chains) of the trim loops;
+ *  the polygons of clipped cells are assembled from the chains and
+ *  the cell corners (walking the cell boundary counter clockwise
+ *  from the end of a chain to the start of the next chain) and are
+ *  triangulated by ear clipping;
+ *  as adjacent cells share the points on the grid lines, the
+ *  tesselation is free of cracks
+ */
+int
+ay_tess_adtrimmed(ay_tess_adctx *ctx, double *uparams, int nu,
+		  double *vparams, int nv, int ntrims, double **trims,
+		  int *trimslens, int primitives, ay_object **pm)
+{
+ int ay_status = AY_OK;
+ ay_tess_admesh mesh = {0};
+ ay_tess_adtrim trim = {0};
+ ay_tess_adring *rings = NULL, *r, *tr;
+ ay_tess_adchain *ch, *cur;
+ ay_tess_adtp *q;
+ ay_object *new = NULL;
+ ay_pomesh_object *po = NULL;
+ unsigned int c[4], *remap = NULL, a;
+ double *vs = NULL, d, bestd, s, *p, len, *n;
+ int nvs = 0, vsalloc = 0, nrings = 0, ringsalloc = 0;
+ int i, j, k, l, m, cell, first, last, best, clipped, cnt, rect;
+
+  trim.uparams = uparams;
+  trim.nu = nu;
+  trim.vparams = vparams;
+  trim.nv = nv;
+
+  /* evaluate the grid */
+  for(i = 0; i < nu; i++)
+    {
+      for(j = 0; j < nv; j++)
+	{
+	  ay_status = ay_tess_adaddpoint(ctx, &mesh, uparams[i], vparams[j],
+					 NULL);
+	  if(ay_status)
+	    goto cleanup;
+	}
+    }
+
+  ay_status = ay_tess_adloops(ctx, &mesh, &trim, ntrims, trims, trimslens);
+  if(ay_status)
+    goto cleanup;
+
+  /* tesselate the cells */
+  first = 0;
+  for(i = 0; i < nu-1; i++)
+    {
+      ay_status = ay_tess_adcolumn(&trim, i, &vs, &nvs, &vsalloc);
+      if(ay_status)
+	goto cleanup;
+
+      cnt = 0;
+      for(j = 0; j < nv-1; j++)
+	{
+	  cell = i*(nv-1)+j;
+
+	  /* count the trim loops below the cell */
+	  while(cnt < nvs && vs[cnt] < vparams[j])
+	    cnt++;
+
+	  c[0] = (unsigned int)(i*nv+j);
+	  c[1] = c[0]+(unsigned int)nv;
+	  c[2] = c[1]+1;
+	  c[3] = c[0]+1;
+
+	  /* get the chains of this cell */
+	  while(first < trim.nchains && trim.chains[first].cell < cell)
+	    first++;
+	  last = first;
+	  clipped = AY_FALSE;
+	  while(last < trim.nchains && trim.chains[last].cell == cell)
+	    {
+	      if(!trim.chains[last].closed)
+		clipped = AY_TRUE;
+	      last++;
+	    }
+
+	  if(first == last)
+	    {
+	      /* not clipped */
+	      if(((cnt%2) == 1) != trim.implicit)
+		{
+		  if(primitives)
+		    {
+		      ay_status = ay_tess_adaddface(&mesh, c, 4);
+		    }
+		  else
+		    {
+		      ay_status = ay_tess_adaddface(&mesh, c, 3);
+		      if(!ay_status)
+			{
+			  c[1] = c[2];
+			  c[2] = c[3];
+			  ay_status = ay_tess_adaddface(&mesh, c, 3);
+			}
+		    }
+		  if(ay_status)
+		    goto cleanup;
+		}
+	      continue;
+	    } /* if */
+
+	  /* assemble the polygons of this cell */
+	  for(k = 0; k < nrings; k++)
+	    rings[k].n = 0;
+	  nrings = 0;
+	  rect = AY_FALSE;
+
+	  if(!clipped && (((cnt%2) == 1) != trim.implicit))
+	    {
+	      /* only closed chains, the cell is inside */
+	      rect = AY_TRUE;
+	    }
+
+	  for(k = first; k <= last; k++)
+	    {
+	      if((k == last && !rect) || (k < last && trim.chains[k].used))
+		continue;
+
+	      if(nrings == ringsalloc)
+		{
+		  ringsalloc = ringsalloc?(ringsalloc*2):8;
+		  if(!(tr = realloc(rings, ringsalloc*sizeof(ay_tess_adring))))
+		    { ay_status = AY_EOMEM; goto cleanup; }
+		  rings = tr;
+		  memset(&(rings[nrings]), 0,
+			 (ringsalloc-nrings)*sizeof(ay_tess_adring));
+		}
+	      r = &(rings[nrings]);
+	      r->n = 0;
+	      r->hole = -2;
+	      nrings++;
+
+	      if(k == last)
+		{
+		  /* the cell itself */
+		  for(m = 0; m < 4; m++)
+		    {
+		      ay_status = ay_tess_adringadd(r, c[m]);
+		      if(ay_status)
+			goto cleanup;
+		    }
+		  continue;
+		}
+
+	      cur = &(trim.chains[k]);
+
+	      /* closed chains oriented clockwise are holes */
+	      if(cur->closed && trim.areas[cur->loop] < 0.0)
+		r->hole = -1;
+
+	      while(1)
+		{
+		  cur->used = AY_TRUE;
+		  q = trim.loops[cur->loop];
+
+		  /* append the chain */
+		  m = cur->start;
+		  do
+		    {
+		      ay_status = ay_tess_adringadd(r, q[m].index);
+		      if(ay_status)
+			goto cleanup;
+		      m = (m+1)%trim.loopslens[cur->loop];
+		    }
+		  while(m != cur->end);
+
+		  if(cur->closed)
+		    break;
+
+		  if(cur->end != cur->start)
+		    {
+		      ay_status = ay_tess_adringadd(r, q[m].index);
+		      if(ay_status)
+			goto cleanup;
+		    }
+
+		  /* find the next chain along the cell boundary */
+		  best = -1;
+		  bestd = DBL_MAX;
+		  for(m = first; m < last; m++)
+		    {
+		      ch = &(trim.chains[m]);
+		      if(ch->closed)
+			continue;
+		      d = ch->sin - cur->sout;
+		      if(d < 0.0)
+			d += 4.0;
+		      if(d < bestd)
+			{
+			  bestd = d;
+			  best = m;
+			}
+		    }
+
+		  /* append the cell corners in between */
+		  s = floor(cur->sout);
+		  for(m = 1; m <= 4; m++)
+		    {
+		      d = s+m-cur->sout;
+		      if(d <= 1.0e-12)
+			continue;
+		      if(d >= bestd-1.0e-12)
+			break;
+		      ay_status = ay_tess_adringadd(r, c[((int)s+m)%4]);
+		      if(ay_status)
+			goto cleanup;
+		    }
+
+		  if(best == -1 || trim.chains[best].used)
+		    break;
+
+		  cur = &(trim.chains[best]);
+		} /* while */
+	    } /* for */
+
+	  /* assign the holes to the smallest enclosing polygons */
+	  for(k = 0; k < nrings; k++)
+	    rings[k].area = ay_tess_adringarea(&mesh, &(rings[k]));
+
+	  for(k = 0; k < nrings; k++)
+	    {
+	      if(rings[k].hole != -1 || rings[k].n == 0)
+		continue;
+	      p = &(mesh.uv[rings[k].ids[0]*2]);
+	      best = -1;
+	      for(m = 0; m < nrings; m++)
+		{
+		  if(rings[m].hole != -2 ||
+		     !ay_tess_adringinside(&mesh, &(rings[m]), p))
+		    continue;
+		  if(best == -1 || rings[m].area < rings[best].area)
+		    best = m;
+		}
+	      rings[k].hole = best;
+	    }
+
+	  /* triangulate */
+	  for(m = 0; m < nrings; m++)
+	    {
+	      r = &(rings[m]);
+	      if(r->hole != -2 || r->n < 3)
+		continue;
+
+	      /* bridge the holes, rightmost first */
+	      while(1)
+		{
+		  best = -1;
+		  bestd = -DBL_MAX;
+		  for(k = 0; k < nrings; k++)
+		    {
+		      if(rings[k].hole != m)
+			continue;
+		      for(l = 0; l < rings[k].n; l++)
+			{
+			  if(mesh.uv[rings[k].ids[l]*2] > bestd)
+			    {
+			      bestd = mesh.uv[rings[k].ids[l]*2];
+			      best = k;
+			    }
+			}
+		    }
+		  if(best == -1)
+		    break;
+		  if(ay_tess_adbridge(&mesh, rings, nrings, m, best) ==
+		     AY_EOMEM)
+		    { ay_status = AY_EOMEM; goto cleanup; }
+		  /* holes that can not be bridged are dropped */
+		  rings[best].n = 0;
+		}
+
+	      ay_status = ay_tess_adearclip(&mesh, r);
+	      if(ay_status)
+		goto cleanup;
+	    } /* for */
+	} /* for */
+    } /* for */
+
+  if(!mesh.npolys)
+    { ay_status = AY_ERROR; goto cleanup; }
+
+  /* create the PolyMesh from the used points */
+  if(!(remap = malloc(mesh.vlen*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  for(a = 0; a < mesh.vlen; a++)
+    remap[a] = mesh.vlen;
+  for(a = 0; a < mesh.vertslen; a++)
+    remap[mesh.verts[a]] = 0;
+
+  if(!(new = calloc(1, sizeof(ay_object))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  ay_object_defaults(new);
+  new->type = AY_IDPOMESH;
+
+  if(!(po = calloc(1, sizeof(ay_pomesh_object))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  new->refine = po;
+
+  po->has_normals = AY_TRUE;
+  for(a = 0; a < mesh.vlen; a++)
+    {
+      if(remap[a] == mesh.vlen)
+	continue;
+      remap[a] = po->ncontrols;
+      memmove(&(mesh.v[po->ncontrols*6]), &(mesh.v[a*6]),
+	      6*sizeof(double));
+      n = &(mesh.v[po->ncontrols*6+3]);
+      len = AY_V3LEN(n);
+      if(len > AY_EPSILON)
+	AY_V3SCAL(n, 1.0/len);
+      po->ncontrols++;
+    }
+
+  for(a = 0; a < mesh.vertslen; a++)
+    mesh.verts[a] = remap[mesh.verts[a]];
+
+  if(!(po->nloops = malloc(mesh.npolys*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  for(a = 0; a < mesh.npolys; a++)
+    po->nloops[a] = 1;
+
+  po->npolys = mesh.npolys;
+  po->controlv = mesh.v;
+  mesh.v = NULL;
+  po->nverts = mesh.nverts;
+  mesh.nverts = NULL;
+  po->verts = mesh.verts;
+  mesh.verts = NULL;
+
+  /* return result */
+  *pm = new;
+  new = NULL;
+
+cleanup:
+
+  if(new)
+    {
+      if(po)
+	{
+	  if(po->nloops)
+	    free(po->nloops);
+	  free(po);
+	}
+      free(new);
+    }
+
+  if(remap)
+    free(remap);
+
+  if(vs)
+    free(vs);
+
+  if(rings)
+    {
+      for(k = 0; k < ringsalloc; k++)
+	if(rings[k].ids)
+	  free(rings[k].ids);
+      free(rings);
+    }
+
+  if(trim.loops)
+    {
+      for(k = 0; k < trim.nloops; k++)
+	if(trim.loops[k])
+	  free(trim.loops[k]);
+      free(trim.loops);
+    }
+
+  if(trim.loopslens)
+    free(trim.loopslens);
+
+  if(trim.areas)
+    free(trim.areas);
+
+  if(trim.chains)
+    free(trim.chains);
+
+  if(mesh.v)
+    free(mesh.v);
+  if(mesh.uv)
+    free(mesh.uv);
+  if(mesh.verts)
+    free(mesh.verts);
+  if(mesh.nverts)
+    free(mesh.nverts);
+
+ return ay_status;
+} /* ay_tess_adtrimmed */
+
+
+/* ay_tess_npatchadaptive:
+ *  tesselate the NURBS patch <npatch> adaptively, without GLU;
+ *  the patch is decomposed into its Bezier segments (knot spans)
+ *  which are recursively subdivided (independently in U and V) until
+ *  the chordal deviation of the tesselation from the surface and the
+ *  deviation of the surface normals over a subdivided interval are
+ *  below the given tolerances;
+ *  as the result is a (non uniform) tensor product grid of parametric
+ *  values, the tesselation is free of cracks;
+ *  trimmed patches are handled by clipping the grid against the
+ *  (already tesselated) trim loops, see ay_tess_adtrimmed();
+ *  this function does not touch any global state, so it may be called
+ *  from multiple threads in parallel
+ *
+ *  ntrims - number of trim loops (0 for untrimmed patches)
+ *  trims - trim loops in parametric space [trimslens[i]*2], as
+ *   delivered by ay_stess_TessTrimCurves()
+ *  trimslens - number of points per trim loop
+ *  cdev - maximum chordal deviation (in object space)
+ *  ndev - maximum normal deviation (in degrees), 0.0 disables the test
+ *  primitives - what primitives to emit:
+ *   0: Triangles
+ *   1: Quads (same as 2)
+ *   2: Quads
+ *  pm - resulting PolyMesh object
+ */
+int
+ay_tess_npatchadaptive(ay_nurbpatch_object *npatch, int ntrims,
+		       double **trims, int *trimslens, double cdev,
+		       double ndev, int primitives, ay_object **pm)
+{
+ int ay_status = AY_OK;
+ ay_tess_adctx ctx = {0};
+ double *uknots = NULL, *vknots = NULL, *fixed = NULL;
+ double *uparams = NULL, *vparams = NULL, *tessv = NULL;
+ int nuknots = 0, nvknots = 0, nfixed = 0, nuparams = 0, nvparams = 0;
+ int i, j, a, fdersize;
+
+  if(!npatch || !pm)
+    return AY_ENULL;
+
+  if(cdev <= 0.0)
+    return AY_ERROR;
+
+  ctx.npatch = npatch;
+  ctx.cdev = cdev;
+  if(ndev > 0.0 && ndev < 180.0)
+    ctx.cosndev = cos(AY_D2R(ndev));
+  else
+    ctx.cosndev = -2.0;
+  ctx.maxdepth = AY_TESSADMAXDEPTH;
+
+  if(npatch->is_rat)
+    fdersize = ay_nb_FirstDerSurf4DMSize(npatch->uorder-1,
+					 npatch->vorder-1);
+  else
+    fdersize = ay_nb_FirstDerSurf3DMSize(npatch->uorder-1,
+					 npatch->vorder-1);
+
+  if(!(ctx.fder = malloc(fdersize*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  /* Bezier decomposition: get the knot spans */
+  ay_status = ay_tess_addistinctknots(npatch->uknotv, npatch->width,
+				      npatch->uorder, &uknots, &nuknots);
+  if(ay_status)
+    goto cleanup;
+
+  ay_status = ay_tess_addistinctknots(npatch->vknotv, npatch->height,
+				      npatch->vorder, &vknots, &nvknots);
+  if(ay_status)
+    goto cleanup;
+
+  /* refine U, testing iso lines at the V knots and at two
+     interior parameters per V knot span */
+  if(!(fixed = malloc((3*nvknots)*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  for(i = 0; i < nvknots-1; i++)
+    {
+      fixed[nfixed]   = vknots[i];
+      fixed[nfixed+1] = vknots[i] + (vknots[i+1] - vknots[i])/3.0;
+      fixed[nfixed+2] = vknots[i] + (vknots[i+1] - vknots[i])*2.0/3.0;
+      nfixed += 3;
+    }
+  fixed[nfixed] = vknots[nvknots-1];
+  nfixed++;
+
+  ay_status = ay_tess_adparams(&ctx, 0, uknots, nuknots, fixed, nfixed,
+			       &uparams, &nuparams);
+  if(ay_status)
+    goto cleanup;
+
+  /* refine V, testing iso lines at the refined U parameters
+     and in the middle of all refined U intervals */
+  free(fixed);
+  nfixed = 0;
+  if(!(fixed = malloc((2*nuparams)*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  for(i = 0; i < nuparams-1; i++)
+    {
+      fixed[nfixed]   = uparams[i];
+      fixed[nfixed+1] = uparams[i] + (uparams[i+1] - uparams[i])*0.5;
+      nfixed += 2;
+    }
+  fixed[nfixed] = uparams[nuparams-1];
+  nfixed++;
+
+  ay_status = ay_tess_adparams(&ctx, 1, vknots, nvknots, fixed, nfixed,
+			       &vparams, &nvparams);
+  if(ay_status)
+    goto cleanup;
+
+  if(ntrims > 0 && trims && trimslens)
+    {
+      ay_status = ay_tess_adtrimmed(&ctx, uparams, nuparams,
+				    vparams, nvparams, ntrims, trims,
+				    trimslens, primitives, pm);
+      goto cleanup;
+    }
+
+  /* evaluate the grid */
+  if(!(tessv = malloc(nuparams*nvparams*6*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  a = 0;
+  for(i = 0; i < nuparams; i++)
+    {
+      for(j = 0; j < nvparams; j++)
+	{
+	  ay_tess_adeval(&ctx, uparams[i], vparams[j], &(tessv[a]));
+	  a += 6;
+	}
+    }
+
+  ay_status = ay_tess_gridtopomesh(tessv, nuparams, nvparams, primitives,
+				   pm);
+  tessv = NULL;
+
+cleanup:
+
+  if(ctx.fder)
+    free(ctx.fder);
+
+  if(uknots)
+    free(uknots);
+
+  if(vknots)
+    free(vknots);
+
+  if(fixed)
+    free(fixed);
+
+  if(uparams)
+    free(uparams);
+
+  if(vparams)
+    free(vparams);
+
+  if(tessv)
+    free(tessv);
+
+ return ay_status;
+} /* ay_tess_npatchadaptive */
+
+
+/* ay_tess_npatchadaptivetcmd:
+ *  Adaptively tesselate selected NURBS patches (convert to PolyMesh)
+ *  without GLU.
+ *  Implements the \a adTessNP scripting interface command.
+ *  \returns TCL_OK in any case.
+ */
+int
+ay_tess_npatchadaptivetcmd(ClientData clientData, Tcl_Interp *interp,
+			   int argc, char *argv[])
+{
+ int ay_status;
+ ay_list_object *sel = ay_selection;
+ ay_object *o = NULL, *new = NULL;
+ double cdev = 0.01, ndev = 15.0, **trims = NULL;
+ int i, primitives = 0, ntrims = 0, *trimslens = NULL;
+
+  if(argc > 1)
+    {
+      if(Tcl_GetDouble(interp, argv[1], &cdev) != TCL_OK)
+	{
+	  ay_error(AY_EARGS, argv[0], "[cdev [ndev [primitives]]]");
+	  return TCL_OK;
+	}
+      if(cdev <= 0.0)
+	{
+	  ay_error(AY_ERROR, argv[0], "cdev must be > 0.0");
+	  return TCL_OK;
+	}
+    }
+
+  if(argc > 2)
+    {
+      Tcl_GetDouble(interp, argv[2], &ndev);
+    }
+
+  if(argc > 3)
+    {
+      Tcl_GetInt(interp, argv[3], &primitives);
+
+      if(primitives < 0)
+	primitives = 0;
+      else
+	if(primitives > 2)
+	  primitives = 2;
+    }
+
+  ay_bin_loadlist(ay_selection);
+
+  while(sel)
+    {
+      o = sel->object;
+
+      if(o->type == AY_IDNPATCH)
+	{
+	  new = NULL;
+	  ay_status = AY_OK;
+	  if(ay_npt_istrimmed(o, 0))
+	    {
+	      /* the trim curves are tesselated here (as this may
+		 need to provide objects) and clipped by the grid */
+	      ay_status = ay_stess_TessTrimCurves(o, ay_prefs.stess_qf,
+						  &ntrims, &trims, &trimslens,
+						  NULL);
+	    }
+	  if(!ay_status)
+	    {
+	      ay_status = ay_tess_npatchadaptive(
+				   (ay_nurbpatch_object *)o->refine,
+				   ntrims, trims, trimslens,
+				   cdev, ndev, primitives, &new);
+	    }
+	  if(trims)
+	    {
+	      for(i = 0; i < ntrims; i++)
+		if(trims[i])
+		  free(trims[i]);
+	      free(trims);
+	      trims = NULL;
+	    }
+	  if(trimslens)
+	    {
+	      free(trimslens);
+	      trimslens = NULL;
+	    }
+	  ntrims = 0;
+	  if(!ay_status && new)
+	    {
+	      ay_trafo_copy(o, new);
+	      ay_object_link(new);
+	    }
+	  else
+	    {
+	      ay_error(AY_ERROR, argv[0], "Could not tesselate object!");
+	      return TCL_OK;
+	    }
+	}
+      else
+	{
+	  ay_error(AY_EWTYPE, argv[0], "NPatch");
+	} /* if is NPatch */
+
+      sel = sel->next;
+    } /* while */
+
+ return TCL_OK;
+} /* ay_tess_npatchadaptivetcmd */
+
+
+/* ay_tess_collectnpatches:
+ *  collect all NURBS patches from the object hierarchy <o> (descending
+ *  into levels) into the growable array <patches> (of <patcheslen>
+ *  entries with room for <patchesalloc> entries);
+ *  the growable array <trafos> receives for every patch the accumulated
+ *  transformation matrix (double[4*4]) of all enclosing levels, starting
+ *  with <m> (which may be NULL for identity);
+ *  objects that can provide NURBS patches (e.g. Revolve, Sweep, Skin)
+ *  are asked to do so and the provided patches are additionally
+ *  linked to the list <provided> (to be freed by the caller later on)
+ */
+int
+ay_tess_collectnpatches(ay_object *o, double *m,
+			ay_object ***patches, double **trafos,
+			int *patcheslen, int *patchesalloc,
+			ay_object ***provided)
+{
+ int ay_status = AY_OK;
+ ay_object *p = NULL, *d, **t;
+ double ml[16], mt[16], *tt;
+
+  if(!o)
+    return AY_OK;
+
+  if(o->type == AY_IDLEVEL)
+    {
+      /* accumulate the transformations of the enclosing levels */
+      if(m)
+	memcpy(ml, m, 16*sizeof(double));
+      else
+	ay_trafo_identitymatrix(ml);
+      ay_trafo_creatematrix(o, mt);
+      ay_trafo_multmatrix(ml, mt);
+
+      d = o->down;
+      while(d && d->next)
+	{
+	  ay_status = ay_tess_collectnpatches(d, ml, patches, trafos,
+					      patcheslen, patchesalloc,
+					      provided);
+	  if(ay_status)
+	    return ay_status;
+	  d = d->next;
+	}
+      return AY_OK;
+    } /* if */
+
+  if(o->type == AY_IDNPATCH)
+    {
+      p = o;
+    }
+  else
+    {
+      if(ay_provide_object(o, AY_IDNPATCH, NULL) == AY_OK)
+	{
+	  (void)ay_provide_object(o, AY_IDNPATCH, &p);
+	  if(p)
+	    {
+	      **provided = p;
+	      d = p;
+	      while(d->next)
+		d = d->next;
+	      *provided = &(d->next);
+	    }
+	}
+    } /* if */
+
+  while(p)
+    {
+      if(p->type == AY_IDNPATCH)
+	{
+	  if(*patcheslen == *patchesalloc)
+	    {
+	      *patchesalloc = (*patchesalloc)?(*patchesalloc)*2:64;
+	      if(!(t = realloc(*patches,
+			       (*patchesalloc)*sizeof(ay_object*))))
+		return AY_EOMEM;
+	      *patches = t;
+	      if(!(tt = realloc(*trafos,
+				(*patchesalloc)*16*sizeof(double))))
+		return AY_EOMEM;
+	      *trafos = tt;
+	    }
+	  (*patches)[*patcheslen] = p;
+	  if(m)
+	    memcpy(&((*trafos)[(*patcheslen)*16]), m, 16*sizeof(double));
+	  else
+	    ay_trafo_identitymatrix(&((*trafos)[(*patcheslen)*16]));
+	  (*patcheslen)++;
+	}
+
+      if(p == o)
+	break;
+
+      p = p->next;
+    } /* while */
+
+ return ay_status;
+} /* ay_tess_collectnpatches */
+
+
+/* ay_tess_npatchbatchcb:
+ *  thread pool work callback of ay_tess_npatches()
+ */
+int
+ay_tess_npatchbatchcb(void *data, int item, int thread)
+{
+ ay_tess_batch *batch = (ay_tess_batch *)data;
+
+  /* trimmed patches have already been processed */
+  if(batch->results[item] || batch->trimmed[item])
+    return AY_OK;
+
+ return ay_tess_npatchgrid(
+		     (ay_nurbpatch_object *)batch->patches[item]->refine,
+			   batch->qf, batch->primitives,
+			   &(batch->results[item]));
+} /* ay_tess_npatchbatchcb */
+
+
+/* ay_tess_npatches:
+ *  tesselate all NURBS patches in the objects of list <l>
+ *  (including patches in levels and patches provided by
+ *  other objects, like Revolve, Sweep, Skin, or Birail) in parallel;
+ *  untrimmed patches are tesselated using ay_tess_npatchgrid() on
+ *  a thread pool, (nontrivially) trimmed patches are tesselated
+ *  serially using ay_tess_npatch() and the GLU sampling preferences
+ *
+ *  qf - tesselation quality factor (see ay_stess_GetQF())
+ *  primitives - what primitives to emit:
+ *   0: Triangles
+ *   1: Triangles&Quads (quads for untrimmed patches)
+ *   2: Quads
+ *  result - resulting PolyMesh objects, one per patch, linked in
+ *   the order of the patches in the hierarchy; the PolyMesh objects
+ *   get the transformation attributes of the respective patches
+ *   combined with the transformations of all enclosing levels
+ */
+int
+ay_tess_npatches(ay_list_object *l, int qf, int primitives,
+		 ay_object **result)
+{
+ int ay_status = AY_OK;
+ ay_object **patches = NULL, *provided = NULL, **nextprovided = &provided;
+ ay_object **next = result;
+ ay_tess_batch batch = {0};
+ int i, patcheslen = 0, patchesalloc = 0;
+ double *trafos = NULL, m[16], mt[16];
+
+  if(!result)
+    return AY_ENULL;
+
+  /* collect the patches (serially, as the provide callbacks
+     may use global state) */
+  while(l)
+    {
+      ay_status = ay_tess_collectnpatches(l->object, NULL, &patches,
+					  &trafos, &patcheslen,
+					  &patchesalloc, &nextprovided);
+      if(ay_status)
+	goto cleanup;
+      l = l->next;
+    }
+
+  if(!patcheslen)
+    goto cleanup;
+
+  batch.patches = patches;
+  batch.qf = qf;
+  batch.primitives = primitives;
+  if(!(batch.results = calloc(patcheslen, sizeof(ay_object*))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  if(!(batch.trimmed = calloc(patcheslen, sizeof(char))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  /* tesselate the trimmed patches with GLU (which is not reentrant) */
+  for(i = 0; i < patcheslen; i++)
+    {
+      if(ay_npt_istrimmed(patches[i], 0))
+	{
+	  batch.trimmed[i] = AY_TRUE;
+	  ay_status = ay_tess_npatch(patches[i], ay_prefs.smethod+1,
+				     ay_prefs.sparamu, ay_prefs.sparamv,
+				     AY_FALSE, NULL, AY_FALSE, NULL,
+				     AY_FALSE, NULL,
+				     0, primitives, DBL_MAX,
+				     &(batch.results[i]));
+	  if(ay_status)
+	    goto cleanup;
+	}
+    } /* for */
+
+  /* tesselate the remaining patches in parallel */
+  ay_status = ay_tp_run(patcheslen, ay_tess_npatchbatchcb, &batch);
+  if(ay_status)
+    goto cleanup;
+
+  /* return result */
+  for(i = 0; i < patcheslen; i++)
+    {
+      if(batch.results[i])
+	{
+	  if(ay_trafo_isidentitymatrix(&(trafos[i*16])))
+	    {
+	      ay_trafo_copy(patches[i], batch.results[i]);
+	    }
+	  else
+	    {
+	      memcpy(m, &(trafos[i*16]), 16*sizeof(double));
+	      ay_trafo_creatematrix(patches[i], mt);
+	      ay_trafo_multmatrix(m, mt);
+	      ay_trafo_decomposematrix(m, batch.results[i]);
+	    }
+	  *next = batch.results[i];
+	  next = &(batch.results[i]->next);
+	  batch.results[i] = NULL;
+	}
+    }
+
+cleanup:
+
+  if(batch.results)
+    {
+      for(i = 0; i < patcheslen; i++)
+	{
+	  if(batch.results[i])
+	    (void)ay_object_delete(batch.results[i]);
+	}
+      free(batch.results);
+    }
+
+  if(batch.trimmed)
+    free(batch.trimmed);
+
+  if(patches)
+    free(patches);
+
+  if(trafos)
+    free(trafos);
+
+  if(provided)
+    (void)ay_object_deletemulti(provided, AY_FALSE);
+
+ return ay_status;
+} /* ay_tess_npatches */
+
+
+/* ay_tess_npatchestcmd:
+ *  Tesselate all NURBS patches in the selected objects (convert to
+ *  PolyMesh) in parallel.
+ *  Implements the \a tessNPs scripting interface command.
+ *  \returns TCL_OK in any case.
+ */
+int
+ay_tess_npatchestcmd(ClientData clientData, Tcl_Interp *interp,
+		     int argc, char *argv[])
+{
+ int ay_status;
+ int qf = ay_prefs.stess_qf, primitives = 0;
+ ay_object *new = NULL, *o;
+
+  if(!ay_selection)
+    {
+      ay_error(AY_ENOSEL, argv[0], NULL);
+      return TCL_OK;
+    }
+
+  if(argc > 1)
+    {
+      if(Tcl_GetInt(interp, argv[1], &qf) != TCL_OK)
+	{
+	  ay_error(AY_EARGS, argv[0], "[qf [primitives]]");
+	  return TCL_OK;
+	}
+      if(qf < 1)
+	qf = 1;
+    }
+
+  if(argc > 2)
+    {
+      Tcl_GetInt(interp, argv[2], &primitives);
+
+      if(primitives < 0)
+	primitives = 0;
+      else
+	if(primitives > 2)
+	  primitives = 2;
+    }
+
+  /* the children of selected levels may not be loaded yet */
+  ay_bin_loadlist(ay_selection);
+
+  ay_status = ay_tess_npatches(ay_selection, qf, primitives, &new);
+
+  if(ay_status)
+    {
+      ay_error(ay_status, argv[0], "Could not tesselate objects!");
+      return TCL_OK;
+    }
+
+  while(new)
+    {
+      o = new->next;
+      new->next = NULL;
+      ay_object_link(new);
+      new = o;
+    }
+
+ return TCL_OK;
+} /* ay_tess_npatchestcmd */
+
+
 /* ay_tess_pomeshf:
  *  tesselate the face <f> of PolyMesh <pomesh> into triangles, removes doubly
  *  used vertices if <optimize> is AY_TRUE,
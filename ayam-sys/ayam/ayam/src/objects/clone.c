@@ -25,6 +25,12 @@ int ay_clone_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe);
 
 int ay_clone_notifycb(ay_object *o);
 
+int ay_clone_getpnts(ay_object *o);
+
+void ay_clone_drawpnts(ay_object *t, ay_pointedit *pe);
+
+ay_object *ay_clone_newinstance(ay_object **old, ay_object *down);
+
 
 /* functions: */
 
@@ -192,13 +198,251 @@ ay_clone_shadecb(struct Togl *togl, ay_object *o)
 } /* ay_clone_shadecb */
 
 
+/* ay_clone_getpnts:
+ *  create the read only points of a clone object, i.e. the points of
+ *  the child(ren) transformed by the trafos of all clones; as the
+ *  points of many clones of a big object require lots of memory, they
+ *  are only created on request (for point selection)
+ */
+int
+ay_clone_getpnts(ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_clone_object *clone = NULL;
+ ay_object *down = NULL, *tr = NULL;
+ double xaxis[3] = {1.0,0.0,0.0}, m[16];
+ double *p1 = NULL, *p2 = NULL;
+ ay_pointedit pe = {0};
+ unsigned int j = 0, a = 0;
+ int i = 0;
+
+  if(!o)
+    return AY_ENULL;
+
+  clone = (ay_clone_object *)(o->refine);
+
+  if(!clone)
+    return AY_ENULL;
+
+  if(clone->pnts)
+    {
+      free(clone->pnts);
+      clone->pnts = NULL;
+    }
+  clone->pntslen = 0;
+
+  if(!o->down || !o->down->next)
+    return AY_OK;
+
+  clone->pntsrat = AY_FALSE;
+  down = o->down;
+  tr = clone->clones;
+
+  if(!clone->mirror)
+    {
+      /* normal or trajectory mode... */
+      if(clone->numclones && clone->clones)
+	{
+	  /* get all points of first child */
+	  ay_status = ay_pact_getpoint(0, down, xaxis, &pe);
+
+	  if(!ay_status && pe.num)
+	    {
+	      /* get memory for all clone points */
+	      if(!(clone->pnts = calloc(clone->numclones * pe.num,
+					4 * sizeof(double))))
+		{
+		  ay_pact_clearpointedit(&pe);
+		  return AY_EOMEM;
+		}
+	      clone->pntslen = clone->numclones * pe.num;
+
+	      /* iterate over all clones and transform/copy
+		 the child points according to clone trafos
+		 into the big clone points vector */
+	      for(i = 0; i < clone->numclones; i++)
+		{
+		  ay_trafo_creatematrix(tr, m);
+		  if(pe.type == AY_PTRAT)
+		    {
+		      clone->pntsrat = AY_TRUE;
+		      for(j = 0; j < pe.num; j++)
+			{
+			  p1 = &(clone->pnts[a]);
+			  p2 = pe.coords[j];
+			  AY_APTRAN3(p1, p2, m);
+			  p1[3] = pe.coords[j][3];
+			  a += 4;
+			} /* for */
+		    }
+		  else
+		    {
+		      for(j = 0; j < pe.num; j++)
+			{
+			  p1 = &(clone->pnts[a]);
+			  p2 = pe.coords[j];
+			  AY_APTRAN3(p1, p2, m);
+			  p1[3] = 1.0;
+			  a += 4;
+			} /* for */
+		    } /* if */
+		  tr = tr->next;
+		} /* for */
+	    } /* if */
+	  ay_pact_clearpointedit(&pe);
+	} /* if have clones*/
+    }
+  else
+    {
+      /* mirror mode... */
+      if(clone->clones)
+	{
+	  clone->pntslen = 0;
+	  /* iterate over all children and transform/copy
+	     the respective child points according to childs
+	     transformation attributes and then also according
+	     to the corresponding mirror clone trafos
+	     into a big clone points vector (built
+	     up dynamically using realloc()) */
+	  while(down && down->next && tr)
+	    {
+	      ay_status = ay_pact_getpoint(0, down, xaxis, &pe);
+
+	      if(!ay_status && pe.num)
+		{
+		  clone->pntslen += (2 * pe.num);
+
+		  p1 = realloc(clone->pnts,
+			       clone->pntslen*4*sizeof(double));
+
+		  if(p1)
+		    {
+		      clone->pnts = p1;
+		      ay_trafo_creatematrix(tr, m);
+		      if(pe.type == AY_PTRAT)
+			{
+			  clone->pntsrat = AY_TRUE;
+			  for(j = 0; j < pe.num; j++)
+			    {
+			      p1 = &(clone->pnts[a]);
+			      p2 = pe.coords[j];
+			      AY_APTRAN3(p1, p2, m);
+			      p1[3] = pe.coords[j][3];
+			      a += 4;
+			    } /* for */
+			}
+		      else
+			{
+			  for(j = 0; j < pe.num; j++)
+			    {
+			      p1 = &(clone->pnts[a]);
+			      p2 = pe.coords[j];
+			      AY_APTRAN3(p1, p2, m);
+			      p1[3] = 1.0;
+			      a += 4;
+			    } /* for */
+			} /* if */
+
+		      ay_trafo_creatematrix(down, m);
+		      if(pe.type == AY_PTRAT)
+			{
+			  for(j = 0; j < pe.num; j++)
+			    {
+			      p1 = &(clone->pnts[a]);
+			      p2 = pe.coords[j];
+			      AY_APTRAN3(p1, p2, m);
+			      p1[3] = pe.coords[j][3];
+			      a += 4;
+			    } /* for */
+			}
+		      else
+			{
+			  for(j = 0; j < pe.num; j++)
+			    {
+			      p1 = &(clone->pnts[a]);
+			      p2 = pe.coords[j];
+			      AY_APTRAN3(p1, p2, m);
+			      p1[3] = 1.0;
+			      a += 4;
+			    } /* for */
+			} /* if */
+		    }
+		  else
+		    {
+		      /* realloc() failed! */
+		      ay_pact_clearpointedit(&pe);
+		      free(clone->pnts);
+		      clone->pnts = NULL;
+		      break;
+		    } /* if */
+		} /* if have points*/
+
+	      ay_pact_clearpointedit(&pe);
+
+	      down = down->next;
+	      tr = tr->next;
+	    } /* while */
+	} /* if have clones */
+    } /* if mirror */
+
+  /* correct any inconsistent values of pnts and pntslen */
+  if(clone->pntslen && !clone->pnts)
+    {
+      clone->pntslen = 0;
+    }
+
+ return ay_status;
+} /* ay_clone_getpnts */
+
+
+/* ay_clone_drawpnts:
+ *  helper for ay_clone_drawhcb(), draw the points <pe> of a child
+ *  transformed by the trafos of <t>
+ */
+void
+ay_clone_drawpnts(ay_object *t, ay_pointedit *pe)
+{
+ double m[16], p[3];
+ unsigned int j;
+
+  ay_trafo_creatematrix(t, m);
+
+  glBegin(GL_POINTS);
+   if((pe->type == AY_PTRAT) && ay_prefs.rationalpoints)
+     {
+       for(j = 0; j < pe->num; j++)
+	 {
+	   AY_APTRAN3(p, pe->coords[j], m);
+	   glVertex3d((GLdouble)p[0]*pe->coords[j][3],
+		      (GLdouble)p[1]*pe->coords[j][3],
+		      (GLdouble)p[2]*pe->coords[j][3]);
+	 }
+     }
+   else
+     {
+       for(j = 0; j < pe->num; j++)
+	 {
+	   AY_APTRAN3(p, pe->coords[j], m);
+	   glVertex3dv((GLdouble *)p);
+	 }
+     }
+  glEnd();
+
+ return;
+} /* ay_clone_drawpnts */
+
+
 /* ay_clone_drawhcb:
  *  draw handles (in an Ayam view window) callback function of clone object
  */
 int
 ay_clone_drawhcb(struct Togl *togl, ay_object *o)
 {
+ int ay_status = AY_OK;
  ay_clone_object *clone = NULL;
+ ay_object *down = NULL, *c = NULL;
+ ay_pointedit pe = {0};
+ double xaxis[3] = {1.0,0.0,0.0};
  unsigned int i;
  double *pnts;
 
@@ -210,11 +454,48 @@ ay_clone_drawhcb(struct Togl *togl, ay_object *o)
   if(!clone)
     return AY_ENULL;
 
-  if(!clone->pnts)
+  down = o->down;
+
+  if(!clone->pnts && clone->clones && down && down->next)
     {
-      clone->pntslen = 1;
-      ay_clone_notifycb(o);
-    }
+      /* draw the points of the child(ren) transformed by the clone
+	 trafos without creating the read only points */
+      glColor3f((GLfloat)ay_prefs.obr, (GLfloat)ay_prefs.obg,
+		(GLfloat)ay_prefs.obb);
+
+      c = clone->clones;
+      if(!clone->mirror)
+	{
+	  ay_status = ay_pact_getpoint(0, down, xaxis, &pe);
+	  if(!ay_status && pe.num)
+	    {
+	      while(c)
+		{
+		  ay_clone_drawpnts(c, &pe);
+		  c = c->next;
+		}
+	    }
+	  ay_pact_clearpointedit(&pe);
+	}
+      else
+	{
+	  while(c && down->next)
+	    {
+	      ay_status = ay_pact_getpoint(0, down, xaxis, &pe);
+	      if(!ay_status && pe.num)
+		{
+		  ay_clone_drawpnts(c, &pe);
+		  ay_clone_drawpnts(down, &pe);
+		}
+	      ay_pact_clearpointedit(&pe);
+	      down = down->next;
+	      c = c->next;
+	    }
+	} /* if */
+
+      glColor3f((GLfloat)ay_prefs.ser, (GLfloat)ay_prefs.seg,
+		(GLfloat)ay_prefs.seb);
+    } /* if */
 
   if(clone->pnts)
     {
@@ -271,8 +552,7 @@ ay_clone_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
     {
       if(mode != 3)
 	{
-	  clone->pntslen = 1;
-	  ay_clone_notifycb(o);
+	  (void)ay_clone_getpnts(o);
 	}
       else
 	{
@@ -695,6 +975,43 @@ ay_clone_bbccb(ay_object *o, double *bbox, int *flags)
 } /* ay_clone_bbccb */
 
 
+/* ay_clone_newinstance:
+ *  helper for ay_clone_notifycb(), create a new instance object of
+ *  <down>, re-using an instance object from the list <old> (the clones
+ *  of the last notification) if possible
+ */
+ay_object *
+ay_clone_newinstance(ay_object **old, ay_object *down)
+{
+ ay_object *newo = NULL;
+
+  if(*old)
+    {
+      newo = *old;
+      *old = newo->next;
+      memset(newo, 0, sizeof(ay_object));
+    }
+  else
+    {
+      if(!(newo = calloc(1, sizeof(ay_object))))
+	return NULL;
+    }
+
+  ay_object_defaults(newo);
+  newo->type = AY_IDINSTANCE;
+  if(down->type != AY_IDINSTANCE)
+    {
+      newo->refine = down;
+    }
+  else
+    {
+      newo->refine = down->refine;
+    }
+
+ return newo;
+} /* ay_clone_newinstance */
+
+
 /* ay_clone_notifycb:
  *  notification callback function of clone object
  */
@@ -705,15 +1022,12 @@ ay_clone_notifycb(ay_object *o)
  char fname[] = "clone_notifycb";
  ay_clone_object *clone = NULL;
  ay_object *down = NULL, *newo = NULL, **next = NULL, trafo = {0};
- ay_object *tr;
+ ay_object *tr, *old = NULL;
  int i = 0, use_trajectory = AY_FALSE, tr_iscopy = AY_FALSE;
  double euler[3], quat[4], m[16];
  double xaxis[3] = {1.0,0.0,0.0};
  double yaxis[3] = {0.0,1.0,0.0};
  double zaxis[3] = {0.0,0.0,1.0};
- double *p1 = NULL, *p2 = NULL;
- ay_pointedit pe = {0};
- unsigned int j = 0, a = 0;
 
   if(!o)
     return AY_ENULL;
@@ -723,21 +1037,20 @@ ay_clone_notifycb(ay_object *o)
   if(!clone)
     return AY_ENULL;
 
-  /* clear the old clones */
-  while(clone->clones)
-    {
-      tr = clone->clones;
-      clone->clones = tr->next;
-      free(tr);
-    }
+  /* the old clones are re-used below, as only their
+     transformation attributes change */
+  old = clone->clones;
+  clone->clones = NULL;
   tr = NULL;
 
-  /* always clear the old read only points */
+  /* always clear the old read only points, they are
+     re-created on request (see ay_clone_getpnts()) */
   if(clone->pnts)
     {
       free(clone->pnts);
       clone->pnts = NULL;
     }
+  clone->pntslen = 0;
 
   /* get (first) child object */
   down = o->down;
@@ -786,8 +1099,7 @@ ay_clone_notifycb(ay_object *o)
 	  for(i = 0; i < clone->numclones; i++)
 	    {
 	      /* create a new instance object */
-	      newo = NULL;
-	      if(!(newo = calloc(1, sizeof(ay_object))))
+	      if(!(newo = ay_clone_newinstance(&old, down)))
 		{
 		  if(tr_iscopy)
 		    {
@@ -796,16 +1108,6 @@ ay_clone_notifycb(ay_object *o)
 		  ay_status = AY_EOMEM;
 		  goto cleanup;
 		}
-	      ay_object_defaults(newo);
-	      newo->type = AY_IDINSTANCE;
-	      if(down->type != AY_IDINSTANCE)
-		{
-		  newo->refine = down;
-		}
-	      else
-		{
-		  newo->refine = down->refine;
-		}
 
 	      /* link new instance object */
 	      *next = newo;
@@ -879,23 +1181,12 @@ ay_clone_notifycb(ay_object *o)
 		  trafo.rotz = AY_R2D(euler[2]);
 
 		  /* create a new instance object */
-		  newo = NULL;
-		  if(!(newo = calloc(1, sizeof(ay_object))))
+		  if(!(newo = ay_clone_newinstance(&old, down)))
 		    {
 		      ay_status = AY_EOMEM;
 		      goto cleanup;
 		    }
 
-		  ay_object_defaults(newo);
-		  newo->type = AY_IDINSTANCE;
-		  if(down->type != AY_IDINSTANCE)
-		    {
-		      newo->refine = down;
-		    }
-		  else
-		    {
-		      newo->refine = down->refine;
-		    }
 		  ay_trafo_copy(down, newo);
 		  ay_trafo_add(&trafo, newo);
 
@@ -912,23 +1203,12 @@ ay_clone_notifycb(ay_object *o)
 		  /* XXXX add instantiability test here! */
 
 		  /* create a new instance object */
-		  newo = NULL;
-		  if(!(newo = calloc(1, sizeof(ay_object))))
+		  if(!(newo = ay_clone_newinstance(&old, down)))
 		    {
 		      ay_status = AY_EOMEM;
 		      goto cleanup;
 		    }
 
-		  ay_object_defaults(newo);
-		  newo->type = AY_IDINSTANCE;
-		  if(down->type != AY_IDINSTANCE)
-		    {
-		      newo->refine = down;
-		    }
-		  else
-		    {
-		      newo->refine = down->refine;
-		    }
 		  ay_trafo_copy(down, newo);
 		  switch(clone->mirror)
 		    {
@@ -1052,161 +1332,6 @@ ay_clone_notifycb(ay_object *o)
 	    } /* if */
 	} /* if */
 
-      /* manage read only points */
-      if(clone->pntslen)
-	{
-	  clone->pntsrat = AY_FALSE;
-	  down = o->down;
-	  tr = clone->clones;
-
-	  if(!clone->mirror)
-	    {
-	      /* normal or trajectory mode... */
-	      if(clone->numclones && clone->clones)
-		{
-		  /* get all points of first child */
-		  ay_status = ay_pact_getpoint(0, down, xaxis, &pe);
-
-		  if(!ay_status && pe.num)
-		    {
-		      /* get memory for all clone points */
-		      if(!(clone->pnts = calloc(clone->numclones * pe.num,
-						4 * sizeof(double))))
-			{
-			  ay_pact_clearpointedit(&pe);
-			  ay_status = AY_EOMEM;
-			  goto cleanup;
-			}
-		      clone->pntslen = clone->numclones * pe.num;
-
-		      /* iterate over all clones and transform/copy
-			 the child points according to clone trafos
-			 into the big clone points vector */
-		      for(i = 0; i < clone->numclones; i++)
-			{
-			  ay_trafo_creatematrix(tr, m);
-			  if(pe.type == AY_PTRAT)
-			    {
-			      clone->pntsrat = AY_TRUE;
-			      for(j = 0; j < pe.num; j++)
-				{
-				  p1 = &(clone->pnts[a]);
-				  p2 = pe.coords[j];
-				  AY_APTRAN3(p1, p2, m);
-				  p1[3] = pe.coords[j][3];
-				  a += 4;
-				} /* for */
-			    }
-			  else
-			    {
-			      for(j = 0; j < pe.num; j++)
-				{
-				  p1 = &(clone->pnts[a]);
-				  p2 = pe.coords[j];
-				  AY_APTRAN3(p1, p2, m);
-				  p1[3] = 1.0;
-				  a += 4;
-				} /* for */
-			    } /* if */
-			  tr = tr->next;
-			} /* for */
-		    } /* if */
-		  ay_pact_clearpointedit(&pe);
-		} /* if have clones*/
-	    }
-	  else
-	    {
-	      /* mirror mode... */
-	      if(clone->clones)
-		{
-		  clone->pntslen = 0;
-		  /* iterate over all children and transform/copy
-		     the respective child points according to childs
-		     transformation attributes and then also according
-		     to the corresponding mirror clone trafos
-		     into a big clone points vector (built
-		     up dynamically using realloc()) */
-		  while(down && down->next && tr)
-		    {
-		      ay_status = ay_pact_getpoint(0, down, xaxis, &pe);
-
-		      if(!ay_status && pe.num)
-			{
-			  clone->pntslen += (2 * pe.num);
-
-			  p1 = realloc(clone->pnts,
-				       clone->pntslen*4*sizeof(double));
-
-			  if(p1)
-			    {
-			      clone->pnts = p1;
-			      ay_trafo_creatematrix(tr, m);
-			      if(pe.type == AY_PTRAT)
-				{
-				  clone->pntsrat = AY_TRUE;
-				  for(j = 0; j < pe.num; j++)
-				    {
-				      p1 = &(clone->pnts[a]);
-				      p2 = pe.coords[j];
-				      AY_APTRAN3(p1, p2, m);
-				      p1[3] = pe.coords[j][3];
-				      a += 4;
-				    } /* for */
-				}
-			      else
-				{
-				  for(j = 0; j < pe.num; j++)
-				    {
-				      p1 = &(clone->pnts[a]);
-				      p2 = pe.coords[j];
-				      AY_APTRAN3(p1, p2, m);
-				      p1[3] = 1.0;
-				      a += 4;
-				    } /* for */
-				} /* if */
-
-			      ay_trafo_creatematrix(down, m);
-			      if(pe.type == AY_PTRAT)
-				{
-				  for(j = 0; j < pe.num; j++)
-				    {
-				      p1 = &(clone->pnts[a]);
-				      p2 = pe.coords[j];
-				      AY_APTRAN3(p1, p2, m);
-				      p1[3] = pe.coords[j][3];
-				      a += 4;
-				    } /* for */
-				}
-			      else
-				{
-				  for(j = 0; j < pe.num; j++)
-				    {
-				      p1 = &(clone->pnts[a]);
-				      p2 = pe.coords[j];
-				      AY_APTRAN3(p1, p2, m);
-				      p1[3] = 1.0;
-				      a += 4;
-				    } /* for */
-				} /* if */
-			    }
-			  else
-			    {
-			      /* realloc() failed! */
-			      ay_pact_clearpointedit(&pe);
-			      free(clone->pnts);
-			      clone->pnts = NULL;
-			      break;
-			    } /* if */
-			} /* if have points*/
-
-		      ay_pact_clearpointedit(&pe);
-
-		      down = down->next;
-		      tr = tr->next;
-		    } /* while */
-		} /* if have clones */
-	    } /* if mirror */
-	} /* if manage points */
     }
   else
     {
@@ -1215,15 +1340,18 @@ ay_clone_notifycb(ay_object *o)
 
 cleanup:
 
-  /* correct any inconsistent values of pnts and pntslen */
-  if(clone->pntslen && !clone->pnts)
+  /* free the old clones that were not re-used */
+  while(old)
     {
-      clone->pntslen = 0;
+      tr = old;
+      old = tr->next;
+      free(tr);
     }
 
   /* recover selected points */
   if(o->selp)
     {
+      (void)ay_clone_getpnts(o);
       ay_clone_getpntcb(3, o, NULL, NULL);
     }
 
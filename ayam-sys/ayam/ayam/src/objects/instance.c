@@ -303,6 +303,9 @@ ay_instance_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
 
   m = (ay_object *)o->refine;
 
+  if(!m->refine)
+    (void)ay_bin_load(m);
+
   arr = ay_getpntcbt.arr;
   cb = (ay_getpntcb *)(arr[m->type]);
 
@@ -441,7 +444,11 @@ ay_instance_wribcb(char *file, ay_object *o)
 		    }
 		  else
 		    {
-		      iafilename = ay_wrib_geniafilename(file, tag->val);
+		      /* the master may have been written to the
+			 RIB archive cache */
+		      iafilename = ay_wrib_cachename(file, orig, AY_TRUE);
+		      if(!iafilename)
+			iafilename = ay_wrib_geniafilename(file, tag->val);
 		      if(iafilename)
 			{
 			  RiReadArchive(iafilename,(RtVoid*)RI_NULL,RI_NULL);
@@ -1903,6 +1903,123 @@ ay_ncurve_writecb(FILE *fileptr, ay_object *o)
 } /* ay_ncurve_writecb */
 
 
+/* ay_ncurve_breadcb:
+ *  read (from binary scene file) callback function of ncurve object
+ */
+int
+ay_ncurve_breadcb(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_nurbcurve_object *ncurve = NULL;
+ int vals[3];
+
+  if(!bf || !o)
+    return AY_ENULL;
+
+  if((ay_status = ay_bin_readuints(bf, 3, (unsigned int*)vals)))
+    return ay_status;
+
+  if(vals[0] <= 0 || vals[1] <= 0)
+    return AY_EFORMAT;
+
+  if(!(ncurve = calloc(1, sizeof(ay_nurbcurve_object))))
+    return AY_EOMEM;
+
+  ncurve->length = vals[0];
+  ncurve->order = vals[1];
+  ncurve->knot_type = vals[2];
+
+  if(ncurve->knot_type == AY_KTCUSTOM)
+    {
+      if(!(ncurve->knotv =
+	   malloc((ncurve->length + ncurve->order)*sizeof(double))))
+	{ ay_status = AY_EOMEM; goto cleanup; }
+
+      ay_status = ay_bin_readdoubles(bf, ncurve->length + ncurve->order,
+				     ncurve->knotv);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  if(!(ncurve->controlv = malloc(ncurve->length*4*sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  ay_status = ay_bin_readdoubles(bf, ncurve->length*4, ncurve->controlv);
+  if(ay_status)
+    goto cleanup;
+
+  ay_status = ay_bin_readint(bf, &(ncurve->type));
+  ay_status += ay_bin_readdoubles(bf, 1, &(ncurve->glu_sampling_tolerance));
+  ay_status += ay_bin_readint(bf, &(ncurve->display_mode));
+  ay_status += ay_bin_readint(bf, &(ncurve->createmp));
+  if(ay_status)
+    { ay_status = AY_EUEOF; goto cleanup; }
+
+  if(ncurve->knot_type != AY_KTCUSTOM)
+    {
+      ay_status = ay_knots_createnc(ncurve);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  ay_nct_recreatemp(ncurve);
+
+  ncurve->is_rat = ay_nct_israt(ncurve);
+
+  o->refine = ncurve;
+  ncurve = NULL;
+
+cleanup:
+
+  if(ncurve)
+    ay_nct_destroy(ncurve);
+
+ return ay_status;
+} /* ay_ncurve_breadcb */
+
+
+/* ay_ncurve_bwritecb:
+ *  write (to binary scene file) callback function of ncurve object
+ */
+int
+ay_ncurve_bwritecb(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_nurbcurve_object *ncurve = NULL;
+ int vals[3];
+
+  if(!bf || !o)
+    return AY_ENULL;
+
+  ncurve = (ay_nurbcurve_object *)(o->refine);
+
+  if(!ncurve)
+    return AY_ENULL;
+
+  vals[0] = ncurve->length;
+  vals[1] = ncurve->order;
+  vals[2] = ncurve->knot_type;
+
+  ay_status = ay_bin_writeuints(bf, 3, (unsigned int*)vals);
+
+  if(ncurve->knot_type == AY_KTCUSTOM)
+    ay_status += ay_bin_writedoubles(bf, ncurve->length + ncurve->order,
+				     ncurve->knotv);
+
+  ay_status += ay_bin_writedoubles(bf, ncurve->length*4, ncurve->controlv);
+
+  ay_status += ay_bin_writeint(bf, ncurve->type);
+  ay_status += ay_bin_writedoubles(bf, 1, &(ncurve->glu_sampling_tolerance));
+  ay_status += ay_bin_writeint(bf, ncurve->display_mode);
+  ay_status += ay_bin_writeint(bf, ncurve->createmp);
+
+  if(ay_status)
+    return AY_ERROR;
+
+ return AY_OK;
+} /* ay_ncurve_bwritecb */
+
+
 /* ay_ncurve_wribcb:
  *  RIB export callback function of ncurve object
  */
@@ -2112,6 +2229,9 @@ ay_ncurve_init(Tcl_Interp *interp)
 
   ay_status += ay_notify_register(ay_ncurve_notifycb, AY_IDNCURVE);
 
+  ay_status += ay_bin_register(ay_ncurve_breadcb, ay_ncurve_bwritecb,
+			       AY_IDNCURVE);
+
   /* ncurve objects may not be associated with materials */
   ay_matt_nomaterial(AY_IDNCURVE);
 
@@ -1885,120 +1885,82 @@ ay_npatch_drawcb(struct Togl *togl, ay_object *o)
 
 /* ay_npatch_shadech:
  *  internal helper function
- *  shade the patch control polygon
+ *  shade the patch control polygon; the vertex arrays are cached
+ *  in the first stess struct (marked by tessw == -1) until the next
+ *  notification or until the rational points preference changes
  */
 int
 ay_npatch_shadech(ay_nurbpatch_object *npatch)
 {
- int a, b, c, d, i, j;
- float *fcv;
+ int a, b, i, j;
+ double p[3], w, *n = NULL, *cv;
  ay_stess_patch *stess;
+ ay_vbuf *vb;
 
   stess = &(npatch->stess[0]);
+  vb = &(stess->vb);
 
-  if(stess->tessw != -1)
-    ay_stess_destroy(stess);
-
-  if(!(stess->tessv = calloc(npatch->width*npatch->height*3,
-				     sizeof(double))))
-    {
-      return AY_EOMEM;
-    }
-
-  ay_npt_getcvnormals(npatch, stess->tessv);
-  stess->tessw = -1;
-
-  if(npatch->is_rat)
+  if(stess->tessw != -1 || !vb->valid ||
+     vb->mode != ay_prefs.rationalpoints)
     {
-      if(!npatch->fltcv)
-	{
-	  ay_npatch_cacheflt(npatch);
-	}
+      ay_stess_destroy(stess);
+      stess->tessw = -1;
 
-      if(!npatch->fltcv)
+      if(!(n = malloc(npatch->width*npatch->height*3*sizeof(double))))
 	{
-	  return AY_ERROR;
+	  return AY_EOMEM;
 	}
 
-      fcv = &(npatch->fltcv[npatch->width+npatch->height+
-			    npatch->uorder+npatch->vorder]);
+      ay_npt_getcvnormals(npatch, n);
 
-      if(!ay_prefs.rationalpoints)
-	{
-	  /* euclidean */
-	  for(i = 0; i < npatch->width-1; i++)
-	    {
-	      a = i*npatch->height*4;
-	      b = a+(npatch->height*4);
-	      c = i*npatch->height*3;
-	      d = c+(npatch->height*3);
-	      glBegin(GL_QUAD_STRIP);
-	       for(j = 0; j < npatch->height; j++)
-		 {
-		   glNormal3dv(&(stess->tessv[c]));
-		   glVertex3f(fcv[a]/fcv[a+3],
-			      fcv[a+1]/fcv[a+3],
-			      fcv[a+2]/fcv[a+3]);
-		   glNormal3dv(&(stess->tessv[d]));
-		   glVertex3f(fcv[b]/fcv[b+3],
-			      fcv[b+1]/fcv[b+3],
-			      fcv[b+2]/fcv[b+3]);
-		   a += 4;
-		   b += 4;
-		   c += 3;
-		   d += 3;
-		 } /* for */
-	      glEnd();
-	    } /* for */
-	}
-      else
+      cv = npatch->controlv;
+      for(i = 0; i < npatch->width*npatch->height; i++)
 	{
-	  /* homogeneous */
-	  for(i = 0; i < npatch->width-1; i++)
+	  memcpy(p, cv, 3*sizeof(double));
+	  if(npatch->is_rat && ay_prefs.rationalpoints)
 	    {
-	      a = i*npatch->height*4;
-	      b = a+(npatch->height*4);
-	      c = i*npatch->height*3;
-	      d = c+(npatch->height*3);
-	      glBegin(GL_QUAD_STRIP);
-	       for(j = 0; j < npatch->height; j++)
-		 {
-		   glNormal3dv(&(stess->tessv[c]));
-		   glVertex3fv(&(fcv[a]));
-		   glNormal3dv(&(stess->tessv[d]));
-		   glVertex3fv(&(fcv[b]));
-		   a += 4;
-		   b += 4;
-		   c += 3;
-		   d += 3;
-		 } /* for */
-	      glEnd();
-	    } /* for */
-	}
-    }
-  else
-    {
+	      /* homogeneous */
+	      w = cv[3];
+	      p[0] *= w;
+	      p[1] *= w;
+	      p[2] *= w;
+	    }
+	  if(ay_shade_vbufaddvert(vb, p, &(n[i*3])))
+	    goto cleanup;
+	  cv += 4;
+	} /* for */
+
       for(i = 0; i < npatch->width-1; i++)
 	{
-	  a = i*npatch->height*4;
-	  b = a+(npatch->height*4);
-	  c = i*npatch->height*3;
-	  d = c+(npatch->height*3);
-	  glBegin(GL_QUAD_STRIP);
-	   for(j = 0; j < npatch->height; j++)
+	  a = i*npatch->height;
+	  b = a+npatch->height;
+	  for(j = 0; j < npatch->height-1; j++)
 	    {
-	      glNormal3dv(&(stess->tessv[c]));
-	      glVertex3dv(&(npatch->controlv[a]));
-	      glNormal3dv(&(stess->tessv[d]));
-	      glVertex3dv(&(npatch->controlv[b]));
-	      a += 4;
-	      b += 4;
-	      c += 3;
-	      d += 3;
+	      if(ay_shade_vbufaddtri(vb, a, b, b+1) ||
+		 ay_shade_vbufaddtri(vb, a, b+1, a+1))
+		goto cleanup;
+	      a++;
+	      b++;
 	    } /* for */
-	  glEnd();
 	} /* for */
-    } /* if is rat */
+
+      vb->mode = ay_prefs.rationalpoints;
+      vb->valid = AY_TRUE;
+
+      free(n);
+      n = NULL;
+    } /* if */
+
+  ay_shade_vbufdraw(vb, NULL);
+
+cleanup:
+
+  if(n)
+    {
+      free(n);
+      ay_shade_vbuffree(vb);
+      return AY_EOMEM;
+    }
 
  return AY_OK;
 } /* ay_npatch_shadech */
@@ -2013,8 +1975,6 @@ ay_npatch_shadestess(ay_view_object *view, ay_object *o)
 {
  int ay_status = AY_OK;
  int qf = ay_prefs.stess_qf;
- int a, b, i, j, tessw, tessh;
- double *tessv = NULL;
  ay_nurbpatch_object *npatch = (ay_nurbpatch_object *)o->refine;
  ay_stess_patch *stess;
 
@@ -2045,36 +2005,7 @@ ay_npatch_shadestess(ay_view_object *view, ay_object *o)
 	return ay_status;
     }
 
-  if(stess->tessv)
-    {
-      tessv = stess->tessv;
-      tessw = stess->tessw;
-      tessh = stess->tessh;
-
-      a = 0;
-      b = tessh*6;
-      for(i = 0; i < tessw-1; i++)
-	{
-	  glBegin(GL_QUAD_STRIP);
-	  for(j = 0; j < tessh; j++)
-	    {
-	      glNormal3dv(&(tessv[a+3]));
-	      glVertex3dv(&(tessv[a]));
-	      glNormal3dv(&(tessv[b+3]));
-	      glVertex3dv(&(tessv[b]));
-	      a += 6;
-	      b += 6;
-	    } /* for */
-	  glEnd();
-	} /* for */
-    }
-  else
-    {
-      if(stess)
-	{
-	  (void)ay_stess_ShadeTrimmedSurface(stess);
-	}
-    }
+  ay_stess_ShadeSurface(stess);
 
  return AY_OK;
 } /* ay_npatch_shadestess */
@@ -2453,9 +2384,9 @@ ay_npatch_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
  ay_mpoint *mp = NULL;
  double min_dist = ay_prefs.pick_epsilon, dist = 0.0;
  double *pecoord = NULL, **ctmp;
- double *control = NULL, *c, h[3];
- int i = 0, j = 0, a = 0, found = AY_FALSE;
- unsigned int *itmp, peindex = 0;
+ double *control = NULL, *c;
+ int i = 0, a = 0, found = AY_FALSE;
+ unsigned int *itmp, peindex = 0, num = 0;
 
   if(!o || ((mode != 3) && (!p || !pe)))
     return AY_ENULL;
@@ -2523,33 +2454,13 @@ ay_npatch_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
 	  /* pick ordinary point */
 	  pe->type = AY_PTRAT;
 	  control = npatch->controlv;
-	  for(i = 0; i < (npatch->width * npatch->height); i++)
-	    {
-	      if(npatch->is_rat && ay_prefs.rationalpoints)
-		{
-		  dist = AY_VLEN((p[0] - (control[j]*control[j+3])),
-				 (p[1] - (control[j+1]*control[j+3])),
-				 (p[2] - (control[j+2]*control[j+3])));
-		}
-	      else
-		{
-		  dist = AY_VLEN((p[0] - control[j]),
-				 (p[1] - control[j+1]),
-				 (p[2] - control[j+2]));
-		}
-	      if(dist < min_dist)
-		{
-		  pecoord = &(control[j]);
-		  peindex = i;
-		  min_dist = dist;
-		}
-
-	      j += 4;
-	    }
-
-	  if(!pecoord)
+	  if(!ay_selp_nearest(o, npatch->width * npatch->height, 4,
+			      (npatch->is_rat && ay_prefs.rationalpoints),
+			      control, p, &min_dist, &peindex))
 	    return AY_OK; /* XXXX should this return a 'AY_EPICK' ? */
 
+	  pecoord = &(control[peindex*4]);
+
 	  if(npatch->mpoints)
 	    {
 	      mp = npatch->mpoints;
@@ -2637,46 +2548,23 @@ ay_npatch_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
 	  /* pick ordinary point(s) */
 	  pe->type = AY_PTRAT;
 	  control = npatch->controlv;
-	  j = 0;
-	  a = 0;
-	  if(npatch->is_rat && ay_prefs.rationalpoints)
-	    {
-	      c = h;
-	    }
-	  for(i = 0; i < npatch->width * npatch->height; i++)
+	  if(ay_selp_inside(o, npatch->width * npatch->height, 4,
+			    (npatch->is_rat && ay_prefs.rationalpoints),
+			    control, p, &num, &itmp))
+	    return AY_EOMEM;
+
+	  if(itmp)
 	    {
-	      if(npatch->is_rat && ay_prefs.rationalpoints)
+	      if(!(pe->coords = malloc(num*sizeof(double *))))
 		{
-		  h[0] = control[j]*control[j+3];
-		  h[1] = control[j+1]*control[j+3];
-		  h[2] = control[j+2]*control[j+3];
+		  free(itmp);
+		  return AY_EOMEM;
 		}
-	      else
-		{
-		  c = &(control[j]);
-		}
-	      /* test point c against the four planes in p */
-	      if(((p[0]*c[0] + p[1]*c[1] + p[2]*c[2] + p[3]) < 0.0) &&
-		 ((p[4]*c[0] + p[5]*c[1] + p[6]*c[2] + p[7]) < 0.0) &&
-		 ((p[8]*c[0] + p[9]*c[1] + p[10]*c[2] + p[11]) < 0.0) &&
-		 ((p[12]*c[0] + p[13]*c[1] + p[14]*c[2] + p[15]) < 0.0))
-		{
-		  if(!(ctmp = realloc(pe->coords, (a+1)*sizeof(double *))))
-		    return AY_EOMEM;
-		  pe->coords = ctmp;
-
-		  if(!(itmp = realloc(pe->indices,
-				      (a+1)*sizeof(unsigned int))))
-		    return AY_EOMEM;
-		  pe->indices = itmp;
-
-		  pe->coords[a] = &(control[j]);
-		  pe->indices[a] = i;
-		  a++;
-		} /* if */
+	      pe->indices = itmp;
 
-	      j += 4;
-	    } /* for */
+	      for(a = 0; a < (int)num; a++)
+		pe->coords[a] = &(control[itmp[a]*4]);
+	    }
 	} /* if */
       pe->num = a;
       break;
@@ -3353,6 +3241,151 @@ ay_npatch_writecb(FILE *fileptr, ay_object *o)
 } /* ay_npatch_writecb */
 
 
+/* ay_npatch_breadcb:
+ *  read (from binary scene file) callback function of npatch object
+ */
+int
+ay_npatch_breadcb(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_nurbpatch_object *npatch = NULL;
+ int vals[6];
+
+  if(!bf || !o)
+    return AY_ENULL;
+
+  if((ay_status = ay_bin_readuints(bf, 6, (unsigned int*)vals)))
+    return ay_status;
+
+  if(vals[0] <= 0 || vals[1] <= 0 || vals[2] <= 0 || vals[3] <= 0)
+    return AY_EFORMAT;
+
+  if(!(npatch = calloc(1, sizeof(ay_nurbpatch_object))))
+    return AY_EOMEM;
+
+  npatch->width = vals[0];
+  npatch->height = vals[1];
+  npatch->uorder = vals[2];
+  npatch->vorder = vals[3];
+  npatch->uknot_type = vals[4];
+  npatch->vknot_type = vals[5];
+
+  if(npatch->uknot_type == AY_KTCUSTOM)
+    {
+      if(!(npatch->uknotv =
+	   malloc((npatch->width + npatch->uorder)*sizeof(double))))
+	{ ay_status = AY_EOMEM; goto cleanup; }
+
+      ay_status = ay_bin_readdoubles(bf, npatch->width + npatch->uorder,
+				     npatch->uknotv);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  if(npatch->vknot_type == AY_KTCUSTOM)
+    {
+      if(!(npatch->vknotv =
+	   malloc((npatch->height + npatch->vorder)*sizeof(double))))
+	{ ay_status = AY_EOMEM; goto cleanup; }
+
+      ay_status = ay_bin_readdoubles(bf, npatch->height + npatch->vorder,
+				     npatch->vknotv);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  if(!(npatch->controlv = malloc(npatch->width*npatch->height*4*
+				 sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+
+  ay_status = ay_bin_readdoubles(bf, npatch->width*npatch->height*4,
+				 npatch->controlv);
+  if(ay_status)
+    goto cleanup;
+
+  ay_status = ay_bin_readdoubles(bf, 1, &(npatch->glu_sampling_tolerance));
+  ay_status += ay_bin_readint(bf, &(npatch->display_mode));
+  ay_status += ay_bin_readint(bf, &(npatch->createmp));
+  if(ay_status)
+    { ay_status = AY_EUEOF; goto cleanup; }
+
+  /* create the knots of the non-custom knot types */
+  if((npatch->uknot_type != AY_KTCUSTOM) ||
+     (npatch->vknot_type != AY_KTCUSTOM))
+    {
+      ay_status = ay_knots_createnp(npatch);
+      if(ay_status)
+	goto cleanup;
+    }
+
+  ay_npt_recreatemp(npatch);
+
+  npatch->is_rat = ay_npt_israt(npatch);
+
+  o->refine = npatch;
+  npatch = NULL;
+
+  /* trigger attribute computation in notify callback */
+  o->modified = AY_TRUE;
+
+cleanup:
+
+  if(npatch)
+    ay_npt_destroy(npatch);
+
+ return ay_status;
+} /* ay_npatch_breadcb */
+
+
+/* ay_npatch_bwritecb:
+ *  write (to binary scene file) callback function of npatch object
+ */
+int
+ay_npatch_bwritecb(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_nurbpatch_object *npatch = NULL;
+ int vals[6];
+
+  if(!bf || !o)
+    return AY_ENULL;
+
+  npatch = (ay_nurbpatch_object *)(o->refine);
+
+  if(!npatch)
+    return AY_ENULL;
+
+  vals[0] = npatch->width;
+  vals[1] = npatch->height;
+  vals[2] = npatch->uorder;
+  vals[3] = npatch->vorder;
+  vals[4] = npatch->uknot_type;
+  vals[5] = npatch->vknot_type;
+
+  ay_status = ay_bin_writeuints(bf, 6, (unsigned int*)vals);
+
+  if(npatch->uknot_type == AY_KTCUSTOM)
+    ay_status += ay_bin_writedoubles(bf, npatch->width + npatch->uorder,
+				     npatch->uknotv);
+
+  if(npatch->vknot_type == AY_KTCUSTOM)
+    ay_status += ay_bin_writedoubles(bf, npatch->height + npatch->vorder,
+				     npatch->vknotv);
+
+  ay_status += ay_bin_writedoubles(bf, npatch->width*npatch->height*4,
+				   npatch->controlv);
+
+  ay_status += ay_bin_writedoubles(bf, 1, &(npatch->glu_sampling_tolerance));
+  ay_status += ay_bin_writeint(bf, npatch->display_mode);
+  ay_status += ay_bin_writeint(bf, npatch->createmp);
+
+  if(ay_status)
+    return AY_ERROR;
+
+ return AY_OK;
+} /* ay_npatch_bwritecb */
+
+
 /* ay_npatch_wribtrimcurves
  *  internal helper function
  *  for ay_npatch_wribtrimcurves() below
@@ -4312,6 +4345,9 @@ ay_npatch_init(Tcl_Interp *interp)
 
   ay_status += ay_notify_register(ay_npatch_notifycb, AY_IDNPATCH);
 
+  ay_status += ay_bin_register(ay_npatch_breadcb, ay_npatch_bwritecb,
+			       AY_IDNPATCH);
+
  return ay_status;
 } /* ay_npatch_init */
 
@@ -469,6 +469,13 @@ ay_pomesh_deletecb(void *c)
   if(pomesh->face_normals)
     free(pomesh->face_normals);
 
+  /* free shading arrays */
+  if(pomesh->vb)
+    {
+      ay_shade_vbuffree(pomesh->vb);
+      free(pomesh->vb);
+    }
+
   free(pomesh);
 
  return AY_OK;
@@ -506,6 +513,7 @@ ay_pomesh_copycb(void *src, void **dst)
   pomesh->verts = NULL;
   pomesh->controlv = NULL;
   pomesh->face_normals = NULL;
+  pomesh->vb = NULL;
 
   /* copy nloops */
   if(pomeshsrc->npolys && pomeshsrc->nloops)
@@ -745,10 +753,10 @@ ay_pomesh_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
 {
  ay_pomesh_object *pomesh = NULL;
  ay_point *pnt = NULL, **lastpnt = NULL;
- double min_dist = ay_prefs.pick_epsilon, dist = 0.0;
- double *pecoord = NULL, **ctmp;
- double *control = NULL, *c = NULL;
- unsigned int i = 0, j = 0, a = 0;
+ double min_dist = ay_prefs.pick_epsilon;
+ double *pecoord = NULL;
+ double *control = NULL;
+ unsigned int i = 0, a = 0;
  unsigned int *itmp, peindex = 0;
  int stride = 0;
 
@@ -791,25 +799,12 @@ ay_pomesh_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
     case 1:
       /* selection based on a single point */
       control = pomesh->controlv;
-      for(i = 0; i < pomesh->ncontrols; i++)
-	{
-	  dist = AY_VLEN((p[0] - control[j]),
-			 (p[1] - control[j+1]),
-			 (p[2] - control[j+2]));
-
-	  if(dist < min_dist)
-	    {
-	      min_dist = dist;
-	      pecoord = &(control[j]);
-	      peindex = i;
-	    }
-
-	  j += stride;
-	} /* for */
-
-      if(!pecoord)
+      if(!ay_selp_nearest(o, pomesh->ncontrols, stride, AY_FALSE, control,
+			  p, &min_dist, &peindex))
 	return AY_OK; /* XXXX should this return a 'AY_EPICK' ? */
 
+      pecoord = &(control[peindex*stride]);
+
       if(!(pe->coords = calloc(1, sizeof(double*))))
 	return AY_EOMEM;
       if(!(pe->indices = calloc(1, sizeof(unsigned int))))
@@ -822,32 +817,22 @@ ay_pomesh_getpntcb(int mode, ay_object *o, double *p, ay_pointedit *pe)
     case 2:
       /* selection based on planes */
       control = pomesh->controlv;
-      j = 0;
-      a = 0;
-      for(i = 0; i < pomesh->ncontrols; i++)
-	{
-	  c = &(control[j]);
+      if(ay_selp_inside(o, pomesh->ncontrols, stride, AY_FALSE, control, p,
+			&a, &itmp))
+	return AY_EOMEM;
 
-	  /* test point c against the four planes in p */
-	  if(((p[0]*c[0] + p[1]*c[1] + p[2]*c[2] + p[3]) < 0.0) &&
-	     ((p[4]*c[0] + p[5]*c[1] + p[6]*c[2] + p[7]) < 0.0) &&
-	     ((p[8]*c[0] + p[9]*c[1] + p[10]*c[2] + p[11]) < 0.0) &&
-	     ((p[12]*c[0] + p[13]*c[1] + p[14]*c[2] + p[15]) < 0.0))
+      if(itmp)
+	{
+	  if(!(pe->coords = malloc(a*sizeof(double *))))
 	    {
-	      if(!(ctmp = realloc(pe->coords, (a+1)*sizeof(double *))))
-		return AY_EOMEM;
-	      pe->coords = ctmp;
-	      if(!(itmp = realloc(pe->indices, (a+1)*sizeof(unsigned int))))
-		return AY_EOMEM;
-	      pe->indices = itmp;
-
-	      pe->coords[a] = &(control[j]);
-	      pe->indices[a] = i;
-
-	      a++;
-	    } /* if */
-	  j += stride;
-	} /* for */
+	      free(itmp);
+	      return AY_EOMEM;
+	    }
+	  pe->indices = itmp;
+
+	  for(i = 0; i < a; i++)
+	    pe->coords[i] = &(control[itmp[i]*stride]);
+	}
 
       pe->num = a;
       break;
@@ -1132,6 +1117,144 @@ ay_pomesh_writecb(FILE *fileptr, ay_object *o)
 } /* ay_pomesh_writecb */
 
 
+/* ay_pomesh_breadcb:
+ *  read (from binary scene file) callback function of pomesh object
+ */
+int
+ay_pomesh_breadcb(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_pomesh_object *pomesh = NULL;
+ unsigned int total_loops = 0, total_verts = 0, sum, i;
+ size_t stride;
+
+  if(!bf || !o)
+   return AY_ENULL;
+
+  if(!(pomesh = calloc(1, sizeof(ay_pomesh_object))))
+    return AY_EOMEM;
+
+  ay_status = ay_bin_readint(bf, &pomesh->type);
+  ay_status += ay_bin_readuints(bf, 1, &pomesh->npolys);
+  if(ay_status)
+    { ay_status = AY_EUEOF; goto cleanup; }
+
+  if(!(pomesh->nloops = malloc((pomesh->npolys+1)*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  if((ay_status = ay_bin_readuints(bf, pomesh->npolys, pomesh->nloops)))
+    goto cleanup;
+
+  /* the totals are redundant, but checking them guards the
+     index arrays against corrupt files */
+  if((ay_status = ay_bin_readuints(bf, 1, &total_loops)))
+    goto cleanup;
+  sum = 0;
+  for(i = 0; i < pomesh->npolys; i++)
+    sum += pomesh->nloops[i];
+  if(sum != total_loops)
+    { ay_status = AY_EFORMAT; goto cleanup; }
+
+  if(!(pomesh->nverts = malloc((total_loops+1)*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  if((ay_status = ay_bin_readuints(bf, total_loops, pomesh->nverts)))
+    goto cleanup;
+
+  if((ay_status = ay_bin_readuints(bf, 1, &total_verts)))
+    goto cleanup;
+  sum = 0;
+  for(i = 0; i < total_loops; i++)
+    sum += pomesh->nverts[i];
+  if(sum != total_verts)
+    { ay_status = AY_EFORMAT; goto cleanup; }
+
+  if(!(pomesh->verts = malloc((total_verts+1)*sizeof(unsigned int))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  if((ay_status = ay_bin_readuints(bf, total_verts, pomesh->verts)))
+    goto cleanup;
+
+  /* read controlv */
+  ay_status = ay_bin_readuints(bf, 1, &pomesh->ncontrols);
+  ay_status += ay_bin_readint(bf, &pomesh->has_normals);
+  if(ay_status)
+    { ay_status = AY_EUEOF; goto cleanup; }
+
+  for(i = 0; i < total_verts; i++)
+    {
+      if(pomesh->verts[i] >= pomesh->ncontrols)
+	{ ay_status = AY_EFORMAT; goto cleanup; }
+    }
+
+  stride = pomesh->has_normals?6:3;
+  if(!(pomesh->controlv = malloc((pomesh->ncontrols*stride+1)*
+				 sizeof(double))))
+    { ay_status = AY_EOMEM; goto cleanup; }
+  ay_status = ay_bin_readdoubles(bf, pomesh->ncontrols*stride,
+				 pomesh->controlv);
+  if(ay_status)
+    goto cleanup;
+
+  /* return result */
+  o->refine = pomesh;
+
+  /* prevent cleanup code from doing something harmful */
+  pomesh = NULL;
+
+cleanup:
+
+  if(pomesh)
+    (void)ay_pomesht_destroy(pomesh);
+
+ return ay_status;
+} /* ay_pomesh_breadcb */
+
+
+/* ay_pomesh_bwritecb:
+ *  write (to binary scene file) callback function of pomesh object
+ */
+int
+ay_pomesh_bwritecb(ay_binfile *bf, ay_object *o)
+{
+ int ay_status = AY_OK;
+ ay_pomesh_object *pomesh = NULL;
+ unsigned int total_loops = 0, total_verts = 0;
+ unsigned int i = 0;
+
+  if(!bf || !o)
+    return AY_ENULL;
+
+  pomesh = (ay_pomesh_object *)(o->refine);
+
+  if(!pomesh)
+    return AY_ENULL;
+
+  for(i = 0; i < pomesh->npolys; i++)
+    total_loops += pomesh->nloops[i];
+
+  for(i = 0; i < total_loops; i++)
+    total_verts += pomesh->nverts[i];
+
+  ay_status = ay_bin_writeint(bf, pomesh->type);
+  ay_status += ay_bin_writeuints(bf, 1, &pomesh->npolys);
+  ay_status += ay_bin_writeuints(bf, pomesh->npolys, pomesh->nloops);
+  ay_status += ay_bin_writeuints(bf, 1, &total_loops);
+  ay_status += ay_bin_writeuints(bf, total_loops, pomesh->nverts);
+  ay_status += ay_bin_writeuints(bf, 1, &total_verts);
+  ay_status += ay_bin_writeuints(bf, total_verts, pomesh->verts);
+
+  /* write controlv */
+  ay_status += ay_bin_writeuints(bf, 1, &pomesh->ncontrols);
+  ay_status += ay_bin_writeint(bf, pomesh->has_normals);
+  ay_status += ay_bin_writedoubles(bf, pomesh->ncontrols *
+				   (pomesh->has_normals?6:3),
+				   pomesh->controlv);
+
+  if(ay_status)
+    return AY_ERROR;
+
+ return AY_OK;
+} /* ay_pomesh_bwritecb */
+
+
 /* ay_pomesh_wribcb:
  *  RIB export callback function of pomesh object
  */
@@ -1343,6 +1466,9 @@ ay_pomesh_notifycb(ay_object *o)
     free(pomesh->face_normals);
   pomesh->face_normals = NULL;
 
+  if(pomesh->vb)
+    ay_shade_vbuffree(pomesh->vb);
+
  return AY_OK;
 } /* ay_pomesh_notifycb */
 
@@ -1425,6 +1551,9 @@ ay_pomesh_init(Tcl_Interp *interp)
 
   ay_status += ay_convert_register(ay_pomesh_convertcb, AY_IDPOMESH);
 
+  ay_status += ay_bin_register(ay_pomesh_breadcb, ay_pomesh_bwritecb,
+			       AY_IDPOMESH);
+
  return ay_status;
 } /* ay_pomesh_init */
 
@@ -1522,6 +1522,7 @@ ay_script_notifycb(ay_object *o)
 	    }
 	  o->down = down;
 	  last->next = ay_endlevel;
+	  ay_notify_graphinvalidate();
 	}
 
       /* restore old selection */
@@ -1657,6 +1658,7 @@ ay_script_notifycb(ay_object *o)
 	  ccm_objects = sc->cm_objects;
 	  sc->cm_objects = o->down;
 	  o->down = ccm_objects;
+	  ay_notify_graphinvalidate();
 	} /* if */
     } /* if type is modify */
 
@@ -1972,6 +1974,7 @@ ay_script_convertcb(ay_object *o, int in_place)
 		     children to the new level object */
 		  o->down = sc->cm_objects;
 		  sc->cm_objects = NULL;
+		  ay_notify_graphinvalidate();
 
 		  /* now free the script object */
 		  ay_script_deletecb(sc);
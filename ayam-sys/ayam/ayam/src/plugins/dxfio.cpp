@@ -2539,6 +2539,10 @@ dxfio_writetcmd(ClientData clientData, Tcl_Interp *interp,
       i += 2;
     } // while
 
+  // load all lazily read data first, exported objects may provide
+  // or reference other objects
+  ay_bin_loadall(ay_root);
+
   // initialize and open output file
   dimeOutput out;
   if(!out.setFilename(argv[1]))
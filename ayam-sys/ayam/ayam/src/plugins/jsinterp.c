@@ -226,12 +226,15 @@ static JSFunctionSpec jsinterp_global_functions[] = {
   {"fairNC", jsinterp_wraptcmdargs, 0, 0, 0},
   {"curvatNC", jsinterp_wraptcmdargs, 0, 0, 0},
   {"torsionNC", jsinterp_wraptcmdargs, 0, 0, 0},
+  {"intersectNC", jsinterp_wraptcmdargs, 0, 0, 0},
 
   {"crtNSphere", jsinterp_wraptcmd, 0, 0, 0},
   {"crtNSphere2", jsinterp_wraptcmd, 0, 0, 0},
   {"breakNP", jsinterp_wraptcmd, 0, 0, 0},
   {"buildNP", jsinterp_wraptcmd, 0, 0, 0},
   /* topoly? */
+  {"tessNPs", jsinterp_wraptcmdargs, 0, 0, 0},
+  {"adTessNP", jsinterp_wraptcmdargs, 0, 0, 0},
   {"elevateuNP", jsinterp_wraptcmdargs, 0, 0, 0},
   {"elevatevNP", jsinterp_wraptcmdargs, 0, 0, 0},
   {"reduceuNP", jsinterp_wraptcmdargs, 0, 0, 0},
@@ -260,6 +263,7 @@ static JSFunctionSpec jsinterp_global_functions[] = {
   {"interpuNP", jsinterp_wraptcmdargs, 0, 0, 0},
   {"interpvNP", jsinterp_wraptcmdargs, 0, 0, 0},
   {"curvatNP", jsinterp_wraptcmdargs, 0, 0, 0},
+  {"findUVNP", jsinterp_wraptcmdargs, 0, 0, 0},
   {"fairNP", jsinterp_wraptcmdargs, 0, 0, 0},
 
   {"concatS", jsinterp_wraptcmdargs, 0, 0, 0},
@@ -206,12 +206,15 @@ static const struct luaL_Reg luainterplib [] = {
       {"fairNC", luainterp_wraptclcmd},
       {"curvatNC", luainterp_wraptclcmd},
       {"torsionNC", luainterp_wraptclcmd},
+      {"intersectNC", luainterp_wraptclcmd},
 
       {"crtNSphere", luainterp_wraptclcmd},
       {"crtNSphere2", luainterp_wraptclcmd},
       {"breakNP", luainterp_wraptclcmd},
       {"buildNP", luainterp_wraptclcmd},
       /* topoly? */
+      {"tessNPs", luainterp_wraptclcmd},
+      {"adTessNP", luainterp_wraptclcmd},
       {"elevateuNP", luainterp_wraptclcmd},
       {"elevatevNP", luainterp_wraptclcmd},
       {"reduceuNP", luainterp_wraptclcmd},
@@ -240,6 +243,7 @@ static const struct luaL_Reg luainterplib [] = {
       {"interpuNP", luainterp_wraptclcmd},
       {"interpvNP", luainterp_wraptclcmd},
       {"curvatNP", luainterp_wraptclcmd},
+      {"findUVNP", luainterp_wraptclcmd},
       {"fairNP", luainterp_wraptclcmd},
 
       {"concatS", luainterp_wraptclcmd},
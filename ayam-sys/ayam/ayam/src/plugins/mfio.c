@@ -3022,6 +3022,10 @@ ay_mfio_writescene(Tcl_Interp *interp, char *filename, int selected)
       return AY_OK;
     }
 
+  /* load all lazily read data first, exported objects may provide
+     or reference other objects */
+  ay_bin_loadall(ay_root);
+
   mfo.objectType = kMF3DObjMetafile;
   if(mfio_dataformat)
     {
@@ -1463,6 +1463,10 @@ objio_writescene(char *filename, int selected)
       return;
     }
 
+  /* load all lazily read data first, exported objects may provide
+     or reference other objects */
+  ay_bin_loadall(ay_root);
+
   if(!(fileptr = fopen(filename, "wb")))
     {
       ay_error(AY_EOPENFILE, fname, filename);
@@ -1613,27 +1617,21 @@ static double objio_rescaleknots;
 
 static int objio_checkdegen;
 
-typedef struct objio_vertex_s {
-  struct objio_vertex_s *next;
-  struct objio_vertex_s *prev;
-
-  unsigned int index;
-
-  double v[4];
+/* vertex buffers; a contiguous, growable array of 4D vertices
+   per vertex type (1 - geometric, 2 - normal, 3 - parametric,
+   4 - texture), indexed directly by (OBJ vertex index - 1) */
+typedef struct objio_vbuf_s {
+  double *v;
 
-} objio_vertex;
+  unsigned int length;
 
-static objio_vertex *objio_gverts_head = NULL;
-static objio_vertex *objio_gverts_tail = NULL;
+  unsigned int allocated;
 
-static objio_vertex *objio_nverts_head = NULL;
-static objio_vertex *objio_nverts_tail = NULL;
+} objio_vbuf;
 
-static objio_vertex *objio_pverts_head = NULL;
-static objio_vertex *objio_pverts_tail = NULL;
+#define OBJIO_VBUFINITSIZE 1024
 
-static objio_vertex *objio_tverts_head = NULL;
-static objio_vertex *objio_tverts_tail = NULL;
+static objio_vbuf objio_vbufs[4] = {{NULL, 0, 0}};
 
 static int objio_cstype; /* -1 - unset, 0 - bmatrix, 1 - bezier, 2 - bspline,
 			    3 - cardinal, 4 - taylor */
@@ -1677,13 +1675,37 @@ static ay_object **objio_nexttrim;
 
 static ay_object *objio_lastface;
 
+/* the input buffer; the file is read in large blocks and lines are
+   assembled from there into a single line buffer that is reused for
+   the whole import */
+#define OBJIO_READBUFSIZE 1048576
+
+typedef struct objio_readbuf_s {
+  FILE *fileptr;
+
+  char *buf;
+  size_t buflen;
+  size_t bufpos;
+  int eof;
+
+  char *line;
+  size_t linealloc;
+
+} objio_readbuf;
+
+static objio_readbuf objio_rb = {0};
+
 
 int objio_addvertex(int type, double *v);
 
-int objio_getvertex(int type, unsigned int index, double **v);
+int objio_getvertex(int type, int index, double **v);
 
 int objio_freevertices(void);
 
+int objio_readdouble(char **c, double *d);
+
+int objio_readint(char **c, int *i);
+
 int objio_readvertex(char *str);
 
 int objio_readvindex(char *c, int *gvindex, int *tvindex, int *nvindex);
@@ -1718,6 +1740,10 @@ int objio_fixncurve(ay_nurbcurve_object *nc);
 
 int objio_readend(void);
 
+int objio_fillbuffer(void);
+
+int objio_getline(char **line);
+
 int objio_readline(FILE *fileptr);
 
 void objio_readscene(char *filenam);
@@ -1732,282 +1758,293 @@ int objio_readscenetcmd(ClientData clientData, Tcl_Interp *interp,
 int
 objio_addvertex(int type, double *v)
 {
- objio_vertex *nv = NULL;
+ objio_vbuf *vb;
+ double *t = NULL;
+ unsigned int newalloc;
 
   if(!v)
     return AY_ENULL;
 
-  if(!(nv = calloc(1, sizeof(objio_vertex))))
-    return AY_EOMEM;
-  nv->index = 1;
+  if(type < 1 || type > 4)
+    return AY_OK;
+
+  vb = &(objio_vbufs[type-1]);
+
+  /* grow the buffer (by doubling, to keep adding amortized O(1)) */
+  if(vb->length == vb->allocated)
+    {
+      if(vb->allocated)
+	newalloc = vb->allocated * 2;
+      else
+	newalloc = OBJIO_VBUFINITSIZE;
+
+      if(newalloc < vb->allocated)
+	return AY_EOMEM;
 
+      if(!(t = realloc(vb->v, newalloc * 4 * sizeof(double))))
+	return AY_EOMEM;
+
+      vb->v = t;
+      vb->allocated = newalloc;
+    } /* if */
+
+  t = &(vb->v[vb->length * 4]);
   switch(type)
     {
-    case 1:
-      /* geometric vertex */
-      memcpy(nv->v, v, 4*sizeof(double));
-      if(objio_gverts_tail)
-	{
-	  nv->index = objio_gverts_tail->index + 1;
-	  nv->prev = objio_gverts_tail;
-	  objio_gverts_tail->next = nv;
-	}
-      objio_gverts_tail = nv;
-      if(!objio_gverts_head)
-	{
-	  objio_gverts_head = nv;
-	}
-      break;
     case 2:
       /* normal vertex */
-      memcpy(nv->v, v, 3*sizeof(double));
-      if(objio_nverts_tail)
-	{
-	  nv->index = objio_nverts_tail->index + 1;
-	  nv->prev = objio_nverts_tail;
-	  objio_nverts_tail->next = nv;
-	}
-      objio_nverts_tail = nv;
-      if(!objio_nverts_head)
-	{
-	  objio_nverts_head = nv;
-	}
-      break;
-    case 3:
-      /* parametric vertex */
-      memcpy(nv->v, v, 4*sizeof(double));
-      if(objio_pverts_tail)
-	{
-	  nv->index = objio_pverts_tail->index + 1;
-	  nv->prev = objio_pverts_tail;
-	  objio_pverts_tail->next = nv;
-	}
-      objio_pverts_tail = nv;
-      if(!objio_pverts_head)
-	{
-	  objio_pverts_head = nv;
-	}
-      break;
     case 4:
       /* texture vertex */
-      memcpy(nv->v, v, 3*sizeof(double));
-      if(objio_tverts_tail)
-	{
-	  nv->index = objio_tverts_tail->index + 1;
-	  nv->prev = objio_tverts_tail;
-	  objio_tverts_tail->next = nv;
-	}
-      objio_tverts_tail = nv;
-      if(!objio_tverts_head)
-	{
-	  objio_tverts_head = nv;
-	}
+      memcpy(t, v, 3*sizeof(double));
+      t[3] = 0.0;
       break;
     default:
-      free(nv);
+      /* geometric or parametric vertex */
+      memcpy(t, v, 4*sizeof(double));
       break;
     } /* switch */
 
+  vb->length++;
+
  return AY_OK;
 } /* objio_addvertex */
 
 
 /* objio_getvertex:
- *  get a vertex from a vertex buffer
+ *  get a vertex from a vertex buffer;
+ *  positive indices are absolute (starting at 1), negative indices
+ *  are relative to the last vertex added to the buffer (-1 being the
+ *  last vertex)
  */
 int
-objio_getvertex(int type, unsigned int index, double **v)
+objio_getvertex(int type, int index, double **v)
 {
- static objio_vertex *objio_gverts_cur = NULL;
- static objio_vertex *objio_nverts_cur = NULL;
- static objio_vertex *objio_pverts_cur = NULL;
- static objio_vertex *objio_tverts_cur = NULL;
- objio_vertex *l = NULL, **pl;
+ objio_vbuf *vb;
  unsigned int i;
 
   if(!v)
-    {
-      objio_gverts_cur = NULL;
-      objio_nverts_cur = NULL;
-      objio_pverts_cur = NULL;
-      objio_tverts_cur = NULL;
-      return AY_ENULL;
-    } /* if */
+    return AY_ENULL;
 
   if(index == 0)
     return AY_ERROR;
 
-  switch(type)
-    {
-    case 1:
-      /* vertex buffer empty? */
-      if(!objio_gverts_tail)
-	return AY_ERROR;
+  if(type < 1 || type > 4)
+    return AY_ERROR;
 
-      /* index out of range? */
-      if(index > objio_gverts_tail->index)
-	return AY_ERROR;
+  vb = &(objio_vbufs[type-1]);
 
-      if(objio_gverts_cur)
-	l = objio_gverts_cur;
-      else
-	l = objio_gverts_tail;
+  /* vertex buffer empty? */
+  if(!vb->length)
+    return AY_ENULL;
 
-      pl = &objio_gverts_cur;
-      break;
-    case 2:
-      /* vertex buffer empty? */
-      if(!objio_nverts_tail)
+  if(index < 0)
+    {
+      /* relative index */
+      if((unsigned int)(-index) > vb->length)
 	return AY_ERROR;
-
-      /* index out of range? */
-      if(index > objio_nverts_tail->index)
+      i = vb->length - (unsigned int)(-index);
+    }
+  else
+    {
+      /* absolute index */
+      if((unsigned int)index > vb->length)
 	return AY_ERROR;
+      i = (unsigned int)index - 1;
+    } /* if */
 
-      if(objio_nverts_cur)
-	l = objio_nverts_cur;
-      else
-	l = objio_nverts_tail;
+  /* return result */
+  *v = &(vb->v[i * 4]);
 
-      pl = &objio_nverts_cur;
-      break;
-    case 3:
-      /* vertex buffer empty? */
-      if(!objio_pverts_tail)
-	return AY_ERROR;
+ return AY_OK;
+} /* objio_getvertex */
 
-      /* index out of range? */
-      if(index > objio_pverts_tail->index)
-	return AY_ERROR;
 
-      if(objio_pverts_cur)
-	l = objio_pverts_cur;
-      else
-	l = objio_pverts_tail;
+/* objio_freevertices:
+ *  free all vertex buffers
+ */
+int
+objio_freevertices(void)
+{
+ int i;
 
-      pl = &objio_pverts_cur;
-      break;
-    case 4:
-      /* vertex buffer empty? */
-      if(!objio_tverts_tail)
-	return AY_ERROR;
+  for(i = 0; i < 4; i++)
+    {
+      if(objio_vbufs[i].v)
+	free(objio_vbufs[i].v);
+      objio_vbufs[i].v = NULL;
+      objio_vbufs[i].length = 0;
+      objio_vbufs[i].allocated = 0;
+    } /* for */
 
-      /* index out of range? */
-      if(index > objio_tverts_tail->index)
-	return AY_ERROR;
+ return AY_OK;
+} /* objio_freevertices */
 
-      if(objio_tverts_cur)
-	l = objio_tverts_cur;
-      else
-	l = objio_tverts_tail;
 
-      pl = &objio_tverts_cur;
-      break;
-    default:
-      return AY_ERROR;
-      break;
+/* objio_readdouble:
+ *  parse a floating point number (skipping leading white space);
+ *  plain decimal numbers with up to 15 significant digits and small
+ *  exponents are converted directly (which is exact, as both, the
+ *  mantissa and the power of ten, are representable as double),
+ *  everything else is handed over to strtod()
+ *  !Modifies argument <c>!
+ *
+ *  \param[in,out] c string to parse, will be advanced past the number
+ *  \param[in,out] d where to store the number
+ *
+ *  \returns AY_TRUE if a number was read, AY_FALSE otherwise
+ */
+int
+objio_readdouble(char **c, double *d)
+{
+ static const double p10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+			      1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16,
+			      1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+ char *s = *c, *e = NULL;
+ int neg = AY_FALSE, eneg = AY_FALSE, digits = 0, sdigits = 0, ex = 0;
+ int fdigits = 0, edigits = 0;
+ double m = 0.0;
+
+  while(isspace((unsigned char)*s))
+    s++;
+
+  if(*s == '-')
+    {
+      neg = AY_TRUE;
+      s++;
+    }
+  else
+    {
+      if(*s == '+')
+	s++;
     }
 
-  /* check, whether the same vertex was requested last time */
-  if(index == l->index)
+  while(*s >= '0' && *s <= '9')
     {
-      /* Yes, we may immediately return the result. */
-      *v = &(l->v[0]);
-      return AY_OK;
+      m = m*10.0 + (*s - '0');
+      if(m != 0.0)
+	sdigits++;
+      digits++;
+      s++;
     }
 
-  if(index < l->index)
+  if(*s == '.')
     {
-      /* rewind... */
-      for(i = l->index; i > index; i--)
+      s++;
+      while(*s >= '0' && *s <= '9')
 	{
-	  l = l->prev;
+	  m = m*10.0 + (*s - '0');
+	  if(m != 0.0)
+	    sdigits++;
+	  digits++;
+	  fdigits++;
+	  s++;
 	}
     }
-  else
+
+  if(digits && (*s == 'e' || *s == 'E'))
     {
-      /* forward... */
-      for(i = l->index; i < index; i++)
+      s++;
+      if(*s == '-')
 	{
-	  l = l->next;
+	  eneg = AY_TRUE;
+	  s++;
+	}
+      else
+	{
+	  if(*s == '+')
+	    s++;
 	}
+      while(*s >= '0' && *s <= '9' && ex < 10000)
+	{
+	  ex = ex*10 + (*s - '0');
+	  edigits++;
+	  s++;
+	}
+      if(!edigits)
+	digits = 0;
     } /* if */
 
-  /* remember pointer to vertex in static variable */
-  *pl = l;
+  if(eneg)
+    ex = -ex;
+  ex -= fdigits;
 
-  /* return result */
-  *v = &(l->v[0]);
+  /* take the fast path? */
+  if(digits && sdigits <= 15 && ex >= -22 && ex <= 22 &&
+     !isalnum((unsigned char)*s) && *s != '.')
+    {
+      if(ex < 0)
+	m /= p10[-ex];
+      else
+	m *= p10[ex];
 
- return AY_OK;
-} /* objio_getvertex */
+      *d = neg?-m:m;
+      *c = s;
+      return AY_TRUE;
+    } /* if */
 
+  /* no, fall back to strtod() */
+  m = strtod(*c, &e);
+  if(e == *c)
+    return AY_FALSE;
 
-/* objio_freevertices:
- *  free all vertex buffers
+  *d = m;
+  *c = e;
+
+ return AY_TRUE;
+} /* objio_readdouble */
+
+
+/* objio_readint:
+ *  parse an integer number (skipping leading white space)
+ *  !Modifies argument <c>!
+ *
+ *  \param[in,out] c string to parse, will be advanced past the number
+ *  \param[in,out] i where to store the number
+ *
+ *  \returns AY_TRUE if a number was read, AY_FALSE otherwise
  */
 int
-objio_freevertices(void)
+objio_readint(char **c, int *i)
 {
- objio_vertex *v = NULL, *vt = NULL;
+ char *s = *c;
+ int neg = AY_FALSE, digits = 0;
+ long l = 0;
 
-  if(objio_gverts_tail)
-    {
-      objio_gverts_head = NULL;
-      vt = objio_gverts_tail;
-      while(vt)
-	{
-	  v = vt->prev;
-	  free(vt);
-	  vt = v;
-	} /* while */
-      objio_gverts_tail = NULL;
-    } /* if */
+  while(isspace((unsigned char)*s))
+    s++;
 
-  if(objio_nverts_tail)
+  if(*s == '-')
     {
-      objio_nverts_head = NULL;
-      vt = objio_nverts_tail;
-      while(vt)
-	{
-	  v = vt->prev;
-	  free(vt);
-	  vt = v;
-	} /* while */
-      objio_nverts_tail = NULL;
-    } /* if */
-
-  if(objio_pverts_tail)
+      neg = AY_TRUE;
+      s++;
+    }
+  else
     {
-      objio_pverts_head = NULL;
-      vt = objio_pverts_tail;
-      while(vt)
-	{
-	  v = vt->prev;
-	  free(vt);
-	  vt = v;
-	} /* while */
-      objio_pverts_tail = NULL;
-    } /* if */
+      if(*s == '+')
+	s++;
+    }
 
-  if(objio_tverts_tail)
+  while(*s >= '0' && *s <= '9')
     {
-      objio_tverts_head = NULL;
-      vt = objio_tverts_tail;
-      while(vt)
-	{
-	  v = vt->prev;
-	  free(vt);
-	  vt = v;
-	} /* while */
-      objio_tverts_tail = NULL;
-    } /* if */
+      if(l <= (INT_MAX - 9)/10)
+	l = l*10 + (*s - '0');
+      else
+	l = INT_MAX;
+      digits++;
+      s++;
+    }
 
-  /* clear cached "current" pointers in objio_getvertex() */
-  (void)objio_getvertex(0, 0, NULL);
+  if(!digits)
+    return AY_FALSE;
 
- return AY_OK;
-} /* objio_freevertices */
+  if(l > INT_MAX)
+    l = INT_MAX;
+
+  *i = (int)(neg?-l:l);
+  *c = s;
+
+ return AY_TRUE;
+} /* objio_readint */
 
 
 /* objio_readvertex:
@@ -2018,19 +2055,29 @@ objio_readvertex(char *str)
 {
  int ay_status = AY_OK;
  double v[4] = {0};
+ char *c;
+ int n = 0;
 
-  if(strlen(str) < 2)
+  if((str[0] == '\0') || (str[1] == '\0'))
     return AY_ERROR;
 
   if(str[1] == 'n')
     {
-      sscanf(&(str[2])," %lg %lg %lg", &(v[0]), &(v[1]), &(v[2]));
+      c = &(str[2]);
+      while(n < 3 && objio_readdouble(&c, &(v[n])))
+	n++;
       ay_status = objio_addvertex(2, v);
     }
   else
   if(str[1] == 'p')
     {
-      if(sscanf(&(str[2])," %lg %lg %lg", &(v[0]), &(v[1]), &(v[3])) < 3)
+      c = &(str[2]);
+      if(objio_readdouble(&c, &(v[0])) && objio_readdouble(&c, &(v[1])))
+	{
+	  if(!objio_readdouble(&c, &(v[3])))
+	    v[3] = 1.0;
+	}
+      else
 	{
 	  v[3] = 1.0;
 	}
@@ -2039,13 +2086,17 @@ objio_readvertex(char *str)
   else
   if(str[1] == 't')
     {
-      sscanf(&(str[2])," %lg %lg %lg", &(v[0]), &(v[1]), &(v[2]));
+      c = &(str[2]);
+      while(n < 3 && objio_readdouble(&c, &(v[n])))
+	n++;
       ay_status = objio_addvertex(4, v);
     }
   else
     {
-      if(sscanf(&(str[1])," %lg %lg %lg %lg",
-		&(v[0]), &(v[1]), &(v[2]), &(v[3])) < 4)
+      c = &(str[1]);
+      while(n < 4 && objio_readdouble(&c, &(v[n])))
+	n++;
+      if(n < 4)
 	{
 	  v[3] = 1.0;
 	}
@@ -2066,62 +2117,35 @@ objio_readvertex(char *str)
 int
 objio_readvindex(char *c, int *gvindex, int *tvindex, int *nvindex)
 {
- int ay_status = AY_OK;
 
   if(!c || !gvindex || !tvindex || !nvindex)
     return AY_ENULL;
 
   /* parse geometric vertex index */
-  sscanf(c, "%d", gvindex);
-  /* forward to next index, /, or end */
-  while((isspace((unsigned char)*c)))
-    c++;
-  if(*c == '\0')
-    return AY_OK;
-  while((isdigit(*c) || (*c == '-')) && (*c != '\0'))
-    c++;
-  if(*c == '\0')
+  if(!objio_readint(&c, gvindex))
     return AY_OK;
 
   /* parse texture vertex index? */
-  if(*c == '/')
+  if(*c != '/')
+    return AY_OK;
+  c++;
+
+  /* a second / means: no texture vertex index present */
+  if(*c != '/')
     {
-      /* maybe; check if next char is not a / too (which would mean:
-	 no texture vertex index present) */
-      if(c[1] != '/')
-	{
-	  /* next char is not a /, parse texture vertex index */
-	  c++;
-	  if(*c == '\0')
-	    return AY_OK;
-	  sscanf(c, "%d", tvindex);
-
-	  /* forward to next index or / */
-	  while((isdigit(*c) || (*c == '-')) && (*c != '\0'))
-	    c++;
-	  if(*c == '\0')
-	    return AY_OK;
-	  if(*c == '/')
-	    c++;
-	  if(*c == '\0')
-	    return AY_OK;
-	}
-      else
-	{
-	  /* skip over // combination */
-	  c += 2;
-	  if(*c == '\0')
-	    return AY_OK;
-	} /* if */
+      (void)objio_readint(&c, tvindex);
+      if(*c != '/')
+	return AY_OK;
+    } /* if */
+  c++;
 
-      /* parse normal vertex index */
-      if(isdigit(*c) || (*c == '-'))
-	{
-	  sscanf(c, "%d", nvindex);
-	} /* if */
+  /* parse normal vertex index */
+  if(isdigit((unsigned char)*c) || (*c == '-'))
+    {
+      (void)objio_readint(&c, nvindex);
     } /* if */
 
- return ay_status;
+ return AY_OK;
 } /* objio_readvindex */
 
 
@@ -2249,48 +2273,14 @@ objio_readface(char *str, int lastlinewasface)
       tv = NULL;
 
       /* get geometric vertex data and add it to the pomesh */
-      if(gvindex < 0)
-	{
-	  if(objio_gverts_tail)
-	    {
-	      ay_status = objio_getvertex(1,
-					objio_gverts_tail->index + gvindex + 1,
-					     &gv);
-	    }
-	  else
-	    {
-	      ay_status = AY_ENULL;
-	      goto cleanup;
-	    } /* if */
-	}
-      else
-	{
-	  ay_status = objio_getvertex(1, gvindex, &gv);
-	} /* if */
+      ay_status = objio_getvertex(1, gvindex, &gv);
       if(ay_status)
 	goto cleanup;
 
       if(nvindex != 0)
 	{
 	  /* get normal vertex data and add it to the pomesh */
-	  if(nvindex < 0)
-	    {
-	      if(objio_nverts_tail)
-		{
-		  ay_status = objio_getvertex(2,
-				        objio_nverts_tail->index + nvindex + 1,
-					     &nv);
-		}
-	      else
-		{
-		  ay_status = AY_ENULL;
-		  goto cleanup;
-		} /* if */
-	    }
-	  else
-	    {
-	      ay_status = objio_getvertex(2, nvindex, &nv);
-	    } /* if */
+	  ay_status = objio_getvertex(2, nvindex, &nv);
 	  if(ay_status)
 	    goto cleanup;
 	} /* if */
@@ -2300,24 +2290,7 @@ objio_readface(char *str, int lastlinewasface)
 	  /* get texture vertex data and cache it in texv */
 
 	  tv = NULL;
-	  if(tvindex < 0)
-	    {
-	      if(objio_tverts_tail)
-		{
-		  ay_status = objio_getvertex(4,
-					objio_tverts_tail->index + tvindex + 1,
-						 &tv);
-		}
-	      else
-		{
-		  ay_status = AY_ENULL;
-		  goto cleanup;
-		} /* if */
-	    }
-	  else
-	    {
-	      ay_status = objio_getvertex(4, tvindex, &tv);
-	    } /* if */
+	  ay_status = objio_getvertex(4, tvindex, &tv);
 
 	  if(tv)
 	    {
@@ -2544,24 +2517,7 @@ objio_readpolyline(char *str)
       tv = NULL;
 
       /* get geometric vertex data and add it to the curve */
-      if(gvindex < 0)
-	{
-	  if(objio_gverts_tail)
-	    {
-	      ay_status = objio_getvertex(1,
-					objio_gverts_tail->index + gvindex + 1,
-					  &gv);
-	    }
-	  else
-	    {
-	      ay_status = AY_ENULL;
-	      goto cleanup;
-	    } /* if */
-	}
-      else
-	{
-	  ay_status = objio_getvertex(1, gvindex, &gv);
-	} /* if */
+      ay_status = objio_getvertex(1, gvindex, &gv);
       if(ay_status)
 	goto cleanup;
 
@@ -2580,24 +2536,7 @@ objio_readpolyline(char *str)
 	  /* get texture vertex data and cache it in texv */
 
 	  tv = NULL;
-	  if(tvindex < 0)
-	    {
-	      if(objio_tverts_tail)
-		{
-		  ay_status = objio_getvertex(4,
-					objio_tverts_tail->index + tvindex + 1,
-					      &tv);
-		}
-	      else
-		{
-		  ay_status = AY_ENULL;
-		  goto cleanup;
-		} /* if */
-	    }
-	  else
-	    {
-	      ay_status = objio_getvertex(4, tvindex, &tv);
-	    } /* if */
+	  ay_status = objio_getvertex(4, tvindex, &tv);
 
 	  if(tv)
 	    {
@@ -2754,42 +2693,7 @@ objio_readcurv(char *str)
       ay_status = objio_readvindex(c, &gvindex, &tvindex, &nvindex);
       gv = NULL;
 
-      if(gvindex < 0)
-	{
-	  if(vtype == 1)
-	    {
-	      if(objio_gverts_tail)
-		{
-		  ay_status = objio_getvertex(vtype,
-					objio_gverts_tail->index + gvindex + 1,
-						 &gv);
-		}
-	      else
-		{
-		  ay_status = AY_ENULL;
-		  goto cleanup;
-		} /* if */
-	    }
-	  else
-	    {
-	      /* vtype == 3, get parametric vertex... */
-	      if(objio_pverts_tail)
-		{
-		  ay_status = objio_getvertex(vtype,
-					objio_pverts_tail->index + gvindex + 1,
-						 &gv);
-		}
-	      else
-		{
-		  ay_status = AY_ENULL;
-		  goto cleanup;
-		} /* if */
-	    } /* if */
-	}
-      else
-	{
-	  ay_status = objio_getvertex(vtype, gvindex, &gv);
-	} /* if */
+      ay_status = objio_getvertex(vtype, gvindex, &gv);
 
       if(gv)
 	{
@@ -2806,8 +2710,6 @@ objio_readcurv(char *str)
       objio_readskip(&c);
     } /* while */
 
-cleanup:
-
  return ay_status;
 } /* objio_readcurv */
 
@@ -2847,24 +2749,7 @@ objio_readsurf(char *str)
       ay_status = objio_readvindex(c, &gvindex, &tvindex, &nvindex);
 
       gv = NULL;
-      if(gvindex < 0)
-	{
-	  if(objio_gverts_tail)
-	    {
-	      ay_status = objio_getvertex(1,
-					objio_gverts_tail->index + gvindex + 1,
-					     &gv);
-	    }
-	  else
-	    {
-	      ay_status = AY_ENULL;
-	      goto cleanup;
-	    } /* if */
-	}
-      else
-	{
-	  ay_status = objio_getvertex(1, gvindex, &gv);
-	} /* if */
+      ay_status = objio_getvertex(1, gvindex, &gv);
 
       if(gv)
 	{
@@ -2880,24 +2765,7 @@ objio_readsurf(char *str)
       if(tvindex != 0)
 	{
 	  tv = NULL;
-	  if(tvindex < 0)
-	    {
-	      if(objio_tverts_tail)
-		{
-		  ay_status = objio_getvertex(4,
-					objio_tverts_tail->index + tvindex + 1,
-						 &tv);
-		}
-	      else
-		{
-		  ay_status = AY_ENULL;
-		  goto cleanup;
-		} /* if */
-	    }
-	  else
-	    {
-	      ay_status = objio_getvertex(4, tvindex, &tv);
-	    } /* if */
+	  ay_status = objio_getvertex(4, tvindex, &tv);
 
 	  if(tv)
 	    {
@@ -2919,8 +2787,6 @@ objio_readsurf(char *str)
 
   objio_texturevlen = tlength;
 
-cleanup:
-
  return ay_status;
 } /* objio_readsurf */
 
@@ -2933,7 +2799,7 @@ objio_readparm(char *str)
 {
  int ay_status = AY_OK;
  double knot, *knotv = NULL, *t = NULL;
- int readu = AY_FALSE, knots = 0;
+ int readu = AY_FALSE, knots = 0, knotsalloc = 0;
  char *c = str;
 
   if(!str)
@@ -2951,18 +2817,29 @@ objio_readparm(char *str)
 
   while(*c != '\0')
     {
-      if(sscanf(c, "%lg", &knot))
+      if(isspace((unsigned char)*c))
 	{
-	  t = NULL;
-	  if(!(t = realloc(knotv, (knots + 1) * sizeof(double))))
-	    { if(knotv){free(knotv);} return AY_EOMEM; }
-	  knotv = t;
+	  c++;
+	  continue;
+	}
+
+      if(objio_readdouble(&c, &knot))
+	{
+	  if(knots == knotsalloc)
+	    {
+	      knotsalloc = knotsalloc?(knotsalloc*2):64;
+	      if(!(t = realloc(knotv, knotsalloc * sizeof(double))))
+		{ if(knotv){free(knotv);} return AY_EOMEM; }
+	      knotv = t;
+	    }
 	  knotv[knots] = knot;
 	  knots++;
+	}
+      else
+	{
+	  /* skip to next knot */
+	  objio_readskip(&c);
 	} /* if */
-
-      /* skip to next knot */
-      objio_readskip(&c);
     } /* while */
 
   if(readu)
@@ -3561,91 +3438,182 @@ cleanup:
 } /* objio_readend */
 
 
-/* objio_readline:
- *  read a single line from a Wavefront OBJ file
+/* objio_fillbuffer:
+ *  read the next block of the current file into the input buffer
+ *
+ *  \returns AY_OK on success, AY_EUEOF if the end of the file is reached
  */
 int
-objio_readline(FILE *fileptr)
+objio_fillbuffer(void)
 {
- int ay_status = AY_OK;
- int read, peek, continuation = AY_FALSE;
- static int lastlinewasface = AY_FALSE;
- char readchar, *str;
- Tcl_DString ds;
 
-  if(!fileptr)
-    {
-      if(lastlinewasface)
-	ay_status = objio_readface(NULL, -1);
-      lastlinewasface = AY_FALSE;
-      return AY_ENULL;
-    }
+  if(objio_rb.eof || !objio_rb.fileptr || !objio_rb.buf)
+    return AY_EUEOF;
 
-  Tcl_DStringInit(&ds);
+  objio_rb.bufpos = 0;
+  objio_rb.buflen = fread(objio_rb.buf, 1, OBJIO_READBUFSIZE,
+			  objio_rb.fileptr);
 
-  read = getc(fileptr);
+  if(objio_rb.buflen < OBJIO_READBUFSIZE)
+    objio_rb.eof = AY_TRUE;
 
-  if(read == EOF)
-    {Tcl_DStringFree(&ds); return AY_EUEOF;}
+  if(objio_rb.buflen == 0)
+    return AY_EUEOF;
 
-  if((char)read == '\n' || (char)read == '\r')
-    {Tcl_DStringFree(&ds); return AY_OK;}
+ return AY_OK;
+} /* objio_fillbuffer */
 
-  /* read characters from the file until a line end is hit
-     (and no line continuation hint ('\') was encountered before
-      on that line) */
-  while(1)
-    {
-      /* put read character to the buffer string
-	 (but omit line end and continuation characters) */
-      if((char)read != '\n' && (char)read != '\r' && (char)read != '\\')
-	{
-	  readchar = (char)read;
-	  Tcl_DStringAppend(&ds, &readchar, 1);
-	}
 
-      read = getc(fileptr);
+/* objio_getline:
+ *  assemble the next line from the input buffer; line end and
+ *  continuation characters are omitted and a line continues past
+ *  a line end if it is immediately preceded by a backslash
+ *
+ *  \param[in,out] line where to store the pointer to the line,
+ *   the line is padded with a space and stays valid until the next call;
+ *   empty lines are returned as NULL
+ *
+ *  \returns AY_OK on success, AY_EUEOF if the end of the file is reached
+ */
+int
+objio_getline(char **line)
+{
+ char *b, *e, *t;
+ size_t len = 0, n;
+ int first = AY_TRUE, continuation = AY_FALSE, done = AY_FALSE;
 
-      if(read == EOF)
-	{
-	  break;
-	}
+  *line = NULL;
 
-      if((char)read == '\\')
+  while(!done)
+    {
+      if(objio_rb.bufpos >= objio_rb.buflen)
 	{
-	  peek = getc(fileptr);
-
-	  if(peek == EOF)
+	  if(objio_fillbuffer())
 	    {
+	      if(first)
+		return AY_EUEOF;
 	      break;
 	    }
+	}
+
+      b = &(objio_rb.buf[objio_rb.bufpos]);
+      e = &(objio_rb.buf[objio_rb.buflen]);
 
-	  if((char)peek == '\n' || (char)peek == '\r')
+      if(first)
+	{
+	  first = AY_FALSE;
+	  /* empty line? */
+	  if(*b == '\n' || *b == '\r')
 	    {
-	      continuation = AY_TRUE;
+	      objio_rb.bufpos++;
+	      return AY_OK;
 	    }
+	}
+
+      /* find the end of the next run of plain characters */
+      t = b;
+      while(t < e && *t != '\n' && *t != '\r' && *t != '\\')
+	t++;
 
-	  ungetc(peek, fileptr);
+      /* copy the run to the line buffer */
+      n = (size_t)(t - b);
+      if(len + n + 2 > objio_rb.linealloc)
+	{
+	  objio_rb.linealloc = 2*(len + n + 2);
+	  if(!(b = realloc(objio_rb.line, objio_rb.linealloc)))
+	    return AY_EOMEM;
+	  objio_rb.line = b;
+	  b = &(objio_rb.buf[objio_rb.bufpos]);
 	}
+      memcpy(&(objio_rb.line[len]), b, n);
+      len += n;
+      objio_rb.bufpos += n;
 
-      if((char)read == '\n' || (char)read == '\r')
+      if(t == e)
+	continue;
+
+      objio_rb.bufpos++;
+
+      switch(*t)
 	{
+	case '\\':
+	  /* a backslash immediately preceding a line end marks
+	     a line continuation, other backslashes are ignored */
+	  if(objio_rb.bufpos >= objio_rb.buflen)
+	    {
+	      if(objio_fillbuffer())
+		done = AY_TRUE;
+	    }
+	  if(!done && (objio_rb.buf[objio_rb.bufpos] == '\n' ||
+		       objio_rb.buf[objio_rb.bufpos] == '\r'))
+	    continuation = AY_TRUE;
+	  break;
+	case '\r':
 	  if(continuation)
 	    {
+	      /* swallow the \n of a \r\n pair */
+	      if(objio_rb.bufpos >= objio_rb.buflen)
+		(void)objio_fillbuffer();
+	      if(objio_rb.bufpos < objio_rb.buflen &&
+		 objio_rb.buf[objio_rb.bufpos] == '\n')
+		objio_rb.bufpos++;
 	      continuation = AY_FALSE;
 	    }
 	  else
 	    {
-	      break;
+	      done = AY_TRUE;
 	    }
-	}
+	  break;
+	default:
+	  /* '\n' */
+	  if(continuation)
+	    continuation = AY_FALSE;
+	  else
+	    done = AY_TRUE;
+	  break;
+	} /* switch */
     } /* while */
 
+  if(!objio_rb.line)
+    return AY_OK;
+
   /* add some white space to the string, just in case we
      left the loop prematurely and the string is still empty */
-  Tcl_DStringAppend(&ds, " ", -1);
+  objio_rb.line[len] = ' ';
+  objio_rb.line[len+1] = '\0';
+
+  *line = objio_rb.line;
+
+ return AY_OK;
+} /* objio_getline */
+
+
+/* objio_readline:
+ *  read a single line from a Wavefront OBJ file
+ */
+int
+objio_readline(FILE *fileptr)
+{
+ int ay_status = AY_OK;
+ static int lastlinewasface = AY_FALSE;
+ char *str = NULL;
+
+  if(!fileptr)
+    {
+      if(lastlinewasface)
+	ay_status = objio_readface(NULL, -1);
+      lastlinewasface = AY_FALSE;
+      return AY_ENULL;
+    }
 
-  str = Tcl_DStringValue(&ds);
+  if(fileptr != objio_rb.fileptr)
+    return AY_ERROR;
+
+  if((ay_status = objio_getline(&str)))
+    return ay_status;
+
+  if(!str)
+    return AY_OK;
 
   switch(str[0])
     {
@@ -3718,8 +3686,6 @@ objio_readline(FILE *fileptr)
 	}
     }
 
-  Tcl_DStringFree(&ds);
-
  return ay_status;
 } /* objio_readline */
 
@@ -3782,8 +3748,20 @@ objio_readscene(char *filename)
 
   /* estimate number of lines (the average Wavefront OBJ line has 28 bytes) */
   lines = fsize/28;
+  if(lines == 0)
+    lines = 1;
 
-  while(!feof(fileptr))
+  /* prepare the input buffer */
+  memset(&objio_rb, 0, sizeof(objio_readbuf));
+  if(!(objio_rb.buf = malloc(OBJIO_READBUFSIZE)))
+    {
+      ay_error(AY_EOMEM, fname, NULL);
+      fclose(fileptr);
+      return;
+    }
+  objio_rb.fileptr = fileptr;
+
+  while(1)
     {
       if((ay_status = objio_readline(fileptr)))
 	break;
@@ -3829,6 +3807,13 @@ objio_readscene(char *filename)
       ay_error(AY_ERROR, fname, strerror(errno));
     }
 
+  /* clean up the input buffer */
+  if(objio_rb.buf)
+    free(objio_rb.buf);
+  if(objio_rb.line)
+    free(objio_rb.line);
+  memset(&objio_rb, 0, sizeof(objio_readbuf));
+
   /* clean up all vertex buffers */
   ay_status = objio_freevertices();
 
@@ -329,7 +329,10 @@ int x3dio_writenpwire(scew_element *element, ay_object *o);
 int x3dio_writetrimmednpwire(scew_element *element, ay_object *o);
 
 int x3dio_writetrimwire(scew_element *element, ay_nurbpatch_object *np,
-			ay_stess_uvp *p1, ay_stess_uvp *p2);
+			ay_stess_lines *lines, int p1, int p2);
+
+void x3dio_writetrimlines(scew_element *element, ay_nurbpatch_object *np,
+			  ay_stess_lines *lines, int ft_cw);
 
 int x3dio_writenpconvertibleobj(scew_element *element, ay_object *o);
 
@@ -8228,7 +8231,7 @@ cleanup:
  */
 int
 x3dio_writetrimwire(scew_element *element, ay_nurbpatch_object *np,
-		    ay_stess_uvp *p1, ay_stess_uvp *p2)
+		    ay_stess_lines *lines, int p1, int p2)
 {
  int ay_status = AY_OK;
  char fname[] = "x3dio_writetrimwire";
@@ -8241,9 +8244,9 @@ x3dio_writetrimwire(scew_element *element, ay_nurbpatch_object *np,
  scew_element *shape_element = NULL;
  scew_element *line_element = NULL;
  scew_element *coord_element = NULL;
- ay_stess_uvp *uvp;
+ double *uv;
 
-  if(!element || !np || !p1 || !p2)
+  if(!element || !np || !lines)
     return AY_ENULL;
 
   if(p1 == p2)
@@ -8259,15 +8262,7 @@ x3dio_writetrimwire(scew_element *element, ay_nurbpatch_object *np,
 
   /* estimate memory needed to store the indices */
   /* calculate total number of points/indices */
-  a = 1;
-  uvp = p1;
-  while(uvp && uvp != p2)
-    {
-      a++;
-      uvp = uvp->next;
-    }
-
-  b = a;
+  b = p2-p1+1;
   idxsize = sprintf(buf, " %d", b*2);
 
   /* allocate and fill indices */
@@ -8294,16 +8289,16 @@ x3dio_writetrimwire(scew_element *element, ay_nurbpatch_object *np,
 
   j = 0;
   k = b*3;
-  uvp = p1;
+  uv = &(lines->uv[p1*2]);
   for(i = 0; i < b; i++)
     {
       if(np->is_rat)
 	ay_nb_FirstDerSurf4D(n-1, m-1, p, q, U, V, P,
-			     uvp->u, uvp->v,
+			     uv[0], uv[1],
 			     fder);
       else
 	ay_nb_FirstDerSurf3D(n-1, m-1, p, q, U, V, P,
-			     uvp->u, uvp->v,
+			     uv[0], uv[1],
 			     fder);
 
       fd1 = &(fder[3]);
@@ -8323,7 +8318,7 @@ x3dio_writetrimwire(scew_element *element, ay_nurbpatch_object *np,
       j += 3;
       k += 3;
 
-      uvp = uvp->next;
+      uv += 2;
     } /* for */
 
   /* write out all the data */
@@ -8356,6 +8351,57 @@ cleanup:
 } /* x3dio_writetrimwire */
 
 
+/* x3dio_writetrimlines:
+ * Write the pieces of the tesselated UV-lines <lines> of a trimmed
+ * NURBS patch, that lie inside the trim curves, using
+ * x3dio_writetrimwire() above.
+ */
+void
+x3dio_writetrimlines(scew_element *element, ay_nurbpatch_object *np,
+		     ay_stess_lines *lines, int ft_cw)
+{
+ int i, k, s, e, out, p1;
+
+  for(i = 0; i < lines->numlines; i++)
+    {
+      s = lines->starts[i];
+      e = lines->starts[i+1];
+      p1 = s;
+      if(e - s > 1)
+	{
+	  if(ft_cw)
+	    out = 0;
+	  else
+	    out = 1;
+
+	  for(k = s; k < e; k++)
+	    {
+	      if(lines->types[k] > 0)
+		{
+		  if(out)
+		    {
+		      p1 = k;
+		      out = 0;
+		    }
+		  else
+		    {
+		      x3dio_writetrimwire(element, np, lines, p1, k);
+		      out = 1;
+		    } /* if */
+		}
+	    } /* for */
+
+	  if(!out)
+	    {
+	      x3dio_writetrimwire(element, np, lines, p1, e-1);
+	    }
+	} /* if line has at least two points */
+    } /* for all lines */
+
+ return;
+} /* x3dio_writetrimlines */
+
+
 /* x3dio_writetrimmednpwire:
  * Special version of x3dio_writetrimwire() for trimmed NURBS patches.
  *
@@ -8382,11 +8428,10 @@ x3dio_writetrimmednpwire(scew_element *element, ay_object *o)
  scew_element *shape_element = NULL;
  scew_element *line_element = NULL;
  scew_element *coord_element = NULL;
- int out, tcslen = 0;
+ int tcslen = 0;
  ay_stess_patch stess = {0};
  int *tcslens = NULL;
  double **tcs = NULL;
- ay_stess_uvp *uvpptr, *p1, *p2;
 
   if(!element || !o)
     return AY_ENULL;
@@ -8403,121 +8448,10 @@ x3dio_writetrimmednpwire(scew_element *element, ay_object *o)
     return ay_status;
 
   /* write iso-u lines */
-  out = 0;
-  for(i = 0; i < stess.upslen; i++)
-    {
-      uvpptr = stess.ups[i];
-      p1 = uvpptr;
-      if(uvpptr && uvpptr->next)
-	{
-	  if(stess.ft_cw)
-	    {
-	      out = 0;
-	      p1 = uvpptr;
-	      /*
-		glBegin(GL_LINE_STRIP);
-	      */
-	    }
-	  else
-	    out = 1;
-
-	  while(uvpptr)
-	    {
-	      if(uvpptr->type > 0)
-		{
-		  if(out)
-		    {
-		      p1 = uvpptr;
-		      /*
-			glBegin(GL_LINE_STRIP);
-			glVertex3dv((GLdouble*)(uvpptr->C));
-		      */
-		      out = 0;
-		    }
-		  else
-		    {
-		      p2 = uvpptr;
-		      x3dio_writetrimwire(transform_element, np, p1, p2);
-		      /*
-			glVertex3dv((GLdouble*)(uvpptr->C));
-			glEnd();
-		      */
-		      out = 1;
-		    } /* if */
-		}
-
-	      uvpptr = uvpptr->next;
-	    } /* while */
-
-	  if(!out)
-	    {
-	      p2 = uvpptr;
-	      x3dio_writetrimwire(transform_element, np, p1, p2);
-	      /*
-		glEnd();
-	      */
-	    }
-	} /* if line has at least two points */
-    } /* for all u lines */
+  x3dio_writetrimlines(transform_element, np, &(stess.ups), stess.ft_cw);
 
   /* write iso-v lines */
-  out = 0;
-  for(i = 0; i < stess.vpslen; i++)
-    {
-      uvpptr = stess.vps[i];
-      p1 = uvpptr;
-      if(uvpptr && uvpptr->next)
-	{
-	  if(stess.ft_cw)
-	    {
-	      out = 0;
-	      p1 = uvpptr;
-	      /*
-		glBegin(GL_LINE_STRIP);
-		glVertex3dv((GLdouble*)(uvpptr->C));
-	      */
-	    }
-	  else
-	    out = 1;
-
-	  while(uvpptr)
-	    {
-	      if(uvpptr->type > 0)
-		{
-		  if(out)
-		    {
-		      p1 = uvpptr;
-		      /*
-			glBegin(GL_LINE_STRIP);
-			glVertex3dv((GLdouble*)(uvpptr->C));
-		      */
-		      out = 0;
-		    }
-		  else
-		    {
-		      p2 = uvpptr;
-		      x3dio_writetrimwire(transform_element, np, p1, p2);
-		      /*
-			glVertex3dv((GLdouble*)(uvpptr->C));
-			glEnd();
-		      */
-		      out = 1;
-		    } /* if */
-		}
-
-	      uvpptr = uvpptr->next;
-	    } /* while */
-
-	  if(!out)
-	    {
-	      p2 = uvpptr;
-	      x3dio_writetrimwire(transform_element, np, p1, p2);
-	      /*
-		glEnd();
-	      */
-	    }
-	} /* if line has at least two points */
-    } /* for all v lines */
+  x3dio_writetrimlines(transform_element, np, &(stess.vps), stess.ft_cw);
 
   /* write trim curves */
   P = np->controlv;
@@ -11104,6 +11038,10 @@ x3dio_writescene(char *filename, int selected, int toplevellayers)
   if(!filename)
     return AY_ENULL;
 
+  /* load all lazily read data first, exported objects may provide
+     or reference other objects */
+  ay_bin_loadall(ay_root);
+
   /* create and initialize hashtable for DEFs */
   if(!(x3dio_defs_ht = calloc(1, sizeof(Tcl_HashTable))))
     return AY_EOMEM;
@@ -24,7 +24,7 @@ array set aytestprefs {
     InitTypes 0
     RandomOrder 0
     AdvancedOptions 0
-    TestProcs { testDefaultCallbacks testValidSolidVariations testValidNURBS testValidToolObjects testModellingTools testAllSolidVariations testCustomObjects testScriptObjects }
+    TestProcs { testDefaultCallbacks testValidSolidVariations testValidNURBS testValidToolObjects testModellingTools testAllSolidVariations testCustomObjects testScriptObjects testBinaryScenes testNURBSQueries }
 }
 
 # aytest_handleLBS:
@@ -139,6 +139,8 @@ proc aytest_selectGUI { } {
     $lb insert end "Test 6 - All Solid Object Variations"
     $lb insert end "Test 7 - Custom Objects"
     $lb insert end "Test 8 - Script Objects"
+    $lb insert end "Test 9 - Binary Scene Files"
+    $lb insert end "Test 10 - NURBS Queries"
 
     bind $lb <<ListboxSelect>> "aytest_handleLBS %W"
 
@@ -3049,6 +3051,418 @@ foreach type $types {
 # testScriptObjects
 
 
+#
+# Test Binary Scene Files
+#
+proc testBinaryScenes { types } {
+set ::types $types
+uplevel #0 {
+puts $log "Testing binary scene files...\n"
+
+# creation options of the objects to test (if not created with defaults)
+array set aytestbinargs {
+    NCurve {-length 4 -order 3 -cv {0 0 0 1  1 1 0 0.5  2 1 0 2  3 0 0 1}}
+    NPatch {-width 3 -height 3 -uorder 3 -vorder 3 -cv {0 0 0 1  0 1 0 1  0 2 0 1  1 0 0 1  1 1 1 0.5  1 2 0 1  2 0 0 1  2 1 0 1  2 2 0 1}}
+    PolyMesh {-p 1 -l {2} -cv {0 0 0  1 0 0  0 1 0  .25 .25 0  .5 .25 0  .25 .5 0}}
+}
+
+set binfile [file rootname $scratchfile].ayb
+set reffile [file rootname $scratchfile]ref.ay
+set oldlazyload $ayprefs(LazyLoad)
+
+set view1 ""
+if { [winfo exists .fv.fViews.fview1.f3D.togl] } {
+    set view1 .fv.fViews.fview1.f3D.togl
+}
+
+puts -nonewline "Testing "
+foreach type $types {
+    set aytestprefs(TestItem) "${type}"
+    puts -nonewline "${type}, "
+
+    newScene
+    selOb
+
+    switch $type {
+	Hierarchy {
+	    crtOb Level
+	    goDown -1
+	    crtOb NCurve
+	    eval crtOb NPatch $aytestbinargs(NPatch)
+	    crtOb Sphere
+	    goUp
+	}
+	LazyExport {
+	    crtOb Level
+	    goDown -1
+	    eval crtOb NCurve $aytestbinargs(NCurve)
+	    eval crtOb NPatch $aytestbinargs(NPatch)
+	    eval crtOb PolyMesh $aytestbinargs(PolyMesh)
+	    goUp
+	}
+	Truncated -
+	Corrupt {
+	    eval crtOb NPatch $aytestbinargs(NPatch)
+	    eval crtOb PolyMesh $aytestbinargs(PolyMesh)
+	}
+	default {
+	    if { [info exists aytestbinargs($type)] } {
+		eval crtOb $type $aytestbinargs($type)
+	    } else {
+		crtOb $type
+	    }
+	}
+    }
+    # switch
+    hSL
+
+    puts $log "Saving a $type ...\n"
+    saveScene $reffile 1
+    saveScene $binfile 1 1
+
+    if { $type == "Truncated" || $type == "Corrupt" } {
+	set f [open $binfile r]
+	fconfigure $f -translation binary
+	set data [read $f]
+	close $f
+	set len [string length $data]
+
+	if { $type == "Truncated" } {
+	    # cut the file in the header, in the first object, and
+	    # in the last object
+	    set cuts [list 4 [expr {$len/3}] [expr {$len-8}]]
+	} else {
+	    # overwrite parts of the header, the first object, and
+	    # the last object with garbage
+	    set cuts [list 8 [expr {$len/3}] [expr {$len-24}]]
+	}
+
+	foreach cut $cuts {
+	    set aytestprefs(TestVariant) "${type} at ${cut}/${len}"
+	    if { $type == "Truncated" } {
+		set bad [string range $data 0 [expr {$cut-1}]]
+	    } else {
+		set bad [string replace $data $cut [expr {$cut+15}]\
+			     [string repeat "\xff" 16]]
+	    }
+	    set f [open $binfile w]
+	    fconfigure $f -translation binary
+	    puts -nonewline $f $bad
+	    close $f
+
+	    foreach lazy {0 1} {
+		puts $log "Reading a $type file (cut: $cut, lazy: $lazy)...\n"
+		set ayprefs(LazyLoad) $lazy
+		setPrefs
+		newScene
+		set ::ay_error 0
+		insertScene $binfile
+		# force loading of all objects
+		saveScene $scratchfile
+		if { $type == "Truncated" && $::ay_error < 2 } {
+		    puts $log "FAILED: no error reading a $type file!\n"
+		    puts "\nFAILED: no error reading a $type file (cut: $cut)!"
+		}
+	    }
+	}
+	# foreach
+    } elseif { $type == "LazyExport" } {
+	# export and tesselate lazily loaded objects that were
+	# never drawn or selected
+	set objref [file rootname $scratchfile]ref.obj
+	set objcmp [file rootname $scratchfile].obj
+	catch {loadPlugin objio}
+	if { [info commands objioWrite] != "" } {
+	    puts $log "Exporting a lazily loaded scene ...\n"
+	    objioWrite $objref
+	    set ayprefs(LazyLoad) 1
+	    setPrefs
+	    newScene
+	    insertScene $binfile
+	    set ::ay_error 0
+	    objioWrite $objcmp
+	    set f [open $objref r]
+	    set ref [read $f]
+	    close $f
+	    set f [open $objcmp r]
+	    set cmp [read $f]
+	    close $f
+	    if { $::ay_error > 1 || ![string equal $ref $cmp] } {
+		puts $log "FAILED: export of lazily loaded scene differs!\n"
+		puts "\nFAILED: export of lazily loaded scene differs!"
+	    }
+	    if { ! $::aytestprefs(KeepFiles) } {
+		catch {file delete $objref}
+		catch {file delete $objcmp}
+	    }
+	}
+
+	puts $log "Tesselating a lazily loaded scene ...\n"
+	set ayprefs(LazyLoad) 1
+	setPrefs
+	newScene
+	insertScene $binfile
+	selOb 0
+	set ::ay_error 0
+	tessNPs
+	getLevel names types
+	if { $::ay_error > 1 || [lindex $types end] != "PolyMesh" } {
+	    puts $log "FAILED: tesselation of lazily loaded scene!\n"
+	    puts "\nFAILED: tesselation of lazily loaded scene!"
+	}
+    } else {
+	foreach lazy {0 1} {
+	    set aytestprefs(TestVariant) "LazyLoad ${lazy}"
+	    puts $log "Reading a $type (lazy: $lazy)...\n"
+	    set ayprefs(LazyLoad) $lazy
+	    setPrefs
+	    newScene
+	    selOb
+	    set ::ay_error 0
+	    insertScene $binfile
+	    if { $::ay_error > 1 } {
+		puts $log "FAILED: error reading a $type!\n"
+		puts "\nFAILED: error reading a $type (lazy: $lazy)!"
+	    }
+
+	    if { [winfo exists $view1] } {
+		puts $log "Drawing a $type ...\n"
+		$view1 mc
+		$view1 redraw
+	    }
+
+	    hSL
+	    saveScene $scratchfile 1
+
+	    # compare with the original object
+	    set f [open $reffile r]
+	    set ref [read $f]
+	    close $f
+	    set f [open $scratchfile r]
+	    set cmp [read $f]
+	    close $f
+	    if { ![string equal $ref $cmp] } {
+		puts $log "FAILED: $type differs after reading!\n"
+		puts "\nFAILED: $type differs after reading (lazy: $lazy)!"
+	    }
+	}
+	# foreach
+    }
+    # if
+
+    set ayprefs(LazyLoad) $oldlazyload
+    setPrefs
+
+    if { ! $::aytestprefs(KeepFiles) } {
+	catch {file delete $scratchfile}
+	catch {file delete $binfile}
+	catch {file delete $reffile}
+    }
+
+    selOb
+    goTop
+
+    if { $::cancelled } {
+	break;
+    }
+}
+# foreach
+
+newScene
+}
+}
+# testBinaryScenes
+
+
+#
+# Test NURBS Queries
+#
+proc testNURBSQueries { commands } {
+set ::commands $commands
+uplevel #0 {
+puts $log "Testing NURBS query and tesselation commands...\n"
+
+# a planar bilinear patch spanning [0,1]x[0,1] in the XY plane
+set aytestqplane {-width 2 -height 2 -uorder 2 -vorder 2 -cv {0 0 0 1  0 1 0 1  1 0 0 1  1 1 0 1}}
+# a curved patch
+set aytestqcurved {-width 3 -height 3 -uorder 3 -vorder 3 -cv {0 0 0 1  0 1 0 1  0 2 0 1  1 0 0 1  1 1 1 1  1 2 0 1  2 0 0 1  2 1 0 1  2 2 0 1}}
+# a patch collapsed to a single point
+set aytestqdegen {-width 2 -height 2 -uorder 2 -vorder 2 -cv {1 1 1 1  1 1 1 1  1 1 1 1  1 1 1 1}}
+
+# each case is a list of: creation commands, command to test,
+# expected result ("-" if only the error state is to be checked,
+# "PolyMesh" if a PolyMesh is to be created), and whether an error
+# is expected
+set aytestqcases(findUVNP) {
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 0.25 0.75 0.0}
+	{0.25 0.75 0.25 0.75 0.0} 0}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 0.25 0.75 1.0}
+	{0.25 0.75 0.25 0.75 0.0} 0}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 2.0 2.0 0.0}
+	{1.0 1.0 1.0 1.0 0.0} 0}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 0.5 0.5 1.0 0.0 0.0 -1.0}
+	{0.5 0.5 0.5 0.5 0.0} 0}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 5.0 5.0 1.0 0.0 0.0 -1.0}
+	{} 0}
+    {{eval crtOb NPatch $aytestqplane; hSL; movOb 0 0 1}
+	{findUVNP -t 0.5 0.5 1.0} {0.5 0.5 0.5 0.5 1.0} 0}
+    {{eval crtOb NPatch $aytestqcurved} {findUVNP 1.0 1.0 2.0}
+	{0.5 0.5 1.0 1.0 0.25} 0}
+    {{eval crtOb NPatch $aytestqdegen} {findUVNP 0.0 0.0 0.0} - 0}
+    {{eval crtOb NPatch $aytestqdegen} {findUVNP 0.0 0.0 0.0 1.0 1.0 1.0}
+	- 0}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 0.5 0.5} - 1}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP 0.5 0.5 0.5 1.0} - 1}
+    {{eval crtOb NPatch $aytestqplane} {findUVNP a b c} - 1}
+    {{crtOb Light} {findUVNP 0.5 0.5 0.5} {} 0}
+    {{} {findUVNP 0.5 0.5 0.5} - 1}
+}
+
+set aytestqcases(tessNPs) {
+    {{eval crtOb NPatch $aytestqplane} {tessNPs} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqcurved} {tessNPs 3 1} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqcurved} {tessNPs 0 5} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqdegen} {tessNPs} - 0}
+    {{crtOb Sphere} {tessNPs} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqplane} {tessNPs a} - 1}
+    {{} {tessNPs} - 1}
+}
+
+set aytestqcases(adTessNP) {
+    {{eval crtOb NPatch $aytestqplane} {adTessNP} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqcurved} {adTessNP 0.001 5 1} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqdegen} {adTessNP} - 0}
+    {{eval crtOb NPatch $aytestqcurved; goDown -1;
+	crtOb NCurve -length 5 -order 2 -cv {0.25 0.25 0 1  0.75 0.25 0 1  0.75 0.75 0 1  0.25 0.75 0 1  0.25 0.25 0 1};
+	goUp} {adTessNP 0.001} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqplane; goDown -1;
+	crtOb NCurve -length 5 -order 2 -cv {0.25 0.25 0 1  0.25 0.75 0 1  0.75 0.75 0 1  0.75 0.25 0 1  0.25 0.25 0 1};
+	goUp} {adTessNP 0.01 15 1} PolyMesh 0}
+    {{eval crtOb NPatch $aytestqplane} {adTessNP 0.0} - 1}
+    {{eval crtOb NPatch $aytestqplane} {adTessNP a} - 1}
+    {{crtOb NCurve} {adTessNP} - 1}
+}
+
+set aytestqcases(intersectNC) {
+    {{crtOb NCurve -length 2 -order 2 -cv {-1 0 0 1  1 0 0 1};
+	crtOb NCurve -length 2 -order 2 -cv {0 -1 0 1  0 1 0 1}}
+	{intersectNC} {0.5 0.5 0.0 0.0 0.0} 0}
+    {{crtOb NCurve -length 2 -order 2 -cv {-1 0 0 1  1 0 0 1};
+	crtOb NCurve -length 2 -order 2 -cv {0 1 0 1  0 2 0 1}}
+	{intersectNC} {} 0}
+    {{crtOb NCurve -length 2 -order 2 -cv {-1 0 0 1  1 0 0 1};
+	crtOb NCurve -length 2 -order 2 -cv {0 -1 0 1  0 1 0 1};
+	hSL; movOb 0.5 0 0}
+	{intersectNC -t} {0.75 0.5 0.5 0.0 0.0} 0}
+    {{crtOb NCurve -length 2 -order 2 -cv {0 0 0 1  0 0 0 1};
+	crtOb NCurve -length 2 -order 2 -cv {0 -1 0 1  0 1 0 1}}
+	{intersectNC} - 0}
+    {{crtOb NCurve -length 2 -order 2 -cv {-1 0 0 1  1 0 0 1};
+	crtOb NCurve -length 2 -order 2 -cv {-1 0 0 1  1 0 0 1}}
+	{intersectNC} - 1}
+    {{crtOb NCurve -length 2 -order 2 -cv {-1 0 0 1  1 0 0 1};
+	crtOb NCurve -length 2 -order 2 -cv {0 -1 0 1  0 1 0 1}}
+	{intersectNC 0.0} - 1}
+    {{crtOb NCurve} {intersectNC} - 1}
+    {{} {intersectNC} - 1}
+}
+
+puts -nonewline "Testing "
+foreach command $commands {
+    set aytestprefs(TestItem) "${command}"
+    puts -nonewline "${command}, "
+
+    set i 0
+    foreach case $aytestqcases($command) {
+	set aytestprefs(TestVariant) [lindex $case 1]
+	puts $log "Running $command case $i: [lindex $case 1] ...\n"
+
+	newScene
+	selOb
+	eval [lindex $case 0]
+	# select all created objects
+	getLevel -l nobjs
+	set sel ""
+	set j 0
+	while { $j < $nobjs } {
+	    lappend sel $j
+	    incr j
+	}
+	if { $nobjs > 0 } {
+	    eval selOb $sel
+	}
+
+	set ::ay_error 0
+	set res ""
+	catch {set res [eval [lindex $case 1]]}
+	set exp [lindex $case 2]
+	set experr [lindex $case 3]
+
+	if { $experr } {
+	    if { $::ay_error < 2 } {
+		puts $log "FAILED: no error for $command case $i!\n"
+		puts "\nFAILED: no error for $command case $i!"
+	    }
+	} else {
+	    if { $::ay_error > 1 } {
+		puts $log "FAILED: error for $command case $i!\n"
+		puts "\nFAILED: error for $command case $i!"
+	    }
+	    if { $exp == "-" } {
+		# only the error state is checked
+	    } elseif { $exp == "PolyMesh" } {
+		# the tesselation must have been created as last object
+		getLevel names types
+		if { [lindex $types end] != "PolyMesh" } {
+		    puts $log "FAILED: no PolyMesh from $command case $i!\n"
+		    puts "\nFAILED: no PolyMesh from $command case $i!"
+		}
+	    } else {
+		if { ![aytest_cmpnums $res $exp] } {
+		    puts $log "FAILED: $command case $i: $res != $exp!\n"
+		    puts "\nFAILED: $command case $i: $res != $exp!"
+		}
+	    }
+	}
+	# if
+
+	incr i
+
+	if { $::cancelled } {
+	    break;
+	}
+    }
+    # foreach case
+
+    if { $::cancelled } {
+	break;
+    }
+}
+# foreach
+
+newScene
+}
+}
+# testNURBSQueries
+
+
+# aytest_cmpnums:
+#  compare two lists of numbers <a> and <b> with tolerance <eps>
+#  returns 1 if they match
+proc aytest_cmpnums { a b { eps 1.0e-4 } } {
+    if { [llength $a] != [llength $b] } {
+	return 0;
+    }
+    foreach x $a y $b {
+	if { [catch {expr {abs($x-$y) > $eps}} differ] || $differ } {
+	    return 0;
+	}
+    }
+ return 1;
+}
+# aytest_cmpnums
+
+
 # aytest_varcmds:
 #  what to do with the object variants
 #
@@ -3562,6 +3976,23 @@ set types {}
 lappend types 1 1 1 1 1 2 2 2
 set testScriptObjectsTypes $types
 
+# set up items to test in test #9
+set items {}
+lappend items Box Sphere Cylinder Cone Disk Hyperboloid Paraboloid Torus
+lappend items NCurve ICurve ACurve NCircle
+lappend items NPatch IPatch APatch BPatch PatchMesh PolyMesh
+lappend items Revolve Extrude Sweep Swing Skin Birail1 Birail2 Gordon DSkin
+lappend items Cap Bevel ExtrNC ExtrNP OffsetNC OffsetNP ConcatNC ConcatNP
+lappend items Trim Text
+lappend items Camera Light Material RiInc RiProc Script Select
+lappend items Clone Mirror Hierarchy LazyExport Truncated Corrupt
+set testBinaryScenesItems $items
+
+# set up commands to test in test #10
+set items {}
+lappend items findUVNP tessNPs adTessNP intersectNC
+set testNURBSQueriesItems $items
+
 ###
 
 # everything is set, start the GUI
@@ -16,6 +16,8 @@
 #   bgconvert.tcl infile.rib outfile.dxf
 #  or (with options):
 #   bgconvert.tcl "infile.rib -p 1" outfile.obj
+#  or (to convert between text and binary Ayam scene files):
+#   bgconvert.tcl scene.ay scene.ayb
 
 if { $argc < 2 } {
     puts stderr "Error, need two file names!"
@@ -25,8 +27,10 @@ if { $argc < 2 } {
 #
 proc fileNameToPluginName { filename } {
     # extend as needed
-    set extensions { ".rib" ".3dm" ".obj" ".3dmf" ".mop" ".dxf" ".x3d" }
-    set plugins { "rrib" "onio" "objio" "mfio" "mopsi" "dxfio" "x3dio" }
+    set extensions { ".rib" ".3dm" ".obj" ".3dmf" ".mop" ".dxf" ".x3d"
+	".ay" ".ayb" }
+    set plugins { "rrib" "onio" "objio" "mfio" "mopsi" "dxfio" "x3dio"
+	"ay" "ayb" }
 
     set ext [file extension $filename]
     if { $ext != "" } {
@@ -68,24 +72,37 @@ set outplugin [fileNameToPluginName $outfile]
 
 if { $outplugin == "" } { exit }
 
-set cscript "\
-if { ! \[info exists \"${inplugin}Read\"\] } { \
-   set ::ay(autoload) ${inplugin}; \
-   io_lcAuto; \
-}; \
-if { ! \[info exists \"${outplugin}Write\"\] } { \
-   set ::ay(autoload) ${outplugin}; \
+set cscript ""
+foreach {plugin cmd} [list $inplugin Read $outplugin Write] {
+    # Ayam scene files need no plugin
+    if { $plugin != "ay" && $plugin != "ayb" } {
+	append cscript "\
+if { ! \[info exists \"${plugin}${cmd}\"\] } { \
+   set ::ay(autoload) ${plugin}; \
    io_lcAuto; \
 }; \
 "
+    }
+}
 append cscript "newScene; cd [pwd];"
-append cscript "${inplugin}Read [lindex $argv 0];"
+if { $inplugin == "ay" || $inplugin == "ayb" } {
+    # the scene reader detects binary files automatically
+    append cscript "replaceScene [lindex $argv 0];"
+} else {
+    append cscript "${inplugin}Read [lindex $argv 0];"
+}
 
 # this is the right place to append some scene processing,
 # like conversion to polygons:
 #append cscript "toPoly;"
 
-append cscript "${outplugin}Write [lindex $argv 1];"
+if { $outplugin == "ay" } {
+    append cscript "saveScene [lindex $argv 1] 0 0;"
+} elseif { $outplugin == "ayb" } {
+    append cscript "saveScene [lindex $argv 1] 0 1;"
+} else {
+    append cscript "${outplugin}Write [lindex $argv 1];"
+}
 
 # do we run in wish?
 if { [string first wish [file tail [info nameofexecutable]]] != -1 } {
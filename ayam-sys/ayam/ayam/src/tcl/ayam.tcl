@@ -99,6 +99,10 @@ array set ayprefs {
  WriteIdent 1
  ShadowMaps 0
  ExcludeHidden 1
+ RIBFormat 0
+ RIBCompress 0
+ RIBCache 0
+ RIBParallel 0
  QRender "rgl -rd 4 %s"
  QRenderUI 0
  QRenderPT ""
@@ -152,6 +156,7 @@ array set ayprefs {
  LogFile "/tmp/ay.log"
 
  UndoLevels 10
+ UndoMemory 256
 
  mainGeom ""
  mainState "normal"
@@ -210,6 +215,7 @@ array set ayprefs {
  ConsoleCursorEnd 1
 
  AddExtensions 0
+ LazyLoad 0
 
  WindowSystem "unknown"
 
@@ -268,6 +274,8 @@ array set ayprefs {
  PickCycle 0
  PickCycleMax 5
  CullFaces 0
+ CullObjects 1
+ CullSize 0
  AutoCloseUI 1
  DisableFailedScripts 1
  CyclePerspective 0
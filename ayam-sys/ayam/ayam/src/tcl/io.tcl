@@ -41,7 +41,7 @@ proc io_replaceScene { {newfilename ""} } {
 	}
 
 	set types [subst {
-	    {"Ayam Scene" ".ay"}
+	    {"Ayam Scene" {".ay" ".ayb"}}
 	    {"Supported Files" {$ayprefs(ALFileTypes)}}
 	    {"All Files" *}}]
 
@@ -77,7 +77,8 @@ proc io_replaceScene { {newfilename ""} } {
 
 	# see, if this is an Ayam scene file
 	set ext [file extension $filename]
-	if { ($ext != "") && ([string compare -nocase $ext ".ay"]) } {
+	if { ($ext != "") && ([string compare -nocase $ext ".ay"]) &&
+	     ([string compare -nocase $ext ".ayb"]) } {
 	    # no, try to import it
 	    io_importScene $filename
 	    return;
@@ -158,7 +159,7 @@ proc io_insertScene { {ifilename ""} } {
 	    if { $dirname == "." } { set dirname [pwd] }
 	}
 
-	set types [subst {{"Ayam Scene" ".ay"}
+	set types [subst {{"Ayam Scene" {".ay" ".ayb"}}
 	    {"Supported Files" {$ayprefs(ALFileTypes)}}
 	    {"All Files" *}}]
 
@@ -190,7 +191,8 @@ proc io_insertScene { {ifilename ""} } {
 
 	# see, if this is an Ayam scene file
 	set ext [file extension $ifilename]
-	if { ($ext != "") && ([string compare -nocase $ext ".ay"]) } {
+	if { ($ext != "") && ([string compare -nocase $ext ".ay"]) &&
+	     ([string compare -nocase $ext ".ayb"]) } {
 	    # no, try to import it
 	    io_importScene $ifilename
 	    return;
@@ -255,7 +257,7 @@ proc io_saveScene { ask selected } {
 	    if { $dirname == "." } { set dirname [pwd] }
 	}
 
-	set types [subst {{"Ayam Scene" ".ay"}
+	set types [subst {{"Ayam Scene" {".ay" ".ayb"}}
 	    {"Supported Files" {$ayprefs(ALFileTypes)}}
 	    {"All Files" *}}]
 
@@ -271,7 +273,8 @@ proc io_saveScene { ask selected } {
 
 	# see, if the user wants to save to an Ayam scene file
 	set ext [file extension $filename]
-	if { ($ext != "") && ([string compare -nocase $ext ".ay"]) } {
+	if { ($ext != "") && ([string compare -nocase $ext ".ay"]) &&
+	     ([string compare -nocase $ext ".ayb"]) } {
 	    # no, try to export the scene...
 	    io_exportScene $filename
 	    return;
@@ -280,8 +283,13 @@ proc io_saveScene { ask selected } {
     # if have no filename
 
     if { $filename != "" } {
-	# append extension
-	set filename [io_appext $filename ".ay"]
+	# append extension; binary scene files keep theirs
+	set binary 0
+	if { [string equal -nocase [file extension $filename] ".ayb"] } {
+	    set binary 1
+	} else {
+	    set filename [io_appext $filename ".ay"]
+	}
 
 	# fix window positions
 	viewUPos
@@ -294,7 +302,7 @@ proc io_saveScene { ask selected } {
 	# save scene to disk
 	global ay_error
 	set ay_error ""
-	saveScene $filename $selected
+	saveScene $filename $selected $binary
 	set wh "saveScene"
 	if { $ay_error < 2 } {
 	    set windowfilename [file tail [file rootname $filename]]
@@ -768,7 +776,7 @@ proc io_saveEnv { } {
      if { $dirname == "." } { set dirname [pwd] }
  }
 
- set types {{"Ayam Scene" ".ay"} {"All Files" *}}
+ set types {{"Ayam Scene" {".ay" ".ayb"}} {"All Files" *}}
 
  if { $tcl_platform(os) != "Darwin" } {
      set savefilename [tk_getSaveFile -filetypes $types -parent .\
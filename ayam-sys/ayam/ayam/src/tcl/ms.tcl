@@ -160,6 +160,8 @@ ms_set en ayprefse_ListTypes "Show object types in the tree/list view?"
 ms_set en ayprefse_MarkHidden "Mark hidden objects in the tree view?"
 ms_set en ayprefse_AutoSavePrefs "Save preferences on exit?"
 ms_set en ayprefse_AddExtensions "Automatically add file name extensions?"
+ms_set en ayprefse_LazyLoad "Load the geometry of objects from binary scene\
+files\nnot before it is needed (e.g. for drawing)?"
 ms_set en ayprefse_BakOnReplace "Make backup copies of loaded scene files?"
 ms_set en ayprefse_LoadEnv "Load environment on startup?"
 ms_set en ayprefse_NewLoadsEnv "Load environment on File/New?"
@@ -193,6 +195,9 @@ ms_set en ayprefse_DefaultAction "Modelling action invoked, when <Esc> key\
 is pressed."
 ms_set en ayprefse_UndoLevels "Number of undoable modelling steps;\
 \n0 means Undo/Redo is disabled."
+ms_set en ayprefse_UndoMemory "Memory (in megabytes) the saved curves,\
+\nsurfaces, and meshes may use; when exceeded, the oldest\
+\nundoable modelling steps are forgotten; 0 means no limit."
 
 # Drawing
 ms_set en ayprefse_Tolerance "Sampling tolerance used when drawing\
@@ -209,6 +214,11 @@ ms_set en ayprefse_NPDisplayModeA "Determine how surfaces should be drawn\
 ms_set en ayprefse_NCDisplayModeA "Determine how curves should be drawn\
 \nwhen an action is active."
 ms_set en ayprefse_UseMatColor "Use color of material for shaded views?"
+ms_set en ayprefse_CullObjects "Skip drawing of objects that are completely\
+\noutside of the view (based on their bounding boxes)?"
+ms_set en ayprefse_CullSize "Objects whose bounding box covers fewer pixels\
+\nthan this are drawn as box while an action is active;\
+\n0 disables this."
 ms_set en ayprefse_Background "Color to use for the background."
 ms_set en ayprefse_Object "Color to use for unselected objects."
 ms_set en ayprefse_Selection "Color to use for selected objects."
@@ -244,6 +254,16 @@ create a RIB that automatically renders ShadowMaps all the time.\
 \nManual: Yes, but the ShadowMaps will be rendered on user request only
 (Menu: View/Create ShadowMaps)"
 ms_set en ayprefse_ExcludeHidden "Omit hidden objects on RIB export?"
+ms_set en ayprefse_RIBFormat "Format of exported RIB files:\
+\nASCII: text, numbers with six significant digits,\
+\nASCII (Precise): text, numbers with full precision,\
+\nBinary: binary encoded numbers (smaller and faster)."
+ms_set en ayprefse_RIBCompress "Compress exported RIB files with gzip?"
+ms_set en ayprefse_RIBCache "Write the geometry of top-level objects and\
+\nmasters to archive files that are re-used by the next export\
+\nas long as the objects do not change?"
+ms_set en ayprefse_RIBParallel "Export top-level objects in parallel\
+\nusing all processors?"
 ms_set en ayprefse_RenderMode "How shall the preview renderer render to\
 the screen?\n\
 CommandLineArg: via command line argument (display in extra window), s.a.\
@@ -164,6 +164,7 @@ proc prefs_open {} {
     addCheckB $fw ayprefse AutoSavePrefs [ms ayprefse_AutoSavePrefs]
     addCheckB $fw ayprefse BakOnReplace [ms ayprefse_BakOnReplace]
     addCheckB $fw ayprefse AddExtensions [ms ayprefse_AddExtensions]
+    addCheckB $fw ayprefse LazyLoad [ms ayprefse_LazyLoad]
     #addCheckB $fw ayprefse LoadEnv [ms ayprefse_LoadEnv]
     #addCheckB $fw ayprefse NewLoadsEnv [ms ayprefse_NewLoadsEnv]
     addFileTB $fw ayprefse EnvFile {{"Ayam Scene" ".ay"}} [ms ayprefse_EnvFile]
@@ -217,6 +218,8 @@ proc prefs_open {} {
     addMenuB $fw ayprefse DefaultAction [ms ayprefse_DefaultAction] $l
     addCheckB $fw ayprefse PickCycle [ms ayprefse_PickCycle]
     addParamB $fw ayprefse UndoLevels [ms ayprefse_UndoLevels] { 0 1 10 20 }
+    addParamB $fw ayprefse UndoMemory [ms ayprefse_UndoMemory]\
+	{ 0 64 256 1024 }
 
     # Drawing
     set fw [$nb insert end Drawing -text Drawing\
@@ -239,6 +242,8 @@ proc prefs_open {} {
     addMenuB $fw ayprefse NCDisplayModeA [ms ayprefse_NCDisplayModeA] $l
 
     addCheckB $fw ayprefse UseMatColor [ms ayprefse_UseMatColor]
+    addCheckB $fw ayprefse CullObjects [ms ayprefse_CullObjects]
+    addParamB $fw ayprefse CullSize [ms ayprefse_CullSize] { 0 2 4 8 }
     addColorB $fw ayprefse Background [ms ayprefse_Background]
     addColorB $fw ayprefse Object [ms ayprefse_Object]
     addColorB $fw ayprefse Selection [ms ayprefse_Selection]
@@ -424,6 +429,11 @@ proc prefs_addRIBExport { nb fw } {
     addCheckB $fw ayprefse RIStandard [ms ayprefse_RIStandard]
     addCheckB $fw ayprefse WriteIdent [ms ayprefse_WriteIdent]
     addCheckB $fw ayprefse ExcludeHidden [ms ayprefse_ExcludeHidden]
+    addMenuB $fw ayprefse RIBFormat [ms ayprefse_RIBFormat]\
+	    [list ASCII "ASCII (Precise)" Binary]
+    addCheckB $fw ayprefse RIBCompress [ms ayprefse_RIBCompress]
+    addCheckB $fw ayprefse RIBCache [ms ayprefse_RIBCache]
+    addCheckB $fw ayprefse RIBParallel [ms ayprefse_RIBParallel]
 
     addText $fw e0 "Rendering:"
 